@@ -20,6 +20,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "cg_local.h"
 
+// Boneposes are processed as arrays of dual quaternions
+static_assert( sizeof( bonepose_t ) == sizeof( dualquat_t ) );
+
 
 //========================================================================
 //
@@ -118,6 +121,10 @@ cgs_skeleton_t *CG_SkeletonForModel( struct model_s *model ) {
 		return NULL; // no bones or frames
 
 	}
+	if( numBones > (int)BoneHierarchyLevels::kMaxBones ) {
+		Com_Printf( S_COLOR_YELLOW "CG_SkeletonForModel: too many bones: %i\n", numBones );
+		return NULL;
+	}
 	for( skel = skel_headnode; skel; skel = skel->next ) {
 		if( skel->model == model ) {
 			return skel;
@@ -138,6 +145,15 @@ cgs_skeleton_t *CG_SkeletonForModel( struct model_s *model ) {
 	for( i = 0, bone = skel->bones; i < numBones; i++, bone++ )
 		bone->parent = R_SkeletalGetBoneInfo( model, i, bone->name, sizeof( bone->name ), &bone->flags );
 
+	int parents[BoneHierarchyLevels::kMaxBones];
+	for( i = 0; i < numBones; i++ )
+		parents[i] = skel->bones[i].parent;
+	if( !skel->boneLevels.build( parents, numBones ) ) {
+		Com_Printf( S_COLOR_YELLOW "CG_SkeletonForModel: illegal order of bones\n" );
+		Q_free( skel );
+		return NULL;
+	}
+
 	// register poses for all frames for all bones
 	for( i = 0; i < numFrames; i++ ) {
 		skel->bonePoses[i] = ( bonepose_t * )buffer; buffer += numBones * sizeof( bonepose_t );
@@ -205,17 +221,7 @@ void CG_RecurseBlendSkeletalBone( bonepose_t *inboneposes, bonepose_t *outbonepo
 * Transform boneposes to parent bone space (mount the skeleton)
 */
 void CG_TransformBoneposes( cgs_skeleton_t *skel, bonepose_t *outboneposes, bonepose_t *sourceboneposes ) {
-	int j;
-	bonepose_t temppose;
-
-	for( j = 0; j < (int)skel->numBones; j++ ) {
-		if( skel->bones[j].parent >= 0 ) {
-			memcpy( &temppose, &sourceboneposes[j], sizeof( bonepose_t ) );
-			DualQuat_Multiply( outboneposes[skel->bones[j].parent].dualquat, temppose.dualquat, outboneposes[j].dualquat );
-		} else if( outboneposes != sourceboneposes ) {
-			memcpy( &outboneposes[j], &sourceboneposes[j], sizeof( bonepose_t ) );
-		}
-	}
+	DualQuat_TransformHierarchy( &skel->boneLevels, &sourceboneposes->dualquat, &outboneposes->dualquat );
 }
 
 /*
@@ -224,8 +230,6 @@ void CG_TransformBoneposes( cgs_skeleton_t *skel, bonepose_t *outboneposes, bone
 * from nor if they are previously transformed or not
 */
 bool CG_LerpBoneposes( cgs_skeleton_t *skel, bonepose_t *curboneposes, bonepose_t *oldboneposes, bonepose_t *outboneposes, float frontlerp ) {
-	int i;
-
 	assert( curboneposes && oldboneposes && outboneposes );
 	assert( skel && skel->numBones && skel->numFrames );
 
@@ -235,9 +239,8 @@ bool CG_LerpBoneposes( cgs_skeleton_t *skel, bonepose_t *curboneposes, bonepose_
 		memcpy( outboneposes, oldboneposes, sizeof( bonepose_t ) * skel->numBones );
 	} else {
 		// lerp all bone poses
-		for( i = 0; i < (int)skel->numBones; i++, curboneposes++, oldboneposes++, outboneposes++ ) {
-			DualQuat_Lerp( oldboneposes->dualquat, curboneposes->dualquat, frontlerp, outboneposes->dualquat );
-		}
+		DualQuat_LerpMany( &oldboneposes->dualquat, &curboneposes->dualquat, frontlerp,
+						   &outboneposes->dualquat, skel->numBones );
 	}
 
 	return true;
@@ -500,3 +503,69 @@ void CG_FreeTemporaryBoneposesCache( void ) {
 
 	skel_headnode = nullptr;
 }
+
+/*
+* CG_BoneposesBenchmark_f
+* Compares scalar and batched interpolation and transformation of boneposes of all registered skeletons
+*/
+void CG_BoneposesBenchmark_f( void ) {
+	constexpr int kNumEntities = 64;
+	constexpr int kNumRuns = 100;
+
+	bonepose_t scalarPoses[BoneHierarchyLevels::kMaxBones], batchedPoses[BoneHierarchyLevels::kMaxBones];
+	bonepose_t tempPose;
+	uint64_t totalScalarMicros = 0, totalBatchedMicros = 0;
+	int numSkeletons = 0;
+
+	for( cgs_skeleton_t *skel = skel_headnode; skel; skel = skel->next ) {
+		float maxDifference = 0.0f;
+
+		const uint64_t scalarStartMicros = Sys_Microseconds();
+		for( int run = 0; run < kNumRuns; run++ ) {
+			for( int entNum = 0; entNum < kNumEntities; entNum++ ) {
+				const bonepose_t *oldPoses = skel->bonePoses[entNum % skel->numFrames];
+				const bonepose_t *curPoses = skel->bonePoses[( entNum + 1 ) % skel->numFrames];
+				const float frontlerp = ( (float)entNum + 0.5f ) / (float)kNumEntities;
+				for( int i = 0; i < skel->numBones; i++ ) {
+					DualQuat_Lerp( oldPoses[i].dualquat, curPoses[i].dualquat, frontlerp, scalarPoses[i].dualquat );
+				}
+				for( int i = 0; i < skel->numBones; i++ ) {
+					if( skel->bones[i].parent >= 0 ) {
+						memcpy( &tempPose, &scalarPoses[i], sizeof( bonepose_t ) );
+						DualQuat_Multiply( scalarPoses[skel->bones[i].parent].dualquat, tempPose.dualquat, scalarPoses[i].dualquat );
+					}
+				}
+			}
+		}
+		const uint64_t scalarMicros = Sys_Microseconds() - scalarStartMicros;
+
+		const uint64_t batchedStartMicros = Sys_Microseconds();
+		for( int run = 0; run < kNumRuns; run++ ) {
+			for( int entNum = 0; entNum < kNumEntities; entNum++ ) {
+				bonepose_t *oldPoses = skel->bonePoses[entNum % skel->numFrames];
+				bonepose_t *curPoses = skel->bonePoses[( entNum + 1 ) % skel->numFrames];
+				const float frontlerp = ( (float)entNum + 0.5f ) / (float)kNumEntities;
+				CG_LerpBoneposes( skel, curPoses, oldPoses, batchedPoses, frontlerp );
+				CG_TransformBoneposes( skel, batchedPoses, batchedPoses );
+			}
+		}
+		const uint64_t batchedMicros = Sys_Microseconds() - batchedStartMicros;
+
+		// Results of the last entity are left in buffers
+		for( int i = 0; i < skel->numBones; i++ ) {
+			for( int j = 0; j < 8; j++ ) {
+				maxDifference = wsw::max( maxDifference, std::fabs( scalarPoses[i].dualquat[j] - batchedPoses[i].dualquat[j] ) );
+			}
+		}
+
+		Com_Printf( "Skeleton of %d bones in %d levels: scalar %d micros, batched %d micros, max difference %f\n",
+					skel->numBones, (int)skel->boneLevels.numLevels, (int)scalarMicros, (int)batchedMicros, maxDifference );
+
+		totalScalarMicros += scalarMicros;
+		totalBatchedMicros += batchedMicros;
+		numSkeletons++;
+	}
+
+	Com_Printf( "Processed %d skeletons for %d entities %d times: scalar %d micros, batched %d micros\n",
+				numSkeletons, kNumEntities, kNumRuns, (int)totalScalarMicros, (int)totalBatchedMicros );
+}
@@ -46,3 +46,6 @@ void CG_TransformBoneposes( cgs_skeleton_t *skel, bonepose_t *boneposes,
 void CG_RotateBonePose( vec3_t angles, bonepose_t *bonepose );
 bool CG_SkeletalPoseGetAttachment( orientation_t *orient, cgs_skeleton_t *skel,
 								   bonepose_t *boneposes, const char *bonename );
+
+// A developer command that compares scalar and batched processing of boneposes
+void CG_BoneposesBenchmark_f( void );
@@ -917,6 +917,8 @@ static const cgcmd_t cgcmds[] =
 	{ "weapprev", CG_Cmd_PrevWeapon_f, true },
 	{ "weaplast", CG_Cmd_LastWeapon_f, true },
 	{ "viewpos", CG_Viewpos_f, true },
+	{ "hullsbench", CG_HullsBenchmark_f, true },
+	{ "boneposesbench", CG_BoneposesBenchmark_f, true },
 	{ "players", NULL, false },
 	{ "spectators", NULL, false },
 
@@ -19,6 +19,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 #include "cg_local.h"
 #include "../client/snd_public.h"
+#include "../qcommon/framearena.h"
 
 /*
 * CG_Event_WeaponBeam
@@ -562,16 +563,19 @@ static void CG_Fire_SunflowerPattern( vec3_t start, vec3_t dir, int *seed, int o
 	assert( count > 0 && count < 64 );
 	assert( std::abs( VectorLengthFast( dir ) - 1.0f ) < 0.001f );
 
-	auto *const solidImpacts  = (SolidImpact *)alloca( sizeof( SolidImpact ) * count );
-	auto *const liquidImpacts = (LiquidImpact *)alloca( sizeof( LiquidImpact ) * count );
-	auto *const tracerTargets = (vec3_t *)alloca( sizeof( vec3_t ) * count );
+	wsw::FrameArena *const arena = wsw::FrameArena::instance();
+	wsw::FrameArena::ScopedRewind scratchRewind( arena );
 
-	auto *const underwaterImpactOrigins       = (vec3_t *)alloca( sizeof( vec3_t ) * count );
-	auto *const underwaterImpactNormals       = (vec3_t *)alloca( sizeof( vec3_t ) * count );
-	auto *const underwaterImpactTracerIndices = (int *)alloca( sizeof( int ) * count );
+	auto *const solidImpacts  = arena->allocArray<SolidImpact>( count );
+	auto *const liquidImpacts = arena->allocArray<LiquidImpact>( count );
+	auto *const tracerTargets = arena->allocArray<vec3_t>( count );
 
-	auto *const solidImpactTracerIndices  = (unsigned *)alloca( sizeof( unsigned ) * count );
-	auto *const liquidImpactTracerIndices = (unsigned *)alloca( sizeof( unsigned ) * count );
+	auto *const underwaterImpactOrigins       = arena->allocArray<vec3_t>( count );
+	auto *const underwaterImpactNormals       = arena->allocArray<vec3_t>( count );
+	auto *const underwaterImpactTracerIndices = arena->allocArray<int>( count );
+
+	auto *const solidImpactTracerIndices  = arena->allocArray<unsigned>( count );
+	auto *const liquidImpactTracerIndices = arena->allocArray<unsigned>( count );
 
 	unsigned numSolidImpacts = 0, numLiquidImpacts = 0, numUnderwaterImpacts = 0, numTracerTargets = 0;
 
@@ -630,9 +634,9 @@ static void CG_Fire_SunflowerPattern( vec3_t start, vec3_t dir, int *seed, int o
 		}
 	}
 
-	auto *const tracerDelaysBuffer = (unsigned *)alloca( sizeof( unsigned ) * count );
-	auto *const liquidImpactDelays = (unsigned *)alloca( sizeof( unsigned ) * count );
-	auto *const solidImpactDelays  = (unsigned *)alloca( sizeof( unsigned ) * count );
+	auto *const tracerDelaysBuffer = arena->allocArray<unsigned>( count );
+	auto *const liquidImpactDelays = arena->allocArray<unsigned>( count );
+	auto *const solidImpactDelays  = arena->allocArray<unsigned>( count );
 
 	// TODO: Pass the origin stride plus impacts?
 	cg.effectsSystem.spawnPelletTracers( owner, start, { tracerTargets, numTracerTargets }, tracerDelaysBuffer );
@@ -161,6 +161,9 @@ typedef struct cgs_skeleton_s {
 	struct cg_tagmask_s *tagmasks;
 
 	struct bonenode_s *bonetree;
+
+	// Allows transforming boneposes in batches
+	BoneHierarchyLevels boneLevels;
 } cgs_skeleton_t;
 
 #include "cg_boneposes.h"
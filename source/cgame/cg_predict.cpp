@@ -20,12 +20,42 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "cg_local.h"
 
+#include <bit>
+
 int cg_numSolids;
 static entity_state_t *cg_solidList[MAX_PARSE_ENTITIES];
+// absolute bounds of solids for the server time of the current frame (expanded a bit)
+static vec3_t cg_solidMins[MAX_PARSE_ENTITIES];
+static vec3_t cg_solidMaxs[MAX_PARSE_ENTITIES];
 
 int cg_numTriggers;
 static entity_state_t *cg_triggersList[MAX_PARSE_ENTITIES];
 static bool cg_triggersListTriggered[MAX_PARSE_ENTITIES];
+static vec3_t cg_triggerMins[MAX_PARSE_ENTITIES];
+static vec3_t cg_triggerMaxs[MAX_PARSE_ENTITIES];
+
+#define SOLID_GRID_MAX_CELLS_PER_AXIS   32
+#define SOLID_GRID_MIN_CELL_SIZE        192.0f
+// solids that span more cells are tested by every query
+#define SOLID_GRID_MAX_CELLS_PER_SOLID  16
+#define SOLID_MASK_WORDS                ( MAX_PARSE_ENTITIES / 64 )
+
+typedef uint64_t solid_mask_t[SOLID_MASK_WORDS];
+
+/*
+* A uniform grid over the XY plane that gets rebuilt for every new frame.
+* Traces test only solids that are registered in cells overlapped by the trace bounds.
+* Candidates are marked in a bit mask of solid list indices, so the order of tests
+* (and thus the result in case of equal trace fractions) is the same as for the plain list scan.
+*/
+static struct {
+	vec2_t origin;
+	float invCellSize;
+	int numCellsX, numCellsY;
+	uint16_t cellOffsets[SOLID_GRID_MAX_CELLS_PER_AXIS * SOLID_GRID_MAX_CELLS_PER_AXIS + 1];
+	uint16_t cellSolids[MAX_PARSE_ENTITIES * SOLID_GRID_MAX_CELLS_PER_SOLID];
+	solid_mask_t alwaysTestedSolids;
+} cg_solidGrid;
 
 static bool ucmdReady = false;
 
@@ -106,6 +136,181 @@ void CG_CheckPredictionError( void ) {
 	}
 }
 
+/*
+* CG_SolidEntityBounds
+*
+* Returns false if there is no collision model for the entity
+*/
+static bool CG_SolidEntityBounds( const entity_state_t *ent, vec3_t absmins, vec3_t absmaxs ) {
+	vec3_t origin, mins, maxs;
+	// point contents are tested against the original origin of movers
+	vec3_t origin2;
+
+	if( ent->solid == SOLID_BMODEL ) { // special value for bmodel
+		const cmodel_s *cmodel = CG_InlineModel( ent->modelindex );
+		if( !cmodel ) {
+			return false;
+		}
+
+		if( ent->linearMovement ) {
+			GS_LinearMovement( ent, cg.frame.serverTime, origin );
+		} else {
+			VectorCopy( ent->origin, origin );
+		}
+		VectorCopy( ent->origin, origin2 );
+
+		CG_InlineModelBounds( cmodel, mins, maxs );
+		if( ent->angles[0] || ent->angles[1] || ent->angles[2] ) {
+			// use bounds of the sphere that contains the model in any rotation
+			const float radius = RadiusFromBounds( mins, maxs );
+			VectorSet( mins, -radius, -radius, -radius );
+			VectorSet( maxs, +radius, +radius, +radius );
+		}
+	} else {   // encoded bbox
+		const int x = 8 * ( ent->solid & 31 );
+		const int zd = 8 * ( ( ent->solid >> 5 ) & 31 );
+		const int zu = 8 * ( ( ent->solid >> 10 ) & 63 ) - 32;
+
+		VectorSet( mins, -x, -x, -zd );
+		VectorSet( maxs, +x, +x, zu );
+		VectorCopy( ent->origin, origin );
+		VectorCopy( ent->origin, origin2 );
+	}
+
+	// add some margin for trace epsilons
+	for( int i = 0; i < 3; i++ ) {
+		absmins[i] = wsw::min( origin[i], origin2[i] ) + mins[i] - 1.0f;
+		absmaxs[i] = wsw::max( origin[i], origin2[i] ) + maxs[i] + 1.0f;
+	}
+
+	return true;
+}
+
+static inline bool CG_BoundsIntersect( const vec3_t mins1, const vec3_t maxs1, const vec3_t mins2, const vec3_t maxs2 ) {
+	return mins1[0] <= maxs2[0] && mins1[1] <= maxs2[1] && mins1[2] <= maxs2[2] &&
+		   maxs1[0] >= mins2[0] && maxs1[1] >= mins2[1] && maxs1[2] >= mins2[2];
+}
+
+/*
+* CG_SolidGridCellRange
+*/
+static void CG_SolidGridCellRange( const vec3_t absmins, const vec3_t absmaxs, int *mins, int *maxs ) {
+	const int numCells[2] = { cg_solidGrid.numCellsX, cg_solidGrid.numCellsY };
+	for( int i = 0; i < 2; i++ ) {
+		const float invCellSize = cg_solidGrid.invCellSize;
+		const float minCell = floorf( ( absmins[i] - cg_solidGrid.origin[i] ) * invCellSize );
+		const float maxCell = floorf( ( absmaxs[i] - cg_solidGrid.origin[i] ) * invCellSize );
+		// clamp in the float domain so huge bounds do not overflow
+		mins[i] = (int)bound( 0.0f, minCell, (float)( numCells[i] - 1 ) );
+		maxs[i] = (int)bound( 0.0f, maxCell, (float)( numCells[i] - 1 ) );
+	}
+}
+
+/*
+* CG_BuildSolidGrid
+*/
+static void CG_BuildSolidGrid( void ) {
+	vec2_t gridMins = { +999999.0f, +999999.0f };
+	vec2_t gridMaxs = { -999999.0f, -999999.0f };
+	int cellMins[MAX_PARSE_ENTITIES][2], cellMaxs[MAX_PARSE_ENTITIES][2];
+
+	memset( cg_solidGrid.alwaysTestedSolids, 0, sizeof( cg_solidGrid.alwaysTestedSolids ) );
+	for( int i = 0; i < cg_numSolids; i++ ) {
+		for( int j = 0; j < 2; j++ ) {
+			gridMins[j] = wsw::min( gridMins[j], cg_solidMins[i][j] );
+			gridMaxs[j] = wsw::max( gridMaxs[j], cg_solidMaxs[i][j] );
+		}
+	}
+
+	float cellSize = SOLID_GRID_MIN_CELL_SIZE;
+	for( int j = 0; j < 2; j++ ) {
+		cellSize = wsw::max( cellSize, ( gridMaxs[j] - gridMins[j] ) * ( 1.0f / SOLID_GRID_MAX_CELLS_PER_AXIS ) );
+	}
+
+	Vector2Copy( gridMins, cg_solidGrid.origin );
+	cg_solidGrid.invCellSize = 1.0f / cellSize;
+	cg_solidGrid.numCellsX = (int)bound( 1.0f, ceilf( ( gridMaxs[0] - gridMins[0] ) / cellSize ), SOLID_GRID_MAX_CELLS_PER_AXIS );
+	cg_solidGrid.numCellsY = (int)bound( 1.0f, ceilf( ( gridMaxs[1] - gridMins[1] ) / cellSize ), SOLID_GRID_MAX_CELLS_PER_AXIS );
+
+	const int numCellsX = cg_solidGrid.numCellsX;
+	const int numCells = numCellsX * cg_solidGrid.numCellsY;
+	uint16_t *const cellOffsets = cg_solidGrid.cellOffsets;
+	memset( cellOffsets, 0, sizeof( cellOffsets[0] ) * ( numCells + 1 ) );
+
+	// count solids of every cell
+	// the entity we are predicting for gets its state restored during prediction, so it must be always tested
+	const int povEntNum = cg.frame.playerState.POVnum;
+	for( int i = 0; i < cg_numSolids; i++ ) {
+		CG_SolidGridCellRange( cg_solidMins[i], cg_solidMaxs[i], cellMins[i], cellMaxs[i] );
+		const int numSolidCells = ( cellMaxs[i][0] - cellMins[i][0] + 1 ) * ( cellMaxs[i][1] - cellMins[i][1] + 1 );
+		if( numSolidCells > SOLID_GRID_MAX_CELLS_PER_SOLID || cg_solidList[i]->number == povEntNum ) {
+			cg_solidGrid.alwaysTestedSolids[i >> 6] |= (uint64_t)1 << ( i & 63 );
+			continue;
+		}
+		for( int y = cellMins[i][1]; y <= cellMaxs[i][1]; y++ ) {
+			for( int x = cellMins[i][0]; x <= cellMaxs[i][0]; x++ ) {
+				cellOffsets[y * numCellsX + x + 1]++;
+			}
+		}
+	}
+
+	for( int i = 0; i < numCells; i++ ) {
+		cellOffsets[i + 1] += cellOffsets[i];
+	}
+
+	uint16_t cellHeads[SOLID_GRID_MAX_CELLS_PER_AXIS * SOLID_GRID_MAX_CELLS_PER_AXIS];
+	memcpy( cellHeads, cellOffsets, sizeof( cellHeads[0] ) * numCells );
+	for( int i = 0; i < cg_numSolids; i++ ) {
+		if( cg_solidGrid.alwaysTestedSolids[i >> 6] & ( (uint64_t)1 << ( i & 63 ) ) ) {
+			continue;
+		}
+		for( int y = cellMins[i][1]; y <= cellMaxs[i][1]; y++ ) {
+			for( int x = cellMins[i][0]; x <= cellMaxs[i][0]; x++ ) {
+				cg_solidGrid.cellSolids[cellHeads[y * numCellsX + x]++] = (uint16_t)i;
+			}
+		}
+	}
+}
+
+/*
+* CG_FindSolidsInBounds
+*
+* Finds solids that possibly intersect the given bounds.
+* Returns the number of found solid list indices (which are written in ascending order).
+*/
+static int CG_FindSolidsInBounds( const vec3_t absmins, const vec3_t absmaxs, int *solids ) {
+	int cellMins[2], cellMaxs[2];
+	solid_mask_t mask;
+
+	if( !cg_numSolids ) {
+		return 0;
+	}
+
+	memcpy( mask, cg_solidGrid.alwaysTestedSolids, sizeof( solid_mask_t ) );
+
+	CG_SolidGridCellRange( absmins, absmaxs, cellMins, cellMaxs );
+	for( int y = cellMins[1]; y <= cellMaxs[1]; y++ ) {
+		for( int x = cellMins[0]; x <= cellMaxs[0]; x++ ) {
+			const int cell = y * cg_solidGrid.numCellsX + x;
+			for( int j = cg_solidGrid.cellOffsets[cell]; j < cg_solidGrid.cellOffsets[cell + 1]; j++ ) {
+				const int solid = cg_solidGrid.cellSolids[j];
+				if( CG_BoundsIntersect( absmins, absmaxs, cg_solidMins[solid], cg_solidMaxs[solid] ) ) {
+					mask[solid >> 6] |= (uint64_t)1 << ( solid & 63 );
+				}
+			}
+		}
+	}
+
+	int numSolids = 0;
+	for( int word = 0; word < SOLID_MASK_WORDS; word++ ) {
+		for( uint64_t bits = mask[word]; bits; bits &= bits - 1 ) {
+			solids[numSolids++] = word * 64 + std::countr_zero( bits );
+		}
+	}
+
+	return numSolids;
+}
+
 /*
 * CG_BuildSolidList
 */
@@ -140,15 +345,22 @@ void CG_BuildSolidList( void ) {
 					break;
 
 				case ET_PUSH_TRIGGER:
-					cg_triggersList[cg_numTriggers++] = &cg_entities[ ent->number ].current;
+					if( CG_SolidEntityBounds( ent, cg_triggerMins[cg_numTriggers], cg_triggerMaxs[cg_numTriggers] ) ) {
+						cg_triggersList[cg_numTriggers++] = &cg_entities[ ent->number ].current;
+					}
 					break;
 
 				default:
-					cg_solidList[cg_numSolids++] = &cg_entities[ ent->number ].current;
+					// entities without a collision model are never hit
+					if( CG_SolidEntityBounds( ent, cg_solidMins[cg_numSolids], cg_solidMaxs[cg_numSolids] ) ) {
+						cg_solidList[cg_numSolids++] = &cg_entities[ ent->number ].current;
+					}
 					break;
 			}
 		}
 	}
+
+	CG_BuildSolidGrid();
 }
 
 /*
@@ -203,15 +415,23 @@ static bool CG_ClipEntityContact( const vec3_t origin, const vec3_t mins, const
 void CG_Predict_TouchTriggers( pmove_t *pm, const vec3_t previous_origin ) {
 	int i;
 	entity_state_t *state;
+	vec3_t absmins, absmaxs;
 
 	// fixme: more accurate check for being able to touch or not
 	if( pm->playerState->pmove.pm_type != PM_NORMAL ) {
 		return;
 	}
 
+	VectorAdd( pm->playerState->pmove.origin, pm->mins, absmins );
+	VectorAdd( pm->playerState->pmove.origin, pm->maxs, absmaxs );
+
 	for( i = 0; i < cg_numTriggers; i++ ) {
 		state = cg_triggersList[i];
 
+		if( !CG_BoundsIntersect( absmins, absmaxs, cg_triggerMins[i], cg_triggerMaxs[i] ) ) {
+			continue;
+		}
+
 		if( state->type == ET_PUSH_TRIGGER ) {
 			if( !cg_triggersListTriggered[i] ) {
 				if( CG_ClipEntityContact( pm->playerState->pmove.origin, pm->mins, pm->maxs, state->number ) ) {
@@ -233,10 +453,19 @@ static void CG_ClipMoveToEntities( const vec3_t start, const vec3_t mins, const
 	entity_state_t *ent;
 	const cmodel_s *cmodel;
 	vec3_t bmins, bmaxs;
+	vec3_t absmins, absmaxs;
+	int solids[MAX_PARSE_ENTITIES];
 	int64_t serverTime = cg.frame.serverTime;
 
-	for( i = 0; i < cg_numSolids; i++ ) {
-		ent = cg_solidList[i];
+	for( i = 0; i < 3; i++ ) {
+		absmins[i] = wsw::min( start[i], end[i] ) + ( mins ? mins[i] : 0.0f );
+		absmaxs[i] = wsw::max( start[i], end[i] ) + ( maxs ? maxs[i] : 0.0f );
+	}
+
+	const int numSolids = CG_FindSolidsInBounds( absmins, absmaxs, solids );
+
+	for( i = 0; i < numSolids; i++ ) {
+		ent = cg_solidList[solids[i]];
 
 		if( ent->number == ignore ) {
 			continue;
@@ -316,11 +545,13 @@ int CG_PointContents( const vec3_t point ) {
 	entity_state_t *ent;
 	const cmodel_s *cmodel;
 	int contents;
+	int solids[MAX_PARSE_ENTITIES];
 
 	contents = CG_TransformedPointContents( (vec_t *)point, NULL, NULL, NULL );
 
-	for( i = 0; i < cg_numSolids; i++ ) {
-		ent = cg_solidList[i];
+	const int numSolids = CG_FindSolidsInBounds( point, point, solids );
+	for( i = 0; i < numSolids; i++ ) {
+		ent = cg_solidList[solids[i]];
 		if( ent->solid != SOLID_BMODEL ) { // special value for bmodel
 			continue;
 		}
@@ -56,6 +56,8 @@ typedef struct snapshot_s {
 	bool delta;
 	bool allentities;
 	bool multipov;
+	bool quantized;         // entity positions and angles are quantized
+	msg_quantization_t quantization;
 	int64_t deltaFrameNum;
 	size_t areabytes;
 	uint8_t *areabits;             // portalarea visibility bits
@@ -0,0 +1,74 @@
+#include "particlekinematics.h"
+#include "../ref/ref.h"
+
+void integrateParticlesGeneric( Particle *__restrict particles, unsigned numParticles,
+								float drag, float deltaSeconds, BoundsBuilder *__restrict boundsBuilder ) {
+	if( drag > 0.0f ) {
+		for( unsigned i = 0; i < numParticles; ++i ) {
+			Particle *const __restrict particle = particles + i;
+			if( const float squareSpeed = VectorLengthSquared( particle->velocity ); squareSpeed > 1.0f ) [[likely]] {
+				const float rcpSpeed = Q_RSqrt( squareSpeed );
+				const float speed    = Q_Rcp( rcpSpeed );
+				vec4_t velocityDir;
+				VectorScale( particle->velocity, rcpSpeed, velocityDir );
+				const float forceLike  = drag * speed * speed;
+				const float deltaSpeed = -forceLike * deltaSeconds;
+				VectorMA( particle->velocity, deltaSpeed, velocityDir, particle->velocity );
+			}
+			VectorMA( particle->velocity, deltaSeconds, particle->accel, particle->velocity );
+			VectorMA( particle->oldOrigin, deltaSeconds, particle->velocity, particle->origin );
+			boundsBuilder->addPoint( particle->origin );
+		}
+	} else {
+		for( unsigned i = 0; i < numParticles; ++i ) {
+			Particle *const __restrict particle = particles + i;
+			VectorMA( particle->velocity, deltaSeconds, particle->accel, particle->velocity );
+			VectorMA( particle->oldOrigin, deltaSeconds, particle->velocity, particle->origin );
+			boundsBuilder->addPoint( particle->origin );
+		}
+	}
+}
+
+#ifdef WSW_USE_SSE2
+
+// Vectors of particles are 4-component ones with zero W components, so a vector fits a register.
+// Operations are performed in the same order as in the generic version, so results are the same.
+void integrateParticlesSse2( Particle *__restrict particles, unsigned numParticles,
+							 float drag, float deltaSeconds, BoundsBuilder *__restrict boundsBuilder ) {
+	const __m128 xmmDeltaSeconds = _mm_set1_ps( deltaSeconds );
+	if( drag > 0.0f ) {
+		for( unsigned i = 0; i < numParticles; ++i ) {
+			Particle *const __restrict particle = particles + i;
+			__m128 velocity = _mm_load_ps( particle->velocity );
+			// Sum squares of components like DotProduct() does
+			const __m128 squares    = _mm_mul_ps( velocity, velocity );
+			const __m128 sumOfXAndY = _mm_add_ss( squares, _mm_shuffle_ps( squares, squares, _MM_SHUFFLE( 1, 1, 1, 1 ) ) );
+			if( const float squareSpeed = _mm_cvtss_f32( _mm_add_ss( sumOfXAndY, _mm_movehl_ps( squares, squares ) ) );
+				squareSpeed > 1.0f ) [[likely]] {
+				const float rcpSpeed     = Q_RSqrt( squareSpeed );
+				const float speed        = Q_Rcp( rcpSpeed );
+				const __m128 velocityDir = _mm_mul_ps( velocity, _mm_set1_ps( rcpSpeed ) );
+				const float forceLike    = drag * speed * speed;
+				const float deltaSpeed   = -forceLike * deltaSeconds;
+				velocity = _mm_add_ps( velocity, _mm_mul_ps( _mm_set1_ps( deltaSpeed ), velocityDir ) );
+			}
+			velocity = _mm_add_ps( velocity, _mm_mul_ps( xmmDeltaSeconds, _mm_load_ps( particle->accel ) ) );
+			const __m128 origin = _mm_add_ps( _mm_load_ps( particle->oldOrigin ), _mm_mul_ps( xmmDeltaSeconds, velocity ) );
+			_mm_store_ps( particle->velocity, velocity );
+			_mm_store_ps( particle->origin, origin );
+			boundsBuilder->addPoint( origin );
+		}
+	} else {
+		for( unsigned i = 0; i < numParticles; ++i ) {
+			Particle *const __restrict particle = particles + i;
+			__m128 velocity = _mm_load_ps( particle->velocity );
+			velocity = _mm_add_ps( velocity, _mm_mul_ps( xmmDeltaSeconds, _mm_load_ps( particle->accel ) ) );
+			const __m128 origin = _mm_add_ps( _mm_load_ps( particle->oldOrigin ), _mm_mul_ps( xmmDeltaSeconds, velocity ) );
+			_mm_store_ps( particle->velocity, velocity );
+			_mm_store_ps( particle->origin, origin );
+			boundsBuilder->addPoint( origin );
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef WSW_e52f506c_fabc_45cc_8bbe_8bcda61bf131_H
+#define WSW_e52f506c_fabc_45cc_8bbe_8bcda61bf131_H
+
+#include "../gameshared/q_math.h"
+
+struct Particle;
+
+// Integrates velocities and origins of particles (rotation is updated separately) and adds new origins to bounds.
+// The generic version is kept for platforms without SSE2 and for validation of the SSE2 one.
+void integrateParticlesGeneric( Particle *__restrict particles, unsigned numParticles,
+								float drag, float deltaSeconds, BoundsBuilder *__restrict boundsBuilder );
+
+#ifdef WSW_USE_SSE2
+
+// Particles are stored as arrays of structures, so this version processes a single particle at a time,
+// utilizing the fact that vectors of particles are 4-component ones that fit a register.
+// The selection of the version is performed at compile time (there's no runtime dispatch).
+void integrateParticlesSse2( Particle *__restrict particles, unsigned numParticles,
+							 float drag, float deltaSeconds, BoundsBuilder *__restrict boundsBuilder );
+
+#endif
+
+#endif
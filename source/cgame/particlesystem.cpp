@@ -1,4 +1,5 @@
 #include "particlesystem.h"
+#include "particlekinematics.h"
 #include "../qcommon/links.h"
 #include "../client/client.h"
 #include "cg_local.h"
@@ -669,42 +670,17 @@ void ParticleSystem::runStepKinematics( ParticleFlock *__restrict flock, float d
 	assert( flock->numActivatedParticles );
 
 	BoundsBuilder boundsBuilder;
+#ifdef WSW_USE_SSE2
+	integrateParticlesSse2( flock->particles, flock->numActivatedParticles, flock->drag, deltaSeconds, &boundsBuilder );
+#else
+	integrateParticlesGeneric( flock->particles, flock->numActivatedParticles, flock->drag, deltaSeconds, &boundsBuilder );
+#endif
 
-	if( flock->drag > 0.0f ) {
+	if( flock->hasRotatingParticles ) {
 		for( unsigned i = 0; i < flock->numActivatedParticles; ++i ) {
 			Particle *const __restrict particle = flock->particles + i;
-			if( const float squareSpeed = VectorLengthSquared( particle->velocity ); squareSpeed > 1.0f ) [[likely]] {
-				const float rcpSpeed = Q_RSqrt( squareSpeed );
-				const float speed    = Q_Rcp( rcpSpeed );
-				vec4_t velocityDir;
-				VectorScale( particle->velocity, rcpSpeed, velocityDir );
-				const float forceLike  = flock->drag * speed * speed;
-				const float deltaSpeed = -forceLike * deltaSeconds;
-				VectorMA( particle->velocity, deltaSpeed, velocityDir, particle->velocity );
-			}
-			VectorMA( particle->velocity, deltaSeconds, particle->accel, particle->velocity );
-			VectorMA( particle->oldOrigin, deltaSeconds, particle->velocity, particle->origin );
-
-			if( flock->hasRotatingParticles ) {
-				particle->rotationAngle += particle->angularVelocity * deltaSeconds;
-				particle->rotationAngle = AngleNormalize360( particle->rotationAngle );
-			}
-
-			// TODO: Supply this 4-component vector explicitly
-			boundsBuilder.addPoint( particle->origin );
-		}
-	} else {
-		for( unsigned i = 0; i < flock->numActivatedParticles; ++i ) {
-			Particle *const __restrict particle = flock->particles + i;
-			VectorMA( particle->velocity, deltaSeconds, particle->accel, particle->velocity );
-			VectorMA( particle->oldOrigin, deltaSeconds, particle->velocity, particle->origin );
-			// TODO: Supply this 4-component vector explicitly
-			boundsBuilder.addPoint( particle->origin );
-
-			if( flock->hasRotatingParticles ) {
-				particle->rotationAngle += particle->angularVelocity * deltaSeconds;
-				particle->rotationAngle = AngleNormalize360( particle->rotationAngle );
-			}
+			particle->rotationAngle += particle->angularVelocity * deltaSeconds;
+			particle->rotationAngle = AngleNormalize360( particle->rotationAngle );
 		}
 	}
 
@@ -772,7 +748,17 @@ void ParticleSystem::simulate( ParticleFlock *__restrict flock, wsw::RandomGener
 			}
 		} while( particleIndex < flock->numActivatedParticles );
 	} else {
-		trace_t trace;
+		// Clip all particles at once, so every shape of the list is tested by many particles while it's in cache.
+		// Traces of particles that are timed out are wasted, but it's rare and it keeps the clipping loop tight.
+		assert( flock->numActivatedParticles <= kMaxClippedFlockSize );
+		vec3_t clipStarts[kMaxClippedFlockSize], clipEnds[kMaxClippedFlockSize];
+		trace_t traces[kMaxClippedFlockSize];
+		for( unsigned i = 0; i < flock->numActivatedParticles; ++i ) {
+			VectorCopy( flock->particles[i].oldOrigin, clipStarts[i] );
+			VectorCopy( flock->particles[i].origin, clipEnds[i] );
+		}
+		CM_ClipPointsToShapeList( cl.cms, flock->shapeList, traces, clipStarts, clipEnds,
+								  flock->numActivatedParticles, MASK_SOLID );
 
 		unsigned particleIndex = 0;
 		do {
@@ -781,14 +767,13 @@ void ParticleSystem::simulate( ParticleFlock *__restrict flock, wsw::RandomGener
 			const int64_t particleTimeoutAt = p->spawnTime + p->lifetime;
 
 			if( particleTimeoutAt <= currTime ) [[unlikely]] {
-				// Replace by the last particle
+				// Replace by the last particle (along with its trace)
 				flock->particles[particleIndex] = flock->particles[--flock->numActivatedParticles];
+				traces[particleIndex] = traces[flock->numActivatedParticles];
 				continue;
 			}
 
-			CM_ClipToShapeList( cl.cms, flock->shapeList, &trace, p->oldOrigin,
-								p->origin, vec3_origin, vec3_origin, MASK_SOLID );
-
+			const trace_t &trace = traces[particleIndex];
 			if( trace.fraction == 1.0f ) [[likely]] {
 				// Save the current origin as the old origin
 				VectorCopy( p->origin, p->oldOrigin );
@@ -815,8 +800,9 @@ void ParticleSystem::simulate( ParticleFlock *__restrict flock, wsw::RandomGener
 			}
 
 			if( !keepTheParticleByImpactRules ) [[unlikely]] {
-				// Replace by the last particle
+				// Replace by the last particle (along with its trace)
 				flock->particles[particleIndex] = flock->particles[--flock->numActivatedParticles];
+				traces[particleIndex] = traces[flock->numActivatedParticles];
 				continue;
 			}
 
@@ -825,8 +811,9 @@ void ParticleSystem::simulate( ParticleFlock *__restrict flock, wsw::RandomGener
 			const float oldSpeedThreshold = 1.0f;
 			const float newSpeedThreshold = oldSpeedThreshold * Q_Rcp( flock->restitution );
 			if( oldSquareSpeed < wsw::square( newSpeedThreshold ) ) [[unlikely]] {
-				// Replace by the last particle
+				// Replace by the last particle (along with its trace)
 				flock->particles[particleIndex] = flock->particles[--flock->numActivatedParticles];
+				traces[particleIndex] = traces[flock->numActivatedParticles];
 				continue;
 			}
 
@@ -954,4 +941,4 @@ auto ParticleSystem::activateDelayedParticles( ParticleFlock *flock, int64_t cur
 	assert( !flock->numDelayedParticles || flock->numActivatedParticles <= flock->delayedParticlesOffset );
 
 	return timeoutOfDelayedParticles ? std::optional( timeoutOfDelayedParticles ) : std::nullopt;
-}
\ No newline at end of file
+}
@@ -148,6 +148,11 @@ private:
 	static constexpr unsigned kMaxMediumFlockSize = 48;
 	static constexpr unsigned kMaxLargeFlockSize  = 144;
 
+	// Limits sizes of buffers that are used for batched clipping of particles
+	static constexpr unsigned kMaxClippedFlockSize = kMaxLargeFlockSize;
+	static_assert( kMaxClippedFlockSize >= kMaxSmallFlockSize && kMaxClippedFlockSize >= kMaxMediumFlockSize );
+	static_assert( kMaxClippedFlockSize >= kMaxClippedTrailFlockSize );
+
 	static constexpr unsigned kMaxNumberOfClippedFlocks = kMaxClippedTrailFlocks +
 		kMaxSmallFlocks + kMaxMediumFlocks + kMaxLargeFlocks;
 
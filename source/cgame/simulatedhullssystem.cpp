@@ -1,9 +1,11 @@
 #include "simulatedhullssystem.h"
+#include "cg_local.h"
 
 #include "../qcommon/links.h"
 #include "../client/client.h"
 #include "../qcommon/wswvector.h"
 #include "../qcommon/memspecbuilder.h"
+#include "../qcommon/jobsystem.h"
 
 #include <memory>
 #include <unordered_map>
@@ -620,59 +622,88 @@ void SimulatedHullsSystem::setupHullVertices( BaseConcentricSimulatedHull *hull,
 }
 
 void SimulatedHullsSystem::simulateFrameAndSubmit( int64_t currTime, DrawSceneRequest *drawSceneRequest ) {
+	simulateFrame( currTime, true );
+	submitFrame( currTime, drawSceneRequest );
+}
+
+void SimulatedHullsSystem::simulateFrame( int64_t currTime, bool useWorkers ) {
 	// Limit the time step
 	const float timeDeltaSeconds = 1e-3f * (float)wsw::min<int64_t>( 33, currTime - m_lastTime );
 
-	constexpr unsigned numRegularHulls = kMaxSmokeHulls + kMaxWaveHulls;
-	wsw::StaticVector<BaseRegularSimulatedHull *, numRegularHulls> activeRegularHulls;
-
-	constexpr unsigned numConcentricHulls = kMaxFireHulls + kMaxFireClusterHulls + kMaxBlastHulls;
-	wsw::StaticVector<BaseConcentricSimulatedHull *, numConcentricHulls> activeConcentricHulls;
+	m_frameActiveRegularHulls.clear();
+	m_frameActiveConcentricHulls.clear();
+	m_frameHullRngSeeds.clear();
 
+	// Regular hulls are much more expensive to simulate due to collision, let them be picked by workers first
+	for( SmokeHull *hull = m_smokeHullsHead, *nextHull = nullptr; hull; hull = nextHull ) { nextHull = hull->next;
+		if( hull->spawnTime + hull->lifetime > currTime ) [[likely]] {
+			m_frameActiveRegularHulls.push_back( hull );
+		} else {
+			unlinkAndFreeSmokeHull( hull );
+		}
+	}
+	for( WaveHull *hull = m_waveHullsHead, *nextHull = nullptr; hull; hull = nextHull ) { nextHull = hull->next;
+		if( hull->spawnTime + hull->lifetime > currTime ) [[likely]] {
+			m_frameActiveRegularHulls.push_back( hull );
+		} else {
+			unlinkAndFreeWaveHull( hull );
+		}
+	}
 	for( FireHull *hull = m_fireHullsHead, *nextHull = nullptr; hull; hull = nextHull ) { nextHull = hull->next;
 		if( hull->spawnTime + hull->lifetime > currTime ) [[likely]] {
-			hull->simulate( currTime, timeDeltaSeconds, &m_rng );
-			activeConcentricHulls.push_back( hull );
+			m_frameActiveConcentricHulls.push_back( hull );
 		} else {
 			unlinkAndFreeFireHull( hull );
 		}
 	}
 	for( FireClusterHull *hull = m_fireClusterHullsHead, *next = nullptr; hull; hull = next ) { next = hull->next;
 		if( hull->spawnTime + hull->lifetime > currTime ) [[likely]] {
-			hull->simulate( currTime, timeDeltaSeconds, &m_rng );
-			activeConcentricHulls.push_back( hull );
+			m_frameActiveConcentricHulls.push_back( hull );
 		} else {
 			unlinkAndFreeFireClusterHull( hull );
 		}
 	}
 	for( BlastHull *hull = m_blastHullsHead, *nextHull = nullptr; hull; hull = nextHull ) { nextHull = hull->next;
 		if( hull->spawnTime + hull->lifetime > currTime ) [[likely]] {
-			hull->simulate( currTime, timeDeltaSeconds, &m_rng );
-			activeConcentricHulls.push_back( hull );
+			m_frameActiveConcentricHulls.push_back( hull );
 		} else {
 			unlinkAndFreeBlastHull( hull );
 		}
 	}
-	for( SmokeHull *hull = m_smokeHullsHead, *nextHull = nullptr; hull; hull = nextHull ) { nextHull = hull->next;
-		if( hull->spawnTime + hull->lifetime > currTime ) [[likely]] {
-			hull->simulate( currTime, timeDeltaSeconds, &m_rng );
-			activeRegularHulls.push_back( hull );
-		} else {
-			unlinkAndFreeSmokeHull( hull );
-		}
+
+	const auto numRegularHulls = (unsigned)m_frameActiveRegularHulls.size();
+	const auto numHulls        = numRegularHulls + (unsigned)m_frameActiveConcentricHulls.size();
+	for( unsigned i = 0; i < numHulls; ++i ) {
+		m_frameHullRngSeeds.push_back( m_rng.next() );
 	}
-	for( WaveHull *hull = m_waveHullsHead, *nextHull = nullptr; hull; hull = nextHull ) { nextHull = hull->next;
-		if( hull->spawnTime + hull->lifetime > currTime ) [[likely]] {
-			hull->simulate( currTime, timeDeltaSeconds, &m_rng );
-			activeRegularHulls.push_back( hull );
-		} else {
-			unlinkAndFreeWaveHull( hull );
+
+	// Tasks write only data of their hulls (including shape lists).
+	// The collision model is shared but it's only read, and shape list building does not keep state in it
+	// (CM_BoxLeafnums() must stay reentrant for that).
+	const auto simulateHulls = [&]( unsigned beginIndex, unsigned endIndex ) {
+		for( unsigned i = beginIndex; i < endIndex; ++i ) {
+			wsw::RandomGenerator rng( m_frameHullRngSeeds[i] );
+			if( i < numRegularHulls ) {
+				m_frameActiveRegularHulls[i]->simulate( currTime, timeDeltaSeconds, &rng );
+			} else {
+				m_frameActiveConcentricHulls[i - numRegularHulls]->simulate( currTime, timeDeltaSeconds, &rng );
+			}
 		}
+	};
+
+	if( useWorkers ) {
+		wsw::JobSystem::instance()->parallelFor( numHulls, 1, simulateHulls );
+	} else {
+		simulateHulls( 0, numHulls );
 	}
 
+	m_lastTime = currTime;
+}
+
+void SimulatedHullsSystem::submitFrame( int64_t currTime, DrawSceneRequest *drawSceneRequest ) {
 	m_frameSharedOverrideColorsBuffer.clear();
 
-	for( BaseRegularSimulatedHull *__restrict hull: activeRegularHulls ) {
+	for( BaseRegularSimulatedHull *__restrict hull: m_frameActiveRegularHulls ) {
 		const SolidAppearanceRules *solidAppearanceRules = nullptr;
 		const CloudAppearanceRules *cloudAppearanceRules = nullptr;
 		if( const auto *solidAndCloudRules = std::get_if<SolidAndCloudAppearanceRules>( &hull->appearanceRules ) ) {
@@ -762,7 +793,7 @@ void SimulatedHullsSystem::simulateFrameAndSubmit( int64_t currTime, DrawSceneRe
 		}
 	}
 
-	for( const BaseConcentricSimulatedHull *__restrict hull: activeConcentricHulls ) {
+	for( const BaseConcentricSimulatedHull *__restrict hull: m_frameActiveConcentricHulls ) {
 		assert( hull->numLayers );
 
 		unsigned numSubmittedSolidMeshes = 0, numSubmittedCloudMeshes = 0;
@@ -882,8 +913,6 @@ void SimulatedHullsSystem::simulateFrameAndSubmit( int64_t currTime, DrawSceneRe
 													  drawOnTopCloudPartIndex );
 		}
 	}
-
-	m_lastTime = currTime;
 }
 
 void SimulatedHullsSystem::BaseRegularSimulatedHull::simulate( int64_t currTime, float timeDeltaSeconds,
@@ -2368,4 +2397,133 @@ auto SimulatedHullsSystem::HullCloudDynamicMesh::fillMeshBuffers( const float *_
 	} while( ++vertexNum < m_vertexNumLimitThisFrame );
 
 	return { numOutVertices, numOutIndices };
-};
\ No newline at end of file
+};
+
+void CG_HullsBenchmark_f() {
+	using Hulls = SimulatedHullsSystem;
+
+	constexpr unsigned kNumFrames     = 120;
+	constexpr int64_t kFrameMillis    = 16;
+	constexpr unsigned kHullsLifetime = 5000;
+
+	const Hulls::HullLayerParams layerParams[5] {
+		{ .speed = 22.5f, .finalOffset = 8.0f, .speedSpikeChance = 0.05f, .minSpeedSpike = 10.0f, .maxSpeedSpike = 15.0f,
+		  .biasAlongChosenDir = 30.0f, .baseInitialColor = { 1.0f, 0.9f, 0.4f, 1.0f }, .bulgeInitialColor = { 1.0f, 1.0f, 1.0f, 1.0f } },
+		{ .speed = 35.0f, .finalOffset = 6.0f, .speedSpikeChance = 0.05f, .minSpeedSpike = 7.5f, .maxSpeedSpike = 15.0f,
+		  .biasAlongChosenDir = 20.0f, .baseInitialColor = { 1.0f, 0.6f, 0.3f, 1.0f }, .bulgeInitialColor = { 1.0f, 0.9f, 0.4f, 1.0f } },
+		{ .speed = 45.0f, .finalOffset = 4.0f, .speedSpikeChance = 0.05f, .minSpeedSpike = 7.5f, .maxSpeedSpike = 15.0f,
+		  .biasAlongChosenDir = 15.0f, .baseInitialColor = { 0.7f, 0.4f, 0.3f, 1.0f }, .bulgeInitialColor = { 1.0f, 0.6f, 0.3f, 1.0f } },
+		{ .speed = 52.5f, .finalOffset = 2.0f, .speedSpikeChance = 0.05f, .minSpeedSpike = 7.5f, .maxSpeedSpike = 15.0f,
+		  .biasAlongChosenDir = 10.0f, .baseInitialColor = { 0.7f, 0.4f, 0.3f, 1.0f }, .bulgeInitialColor = { 0.7f, 0.4f, 0.3f, 1.0f } },
+		{ .speed = 60.0f, .finalOffset = 0.0f, .speedSpikeChance = 0.05f, .minSpeedSpike = 7.5f, .maxSpeedSpike = 15.0f,
+		  .biasAlongChosenDir = 5.0f, .baseInitialColor = { 0.7f, 0.4f, 0.3f, 1.0f }, .bulgeInitialColor = { 0.7f, 0.4f, 0.3f, 1.0f } },
+	};
+
+	const vec4_t smokeColor { 0.0f, 0.0f, 0.0f, 0.03f };
+	const vec4_t waveColor { 1.0f, 1.0f, 1.0f, 0.05f };
+
+	struct ModeResults {
+		wsw::Vector<uint64_t> frameMicros;
+		double checksum { 0.0 };
+	};
+
+	// Every run starts from scratch in a separate instance, so the live effects are not affected
+	const auto runMode = [&]( bool useWorkers ) -> ModeResults {
+		auto system = std::make_unique<Hulls>();
+		const int64_t startTime = cg.time;
+		system->m_lastTime      = startTime;
+
+		// Put hulls on a grid around the view origin, so they collide with the surrounding world
+		const auto getHullOrigin = [&]( unsigned hullNum, float *origin ) {
+			origin[0] = cg.view.origin[0] + 32.0f * (float)( (int)( hullNum % 8 ) - 4 );
+			origin[1] = cg.view.origin[1] + 32.0f * (float)( (int)( ( hullNum / 8 ) % 8 ) - 4 );
+			origin[2] = cg.view.origin[2];
+		};
+
+		vec3_t origin;
+		for( unsigned i = 0; i < Hulls::kMaxSmokeHulls; ++i ) {
+			if( auto *const hull = system->allocSmokeHull( startTime, kHullsLifetime ) ) {
+				hull->archimedesTopAccel     = { .initial = +125.0f, .fadedIn = +100.0f, .fadedOut = 0.0f };
+				hull->archimedesBottomAccel  = { .initial = 0.0f, .fadedIn = +75.0f, .fadedOut = +75.0f };
+				hull->xyExpansionTopAccel    = { .initial = 0.0f, .fadedIn = +95.0f, .fadedOut = 0.0f };
+				hull->xyExpansionBottomAccel = { .initial = 0.0f, .fadedIn = -45.0f, .fadedOut = -55.0f };
+				hull->expansionStartAt       = startTime + 125;
+				getHullOrigin( i, origin );
+				system->setupHullVertices( hull, origin, smokeColor, 85.0f, 15.0f );
+			}
+		}
+		for( unsigned i = 0; i < Hulls::kMaxWaveHulls; ++i ) {
+			if( auto *const hull = system->allocWaveHull( startTime, kHullsLifetime ) ) {
+				getHullOrigin( i, origin );
+				system->setupHullVertices( hull, origin, waveColor, 500.0f, 50.0f );
+			}
+		}
+		for( unsigned i = 0; i < Hulls::kMaxFireHulls; ++i ) {
+			if( auto *const hull = system->allocFireHull( startTime, kHullsLifetime ) ) {
+				getHullOrigin( i, origin );
+				system->setupHullVertices( hull, origin, 1.5f, { layerParams, hull->numLayers } );
+			}
+		}
+		for( unsigned i = 0; i < Hulls::kMaxFireClusterHulls; ++i ) {
+			if( auto *const hull = system->allocFireClusterHull( startTime, kHullsLifetime ) ) {
+				getHullOrigin( i, origin );
+				system->setupHullVertices( hull, origin, 0.5f, { layerParams, hull->numLayers } );
+			}
+		}
+		for( unsigned i = 0; i < Hulls::kMaxBlastHulls; ++i ) {
+			if( auto *const hull = system->allocBlastHull( startTime, kHullsLifetime ) ) {
+				getHullOrigin( i, origin );
+				system->setupHullVertices( hull, origin, 1.25f, { layerParams, hull->numLayers } );
+			}
+		}
+
+		ModeResults results;
+		for( unsigned frameNum = 1; frameNum <= kNumFrames; ++frameNum ) {
+			const uint64_t startMicros = Sys_Microseconds();
+			system->simulateFrame( startTime + frameNum * kFrameMillis, useWorkers );
+			results.frameMicros.push_back( Sys_Microseconds() - startMicros );
+		}
+
+		for( const Hulls::BaseRegularSimulatedHull *hull: system->m_frameActiveRegularHulls ) {
+			const auto numVertices = (unsigned)::basicHullsHolder.getIcosphereForLevel( hull->subdivLevel ).vertices.size();
+			for( unsigned i = 0; i < numVertices; ++i ) {
+				const float *const position = hull->vertexPositions[hull->positionsFrame][i];
+				results.checksum += (double)position[0] + (double)position[1] + (double)position[2];
+				results.checksum += (double)hull->vertexColors[i][3];
+			}
+		}
+		for( const Hulls::BaseConcentricSimulatedHull *hull: system->m_frameActiveConcentricHulls ) {
+			const auto numVertices = (unsigned)::basicHullsHolder.getIcosphereForLevel( hull->subdivLevel ).vertices.size();
+			for( unsigned layerNum = 0; layerNum < hull->numLayers; ++layerNum ) {
+				const Hulls::BaseConcentricSimulatedHull::Layer *const layer = &hull->layers[layerNum];
+				for( unsigned i = 0; i < numVertices; ++i ) {
+					const float *const position = layer->vertexPositions[i];
+					results.checksum += (double)position[0] + (double)position[1] + (double)position[2];
+					results.checksum += (double)layer->vertexColors[i][3];
+				}
+			}
+		}
+
+		std::sort( results.frameMicros.begin(), results.frameMicros.end() );
+		return results;
+	};
+
+	const auto printResults = []( const char *tag, const ModeResults &results ) {
+		const wsw::Vector<uint64_t> &micros = results.frameMicros;
+		Com_Printf( "%s: min %d, median %d, p95 %d, max %d micros per frame\n", tag,
+					(int)micros.front(), (int)micros[micros.size() / 2],
+					(int)micros[( micros.size() * 95 ) / 100], (int)micros.back() );
+	};
+
+	const ModeResults singleThreadedResults = runMode( false );
+	const ModeResults multiThreadedResults  = runMode( true );
+
+	Com_Printf( "Simulated %u frames of max hulls load using %u workers\n",
+				kNumFrames, wsw::JobSystem::instance()->numWorkers() );
+	printResults( "Single-threaded", singleThreadedResults );
+	printResults( "Multi-threaded", multiThreadedResults );
+	if( singleThreadedResults.checksum != multiThreadedResults.checksum ) {
+		Com_Printf( S_COLOR_YELLOW "Results of simulation differ: %f vs %f\n",
+					singleThreadedResults.checksum, multiThreadedResults.checksum );
+	}
+}
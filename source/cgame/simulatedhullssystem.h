@@ -13,6 +13,7 @@ struct CMShapeList;
 class SimulatedHullsSystem {
 	friend class TransientEffectsSystem;
 	friend class MeshTesselationHelper;
+	friend void CG_HullsBenchmark_f();
 public:
 	// TODO: Split function and fading direction?
 	enum class ViewDotFade : uint8_t {
@@ -473,8 +474,30 @@ private:
 	// Can't specify byte_vec4_t as the template parameter
 	wsw::Vector<uint32_t> m_frameSharedOverrideColorsBuffer;
 
+	static constexpr unsigned kMaxRegularHulls    = kMaxSmokeHulls + kMaxWaveHulls;
+	static constexpr unsigned kMaxConcentricHulls = kMaxFireHulls + kMaxFireClusterHulls + kMaxBlastHulls;
+
+	// Hulls that are alive this frame. Regular ones go first in the combined index space of simulation tasks.
+	wsw::StaticVector<BaseRegularSimulatedHull *, kMaxRegularHulls> m_frameActiveRegularHulls;
+	wsw::StaticVector<BaseConcentricSimulatedHull *, kMaxConcentricHulls> m_frameActiveConcentricHulls;
+	// Seeds of per-hull random generators are drawn serially, so results don't depend on the execution order
+	wsw::StaticVector<uint32_t, kMaxRegularHulls + kMaxConcentricHulls> m_frameHullRngSeeds;
+
 	wsw::RandomGenerator m_rng;
 	int64_t m_lastTime { 0 };
+
+	/**
+	 * Frees expired hulls and simulates active ones.
+	 * Hulls are independent of each other, so simulation of every hull is a separate task for workers of the job system.
+	 * @param useWorkers whether workers should be utilized (the single-threaded mode is retained for comparison)
+	 */
+	void simulateFrame( int64_t currTime, bool useWorkers );
+	void submitFrame( int64_t currTime, DrawSceneRequest *drawSceneRequest );
 };
 
+// A developer command that compares single-threaded and multi-threaded simulation of hulls under the max load.
+// Hulls collide with the world of the current map using shape lists of the client collision model,
+// and share the icospheres and the job system of the running client, so this can't be a benchmark of test executables.
+void CG_HullsBenchmark_f();
+
 #endif
\ No newline at end of file
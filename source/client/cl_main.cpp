@@ -1968,6 +1968,8 @@ static void CL_InitLocal( void ) {
 	Cvar_Get( "skin", DEFAULT_PLAYERSKIN, CVAR_USERINFO | CVAR_ARCHIVE );
 	Cvar_Get( "hand", "0", CVAR_USERINFO | CVAR_ARCHIVE );
 	Cvar_Get( "handicap", "0", CVAR_USERINFO | CVAR_ARCHIVE );
+	// lets the server send quantized entity positions (this saves bandwidth at cost of a minor precision loss)
+	Cvar_Get( "cl_quantized_snaps", "0", CVAR_USERINFO | CVAR_ARCHIVE );
 
 	Cvar_Get( "cl_download_name", "", CVAR_READONLY );
 	Cvar_Get( "cl_download_percent", "0", CVAR_READONLY );
@@ -90,7 +90,7 @@ static void SNAP_ParseDeltaEntity( msg_t *msg, snapshot_t *frame, int newnum, en
 
 	state = &frame->parsedEntities[frame->numEntities & ( MAX_PARSE_ENTITIES - 1 )];
 	frame->numEntities++;
-	MSG_ReadDeltaEntity( msg, old, state, newnum, byteMask );
+	MSG_ReadDeltaEntity( msg, old, state, newnum, byteMask, frame->quantized ? &frame->quantization : nullptr );
 }
 
 /*
@@ -282,6 +282,10 @@ static snapshot_t *SNAP_ParseFrameHeader( msg_t *msg, snapshot_t *newframe, int
 	newframe->delta = ( flags & FRAMESNAP_FLAG_DELTA ) ? true : false;
 	newframe->multipov = ( flags & FRAMESNAP_FLAG_MULTIPOV ) ? true : false;
 	newframe->allentities = ( flags & FRAMESNAP_FLAG_ALLENTITIES ) ? true : false;
+	newframe->quantized = ( flags & FRAMESNAP_FLAG_QUANTIZED ) ? true : false;
+	if( newframe->quantized ) {
+		MSG_ReadQuantization( msg, &newframe->quantization );
+	}
 
 	supCnt = MSG_ReadUint8( msg );
 	if( suppressCount ) {
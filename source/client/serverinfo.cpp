@@ -0,0 +1,127 @@
+#include "serverlist.h"
+
+#include <cstring>
+
+void MatchTime::clear() {
+	memset( this, 0, sizeof( MatchTime ) );
+}
+
+bool MatchTime::operator==( const MatchTime &that ) const {
+	return !memcmp( this, &that, sizeof( MatchTime ) );
+}
+
+void MatchScore::clear() {
+	scores[0].clear();
+	scores[1].clear();
+}
+
+bool MatchScore::operator==( const MatchScore &that ) const {
+	// Its better to do integer comparisons first, thats why there are no individual TeamScore::Equals() methods
+	for( int i = 0; i < 2; ++i ) {
+		if( this->scores[i].score != that.scores[i].score ) {
+			return false;
+		}
+	}
+
+	for( int i = 0; i < 2; ++i ) {
+		if( this->scores[i].name != that.scores[i].name ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool PlayerInfo::operator==( const PlayerInfo &that ) const {
+	// Do these cheap comparisons first
+	if( this->score != that.score || this->ping != that.ping || this->team != that.team ) {
+		return false;
+	}
+	return this->name == that.name;
+}
+
+void ServerInfo::clearPlayerInfo( PlayerInfo *infoHead ) {
+	PlayerInfo *nextInfo;
+	for( PlayerInfo *info = infoHead; info; info = nextInfo ) {
+		nextInfo = info->next;
+		delete info;
+	}
+}
+
+ServerInfo::~ServerInfo() {
+	for( auto *infoHead: teamInfoHeads ) {
+		clearPlayerInfo( infoHead );
+	}
+}
+
+bool ServerInfo::comparePlayersList( const PlayerInfo *list1, const PlayerInfo *list2 ) {
+	for(;; ) {
+		if( !list1 ) {
+			return !list2;
+		}
+		if( !list2 ) {
+			return false;
+		}
+		if( *list1 != *list2 ) {
+			return false;
+		}
+
+		list1 = list1->next;
+		list2 = list2->next;
+	}
+}
+
+auto ServerInfo::findChangedFields( const ServerInfo *oldInfo ) const -> unsigned {
+	if( !oldInfo ) {
+		return kAllFields;
+	}
+
+	unsigned result = 0;
+
+	if( this->time != oldInfo->time ) {
+		result |= TimeField;
+	}
+
+	if( this->numClients != oldInfo->numClients ) {
+		result |= NumClientsField;
+	}
+
+	static_assert( SpectatorsField << 1 == PlayersTeamField && PlayersTeamField << 1 == AlphaTeamField );
+	static_assert( AlphaTeamField << 1 == BetaTeamField );
+	for( int i = 0; i < 4; ++i ) {
+		if( this->numTeamPlayers[i] != oldInfo->numTeamPlayers[i] ) {
+			result |= ( SpectatorsField << i );
+		} else if( !comparePlayersList( teamInfoHeads[i], oldInfo->teamInfoHeads[i] ) ) {
+			result |= ( SpectatorsField << i );
+		}
+	}
+
+	if( this->score != oldInfo->score ) {
+		result |= ScoreField;
+	}
+
+	if( mapname != oldInfo->mapname ) {
+		result |= MapNameField;
+	}
+
+	if( gametype != oldInfo->gametype ) {
+		result |= GametypeField;
+	}
+
+	if( this->numBots != oldInfo->numBots ) {
+		result |= NumBotsField;
+	}
+
+	if( serverName != oldInfo->serverName ) {
+		result |= ServerNameField;
+	}
+
+	if( this->maxClients != oldInfo->maxClients ) {
+		result |= MaxClientsField;
+	}
+
+	if( this->needPassword != oldInfo->needPassword ) {
+		result |= NeedPasswordField;
+	}
+
+	return result;
+}
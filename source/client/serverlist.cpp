@@ -400,6 +400,7 @@ void ServerList::onServerAddressReceived( const netadr_t &address ) {
 
 	auto *const server = new PolledGameServer;
 	server->m_networkAddress = address;
+	server->m_instanceId = m_instanceIdCounter++;
 	wsw::link( server, &m_serversHead, PolledGameServer::LIST_LINKS );
 	server->m_addressHash = hash;
 	server->m_hashBinIndex = binIndex;
@@ -430,6 +431,14 @@ void ServerList::clearState() {
 
 	std::fill( std::begin( m_serversHashBins ), std::end( m_serversHashBins ), nullptr );
 	m_serversHead = nullptr;
+
+	// These servers are already unlinked
+	for( PolledGameServer *server: m_pendingRemovals ) {
+		delete server;
+	}
+
+	m_pendingRemovals.clear();
+	m_pendingUpdates.clear();
 }
 
 void ServerList::frame() {
@@ -441,6 +450,8 @@ void ServerList::frame() {
 
 	emitPollInfoServersPackets();
 	emitPollGameServersPackets();
+
+	dispatchPendingChanges();
 }
 
 void ServerList::startPushingUpdates( ServerListListener *listener, bool showEmptyServers, bool showFullServers ) {
@@ -500,10 +511,11 @@ void ServerList::dropTimedOutServers() {
 }
 
 void ServerList::dropServer( PolledGameServer *server ) {
-	m_listener->onServerRemoved( server );
 	wsw::unlink( server, &m_serversHead, PolledGameServer::LIST_LINKS );
 	wsw::unlink( server, &m_serversHashBins[server->m_hashBinIndex], PolledGameServer::BIN_LINKS );
-	delete server;
+	// The listener still may refer to the server, defer the disposal until the removal gets dispatched
+	server->m_isPendingRemoval = true;
+	m_pendingRemovals.push_back( server );
 }
 
 void ServerList::sendPollInfoServerPacket( const netadr_t &address ) {
@@ -533,131 +545,68 @@ void ServerList::onNewServerInfo( PolledGameServer *server, ServerInfo *newServe
 	server->m_currInfo = newServerInfo;
 	server->m_lastInfoReceivedAt = Sys_Milliseconds();
 
-	if( !newServerInfo->matchesOld( server->m_oldInfo ) ) {
-		if( server->m_oldInfo ) {
-			m_listener->onServerUpdated( server );
-		} else {
-			// Defer server addition until a first info arrives.
-			// Otherwise there is just nothing to show in a server browser.
-			// If there is no old info, the listener has not been notified about a new server yet.
-			m_listener->onServerAdded( server );
-		}
-	}
-}
-
-void MatchTime::clear() {
-	memset( this, 0, sizeof( MatchTime ) );
-}
-
-bool MatchTime::operator==( const MatchTime &that ) const {
-	return !memcmp( this, &that, sizeof( MatchTime ) );
-}
-
-void MatchScore::clear() {
-	scores[0].clear();
-	scores[1].clear();
-}
-
-bool MatchScore::operator==( const MatchScore &that ) const {
-	// Its better to do integer comparisons first, thats why there are no individual TeamScore::Equals() methods
-	for( int i = 0; i < 2; ++i ) {
-		if( this->scores[i].score != that.scores[i].score ) {
-			return false;
-		}
-	}
-
-	for( int i = 0; i < 2; ++i ) {
-		if( this->scores[i].name != that.scores[i].name ) {
-			return false;
+	// Note: The server addition is deferred until a first info arrives.
+	// Otherwise there is just nothing to show in a server browser.
+	if( const unsigned changedFields = newServerInfo->findChangedFields( server->m_oldInfo ) ) {
+		server->m_pendingChangedFields |= changedFields;
+		if( !server->m_isPendingUpdate ) {
+			server->m_isPendingUpdate = true;
+			m_pendingUpdates.push_back( server );
 		}
 	}
-	return true;
 }
 
-bool PlayerInfo::operator==( const PlayerInfo &that ) const {
-	// Do these cheap comparisons first
-	if( this->score != that.score || this->ping != that.ping || this->team != that.team ) {
+bool ServerList::passesFilter( const PolledGameServer *server ) const {
+	if( !m_showEmptyServers && !server->getNumClients() ) {
 		return false;
 	}
-	return this->name == that.name;
-}
-
-void ServerInfo::clearPlayerInfo( PlayerInfo *infoHead ) {
-	PlayerInfo *nextInfo;
-	for( PlayerInfo *info = infoHead; info; info = nextInfo ) {
-		nextInfo = info->next;
-		delete info;
+	if( !m_showFullServers && server->getNumClients() >= server->getMaxClients() ) {
+		return false;
 	}
+	return true;
 }
 
-ServerInfo::~ServerInfo() {
-	for( auto *infoHead: teamInfoHeads ) {
-		clearPlayerInfo( infoHead );
-	}
-}
+void ServerList::dispatchPendingChanges() {
+	m_addedBuffer.clear();
+	m_removedBuffer.clear();
+	m_updatedBuffer.clear();
 
-bool ServerInfo::comparePlayersList( const PlayerInfo *list1, const PlayerInfo *list2 ) {
-	for(;; ) {
-		if( !list1 ) {
-			return !list2;
-		}
-		if( !list2 ) {
-			return false;
+	for( PolledGameServer *server: m_pendingRemovals ) {
+		if( server->m_isShownToListener ) {
+			m_removedBuffer.push_back( server );
 		}
-		if( *list1 != *list2 ) {
-			return false;
-		}
-
-		list1 = list1->next;
-		list2 = list2->next;
-	}
-}
-
-bool ServerInfo::matchesOld( ServerInfo *oldInfo ) {
-	if( !oldInfo ) {
-		return false;
-	}
-
-	// Test fields that are likely to change often first
-
-	if( this->time != oldInfo->time ) {
-		return false;
-	}
-
-	if( this->numClients != oldInfo->numClients ) {
-		return false;
 	}
 
-	for( int i = 0; i < 4; ++i ) {
-		if( this->numTeamPlayers[i] != oldInfo->numTeamPlayers[i] ) {
-			return false;
+	for( PolledGameServer *server: m_pendingUpdates ) {
+		if( server->m_isPendingRemoval ) {
+			continue;
 		}
-		if( !comparePlayersList( teamInfoHeads[i], oldInfo->teamInfoHeads[i] ) ) {
-			return false;
+		// Filtering is performed incrementally, only for servers that have changed
+		const bool passesFilter = this->passesFilter( server );
+		if( server->m_isShownToListener ) {
+			if( passesFilter ) {
+				m_updatedBuffer.push_back( { server, server->m_pendingChangedFields } );
+			} else {
+				m_removedBuffer.push_back( server );
+				server->m_isShownToListener = false;
+			}
+		} else if( passesFilter ) {
+			m_addedBuffer.push_back( server );
+			server->m_isShownToListener = true;
 		}
+		server->m_pendingChangedFields = 0;
+		server->m_isPendingUpdate = false;
 	}
 
-	if( this->score != oldInfo->score ) {
-		return false;
-	}
-
-	if( mapname != oldInfo->mapname ) {
-		return false;
-	}
-
-	if( gametype != oldInfo->gametype ) {
-		return false;
+	const ServerListChangeSet changeSet { m_addedBuffer, m_removedBuffer, m_updatedBuffer };
+	if( !changeSet.empty() ) {
+		m_listener->onServerListChanged( changeSet );
 	}
 
-	if( this->numBots != oldInfo->numBots ) {
-		return false;
-	}
-
-	// Never changes until server restart
-
-	if( serverName != oldInfo->serverName ) {
-		return false;
+	for( PolledGameServer *server: m_pendingRemovals ) {
+		delete server;
 	}
 
-	return this->maxClients == oldInfo->maxClients && this->needPassword == oldInfo->needPassword;
-}
\ No newline at end of file
+	m_pendingRemovals.clear();
+	m_pendingUpdates.clear();
+}
@@ -4,9 +4,11 @@
 #include "../qcommon/qcommon.h"
 #include "../qcommon/wswstaticstring.h"
 #include "../qcommon/wswstaticvector.h"
+#include "../qcommon/wswvector.h"
 #include "serverinfoparser.h"
 
 #include <atomic>
+#include <span>
 
 class PlayerInfo {
 public:
@@ -75,7 +77,7 @@ struct MatchScore {
 	void clear();
 	bool operator==( const MatchScore &that ) const;
 	bool operator!=( const MatchScore &that ) const {
-		return ( *this == that );
+		return !( *this == that );
 	}
 };
 
@@ -102,7 +104,30 @@ public:
 
 	bool needPassword { false };
 
-	bool matchesOld( ServerInfo *oldInfo );
+	enum ChangedField : unsigned {
+		ServerNameField     = 1 << 0,
+		GametypeField       = 1 << 1,
+		MapNameField        = 1 << 2,
+		TimeField           = 1 << 3,
+		ScoreField          = 1 << 4,
+		NumClientsField     = 1 << 5,
+		MaxClientsField     = 1 << 6,
+		NumBotsField        = 1 << 7,
+		NeedPasswordField   = 1 << 8,
+		SpectatorsField     = 1 << 9,
+		PlayersTeamField    = 1 << 10,
+		AlphaTeamField      = 1 << 11,
+		BetaTeamField       = 1 << 12,
+	};
+
+	static constexpr unsigned kAllFields = ( BetaTeamField << 1 ) - 1;
+
+	/**
+	 * Compares the info with a previously received info of the same server.
+	 * @return a mask of {@code ChangedField} bits (all bits are set if there's no old info).
+	 */
+	[[nodiscard]]
+	auto findChangedFields( const ServerInfo *oldInfo ) const -> unsigned;
 
 	[[nodiscard]]
 	auto getPlayersListForTeam( int team ) const -> std::pair<const PlayerInfo *, int> {
@@ -111,6 +136,8 @@ public:
 	}
 };
 
+class ServerListModelTest;
+
 namespace wsw {
 template <typename T> auto link( T *, T **, int ) -> T *;
 template <typename T> auto unlink( T *, T **, int ) -> T *;
@@ -118,6 +145,7 @@ template <typename T> auto unlink( T *, T **, int ) -> T *;
 
 class PolledGameServer {
 	friend class ServerList;
+	friend class ::ServerListModelTest;
 	template <typename T> friend auto wsw::link( T *, T **, int ) -> T *;
 	template <typename T> friend auto wsw::unlink( T *, T **, int ) -> T *;
 
@@ -142,6 +170,13 @@ class PolledGameServer {
 
 	unsigned m_instanceId { 0 };
 
+	// Fields that have changed since the last change set was dispatched
+	unsigned m_pendingChangedFields { 0 };
+	bool m_isPendingUpdate { false };
+	bool m_isPendingRemoval { false };
+	// Whether the listener has been notified of the server addition
+	bool m_isShownToListener { false };
+
 	[[nodiscard]]
 	auto getCheckedInfo() const -> const ServerInfo * {
 		assert( m_currInfo );
@@ -212,13 +247,30 @@ public:
 	}
 };
 
+/**
+ * Changes of the list that have been accumulated during a polling tick.
+ * Servers that start or stop passing the list filter are reported as added or removed as well.
+ * Removed servers are still valid during dispatching of the change set.
+ */
+struct ServerListChangeSet {
+	struct Update {
+		const PolledGameServer *server;
+		unsigned changedFields;
+	};
+
+	std::span<const PolledGameServer *const> added;
+	std::span<const PolledGameServer *const> removed;
+	std::span<const Update> updated;
+
+	[[nodiscard]]
+	bool empty() const { return added.empty() && removed.empty() && updated.empty(); }
+};
+
 class ServerListListener {
 public:
 	virtual ~ServerListListener() = default;
 
-	virtual void onServerAdded( const PolledGameServer *server ) = 0;
-	virtual void onServerRemoved( const PolledGameServer *server ) = 0;
-	virtual void onServerUpdated( const PolledGameServer *server ) = 0;
+	virtual void onServerListChanged( const ServerListChangeSet &changeSet ) = 0;
 };
 
 class ServerInfoParser;
@@ -245,8 +297,24 @@ class ServerList {
 	bool m_showFullServers { true };
 	bool m_showPlayerInfo { true };
 
+	unsigned m_instanceIdCounter { 0 };
+
+	// Servers that have received a changed info or were dropped since the last dispatch
+	wsw::Vector<PolledGameServer *> m_pendingUpdates;
+	wsw::Vector<PolledGameServer *> m_pendingRemovals;
+
+	// Reused buffers of a change set
+	wsw::Vector<const PolledGameServer *> m_addedBuffer;
+	wsw::Vector<const PolledGameServer *> m_removedBuffer;
+	wsw::Vector<ServerListChangeSet::Update> m_updatedBuffer;
+
 	void onNewServerInfo( PolledGameServer *server, ServerInfo *parsedServerInfo );
 
+	[[nodiscard]]
+	bool passesFilter( const PolledGameServer *server ) const;
+
+	void dispatchPendingChanges();
+
 	ServerInfoParser *m_serverInfoParser;
 
 	[[nodiscard]]
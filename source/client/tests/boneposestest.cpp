@@ -0,0 +1,231 @@
+#include "boneposestest.h"
+#include "../../gameshared/q_math.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using DualQuats = std::vector<std::array<float, 8>>;
+
+[[nodiscard]]
+static auto dqs( DualQuats &dualQuats ) -> dualquat_t * { return (dualquat_t *)dualQuats.data(); }
+[[nodiscard]]
+static auto dqs( const DualQuats &dualQuats ) -> const dualquat_t * { return (const dualquat_t *)dualQuats.data(); }
+
+// A skeleton which is shaped like skeletons of player models (few roots, branchy limbs, chains of moderate depth)
+class BoneposesTest::SyntheticSkeleton {
+public:
+	static constexpr unsigned kNumFrames = 16;
+
+	SyntheticSkeleton( unsigned seed, unsigned numBones ) : m_rng( seed ), m_numBones( numBones ) {
+		for( unsigned i = 0; i < numBones; ++i ) {
+			if( i == 0 || randomFloat( 0.0f, 1.0f ) < 0.03f ) {
+				m_parents.push_back( -1 );
+			} else {
+				const unsigned maxBackStep = std::min( i, 8u );
+				m_parents.push_back( (int)( i - 1 - ( m_rng() % maxBackStep ) ) );
+			}
+		}
+		m_frames.resize( kNumFrames * numBones );
+		for( auto &dq: m_frames ) {
+			setRandomDualQuat( dq.data() );
+		}
+		m_invBasePoses.resize( numBones );
+		for( auto &dq: m_invBasePoses ) {
+			setRandomDualQuat( dq.data() );
+		}
+	}
+
+	[[nodiscard]]
+	auto numBones() const -> unsigned { return m_numBones; }
+	[[nodiscard]]
+	auto parents() const -> const int * { return m_parents.data(); }
+	[[nodiscard]]
+	auto frame( unsigned frameNum ) const -> const dualquat_t * { return dqs( m_frames ) + frameNum * m_numBones; }
+	[[nodiscard]]
+	auto invBasePoses() const -> const dualquat_t * { return dqs( m_invBasePoses ); }
+
+	[[nodiscard]]
+	auto randomFloat( float min, float max ) -> float {
+		return std::uniform_real_distribution<float>( min, max )( m_rng );
+	}
+
+	void setRandomDualQuat( dualquat_t dq ) {
+		for( unsigned i = 0; i < 8; ++i ) {
+			dq[i] = randomFloat( -1.0f, +1.0f );
+		}
+		// Make sure the real part is a rotation (the dual part is arbitrary)
+		dq[3] += 0.1f;
+		Quat_Normalize( dq );
+	}
+
+	// Transforms bones one by one like code which is superseded by the batched version does
+	void transformSerially( const dualquat_t *in, dualquat_t *out ) const {
+		for( unsigned i = 0; i < m_numBones; ++i ) {
+			if( m_parents[i] >= 0 ) {
+				dualquat_t tmp;
+				DualQuat_Copy( in[i], tmp );
+				DualQuat_Multiply( out[m_parents[i]], tmp, out[i] );
+			} else {
+				DualQuat_Copy( in[i], out[i] );
+			}
+		}
+	}
+private:
+	std::minstd_rand0 m_rng;
+	const unsigned m_numBones;
+	std::vector<int> m_parents;
+	DualQuats m_frames;
+	DualQuats m_invBasePoses;
+};
+
+[[nodiscard]]
+static auto maxAbsDifference( const dualquat_t *a, const dualquat_t *b, unsigned count ) -> float {
+	float result = 0.0f;
+	for( unsigned i = 0; i < count; ++i ) {
+		for( unsigned j = 0; j < 8; ++j ) {
+			result = std::max( result, std::fabs( a[i][j] - b[i][j] ) );
+		}
+	}
+	return result;
+}
+
+static constexpr float kEpsilon = 1e-5f;
+
+void BoneposesTest::test_hierarchyLevels() {
+	for( unsigned numBones: { 0u, 1u, 2u, 7u, 48u, 111u, 256u } ) {
+		SyntheticSkeleton skeleton( numBones + 1, numBones );
+		BoneHierarchyLevels levels;
+		QVERIFY( levels.build( skeleton.parents(), numBones ) );
+		QCOMPARE( (unsigned)levels.levelOffsets[levels.numLevels], numBones );
+
+		std::vector<int> levelsOfBones( numBones, -1 );
+		for( unsigned levelNum = 0; levelNum < levels.numLevels; ++levelNum ) {
+			QVERIFY( levels.levelOffsets[levelNum] < levels.levelOffsets[levelNum + 1] );
+			for( unsigned i = levels.levelOffsets[levelNum]; i < levels.levelOffsets[levelNum + 1]; ++i ) {
+				const unsigned bone = levels.bones[i];
+				QCOMPARE( levelsOfBones[bone], -1 );
+				levelsOfBones[bone] = (int)levelNum;
+				const int parent = skeleton.parents()[bone];
+				if( levelNum ) {
+					QCOMPARE( (int)levels.parents[i], parent );
+					QCOMPARE( levelsOfBones[parent], (int)levelNum - 1 );
+				} else {
+					QVERIFY( parent < 0 );
+				}
+			}
+		}
+	}
+
+	BoneHierarchyLevels levels;
+	const int illegalParents[] { -1, 2, 0 };
+	QVERIFY( !levels.build( illegalParents, 3 ) );
+	const int selfParents[] { -1, 1 };
+	QVERIFY( !levels.build( selfParents, 2 ) );
+	std::vector<int> tooManyParents( BoneHierarchyLevels::kMaxBones + 1, -1 );
+	QVERIFY( !levels.build( tooManyParents.data(), (unsigned)tooManyParents.size() ) );
+}
+
+void BoneposesTest::test_lerpMatchesScalar() {
+	SyntheticSkeleton skeleton( 1, 67 );
+	DualQuats expected( skeleton.numBones() ), actual( skeleton.numBones() );
+	for( unsigned count = 0; count <= skeleton.numBones(); ++count ) {
+		for( float t: { 0.0f, 0.1f, 0.5f, 0.77f, 1.0f } ) {
+			const dualquat_t *from = skeleton.frame( count % SyntheticSkeleton::kNumFrames );
+			const dualquat_t *to   = skeleton.frame( ( count + 1 ) % SyntheticSkeleton::kNumFrames );
+			for( unsigned i = 0; i < count; ++i ) {
+				DualQuat_Lerp( from[i], to[i], t, expected[i].data() );
+			}
+			DualQuat_LerpMany( from, to, t, dqs( actual ), count );
+			QVERIFY( maxAbsDifference( dqs( expected ), dqs( actual ), count ) < kEpsilon );
+		}
+	}
+}
+
+void BoneposesTest::test_multiplyAndNormalizeMatchesScalar() {
+	SyntheticSkeleton skeleton( 2, 67 );
+	DualQuats expected( skeleton.numBones() ), actual( skeleton.numBones() );
+	for( unsigned count = 0; count <= skeleton.numBones(); ++count ) {
+		const dualquat_t *poses = skeleton.frame( count % SyntheticSkeleton::kNumFrames );
+		for( unsigned i = 0; i < count; ++i ) {
+			DualQuat_Multiply( poses[i], skeleton.invBasePoses()[i], expected[i].data() );
+			DualQuat_Normalize( expected[i].data() );
+		}
+		DualQuat_MultiplyAndNormalizeMany( poses, skeleton.invBasePoses(), dqs( actual ), count );
+		QVERIFY( maxAbsDifference( dqs( expected ), dqs( actual ), count ) < kEpsilon );
+	}
+}
+
+void BoneposesTest::test_transformMatchesScalar() {
+	for( unsigned numBones: { 1u, 5u, 48u, 64u, 130u, 256u } ) {
+		SyntheticSkeleton skeleton( 3 + numBones, numBones );
+		BoneHierarchyLevels levels;
+		QVERIFY( levels.build( skeleton.parents(), numBones ) );
+
+		for( unsigned frameNum = 0; frameNum < SyntheticSkeleton::kNumFrames; ++frameNum ) {
+			DualQuats expected( numBones ), actual( numBones );
+			skeleton.transformSerially( skeleton.frame( frameNum ), dqs( expected ) );
+
+			DualQuat_TransformHierarchy( &levels, skeleton.frame( frameNum ), dqs( actual ) );
+			QVERIFY( maxAbsDifference( dqs( expected ), dqs( actual ), numBones ) < kEpsilon );
+
+			// Check the in-place transform as well
+			std::memcpy( dqs( actual ), skeleton.frame( frameNum ), sizeof( dualquat_t ) * numBones );
+			DualQuat_TransformHierarchy( &levels, dqs( actual ), dqs( actual ) );
+			QVERIFY( maxAbsDifference( dqs( expected ), dqs( actual ), numBones ) < kEpsilon );
+		}
+	}
+}
+
+// Interpolates, mounts and makes relative to the base pose skeletons of 64 entities, like cgame and the renderer do
+static constexpr unsigned kNumBenchmarkEntities = 64;
+static constexpr unsigned kNumBenchmarkBones    = 56;
+
+void BoneposesTest::benchmark_scalarPipeline() {
+	SyntheticSkeleton skeleton( 4, kNumBenchmarkBones );
+	DualQuats lerped( kNumBenchmarkBones ), transformed( kNumBenchmarkBones );
+	DualQuats relative( kNumBenchmarkBones );
+	float checksum = 0.0f;
+	QBENCHMARK {
+		for( unsigned entNum = 0; entNum < kNumBenchmarkEntities; ++entNum ) {
+			const dualquat_t *from = skeleton.frame( entNum % SyntheticSkeleton::kNumFrames );
+			const dualquat_t *to   = skeleton.frame( ( entNum + 1 ) % SyntheticSkeleton::kNumFrames );
+			const float t          = (float)entNum * ( 1.0f / kNumBenchmarkEntities );
+			for( unsigned i = 0; i < kNumBenchmarkBones; ++i ) {
+				DualQuat_Lerp( from[i], to[i], t, lerped[i].data() );
+			}
+			skeleton.transformSerially( dqs( lerped ), dqs( transformed ) );
+			for( unsigned i = 0; i < kNumBenchmarkBones; ++i ) {
+				DualQuat_Multiply( transformed[i].data(), skeleton.invBasePoses()[i], relative[i].data() );
+				DualQuat_Normalize( relative[i].data() );
+			}
+			checksum += relative[entNum % kNumBenchmarkBones][0];
+		}
+	}
+	QVERIFY( std::isfinite( checksum ) );
+}
+
+void BoneposesTest::benchmark_batchedPipeline() {
+	SyntheticSkeleton skeleton( 4, kNumBenchmarkBones );
+	BoneHierarchyLevels levels;
+	QVERIFY( levels.build( skeleton.parents(), kNumBenchmarkBones ) );
+	DualQuats lerped( kNumBenchmarkBones ), relative( kNumBenchmarkBones );
+	float checksum = 0.0f;
+	QBENCHMARK {
+		for( unsigned entNum = 0; entNum < kNumBenchmarkEntities; ++entNum ) {
+			const dualquat_t *from = skeleton.frame( entNum % SyntheticSkeleton::kNumFrames );
+			const dualquat_t *to   = skeleton.frame( ( entNum + 1 ) % SyntheticSkeleton::kNumFrames );
+			const float t          = (float)entNum * ( 1.0f / kNumBenchmarkEntities );
+			dualquat_t *const lerpedData = dqs( lerped );
+			DualQuat_LerpMany( from, to, t, lerpedData, kNumBenchmarkBones );
+			DualQuat_TransformHierarchy( &levels, lerpedData, lerpedData );
+			DualQuat_MultiplyAndNormalizeMany( lerpedData, skeleton.invBasePoses(),
+											   dqs( relative ), kNumBenchmarkBones );
+			checksum += relative[entNum % kNumBenchmarkBones][0];
+		}
+	}
+	QVERIFY( std::isfinite( checksum ) );
+}
@@ -0,0 +1,20 @@
+#ifndef WSW_BONEPOSESTEST_H
+#define WSW_BONEPOSESTEST_H
+
+#include <QtTest/QtTest>
+
+class BoneposesTest : public QObject {
+	Q_OBJECT
+
+	class SyntheticSkeleton;
+
+private slots:
+	void test_hierarchyLevels();
+	void test_lerpMatchesScalar();
+	void test_multiplyAndNormalizeMatchesScalar();
+	void test_transformMatchesScalar();
+	void benchmark_scalarPipeline();
+	void benchmark_batchedPipeline();
+};
+
+#endif
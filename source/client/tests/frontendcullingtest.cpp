@@ -0,0 +1,284 @@
+#include "frontendcullingtest.h"
+#include "../../ref/local.h"
+#include "../../ref/frontend.h"
+
+#include <atomic>
+#include <random>
+
+using wsw::ref::Frontend;
+using wsw::ref::JobRunner;
+
+// The culling code does not touch the PVS unless world leaves are culled
+uint8_t *Mod_ClusterPVS( int, model_t * ) {
+	return nullptr;
+}
+
+static constexpr float kWorldExtent = 4096.0f;
+
+// A CPU-only scene which groups of entries are laid out like groups of the frontend (entity classes, lights, etc.)
+class FrontendCullingTest::SyntheticScene {
+public:
+	using VisTestedModel = Frontend::VisTestedModel;
+
+	static constexpr unsigned kNumModelGroups = 6;
+	static constexpr unsigned kNumModelsInGroup = 512;
+	static constexpr unsigned kNumLights = 256;
+	static constexpr unsigned kNumMeshPtrs = 128;
+	static constexpr unsigned kNumOccluders = 8;
+	// Model groups, lights and pointers to models
+	static constexpr unsigned kNumGroups = kNumModelGroups + 2;
+
+	// Every group gets its own buffer like every culling job of the frontend does
+	struct CullingResults {
+		uint16_t indices[kNumGroups][kNumModelsInGroup];
+		std::span<const uint16_t> visibleIndices[kNumGroups];
+	};
+
+	explicit SyntheticScene( unsigned seed ) : m_rng( seed ) {
+		for( auto &group: m_modelGroups ) {
+			group.resize( kNumModelsInGroup );
+			for( VisTestedModel &model: group ) {
+				const float halfExtent = randomFloat( 4.0f, 64.0f );
+				setRandomBounds( halfExtent, model.absMins, model.absMaxs );
+			}
+		}
+		m_lights.resize( kNumLights );
+		for( Scene::DynamicLight &light: m_lights ) {
+			light.programRadius = randomFloat( 32.0f, 300.0f );
+			setRandomBounds( light.programRadius, light.mins, light.maxs );
+		}
+		for( unsigned i = 0; i < kNumMeshPtrs; ++i ) {
+			m_meshPtrs.push_back( &m_modelGroups[i % kNumModelGroups][( 7 * i ) % kNumModelsInGroup] );
+		}
+	}
+
+	// Sets up the primary frustum and frusta of occluders (these are axis-aligned boxes)
+	void setupRandomView() {
+		vec3_t origin, angles;
+		mat3_t axis;
+		for( unsigned i = 0; i < 3; ++i ) {
+			origin[i] = randomFloat( -0.5f * kWorldExtent, +0.5f * kWorldExtent );
+		}
+		VectorSet( angles, randomFloat( -60.0f, +60.0f ), randomFloat( 0.0f, 360.0f ), 0.0f );
+		AnglesToAxis( angles, axis );
+		m_primaryFrustum.setupFor4Planes( origin, axis, 110.0f, 90.0f );
+
+		for( Frustum &occluderFrustum: m_occluderFrusta ) {
+			vec4_t mins, maxs;
+			setRandomBounds( randomFloat( 128.0f, 768.0f ), mins, maxs );
+			for( unsigned i = 0; i < 3; ++i ) {
+				vec3_t n { 0.0f, 0.0f, 0.0f };
+				n[i] = +1.0f;
+				occluderFrustum.setPlaneComponentsAtIndex( 2 * i + 0, n, +mins[i] );
+				n[i] = -1.0f;
+				occluderFrustum.setPlaneComponentsAtIndex( 2 * i + 1, n, -maxs[i] );
+			}
+			occluderFrustum.fillComponentTails( 5 );
+		}
+	}
+
+	[[nodiscard]]
+	auto occluderFrusta() const -> std::span<const Frustum> { return { m_occluderFrusta, kNumOccluders }; }
+
+	// Culls a group like the respective frontend culling job does
+	[[nodiscard]]
+	auto cullGroup( unsigned groupNum, uint16_t *tmpIndices ) const -> std::span<const uint16_t> {
+		if( groupNum < kNumModelGroups ) {
+			return Frontend::cullEntriesWithBoundsSse2( m_modelGroups[groupNum].data(), kNumModelsInGroup,
+													offsetof( VisTestedModel, absMins ), sizeof( VisTestedModel ),
+													&m_primaryFrustum, occluderFrusta(), tmpIndices );
+		}
+		if( groupNum == kNumModelGroups ) {
+			return Frontend::cullEntriesWithBoundsSse2( m_lights.data(), kNumLights, offsetof( Scene::DynamicLight, mins ),
+													sizeof( Scene::DynamicLight ), &m_primaryFrustum,
+													occluderFrusta(), tmpIndices );
+		}
+		return Frontend::cullEntryPtrsWithBoundsSse2( (const void **)m_meshPtrs.data(), kNumMeshPtrs,
+												  offsetof( VisTestedModel, absMins ), &m_primaryFrustum,
+												  occluderFrusta(), tmpIndices );
+	}
+
+	void cullSerially( CullingResults *results ) const {
+		for( unsigned groupNum = 0; groupNum < kNumGroups; ++groupNum ) {
+			results->visibleIndices[groupNum] = cullGroup( groupNum, results->indices[groupNum] );
+		}
+	}
+
+	void cullInParallel( JobRunner *jobRunner, CullingResults *results ) const {
+		jobRunner->parallelFor( kNumGroups, [=, this]( unsigned groupNum ) {
+			results->visibleIndices[groupNum] = cullGroup( groupNum, results->indices[groupNum] );
+		});
+	}
+
+	[[nodiscard]]
+	auto boundsOf( unsigned groupNum, unsigned entryNum ) const -> std::pair<const float *, const float *> {
+		if( groupNum < kNumModelGroups ) {
+			const VisTestedModel &model = m_modelGroups[groupNum][entryNum];
+			return { model.absMins, model.absMaxs };
+		}
+		if( groupNum == kNumModelGroups ) {
+			return { m_lights[entryNum].mins, m_lights[entryNum].maxs };
+		}
+		return { m_meshPtrs[entryNum]->absMins, m_meshPtrs[entryNum]->absMaxs };
+	}
+
+	[[nodiscard]]
+	auto groupSize( unsigned groupNum ) const -> unsigned {
+		return groupNum < kNumModelGroups ? kNumModelsInGroup : ( groupNum == kNumModelGroups ? kNumLights : kNumMeshPtrs );
+	}
+
+	// A straightforward scalar implementation of the culling rules
+	[[nodiscard]]
+	bool isVisibleByReference( const float *mins, const float *maxs ) const {
+		for( unsigned planeNum = 0; planeNum < 4; ++planeNum ) {
+			if( maxDistanceToPlane( m_primaryFrustum, planeNum, mins, maxs ) < 0.0f ) {
+				return false;
+			}
+		}
+		for( const Frustum &f: m_occluderFrusta ) {
+			bool isFullyInside = true;
+			for( unsigned planeNum = 0; planeNum < 8; ++planeNum ) {
+				isFullyInside &= minDistanceToPlane( f, planeNum, mins, maxs ) >= 0.0f;
+			}
+			if( isFullyInside ) {
+				return false;
+			}
+		}
+		return true;
+	}
+private:
+	[[nodiscard]]
+	static auto maxDistanceToPlane( const Frustum &f, unsigned planeNum, const float *mins, const float *maxs ) -> float {
+		const float n[3] { f.planeX[planeNum], f.planeY[planeNum], f.planeZ[planeNum] };
+		float result = -f.planeD[planeNum];
+		for( unsigned i = 0; i < 3; ++i ) {
+			result += n[i] * ( n[i] < 0 ? mins[i] : maxs[i] );
+		}
+		return result;
+	}
+
+	[[nodiscard]]
+	static auto minDistanceToPlane( const Frustum &f, unsigned planeNum, const float *mins, const float *maxs ) -> float {
+		const float n[3] { f.planeX[planeNum], f.planeY[planeNum], f.planeZ[planeNum] };
+		float result = -f.planeD[planeNum];
+		for( unsigned i = 0; i < 3; ++i ) {
+			result += n[i] * ( n[i] < 0 ? maxs[i] : mins[i] );
+		}
+		return result;
+	}
+
+	[[nodiscard]]
+	auto randomFloat( float from, float to ) -> float {
+		return std::uniform_real_distribution<float>( from, to )( m_rng );
+	}
+
+	void setRandomBounds( float halfExtent, float *mins, float *maxs ) {
+		for( unsigned i = 0; i < 3; ++i ) {
+			const float center = randomFloat( -kWorldExtent, +kWorldExtent );
+			mins[i] = center - halfExtent;
+			maxs[i] = center + halfExtent;
+		}
+		mins[3] = 0.0f, maxs[3] = 1.0f;
+	}
+
+	std::mt19937 m_rng;
+	wsw::Vector<VisTestedModel> m_modelGroups[kNumModelGroups];
+	wsw::Vector<Scene::DynamicLight> m_lights;
+	wsw::Vector<const VisTestedModel *> m_meshPtrs;
+	Frustum m_primaryFrustum;
+	Frustum m_occluderFrusta[kNumOccluders];
+};
+
+void FrontendCullingTest::test_jobRunner() {
+	for( const unsigned numThreads: { 0u, 1u, 3u } ) {
+		JobRunner jobRunner( numThreads );
+		QCOMPARE( jobRunner.numThreads(), numThreads );
+
+		std::atomic<unsigned> counters[64];
+		for( unsigned batchNum = 0; batchNum < 500; ++batchNum ) {
+			const unsigned numJobs = batchNum % std::size( counters );
+			for( std::atomic<unsigned> &counter: counters ) {
+				counter.store( 0, std::memory_order_relaxed );
+			}
+			jobRunner.parallelFor( numJobs, [&]( unsigned jobIndex ) {
+				counters[jobIndex].fetch_add( 1, std::memory_order_relaxed );
+			});
+			// Every job must be completed exactly once at the moment of return
+			for( unsigned jobIndex = 0; jobIndex < std::size( counters ); ++jobIndex ) {
+				QCOMPARE( counters[jobIndex].load( std::memory_order_relaxed ), jobIndex < numJobs ? 1u : 0u );
+			}
+		}
+	}
+}
+
+void FrontendCullingTest::test_cullingResults() {
+	SyntheticScene scene( 1 );
+	auto results = std::make_unique<SyntheticScene::CullingResults>();
+
+	unsigned numVisibleEntries = 0, numCulledEntries = 0;
+	for( unsigned viewNum = 0; viewNum < 16; ++viewNum ) {
+		scene.setupRandomView();
+		scene.cullSerially( results.get() );
+		for( unsigned groupNum = 0; groupNum < SyntheticScene::kNumGroups; ++groupNum ) {
+			const std::span<const uint16_t> visibleIndices = results->visibleIndices[groupNum];
+			unsigned visibleIndexNum = 0;
+			for( unsigned entryNum = 0; entryNum < scene.groupSize( groupNum ); ++entryNum ) {
+				const auto [mins, maxs] = scene.boundsOf( groupNum, entryNum );
+				const bool isVisible = visibleIndexNum < visibleIndices.size() && visibleIndices[visibleIndexNum] == entryNum;
+				QCOMPARE( isVisible, scene.isVisibleByReference( mins, maxs ) );
+				visibleIndexNum += isVisible;
+				numVisibleEntries += isVisible;
+				numCulledEntries += !isVisible;
+			}
+			QCOMPARE( visibleIndexNum, (unsigned)visibleIndices.size() );
+		}
+	}
+
+	// Make sure the scene is not degenerate
+	QVERIFY( numVisibleEntries > 0 && numCulledEntries > 0 );
+}
+
+void FrontendCullingTest::test_parallelCullingMatchesSerial() {
+	SyntheticScene scene( 2 );
+	JobRunner jobRunner( 3 );
+	auto serialResults = std::make_unique<SyntheticScene::CullingResults>();
+	auto parallelResults = std::make_unique<SyntheticScene::CullingResults>();
+
+	for( unsigned viewNum = 0; viewNum < 64; ++viewNum ) {
+		scene.setupRandomView();
+		scene.cullSerially( serialResults.get() );
+		scene.cullInParallel( &jobRunner, parallelResults.get() );
+		for( unsigned groupNum = 0; groupNum < SyntheticScene::kNumGroups; ++groupNum ) {
+			const std::span<const uint16_t> expected = serialResults->visibleIndices[groupNum];
+			const std::span<const uint16_t> actual = parallelResults->visibleIndices[groupNum];
+			QVERIFY( std::equal( expected.begin(), expected.end(), actual.begin(), actual.end() ) );
+		}
+	}
+}
+
+// Note: A single benchmark iteration corresponds to culling of a single view
+
+void FrontendCullingTest::benchmark_serialCulling() {
+	SyntheticScene scene( 3 );
+	auto results = std::make_unique<SyntheticScene::CullingResults>();
+	unsigned numVisibleEntries = 0;
+	QBENCHMARK {
+		scene.setupRandomView();
+		scene.cullSerially( results.get() );
+		numVisibleEntries += results->visibleIndices[0].size();
+	}
+	QVERIFY( numVisibleEntries < SyntheticScene::kNumModelsInGroup * 1000000u );
+}
+
+void FrontendCullingTest::benchmark_parallelCulling() {
+	SyntheticScene scene( 3 );
+	JobRunner jobRunner( 3 );
+	auto results = std::make_unique<SyntheticScene::CullingResults>();
+	unsigned numVisibleEntries = 0;
+	QBENCHMARK {
+		scene.setupRandomView();
+		scene.cullInParallel( &jobRunner, results.get() );
+		numVisibleEntries += results->visibleIndices[0].size();
+	}
+	QVERIFY( numVisibleEntries < SyntheticScene::kNumModelsInGroup * 1000000u );
+}
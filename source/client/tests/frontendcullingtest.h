@@ -0,0 +1,19 @@
+#ifndef WSW_FRONTENDCULLINGTEST_H
+#define WSW_FRONTENDCULLINGTEST_H
+
+#include <QtTest/QtTest>
+
+class FrontendCullingTest : public QObject {
+	Q_OBJECT
+
+	class SyntheticScene;
+
+private slots:
+	void test_jobRunner();
+	void test_cullingResults();
+	void test_parallelCullingMatchesSerial();
+	void benchmark_serialCulling();
+	void benchmark_parallelCulling();
+};
+
+#endif
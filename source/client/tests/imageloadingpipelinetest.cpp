@@ -0,0 +1,181 @@
+#include "imageloadingpipelinetest.h"
+#include "../../ref/imageloader.h"
+
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <random>
+
+using wsw::operator""_asView;
+
+// Builds an uncompressed TGA image with the top-left origin
+// (channels of a pixel are equal, so the result does not depend on the channel order of the decoder)
+static auto makeTgaImage( unsigned width, unsigned height, unsigned samples, uint8_t seed ) -> wsw::Vector<uint8_t> {
+	assert( samples == 1 || samples == 3 || samples == 4 );
+	wsw::Vector<uint8_t> result( 18 + width * height * samples );
+	result[2] = samples == 1 ? 3 : 2;
+	result[12] = (uint8_t)width;
+	result[13] = (uint8_t)( width >> 8 );
+	result[14] = (uint8_t)height;
+	result[15] = (uint8_t)( height >> 8 );
+	result[16] = (uint8_t)( 8 * samples );
+	result[17] = 0x20 | ( samples == 4 ? 8 : 0 );
+	for( unsigned i = 0; i < width * height; ++i ) {
+		for( unsigned j = 0; j < samples; ++j ) {
+			result[18 + i * samples + j] = (uint8_t)( seed + i );
+		}
+	}
+	return result;
+}
+
+static bool isExpectedImageData( const DecodedImage &image, uint8_t seed ) {
+	const BitmapProps &props = image.props();
+	for( unsigned i = 0; i < (unsigned)props.width * (unsigned)props.height; ++i ) {
+		for( unsigned j = 0; j < props.samples; ++j ) {
+			if( image.data()[i * props.samples + j] != (uint8_t)( seed + i ) ) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// File readers are plain functions, so in-memory files have to be global
+static std::map<std::string, wsw::Vector<uint8_t>> g_files;
+static std::atomic<unsigned> g_numReads;
+
+static bool readInMemoryFile( const wsw::StringView &name, wsw::Vector<uint8_t> *buffer ) {
+	g_numReads.fetch_add( 1 );
+	const auto it = g_files.find( std::string( name.data(), name.size() ) );
+	if( it == g_files.end() ) {
+		return false;
+	}
+	buffer->assign( it->second.begin(), it->second.end() );
+	return true;
+}
+
+static void makeInMemoryFiles( unsigned numFiles ) {
+	g_files.clear();
+	g_numReads = 0;
+	for( unsigned i = 0; i < numFiles; ++i ) {
+		const unsigned samples = ( i % 3 == 0 ) ? 1 : ( i % 3 == 1 ? 3 : 4 );
+		g_files["textures/image" + std::to_string( i )] = makeTgaImage( 16 + i, 8 + i % 7, samples, (uint8_t)i );
+	}
+	// This is a file that exists but can't be decoded
+	g_files["textures/corrupted"] = wsw::Vector<uint8_t>( 7, 0xFF );
+}
+
+void ImageLoadingPipelineTest::test_decodeImageFileData() {
+	for( unsigned samples: { 1u, 3u, 4u } ) {
+		const auto fileData = makeTgaImage( 5, 3, samples, 17 );
+		const auto maybeImage = decodeImageFileData( fileData.data(), fileData.size() );
+		QVERIFY( maybeImage );
+		QCOMPARE( (unsigned)maybeImage->props().width, 5u );
+		QCOMPARE( (unsigned)maybeImage->props().height, 3u );
+		QCOMPARE( (unsigned)maybeImage->props().samples, samples );
+		QCOMPARE( maybeImage->dataSize(), (size_t)( 5 * 3 * samples ) );
+		QVERIFY( isExpectedImageData( *maybeImage, 17 ) );
+	}
+
+	const uint8_t garbage[32] { 1, 2, 3 };
+	QVERIFY( !decodeImageFileData( garbage, sizeof( garbage ) ) );
+}
+
+void ImageLoadingPipelineTest::test_takeFromWorkers() {
+	constexpr unsigned kNumFiles = 96;
+	makeInMemoryFiles( kNumFiles );
+
+	ImageLoadingPipeline pipeline( &readInMemoryFile );
+	wsw::Vector<std::string> names;
+	for( unsigned i = 0; i < kNumFiles; ++i ) {
+		names.push_back( "textures/image" + std::to_string( i ) );
+	}
+	for( const std::string &name: names ) {
+		pipeline.add( wsw::StringView( name.data(), name.size() ) );
+	}
+	// Duplicates (including ones that differ by case) must be ignored
+	pipeline.add( "textures/image0"_asView );
+	pipeline.add( "Textures/Image1"_asView );
+	pipeline.add( "textures/missing"_asView );
+	pipeline.add( "textures/corrupted"_asView );
+	QCOMPARE( pipeline.numRequests(), kNumFiles + 2 );
+
+	pipeline.start( 4 );
+
+	wsw::Vector<unsigned> order( kNumFiles );
+	std::iota( order.begin(), order.end(), 0 );
+	std::shuffle( order.begin(), order.end(), std::mt19937( 1 ) );
+
+	for( unsigned i: order ) {
+		DecodedImage image;
+		const wsw::StringView name( names[i].data(), names[i].size() );
+		QCOMPARE( pipeline.take( name, &image ), ImageLoadingPipeline::TakeResult::Taken );
+		QCOMPARE( (unsigned)image.props().width, 16 + i );
+		QCOMPARE( (unsigned)image.props().height, 8 + i % 7 );
+		QVERIFY( isExpectedImageData( image, (uint8_t)i ) );
+		// The data has been moved out
+		QCOMPARE( pipeline.take( name, &image ), ImageLoadingPipeline::TakeResult::NotRequested );
+	}
+
+	DecodedImage image;
+	QCOMPARE( pipeline.take( "TEXTURES/MISSING"_asView, &image ), ImageLoadingPipeline::TakeResult::Missing );
+	QCOMPARE( pipeline.take( "textures/corrupted"_asView, &image ), ImageLoadingPipeline::TakeResult::Missing );
+	QCOMPARE( pipeline.take( "textures/unknown"_asView, &image ), ImageLoadingPipeline::TakeResult::NotRequested );
+
+	const auto stats = pipeline.finish();
+	QCOMPARE( stats.numRequested, kNumFiles + 2 );
+	QCOMPARE( stats.numDecoded, kNumFiles );
+	QCOMPARE( stats.numMissing, 2u );
+	QCOMPARE( stats.numThreads, 4u );
+	// Every request must be executed exactly once
+	QCOMPARE( g_numReads.load(), kNumFiles + 2 );
+
+	// Nothing can be taken after finishing
+	QCOMPARE( pipeline.take( "textures/image2"_asView, &image ), ImageLoadingPipeline::TakeResult::NotRequested );
+}
+
+void ImageLoadingPipelineTest::test_executeInPlace() {
+	constexpr unsigned kNumFiles = 8;
+	makeInMemoryFiles( kNumFiles );
+
+	ImageLoadingPipeline pipeline( &readInMemoryFile );
+	pipeline.add( "textures/image3"_asView );
+	pipeline.add( "textures/image5"_asView );
+	pipeline.start( 0 );
+
+	DecodedImage image;
+	QCOMPARE( pipeline.take( "textures/image5"_asView, &image ), ImageLoadingPipeline::TakeResult::Taken );
+	QVERIFY( isExpectedImageData( image, 5 ) );
+	QCOMPARE( pipeline.take( "textures/image3"_asView, &image ), ImageLoadingPipeline::TakeResult::Taken );
+	QVERIFY( isExpectedImageData( image, 3 ) );
+
+	const auto stats = pipeline.finish();
+	QCOMPARE( stats.numThreads, 0u );
+	QCOMPARE( stats.numExecutedInPlace, 2u );
+	QCOMPARE( stats.numDecoded, 2u );
+
+	// The pipeline must be reusable
+	pipeline.add( "textures/image7"_asView );
+	pipeline.start( 2 );
+	QCOMPARE( pipeline.take( "textures/image7"_asView, &image ), ImageLoadingPipeline::TakeResult::Taken );
+	QVERIFY( isExpectedImageData( image, 7 ) );
+	QCOMPARE( pipeline.finish().numDecoded, 1u );
+}
+
+void ImageLoadingPipelineTest::test_finishWithoutTaking() {
+	constexpr unsigned kNumFiles = 64;
+	makeInMemoryFiles( kNumFiles );
+
+	ImageLoadingPipeline pipeline( &readInMemoryFile );
+	for( unsigned i = 0; i < kNumFiles; ++i ) {
+		const std::string name( "textures/image" + std::to_string( i ) );
+		pipeline.add( wsw::StringView( name.data(), name.size() ) );
+	}
+	pipeline.start( 3 );
+
+	// Results that were not taken must be released, requests that were not started must be skipped
+	const auto stats = pipeline.finish();
+	QVERIFY( stats.numDecoded <= kNumFiles );
+	QCOMPARE( stats.numMissing, 0u );
+	QCOMPARE( stats.numDecoded, g_numReads.load() );
+}
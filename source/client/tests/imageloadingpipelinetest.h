@@ -0,0 +1,16 @@
+#ifndef WSW_IMAGELOADINGPIPELINETEST_H
+#define WSW_IMAGELOADINGPIPELINETEST_H
+
+#include <QtTest/QtTest>
+
+class ImageLoadingPipelineTest : public QObject {
+	Q_OBJECT
+
+private slots:
+	void test_decodeImageFileData();
+	void test_takeFromWorkers();
+	void test_executeInPlace();
+	void test_finishWithoutTaking();
+};
+
+#endif
@@ -1,7 +1,14 @@
 #include <QCoreApplication>
+#include "boneposestest.h"
+#include "frontendcullingtest.h"
+#include "imageloadingpipelinetest.h"
 #include "materialifevaluatortest.h"
 #include "materialsourcetest.h"
+#include "materialsourcecachetest.h"
 #include "materialparsertest.h"
+#include "particlekinematicstest.h"
+#include "pcmcachetest.h"
+#include "serverlistmodeltest.h"
 #include "tokensplittertest.h"
 #include "tokenstreamtest.h"
 
@@ -36,6 +43,41 @@ int main( int argc, char **argv ) {
 		result |= QTest::qExec( &materialParserTest, argc, argv );
 	}
 
+	{
+		MaterialSourceCacheTest materialSourceCacheTest;
+		result |= QTest::qExec( &materialSourceCacheTest, argc, argv );
+	}
+
+	{
+		ImageLoadingPipelineTest imageLoadingPipelineTest;
+		result |= QTest::qExec( &imageLoadingPipelineTest, argc, argv );
+	}
+
+	{
+		FrontendCullingTest frontendCullingTest;
+		result |= QTest::qExec( &frontendCullingTest, argc, argv );
+	}
+
+	{
+		PcmCacheTest pcmCacheTest;
+		result |= QTest::qExec( &pcmCacheTest, argc, argv );
+	}
+
+	{
+		BoneposesTest boneposesTest;
+		result |= QTest::qExec( &boneposesTest, argc, argv );
+	}
+
+	{
+		ParticleKinematicsTest particleKinematicsTest;
+		result |= QTest::qExec( &particleKinematicsTest, argc, argv );
+	}
+
+	{
+		ServerListModelTest serverListModelTest;
+		result |= QTest::qExec( &serverListModelTest, argc, argv );
+	}
+
 	return result;
 }
 
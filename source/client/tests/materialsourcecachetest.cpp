@@ -0,0 +1,218 @@
+#include "materialsourcecachetest.h"
+#include "../../ref/materiallocal.h"
+
+#include <cstring>
+
+using wsw::operator""_asView;
+
+// Tokenized and compactified contents of a script file (this follows what MaterialCache does)
+struct TokenizedScript {
+	wsw::Vector<TokenSpan> spans;
+	wsw::String data;
+	wsw::Vector<std::pair<uint32_t, uint32_t>> sourceSpans;
+};
+
+static auto tokenizeScript( const wsw::String &rawContents ) -> TokenizedScript {
+	TokenizedScript result;
+	TokenSplitter splitter( rawContents.data(), rawContents.size() );
+	uint32_t lineNum = 0;
+	while( !splitter.isAtEof() ) {
+		while( auto maybeToken = splitter.fetchNextTokenInLine() ) {
+			const auto &[off, len] = *maybeToken;
+			result.spans.emplace_back( TokenSpan { (int)result.data.size(), len, lineNum } );
+			result.data.append( rawContents.data() + off, len );
+		}
+		lineNum++;
+	}
+
+	// Scripts of tests are well-formed, so just track the depth of braces
+	int depth = 0;
+	uint32_t sourceStart = 0;
+	for( uint32_t i = 0; i < result.spans.size(); ++i ) {
+		const char ch = result.data[result.spans[i].offset];
+		if( ch == '{' && !depth++ ) {
+			sourceStart = i + 1;
+		} else if( ch == '}' && !--depth ) {
+			result.sourceSpans.emplace_back( std::make_pair( sourceStart, i - sourceStart ) );
+		}
+	}
+
+	return result;
+}
+
+static auto makeRecord( const wsw::StringView &fileName, const wsw::String &rawContents,
+						const TokenizedScript &script ) -> MaterialSourceCache::FileRecord {
+	MaterialSourceCache::FileRecord record;
+	record.fileName = fileName;
+	record.checksum = (uint32_t)rawContents.size() * 31u + 7u;
+	record.rawSize = (uint32_t)rawContents.size();
+	record.spans = script.spans.data();
+	record.numSpans = (unsigned)script.spans.size();
+	record.data = script.data.data();
+	record.dataSize = (unsigned)script.data.size();
+	record.sourceSpans = script.sourceSpans.data();
+	record.numSources = (unsigned)script.sourceSpans.size();
+	return record;
+}
+
+static auto makeScript( unsigned numMaterials ) -> wsw::String {
+	wsw::String result;
+	for( unsigned i = 0; i < numMaterials; ++i ) {
+		const wsw::String index( std::to_string( i ) );
+		result += "textures/generated/material" + index + "\n{\n";
+		result += "\tqer_editorimage textures/generated/material" + index + ".tga\n";
+		result += "\tsurfaceparm nomarks\n\tcull none\n";
+		result += "\t{\n\t\tmap textures/generated/material" + index + "\n\t\trgbGen identity\n";
+		result += "\t\tblendFunc GL_SRC_ALPHA GL_ONE_MINUS_SRC_ALPHA\n\t}\n";
+		result += "\t{\n\t\tmap $lightmap\n\t\tblendFunc filter\n\t\ttcMod scroll 0.1 0.25\n\t}\n}\n\n";
+	}
+	return result;
+}
+
+void MaterialSourceCacheTest::test_roundTrip() {
+	const wsw::String rawContents1( makeScript( 3 ) );
+	const wsw::String rawContents2( "gfx/ui/cursor\n{\n\tnopicmip\n\t{\n\t\tclampmap gfx/ui/cursor\n\t}\n}\n" );
+	const TokenizedScript script1( tokenizeScript( rawContents1 ) );
+	const TokenizedScript script2( tokenizeScript( rawContents2 ) );
+	QCOMPARE( (int)script1.sourceSpans.size(), 3 );
+	QCOMPARE( (int)script2.sourceSpans.size(), 1 );
+
+	const MaterialSourceCache::FileRecord records[] {
+		makeRecord( "generated.shader"_asView, rawContents1, script1 ),
+		makeRecord( "ui.shader"_asView, rawContents2, script2 ),
+	};
+
+	wsw::Vector<uint8_t> image;
+	MaterialSourceCache::write( records, std::size( records ), &image );
+	QVERIFY( image.size() % 4 == 0 );
+
+	const auto maybeParsedRecords = MaterialSourceCache::parse( image.data(), image.size() );
+	QVERIFY( maybeParsedRecords );
+	QCOMPARE( (int)maybeParsedRecords->size(), 2 );
+
+	for( size_t i = 0; i < std::size( records ); ++i ) {
+		const MaterialSourceCache::FileRecord &expected = records[i];
+		const MaterialSourceCache::FileRecord &actual = ( *maybeParsedRecords )[i];
+		QVERIFY( actual.fileName.equals( expected.fileName ) );
+		QCOMPARE( actual.checksum, expected.checksum );
+		QCOMPARE( actual.rawSize, expected.rawSize );
+		QCOMPARE( actual.numSpans, expected.numSpans );
+		QCOMPARE( actual.dataSize, expected.dataSize );
+		QCOMPARE( actual.numSources, expected.numSources );
+		QVERIFY( std::memcmp( actual.spans, expected.spans, sizeof( TokenSpan ) * expected.numSpans ) == 0 );
+		QVERIFY( std::memcmp( actual.data, expected.data, expected.dataSize ) == 0 );
+		QVERIFY( std::equal( actual.sourceSpans, actual.sourceSpans + actual.numSources, expected.sourceSpans ) );
+
+		MaterialFileContents *contents = MaterialSourceCache::makeFileContents( actual );
+		QVERIFY( contents );
+		QCOMPARE( contents->numSpans, expected.numSpans );
+		QCOMPARE( contents->dataSize, (size_t)expected.dataSize );
+
+		// The name token precedes the opening brace of every source
+		const auto [from, len] = actual.sourceSpans[0];
+		TokenStream stream( contents->data, contents->spans + from - 2, len + 2 );
+		const auto maybeNameToken = stream.getNextToken();
+		QVERIFY( maybeNameToken );
+		QVERIFY( maybeNameToken->equals( i ? "gfx/ui/cursor"_asView : "textures/generated/material0"_asView ) );
+
+		contents->~MaterialFileContents();
+		::free( contents );
+	}
+
+	// An empty cache is valid as well
+	MaterialSourceCache::write( nullptr, 0, &image );
+	const auto maybeNoRecords = MaterialSourceCache::parse( image.data(), image.size() );
+	QVERIFY( maybeNoRecords );
+	QVERIFY( maybeNoRecords->empty() );
+}
+
+void MaterialSourceCacheTest::test_rejectMalformedImages() {
+	const wsw::String rawContents( makeScript( 2 ) );
+	const TokenizedScript script( tokenizeScript( rawContents ) );
+	const MaterialSourceCache::FileRecord record( makeRecord( "generated.shader"_asView, rawContents, script ) );
+
+	wsw::Vector<uint8_t> image;
+	MaterialSourceCache::write( &record, 1, &image );
+	QVERIFY( MaterialSourceCache::parse( image.data(), image.size() ) );
+
+	// Truncated (e.g. partially written) images
+	QVERIFY( !MaterialSourceCache::parse( image.data(), 0 ) );
+	QVERIFY( !MaterialSourceCache::parse( image.data(), 8 ) );
+	QVERIFY( !MaterialSourceCache::parse( image.data(), image.size() - 4 ) );
+
+	// Trailing garbage
+	wsw::Vector<uint8_t> extended( image );
+	extended.resize( image.size() + 4, 0 );
+	QVERIFY( !MaterialSourceCache::parse( extended.data(), extended.size() ) );
+
+	// Wrong magic
+	wsw::Vector<uint8_t> corrupted( image );
+	corrupted[0] ^= 0xFF;
+	QVERIFY( !MaterialSourceCache::parse( corrupted.data(), corrupted.size() ) );
+
+	// Wrong version (it immediately follows the magic)
+	corrupted = image;
+	const uint32_t wrongVersion = MaterialSourceCache::kVersion + 1;
+	std::memcpy( corrupted.data() + 4, &wrongVersion, 4 );
+	QVERIFY( !MaterialSourceCache::parse( corrupted.data(), corrupted.size() ) );
+
+	// Out-of-bounds token span offset (spans immediately follow headers)
+	constexpr size_t kSpansOffset = 4 * sizeof( uint32_t ) + 6 * sizeof( uint32_t );
+	corrupted = image;
+	const int32_t wrongOffset = (int32_t)script.data.size();
+	std::memcpy( corrupted.data() + kSpansOffset, &wrongOffset, sizeof( int32_t ) );
+	QVERIFY( !MaterialSourceCache::parse( corrupted.data(), corrupted.size() ) );
+
+	// Out-of-bounds source span
+	corrupted = image;
+	const uint32_t wrongFrom = (uint32_t)script.spans.size();
+	std::memcpy( corrupted.data() + kSpansOffset + sizeof( TokenSpan ) * script.spans.size(), &wrongFrom, 4 );
+	QVERIFY( !MaterialSourceCache::parse( corrupted.data(), corrupted.size() ) );
+}
+
+static constexpr unsigned kNumBenchmarkFiles = 32;
+static constexpr unsigned kNumBenchmarkMaterialsPerFile = 64;
+
+void MaterialSourceCacheTest::benchmark_tokenizeScripts() {
+	const wsw::String rawContents( makeScript( kNumBenchmarkMaterialsPerFile ) );
+
+	size_t numSources = 0;
+	QBENCHMARK {
+		for( unsigned i = 0; i < kNumBenchmarkFiles; ++i ) {
+			numSources += tokenizeScript( rawContents ).sourceSpans.size();
+		}
+	}
+	QVERIFY( numSources >= kNumBenchmarkFiles * kNumBenchmarkMaterialsPerFile );
+}
+
+void MaterialSourceCacheTest::benchmark_restoreScripts() {
+	const wsw::String rawContents( makeScript( kNumBenchmarkMaterialsPerFile ) );
+	const TokenizedScript script( tokenizeScript( rawContents ) );
+
+	wsw::Vector<wsw::String> fileNames;
+	wsw::Vector<MaterialSourceCache::FileRecord> records;
+	for( unsigned i = 0; i < kNumBenchmarkFiles; ++i ) {
+		fileNames.emplace_back( "generated" + std::to_string( i ) + ".shader" );
+	}
+	for( const wsw::String &fileName: fileNames ) {
+		const wsw::StringView fileNameView( fileName.data(), fileName.size() );
+		records.emplace_back( makeRecord( fileNameView, rawContents, script ) );
+	}
+
+	wsw::Vector<uint8_t> image;
+	MaterialSourceCache::write( records.data(), records.size(), &image );
+
+	size_t numSources = 0;
+	QBENCHMARK {
+		if( const auto maybeRecords = MaterialSourceCache::parse( image.data(), image.size() ) ) {
+			for( const MaterialSourceCache::FileRecord &record: *maybeRecords ) {
+				if( MaterialFileContents *contents = MaterialSourceCache::makeFileContents( record ) ) {
+					numSources += record.numSources;
+					contents->~MaterialFileContents();
+					::free( contents );
+				}
+			}
+		}
+	}
+	QVERIFY( numSources >= kNumBenchmarkFiles * kNumBenchmarkMaterialsPerFile );
+}
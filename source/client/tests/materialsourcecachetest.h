@@ -0,0 +1,16 @@
+#ifndef WSW_MATERIALSOURCECACHETEST_H
+#define WSW_MATERIALSOURCECACHETEST_H
+
+#include <QtTest/QtTest>
+
+class MaterialSourceCacheTest : public QObject {
+	Q_OBJECT
+
+private slots:
+	void test_roundTrip();
+	void test_rejectMalformedImages();
+	void benchmark_tokenizeScripts();
+	void benchmark_restoreScripts();
+};
+
+#endif
@@ -233,3 +233,63 @@ void MaterialSourceTest::test_realMaterialExample() {
 	QVERIFY( expansionResult );
 	QCOMPARE( actualTokenStrings, expectedTokenStrings );
 }
+
+void MaterialSourceTest::test_findReferencedImages() {
+	const char *data =
+		"\t{\n"
+		"\t\tmap $lightmap\n"
+		"\t\tblendFunc filter\n"
+		"\t}\n"
+		"\t{\n"
+		"\t\tmap textures/base/floor.tga\n"
+		"\t\tanimMap 10 textures/anim/1 textures/anim/2\n"
+		"\t\tclampMap gfx/$1.tga\n"
+		"\t\tdistortion 64 dudv/water normal/water\n"
+		"\t}\n"
+		"\t{\n"
+		"\t\tmaterial\n"
+		"\t}\n";
+
+	const auto dataSize = std::strlen( data );
+	TokenSplitter splitter( data, dataSize );
+	wsw::Vector<TokenSpan> spans;
+	uint32_t lineNum = 0;
+	while( !splitter.isAtEof() ) {
+		if( auto maybeToken = splitter.fetchNextTokenInLine() ) {
+			auto [off, len] = *maybeToken;
+			spans.push_back( { (int32_t)off, len, lineNum } );
+		} else {
+			lineNum++;
+		}
+	}
+
+	MaterialFileContents contents;
+	contents.data = data;
+	contents.dataSize = dataSize;
+	contents.spans = spans.data();
+	contents.numSpans = spans.size();
+
+	MaterialSource source;
+	source.m_fileContents = &contents;
+	source.m_tokenSpansOffset = 0;
+	source.m_numTokens = spans.size();
+	source.m_name = wsw::HashedStringView( "textures/base/wall" );
+
+	wsw::Vector<wsw::StringView> imageNames;
+	// The bare material key implies loading of default companion images
+	QVERIFY( source.findReferencedImages( &imageNames ) );
+
+	QStringList actualImageNames;
+	for( const wsw::StringView &name: imageNames ) {
+		actualImageNames.append( QString::fromLatin1( name.data(), (int)name.size() ) );
+	}
+
+	QStringList expectedImageNames {
+		"textures/base/floor.tga",
+		"textures/anim/1", "textures/anim/2",
+		"dudv/water", "normal/water",
+		"textures/base/wall"
+	};
+
+	QCOMPARE( actualImageNames, expectedImageNames );
+}
@@ -11,6 +11,7 @@ private slots:
 	void test_preparePlaceholders();
 	void test_expandTemplate();
 	void test_realMaterialExample();
+	void test_findReferencedImages();
 };
 
 #endif
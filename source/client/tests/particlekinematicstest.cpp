@@ -0,0 +1,118 @@
+#include "particlekinematicstest.h"
+#include "../../cgame/particlekinematics.h"
+#include "../../ref/ref.h"
+
+#include <random>
+#include <vector>
+
+// Flocks of particles which are shaped like ones that are produced by flock fillers
+class ParticleKinematicsTest::SyntheticFlocks {
+public:
+	static constexpr unsigned kFlockSize = 128;
+	static constexpr float kDeltaSeconds = 0.016f;
+
+	SyntheticFlocks( unsigned seed, unsigned numFlocks, float minSpeed, float maxSpeed )
+		: m_rng( seed ), m_numFlocks( numFlocks ), m_particles( numFlocks * kFlockSize ) {
+		for( unsigned flockNum = 0; flockNum < numFlocks; ++flockNum ) {
+			const float origin[3] {
+				randomFloat( -1000.0f, +1000.0f ), randomFloat( -1000.0f, +1000.0f ), randomFloat( -1000.0f, +1000.0f )
+			};
+			for( unsigned i = 0; i < kFlockSize; ++i ) {
+				Particle *const p = &m_particles[flockNum * kFlockSize + i];
+				vec3_t dir { randomFloat( -1.0f, +1.0f ), randomFloat( -1.0f, +1.0f ), randomFloat( -1.0f, +1.0f ) };
+				VectorNormalize( dir );
+				const float speed = randomFloat( minSpeed, maxSpeed );
+				Vector4Set( p->origin, origin[0], origin[1], origin[2], 0.0f );
+				Vector4Copy( p->origin, p->oldOrigin );
+				Vector4Set( p->velocity, speed * dir[0], speed * dir[1], speed * dir[2], 0.0f );
+				Vector4Set( p->accel, 0.0f, 0.0f, -600.0f, 0.0f );
+			}
+		}
+	}
+
+	[[nodiscard]]
+	auto particles() const -> const std::vector<Particle> & { return m_particles; }
+
+	// Runs a simulation step of all flocks, advancing old origins like the particle system does
+	template <typename IntegrateFn>
+	void runStep( IntegrateFn integrateFn, float drag, float *mins, float *maxs ) {
+		BoundsBuilder boundsBuilder;
+		for( unsigned flockNum = 0; flockNum < m_numFlocks; ++flockNum ) {
+			Particle *const flockParticles = m_particles.data() + flockNum * kFlockSize;
+			integrateFn( flockParticles, kFlockSize, drag, kDeltaSeconds, &boundsBuilder );
+			for( unsigned i = 0; i < kFlockSize; ++i ) {
+				Vector4Copy( flockParticles[i].origin, flockParticles[i].oldOrigin );
+			}
+		}
+		boundsBuilder.storeTo( mins, maxs );
+	}
+private:
+	[[nodiscard]]
+	auto randomFloat( float min, float max ) -> float {
+		return std::uniform_real_distribution<float>( min, max )( m_rng );
+	}
+
+	std::minstd_rand0 m_rng;
+	const unsigned m_numFlocks;
+	std::vector<Particle> m_particles;
+};
+
+static constexpr unsigned kNumBenchmarkFlocks = 800;
+
+void ParticleKinematicsTest::compareIntegration( float minSpeed, float maxSpeed, float drag ) {
+#ifdef WSW_USE_SSE2
+	SyntheticFlocks genericFlocks( 1, 16, minSpeed, maxSpeed );
+	SyntheticFlocks sse2Flocks( 1, 16, minSpeed, maxSpeed );
+	for( unsigned stepNum = 0; stepNum < 50; ++stepNum ) {
+		vec3_t genericMins, genericMaxs, sse2Mins, sse2Maxs;
+		genericFlocks.runStep( integrateParticlesGeneric, drag, genericMins, genericMaxs );
+		sse2Flocks.runStep( integrateParticlesSse2, drag, sse2Mins, sse2Maxs );
+		// Operations are performed in the same order, so results must be exactly the same
+		QVERIFY( VectorCompare( genericMins, sse2Mins ) );
+		QVERIFY( VectorCompare( genericMaxs, sse2Maxs ) );
+	}
+	for( size_t i = 0; i < genericFlocks.particles().size(); ++i ) {
+		const Particle &genericParticle = genericFlocks.particles()[i];
+		const Particle &sse2Particle = sse2Flocks.particles()[i];
+		QVERIFY( VectorCompare( genericParticle.origin, sse2Particle.origin ) );
+		QVERIFY( VectorCompare( genericParticle.velocity, sse2Particle.velocity ) );
+		QCOMPARE( sse2Particle.origin[3], 0.0f );
+		QCOMPARE( sse2Particle.velocity[3], 0.0f );
+	}
+#else
+	QSKIP( "The SSE2 version is not available for this build" );
+#endif
+}
+
+void ParticleKinematicsTest::test_sse2MatchesGeneric_noDrag() {
+	compareIntegration( 100.0f, 700.0f, 0.0f );
+}
+
+void ParticleKinematicsTest::test_sse2MatchesGeneric_drag() {
+	compareIntegration( 100.0f, 700.0f, 0.01f );
+}
+
+void ParticleKinematicsTest::test_sse2MatchesGeneric_slowParticles() {
+	// Drag is not applied to particles that are almost at rest
+	compareIntegration( 0.0f, 2.0f, 0.01f );
+}
+
+void ParticleKinematicsTest::benchmark_genericIntegration() {
+	SyntheticFlocks flocks( 2, kNumBenchmarkFlocks, 100.0f, 700.0f );
+	vec3_t mins, maxs;
+	QBENCHMARK {
+		flocks.runStep( integrateParticlesGeneric, 0.01f, mins, maxs );
+	}
+}
+
+void ParticleKinematicsTest::benchmark_sse2Integration() {
+#ifdef WSW_USE_SSE2
+	SyntheticFlocks flocks( 2, kNumBenchmarkFlocks, 100.0f, 700.0f );
+	vec3_t mins, maxs;
+	QBENCHMARK {
+		flocks.runStep( integrateParticlesSse2, 0.01f, mins, maxs );
+	}
+#else
+	QSKIP( "The SSE2 version is not available for this build" );
+#endif
+}
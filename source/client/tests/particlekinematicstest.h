@@ -0,0 +1,21 @@
+#ifndef WSW_PARTICLEKINEMATICSTEST_H
+#define WSW_PARTICLEKINEMATICSTEST_H
+
+#include <QtTest/QtTest>
+
+class ParticleKinematicsTest : public QObject {
+	Q_OBJECT
+
+	class SyntheticFlocks;
+
+	void compareIntegration( float minSpeed, float maxSpeed, float drag );
+
+private slots:
+	void test_sse2MatchesGeneric_noDrag();
+	void test_sse2MatchesGeneric_drag();
+	void test_sse2MatchesGeneric_slowParticles();
+	void benchmark_genericIntegration();
+	void benchmark_sse2Integration();
+};
+
+#endif
@@ -0,0 +1,83 @@
+#include "pcmcachetest.h"
+#include "../../snd_openal/snd_pcmcache.h"
+#include "../../qcommon/wswvector.h"
+
+#include <cstring>
+
+using wsw::operator""_asView;
+using wsw::snd::PcmCacheFile;
+using wsw::snd::PcmProps;
+
+static auto makeProps( uint32_t channels, uint32_t width, uint32_t samples ) -> PcmProps {
+	PcmProps props;
+	props.rate = 44100;
+	props.width = width;
+	props.channels = channels;
+	props.samples = samples;
+	props.dataSize = samples * channels * width;
+	return props;
+}
+
+static auto writeHeader( const PcmProps &props, uint32_t pakChecksum ) -> wsw::Vector<uint8_t> {
+	wsw::Vector<uint8_t> result( PcmCacheFile::kHeaderSize );
+	PcmCacheFile::writeHeader( props, pakChecksum, result.data() );
+	return result;
+}
+
+void PcmCacheTest::test_makePath() {
+	const wsw::String path( PcmCacheFile::makePath( "sounds/weapons/rocket_fly.ogg"_asView ) );
+	QVERIFY( wsw::StringView( path.data(), path.size() ).equals( "pcmcache/sounds/weapons/rocket_fly.ogg.pcm"_asView ) );
+}
+
+void PcmCacheTest::test_roundTrip() {
+	for( const PcmProps &props: { makeProps( 1, 2, 22050 ), makeProps( 2, 2, 1 ), makeProps( 2, 1, 12345 ) } ) {
+		const wsw::Vector<uint8_t> header( writeHeader( props, 0xCAFEBABE ) );
+		const size_t fileSize = PcmCacheFile::kHeaderSize + props.dataSize;
+		const auto maybeProps = PcmCacheFile::parseHeader( header.data(), fileSize, 0xCAFEBABE );
+		QVERIFY( maybeProps );
+		QCOMPARE( maybeProps->rate, props.rate );
+		QCOMPARE( maybeProps->width, props.width );
+		QCOMPARE( maybeProps->channels, props.channels );
+		QCOMPARE( maybeProps->samples, props.samples );
+		QCOMPARE( maybeProps->dataSize, props.dataSize );
+	}
+}
+
+void PcmCacheTest::test_rejectMalformedHeaders() {
+	const PcmProps props( makeProps( 2, 2, 1000 ) );
+	const size_t fileSize = PcmCacheFile::kHeaderSize + props.dataSize;
+	const wsw::Vector<uint8_t> header( writeHeader( props, 1 ) );
+	QVERIFY( PcmCacheFile::parseHeader( header.data(), fileSize, 1 ) );
+
+	// The pak has been changed
+	QVERIFY( !PcmCacheFile::parseHeader( header.data(), fileSize, 2 ) );
+
+	// Truncated (e.g. partially written) files and trailing garbage
+	QVERIFY( !PcmCacheFile::parseHeader( header.data(), 0, 1 ) );
+	QVERIFY( !PcmCacheFile::parseHeader( header.data(), PcmCacheFile::kHeaderSize, 1 ) );
+	QVERIFY( !PcmCacheFile::parseHeader( header.data(), fileSize - 1, 1 ) );
+	QVERIFY( !PcmCacheFile::parseHeader( header.data(), fileSize + 1, 1 ) );
+
+	// Wrong magic
+	wsw::Vector<uint8_t> corrupted( header );
+	corrupted[0] ^= 0xFF;
+	QVERIFY( !PcmCacheFile::parseHeader( corrupted.data(), fileSize, 1 ) );
+
+	// Wrong version (it immediately follows the magic)
+	corrupted = header;
+	const uint32_t wrongVersion = PcmCacheFile::kVersion + 1;
+	std::memcpy( corrupted.data() + 4, &wrongVersion, 4 );
+	QVERIFY( !PcmCacheFile::parseHeader( corrupted.data(), fileSize, 1 ) );
+
+	// Formats that are not accepted by OpenAL
+	for( const PcmProps &wrongProps: { makeProps( 3, 2, 1000 ), makeProps( 1, 4, 1000 ), makeProps( 0, 2, 1000 ) } ) {
+		const wsw::Vector<uint8_t> wrongHeader( writeHeader( wrongProps, 1 ) );
+		QVERIFY( !PcmCacheFile::parseHeader( wrongHeader.data(), PcmCacheFile::kHeaderSize + wrongProps.dataSize, 1 ) );
+	}
+
+	// The number of samples does not fit the data
+	PcmProps wrongProps( props );
+	wrongProps.samples++;
+	const wsw::Vector<uint8_t> wrongHeader( writeHeader( wrongProps, 1 ) );
+	QVERIFY( !PcmCacheFile::parseHeader( wrongHeader.data(), fileSize, 1 ) );
+}
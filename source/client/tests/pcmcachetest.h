@@ -0,0 +1,15 @@
+#ifndef WSW_PCMCACHETEST_H
+#define WSW_PCMCACHETEST_H
+
+#include <QtTest/QtTest>
+
+class PcmCacheTest : public QObject {
+	Q_OBJECT
+
+private slots:
+	void test_makePath();
+	void test_roundTrip();
+	void test_rejectMalformedHeaders();
+};
+
+#endif
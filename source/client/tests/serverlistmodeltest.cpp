@@ -0,0 +1,355 @@
+#include "serverlistmodeltest.h"
+#include "../../ui/serverlistmodel.h"
+#include "../../ui/local.h"
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <vector>
+
+using wsw::ui::ServerListModel;
+
+// Mimics ServerList: servers get new infos, appear and time out, and changes are dispatched once per tick
+class ServerListModelTest::SyntheticServerList {
+public:
+	static constexpr int kMaxClients = 16;
+
+	struct ChurnParams {
+		float removalChance { 0.0f };
+		float playersChangeChance { 0.0f };
+		float timeChangeChance { 0.0f };
+		unsigned numExtraAdditions { 0 };
+	};
+
+	explicit SyntheticServerList( unsigned seed ) : m_rng( seed ) {}
+
+	~SyntheticServerList() {
+		for( PolledGameServer *server: m_servers ) {
+			delete server;
+		}
+		for( PolledGameServer *server: m_removedServers ) {
+			delete server;
+		}
+	}
+
+	[[nodiscard]]
+	auto fill( unsigned numServers ) -> ServerListChangeSet {
+		beginTick();
+		for( unsigned i = 0; i < numServers; ++i ) {
+			m_added.push_back( addServer() );
+		}
+		return { m_added, m_removed, m_updated };
+	}
+
+	[[nodiscard]]
+	auto tick( const ChurnParams &params ) -> ServerListChangeSet {
+		beginTick();
+
+		std::uniform_real_distribution<float> chance( 0.0f, 1.0f );
+		for( unsigned i = 0; i < m_servers.size(); ) {
+			PolledGameServer *const server = m_servers[i];
+			if( chance( m_rng ) < params.removalChance ) {
+				m_servers[i] = m_servers.back();
+				m_servers.pop_back();
+				// The server must stay valid during dispatching as it is in the actual list
+				m_removedServers.push_back( server );
+				m_removed.push_back( server );
+				continue;
+			}
+			ServerInfo *const info = cloneInfo( server->m_currInfo );
+			if( chance( m_rng ) < params.playersChangeChance ) {
+				info->numClients = (uint8_t)randomNumClients();
+			}
+			if( chance( m_rng ) < params.timeChangeChance ) {
+				info->time.timeSeconds = ( info->time.timeSeconds + 1 ) % 60;
+			}
+			if( const unsigned changedFields = setNewInfo( server, info ) ) {
+				m_updated.push_back( { server, changedFields } );
+			}
+			++i;
+		}
+
+		const size_t numAdditions = m_removed.size() + params.numExtraAdditions;
+		for( size_t i = 0; i < numAdditions; ++i ) {
+			m_added.push_back( addServer() );
+		}
+
+		return { m_added, m_removed, m_updated };
+	}
+
+	void updateTime( unsigned serverIndex ) {
+		beginTick();
+		PolledGameServer *const server = m_servers[serverIndex];
+		ServerInfo *const info = cloneInfo( server->m_currInfo );
+		info->time.timeMinutes++;
+		m_updated.push_back( { server, setNewInfo( server, info ) } );
+	}
+
+	[[nodiscard]]
+	auto lastChangeSet() const -> ServerListChangeSet { return { m_added, m_removed, m_updated }; }
+
+	// Checks whether the model shows all servers in the expected order
+	void checkModelOrder( const ServerListModel &model ) const {
+		QCOMPARE( model.rowCount( QModelIndex() ), ( (int)m_servers.size() + 1 ) / 2 );
+
+		std::vector<std::pair<int, unsigned>> expected;
+		for( const PolledGameServer *server: m_servers ) {
+			expected.push_back( { -server->getNumClients(), server->getInstanceId() } );
+		}
+		std::sort( expected.begin(), expected.end() );
+
+		for( unsigned i = 0; i < expected.size(); ++i ) {
+			const QModelIndex index( model.index( (int)i / 2, (int)i % 2 ) );
+			QCOMPARE( model.data( index, ServerListModel::NumPlayers ).toInt(), -expected[i].first );
+			const QString expectedName( QString::asprintf( "server #%u", expected[i].second ) );
+			QCOMPARE( model.data( index, ServerListModel::ServerName ).toString(), expectedName );
+		}
+	}
+private:
+	void beginTick() {
+		for( PolledGameServer *server: m_removedServers ) {
+			delete server;
+		}
+		m_removedServers.clear();
+		m_added.clear();
+		m_removed.clear();
+		m_updated.clear();
+	}
+
+	[[nodiscard]]
+	auto randomNumClients() -> int {
+		// Make many servers share the same number of clients, like actual empty servers do
+		return std::max( 0, std::uniform_int_distribution<int>( -8, kMaxClients )( m_rng ) );
+	}
+
+	[[nodiscard]]
+	auto addServer() -> PolledGameServer * {
+		auto *const server = new PolledGameServer;
+		server->m_instanceId = m_instanceIdCounter++;
+		auto *const info = new ServerInfo;
+		(void)info->serverName.assignf( "server #%u", server->m_instanceId );
+		info->mapname.assign( wsw::StringView( "wca1" ) );
+		info->gametype.assign( wsw::StringView( "ca" ) );
+		info->maxClients = kMaxClients;
+		info->numClients = (uint8_t)randomNumClients();
+		(void)setNewInfo( server, info );
+		m_servers.push_back( server );
+		return server;
+	}
+
+	[[nodiscard]]
+	static auto cloneInfo( const ServerInfo *info ) -> ServerInfo * {
+		auto *const result = new ServerInfo;
+		result->serverName = info->serverName;
+		result->mapname = info->mapname;
+		result->gametype = info->gametype;
+		result->time = info->time;
+		result->score = info->score;
+		result->maxClients = info->maxClients;
+		result->numClients = info->numClients;
+		return result;
+	}
+
+	[[nodiscard]]
+	static auto setNewInfo( PolledGameServer *server, ServerInfo *info ) -> unsigned {
+		delete server->m_oldInfo;
+		server->m_oldInfo = server->m_currInfo;
+		server->m_currInfo = info;
+		return info->findChangedFields( server->m_oldInfo );
+	}
+
+	std::mt19937 m_rng;
+	std::vector<PolledGameServer *> m_servers;
+	std::vector<PolledGameServer *> m_removedServers;
+	std::vector<const PolledGameServer *> m_added;
+	std::vector<const PolledGameServer *> m_removed;
+	std::vector<ServerListChangeSet::Update> m_updated;
+	unsigned m_instanceIdCounter { 0 };
+};
+
+// Keeps a copy of the model data which is updated only as signals tell, like views do
+class ServerListModelTest::SignalsRecorder {
+public:
+	explicit SignalsRecorder( ServerListModel *model ) : m_model( model ) {
+		QObject::connect( model, &QAbstractItemModel::dataChanged,
+						  [this]( const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles ) {
+			numDataChangedSignals++;
+			for( int row = topLeft.row(); row <= bottomRight.row(); ++row ) {
+				for( int column = topLeft.column(); column <= bottomRight.column(); ++column ) {
+					numChangedCells++;
+					for( int role: { ServerListModel::ServerName, ServerListModel::NumPlayers, ServerListModel::TimeSeconds } ) {
+						if( roles.isEmpty() || roles.contains( role ) ) {
+							m_cells[row][column][roleIndex( role )] = fetch( row, column, role );
+						}
+					}
+				}
+			}
+		});
+		QObject::connect( model, &QAbstractItemModel::rowsInserted, [this]( const QModelIndex &, int first, int last ) {
+			numRowsInsertedSignals++;
+			for( int row = first; row <= last; ++row ) {
+				m_cells.insert( m_cells.begin() + row, fetchRow( row ) );
+			}
+		});
+		QObject::connect( model, &QAbstractItemModel::rowsRemoved, [this]( const QModelIndex &, int first, int last ) {
+			numRowsRemovedSignals++;
+			m_cells.erase( m_cells.begin() + first, m_cells.begin() + last + 1 );
+		});
+		QObject::connect( model, &QAbstractItemModel::modelReset, [this]() {
+			numResetSignals++;
+			fetchAllRows();
+		});
+		fetchAllRows();
+	}
+
+	[[nodiscard]]
+	bool matchesModel() const {
+		if( (int)m_cells.size() != m_model->rowCount( QModelIndex() ) ) {
+			return false;
+		}
+		for( int row = 0; row < (int)m_cells.size(); ++row ) {
+			if( m_cells[row] != fetchRow( row ) ) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void resetCounters() {
+		numDataChangedSignals = numChangedCells = 0;
+		numRowsInsertedSignals = numRowsRemovedSignals = numResetSignals = 0;
+	}
+
+	int numDataChangedSignals { 0 };
+	int numChangedCells { 0 };
+	int numRowsInsertedSignals { 0 };
+	int numRowsRemovedSignals { 0 };
+	int numResetSignals { 0 };
+private:
+	using Cell = std::array<QVariant, 3>;
+	using Row = std::array<Cell, 2>;
+
+	[[nodiscard]]
+	static auto roleIndex( int role ) -> int {
+		return role == ServerListModel::ServerName ? 0 : ( role == ServerListModel::NumPlayers ? 1 : 2 );
+	}
+
+	[[nodiscard]]
+	auto fetch( int row, int column, int role ) const -> QVariant {
+		return m_model->data( m_model->index( row, column ), role );
+	}
+
+	void fetchAllRows() {
+		m_cells.clear();
+		for( int row = 0; row < m_model->rowCount( QModelIndex() ); ++row ) {
+			m_cells.push_back( fetchRow( row ) );
+		}
+	}
+
+	[[nodiscard]]
+	auto fetchRow( int row ) const -> Row {
+		Row result;
+		for( int column = 0; column < 2; ++column ) {
+			for( int role: { ServerListModel::ServerName, ServerListModel::NumPlayers, ServerListModel::TimeSeconds } ) {
+				result[column][roleIndex( role )] = fetch( row, column, role );
+			}
+		}
+		return result;
+	}
+
+	ServerListModel *const m_model;
+	std::vector<Row> m_cells;
+};
+
+void ServerListModelTest::test_initialFill() {
+	for( const unsigned numServers: { 0u, 1u, 2u, 7u, 64u } ) {
+		ServerListModel model;
+		SignalsRecorder recorder( &model );
+		SyntheticServerList list( numServers );
+
+		model.onServerListChanged( list.fill( numServers ) );
+		QVERIFY( recorder.matchesModel() );
+		QCOMPARE( recorder.numResetSignals, 0 );
+		QCOMPARE( recorder.numRowsInsertedSignals, numServers ? 1 : 0 );
+		list.checkModelOrder( model );
+	}
+}
+
+void ServerListModelTest::test_fieldUpdatesAreRoleGranular() {
+	ServerListModel model;
+	SyntheticServerList list( 1 );
+	model.onServerListChanged( list.fill( 5 ) );
+
+	QSignalSpy spy( &model, &QAbstractItemModel::dataChanged );
+	SignalsRecorder recorder( &model );
+
+	list.updateTime( 3 );
+	model.onServerListChanged( list.lastChangeSet() );
+
+	QCOMPARE( spy.count(), 1 );
+	const auto topLeft = spy.front().at( 0 ).value<QModelIndex>();
+	const auto bottomRight = spy.front().at( 1 ).value<QModelIndex>();
+	const auto roles = spy.front().at( 2 ).value<QVector<int>>();
+	QCOMPARE( topLeft.row(), bottomRight.row() );
+	QVector<int> expectedRoles { ServerListModel::TimeMinutes, ServerListModel::TimeSeconds, ServerListModel::TimeFlags };
+	QCOMPARE( roles, expectedRoles );
+	QCOMPARE( recorder.numRowsInsertedSignals + recorder.numRowsRemovedSignals + recorder.numResetSignals, 0 );
+}
+
+void ServerListModelTest::test_churnKeepsViewsConsistent() {
+	ServerListModel model;
+	SignalsRecorder recorder( &model );
+	SyntheticServerList list( 7 );
+
+	model.onServerListChanged( list.fill( 5000 ) );
+	QVERIFY( recorder.matchesModel() );
+
+	SyntheticServerList::ChurnParams params;
+	params.removalChance = 0.002f;
+	params.playersChangeChance = 0.01f;
+	params.timeChangeChance = 0.1f;
+	for( unsigned tick = 0; tick < 100; ++tick ) {
+		params.numExtraAdditions = tick % 3;
+		model.onServerListChanged( list.tick( params ) );
+		QVERIFY( recorder.matchesModel() );
+	}
+
+	list.checkModelOrder( model );
+	QCOMPARE( recorder.numResetSignals, 0 );
+}
+
+void ServerListModelTest::benchmark_churnUpdates() {
+	ServerListModel model;
+	SignalsRecorder recorder( &model );
+	SyntheticServerList list( 13 );
+	model.onServerListChanged( list.fill( 5000 ) );
+	recorder.resetCounters();
+
+	SyntheticServerList::ChurnParams params;
+	params.removalChance = 0.001f;
+	params.playersChangeChance = 0.005f;
+	params.timeChangeChance = 0.05f;
+
+	int numTicks = 0;
+	QBENCHMARK {
+		const ServerListChangeSet changeSet( list.tick( params ) );
+		model.onServerListChanged( changeSet );
+		numTicks++;
+	}
+
+	qInfo( "Per tick: %.1f dataChanged() signals, %.1f changed cells, %.2f row insertions, %.2f row removals",
+		   (double)recorder.numDataChangedSignals / (double)numTicks, (double)recorder.numChangedCells / (double)numTicks,
+		   (double)recorder.numRowsInsertedSignals / (double)numTicks, (double)recorder.numRowsRemovedSignals / (double)numTicks );
+	QCOMPARE( recorder.numResetSignals, 0 );
+}
+
+// Stubs for dependencies of the model
+
+auto wsw::ui::toStyledText( const wsw::StringView &text ) -> QString {
+	return QString::fromLatin1( text.data(), (int)text.size() );
+}
+
+char *NET_AddressToString( const netadr_t * ) {
+	static char buffer[] = "0.0.0.0:0";
+	return buffer;
+}
@@ -0,0 +1,19 @@
+#ifndef WSW_SERVERLISTMODELTEST_H
+#define WSW_SERVERLISTMODELTEST_H
+
+#include <QtTest/QtTest>
+
+class ServerListModelTest : public QObject {
+	Q_OBJECT
+
+	class SyntheticServerList;
+	class SignalsRecorder;
+
+private slots:
+	void test_initialFill();
+	void test_fieldUpdatesAreRoleGranular();
+	void test_churnKeepsViewsConsistent();
+	void benchmark_churnUpdates();
+};
+
+#endif
@@ -35,6 +35,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "../../qcommon/qcommon.h"
 #include "../../qcommon/wswstringsplitter.h"
 #include "../../qcommon/wswstaticstring.h"
+#include "../../qcommon/wswvector.h"
+#include "../../qcommon/md5.h"
 
 #define QAS_SECTIONS_SEPARATOR ';'
 #define QAS_FILE_EXTENSION     ".as"
@@ -175,7 +177,7 @@ void qasReleaseEngine( asIScriptEngine *engine ) {
 	engine->Release();
 }
 
-static asIScriptContext *qasCreateContext( asIScriptEngine *engine ) {
+asIScriptContext *qasCreateUnlinkedContext( asIScriptEngine *engine ) {
 	asIScriptContext *ctx;
 	int error;
 
@@ -201,6 +203,15 @@ static asIScriptContext *qasCreateContext( asIScriptEngine *engine ) {
 		return NULL;
 	}
 
+	return ctx;
+}
+
+static asIScriptContext *qasCreateContext( asIScriptEngine *engine ) {
+	asIScriptContext *ctx = qasCreateUnlinkedContext( engine );
+	if( !ctx ) {
+		return NULL;
+	}
+
 	qasContextList &ctxList = contexts[engine];
 	ctxList.push_back( ctx );
 
@@ -282,6 +293,193 @@ static char *qasLoadScriptSection( const char *rootDir, const char *dir, const w
 	return (char *)data;
 }
 
+/*************************************
+* Bytecode cache
+**************************************/
+
+#define QAS_BYTECODE_CACHE_DIRECTORY "ascache"
+#define QAS_BYTECODE_CACHE_EXTENSION ".asbc"
+#define QAS_BYTECODE_CACHE_MAGIC     "QASB"
+#define QAS_BYTECODE_CACHE_VERSION   1
+
+typedef struct qasBytecodeHeader_s {
+	char magic[4];
+	int32_t version;
+	md5_byte_t key[16];
+} qasBytecodeHeader_t;
+
+class qasBytecodeWriteStream : public asIBinaryStream {
+public:
+	wsw::Vector<uint8_t> data;
+
+	void Write( const void *ptr, asUINT size ) override {
+		const auto *bytes = (const uint8_t *)ptr;
+		data.insert( data.end(), bytes, bytes + size );
+	}
+	void Read( void *, asUINT ) override {
+		assert( false && "Unreachable" );
+	}
+};
+
+class qasBytecodeReadStream : public asIBinaryStream {
+	const uint8_t *m_data;
+	size_t m_size;
+	size_t m_offset { 0 };
+public:
+	bool overflow { false };
+
+	qasBytecodeReadStream( const uint8_t *data, size_t size ) : m_data( data ), m_size( size ) {}
+
+	void Read( void *ptr, asUINT size ) override {
+		if( m_offset + size > m_size ) {
+			// Let the engine fail gracefully on zero data
+			memset( ptr, 0, size );
+			overflow = true;
+			return;
+		}
+		memcpy( ptr, m_data + m_offset, size );
+		m_offset += size;
+	}
+	void Write( const void *, asUINT ) override {
+		assert( false && "Unreachable" );
+	}
+};
+
+/*
+* qasAppendToDigest
+*/
+static void qasAppendToDigest( md5_state_t *md5, const char *string ) {
+	// Include the terminating zero so adjacent strings can't produce the same digest
+	md5_append( md5, (const md5_byte_t *)string, (int)strlen( string ) + 1 );
+}
+
+/*
+* qasAppendApiToDigest
+*
+* Bytecode refers to the application interface, so it's valid only for the same registered API
+*/
+static void qasAppendApiToDigest( md5_state_t *md5, asIScriptEngine *engine ) {
+	qasAppendToDigest( md5, ANGELSCRIPT_VERSION_STRING );
+
+	for( asUINT i = 0; i < engine->GetGlobalFunctionCount(); i++ ) {
+		qasAppendToDigest( md5, engine->GetGlobalFunctionByIndex( i )->GetDeclaration( true, true ) );
+	}
+
+	for( asUINT i = 0; i < engine->GetGlobalPropertyCount(); i++ ) {
+		const char *name = NULL;
+		engine->GetGlobalPropertyByIndex( i, &name );
+		qasAppendToDigest( md5, name ? name : "" );
+	}
+
+	for( asUINT i = 0; i < engine->GetEnumCount(); i++ ) {
+		int enumTypeId = 0;
+		qasAppendToDigest( md5, engine->GetEnumByIndex( i, &enumTypeId ) );
+		for( int j = 0; j < engine->GetEnumValueCount( enumTypeId ); j++ ) {
+			int value = 0;
+			qasAppendToDigest( md5, engine->GetEnumValueByIndex( enumTypeId, j, &value ) );
+			md5_append( md5, (const md5_byte_t *)&value, sizeof( value ) );
+		}
+	}
+
+	for( asUINT i = 0; i < engine->GetObjectTypeCount(); i++ ) {
+		asIObjectType *objectType = engine->GetObjectTypeByIndex( i );
+		qasAppendToDigest( md5, objectType->GetName() );
+		for( asUINT j = 0; j < objectType->GetMethodCount(); j++ ) {
+			qasAppendToDigest( md5, objectType->GetMethodByIndex( j )->GetDeclaration( true, true ) );
+		}
+		for( asUINT j = 0; j < objectType->GetPropertyCount(); j++ ) {
+			qasAppendToDigest( md5, objectType->GetPropertyDeclaration( j ) );
+		}
+	}
+}
+
+/*
+* qasMakeBytecodeCachePath
+*/
+static void qasMakeBytecodeCachePath( const char *scriptName, char *buffer, size_t bufferSize ) {
+	Q_snprintfz( buffer, bufferSize, "%s/%s%s", QAS_BYTECODE_CACHE_DIRECTORY, scriptName, QAS_BYTECODE_CACHE_EXTENSION );
+	COM_SanitizeFilePath( buffer );
+}
+
+/*
+* qasLoadCachedBytecode
+*/
+static asIScriptModule *qasLoadCachedBytecode( asIScriptEngine *asEngine, const char *moduleName, const char *scriptName, const md5_byte_t *key ) {
+	char path[MAX_QPATH];
+	qasMakeBytecodeCachePath( scriptName, path, sizeof( path ) );
+
+	int filenum;
+	const int length = FS_FOpenFile( path, &filenum, FS_READ | FS_CACHE );
+	if( length < 0 ) {
+		return NULL;
+	}
+
+	if( length <= (int)sizeof( qasBytecodeHeader_t ) ) {
+		FS_FCloseFile( filenum );
+		return NULL;
+	}
+
+	wsw::Vector<uint8_t> data( (size_t)length );
+	const int numRead = FS_Read( data.data(), (size_t)length, filenum );
+	FS_FCloseFile( filenum );
+	if( numRead != length ) {
+		return NULL;
+	}
+
+	qasBytecodeHeader_t header;
+	memcpy( &header, data.data(), sizeof( header ) );
+	if( memcmp( header.magic, QAS_BYTECODE_CACHE_MAGIC, 4 ) != 0 || header.version != QAS_BYTECODE_CACHE_VERSION ) {
+		return NULL;
+	}
+	// The script sources or the application interface have been modified
+	if( memcmp( header.key, key, sizeof( header.key ) ) != 0 ) {
+		return NULL;
+	}
+
+	asIScriptModule *asModule = asEngine->GetModule( moduleName, asGM_ALWAYS_CREATE );
+	if( asModule == NULL ) {
+		return NULL;
+	}
+
+	qasBytecodeReadStream stream( data.data() + sizeof( header ), data.size() - sizeof( header ) );
+	if( asModule->LoadByteCode( &stream ) < 0 || stream.overflow ) {
+		Com_Printf( S_COLOR_YELLOW "* Failed to load the cached bytecode '%s'\n", path );
+		asEngine->DiscardModule( moduleName );
+		return NULL;
+	}
+
+	Com_Printf( "* Loaded the cached bytecode '%s'\n", path );
+	return asModule;
+}
+
+/*
+* qasSaveCachedBytecode
+*/
+static void qasSaveCachedBytecode( asIScriptModule *asModule, const char *scriptName, const md5_byte_t *key ) {
+	qasBytecodeWriteStream stream;
+	if( asModule->SaveByteCode( &stream ) < 0 ) {
+		return;
+	}
+
+	qasBytecodeHeader_t header;
+	memcpy( header.magic, QAS_BYTECODE_CACHE_MAGIC, 4 );
+	header.version = QAS_BYTECODE_CACHE_VERSION;
+	memcpy( header.key, key, sizeof( header.key ) );
+
+	char path[MAX_QPATH];
+	qasMakeBytecodeCachePath( scriptName, path, sizeof( path ) );
+
+	int filenum;
+	if( FS_FOpenFile( path, &filenum, FS_WRITE | FS_CACHE ) < 0 ) {
+		Com_Printf( S_COLOR_YELLOW "* Failed to open '%s' for writing\n", path );
+		return;
+	}
+
+	FS_Write( &header, sizeof( header ), filenum );
+	FS_Write( stream.data.data(), stream.data.size(), filenum );
+	FS_FCloseFile( filenum );
+}
+
 /*
 * qasBuildScriptProject
 */
@@ -303,15 +501,20 @@ static asIScriptModule *qasBuildScriptProject( asIScriptEngine *asEngine, const
 		}
 	}
 
-	// load up the script sections
+	// load up the script sections, the cache key is computed over their contents
 
-	asIScriptModule *asModule = asEngine->GetModule( moduleName, asGM_CREATE_IF_NOT_EXISTS );
-	if( asModule == NULL ) {
-		Com_Printf( S_COLOR_RED "qasBuildGameScript: GetModule '%s' failed\n", moduleName );
-		return NULL;
-	}
+	md5_state_t md5;
+	md5_init( &md5 );
+	qasAppendApiToDigest( &md5, asEngine );
+	qasAppendToDigest( &md5, moduleName );
+
+	wsw::Vector<std::pair<wsw::StaticString<MAX_QPATH>, char *>> sections;
+	auto freeSections = [&]() {
+		for( auto &[name, section]: sections ) {
+			qasFree( section );
+		}
+	};
 
-	int error;
 	wsw::StringSplitter splitter( scriptView );
 	while( const auto maybeSectionName = splitter.getNext( QAS_SECTIONS_SEPARATOR ) ) {
 		wsw::StringView trimmedName( maybeSectionName->trim() );
@@ -322,17 +525,44 @@ static asIScriptModule *qasBuildScriptProject( asIScriptEngine *asEngine, const
 		const wsw::StaticString<MAX_QPATH> nameBuffer( trimmedName );
 
 		char *section = qasLoadScriptSection( rootDir, dir, trimmedName );
-		error = asModule->AddScriptSection( nameBuffer.data(), section, strlen( section ) );
+		if( !section ) {
+			freeSections();
+			return NULL;
+		}
 
-		qasFree( section );
+		qasAppendToDigest( &md5, nameBuffer.data() );
+		qasAppendToDigest( &md5, section );
+		sections.emplace_back( std::make_pair( nameBuffer, section ) );
+	}
+
+	md5_byte_t key[16];
+	md5_finish( &md5, key );
+
+	if( asIScriptModule *cachedModule = qasLoadCachedBytecode( asEngine, moduleName, scriptName, key ) ) {
+		freeSections();
+		return cachedModule;
+	}
 
+	asIScriptModule *asModule = asEngine->GetModule( moduleName, asGM_CREATE_IF_NOT_EXISTS );
+	if( asModule == NULL ) {
+		Com_Printf( S_COLOR_RED "qasBuildGameScript: GetModule '%s' failed\n", moduleName );
+		freeSections();
+		return NULL;
+	}
+
+	int error;
+	for( auto &[name, section]: sections ) {
+		error = asModule->AddScriptSection( name.data(), section, strlen( section ) );
 		if( error ) {
-			Com_Printf( S_COLOR_RED "* Failed to add the script section %s with error %i\n", nameBuffer.data(), error );
+			Com_Printf( S_COLOR_RED "* Failed to add the script section %s with error %i\n", name.data(), error );
+			freeSections();
 			asEngine->DiscardModule( moduleName );
 			return NULL;
 		}
 	}
 
+	freeSections();
+
 	error = asModule->Build();
 	if( error ) {
 		Com_Printf( S_COLOR_RED "* Failed to build script '%s'\n", scriptName );
@@ -340,6 +570,8 @@ static asIScriptModule *qasBuildScriptProject( asIScriptEngine *asEngine, const
 		return NULL;
 	}
 
+	qasSaveCachedBytecode( asModule, scriptName, key );
+
 	return asModule;
 }
 
@@ -115,6 +115,8 @@ public:
 /******* C++ objects *******/
 asIScriptEngine *qasCreateEngine( bool *asMaxPortability );
 asIScriptContext *qasAcquireContext( asIScriptEngine *engine );
+// Creates a context that is not shared via qasAcquireContext() and is not released along with the engine
+asIScriptContext *qasCreateUnlinkedContext( asIScriptEngine *engine );
 void qasReleaseContext( asIScriptContext *ctx );
 void qasReleaseEngine( asIScriptEngine *engine );
 asIScriptContext *qasGetActiveContext( void );
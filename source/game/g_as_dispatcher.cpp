@@ -0,0 +1,154 @@
+#include "g_local.h"
+#include "g_as_local.h"
+#include "g_as_dispatcher.h"
+#include "../qcommon/singletonholder.h"
+
+#include <algorithm>
+#include <chrono>
+
+static SingletonHolder<ScriptCallDispatcher> g_scriptCallDispatcherHolder;
+
+void ScriptCallDispatcher::init( asIScriptEngine *engine ) {
+	g_scriptCallDispatcherHolder.init( engine );
+}
+
+void ScriptCallDispatcher::shutdown() {
+	g_scriptCallDispatcherHolder.shutdown();
+}
+
+auto ScriptCallDispatcher::instance() -> ScriptCallDispatcher * {
+	return g_scriptCallDispatcherHolder.instance();
+}
+
+static inline uint64_t G_asNanoseconds() {
+	const auto sinceEpoch = std::chrono::steady_clock::now().time_since_epoch();
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>( sinceEpoch ).count();
+}
+
+static inline bool G_asIsContextBusy( asIScriptContext *ctx ) {
+	const asEContextState state = ctx->GetState();
+	return state == asEXECUTION_ACTIVE || state == asEXECUTION_SUSPENDED;
+}
+
+ScriptCallDispatcher::~ScriptCallDispatcher() {
+	// Nothing could be executed at this point
+	releaseFunctions();
+	for( asIScriptContext *ctx: m_retiredContexts ) {
+		ctx->Release();
+	}
+}
+
+auto ScriptCallDispatcher::findOrAddEntry( asIScriptFunction *func ) -> Entry * {
+	if( func == m_lastFunction ) {
+		return m_lastEntry;
+	}
+
+	Entry *entry = &m_entries[func];
+	m_lastFunction = func;
+	m_lastEntry = entry;
+	return entry;
+}
+
+void ScriptCallDispatcher::releaseRetiredContexts() {
+	auto it = m_retiredContexts.begin();
+	while( it != m_retiredContexts.end() ) {
+		if( !G_asIsContextBusy( *it ) ) {
+			( *it )->Release();
+			it = m_retiredContexts.erase( it );
+		} else {
+			++it;
+		}
+	}
+}
+
+auto ScriptCallDispatcher::prepare( asIScriptFunction *func ) -> asIScriptContext * {
+	if( !m_retiredContexts.empty() ) {
+		releaseRetiredContexts();
+	}
+
+	Entry *const entry = findOrAddEntry( func );
+	if( !entry->context && m_numPooledContexts < kMaxPooledContexts ) {
+		if( ( entry->context = qasCreateUnlinkedContext( m_engine ) ) ) {
+			m_numPooledContexts++;
+		}
+	}
+
+	asIScriptContext *ctx = entry->context;
+	// Check whether it's a nested call of the function (or the pool is exhausted)
+	if( !ctx || G_asIsContextBusy( ctx ) ) {
+		ctx = qasAcquireContext( m_engine );
+		if( !ctx ) {
+			return nullptr;
+		}
+	}
+
+	// This is cheap if the context has been prepared for the same function last time
+	if( ctx->Prepare( func ) < 0 ) {
+		return nullptr;
+	}
+
+	// Setting arguments does not lead to script calls, so this gets consumed by the matching execute() call
+	m_preparedContext = ctx;
+	m_preparedEntry = entry;
+	return ctx;
+}
+
+auto ScriptCallDispatcher::execute( asIScriptContext *ctx ) -> int {
+	assert( ctx == m_preparedContext );
+	Entry *const entry = m_preparedEntry;
+	m_preparedContext = nullptr;
+	m_preparedEntry = nullptr;
+	const unsigned generation = m_generation;
+
+	const uint64_t startNanos = G_asNanoseconds();
+	const int result = ctx->Execute();
+	const uint64_t durationNanos = G_asNanoseconds() - startNanos;
+
+	// Entries could have been released by the callee (e.g. on a script error)
+	if( entry && generation == m_generation ) {
+		entry->numCalls++;
+		entry->totalNanos += durationNanos;
+		entry->maxNanos = wsw::max( entry->maxNanos, durationNanos );
+	}
+
+	return result;
+}
+
+void ScriptCallDispatcher::releaseFunctions() {
+	for( auto &[func, entry]: m_entries ) {
+		if( entry.context ) {
+			// Callers could still refer to the context, defer releasing it
+			m_retiredContexts.push_back( entry.context );
+		}
+	}
+
+	m_entries.clear();
+	m_numPooledContexts = 0;
+	m_lastFunction = nullptr;
+	m_lastEntry = nullptr;
+	m_preparedContext = nullptr;
+	m_preparedEntry = nullptr;
+	m_generation++;
+}
+
+void ScriptCallDispatcher::printStats() {
+	wsw::Vector<std::pair<asIScriptFunction *, const Entry *>> entries;
+	for( const auto &[func, entry]: m_entries ) {
+		if( entry.numCalls ) {
+			entries.emplace_back( std::make_pair( func, &entry ) );
+		}
+	}
+
+	std::sort( entries.begin(), entries.end(), []( const auto &lhs, const auto &rhs ) {
+		return lhs.second->totalNanos > rhs.second->totalNanos;
+	});
+
+	G_Printf( "%10s %10s %10s %10s  %s\n", "calls", "total ms", "avg us", "max us", "function" );
+	for( const auto &[func, entry]: entries ) {
+		const double totalMillis = (double)entry->totalNanos * 1e-6;
+		const double avgMicros = (double)entry->totalNanos * 1e-3 / (double)entry->numCalls;
+		const double maxMicros = (double)entry->maxNanos * 1e-3;
+		G_Printf( "%10" PRIu64 " %10.3f %10.3f %10.3f  %s\n", entry->numCalls,
+				  totalMillis, avgMicros, maxMicros, func->GetDeclaration( true ) );
+	}
+}
@@ -0,0 +1,82 @@
+#ifndef WSW_513201a1_7d29_4233_96ca_2889c5166427_H
+#define WSW_513201a1_7d29_4233_96ca_2889c5166427_H
+
+#include "../qcommon/wswvector.h"
+
+#include <cstdint>
+#include <unordered_map>
+
+class asIScriptEngine;
+class asIScriptContext;
+class asIScriptFunction;
+
+template <typename> class SingletonHolder;
+
+/**
+ * Dispatches calls of script callbacks (entity behaviors, gametype and map hooks).
+ * Every called function gets its own context that is kept prepared between calls,
+ * so repeated calls of the same function skip most of the context setup.
+ * Nested calls of a function that is already being executed fall back to shared contexts.
+ * Call counts and timings are recorded for every function.
+ */
+class ScriptCallDispatcher {
+	template <typename> friend class SingletonHolder;
+
+	static constexpr unsigned kMaxPooledContexts = 64;
+
+	struct Entry {
+		asIScriptContext *context { nullptr };
+		uint64_t numCalls { 0 };
+		uint64_t totalNanos { 0 };
+		uint64_t maxNanos { 0 };
+	};
+
+	asIScriptEngine *const m_engine;
+	std::unordered_map<asIScriptFunction *, Entry> m_entries;
+	// Contexts of discarded functions. These could be still referred by callers.
+	wsw::Vector<asIScriptContext *> m_retiredContexts;
+	unsigned m_numPooledContexts { 0 };
+	// Gets incremented on clearing entries so calls that were in progress do not touch stale ones
+	unsigned m_generation { 0 };
+
+	asIScriptFunction *m_lastFunction { nullptr };
+	Entry *m_lastEntry { nullptr };
+
+	asIScriptContext *m_preparedContext { nullptr };
+	Entry *m_preparedEntry { nullptr };
+
+	explicit ScriptCallDispatcher( asIScriptEngine *engine ) : m_engine( engine ) {}
+	~ScriptCallDispatcher();
+
+	[[nodiscard]]
+	auto findOrAddEntry( asIScriptFunction *func ) -> Entry *;
+	void releaseRetiredContexts();
+public:
+	static void init( asIScriptEngine *engine );
+	static void shutdown();
+	[[nodiscard]]
+	static auto instance() -> ScriptCallDispatcher *;
+
+	/**
+	 * Returns a context prepared for calling the function.
+	 * Arguments should be set by the caller, the call should be made using {@code execute()}.
+	 * @return a prepared context or null on failure.
+	 */
+	[[nodiscard]]
+	auto prepare( asIScriptFunction *func ) -> asIScriptContext *;
+
+	/**
+	 * Executes the context returned by the last {@code prepare()} call.
+	 * The context stays valid for retrieval of results until the next {@code prepare()} call.
+	 * @return a result of {@code asIScriptContext::Execute()}.
+	 */
+	[[nodiscard]]
+	auto execute( asIScriptContext *ctx ) -> int;
+
+	//! Must be called prior to discarding script modules.
+	void releaseFunctions();
+
+	void printStats();
+};
+
+#endif
@@ -20,6 +20,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "g_local.h"
 #include "g_as_local.h"
+#include "g_as_dispatcher.h"
 
 static void GT_ResetScriptData( void ) {
 	level.gametype.initFunc = NULL;
@@ -58,6 +59,7 @@ void GT_asShutdownScript( void ) {
 
 	GT_ResetScriptData();
 
+	ScriptCallDispatcher::instance()->releaseFunctions();
 	GAME_AS_ENGINE()->DiscardModule( GAMETYPE_SCRIPTS_MODULE_NAME );
 }
 
@@ -70,14 +72,12 @@ void GT_asCallSpawn( void ) {
 		return;
 	}
 
-	ctx = qasAcquireContext( GAME_AS_ENGINE() );
-
-	error = ctx->Prepare( static_cast<asIScriptFunction *>( level.gametype.spawnFunc ) );
-	if( error < 0 ) {
+	ctx = ScriptCallDispatcher::instance()->prepare( static_cast<asIScriptFunction *>( level.gametype.spawnFunc ) );
+	if( !ctx ) {
 		return;
 	}
 
-	error = ctx->Execute();
+	error = ScriptCallDispatcher::instance()->execute( ctx );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -92,14 +92,12 @@ void GT_asCallMatchStateStarted( void ) {
 		return;
 	}
 
-	ctx = qasAcquireContext( GAME_AS_ENGINE() );
-
-	error = ctx->Prepare( static_cast<asIScriptFunction *>( level.gametype.matchStateStartedFunc ) );
-	if( error < 0 ) {
+	ctx = ScriptCallDispatcher::instance()->prepare( static_cast<asIScriptFunction *>( level.gametype.matchStateStartedFunc ) );
+	if( !ctx ) {
 		return;
 	}
 
-	error = ctx->Execute();
+	error = ScriptCallDispatcher::instance()->execute( ctx );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -115,17 +113,15 @@ bool GT_asCallMatchStateFinished( int incomingMatchState ) {
 		return true;
 	}
 
-	ctx = qasAcquireContext( GAME_AS_ENGINE() );
-
-	error = ctx->Prepare( static_cast<asIScriptFunction *>( level.gametype.matchStateFinishedFunc ) );
-	if( error < 0 ) {
+	ctx = ScriptCallDispatcher::instance()->prepare( static_cast<asIScriptFunction *>( level.gametype.matchStateFinishedFunc ) );
+	if( !ctx ) {
 		return true;
 	}
 
 	// Now we need to pass the parameters to the script function.
 	ctx->SetArgDWord( 0, incomingMatchState );
 
-	error = ctx->Execute();
+	error = ScriptCallDispatcher::instance()->execute( ctx );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -145,14 +141,14 @@ void GT_asCallThinkRules( void ) {
 		return;
 	}
 
-	ctx = qasAcquireContext( GAME_AS_ENGINE() );
+	G_PROFILER_SCOPE( "GT_asCallThinkRules" );
 
-	error = ctx->Prepare( static_cast<asIScriptFunction *>( level.gametype.thinkRulesFunc ) );
-	if( error < 0 ) {
+	ctx = ScriptCallDispatcher::instance()->prepare( static_cast<asIScriptFunction *>( level.gametype.thinkRulesFunc ) );
+	if( !ctx ) {
 		return;
 	}
 
-	error = ctx->Execute();
+	error = ScriptCallDispatcher::instance()->execute( ctx );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -167,10 +163,8 @@ void GT_asCallPlayerRespawn( edict_t *ent, int old_team, int new_team ) {
 		return;
 	}
 
-	ctx = qasAcquireContext( GAME_AS_ENGINE() );
-
-	error = ctx->Prepare( static_cast<asIScriptFunction *>( level.gametype.playerRespawnFunc ) );
-	if( error < 0 ) {
+	ctx = ScriptCallDispatcher::instance()->prepare( static_cast<asIScriptFunction *>( level.gametype.playerRespawnFunc ) );
+	if( !ctx ) {
 		return;
 	}
 
@@ -179,7 +173,7 @@ void GT_asCallPlayerRespawn( edict_t *ent, int old_team, int new_team ) {
 	ctx->SetArgDWord( 1, old_team );
 	ctx->SetArgDWord( 2, new_team );
 
-	error = ctx->Execute();
+	error = ScriptCallDispatcher::instance()->execute( ctx );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -203,10 +197,8 @@ void GT_asCallScoreEvent( Client *client, const char *score_event, const char *a
 		args = "";
 	}
 
-	ctx = qasAcquireContext( GAME_AS_ENGINE() );
-
-	error = ctx->Prepare( static_cast<asIScriptFunction *>( level.gametype.scoreEventFunc ) );
-	if( error < 0 ) {
+	ctx = ScriptCallDispatcher::instance()->prepare( static_cast<asIScriptFunction *>( level.gametype.scoreEventFunc ) );
+	if( !ctx ) {
 		return;
 	}
 
@@ -218,7 +210,7 @@ void GT_asCallScoreEvent( Client *client, const char *score_event, const char *a
 	ctx->SetArgObject( 1, s1 );
 	ctx->SetArgObject( 2, s2 );
 
-	error = ctx->Execute();
+	error = ScriptCallDispatcher::instance()->execute( ctx );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -232,14 +224,13 @@ void GT_asCallUpdateScoreboard() {
 		return;
 	}
 
-	asIScriptContext *ctx = qasAcquireContext( GAME_AS_ENGINE() );
-	int error = ctx->Prepare( static_cast<asIScriptFunction *>( level.gametype.updateScoreboardFunc ) );
-	if( error < 0 ) {
+	asIScriptContext *ctx = ScriptCallDispatcher::instance()->prepare( static_cast<asIScriptFunction *>( level.gametype.updateScoreboardFunc ) );
+	if( !ctx ) {
 		return;
 	}
 
 	// Now we need to pass the parameters to the script function.
-	error = ctx->Execute();
+	int error = ScriptCallDispatcher::instance()->execute( ctx );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -255,17 +246,15 @@ edict_t *GT_asCallSelectSpawnPoint( edict_t *ent ) {
 		return SelectDeathmatchSpawnPoint( ent ); // should have a hardcoded backup
 
 	}
-	ctx = qasAcquireContext( GAME_AS_ENGINE() );
-
-	error = ctx->Prepare( static_cast<asIScriptFunction *>( level.gametype.selectSpawnPointFunc ) );
-	if( error < 0 ) {
+	ctx = ScriptCallDispatcher::instance()->prepare( static_cast<asIScriptFunction *>( level.gametype.selectSpawnPointFunc ) );
+	if( !ctx ) {
 		return SelectDeathmatchSpawnPoint( ent );
 	}
 
 	// Now we need to pass the parameters to the script function.
 	ctx->SetArgObject( 0, ent );
 
-	error = ctx->Execute();
+	error = ScriptCallDispatcher::instance()->execute( ctx );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -294,10 +283,8 @@ bool GT_asCallGameCommand( Client *client, const char *cmd, const char *args, in
 		return false;
 	}
 
-	ctx = qasAcquireContext( GAME_AS_ENGINE() );
-
-	error = ctx->Prepare( static_cast<asIScriptFunction *>( level.gametype.clientCommandFunc ) );
-	if( error < 0 ) {
+	ctx = ScriptCallDispatcher::instance()->prepare( static_cast<asIScriptFunction *>( level.gametype.clientCommandFunc ) );
+	if( !ctx ) {
 		return false;
 	}
 
@@ -310,7 +297,7 @@ bool GT_asCallGameCommand( Client *client, const char *cmd, const char *args, in
 	ctx->SetArgObject( 2, s2 );
 	ctx->SetArgDWord( 3, argc );
 
-	error = ctx->Execute();
+	error = ScriptCallDispatcher::instance()->execute( ctx );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -331,14 +318,12 @@ void GT_asCallShutdown( void ) {
 		return;
 	}
 
-	ctx = qasAcquireContext( GAME_AS_ENGINE() );
-
-	error = ctx->Prepare( static_cast<asIScriptFunction *>( level.gametype.shutdownFunc ) );
-	if( error < 0 ) {
+	ctx = ScriptCallDispatcher::instance()->prepare( static_cast<asIScriptFunction *>( level.gametype.shutdownFunc ) );
+	if( !ctx ) {
 		return;
 	}
 
-	error = ctx->Execute();
+	error = ScriptCallDispatcher::instance()->execute( ctx );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -387,14 +372,12 @@ static bool G_asInitializeGametypeScript( asIScriptModule *asModule ) {
 	// execute the GT_InitGametype function
 	//
 
-	asIScriptContext *ctx = qasAcquireContext( GAME_AS_ENGINE() );
-
-	int error = ctx->Prepare( static_cast<asIScriptFunction *>( level.gametype.initFunc ) );
-	if( error < 0 ) {
+	asIScriptContext *ctx = ScriptCallDispatcher::instance()->prepare( static_cast<asIScriptFunction *>( level.gametype.initFunc ) );
+	if( !ctx ) {
 		return false;
 	}
 
-	error = ctx->Execute();
+	int error = ScriptCallDispatcher::instance()->execute( ctx );
 	if( G_ExecutionErrorReport( error ) ) {
 		return false;
 	}
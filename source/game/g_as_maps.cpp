@@ -20,6 +20,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "g_local.h"
 #include "g_as_local.h"
+#include "g_as_dispatcher.h"
 
 /*
 * G_ResetMapScriptData
@@ -61,14 +62,12 @@ static void G_asCallMapFunction( void *func ) {
 		return;
 	}
 
-	ctx = qasAcquireContext( GAME_AS_ENGINE() );
-
-	error = ctx->Prepare( static_cast<asIScriptFunction *>( func ) );
-	if( error < 0 ) {
+	ctx = ScriptCallDispatcher::instance()->prepare( static_cast<asIScriptFunction *>( func ) );
+	if( !ctx ) {
 		return;
 	}
 
-	error = ctx->Execute();
+	error = ScriptCallDispatcher::instance()->execute( ctx );
 	if( G_ExecutionErrorReport( error ) ) {
 		G_asShutdownMapScript();
 	}
@@ -116,10 +115,8 @@ const char *G_asCallMapGametype( void ) {
 		return "";
 	}
 
-	ctx = qasAcquireContext( GAME_AS_ENGINE() );
-
-	error = ctx->Prepare( static_cast<asIScriptFunction *>( level.mapscript.gametypeFunc ) );
-	if( error < 0 ) {
+	ctx = ScriptCallDispatcher::instance()->prepare( static_cast<asIScriptFunction *>( level.mapscript.gametypeFunc ) );
+	if( !ctx ) {
 		return "";
 	}
 
@@ -127,7 +124,7 @@ const char *G_asCallMapGametype( void ) {
 
 	ctx->SetArgObject( 0, s );
 
-	error = ctx->Execute();
+	error = ScriptCallDispatcher::instance()->execute( ctx );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -190,5 +187,6 @@ void G_asShutdownMapScript( void ) {
 
 	G_ResetMapScriptData();
 
+	ScriptCallDispatcher::instance()->releaseFunctions();
 	GAME_AS_ENGINE()->DiscardModule( MAP_SCRIPTS_MODULE_NAME );
 }
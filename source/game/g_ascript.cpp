@@ -20,6 +20,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "g_local.h"
 #include "g_as_local.h"
+#include "g_as_dispatcher.h"
 #include "scoreboard.h"
 #include "commandshandler.h"
 
@@ -3484,17 +3485,17 @@ void G_asCallMapEntityThink( edict_t *ent ) {
 		return;
 	}
 
-	ctx = qasAcquireContext( GAME_AS_ENGINE() );
+	G_PROFILER_SCOPE( "G_asCallMapEntityThink" );
 
-	error = ctx->Prepare( static_cast<asIScriptFunction *>( ent->asThinkFunc ) );
-	if( error < 0 ) {
+	ctx = ScriptCallDispatcher::instance()->prepare( static_cast<asIScriptFunction *>( ent->asThinkFunc ) );
+	if( !ctx ) {
 		return;
 	}
 
 	// Now we need to pass the parameters to the script function.
 	ctx->SetArgObject( 0, ent );
 
-	error = ctx->Execute();
+	error = ScriptCallDispatcher::instance()->execute( ctx );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -3510,10 +3511,10 @@ void G_asCallMapEntityTouch( edict_t *ent, edict_t *other, cplane_t *plane, int
 		return;
 	}
 
-	ctx = qasAcquireContext( GAME_AS_ENGINE() );
+	G_PROFILER_SCOPE( "G_asCallMapEntityTouch" );
 
-	error = ctx->Prepare( static_cast<asIScriptFunction *>( ent->asTouchFunc ) );
-	if( error < 0 ) {
+	ctx = ScriptCallDispatcher::instance()->prepare( static_cast<asIScriptFunction *>( ent->asTouchFunc ) );
+	if( !ctx ) {
 		return;
 	}
 
@@ -3529,7 +3530,7 @@ void G_asCallMapEntityTouch( edict_t *ent, edict_t *other, cplane_t *plane, int
 	ctx->SetArgObject( 2, &normal );
 	ctx->SetArgDWord( 3, surfFlags );
 
-	error = ctx->Execute();
+	error = ScriptCallDispatcher::instance()->execute( ctx );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -3544,10 +3545,10 @@ void G_asCallMapEntityUse( edict_t *ent, edict_t *other, edict_t *activator ) {
 		return;
 	}
 
-	ctx = qasAcquireContext( GAME_AS_ENGINE() );
+	G_PROFILER_SCOPE( "G_asCallMapEntityUse" );
 
-	error = ctx->Prepare( static_cast<asIScriptFunction *>( ent->asUseFunc ) );
-	if( error < 0 ) {
+	ctx = ScriptCallDispatcher::instance()->prepare( static_cast<asIScriptFunction *>( ent->asUseFunc ) );
+	if( !ctx ) {
 		return;
 	}
 
@@ -3556,7 +3557,7 @@ void G_asCallMapEntityUse( edict_t *ent, edict_t *other, edict_t *activator ) {
 	ctx->SetArgObject( 1, other );
 	ctx->SetArgObject( 2, activator );
 
-	error = ctx->Execute();
+	error = ScriptCallDispatcher::instance()->execute( ctx );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -3571,10 +3572,10 @@ void G_asCallMapEntityPain( edict_t *ent, edict_t *other, float kick, float dama
 		return;
 	}
 
-	ctx = qasAcquireContext( GAME_AS_ENGINE() );
+	G_PROFILER_SCOPE( "G_asCallMapEntityPain" );
 
-	error = ctx->Prepare( static_cast<asIScriptFunction *>( ent->asPainFunc ) );
-	if( error < 0 ) {
+	ctx = ScriptCallDispatcher::instance()->prepare( static_cast<asIScriptFunction *>( ent->asPainFunc ) );
+	if( !ctx ) {
 		return;
 	}
 
@@ -3584,7 +3585,7 @@ void G_asCallMapEntityPain( edict_t *ent, edict_t *other, float kick, float dama
 	ctx->SetArgFloat( 2, kick );
 	ctx->SetArgFloat( 3, damage );
 
-	error = ctx->Execute();
+	error = ScriptCallDispatcher::instance()->execute( ctx );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -3599,10 +3600,10 @@ void G_asCallMapEntityDie( edict_t *ent, edict_t *inflicter, edict_t *attacker,
 		return;
 	}
 
-	ctx = qasAcquireContext( GAME_AS_ENGINE() );
+	G_PROFILER_SCOPE( "G_asCallMapEntityDie" );
 
-	error = ctx->Prepare( static_cast<asIScriptFunction *>( ent->asDieFunc ) );
-	if( error < 0 ) {
+	ctx = ScriptCallDispatcher::instance()->prepare( static_cast<asIScriptFunction *>( ent->asDieFunc ) );
+	if( !ctx ) {
 		return;
 	}
 
@@ -3611,7 +3612,7 @@ void G_asCallMapEntityDie( edict_t *ent, edict_t *inflicter, edict_t *attacker,
 	ctx->SetArgObject( 1, inflicter );
 	ctx->SetArgObject( 2, attacker );
 
-	error = ctx->Execute();
+	error = ScriptCallDispatcher::instance()->execute( ctx );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -3626,17 +3627,17 @@ void G_asCallMapEntityStop( edict_t *ent ) {
 		return;
 	}
 
-	ctx = qasAcquireContext( GAME_AS_ENGINE() );
+	G_PROFILER_SCOPE( "G_asCallMapEntityStop" );
 
-	error = ctx->Prepare( static_cast<asIScriptFunction *>( ent->asStopFunc ) );
-	if( error < 0 ) {
+	ctx = ScriptCallDispatcher::instance()->prepare( static_cast<asIScriptFunction *>( ent->asStopFunc ) );
+	if( !ctx ) {
 		return;
 	}
 
 	// Now we need to pass the parameters to the script function.
 	ctx->SetArgObject( 0, ent );
 
-	error = ctx->Execute();
+	error = ScriptCallDispatcher::instance()->execute( ctx );
 	if( G_ExecutionErrorReport( error ) ) {
 		GT_asShutdownScript();
 	}
@@ -3658,6 +3659,10 @@ bool G_ExecutionErrorReport( int error ) {
 * G_LoadGameScript
 */
 asIScriptModule *G_LoadGameScript( const char *moduleName, const char *dir, const char *filename, const char *ext ) {
+	// Loading discards an existing module with the same name
+	if( game.asEngine ) {
+		ScriptCallDispatcher::instance()->releaseFunctions();
+	}
 	return qasLoadScriptProject( GAME_AS_ENGINE(), moduleName, GAME_SCRIPTS_DIRECTORY, dir, filename, ext );
 }
 
@@ -3736,6 +3741,8 @@ void G_asInitGameModuleEngine( void ) {
 
 	game.asEngine = asEngine;
 
+	ScriptCallDispatcher::init( asEngine );
+
 	G_InitializeGameModuleSyntax( asEngine );
 }
 
@@ -3744,6 +3751,7 @@ void G_asInitGameModuleEngine( void ) {
 */
 void G_asShutdownGameModuleEngine( void ) {
 	if( game.asEngine != NULL ) {
+		ScriptCallDispatcher::shutdown();
 		qasReleaseEngine( static_cast<asIScriptEngine *>( game.asEngine ) );
 		G_ResetGameModuleScriptData();
 	}
@@ -3999,3 +4007,17 @@ void G_asDumpAPI_f( void ) {
 	Q_snprintfz( path, sizeof( path ), "AS_API/v%.g/", trap_Cvar_Value( "version" ) );
 	G_asDumpAPIToFile( path );
 }
+
+/*
+* G_asPrintCallStats_f
+*
+* Print call counts and timings of script callbacks since the scripts were loaded
+*/
+void G_asPrintCallStats_f( void ) {
+	if( !game.asEngine ) {
+		G_Printf( "Scripts are not initialized\n" );
+		return;
+	}
+
+	ScriptCallDispatcher::instance()->printStats();
+}
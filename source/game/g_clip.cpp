@@ -18,6 +18,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 */
 #include "g_local.h"
+#include "../qcommon/aabbtree.h"
 
 //
 // g_clip.c - entity contact detection. (high level object sorting to reduce interaction tests)
@@ -34,29 +35,12 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define EDICT_NUM( n ) ( (edict_t *)( game.edicts + n ) )
 #define NUM_FOR_EDICT( e ) ( ENTNUM( e ) )
 
-#define AREA_GRID       128
-#define AREA_GRIDNODES  ( AREA_GRID * AREA_GRID )
-#define AREA_GRIDMINSIZE 64.0f  // minimum areagrid cell size, smaller values
-// work better for lots of small objects, higher
-// values for large objects
-
-typedef struct
-{
-	link_t grid[AREA_GRIDNODES];
-	link_t outside;
-	vec3_t bias;
-	vec3_t scale;
-	vec3_t mins;
-	vec3_t maxs;
-	vec3_t size;
-	int marknumber;
-
-	// since the areagrid can have multiple references to one entity,
-	// we should avoid extensive checking on entities already encountered
-	int entmarknumber[MAX_EDICTS];
-} areagrid_t;
-
-static areagrid_t g_areagrid;
+// Fat boxes of moving entities should enclose bounds of a few next frames
+#define CLIP_TREE_FAT_MARGIN 8.0f
+
+// Entities are linked into a dynamic bounding volume hierarchy.
+// Unlike a uniform grid it does not degrade on huge maps or with lots of small fast objects.
+static wsw::AabbTree g_clipTree( MAX_EDICTS, CLIP_TREE_FAT_MARGIN );
 
 extern cvar_t *g_antilag;
 extern cvar_t *g_antilag_maxtimedelta;
@@ -227,241 +211,40 @@ static c4clipedict_t *GClip_GetClipEdictForDeltaTime( int entNum, int deltaTime
 	return clipent;
 }
 
-// ClearLink is used for new headnodes
-static void GClip_ClearLink( link_t *l ) {
-	l->prev = l->next = l;
-	l->entNum = 0;
-}
-
-static void GClip_RemoveLink( link_t *l ) {
-	l->next->prev = l->prev;
-	l->prev->next = l->next;
-	l->entNum = 0;
-}
-
-static void GClip_InsertLinkBefore( link_t *l, link_t *before, int entNum ) {
-	l->next = before;
-	l->prev = before->prev;
-	l->prev->next = l;
-	l->next->prev = l;
-	l->entNum = entNum;
-}
-
 /*
-* GClip_Init_AreaGrid
+* GClip_EntitiesInBox
 */
-static void GClip_Init_AreaGrid( areagrid_t *areagrid, const vec3_t world_mins, const vec3_t world_maxs ) {
-	int i;
-
-	// the areagrid_marknumber is not allowed to be 0
-	if( areagrid->marknumber < 1 ) {
-		areagrid->marknumber = 1;
-	}
-
-	// choose either the world box size, or a larger box to ensure the grid isn't too fine
-	areagrid->size[0] = wsw::max( world_maxs[0] - world_mins[0], AREA_GRID * AREA_GRIDMINSIZE );
-	areagrid->size[1] = wsw::max( world_maxs[1] - world_mins[1], AREA_GRID * AREA_GRIDMINSIZE );
-	areagrid->size[2] = wsw::max( world_maxs[2] - world_mins[2], AREA_GRID * AREA_GRIDMINSIZE );
-
-	// figure out the corners of such a box, centered at the center of the world box
-	areagrid->mins[0] = ( world_mins[0] + world_maxs[0] - areagrid->size[0] ) * 0.5f;
-	areagrid->mins[1] = ( world_mins[1] + world_maxs[1] - areagrid->size[1] ) * 0.5f;
-	areagrid->mins[2] = ( world_mins[2] + world_maxs[2] - areagrid->size[2] ) * 0.5f;
-	areagrid->maxs[0] = ( world_mins[0] + world_maxs[0] + areagrid->size[0] ) * 0.5f;
-	areagrid->maxs[1] = ( world_mins[1] + world_maxs[1] + areagrid->size[1] ) * 0.5f;
-	areagrid->maxs[2] = ( world_mins[2] + world_maxs[2] + areagrid->size[2] ) * 0.5f;
-
-	// now calculate the actual useful info from that
-	VectorNegate( areagrid->mins, areagrid->bias );
-	areagrid->scale[0] = AREA_GRID / areagrid->size[0];
-	areagrid->scale[1] = AREA_GRID / areagrid->size[1];
-	areagrid->scale[2] = AREA_GRID / areagrid->size[2];
-
-	GClip_ClearLink( &areagrid->outside );
-	for( i = 0; i < AREA_GRIDNODES; i++ ) {
-		GClip_ClearLink( &areagrid->grid[i] );
-	}
-
-	memset( areagrid->entmarknumber, 0, sizeof( areagrid->entmarknumber ) );
-
-	if( developer->integer ) {
-		Com_Printf( "areagrid settings: divisions %ix%ix1 : box %f %f %f "
-					": %f %f %f size %f %f %f grid %f %f %f (mingrid %f)\n",
-					AREA_GRID, AREA_GRID,
-					areagrid->mins[0], areagrid->mins[1], areagrid->mins[2],
-					areagrid->maxs[0], areagrid->maxs[1], areagrid->maxs[2],
-					areagrid->size[0], areagrid->size[1], areagrid->size[2],
-					1.0f / areagrid->scale[0], 1.0f / areagrid->scale[1], 1.0f / areagrid->scale[2],
-					AREA_GRIDMINSIZE );
-	}
-}
+static int GClip_EntitiesInBox( const vec3_t mins, const vec3_t maxs, int *list, int maxcount, int areatype, int timeDelta ) {
+	int numlist = 0;
 
-/*
-* GClip_UnlinkEntity_AreaGrid
-*/
-static void GClip_UnlinkEntity_AreaGrid( edict_t *ent ) {
-	for( int i = 0; i < MAX_ENT_AREAS; i++ ) {
-		if( !ent->areagrid[i].prev ) {
-			break;
+	g_clipTree.query( mins, maxs, [&]( unsigned entNum ) {
+		// entities are removed from the tree lazily (see GClip_UnlinkEntity())
+		if( !EDICT_NUM( entNum )->linked ) {
+			return true;
 		}
-		GClip_RemoveLink( &ent->areagrid[i] );
-		ent->areagrid[i].prev = ent->areagrid[i].next = NULL;
-	}
-}
-
-/*
-* GClip_LinkEntity_AreaGrid
-*/
-static void GClip_LinkEntity_AreaGrid( areagrid_t *areagrid, edict_t *ent ) {
-	link_t *grid;
-	int igrid[3], igridmins[3], igridmaxs[3], gridnum, entitynumber;
-
-	entitynumber = NUM_FOR_EDICT( ent );
-	if( entitynumber <= 0 || entitynumber >= game.maxentities || EDICT_NUM( entitynumber ) != ent ) {
-		Com_Printf( "GClip_LinkEntity_AreaGrid: invalid edict %p "
-					"(edicts is %p, edict compared to prog->edicts is %i)\n",
-					(void *)ent, game.edicts, entitynumber );
-		return;
-	}
-
-	igridmins[0] = (int) floor( ( ent->r.absmin[0] + areagrid->bias[0] ) * areagrid->scale[0] );
-	igridmins[1] = (int) floor( ( ent->r.absmin[1] + areagrid->bias[1] ) * areagrid->scale[1] );
-
-	//igridmins[2] = (int) floor( (ent->r.absmin[2] + areagrid->bias[2]) * areagrid->scale[2] );
-	igridmaxs[0] = (int) floor( ( ent->r.absmax[0] + areagrid->bias[0] ) * areagrid->scale[0] ) + 1;
-	igridmaxs[1] = (int) floor( ( ent->r.absmax[1] + areagrid->bias[1] ) * areagrid->scale[1] ) + 1;
-
-	//igridmaxs[2] = (int) floor( (ent->r.absmax[2] + areagrid->bias[2]) * areagrid->scale[2] ) + 1;
-	if( igridmins[0] < 0 || igridmaxs[0] > AREA_GRID
-		|| igridmins[1] < 0 || igridmaxs[1] > AREA_GRID
-		|| ( ( igridmaxs[0] - igridmins[0] ) * ( igridmaxs[1] - igridmins[1] ) ) > MAX_ENT_AREAS ) {
-		// wow, something outside the grid, store it as such
-		GClip_InsertLinkBefore( &ent->areagrid[0], &areagrid->outside, entitynumber );
-		return;
-	}
-
-	gridnum = 0;
-	for( igrid[1] = igridmins[1]; igrid[1] < igridmaxs[1]; igrid[1]++ ) {
-		grid = areagrid->grid + igrid[1] * AREA_GRID + igridmins[0];
-		for( igrid[0] = igridmins[0]; igrid[0] < igridmaxs[0]; igrid[0]++, grid++, gridnum++ )
-			GClip_InsertLinkBefore( &ent->areagrid[gridnum], grid, entitynumber );
-	}
-}
-
-/*
-* GClip_EntitiesInBox_AreaGrid
-*/
-static int GClip_EntitiesInBox_AreaGrid( areagrid_t *areagrid, const vec3_t mins, const vec3_t maxs,
-										 int *list, int maxcount, int areatype, int timeDelta ) {
-	int numlist;
-	link_t *grid;
-	link_t *l;
-	c4clipedict_t *clipEnt;
-	vec3_t paddedmins, paddedmaxs;
-	int igrid[3], igridmins[3], igridmaxs[3];
-
-	// LordHavoc: discovered this actually causes its own bugs (dm6 teleporters
-	// being too close to info_teleport_destination)
-	//VectorSet( paddedmins, mins[0] - 1.0f, mins[1] - 1.0f, mins[2] - 1.0f );
-	//VectorSet( paddedmaxs, maxs[0] + 1.0f, maxs[1] + 1.0f, maxs[2] + 1.0f );
-	VectorCopy( mins, paddedmins );
-	VectorCopy( maxs, paddedmaxs );
-
-	// FIXME: if areagrid_marknumber wraps, all entities need their
-	// ent->priv.server->areagridmarknumber reset
-	areagrid->marknumber++;
-
-	igridmins[0] = (int) floor( ( paddedmins[0] + areagrid->bias[0] ) * areagrid->scale[0] );
-	igridmins[1] = (int) floor( ( paddedmins[1] + areagrid->bias[1] ) * areagrid->scale[1] );
-
-	//igridmins[2] = (int) ( (paddedmins[2] + areagrid->bias[2]) * areagrid->scale[2] );
-	igridmaxs[0] = (int) floor( ( paddedmaxs[0] + areagrid->bias[0] ) * areagrid->scale[0] ) + 1;
-	igridmaxs[1] = (int) floor( ( paddedmaxs[1] + areagrid->bias[1] ) * areagrid->scale[1] ) + 1;
-
-	//igridmaxs[2] = (int) ( (paddedmaxs[2] + areagrid->bias[2]) * areagrid->scale[2] ) + 1;
-	igridmins[0] = wsw::max( 0, igridmins[0] );
-	igridmins[1] = wsw::max( 0, igridmins[1] );
-
-	//igridmins[2] = max( 0, igridmins[2] );
-	igridmaxs[0] = wsw::min( AREA_GRID, igridmaxs[0] );
-	igridmaxs[1] = wsw::min( AREA_GRID, igridmaxs[1] );
 
-	//igridmaxs[2] = min( AREA_GRID, igridmaxs[2] );
+		const c4clipedict_t *clipEnt = GClip_GetClipEdictForDeltaTime( (int)entNum, timeDelta );
 
-	// paranoid debugging
-	//VectorSet( igridmins, 0, 0, 0 );VectorSet( igridmaxs, AREA_GRID, AREA_GRID, AREA_GRID );
-
-	numlist = 0;
-
-	// add entities not linked into areagrid because they are too big or
-	// outside the grid bounds
-	if( areagrid->outside.next ) {
-		grid = &areagrid->outside;
-		for( l = grid->next; l != grid; l = l->next ) {
-			clipEnt = GClip_GetClipEdictForDeltaTime( l->entNum, timeDelta );
-
-			if( areagrid->entmarknumber[l->entNum] == areagrid->marknumber ) {
-				continue;
-			}
-			areagrid->entmarknumber[l->entNum] = areagrid->marknumber;
-
-			if( !clipEnt->r.inuse ) {
-				continue; // deactivated
-			}
-			if( areatype == AREA_TRIGGERS && clipEnt->r.solid != SOLID_TRIGGER ) {
-				continue;
-			}
-			if( areatype == AREA_SOLID &&
-				( clipEnt->r.solid == SOLID_TRIGGER || clipEnt->r.solid == SOLID_NOT ) ) {
-				continue;
-			}
-
-			if( BoundsIntersect( paddedmins, paddedmaxs, clipEnt->r.absmin, clipEnt->r.absmax ) ) {
-				if( numlist < maxcount ) {
-					list[numlist] = l->entNum;
-				}
-				numlist++;
-			}
+		if( !clipEnt->r.inuse ) {
+			return true; // deactivated
+		}
+		if( areatype == AREA_TRIGGERS && clipEnt->r.solid != SOLID_TRIGGER ) {
+			return true;
+		}
+		if( areatype == AREA_SOLID &&
+			( clipEnt->r.solid == SOLID_TRIGGER || clipEnt->r.solid == SOLID_NOT ) ) {
+			return true;
 		}
-	}
-
-	// add grid linked entities
-	for( igrid[1] = igridmins[1]; igrid[1] < igridmaxs[1]; igrid[1]++ ) {
-		grid = areagrid->grid + igrid[1] * AREA_GRID + igridmins[0];
-
-		for( igrid[0] = igridmins[0]; igrid[0] < igridmaxs[0]; igrid[0]++, grid++ ) {
-			if( !grid->next ) {
-				continue;
-			}
-
-			for( l = grid->next; l != grid; l = l->next ) {
-				clipEnt = GClip_GetClipEdictForDeltaTime( l->entNum, timeDelta );
-
-				if( areagrid->entmarknumber[l->entNum] == areagrid->marknumber ) {
-					continue;
-				}
-				areagrid->entmarknumber[l->entNum] = areagrid->marknumber;
-
-				if( !clipEnt->r.inuse ) {
-					continue; // deactivated
-				}
-				if( areatype == AREA_TRIGGERS && clipEnt->r.solid != SOLID_TRIGGER ) {
-					continue;
-				}
-				if( areatype == AREA_SOLID &&
-					( clipEnt->r.solid == SOLID_TRIGGER || clipEnt->r.solid == SOLID_NOT ) ) {
-					continue;
-				}
 
-				if( BoundsIntersect( paddedmins, paddedmaxs, clipEnt->r.absmin, clipEnt->r.absmax ) ) {
-					if( numlist < maxcount ) {
-						list[numlist] = l->entNum;
-					}
-					numlist++;
-				}
+		// the tree stores fat bounds of current entities, test actual bounds (that could be backed up in time)
+		if( BoundsIntersect( mins, maxs, clipEnt->r.absmin, clipEnt->r.absmax ) ) {
+			if( numlist < maxcount ) {
+				list[numlist] = (int)entNum;
 			}
+			numlist++;
 		}
-	}
+		return true;
+	});
 
 	return numlist;
 }
@@ -472,28 +255,30 @@ static int GClip_EntitiesInBox_AreaGrid( areagrid_t *areagrid, const vec3_t mins
 * called after the world model has been loaded, before linking any entities
 */
 void GClip_ClearWorld( void ) {
-	vec3_t world_mins, world_maxs;
-	struct cmodel_s *world_model;
-
-	world_model = trap_CM_InlineModel( 0 );
-	trap_CM_InlineModelBounds( world_model, world_mins, world_maxs );
-
-	GClip_Init_AreaGrid( &g_areagrid, world_mins, world_maxs );
+	g_clipTree.clear();
 }
 
 /*
 * GClip_UnlinkEntity
 * call before removing an entity, and before trying to move one,
 * so it doesn't clip against itself
+*
+* The entity is kept in the tree but is skipped by queries,
+* so relinking it at a close position does not require modification of the tree.
 */
 void GClip_UnlinkEntity( edict_t *ent ) {
-	if( !ent->linked ) {
-		return; // not linked in anywhere
-	}
-	GClip_UnlinkEntity_AreaGrid( ent );
 	ent->linked = false;
 }
 
+/*
+* GClip_RemoveEntity
+* call for freed entities, removes them from the tree
+*/
+void GClip_RemoveEntity( edict_t *ent ) {
+	ent->linked = false;
+	g_clipTree.unlink( NUM_FOR_EDICT( ent ) );
+}
+
 /*
 * GClip_LinkEntity
 * Needs to be called any time an entity changes origin, mins, maxs,
@@ -518,6 +303,7 @@ void GClip_LinkEntity( edict_t *ent ) {
 
 	}
 	if( !ent->r.inuse ) {
+		GClip_RemoveEntity( ent );
 		return;
 	}
 
@@ -644,7 +430,14 @@ void GClip_LinkEntity( edict_t *ent ) {
 	ent->linkcount++;
 	ent->linked = true;
 
-	GClip_LinkEntity_AreaGrid( &g_areagrid, ent );
+	const int entNum = NUM_FOR_EDICT( ent );
+	if( entNum <= 0 || entNum >= game.maxentities || EDICT_NUM( entNum ) != ent ) {
+		Com_Printf( "GClip_LinkEntity: invalid edict %p (edicts is %p, edict number is %i)\n",
+					(void *)ent, (void *)game.edicts, entNum );
+		return;
+	}
+
+	g_clipTree.link( entNum, ent->r.absmin, ent->r.absmax );
 }
 
 /*
@@ -678,8 +471,7 @@ int GClip_AreaEdicts( const vec3_t mins, const vec3_t maxs,
 					  int *list, int maxcount, int areatype, int timeDelta ) {
 	int count;
 
-	count = GClip_EntitiesInBox_AreaGrid( &g_areagrid, mins, maxs,
-										  list, maxcount, areatype, timeDelta );
+	count = GClip_EntitiesInBox( mins, maxs, list, maxcount, areatype, timeDelta );
 
 	return wsw::min( count, maxcount );
 }
@@ -549,6 +549,8 @@ void G_ClearSnap( void ) {
 * It's time to send a new snap, so set the world up for sending
 */
 void G_SnapFrame( void ) {
+	G_PROFILER_SCOPE( "G_SnapFrame" );
+
 	edict_t *ent;
 	game.realtime = trap_Milliseconds(); // level.time etc. might not be real time
 
@@ -887,12 +889,30 @@ void G_RunFrame( unsigned int msec, int64_t serverTime ) {
 	G_SpawnQueue_Think();
 
 	// run the world
-	G_asCallMapPreThink();
-	AI_CommonFrame();
-	G_RunClients();
-	G_RunEntities();
-	G_RunGametype();
+	{
+		G_PROFILER_SCOPE( "G_asCallMapPreThink" );
+		G_asCallMapPreThink();
+	}
+	{
+		G_PROFILER_SCOPE( "AI_CommonFrame" );
+		AI_CommonFrame();
+	}
+	{
+		G_PROFILER_SCOPE( "G_RunClients" );
+		G_RunClients();
+	}
+	{
+		G_PROFILER_SCOPE( "G_RunEntities" );
+		G_RunEntities();
+	}
+	{
+		G_PROFILER_SCOPE( "G_RunGametype" );
+		G_RunGametype();
+	}
 	G_RunCMBenchmark();
-	G_asCallMapPostThink();
+	{
+		G_PROFILER_SCOPE( "G_asCallMapPostThink" );
+		G_asCallMapPostThink();
+	}
 	GClip_BackUpCollisionFrame();
 }
@@ -519,6 +519,7 @@ void G_asInitGameModuleEngine( void );
 void G_asShutdownGameModuleEngine( void );
 void G_asGarbageCollect( bool force );
 void G_asDumpAPI_f( void );
+void G_asPrintCallStats_f( void );
 
 #define world   ( (edict_t *)game.edicts )
 
@@ -720,13 +721,6 @@ void SP_trigger_gravity( edict_t *ent );
 //
 // g_clip.c
 //
-#define MAX_ENT_AREAS 16
-
-typedef struct link_s {
-	struct link_s *prev, *next;
-	int entNum;
-} link_t;
-
 int G_PointContents( const vec3_t p );
 void G_Trace( trace_t *tr, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, const edict_t *passedict, int contentmask );
 int G_PointContents4D( const vec3_t p, int timeDelta );
@@ -740,6 +734,7 @@ void GClip_SetBrushModel( edict_t *ent, const char *name );
 void GClip_SetAreaPortalState( edict_t *ent, bool open );
 void GClip_LinkEntity( edict_t *ent );
 void GClip_UnlinkEntity( edict_t *ent );
+void GClip_RemoveEntity( edict_t *ent );
 void GClip_TouchTriggers( edict_t *ent );
 void G_PMoveTouchTriggers( pmove_t *pm, const vec3_t previous_origin );
 entity_state_t *G_GetEntityStateForDeltaTime( int entNum, int deltaTime );
@@ -1476,9 +1471,6 @@ struct edict_s {
 
 	int linkcount;
 
-	// physics grid areas this edict is linked into
-	link_t areagrid[MAX_ENT_AREAS];
-
 	entity_state_t olds; // state in the last sent frame snap
 
 	int movetype;
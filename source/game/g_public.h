@@ -20,7 +20,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 // g_public.h -- game dll information visible to server
 
-#define GAME_API_VERSION    81
+#define GAME_API_VERSION    82
 
 //===============================================================
 
@@ -209,6 +209,11 @@ typedef struct {
 	void ( *MM_DeleteQuery )( class QueryObject *query );
 	bool ( *MM_SendQuery )( class QueryObject *query );
 	void ( *MM_EnqueueReport )( class QueryObject *query );
+
+	// hierarchical scopes of the server frame profiler
+	bool ( *Prof_IsEnabled )();
+	void ( *Prof_BeginScope )( const char *name );
+	void ( *Prof_EndScope )();
 } game_import_t;
 
 //
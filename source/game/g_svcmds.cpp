@@ -1291,6 +1291,7 @@ void G_AddServerCommands( void ) {
 #endif
 
 	trap_Cmd_AddCommand( "dumpASapi", G_asDumpAPI_f );
+	trap_Cmd_AddCommand( "listAScallstats", G_asPrintCallStats_f );
 
 	trap_Cmd_AddCommand( "listlocations", Cmd_ListLocations_f );
 }
@@ -1317,6 +1318,7 @@ void G_RemoveCommands( void ) {
 #endif
 
 	trap_Cmd_RemoveCommand( "dumpASapi" );
+	trap_Cmd_RemoveCommand( "listAScallstats" );
 
 	trap_Cmd_RemoveCommand( "listlocations" );
 }
@@ -315,3 +315,42 @@ inline void trap_MM_SendQuery( class QueryObject *query ) {
 inline void trap_MM_EnqueueReport( class QueryObject *matchReport ) {
 	GAME_IMPORT.MM_EnqueueReport( matchReport );
 }
+
+// Profiling
+
+static inline bool trap_Prof_IsEnabled() {
+	return GAME_IMPORT.Prof_IsEnabled();
+}
+
+static inline void trap_Prof_BeginScope( const char *name ) {
+	GAME_IMPORT.Prof_BeginScope( name );
+}
+
+static inline void trap_Prof_EndScope() {
+	GAME_IMPORT.Prof_EndScope();
+}
+
+/**
+ * A counterpart of {@code wsw::ProfilerScope} that goes through the game imports.
+ */
+class GProfilerScope {
+	const bool m_active;
+public:
+	explicit GProfilerScope( const char *name ) : m_active( trap_Prof_IsEnabled() ) {
+		if( m_active ) {
+			trap_Prof_BeginScope( name );
+		}
+	}
+	~GProfilerScope() {
+		if( m_active ) {
+			trap_Prof_EndScope();
+		}
+	}
+
+	GProfilerScope( const GProfilerScope & ) = delete;
+	auto operator=( const GProfilerScope & ) -> GProfilerScope & = delete;
+};
+
+#define G_PROFILER_CONCAT_( a, b ) a##b
+#define G_PROFILER_CONCAT( a, b ) G_PROFILER_CONCAT_( a, b )
+#define G_PROFILER_SCOPE( name ) const GProfilerScope G_PROFILER_CONCAT( gProfilerScope_, __LINE__ )( name )
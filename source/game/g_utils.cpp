@@ -378,7 +378,7 @@ float vectoyaw( vec3_t vec ) {
 void G_FreeEdict( edict_t *ed ) {
 	bool evt = ISEVENTENTITY( &ed->s );
 
-	GClip_UnlinkEntity( ed );   // unlink from world
+	GClip_RemoveEntity( ed );   // unlink from world
 
 	AI_RemoveNavEntity( ed );
 	G_FreeAI( ed );
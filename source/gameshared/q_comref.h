@@ -323,6 +323,12 @@ typedef enum {
 	WIRE_UBASE128				// base-128 encoded signed integer
 } wireType_t;
 
+// Parameters of the quantized encoding of entity positions
+typedef struct {
+	int mins[3];                        // positions are stored relative to these bounds
+	int numBits;                        // a number of bits of an absolute quantized position value
+} msg_quantization_t;
+
 //==============================================
 
 typedef struct entity_state_s {
@@ -1173,6 +1173,205 @@ void DualQuat_Lerp( const dualquat_t dq1, const dualquat_t dq2, vec_t t, dualqua
 	Quat_Normalize( &out[0] );
 }
 
+#ifdef WSW_USE_SSE2
+
+// Loads 4 dual quaternions transposing real and dual parts to the SoA layout (x, y, z, w rows)
+static inline void DualQuat_Load4( const float *dq0, const float *dq1, const float *dq2, const float *dq3,
+								   __m128 *real, __m128 *dual ) {
+	real[0] = _mm_loadu_ps( dq0 + 0 ), real[1] = _mm_loadu_ps( dq1 + 0 );
+	real[2] = _mm_loadu_ps( dq2 + 0 ), real[3] = _mm_loadu_ps( dq3 + 0 );
+	dual[0] = _mm_loadu_ps( dq0 + 4 ), dual[1] = _mm_loadu_ps( dq1 + 4 );
+	dual[2] = _mm_loadu_ps( dq2 + 4 ), dual[3] = _mm_loadu_ps( dq3 + 4 );
+	_MM_TRANSPOSE4_PS( real[0], real[1], real[2], real[3] );
+	_MM_TRANSPOSE4_PS( dual[0], dual[1], dual[2], dual[3] );
+}
+
+static inline void DualQuat_Store4( __m128 *real, __m128 *dual, float *dq0, float *dq1, float *dq2, float *dq3 ) {
+	_MM_TRANSPOSE4_PS( real[0], real[1], real[2], real[3] );
+	_MM_TRANSPOSE4_PS( dual[0], dual[1], dual[2], dual[3] );
+	_mm_storeu_ps( dq0 + 0, real[0] ), _mm_storeu_ps( dq1 + 0, real[1] );
+	_mm_storeu_ps( dq2 + 0, real[2] ), _mm_storeu_ps( dq3 + 0, real[3] );
+	_mm_storeu_ps( dq0 + 4, dual[0] ), _mm_storeu_ps( dq1 + 4, dual[1] );
+	_mm_storeu_ps( dq2 + 4, dual[2] ), _mm_storeu_ps( dq3 + 4, dual[3] );
+}
+
+// Keeps the order of operations of Quat_Multiply(). The output must not alias inputs.
+static inline void Quat_Multiply4( const __m128 *q1, const __m128 *q2, __m128 *out ) {
+	out[0] = _mm_add_ps( _mm_mul_ps( q1[3], q2[0] ), _mm_mul_ps( q1[0], q2[3] ) );
+	out[0] = _mm_sub_ps( _mm_add_ps( out[0], _mm_mul_ps( q1[1], q2[2] ) ), _mm_mul_ps( q1[2], q2[1] ) );
+	out[1] = _mm_add_ps( _mm_mul_ps( q1[3], q2[1] ), _mm_mul_ps( q1[1], q2[3] ) );
+	out[1] = _mm_sub_ps( _mm_add_ps( out[1], _mm_mul_ps( q1[2], q2[0] ) ), _mm_mul_ps( q1[0], q2[2] ) );
+	out[2] = _mm_add_ps( _mm_mul_ps( q1[3], q2[2] ), _mm_mul_ps( q1[2], q2[3] ) );
+	out[2] = _mm_sub_ps( _mm_add_ps( out[2], _mm_mul_ps( q1[0], q2[1] ) ), _mm_mul_ps( q1[1], q2[0] ) );
+	out[3] = _mm_sub_ps( _mm_mul_ps( q1[3], q2[3] ), _mm_mul_ps( q1[0], q2[0] ) );
+	out[3] = _mm_sub_ps( _mm_sub_ps( out[3], _mm_mul_ps( q1[1], q2[1] ) ), _mm_mul_ps( q1[2], q2[2] ) );
+}
+
+static inline void DualQuat_Multiply4( const __m128 *real1, const __m128 *dual1, const __m128 *real2,
+									   const __m128 *dual2, __m128 *outReal, __m128 *outDual ) {
+	__m128 tq1[4], tq2[4];
+	Quat_Multiply4( real1, dual2, tq1 );
+	Quat_Multiply4( dual1, real2, tq2 );
+	Quat_Multiply4( real1, real2, outReal );
+	for( unsigned i = 0; i < 4; ++i ) {
+		outDual[i] = _mm_add_ps( tq1[i], tq2[i] );
+	}
+}
+
+static inline auto Quat_SquareLength4( const __m128 *q ) -> __m128 {
+	const __m128 xy = _mm_add_ps( _mm_mul_ps( q[0], q[0] ), _mm_mul_ps( q[1], q[1] ) );
+	return _mm_add_ps( _mm_add_ps( xy, _mm_mul_ps( q[2], q[2] ) ), _mm_mul_ps( q[3], q[3] ) );
+}
+
+// Returns reciprocal lengths, or 1.0f for zero lengths (so the scaling is no-op like in Quat_Normalize())
+static inline auto Quat_RcpLength4( const __m128 *q ) -> __m128 {
+	const __m128 squareLength = Quat_SquareLength4( q );
+	const __m128 zeroMask     = _mm_cmpeq_ps( squareLength, _mm_setzero_ps() );
+	const __m128 rcpLength    = _mm_div_ps( _mm_set1_ps( 1.0f ), _mm_sqrt_ps( squareLength ) );
+	return _mm_or_ps( _mm_andnot_ps( zeroMask, rcpLength ), _mm_and_ps( zeroMask, _mm_set1_ps( 1.0f ) ) );
+}
+
+#endif
+
+void DualQuat_LerpMany( const dualquat_t *dq1, const dualquat_t *dq2, vec_t t, dualquat_t *out, unsigned count ) {
+	unsigned i = 0;
+#ifdef WSW_USE_SSE2
+	const __m128 xmmT           = _mm_set1_ps( t );
+	const __m128 xmmComplementT = _mm_set1_ps( 1.0f - t );
+	const __m128 xmmSignMask    = _mm_set1_ps( -0.0f );
+	for(; i + 4 <= count; i += 4 ) {
+		__m128 real1[4], dual1[4], real2[4], dual2[4];
+		DualQuat_Load4( dq1[i + 0], dq1[i + 1], dq1[i + 2], dq1[i + 3], real1, dual1 );
+		DualQuat_Load4( dq2[i + 0], dq2[i + 1], dq2[i + 2], dq2[i + 3], real2, dual2 );
+
+		// Take the shortest path like DualQuat_Lerp() does
+		__m128 dot = _mm_add_ps( _mm_mul_ps( real1[0], real2[0] ), _mm_mul_ps( real1[1], real2[1] ) );
+		dot = _mm_add_ps( _mm_add_ps( dot, _mm_mul_ps( real1[2], real2[2] ) ), _mm_mul_ps( real1[3], real2[3] ) );
+		const __m128 negativeDotMask = _mm_cmplt_ps( dot, _mm_setzero_ps() );
+		const __m128 k = _mm_xor_ps( xmmT, _mm_and_ps( negativeDotMask, xmmSignMask ) );
+
+		__m128 outReal[4], outDual[4];
+		for( unsigned j = 0; j < 4; ++j ) {
+			outReal[j] = _mm_add_ps( _mm_mul_ps( real1[j], xmmComplementT ), _mm_mul_ps( real2[j], k ) );
+			outDual[j] = _mm_add_ps( _mm_mul_ps( dual1[j], xmmComplementT ), _mm_mul_ps( dual2[j], k ) );
+		}
+
+		// Only the real part gets normalized, like in DualQuat_Lerp()
+		const __m128 rcpLength = Quat_RcpLength4( outReal );
+		for( unsigned j = 0; j < 4; ++j ) {
+			outReal[j] = _mm_mul_ps( outReal[j], rcpLength );
+		}
+
+		DualQuat_Store4( outReal, outDual, out[i + 0], out[i + 1], out[i + 2], out[i + 3] );
+	}
+#endif
+	for(; i < count; ++i ) {
+		DualQuat_Lerp( dq1[i], dq2[i], t, out[i] );
+	}
+}
+
+void DualQuat_MultiplyAndNormalizeMany( const dualquat_t *dq1, const dualquat_t *dq2, dualquat_t *out, unsigned count ) {
+	unsigned i = 0;
+#ifdef WSW_USE_SSE2
+	for(; i + 4 <= count; i += 4 ) {
+		__m128 real1[4], dual1[4], real2[4], dual2[4], outReal[4], outDual[4];
+		DualQuat_Load4( dq1[i + 0], dq1[i + 1], dq1[i + 2], dq1[i + 3], real1, dual1 );
+		DualQuat_Load4( dq2[i + 0], dq2[i + 1], dq2[i + 2], dq2[i + 3], real2, dual2 );
+		DualQuat_Multiply4( real1, dual1, real2, dual2, outReal, outDual );
+
+		const __m128 rcpLength = Quat_RcpLength4( outReal );
+		for( unsigned j = 0; j < 4; ++j ) {
+			outReal[j] = _mm_mul_ps( outReal[j], rcpLength );
+			outDual[j] = _mm_mul_ps( outDual[j], rcpLength );
+		}
+
+		DualQuat_Store4( outReal, outDual, out[i + 0], out[i + 1], out[i + 2], out[i + 3] );
+	}
+#endif
+	for(; i < count; ++i ) {
+		DualQuat_Multiply( dq1[i], dq2[i], out[i] );
+		DualQuat_Normalize( out[i] );
+	}
+}
+
+bool BoneHierarchyLevels::build( const int *parentsOfBones, unsigned numBones ) {
+	if( numBones > kMaxBones ) {
+		return false;
+	}
+
+	uint8_t depths[kMaxBones];
+	unsigned maxDepth = 0;
+	for( unsigned i = 0; i < numBones; ++i ) {
+		const int parent = parentsOfBones[i];
+		if( parent < 0 ) {
+			depths[i] = 0;
+		} else {
+			if( parent >= (int)i ) {
+				return false;
+			}
+			depths[i] = depths[parent] + 1;
+			maxDepth  = wsw::max<unsigned>( maxDepth, depths[i] );
+		}
+	}
+
+	numLevels = numBones ? maxDepth + 1 : 0;
+
+	// Perform a counting sort by depth, so the natural order is retained within a level
+	std::fill( levelOffsets, levelOffsets + numLevels + 1, 0 );
+	for( unsigned i = 0; i < numBones; ++i ) {
+		levelOffsets[depths[i] + 1]++;
+	}
+	for( unsigned levelNum = 0; levelNum < numLevels; ++levelNum ) {
+		levelOffsets[levelNum + 1] += levelOffsets[levelNum];
+	}
+
+	uint16_t cursors[kMaxBones];
+	std::copy( levelOffsets, levelOffsets + numLevels, cursors );
+	for( unsigned i = 0; i < numBones; ++i ) {
+		const unsigned index = cursors[depths[i]]++;
+		bones[index]   = (uint8_t)i;
+		parents[index] = (uint8_t)wsw::max( 0, parentsOfBones[i] );
+	}
+
+	return true;
+}
+
+void DualQuat_TransformHierarchy( const BoneHierarchyLevels *levels, const dualquat_t *in, dualquat_t *out ) {
+	if( !levels->numLevels ) {
+		return;
+	}
+
+	const uint8_t *const bones   = levels->bones;
+	const uint8_t *const parents = levels->parents;
+	if( in != out ) {
+		for( unsigned i = levels->levelOffsets[0]; i < levels->levelOffsets[1]; ++i ) {
+			DualQuat_Copy( in[bones[i]], out[bones[i]] );
+		}
+	}
+
+	// Parents of bones of a level belong to previous levels, so they are already transformed
+	for( unsigned levelNum = 1; levelNum < levels->numLevels; ++levelNum ) {
+		unsigned i = levels->levelOffsets[levelNum];
+		const unsigned levelEnd = levels->levelOffsets[levelNum + 1];
+#ifdef WSW_USE_SSE2
+		for(; i + 4 <= levelEnd; i += 4 ) {
+			__m128 parentReal[4], parentDual[4], boneReal[4], boneDual[4], outReal[4], outDual[4];
+			DualQuat_Load4( out[parents[i + 0]], out[parents[i + 1]], out[parents[i + 2]], out[parents[i + 3]],
+							parentReal, parentDual );
+			DualQuat_Load4( in[bones[i + 0]], in[bones[i + 1]], in[bones[i + 2]], in[bones[i + 3]], boneReal, boneDual );
+			DualQuat_Multiply4( parentReal, parentDual, boneReal, boneDual, outReal, outDual );
+			DualQuat_Store4( outReal, outDual, out[bones[i + 0]], out[bones[i + 1]], out[bones[i + 2]], out[bones[i + 3]] );
+		}
+#endif
+		for(; i < levelEnd; ++i ) {
+			// The input may be aliased by the output
+			dualquat_t tmp;
+			DualQuat_Copy( in[bones[i]], tmp );
+			DualQuat_Multiply( out[parents[i]], tmp, out[bones[i]] );
+		}
+	}
+}
+
 /*
  * Distribution functions
  * Standard distribution is expected with mean=0, deviation=1
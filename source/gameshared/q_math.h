@@ -873,6 +873,47 @@ vec_t DualQuat_Normalize( dualquat_t dq );
 void DualQuat_Multiply( const dualquat_t dq1, const dualquat_t dq2, dualquat_t out );
 void DualQuat_Lerp( const dualquat_t dq1, const dualquat_t dq2, vec_t t, dualquat_t out );
 
+// Batched versions of dual quaternion routines. Results match ones of scalar routines up to rounding errors.
+
+/**
+ * Interpolates arrays of dual quaternions like {@code DualQuat_Lerp()} does for every element.
+ */
+void DualQuat_LerpMany( const dualquat_t *dq1, const dualquat_t *dq2, vec_t t, dualquat_t *out, unsigned count );
+
+/**
+ * Multiplies arrays of dual quaternions like {@code DualQuat_Multiply()} followed by {@code DualQuat_Normalize()}.
+ */
+void DualQuat_MultiplyAndNormalizeMany( const dualquat_t *dq1, const dualquat_t *dq2, dualquat_t *out, unsigned count );
+
+/**
+ * Bones of a skeleton grouped by their depth in the hierarchy.
+ * Bones of the same level do not depend on each other, so they can be transformed in batches.
+ */
+struct BoneHierarchyLevels {
+	static constexpr unsigned kMaxBones = 256;
+
+	// Numbers of bones and their parents ordered by levels
+	uint8_t bones[kMaxBones];
+	uint8_t parents[kMaxBones];
+	// Offsets of levels in bones/parents arrays, the last one is the total number of bones
+	uint16_t levelOffsets[kMaxBones + 1];
+	unsigned numLevels;
+
+	/**
+	 * @param parentsOfBones parents of bones (negative for roots). A parent must precede its children.
+	 * @return false if there are too many bones or the order of bones is illegal.
+	 */
+	[[nodiscard]]
+	bool build( const int *parentsOfBones, unsigned numBones );
+};
+
+/**
+ * Transforms dual quaternions of bones to the model space (out[bone] = out[parent] * in[bone]).
+ * This is equivalent to transforming bones one by one in their natural order.
+ * @note in and out may be the same array.
+ */
+void DualQuat_TransformHierarchy( const BoneHierarchyLevels *levels, const dualquat_t *in, dualquat_t *out );
+
 vec_t LogisticCDF( vec_t x );
 vec_t LogisticPDF( vec_t x );
 vec_t NormalCDF( vec_t x );
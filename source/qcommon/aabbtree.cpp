@@ -0,0 +1,391 @@
+#include "aabbtree.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace wsw {
+
+// Moving objects get their fat boxes extended by this multiple of the displacement
+static constexpr float kDisplacementMultiplier = 4.0f;
+// Larger displacements are considered to be teleportations and are not used for extension of boxes
+static constexpr float kMaxPredictedDisplacement = 128.0f;
+
+[[nodiscard]]
+static inline float surfaceCost( const float *mins, const float *maxs ) {
+	const float dx = maxs[0] - mins[0], dy = maxs[1] - mins[1], dz = maxs[2] - mins[2];
+	// A half of the surface area is sufficient for comparisons
+	return dx * dy + dy * dz + dz * dx;
+}
+
+[[nodiscard]]
+static inline float unionCost( const float *mins1, const float *maxs1, const float *mins2, const float *maxs2 ) {
+	float mins[3], maxs[3];
+	for( int i = 0; i < 3; ++i ) {
+		mins[i] = std::min( mins1[i], mins2[i] );
+		maxs[i] = std::max( maxs1[i], maxs2[i] );
+	}
+	return surfaceCost( mins, maxs );
+}
+
+AabbTree::AabbTree( unsigned maxObjects, float fatMargin ) : m_fatMargin( fatMargin ) {
+	// A binary tree with N leaves has N - 1 internal nodes
+	m_nodes.resize( maxObjects ? 2 * maxObjects - 1 : 1 );
+	m_leafOfObject.resize( maxObjects );
+	m_lastCenterOfObject.resize( maxObjects );
+	clear();
+}
+
+void AabbTree::clear() {
+	for( size_t i = 0; i < m_nodes.size(); ++i ) {
+		m_nodes[i].parent = (int32_t)( i + 1 );
+		m_nodes[i].height = -1;
+	}
+	m_nodes.back().parent = kNullNode;
+	m_freeList = 0;
+	m_root = kNullNode;
+	m_numObjects = 0;
+	std::fill( m_leafOfObject.begin(), m_leafOfObject.end(), kNullNode );
+}
+
+auto AabbTree::allocNode() -> int32_t {
+	// The capacity is sufficient for the maximal number of objects
+	assert( m_freeList != kNullNode );
+	const int32_t nodeIndex = m_freeList;
+	Node &node = m_nodes[nodeIndex];
+	m_freeList = node.parent;
+	node.parent = kNullNode;
+	node.child1 = kNullNode;
+	node.child2 = kNullNode;
+	node.height = 0;
+	node.id = -1;
+	return nodeIndex;
+}
+
+void AabbTree::freeNode( int32_t nodeIndex ) {
+	Node &node = m_nodes[nodeIndex];
+	node.parent = m_freeList;
+	node.height = -1;
+	m_freeList = nodeIndex;
+}
+
+bool AabbTree::link( unsigned id, const float *mins, const float *maxs ) {
+	assert( id < m_leafOfObject.size() );
+
+	float center[3], displacement[3] { 0.0f, 0.0f, 0.0f };
+	for( int i = 0; i < 3; ++i ) {
+		center[i] = 0.5f * ( mins[i] + maxs[i] );
+	}
+
+	int32_t leaf = m_leafOfObject[id];
+	if( leaf != kNullNode ) {
+		float *const lastCenter = m_lastCenterOfObject[id].data();
+		for( int i = 0; i < 3; ++i ) {
+			displacement[i] = center[i] - lastCenter[i];
+			lastCenter[i] = center[i];
+		}
+		if( m_nodes[leaf].contains( mins, maxs ) ) {
+			return false;
+		}
+		if( std::fabs( displacement[0] ) + std::fabs( displacement[1] ) + std::fabs( displacement[2] ) > kMaxPredictedDisplacement ) {
+			displacement[0] = displacement[1] = displacement[2] = 0.0f;
+		}
+		removeLeaf( leaf );
+	} else {
+		leaf = allocNode();
+		m_nodes[leaf].id = (int32_t)id;
+		m_leafOfObject[id] = leaf;
+		m_numObjects++;
+		std::copy( center, center + 3, m_lastCenterOfObject[id].data() );
+	}
+
+	Node &node = m_nodes[leaf];
+	for( int i = 0; i < 3; ++i ) {
+		node.mins[i] = mins[i] - m_fatMargin;
+		node.maxs[i] = maxs[i] + m_fatMargin;
+		// Predict further movement
+		const float extension = kDisplacementMultiplier * displacement[i];
+		if( extension < 0.0f ) {
+			node.mins[i] += extension;
+		} else {
+			node.maxs[i] += extension;
+		}
+	}
+
+	insertLeaf( leaf );
+	return true;
+}
+
+void AabbTree::unlink( unsigned id ) {
+	assert( id < m_leafOfObject.size() );
+	if( const int32_t leaf = m_leafOfObject[id]; leaf != kNullNode ) {
+		removeLeaf( leaf );
+		freeNode( leaf );
+		m_leafOfObject[id] = kNullNode;
+		m_numObjects--;
+	}
+}
+
+auto AabbTree::query( const float *mins, const float *maxs, int *list, int maxCount ) const -> int {
+	int count = 0;
+	query( mins, maxs, [&]( unsigned id ) {
+		if( count < maxCount ) {
+			list[count] = (int)id;
+		}
+		count++;
+		return true;
+	});
+	return count;
+}
+
+void AabbTree::setUnion( Node *node, const Node &a, const Node &b ) {
+	for( int i = 0; i < 3; ++i ) {
+		node->mins[i] = std::min( a.mins[i], b.mins[i] );
+		node->maxs[i] = std::max( a.maxs[i], b.maxs[i] );
+	}
+}
+
+void AabbTree::insertLeaf( int32_t leaf ) {
+	if( m_root == kNullNode ) {
+		m_root = leaf;
+		m_nodes[leaf].parent = kNullNode;
+		return;
+	}
+
+	// Find the best sibling using the surface area heuristic
+	const Node &leafNode = m_nodes[leaf];
+	int32_t sibling = m_root;
+	while( !m_nodes[sibling].isLeaf() ) {
+		const Node &node = m_nodes[sibling];
+		const float area = surfaceCost( node.mins, node.maxs );
+		const float combinedArea = unionCost( node.mins, node.maxs, leafNode.mins, leafNode.maxs );
+
+		// The cost of creating a new parent for this node and the new leaf
+		const float cost = 2.0f * combinedArea;
+		// The minimum cost of pushing the leaf further down the tree
+		const float inheritanceCost = 2.0f * ( combinedArea - area );
+
+		float childCosts[2];
+		const int32_t children[2] { node.child1, node.child2 };
+		for( int i = 0; i < 2; ++i ) {
+			const Node &child = m_nodes[children[i]];
+			childCosts[i] = unionCost( child.mins, child.maxs, leafNode.mins, leafNode.maxs ) + inheritanceCost;
+			if( !child.isLeaf() ) {
+				childCosts[i] -= surfaceCost( child.mins, child.maxs );
+			}
+		}
+
+		if( cost < childCosts[0] && cost < childCosts[1] ) {
+			break;
+		}
+
+		sibling = childCosts[0] < childCosts[1] ? children[0] : children[1];
+	}
+
+	const int32_t oldParent = m_nodes[sibling].parent;
+	const int32_t newParent = allocNode();
+	Node &newParentNode = m_nodes[newParent];
+	newParentNode.parent = oldParent;
+	newParentNode.height = m_nodes[sibling].height + 1;
+	newParentNode.child1 = sibling;
+	newParentNode.child2 = leaf;
+	setUnion( &newParentNode, m_nodes[sibling], m_nodes[leaf] );
+
+	if( oldParent != kNullNode ) {
+		Node &oldParentNode = m_nodes[oldParent];
+		if( oldParentNode.child1 == sibling ) {
+			oldParentNode.child1 = newParent;
+		} else {
+			oldParentNode.child2 = newParent;
+		}
+	} else {
+		m_root = newParent;
+	}
+
+	m_nodes[sibling].parent = newParent;
+	m_nodes[leaf].parent = newParent;
+
+	refitAncestors( newParent );
+}
+
+void AabbTree::removeLeaf( int32_t leaf ) {
+	if( leaf == m_root ) {
+		m_root = kNullNode;
+		return;
+	}
+
+	const int32_t parent = m_nodes[leaf].parent;
+	const int32_t grandParent = m_nodes[parent].parent;
+	const int32_t sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+	if( grandParent != kNullNode ) {
+		Node &grandParentNode = m_nodes[grandParent];
+		if( grandParentNode.child1 == parent ) {
+			grandParentNode.child1 = sibling;
+		} else {
+			grandParentNode.child2 = sibling;
+		}
+		m_nodes[sibling].parent = grandParent;
+		freeNode( parent );
+		refitAncestors( grandParent );
+	} else {
+		m_root = sibling;
+		m_nodes[sibling].parent = kNullNode;
+		freeNode( parent );
+	}
+}
+
+void AabbTree::refitAncestors( int32_t nodeIndex ) {
+	while( nodeIndex != kNullNode ) {
+		nodeIndex = balance( nodeIndex );
+
+		Node &node = m_nodes[nodeIndex];
+		const Node &child1 = m_nodes[node.child1];
+		const Node &child2 = m_nodes[node.child2];
+		node.height = 1 + std::max( child1.height, child2.height );
+		setUnion( &node, child1, child2 );
+
+		nodeIndex = node.parent;
+	}
+}
+
+auto AabbTree::balance( int32_t indexA ) -> int32_t {
+	Node &a = m_nodes[indexA];
+	if( a.isLeaf() || a.height < 2 ) {
+		return indexA;
+	}
+
+	const int32_t indexB = a.child1;
+	const int32_t indexC = a.child2;
+	Node &b = m_nodes[indexB];
+	Node &c = m_nodes[indexC];
+
+	const int32_t heightDifference = c.height - b.height;
+	if( heightDifference > 1 ) {
+		// Rotate C up
+		const int32_t indexF = c.child1;
+		const int32_t indexG = c.child2;
+		Node &f = m_nodes[indexF];
+		Node &g = m_nodes[indexG];
+
+		c.child1 = indexA;
+		c.parent = a.parent;
+		a.parent = indexC;
+
+		if( c.parent != kNullNode ) {
+			Node &parent = m_nodes[c.parent];
+			if( parent.child1 == indexA ) {
+				parent.child1 = indexC;
+			} else {
+				parent.child2 = indexC;
+			}
+		} else {
+			m_root = indexC;
+		}
+
+		if( f.height > g.height ) {
+			c.child2 = indexF;
+			a.child2 = indexG;
+			g.parent = indexA;
+			setUnion( &a, b, g );
+			setUnion( &c, a, f );
+			a.height = 1 + std::max( b.height, g.height );
+			c.height = 1 + std::max( a.height, f.height );
+		} else {
+			c.child2 = indexG;
+			a.child2 = indexF;
+			f.parent = indexA;
+			setUnion( &a, b, f );
+			setUnion( &c, a, g );
+			a.height = 1 + std::max( b.height, f.height );
+			c.height = 1 + std::max( a.height, g.height );
+		}
+
+		return indexC;
+	}
+
+	if( heightDifference < -1 ) {
+		// Rotate B up
+		const int32_t indexD = b.child1;
+		const int32_t indexE = b.child2;
+		Node &d = m_nodes[indexD];
+		Node &e = m_nodes[indexE];
+
+		b.child1 = indexA;
+		b.parent = a.parent;
+		a.parent = indexB;
+
+		if( b.parent != kNullNode ) {
+			Node &parent = m_nodes[b.parent];
+			if( parent.child1 == indexA ) {
+				parent.child1 = indexB;
+			} else {
+				parent.child2 = indexB;
+			}
+		} else {
+			m_root = indexB;
+		}
+
+		if( d.height > e.height ) {
+			b.child2 = indexD;
+			a.child1 = indexE;
+			e.parent = indexA;
+			setUnion( &a, c, e );
+			setUnion( &b, a, d );
+			a.height = 1 + std::max( c.height, e.height );
+			b.height = 1 + std::max( a.height, d.height );
+		} else {
+			b.child2 = indexE;
+			a.child1 = indexD;
+			d.parent = indexA;
+			setUnion( &a, c, d );
+			setUnion( &b, a, e );
+			a.height = 1 + std::max( c.height, d.height );
+			b.height = 1 + std::max( a.height, e.height );
+		}
+
+		return indexB;
+	}
+
+	return indexA;
+}
+
+bool AabbTree::validate() const {
+	unsigned numLeaves = 0;
+	if( m_root != kNullNode && !validateNode( m_root, kNullNode, &numLeaves ) ) {
+		return false;
+	}
+	if( numLeaves != m_numObjects ) {
+		return false;
+	}
+	for( size_t id = 0; id < m_leafOfObject.size(); ++id ) {
+		const int32_t leaf = m_leafOfObject[id];
+		if( leaf != kNullNode && ( !m_nodes[leaf].isLeaf() || m_nodes[leaf].id != (int32_t)id ) ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool AabbTree::validateNode( int32_t nodeIndex, int32_t parent, unsigned *numLeaves ) const {
+	const Node &node = m_nodes[nodeIndex];
+	if( node.parent != parent || node.height < 0 ) {
+		return false;
+	}
+	if( node.isLeaf() ) {
+		( *numLeaves )++;
+		return node.height == 0 && node.id >= 0 && m_leafOfObject[node.id] == nodeIndex;
+	}
+
+	const Node &child1 = m_nodes[node.child1];
+	const Node &child2 = m_nodes[node.child2];
+	if( node.height != 1 + std::max( child1.height, child2.height ) ) {
+		return false;
+	}
+	if( !node.contains( child1.mins, child1.maxs ) || !node.contains( child2.mins, child2.maxs ) ) {
+		return false;
+	}
+
+	return validateNode( node.child1, nodeIndex, numLeaves ) && validateNode( node.child2, nodeIndex, numLeaves );
+}
+
+}
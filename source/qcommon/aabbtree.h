@@ -0,0 +1,142 @@
+#ifndef WSW_e74fd40f_0c2d_4126_88a1_be43660889b3_H
+#define WSW_e74fd40f_0c2d_4126_88a1_be43660889b3_H
+
+#include "wswvector.h"
+
+#include <array>
+#include <cstdint>
+#include <cassert>
+
+namespace wsw {
+
+/**
+ * A dynamic bounding volume hierarchy of axis-aligned boxes of objects identified by small integer ids.
+ * Leaves store "fat" boxes that enclose actual bounds with some margin (extended in the direction of movement),
+ * so objects that move a bit do not require modification of the tree.
+ * If an object leaves its fat box, the leaf is reinserted and ancestors get refitted and rebalanced.
+ * Nodes are stored in a single contiguous array and are addressed by indices.
+ */
+class AabbTree {
+public:
+	/**
+	 * @param maxObjects a maximal number of objects (ids must be less than this value).
+	 * @param fatMargin an expansion of actual bounds of objects in every direction.
+	 */
+	explicit AabbTree( unsigned maxObjects, float fatMargin = 8.0f );
+
+	/**
+	 * Adds the object to the tree or updates bounds of an already added object.
+	 * @return true if the tree has been modified (the object was outside of its fat box).
+	 */
+	bool link( unsigned id, const float *mins, const float *maxs );
+	void unlink( unsigned id );
+	void clear();
+
+	[[nodiscard]]
+	bool isLinked( unsigned id ) const {
+		assert( id < m_leafOfObject.size() );
+		return m_leafOfObject[id] != kNullNode;
+	}
+
+	/**
+	 * Calls the callback for every object which fat box intersects the given bounds.
+	 * The callback should return false to interrupt the query.
+	 */
+	template <typename Callback>
+	void query( const float *mins, const float *maxs, Callback &&callback ) const {
+		if( m_root == kNullNode ) {
+			return;
+		}
+
+		int32_t stack[kMaxStackDepth];
+		int stackSize = 0;
+		stack[stackSize++] = m_root;
+		do {
+			const Node &node = m_nodes[stack[--stackSize]];
+			if( !node.intersects( mins, maxs ) ) {
+				continue;
+			}
+			if( node.isLeaf() ) {
+				if( !callback( (unsigned)node.id ) ) {
+					return;
+				}
+			} else {
+				assert( stackSize + 2 <= kMaxStackDepth );
+				stack[stackSize++] = node.child2;
+				stack[stackSize++] = node.child1;
+			}
+		} while( stackSize );
+	}
+
+	/**
+	 * Collects ids of objects which fat boxes intersect the given bounds.
+	 * @return the number of found objects (this could be greater than the list capacity).
+	 */
+	[[nodiscard]]
+	auto query( const float *mins, const float *maxs, int *list, int maxCount ) const -> int;
+
+	[[nodiscard]]
+	auto height() const -> int { return m_root != kNullNode ? m_nodes[m_root].height : 0; }
+	[[nodiscard]]
+	auto numObjects() const -> unsigned { return m_numObjects; }
+
+	//! Checks structural invariants (for debugging and tests).
+	[[nodiscard]]
+	bool validate() const;
+private:
+	static constexpr int32_t kNullNode = -1;
+	// The tree is balanced, so this is sufficient for any reasonable number of objects
+	static constexpr int kMaxStackDepth = 256;
+
+	struct Node {
+		float mins[3];
+		float maxs[3];
+		int32_t parent;     // or the next free node
+		int32_t child1;
+		int32_t child2;
+		int32_t height;     // zero for leaves, -1 for free nodes
+		int32_t id;
+
+		[[nodiscard]]
+		bool isLeaf() const { return child1 == kNullNode; }
+
+		[[nodiscard]]
+		bool intersects( const float *mins_, const float *maxs_ ) const {
+			return mins[0] <= maxs_[0] && mins[1] <= maxs_[1] && mins[2] <= maxs_[2] &&
+				   maxs[0] >= mins_[0] && maxs[1] >= mins_[1] && maxs[2] >= mins_[2];
+		}
+
+		[[nodiscard]]
+		bool contains( const float *mins_, const float *maxs_ ) const {
+			return mins[0] <= mins_[0] && mins[1] <= mins_[1] && mins[2] <= mins_[2] &&
+				   maxs[0] >= maxs_[0] && maxs[1] >= maxs_[1] && maxs[2] >= maxs_[2];
+		}
+	};
+
+	wsw::Vector<Node> m_nodes;
+	wsw::Vector<int32_t> m_leafOfObject;
+	// Centers of actual bounds that were supplied by the last link() call
+	wsw::Vector<std::array<float, 3>> m_lastCenterOfObject;
+	int32_t m_root { kNullNode };
+	int32_t m_freeList { kNullNode };
+	unsigned m_numObjects { 0 };
+	const float m_fatMargin;
+
+	[[nodiscard]]
+	auto allocNode() -> int32_t;
+	void freeNode( int32_t nodeIndex );
+
+	void insertLeaf( int32_t leaf );
+	void removeLeaf( int32_t leaf );
+	[[nodiscard]]
+	auto balance( int32_t nodeIndex ) -> int32_t;
+	void refitAncestors( int32_t nodeIndex );
+	void setUnion( Node *node, const Node &a, const Node &b );
+
+	[[nodiscard]]
+	bool validateNode( int32_t nodeIndex, int32_t parent, unsigned *numLeaves ) const;
+};
+
+}
+
+#endif
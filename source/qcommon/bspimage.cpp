@@ -0,0 +1,85 @@
+#include "bspimage.h"
+#include "qcommon.h"
+#include "md5.h"
+#include "wswvector.h"
+
+#include <algorithm>
+#include <mutex>
+
+namespace wsw::bsp {
+
+// Images are acquired by the server and the client (that could run in different threads)
+static std::mutex g_mapImagesMutex;
+static wsw::Vector<MapImage *> g_mapImages;
+
+auto MapImage::acquire( const char *name ) -> MapImage * {
+	[[maybe_unused]] std::lock_guard<std::mutex> lock( g_mapImagesMutex );
+
+	for( MapImage *image: g_mapImages ) {
+		if( !Q_stricmp( image->m_name, name ) ) {
+			image->m_refCount++;
+			return image;
+		}
+	}
+
+	int file = 0;
+	const int length = FS_FOpenFile( name, &file, FS_READ );
+	if( !file ) {
+		return nullptr;
+	}
+	if( length <= 0 ) {
+		FS_FCloseFile( file );
+		return nullptr;
+	}
+
+	auto *const image = new MapImage;
+	size_t mappedSize = 0;
+	if( void *mappedData = FS_MMapFile( file, &mappedSize ) ) {
+		image->m_data = (const uint8_t *)mappedData;
+		image->m_size = mappedSize;
+		// The file should be kept open as long as it's mapped
+		image->m_mappedFile = file;
+	} else {
+		auto *const buffer = (uint8_t *)Q_malloc( length + 1 );
+		const int numRead = FS_Read( buffer, length, file );
+		FS_FCloseFile( file );
+		if( numRead != length ) {
+			Q_free( buffer );
+			delete image;
+			return nullptr;
+		}
+		buffer[length] = '\0';
+		image->m_data = buffer;
+		image->m_size = length;
+	}
+
+	image->m_name = Q_strdup( name );
+	image->m_checksum = md5_digest32( image->m_data, (int)image->m_size );
+	image->m_refCount = 1;
+	g_mapImages.push_back( image );
+
+	Com_DPrintf( "Loaded a map image for %s (%s)\n", name, image->isMapped() ? "mapped" : "in memory" );
+	return image;
+}
+
+void MapImage::release( MapImage *image ) {
+	[[maybe_unused]] std::lock_guard<std::mutex> lock( g_mapImagesMutex );
+
+	assert( image->m_refCount > 0 );
+	if( --image->m_refCount ) {
+		return;
+	}
+
+	if( image->m_mappedFile ) {
+		FS_UnMMapBaseFile( image->m_mappedFile, (void *)image->m_data );
+		FS_FCloseFile( image->m_mappedFile );
+	} else {
+		Q_free( (void *)image->m_data );
+	}
+
+	g_mapImages.erase( std::find( g_mapImages.begin(), g_mapImages.end(), image ) );
+	Q_free( image->m_name );
+	delete image;
+}
+
+}
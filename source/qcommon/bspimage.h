@@ -0,0 +1,58 @@
+#ifndef WSW_233c2ddb_95ab_43f6_9d20_d7a8a71d17ef_H
+#define WSW_233c2ddb_95ab_43f6_9d20_d7a8a71d17ef_H
+
+#include <cstdint>
+#include <cstddef>
+
+namespace wsw::bsp {
+
+/**
+ * A read-only image of a map file that is shared by all consumers within the process
+ * (collision models of the server and the client, the renderer).
+ * The file gets memory-mapped if it's a regular file or a pak entry that is stored without compression,
+ * otherwise it gets loaded into memory.
+ * Consumers may refer to lumps of the image directly as long as they hold a reference.
+ * Data of the image must not be modified.
+ */
+class MapImage {
+public:
+	/**
+	 * Returns an image for the given file name, loading it if there's no image in use for this name.
+	 * @return a new reference to the image or null on failure.
+	 */
+	[[nodiscard]]
+	static auto acquire( const char *name ) -> MapImage *;
+	//! Releases the reference, the image gets destroyed once the last reference is released.
+	static void release( MapImage *image );
+
+	[[nodiscard]]
+	auto data() const -> const uint8_t * { return m_data; }
+	[[nodiscard]]
+	auto size() const -> size_t { return m_size; }
+	[[nodiscard]]
+	auto checksum() const -> unsigned { return m_checksum; }
+	[[nodiscard]]
+	bool isMapped() const { return m_mappedFile != 0; }
+
+	/**
+	 * Checks whether the lump could be referred directly as an array of the given alignment.
+	 * @note Lumps are stored in the little-endian order.
+	 */
+	[[nodiscard]]
+	bool isLumpAligned( int fileofs, size_t alignment ) const {
+		return ( (uintptr_t)( m_data + fileofs ) % alignment ) == 0;
+	}
+private:
+	MapImage() = default;
+
+	char *m_name { nullptr };
+	const uint8_t *m_data { nullptr };
+	size_t m_size { 0 };
+	unsigned m_checksum { 0 };
+	unsigned m_refCount { 0 };
+	int m_mappedFile { 0 };
+};
+
+}
+
+#endif
@@ -18,6 +18,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 */
 
+namespace wsw::bsp { class MapImage; }
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -187,6 +189,7 @@ struct cmodel_state_s {
 
 	dvis_t *map_pvs, *map_phs;
 	int map_visdatasize;
+	bool map_pvs_is_shared;         // refers to the map image directly
 
 	uint8_t nullrow[MAX_CM_LEAFS / 8];
 
@@ -197,6 +200,8 @@ struct cmodel_state_s {
 	int floodvalid;
 
 	uint8_t *cmod_base;
+	// the map file contents, kept as long as the map is loaded
+	wsw::bsp::MapImage *map_image;
 
 	// cm_trace.c
 	cbrushside_t box_brushsides[6];
@@ -209,11 +214,6 @@ struct cmodel_state_s {
 	cbrush_t *oct_markbrushes[1];
 	cmodel_t oct_cmodel[1];
 
-	mutable int leaf_count, leaf_maxcount;
-	mutable int *leaf_list;
-	mutable const float *leaf_mins, *leaf_maxs;
-	mutable int leaf_topnode;
-
 	struct Ops *ops;
 };
 
@@ -21,7 +21,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "qcommon.h"
 #include "cm_local.h"
-#include "md5.h"
+#include "bspimage.h"
 
 static bool cm_initialized = false;
 
@@ -167,8 +167,11 @@ static void CM_Clear( cmodel_state_t *cms ) {
 	}
 
 	if( cms->map_pvs ) {
-		Q_free( cms->map_pvs );
+		if( !cms->map_pvs_is_shared ) {
+			Q_free( cms->map_pvs );
+		}
 		cms->map_pvs = NULL;
+		cms->map_pvs_is_shared = false;
 	}
 
 	if( cms->map_entitystring != &cms->map_entitystring_empty ) {
@@ -176,6 +179,11 @@ static void CM_Clear( cmodel_state_t *cms ) {
 		cms->map_entitystring = &cms->map_entitystring_empty;
 	}
 
+	if( cms->map_image ) {
+		wsw::bsp::MapImage::release( cms->map_image );
+		cms->map_image = NULL;
+	}
+
 	cms->map_name[0] = 0;
 
 	ClearBounds( cms->world_mins, cms->world_maxs );
@@ -197,8 +205,7 @@ MAP LOADING
 *  CM_LoadMap( "", false, &checksum );	// no real map
 */
 cmodel_t *CM_LoadMap( cmodel_state_t *cms, const char *name, bool clientload, unsigned *checksum ) {
-	int length;
-	unsigned *buf;
+	const uint8_t *buf;
 	char *header;
 	const modelFormatDescr_t *descr;
 	bspFormatDesc_t *bspFormat = NULL;
@@ -230,16 +237,18 @@ cmodel_t *CM_LoadMap( cmodel_state_t *cms, const char *name, bool clientload, un
 	//
 	// load the file
 	//
-	length = FS_LoadFile( name, ( void ** )&buf, NULL, 0 );
-	if( !buf ) {
+	// the image is shared with other consumers of the map file (e.g. the server and the client on listen servers)
+	cms->map_image = wsw::bsp::MapImage::acquire( name );
+	if( !cms->map_image ) {
 		Com_Error( ERR_DROP, "Couldn't load %s", name );
 	}
 
-	cms->checksum = md5_digest32( ( const uint8_t * )buf, length );
+	buf = cms->map_image->data();
+	cms->checksum = cms->map_image->checksum();
 	*checksum = cms->checksum;
 
 	// call the apropriate loader
-	descr = Q_FindFormatDescriptor( cm_supportedformats, ( const uint8_t * )buf, (const bspFormatDesc_t **)&bspFormat );
+	descr = Q_FindFormatDescriptor( cm_supportedformats, buf, (const bspFormatDesc_t **)&bspFormat );
 	if( !descr ) {
 		Com_Error( ERR_DROP, "CM_LoadMap: unknown fileid for %s", name );
 	}
@@ -259,7 +268,7 @@ cmodel_t *CM_LoadMap( cmodel_state_t *cms, const char *name, bool clientload, un
 
 	Q_free( header );
 
-	descr->loader( cms, NULL, buf, bspFormat );
+	descr->loader( cms, NULL, (void *)buf, bspFormat );
 
 	CM_InitBoxHull( cms );
 	CM_InitOctagonHull( cms );
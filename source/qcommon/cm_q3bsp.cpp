@@ -21,6 +21,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "qcommon.h"
 #include "cm_local.h"
+#include "bspimage.h"
 #include "patch.h"
 #include "qfiles.h"
 #include "glob.h"
@@ -1014,8 +1015,18 @@ static void CMod_LoadVisibility( cmodel_state_t *cms, lump_t *l ) {
 		return;
 	}
 
+	// refer to the map image directly if the data is usable as-is
+	dvis_t *in = (dvis_t *)( cms->cmod_base + l->fileofs );
+	if( cms->map_image && cms->map_image->isLumpAligned( l->fileofs, alignof( dvis_t ) ) ) {
+		if( LittleLong( in->numclusters ) == in->numclusters && LittleLong( in->rowsize ) == in->rowsize ) {
+			cms->map_pvs = in;
+			cms->map_pvs_is_shared = true;
+			return;
+		}
+	}
+
 	cms->map_pvs = (dvis_t *)Q_malloc( cms->map_visdatasize );
-	memcpy( cms->map_pvs, cms->cmod_base + l->fileofs, cms->map_visdatasize );
+	memcpy( cms->map_pvs, in, cms->map_visdatasize );
 
 	cms->map_pvs->numclusters = LittleLong( cms->map_pvs->numclusters );
 	cms->map_pvs->rowsize = LittleLong( cms->map_pvs->rowsize );
@@ -1072,7 +1083,8 @@ void CM_LoadQ3BrushModel( cmodel_state_t *cms, void *parent, void *buf, bspForma
 	CMod_LoadVisibility( cms, &header.lumps[LUMP_VISIBILITY] );
 	CMod_LoadEntityString( cms, &header.lumps[LUMP_ENTITIES] );
 
-	FS_FreeFile( buf );
+	// the buffer is owned by the map image
+	cms->cmod_base = NULL;
 
 	// Free no longer needed data
 	if( cms->map_verts ) {
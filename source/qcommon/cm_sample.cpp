@@ -22,18 +22,26 @@ int CM_PointLeafnum( const cmodel_state_t *cms, const vec3_t p, int topNodeHint
 	return -1 - num;
 }
 
+// Keeps the state of a single CM_BoxLeafnums() call on the stack, so concurrent calls are safe
+typedef struct {
+	const float *mins, *maxs;
+	int *list;
+	int count, maxcount;
+	int topnode;
+} cm_boxleafnums_context_t;
+
 /*
 * CM_BoxLeafnums
 *
 * Fills in a list of all the leafs touched
 */
-static void CM_BoxLeafnums_r( const cmodel_state_t *cms, int nodenum ) {
+static void CM_BoxLeafnums_r( const cmodel_state_t *cms, cm_boxleafnums_context_t *ctx, int nodenum ) {
 	int s;
 	cnode_t *node;
 
 	while( nodenum >= 0 ) {
 		node = &cms->map_nodes[nodenum];
-		s = BOX_ON_PLANE_SIDE( cms->leaf_mins, cms->leaf_maxs, node->plane ) - 1;
+		s = BOX_ON_PLANE_SIDE( ctx->mins, ctx->maxs, node->plane ) - 1;
 
 		if( s < 2 ) {
 			nodenum = node->children[s];
@@ -41,15 +49,15 @@ static void CM_BoxLeafnums_r( const cmodel_state_t *cms, int nodenum ) {
 		}
 
 		// go down both sides
-		if( cms->leaf_topnode == -1 ) {
-			cms->leaf_topnode = nodenum;
+		if( ctx->topnode == -1 ) {
+			ctx->topnode = nodenum;
 		}
-		CM_BoxLeafnums_r( cms, node->children[0] );
+		CM_BoxLeafnums_r( cms, ctx, node->children[0] );
 		nodenum = node->children[1];
 	}
 
-	if( cms->leaf_count < cms->leaf_maxcount ) {
-		cms->leaf_list[cms->leaf_count++] = -1 - nodenum;
+	if( ctx->count < ctx->maxcount ) {
+		ctx->list[ctx->count++] = -1 - nodenum;
 	}
 }
 
@@ -62,24 +70,24 @@ int CM_BoxLeafnums( const cmodel_state_t *cms,
 					int *topnode, int topNodeHint ) {
 	assert( topNodeHint >= 0 );
 
-	cms->leaf_list = list;
-	cms->leaf_count = 0;
-	cms->leaf_maxcount = listsize;
-	cms->leaf_mins = mins;
-	cms->leaf_maxs = maxs;
-
-	cms->leaf_topnode = -1;
+	cm_boxleafnums_context_t ctx;
+	ctx.list = list;
+	ctx.count = 0;
+	ctx.maxcount = listsize;
+	ctx.mins = mins;
+	ctx.maxs = maxs;
+	ctx.topnode = -1;
 
-	CM_BoxLeafnums_r( cms, topNodeHint );
+	CM_BoxLeafnums_r( cms, &ctx, topNodeHint );
 
 	// Make sure the hinted top node is a parent of (maybe) found split node
-	assert( !topNodeHint || cms->leaf_topnode < 0 || cms->leaf_topnode > topNodeHint );
+	assert( !topNodeHint || ctx.topnode < 0 || ctx.topnode > topNodeHint );
 
 	if( topnode ) {
-		*topnode = cms->leaf_topnode;
+		*topnode = ctx.topnode;
 	}
 
-	return cms->leaf_count;
+	return ctx.count;
 }
 
 /*
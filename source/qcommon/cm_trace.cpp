@@ -779,6 +779,197 @@ void Ops::Trace( trace_t *tr, const vec3_t start, const vec3_t end, const vec3_t
 	}
 }
 
+void Ops::RecursivePointsCheck( CMPointsTraceContext *pc, int num, const CMPacketRay *rays, unsigned numRays ) {
+	alignas( 16 ) float startDists[CMPointsTraceContext::kMaxRays];
+	alignas( 16 ) float endDists[CMPointsTraceContext::kMaxRays];
+
+	for(;; ) {
+		// if < 0, we are in a leaf node
+		if( num < 0 ) {
+			const cleaf_t *leaf = &cms->map_leafs[-1 - num];
+			if( leaf->contents & pc->contents ) {
+				for( unsigned i = 0; i < numRays; ++i ) {
+					CMTraceContext *tlc = &pc->rayContexts[rays[i].rayNum];
+					// The ray could have hit something nearer since the packet has been split
+					if( tlc->trace->fraction > rays[i].startFrac ) {
+						ClipBoxToLeaf( tlc, leaf->brushes, leaf->numbrushes, leaf->faces, leaf->numfaces );
+					}
+				}
+			}
+			return;
+		}
+
+		const cnode_t *node = cms->map_nodes + num;
+		const cplane_t *plane = node->plane;
+
+		// Find distances of ray parts ends to the separating plane.
+		// Distances are linear in respect to fractions of a ray, so only start distances and deltas are computed.
+		if( plane->type < 3 ) {
+			const float *const starts = plane->type == 0 ? pc->startX : ( plane->type == 1 ? pc->startY : pc->startZ );
+			const float *const deltas = plane->type == 0 ? pc->deltaX : ( plane->type == 1 ? pc->deltaY : pc->deltaZ );
+			const float dist = plane->dist;
+			for( unsigned i = 0; i < numRays; ++i ) {
+				const unsigned rayNum = rays[i].rayNum;
+				const float startDist = starts[rayNum] - dist;
+				startDists[i] = startDist + rays[i].startFrac * deltas[rayNum];
+				endDists[i] = startDist + rays[i].endFrac * deltas[rayNum];
+			}
+		} else {
+			const float nx = plane->normal[0], ny = plane->normal[1], nz = plane->normal[2], dist = plane->dist;
+			for( unsigned i = 0; i < numRays; ++i ) {
+				const unsigned rayNum = rays[i].rayNum;
+				const float startDist = nx * pc->startX[rayNum] + ny * pc->startY[rayNum] + nz * pc->startZ[rayNum] - dist;
+				const float delta = nx * pc->deltaX[rayNum] + ny * pc->deltaY[rayNum] + nz * pc->deltaZ[rayNum];
+				startDists[i] = startDist + rays[i].startFrac * delta;
+				endDists[i] = startDist + rays[i].endFrac * delta;
+			}
+		}
+
+		// see which sides we need to consider
+		unsigned numRaysInFront = 0, numRaysBehind = 0;
+		for( unsigned i = 0; i < numRays; ++i ) {
+			numRaysInFront += (unsigned)( ( startDists[i] >= 0 ) & ( endDists[i] >= 0 ) );
+			numRaysBehind += (unsigned)( ( startDists[i] < 0 ) & ( endDists[i] < 0 ) );
+		}
+		if( numRaysInFront == numRays ) {
+			num = node->children[0];
+			continue;
+		}
+		if( numRaysBehind == numRays ) {
+			num = node->children[1];
+			continue;
+		}
+
+		// Split the packet in a single pass.
+		// Rays of a packet usually share the start, so the near side of the first crossing ray is likely to be near for all.
+		CMPacketRay childRays[2][CMPointsTraceContext::kMaxRays];
+		unsigned numChildRays[2] { 0, 0 };
+		int firstSide = -1;
+		for( unsigned i = 0; i < numRays; ++i ) {
+			const float t1 = startDists[i], t2 = endDists[i];
+			const CMPacketRay &ray = rays[i];
+			if( t1 >= 0 && t2 >= 0 ) {
+				childRays[0][numChildRays[0]++] = ray;
+			} else if( t1 < 0 && t2 < 0 ) {
+				childRays[1][numChildRays[1]++] = ray;
+			} else {
+				// put the crosspoint DIST_EPSILON pixels on the near side
+				const float idist = 1.0f / ( t1 - t2 );
+				const int nearSide = t1 < t2 ? 1 : 0;
+				float frac = ( t1 + DIST_EPSILON ) * idist;
+				float frac2 = ( t1 + ( nearSide ? DIST_EPSILON : -DIST_EPSILON ) ) * idist;
+				Q_clamp( frac, 0, 1 );
+				Q_clamp( frac2, 0, 1 );
+				const float fracDelta = ray.endFrac - ray.startFrac;
+				// move up to the node
+				childRays[nearSide][numChildRays[nearSide]++] = { ray.startFrac, ray.startFrac + fracDelta * frac, ray.rayNum };
+				// go past the node
+				const int farSide = nearSide ^ 1;
+				childRays[farSide][numChildRays[farSide]++] = { ray.startFrac + fracDelta * frac2, ray.endFrac, ray.rayNum };
+				if( firstSide < 0 ) {
+					firstSide = nearSide;
+				}
+			}
+		}
+
+		const int nearSide = wsw::max( 0, firstSide ), farSide = nearSide ^ 1;
+		if( numChildRays[nearSide] ) {
+			RecursivePointsCheck( pc, node->children[nearSide], childRays[nearSide], numChildRays[nearSide] );
+		}
+
+		// Drop rays that have hit something on the near side
+		unsigned numFarRays = 0;
+		for( unsigned i = 0; i < numChildRays[farSide]; ++i ) {
+			const CMPacketRay &ray = childRays[farSide][i];
+			if( pc->rayContexts[ray.rayNum].trace->fraction > ray.startFrac ) {
+				childRays[farSide][numFarRays++] = ray;
+			}
+		}
+		if( numFarRays ) {
+			RecursivePointsCheck( pc, node->children[farSide], childRays[farSide], numFarRays );
+		}
+		return;
+	}
+}
+
+void Ops::TracePointsPacket( trace_t *traces, const vec3_t *starts, const vec3_t *ends,
+							 unsigned numTraces, int brushmask, int topNodeHint ) {
+	assert( numTraces <= CMPointsTraceContext::kMaxRays );
+
+	alignas( 16 ) CMTraceContext rayContexts[CMPointsTraceContext::kMaxRays];
+	alignas( 16 ) CMPointsTraceContext pc;
+	pc.rayContexts = rayContexts;
+	pc.contents = brushmask;
+
+	CMPacketRay rays[CMPointsTraceContext::kMaxRays];
+	unsigned numRays = 0;
+	for( unsigned i = 0; i < numTraces; ++i ) {
+		trace_t *const tr = &traces[i];
+		const float *const start = starts[i];
+		const float *const end = ends[i];
+
+		// Position tests are rare, and there's nothing to share for them
+		if( VectorCompare( start, end ) ) {
+			Trace( tr, start, end, vec3_origin, vec3_origin, cms->map_cmodels, brushmask, topNodeHint );
+			continue;
+		}
+
+		memset( tr, 0, sizeof( *tr ) );
+		tr->fraction = 1;
+
+		CMTraceContext *const tlc = &rayContexts[i];
+		SetupCollideContext( tlc, tr, start, end, vec3_origin, vec3_origin, brushmask );
+		tlc->ispoint = true;
+		VectorClear( tlc->extents );
+		SetupClipContext( tlc );
+		VectorSubtract( end, start, tlc->traceDir );
+		VectorNormalize( tlc->traceDir );
+		tlc->boxRadius = 8.0f;
+
+		pc.startX[i] = start[0];
+		pc.startY[i] = start[1];
+		pc.startZ[i] = start[2];
+		pc.deltaX[i] = end[0] - start[0];
+		pc.deltaY[i] = end[1] - start[1];
+		pc.deltaZ[i] = end[2] - start[2];
+
+		rays[numRays++] = { 0.0f, 1.0f, i };
+	}
+
+	if( numRays ) {
+		RecursivePointsCheck( &pc, topNodeHint, rays, numRays );
+	}
+
+	for( unsigned i = 0; i < numRays; ++i ) {
+		const unsigned rayNum = rays[i].rayNum;
+		trace_t *const tr = &traces[rayNum];
+		if( tr->fraction == 1 ) {
+			VectorCopy( ends[rayNum], tr->endpos );
+		} else {
+			VectorLerp( starts[rayNum], tr->fraction, ends[rayNum], tr->endpos );
+		}
+	}
+}
+
+void Ops::TracePoints( trace_t *traces, const vec3_t *starts, const vec3_t *ends,
+					   int numTraces, int brushmask, int topNodeHint ) {
+	assert( topNodeHint >= 0 );
+
+	if( !cms->numnodes ) { // map not loaded
+		for( int i = 0; i < numTraces; ++i ) {
+			memset( &traces[i], 0, sizeof( trace_t ) );
+			traces[i].fraction = 1;
+			VectorCopy( ends[i], traces[i].endpos );
+		}
+		return;
+	}
+
+	for( int i = 0; i < numTraces; i += (int)CMPointsTraceContext::kMaxRays ) {
+		const auto numTracesInPacket = (unsigned)wsw::min( numTraces - i, (int)CMPointsTraceContext::kMaxRays );
+		TracePointsPacket( traces + i, starts + i, ends + i, numTracesInPacket, brushmask, topNodeHint );
+	}
+}
+
 #ifdef CM_SELF_TEST
 static void CompareTraceResults( const trace_t *tr, const char **tags, int count, bool interrupt = false ) {
 	if( count < 2 ) {
@@ -974,6 +1165,27 @@ void CM_TransformedBoxTrace( const cmodel_state_t *cms, trace_t *tr,
 	}
 }
 
+void CM_TracePointsInWorld( const cmodel_state_t *cms, trace_t *traces,
+							const vec3_t *starts, const vec3_t *ends,
+							int numTraces, int brushmask, int topNodeHint ) {
+	assert( topNodeHint >= 0 );
+
+	cms->ops->TracePoints( traces, starts, ends, numTraces, brushmask, topNodeHint );
+
+#ifdef CM_SELF_TEST
+	const char *tags[2] { "single", "packet" };
+	for( int i = 0; i < numTraces; ++i ) {
+		trace_t pair[2];
+		cms->ops->Trace( &pair[0], starts[i], ends[i], vec3_origin, vec3_origin, cms->map_cmodels, brushmask, topNodeHint );
+		if( pair[0].fraction == 1 ) {
+			VectorCopy( ends[i], pair[0].endpos );
+		}
+		pair[1] = traces[i];
+		CompareTraceResults( pair, tags, 2 );
+	}
+#endif
+}
+
 void Ops::BuildShapeList( CMShapeList *list, const float *mins, const float *maxs, int clipMask ) {
 	int leafNums[1024], topNode;
 	// TODO: This can be optimized
@@ -1116,6 +1328,66 @@ void Ops::ClipToShapeList( const CMShapeList *list, trace_t *tr, const float *st
 	}
 }
 
+auto Ops::SetupPointsClipping( const CMShapeList *list, trace_t *traces, const vec3_t *starts, const vec3_t *ends,
+							   unsigned numPoints, int clipMask, CMTraceContext *contexts ) -> unsigned {
+	assert( numPoints <= kMaxPointsInClippingChunk );
+
+	unsigned numContexts = 0;
+	for( unsigned i = 0; i < numPoints; ++i ) {
+		trace_t *const tr = &traces[i];
+		if( VectorCompare( starts[i], ends[i] ) ) [[unlikely]] {
+			ClipToShapeList( list, tr, starts[i], ends[i], vec3_origin, vec3_origin, clipMask );
+			continue;
+		}
+		CMTraceContext *const tlc = &contexts[numContexts];
+		SetupCollideContext( tlc, tr, starts[i], ends[i], vec3_origin, vec3_origin, clipMask );
+		if( list->hasBounds ) {
+			if( !BoundsIntersect( list->mins, list->maxs, tlc->absmins, tlc->absmaxs ) ) {
+				assert( tr->fraction == 1.0f );
+				VectorCopy( ends[i], tr->endpos );
+				continue;
+			}
+		}
+		SetupClipContext( tlc );
+		numContexts++;
+	}
+
+	return numContexts;
+}
+
+void Ops::ClipPointsToShapeList( const CMShapeList *list, trace_t *traces,
+								 const vec3_t *starts, const vec3_t *ends, unsigned numPoints, int clipMask ) {
+	alignas( 16 ) CMTraceContext contexts[kMaxPointsInClippingChunk];
+	const unsigned numContexts = SetupPointsClipping( list, traces, starts, ends, numPoints, clipMask, contexts );
+
+	const int numShapes = list->numShapes;
+	const auto *__restrict shapes = list->shapes;
+	for( int i = 0; i < numShapes; ++i ) {
+		const cbrush_t *__restrict b = shapes[i];
+		for( unsigned j = 0; j < numContexts; ++j ) {
+			CMTraceContext *const tlc = &contexts[j];
+			// Skip completed traces (this matches the early exit of ClipToShapeList())
+			if( !tlc->trace->fraction ) {
+				continue;
+			}
+			if( !BoundsIntersect( b->mins, b->maxs, tlc->absmins, tlc->absmaxs ) ) {
+				continue;
+			}
+			ClipBoxToBrush( tlc, b );
+		}
+	}
+
+	for( unsigned j = 0; j < numContexts; ++j ) {
+		const CMTraceContext *const tlc = &contexts[j];
+		trace_t *const tr = tlc->trace;
+		if( tr->fraction == 1.0f ) {
+			VectorCopy( tlc->end, tr->endpos );
+		} else {
+			VectorLerp( tlc->start, tr->fraction, tlc->end, tr->endpos );
+		}
+	}
+}
+
 CMShapeList *CM_AllocShapeList( cmodel_state_t *cms ) {
 	// TODO: Use a necessary amount of memory
 	const size_t totalSize = 72 * 1024;
@@ -1224,4 +1496,34 @@ void CM_ClipToShapeList( cmodel_state_t *cms, const CMShapeList *list, trace_t *
 #endif
 
 	CM_GetOps( cms )->ClipToShapeList( list, tr, start, end, mins, maxs, clipMask );
+}
+
+void CM_ClipPointsToShapeList( cmodel_state_t *cms, const CMShapeList *list, trace_t *traces,
+							   const vec3_t *starts, const vec3_t *ends, unsigned numPoints, int clipMask ) {
+	memset( traces, 0, sizeof( trace_t ) * numPoints );
+	for( unsigned i = 0; i < numPoints; ++i ) {
+		traces[i].fraction = 1.0f;
+	}
+	if( !list || !list->numShapes ) {
+		for( unsigned i = 0; i < numPoints; ++i ) {
+			VectorCopy( ends[i], traces[i].endpos );
+		}
+		return;
+	}
+
+	Ops *const ops = CM_GetOps( cms );
+	for( unsigned i = 0; i < numPoints; i += Ops::kMaxPointsInClippingChunk ) {
+		const unsigned numPointsInChunk = wsw::min( numPoints - i, Ops::kMaxPointsInClippingChunk );
+		ops->ClipPointsToShapeList( list, traces + i, starts + i, ends + i, numPointsInChunk, clipMask );
+	}
+
+#ifdef CM_SELF_TEST
+	for( unsigned i = 0; i < numPoints; ++i ) {
+		trace_t trace;
+		CM_ClipToShapeList( cms, list, &trace, starts[i], ends[i], vec3_origin, vec3_origin, clipMask );
+		if( trace.fraction != traces[i].fraction || !VectorCompare( trace.endpos, traces[i].endpos ) ) {
+			abort();
+		}
+	}
+#endif
 }
\ No newline at end of file
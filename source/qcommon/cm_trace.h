@@ -35,6 +35,34 @@ struct CMTraceContext {
 	bool ispoint;      // optimized case
 };
 
+/**
+ * A part of a point trace that is pending to be tested against a BSP subtree.
+ * The part is defined in terms of fractions of the entire ray.
+ */
+struct CMPacketRay {
+	float startFrac, endFrac;
+	unsigned rayNum;
+};
+
+/**
+ * A packet of point traces in the world model that share BSP nodes traversal.
+ * Starts and directions of rays are kept in the SoA layout,
+ * so testing all rays of the packet against a node plane is a tight loop that is friendly to autovectorization.
+ */
+struct CMPointsTraceContext {
+	static constexpr unsigned kMaxRays = 32;
+
+	CMTraceContext *rayContexts;
+	int contents;
+
+	alignas( 16 ) float startX[kMaxRays];
+	alignas( 16 ) float startY[kMaxRays];
+	alignas( 16 ) float startZ[kMaxRays];
+	alignas( 16 ) float deltaX[kMaxRays];
+	alignas( 16 ) float deltaY[kMaxRays];
+	alignas( 16 ) float deltaZ[kMaxRays];
+};
+
 struct CMShapeList;
 
 struct Ops {
@@ -66,12 +94,35 @@ struct Ops {
 	void Trace( trace_t *tr, const vec3_t start, const vec3_t end, const vec3_t mins,
 				const vec3_t maxs, const cmodel_s *cmodel, int brushmask, int topNodeHint );
 
+	void RecursivePointsCheck( CMPointsTraceContext *pc, int num, const CMPacketRay *rays, unsigned numRays );
+
+	void TracePointsPacket( trace_t *traces, const vec3_t *starts, const vec3_t *ends,
+							unsigned numTraces, int brushmask, int topNodeHint );
+
+	void TracePoints( trace_t *traces, const vec3_t *starts, const vec3_t *ends,
+					  int numTraces, int brushmask, int topNodeHint );
+
 	virtual void BuildShapeList( CMShapeList *list, const float *mins, const float *maxs, int clipMask );
 	virtual void ClipShapeList( CMShapeList *list, const CMShapeList *baseList, const float *mins, const float *maxs );
 
 	virtual void ClipToShapeList( const CMShapeList *list, trace_t *tr,
 		                          const float *start, const float *end,
 		                          const float *mins, const float *maxs, int clipMask );
+
+	static constexpr unsigned kMaxPointsInClippingChunk = 32;
+
+	// Shapes are the outer loop, so every shape gets tested against all points of a chunk while it's in cache
+	virtual void ClipPointsToShapeList( const CMShapeList *list, trace_t *traces,
+										const vec3_t *starts, const vec3_t *ends, unsigned numPoints, int clipMask );
+
+	/**
+	 * Sets up contexts of points that should be clipped by shapes of the list.
+	 * Points that miss the list bounds are completed immediately, position tests are delegated to ClipToShapeList().
+	 * @return a number of set up contexts
+	 */
+	[[nodiscard]]
+	auto SetupPointsClipping( const CMShapeList *list, trace_t *traces, const vec3_t *starts, const vec3_t *ends,
+							  unsigned numPoints, int clipMask, CMTraceContext *contexts ) -> unsigned;
 };
 
 struct GenericOps final: public Ops {};
@@ -95,6 +146,9 @@ struct Sse42Ops: public Ops {
 	void ClipToShapeList( const CMShapeList *list, trace_t *tr,
 		                  const float *start, const float *end,
 		                  const float *mins, const float *maxs, int clipMask ) override;
+
+	void ClipPointsToShapeList( const CMShapeList *list, trace_t *traces,
+								const vec3_t *starts, const vec3_t *ends, unsigned numPoints, int clipMask ) override;
 #endif
 };
 
@@ -107,6 +161,9 @@ struct AvxOps final: public Sse42Ops {
 	void ClipToShapeList( const CMShapeList *list, trace_t *tr,
 						  const float *start, const float *end,
 						  const float *mins, const float *maxs, int clipMask ) override;
+
+	void ClipPointsToShapeList( const CMShapeList *list, trace_t *traces,
+								const vec3_t *starts, const vec3_t *ends, unsigned numPoints, int clipMask ) override;
 };
 
 inline bool doBoundsTest( const float *shapeMins, const float *shapeMaxs, const CMTraceContext *tlc ) {
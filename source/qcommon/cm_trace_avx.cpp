@@ -351,4 +351,61 @@ void AvxOps::ClipToShapeList( const CMShapeList *__restrict list, trace_t *tr, c
 	} else {
 		VectorLerp( start, tr->fraction, end, tr->endpos );
 	}
+}
+
+void AvxOps::ClipPointsToShapeList( const CMShapeList *__restrict list, trace_t *traces,
+									const vec3_t *starts, const vec3_t *ends, unsigned numPoints, int clipMask ) {
+	alignas( 16 ) CMTraceContext contexts[kMaxPointsInClippingChunk];
+	const unsigned numContexts = SetupPointsClipping( list, traces, starts, ends, numPoints, clipMask, contexts );
+
+	[[maybe_unused]] volatile VexScopedFence fence;
+
+	const auto *__restrict shapes = list->shapes;
+	const int numShapes = list->numShapes;
+
+	int i = 0;
+	// AVX-friendly shapes are put first only by ClipShapeList() which also sets bounds
+	if( list->hasBounds ) {
+		assert( list->numAvxFriendlyShapes + list->numOtherShapes == list->numShapes );
+		const int numAvxFriendlyShapes = list->numAvxFriendlyShapes;
+		for(; i < numAvxFriendlyShapes; ++i ) {
+			const cbrush_s *__restrict b = shapes[i];
+			for( unsigned j = 0; j < numContexts; ++j ) {
+				CMTraceContext *const tlc = &contexts[j];
+				if( !tlc->trace->fraction ) {
+					continue;
+				}
+				if( !boundsIntersectSse42( tlc->xmmAbsmins, tlc->xmmAbsmaxs, b->mins, b->maxs ) ) {
+					continue;
+				}
+				ClipToAvxFriendlyShape( tlc, b );
+			}
+		}
+	}
+
+	for(; i < numShapes; ++i ) {
+		const cbrush_t *__restrict b = shapes[i];
+		for( unsigned j = 0; j < numContexts; ++j ) {
+			CMTraceContext *const tlc = &contexts[j];
+			if( !tlc->trace->fraction ) {
+				continue;
+			}
+			if( !boundsIntersectSse42( tlc->xmmAbsmins, tlc->xmmAbsmaxs, b->mins, b->maxs ) ) {
+				continue;
+			}
+			wsw_vex_fence();
+			Sse42Ops::ClipBoxToBrush( tlc, b );
+			wsw_vex_fence();
+		}
+	}
+
+	for( unsigned j = 0; j < numContexts; ++j ) {
+		const CMTraceContext *const tlc = &contexts[j];
+		trace_t *const tr = tlc->trace;
+		if( tr->fraction == 1.0f ) {
+			VectorCopy( tlc->end, tr->endpos );
+		} else {
+			VectorLerp( tlc->start, tr->fraction, tlc->end, tr->endpos );
+		}
+	}
 }
\ No newline at end of file
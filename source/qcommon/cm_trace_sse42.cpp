@@ -540,4 +540,38 @@ void Sse42Ops::ClipToShapeList( const CMShapeList *list, trace_t *tr, const floa
 	}
 }
 
+void Sse42Ops::ClipPointsToShapeList( const CMShapeList *list, trace_t *traces,
+									  const vec3_t *starts, const vec3_t *ends, unsigned numPoints, int clipMask ) {
+	alignas( 16 ) CMTraceContext contexts[kMaxPointsInClippingChunk];
+	const unsigned numContexts = SetupPointsClipping( list, traces, starts, ends, numPoints, clipMask, contexts );
+
+	[[maybe_unused]] volatile VexScopedFence fence;
+
+	const int numShapes = list->numShapes;
+	const auto *__restrict shapes = list->shapes;
+	for( int i = 0; i < numShapes; ++i ) {
+		const cbrush_t *__restrict b = shapes[i];
+		for( unsigned j = 0; j < numContexts; ++j ) {
+			CMTraceContext *const tlc = &contexts[j];
+			if( !tlc->trace->fraction ) {
+				continue;
+			}
+			if( !boundsIntersectSse42( tlc->xmmAbsmins, tlc->xmmAbsmaxs, b->mins, b->maxs ) ) {
+				continue;
+			}
+			Sse42Ops::ClipBoxToBrush( tlc, b );
+		}
+	}
+
+	for( unsigned j = 0; j < numContexts; ++j ) {
+		const CMTraceContext *const tlc = &contexts[j];
+		trace_t *const tr = tlc->trace;
+		if( tr->fraction == 1.0f ) {
+			VectorCopy( tlc->end, tr->endpos );
+		} else {
+			VectorLerp( tlc->start, tr->fraction, tlc->end, tr->endpos );
+		}
+	}
+}
+
 #endif
\ No newline at end of file
@@ -84,6 +84,23 @@ void CM_TransformedBoxTrace( const cmodel_state_t *cms, trace_t *tr,
 							 const vec3_t origin, const vec3_t angles,
 							 int topNodeHint = 0 );
 
+/**
+ * Traces multiple rays of zero-sized boxes through the world model.
+ * This is equivalent to calling {@code CM_TransformedBoxTrace()} for every ray with zero mins/maxs
+ * and the world model but traversal of BSP nodes is shared by packets of successive rays.
+ * @param cms a collision model instance
+ * @param traces an output buffer for results of traces
+ * @param starts start points of rays
+ * @param ends end points of rays
+ * @param numTraces a number of rays
+ * @param brushmask a contents mask of brushes that are tested
+ * @param topNodeHint a BSP node that is known to enclose all rays
+ * @note Successive rays should be close to each other (e.g. share the start point) for the best performance.
+ */
+void CM_TracePointsInWorld( const cmodel_state_t *cms, trace_t *traces,
+							const vec3_t *starts, const vec3_t *ends,
+							int numTraces, int brushmask, int topNodeHint = 0 );
+
 int CM_ClusterRowSize( const cmodel_state_t *cms );
 int CM_AreaRowSize( const cmodel_state_t *cms );
 int CM_PointLeafnum( const cmodel_state_t *cms, const vec3_t p, int topNodeHint = 0 );
@@ -135,6 +152,14 @@ void CM_ClipToShapeList( cmodel_state_t *cms, const CMShapeList *list, trace_t *
 						 const float *start, const float *end,
 						 const float *mins, const float *maxs, int clipMask );
 
+/**
+ * Clips multiple point traces against shapes of the list.
+ * This is equivalent to calling {@code CM_ClipToShapeList()} for every trace with zero mins/maxs
+ * but every shape is tested against many traces at once, so it's much more cache-friendly for large batches.
+ */
+void CM_ClipPointsToShapeList( cmodel_state_t *cms, const CMShapeList *list, trace_t *traces,
+							   const vec3_t *starts, const vec3_t *ends, unsigned numPoints, int clipMask );
+
 int CM_PossibleShapeListContents( const CMShapeList *list );
 int CM_GetNumShapesInShapeList( const CMShapeList *list );
 
@@ -47,6 +47,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "../qcommon/cjson.h"
 #include "mmcommon.h"
 #include "compression.h"
+#include "jobsystem.h"
+#include "framearena.h"
 
 #include <setjmp.h>
 #include <mutex>
@@ -847,6 +849,11 @@ void Qcommon_Init( int argc, char **argv ) {
 	// Required being able to call Com_Printf().
 	systemFeaturesHolder.EnsureInitialized();
 
+	// Keep a logical processor for the main thread
+	unsigned numPhysicalProcessors = 1, numLogicalProcessors = 1;
+	(void)Sys_GetNumberOfProcessors( &numPhysicalProcessors, &numLogicalProcessors );
+	wsw::JobSystem::init( wsw::max( 1u, numLogicalProcessors ) - 1 );
+
 	// prepare enough of the subsystems to handle
 	// cvar and command buffer management
 	COM_InitArgv( argc, argv );
@@ -990,6 +997,9 @@ void Qcommon_Frame( unsigned int realMsec ) {
 
 	}
 
+	// Temporaries of the previous frame are released here (this also covers frames that were aborted)
+	wsw::FrameArena::instance()->beginFrame();
+
 	if( logconsole && logconsole->modified ) {
 		logconsole->modified = false;
 		Com_ReopenConsoleLog();
@@ -1093,6 +1103,8 @@ void Qcommon_Shutdown( void ) {
 
 	QMutex_Destroy( &com_print_mutex );
 
+	wsw::JobSystem::shutdown();
+
 	QThreads_Shutdown();
 }
 
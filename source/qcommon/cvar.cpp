@@ -61,6 +61,16 @@ static bool Cvar_InfoValidate( const char *s, bool name ) {
 			  ( name && strchr( s, Q_COLOR_ESCAPE ) ) );
 }
 
+/*
+* Cvar_TouchInfo
+* Bumps serverinfo_revision if a variable with the given flags contributes to info strings
+*/
+static void Cvar_TouchInfo( cvar_flag_t flags ) {
+	if( Cvar_FlagIsSet( flags, CVAR_USERINFO ) || Cvar_FlagIsSet( flags, CVAR_SERVERINFO ) ) {
+		serverinfo_revision++;
+	}
+}
+
 /*
 * Cvar_Initialized
 */
@@ -144,6 +154,7 @@ cvar_t *Cvar_Get( const char *var_name, const char *var_value, cvar_flag_t flags
 	}
 
 	if( var ) {
+		const cvar_flag_t oldFlags = var->flags;
 		bool reset = false;
 
 		if( !var->dvalue || strcmp( var->dvalue, var_value ) ) {
@@ -181,6 +192,9 @@ cvar_t *Cvar_Get( const char *var_name, const char *var_value, cvar_flag_t flags
 
 		}
 		Cvar_FlagSet( &var->flags, flags );
+		if( reset || var->flags != oldFlags ) {
+			Cvar_TouchInfo( oldFlags | var->flags );
+		}
 		return var;
 	}
 
@@ -200,6 +214,7 @@ cvar_t *Cvar_Get( const char *var_name, const char *var_value, cvar_flag_t flags
 	var->integer = Q_rint( var->value );
 	var->flags = flags;
 	Cvar_SetModified( var );
+	Cvar_TouchInfo( flags );
 
 	QMutex_Lock( cvar_mutex );
 	Trie_Insert( cvar_trie, var_name, var );
@@ -272,6 +287,7 @@ static cvar_t *Cvar_Set2( const char *var_name, const char *value, bool force )
 					var->value = atof( var->string );
 					var->integer = Q_rint( var->value );
 					Cvar_SetModified( var );
+					Cvar_TouchInfo( var->flags );
 				}
 			}
 			return var;
@@ -297,6 +313,7 @@ static cvar_t *Cvar_Set2( const char *var_name, const char *value, bool force )
 	var->value = atof( var->string );
 	var->integer = Q_rint( var->value );
 	Cvar_SetModified( var );
+	Cvar_TouchInfo( var->flags );
 
 	return var;
 }
@@ -328,11 +345,15 @@ cvar_t *Cvar_FullSet( const char *var_name, const char *value, cvar_flag_t flags
 		return Cvar_Get( var_name, value, flags );
 	}
 
+	const cvar_flag_t oldFlags = var->flags;
 	if( overwrite_flags ) {
 		var->flags = flags;
 	} else {
 		Cvar_FlagSet( &var->flags, flags );
 	}
+	if( var->flags != oldFlags ) {
+		Cvar_TouchInfo( oldFlags | var->flags );
+	}
 
 	// if we overwrite the flags, we will also force the value
 	return Cvar_Set2( var_name, value, overwrite_flags );
@@ -382,6 +403,7 @@ void Cvar_GetLatchedVars( cvar_flag_t flags ) {
 		var->latched_string = NULL;
 		var->value = atof( var->string );
 		var->integer = Q_rint( var->value );
+		Cvar_TouchInfo( var->flags );
 	}
 	Trie_FreeDump( dump );
 }
@@ -410,6 +432,7 @@ void Cvar_FixCheatVars( void ) {
 		var->string = Q_strdup( var->dvalue );
 		var->value = atof( var->string );
 		var->integer = Q_rint( var->value );
+		Cvar_TouchInfo( var->flags );
 	}
 	Trie_FreeDump( dump );
 }
@@ -665,6 +688,7 @@ static void Cvar_ArchiveList_f( void ) {
 #endif
 
 bool userinfo_modified;
+unsigned serverinfo_revision;
 
 static char *Cvar_BitInfo( int bit ) {
 	static char info[MAX_INFO_STRING];
@@ -44,6 +44,10 @@ static inline void      Cvar_UnsetModified( cvar_t *var );
 // that the client knows to send it to the server
 extern bool userinfo_modified;
 
+// this is incremented each time a CVAR_SERVERINFO or CVAR_USERINFO variable is changed
+// so that cached info strings can be revalidated without rebuilding them
+extern unsigned serverinfo_revision;
+
 /*
 
    cvar_t variables are used to hold scalar or string variables that can be changed or displayed at the console or prog code as well as accessed directly
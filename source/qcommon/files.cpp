@@ -26,6 +26,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "compression.h"
 #include "wswcurl.h"
 #include "md5.h"
+#include "jobsystem.h"
 #include "q_trie.h"
 
 /*
@@ -78,8 +79,6 @@ typedef struct {
 #define FS_PACKFILE_COHERENT        2
 #define FS_PACKFILE_DIRECTORY       4
 
-#define FS_PACKFILE_NUM_THREADS     4     // including the main thread
-
 typedef struct packfile_s {
 	char *name;
 	char *pakname;
@@ -1594,6 +1593,24 @@ void *FS_MMapBaseFile( int file, size_t size, size_t offset ) {
 	return data;
 }
 
+/*
+* FS_MMapFile
+*/
+void *FS_MMapFile( int file, size_t *size ) {
+	filehandle_t *fh;
+
+	fh = FS_FileHandleForNum( file );
+	if( fh->gzstream || fh->zipEntry ) {
+		return NULL;
+	}
+	if( fh->pakFile && ( fh->pakFile->flags & FS_PACKFILE_DEFLATED ) ) {
+		return NULL;
+	}
+
+	*size = fh->uncompressedSize;
+	return FS_MMapBaseFile( file, fh->uncompressedSize, fh->pakFile ? fh->pakOffset : 0 );
+}
+
 /*
 * FS_UnMMapBaseFile
 */
@@ -3274,49 +3291,13 @@ static void FS_ReplaceDeferredPaks( void ) {
 	QMutex_Unlock( fs_searchpaths_mutex );
 }
 
-/*
-* FS_LoadDeferredPaks_Job
-*/
-typedef struct {
-	volatile int *cnt;
-	int maxcnt;
-	pack_t **packs;
-	qmutex_t *mutex;
-} deferred_pack_arg_t;
-
-static void *FS_LoadDeferredPaks_Job( void *parg ) {
-	int i;
-	pack_t *pack;
-	deferred_pack_arg_t *arg = (deferred_pack_arg_t *)parg;
-
-	while( true ) {
-		i = Sys_Atomic_Add( arg->cnt, 1, arg->mutex );
-		if( i >= arg->maxcnt ) {
-			break;
-		}
-
-		pack = arg->packs[i];
-
-		assert( pack != NULL );
-		assert( pack->deferred_load );
-
-		pack->deferred_pack = FS_LoadPackFile( pack->filename, false );
-	}
-
-	return NULL;
-}
-
 /*
 * FS_LoadDeferredPaks
 */
 static void FS_LoadDeferredPaks( int newpaks ) {
-	int i;
-	volatile int cnt;
-	qthread_t *threads[FS_PACKFILE_NUM_THREADS - 1] = { NULL };
-	const int num_threads = wsw::min( newpaks, FS_PACKFILE_NUM_THREADS ) - 1;
+	int cnt;
 	pack_t **packs;
 	searchpath_t *search;
-	deferred_pack_arg_t *arg;
 
 	if( !newpaks ) {
 		return;
@@ -3337,30 +3318,21 @@ static void FS_LoadDeferredPaks( int newpaks ) {
 		}
 	}
 
-	arg = (deferred_pack_arg_t *)Q_malloc( sizeof( *arg ) );
-	arg->cnt = (int *)Q_malloc( sizeof( int ) );
-	arg->maxcnt = newpaks;
-	arg->packs = packs;
-	arg->mutex = QMutex_Create();
+	// Load packs using workers of the job system
+	wsw::JobSystem::instance()->parallelFor( (unsigned)cnt, 1, [=]( unsigned beginIndex, unsigned endIndex ) {
+		for( unsigned i = beginIndex; i < endIndex; ++i ) {
+			pack_t *const pack = packs[i];
 
-	if( num_threads > 0 ) {
-		for( i = 0; i < num_threads; i++ )
-			threads[i] = QThread_Create( FS_LoadDeferredPaks_Job, arg );
-	}
-
-	FS_LoadDeferredPaks_Job( arg );
+			assert( pack != NULL );
+			assert( pack->deferred_load );
 
-	if( num_threads > 0 ) {
-		for( i = 0; i < num_threads; i++ )
-			QThread_Join( threads[i] );
-	}
+			pack->deferred_pack = FS_LoadPackFile( pack->filename, false );
+		}
+	});
 
 	FS_ReplaceDeferredPaks();
 
-	Q_free( (void *)arg->cnt );
-	Q_free( arg->packs );
-	QMutex_Destroy( &arg->mutex );
-	Q_free( arg );
+	Q_free( packs );
 }
 
 /*
@@ -0,0 +1,115 @@
+#include "framearena.h"
+#include "wswexceptions.h"
+
+#include <algorithm>
+#include <new>
+
+namespace wsw {
+
+auto FrameArena::instance() -> FrameArena * {
+	// Lazily constructed on the first use by a thread
+	static thread_local FrameArena arena;
+	return &arena;
+}
+
+FrameArena::FrameArena( size_t initialCapacity ) {
+	m_head = allocBlock( std::max<size_t>( initialCapacity, kBlockAlignment ), nullptr, 0 );
+	setCurrentBlock( m_head, m_head->data );
+}
+
+FrameArena::~FrameArena() {
+	for( Block *block = m_current, *prev; block; block = prev ) {
+		prev = block->prev;
+		freeBlock( block );
+	}
+}
+
+auto FrameArena::allocBlock( size_t capacity, Block *prev, size_t bytesBefore ) -> Block * {
+	// The header is padded so the data is aligned by the block alignment
+	constexpr size_t headerSize = ( ( sizeof( Block ) + kBlockAlignment - 1 ) / kBlockAlignment ) * kBlockAlignment;
+	void *mem = std::malloc( headerSize + capacity + kBlockAlignment );
+	if( !mem ) {
+		wsw::failWithBadAlloc();
+	}
+
+	auto *const basePtr = (uint8_t *)( ( (uintptr_t)mem + kBlockAlignment - 1 ) & ~( (uintptr_t)kBlockAlignment - 1 ) );
+	auto *const block = new( basePtr + headerSize - sizeof( Block ) )Block {
+		.prev = prev, .data = basePtr + headerSize, .capacity = capacity, .bytesBefore = bytesBefore,
+	};
+	// Save the original address just before the header
+	static_assert( sizeof( Block ) + sizeof( void * ) <= headerSize );
+	( (void **)block )[-1] = mem;
+
+	WSW_FRAME_ARENA_POISON( block->data, block->capacity );
+	return block;
+}
+
+void FrameArena::freeBlock( Block *block ) {
+	WSW_FRAME_ARENA_UNPOISON( block->data, block->capacity );
+	std::free( ( (void **)block )[-1] );
+}
+
+void FrameArena::setCurrentBlock( Block *block, uint8_t *top ) {
+	assert( top >= block->data && top <= block->data + block->capacity );
+	m_current = block;
+	m_top = top;
+	m_end = block->data + block->capacity;
+}
+
+void FrameArena::updatePeakUsage() {
+	m_framePeakUsage = std::max( m_framePeakUsage, bytesInUse() );
+}
+
+auto FrameArena::peakUsage() const -> size_t {
+	return std::max( std::max( m_peakUsage, m_framePeakUsage ), bytesInUse() );
+}
+
+auto FrameArena::allocateSlowPath( size_t size, size_t alignment ) -> void * {
+	// Make sure there's enough space for the request in the new block, regardless of alignment of its data
+	const size_t minCapacity = size + ( alignment > kBlockAlignment ? alignment : 0 );
+	// Don't let a series of small overflowing requests allocate a block per request
+	const size_t capacity = std::max( minCapacity, m_head->capacity / 2 );
+
+	m_current = allocBlock( capacity, m_current, bytesInUse() );
+	setCurrentBlock( m_current, m_current->data );
+	m_numFrameOverflows++;
+	m_numOverflows++;
+
+	auto *const p = (uint8_t *)( ( (uintptr_t)m_top + ( alignment - 1 ) ) & ~( (uintptr_t)alignment - 1 ) );
+	assert( p + size <= m_end );
+	m_top = p + size;
+	WSW_FRAME_ARENA_UNPOISON( p, size );
+	return p;
+}
+
+void FrameArena::rewind( const Mark &mark ) {
+	updatePeakUsage();
+	while( m_current != mark.block ) {
+		assert( m_current != m_head );
+		Block *const prev = m_current->prev;
+		freeBlock( m_current );
+		m_current = prev;
+	}
+	WSW_FRAME_ARENA_POISON( mark.top, (size_t)( m_current->data + m_current->capacity - mark.top ) );
+	setCurrentBlock( m_current, mark.top );
+}
+
+void FrameArena::beginFrame() {
+	updatePeakUsage();
+	rewind( Mark { m_head, m_head->data } );
+
+	if( m_numFrameOverflows ) {
+		// Grow the primary block, so the overflow does not happen again for similar workloads
+		const size_t newCapacity = m_framePeakUsage + m_framePeakUsage / 4;
+		freeBlock( m_head );
+		m_head = allocBlock( newCapacity, nullptr, 0 );
+		setCurrentBlock( m_head, m_head->data );
+		m_numFrameOverflows = 0;
+	}
+
+	m_peakUsage = std::max( m_peakUsage, m_framePeakUsage );
+	m_lastFramePeakUsage = m_framePeakUsage;
+	m_framePeakUsage = 0;
+}
+
+}
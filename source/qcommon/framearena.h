@@ -0,0 +1,190 @@
+#ifndef WSW_3c1f0b7e_8d2a_4f56_9e41_b7a0d6c2e915_H
+#define WSW_3c1f0b7e_8d2a_4f56_9e41_b7a0d6c2e915_H
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <type_traits>
+
+#ifdef __SANITIZE_ADDRESS__
+#include <sanitizer/asan_interface.h>
+#define WSW_FRAME_ARENA_POISON( address, size ) ASAN_POISON_MEMORY_REGION( address, size )
+#define WSW_FRAME_ARENA_UNPOISON( address, size ) ASAN_UNPOISON_MEMORY_REGION( address, size )
+#else
+#define WSW_FRAME_ARENA_POISON( address, size ) (void)0
+#define WSW_FRAME_ARENA_UNPOISON( address, size ) (void)0
+#endif
+
+namespace wsw {
+
+/**
+ * A linear (bump) allocator for temporaries that never outlive a frame.
+ * Allocations are just pointer increments, there are no individual deallocations.
+ * Memory is reclaimed all at once by {@code beginFrame()} or by rewinding to a {@code Mark}.
+ * If the primary block is exhausted, overflow blocks are taken from the heap,
+ * and the primary block grows to the observed peak usage at the next frame start,
+ * so a steady state does not touch the heap at all.
+ * @note Objects that are put in the arena must be trivially destructible
+ * (or destructed manually), destructors are never called by the arena.
+ */
+class FrameArena {
+	struct Block {
+		Block *prev;
+		uint8_t *data;
+		size_t capacity;
+		// A number of bytes that were in use in preceding blocks when this block was added
+		size_t bytesBefore;
+	};
+
+	Block *m_head { nullptr };
+	Block *m_current { nullptr };
+	uint8_t *m_top { nullptr };
+	uint8_t *m_end { nullptr };
+
+	size_t m_framePeakUsage { 0 };
+	size_t m_lastFramePeakUsage { 0 };
+	size_t m_peakUsage { 0 };
+	unsigned m_numFrameOverflows { 0 };
+	unsigned m_numOverflows { 0 };
+
+	static constexpr size_t kBlockAlignment = 64;
+
+	[[nodiscard]]
+	static auto allocBlock( size_t capacity, Block *prev, size_t bytesBefore ) -> Block *;
+	static void freeBlock( Block *block );
+
+	void setCurrentBlock( Block *block, uint8_t *top );
+	void updatePeakUsage();
+
+	[[nodiscard]]
+	auto allocateSlowPath( size_t size, size_t alignment ) -> void *;
+public:
+	static constexpr size_t kDefaultCapacity = 1024 * 1024;
+
+	/**
+	 * A saved state of the arena, rewinding to it frees everything that has been allocated since.
+	 */
+	struct Mark {
+		Block *block;
+		uint8_t *top;
+	};
+
+	/**
+	 * Rewinds the arena to the state it had at the scope entry.
+	 * This allows reusing the same memory for every iteration of loops (e.g. over clients).
+	 */
+	class ScopedRewind {
+		FrameArena *const m_arena;
+		const Mark m_mark;
+	public:
+		explicit ScopedRewind( FrameArena *arena ) : m_arena( arena ), m_mark( arena->mark() ) {}
+		~ScopedRewind() { m_arena->rewind( m_mark ); }
+
+		ScopedRewind( const ScopedRewind & ) = delete;
+		auto operator=( const ScopedRewind & ) -> ScopedRewind & = delete;
+	};
+
+	explicit FrameArena( size_t initialCapacity = kDefaultCapacity );
+	~FrameArena();
+
+	FrameArena( const FrameArena & ) = delete;
+	auto operator=( const FrameArena & ) -> FrameArena & = delete;
+	FrameArena( FrameArena && ) = delete;
+	auto operator=( FrameArena && ) -> FrameArena & = delete;
+
+	/**
+	 * Gets an arena of the current thread.
+	 * @note Arenas of the main thread are reset every {@code Qcommon_Frame()}.
+	 * Other threads (e.g. workers of the job system) must use {@code ScopedRewind}.
+	 */
+	[[nodiscard]]
+	static auto instance() -> FrameArena *;
+
+	[[nodiscard]]
+	auto allocate( size_t size, size_t alignment = alignof( std::max_align_t ) ) -> void * {
+		assert( alignment && !( alignment & ( alignment - 1 ) ) );
+		auto *const p = (uint8_t *)( ( (uintptr_t)m_top + ( alignment - 1 ) ) & ~( (uintptr_t)alignment - 1 ) );
+		if( p + size <= m_end ) [[likely]] {
+			m_top = p + size;
+			WSW_FRAME_ARENA_UNPOISON( p, size );
+			return p;
+		}
+		return allocateSlowPath( size, alignment );
+	}
+
+	/**
+	 * Allocates an uninitialized array of trivially destructible objects.
+	 */
+	template <typename T>
+	[[nodiscard]]
+	auto allocArray( size_t count ) -> T * {
+		static_assert( std::is_trivially_destructible_v<T> );
+		return (T *)allocate( sizeof( T ) * count, alignof( T ) );
+	}
+
+	[[nodiscard]]
+	auto mark() const -> Mark { return { m_current, m_top }; }
+
+	void rewind( const Mark &mark );
+
+	/**
+	 * Frees everything allocated since the last call.
+	 * Must not be called while there are active {@code ScopedRewind} objects.
+	 */
+	void beginFrame();
+
+	[[nodiscard]]
+	auto capacity() const -> size_t { return m_head->capacity; }
+	[[nodiscard]]
+	auto bytesInUse() const -> size_t { return m_current->bytesBefore + (size_t)( m_top - m_current->data ); }
+	[[nodiscard]]
+	auto lastFramePeakUsage() const -> size_t { return m_lastFramePeakUsage; }
+	/**
+	 * Gets the maximal number of bytes that have been simultaneously in use since the arena creation.
+	 */
+	[[nodiscard]]
+	auto peakUsage() const -> size_t;
+	/**
+	 * Gets a total number of heap allocations that were performed due to exhaustion of the primary block.
+	 */
+	[[nodiscard]]
+	auto numOverflows() const -> unsigned { return m_numOverflows; }
+};
+
+/**
+ * An adapter of {@code FrameArena} for standard containers (e.g. std::vector temporaries).
+ * Deallocations are no-op, so containers should reserve their capacity upfront if possible.
+ */
+template <typename T>
+class FrameArenaAllocator {
+	template <typename> friend class FrameArenaAllocator;
+
+	FrameArena *m_arena;
+public:
+	using value_type = T;
+
+	FrameArenaAllocator() noexcept : m_arena( FrameArena::instance() ) {}
+	explicit FrameArenaAllocator( FrameArena *arena ) noexcept : m_arena( arena ) {}
+
+	template <typename U>
+	FrameArenaAllocator( const FrameArenaAllocator<U> &that ) noexcept : m_arena( that.m_arena ) {}
+
+	[[nodiscard]]
+	auto allocate( size_t count ) -> T * {
+		return (T *)m_arena->allocate( sizeof( T ) * count, alignof( T ) );
+	}
+
+	void deallocate( T *, size_t ) noexcept {}
+
+	template <typename U>
+	[[nodiscard]]
+	bool operator==( const FrameArenaAllocator<U> &that ) const noexcept { return m_arena == that.m_arena; }
+	template <typename U>
+	[[nodiscard]]
+	bool operator!=( const FrameArenaAllocator<U> &that ) const noexcept { return m_arena != that.m_arena; }
+};
+
+}
+
+#endif
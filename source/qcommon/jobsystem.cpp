@@ -0,0 +1,233 @@
+#include "jobsystem.h"
+#include "singletonholder.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace wsw {
+
+static SingletonHolder<JobSystem> g_jobSystemHolder;
+
+// Allows workers to push jobs to their own queues
+static thread_local const JobSystem *t_jobSystemOfWorker;
+static thread_local unsigned t_queueIndexOfWorker;
+
+void JobSystem::init( unsigned numWorkers ) {
+	g_jobSystemHolder.init( numWorkers );
+}
+
+void JobSystem::shutdown() {
+	g_jobSystemHolder.shutdown();
+}
+
+auto JobSystem::instance() -> JobSystem * {
+	return g_jobSystemHolder.instance();
+}
+
+JobSystem::JobSystem( unsigned numWorkers ) {
+	m_numQueues = numWorkers + 1;
+	m_queues.reset( new JobQueue[m_numQueues] );
+	m_threads.reserve( numWorkers );
+	for( unsigned i = 0; i < numWorkers; ++i ) {
+		m_threads.emplace_back( std::thread( &JobSystem::runWorker, this, i + 1 ) );
+	}
+}
+
+JobSystem::~JobSystem() {
+	assert( !m_numQueuedJobs.load( std::memory_order_relaxed ) );
+	{
+		[[maybe_unused]] std::lock_guard<std::mutex> lock( m_sleepMutex );
+		m_isShuttingDown = true;
+	}
+	m_sleepCondition.notify_all();
+	for( std::thread &thread: m_threads ) {
+		thread.join();
+	}
+}
+
+auto JobSystem::ownQueueIndex() const -> unsigned {
+	return t_jobSystemOfWorker == this ? t_queueIndexOfWorker : 0;
+}
+
+void JobSystem::submit( JobFn fn, void *data, Counter *counter, Counter *dependency ) {
+	if( counter ) {
+		counter->m_numPendingJobs.fetch_add( 1, std::memory_order_relaxed );
+	}
+	const Job job { .fn = fn, .data = data, .counter = counter };
+	if( dependency ) {
+		[[maybe_unused]] std::lock_guard<std::mutex> lock( m_dependenciesMutex );
+		// The last decrement of a counter is performed under this lock, so the check is reliable
+		if( !dependency->isDone() ) {
+			dependency->m_dependentJobs.push_back( job );
+			return;
+		}
+	}
+	enqueue( job );
+}
+
+void JobSystem::enqueue( const Job &job ) {
+	// Increment it prior to pushing the job, so it never wraps around if a thief pops the job immediately
+	m_numQueuedJobs.fetch_add( 1, std::memory_order_seq_cst );
+
+	JobQueue &queue = m_queues[ownQueueIndex()];
+	{
+		[[maybe_unused]] std::lock_guard<std::mutex> lock( queue.mutex );
+		queue.jobs.push_back( job );
+	}
+
+	// Pairs with the check of the number of queued jobs by a worker that is going to sleep
+	if( m_numSleepingWorkers.load( std::memory_order_seq_cst ) ) {
+		[[maybe_unused]] std::lock_guard<std::mutex> lock( m_sleepMutex );
+		m_sleepCondition.notify_one();
+	}
+}
+
+bool JobSystem::tryRunPendingJob( unsigned ownQueueIndex ) {
+	Job job;
+	bool hasJob = false;
+
+	// Prefer the most recently pushed job of the own queue as its data is likely to be in cache
+	{
+		JobQueue &queue = m_queues[ownQueueIndex];
+		[[maybe_unused]] std::lock_guard<std::mutex> lock( queue.mutex );
+		if( !queue.jobs.empty() ) {
+			job = queue.jobs.back();
+			queue.jobs.pop_back();
+			hasJob = true;
+		}
+	}
+
+	// Steal the oldest job of another queue (it's likely to spawn more work)
+	for( unsigned i = 1; !hasJob && i < m_numQueues; ++i ) {
+		JobQueue &queue = m_queues[( ownQueueIndex + i ) % m_numQueues];
+		[[maybe_unused]] std::lock_guard<std::mutex> lock( queue.mutex );
+		if( !queue.jobs.empty() ) {
+			job = queue.jobs.front();
+			queue.jobs.pop_front();
+			hasJob = true;
+		}
+	}
+
+	if( !hasJob ) {
+		return false;
+	}
+
+	m_numQueuedJobs.fetch_sub( 1, std::memory_order_relaxed );
+	job.fn( job.data );
+	if( job.counter ) {
+		complete( job.counter );
+	}
+	return true;
+}
+
+void JobSystem::complete( Counter *counter ) {
+	unsigned numPendingJobs = counter->m_numPendingJobs.load( std::memory_order_relaxed );
+	for(;; ) {
+		assert( numPendingJobs );
+		if( numPendingJobs == 1 ) {
+			// This is likely the last job of the counter.
+			// Perform the decrement under the lock, so waiters could synchronize with releasing dependent jobs.
+			wsw::Vector<Job> dependentJobs;
+			{
+				[[maybe_unused]] std::lock_guard<std::mutex> lock( m_dependenciesMutex );
+				if( counter->m_numPendingJobs.fetch_sub( 1, std::memory_order_acq_rel ) == 1 ) {
+					dependentJobs.swap( counter->m_dependentJobs );
+				}
+			}
+			// The counter must not be accessed at this point as it could be already destroyed
+			for( const Job &job: dependentJobs ) {
+				enqueue( job );
+			}
+			return;
+		}
+		if( counter->m_numPendingJobs.compare_exchange_weak( numPendingJobs, numPendingJobs - 1, std::memory_order_acq_rel ) ) {
+			return;
+		}
+	}
+}
+
+void JobSystem::waitFor( Counter *counter ) {
+	const unsigned queueIndex = ownQueueIndex();
+	while( !counter->isDone() ) {
+		if( !tryRunPendingJob( queueIndex ) ) {
+			// Jobs of the counter are being executed by other threads
+			std::this_thread::yield();
+		}
+	}
+	// Wait for releasing dependent jobs by the thread that has made the last decrement
+	[[maybe_unused]] std::lock_guard<std::mutex> lock( m_dependenciesMutex );
+	assert( counter->m_dependentJobs.empty() );
+}
+
+void JobSystem::runWorker( unsigned queueIndex ) {
+	t_jobSystemOfWorker = this;
+	t_queueIndexOfWorker = queueIndex;
+
+	for(;; ) {
+		if( tryRunPendingJob( queueIndex ) ) {
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock( m_sleepMutex );
+		m_numSleepingWorkers.fetch_add( 1, std::memory_order_seq_cst );
+		m_sleepCondition.wait( lock, [this]() {
+			return m_isShuttingDown || m_numQueuedJobs.load( std::memory_order_seq_cst );
+		});
+		m_numSleepingWorkers.fetch_sub( 1, std::memory_order_relaxed );
+		if( m_isShuttingDown ) {
+			return;
+		}
+	}
+}
+
+struct JobSystem::ParallelForState {
+	std::atomic<unsigned> nextChunkIndex { 0 };
+	unsigned numChunks;
+	unsigned numItems;
+	unsigned grainSize;
+	RangeFn rangeFn;
+	void *data;
+};
+
+void JobSystem::runParallelForChunks( void *data ) {
+	auto *const state = (ParallelForState *)data;
+	for(;; ) {
+		const unsigned chunkIndex = state->nextChunkIndex.fetch_add( 1, std::memory_order_relaxed );
+		if( chunkIndex >= state->numChunks ) {
+			break;
+		}
+		const unsigned beginIndex = chunkIndex * state->grainSize;
+		const unsigned endIndex = std::min( beginIndex + state->grainSize, state->numItems );
+		state->rangeFn( state->data, beginIndex, endIndex );
+	}
+}
+
+void JobSystem::runParallelFor( unsigned numItems, unsigned grainSize, RangeFn rangeFn, void *data ) {
+	grainSize = std::max( 1u, grainSize );
+	const unsigned numChunks = numItems / grainSize + ( numItems % grainSize ? 1 : 0 );
+	if( numChunks < 2 || m_threads.empty() ) {
+		if( numItems ) {
+			rangeFn( data, 0, numItems );
+		}
+		return;
+	}
+
+	ParallelForState state;
+	state.numChunks = numChunks;
+	state.numItems = numItems;
+	state.grainSize = grainSize;
+	state.rangeFn = rangeFn;
+	state.data = data;
+
+	// Chunks are picked dynamically, so there is no need to submit a job per chunk.
+	// The calling thread picks chunks as well.
+	Counter counter;
+	const unsigned numHelperJobs = std::min( numChunks, numWorkers() + 1 ) - 1;
+	for( unsigned i = 0; i < numHelperJobs; ++i ) {
+		submit( &JobSystem::runParallelForChunks, &state, &counter );
+	}
+	runParallelForChunks( &state );
+	waitFor( &counter );
+}
+
+}
@@ -0,0 +1,132 @@
+#ifndef WSW_d306e7ec_f74a_4c7b_9026_ab82a01360e5_H
+#define WSW_d306e7ec_f74a_4c7b_9026_ab82a01360e5_H
+
+#include "wswvector.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+namespace wsw {
+
+/**
+ * A pool of persistent worker threads that execute short independent jobs.
+ * Every worker has its own deque of jobs. A worker takes jobs from the bottom of its own deque
+ * and steals jobs from the top of deques of other workers if its own deque is empty.
+ * Jobs that are submitted by other threads go to a shared deque which is also subject to stealing.
+ * Threads that wait for completion of jobs execute pending jobs meanwhile.
+ * @note Jobs are not allowed to block waiting for something except other jobs.
+ */
+class JobSystem {
+public:
+	class Counter;
+private:
+	struct Job {
+		void (*fn)( void * );
+		void *data;
+		Counter *counter;
+	};
+public:
+	using JobFn = void (*)( void *data );
+
+	/**
+	 * A counter of jobs that are not completed yet.
+	 * It can be waited for, and other jobs can be made dependent on it.
+	 * @note A counter must be waited for prior to its destruction.
+	 */
+	class Counter {
+		friend class JobSystem;
+
+		std::atomic<unsigned> m_numPendingJobs { 0 };
+		// Guarded by the dependencies mutex of the system
+		wsw::Vector<Job> m_dependentJobs;
+	public:
+		Counter() = default;
+		Counter( const Counter & ) = delete;
+		auto operator=( const Counter & ) -> Counter & = delete;
+
+		[[nodiscard]]
+		bool isDone() const { return !m_numPendingJobs.load( std::memory_order_acquire ); }
+	};
+
+	explicit JobSystem( unsigned numWorkers );
+	~JobSystem();
+
+	JobSystem( const JobSystem & ) = delete;
+	auto operator=( const JobSystem & ) -> JobSystem & = delete;
+
+	static void init( unsigned numWorkers );
+	static void shutdown();
+	[[nodiscard]]
+	static auto instance() -> JobSystem *;
+
+	[[nodiscard]]
+	auto numWorkers() const -> unsigned { return (unsigned)m_threads.size(); }
+
+	/**
+	 * Enqueues a job. The counter (if any) gets incremented immediately and decremented once the job is completed.
+	 * If the dependency (if any) is specified, the job does not start until the dependency counter reaches zero.
+	 * The data must stay valid until the job is completed.
+	 */
+	void submit( JobFn fn, void *data, Counter *counter = nullptr, Counter *dependency = nullptr );
+
+	/**
+	 * Waits for the counter to reach zero, executing pending jobs in the calling thread meanwhile.
+	 */
+	void waitFor( Counter *counter );
+
+	/**
+	 * Calls the function for subranges of [0, numItems) that are (at most) grainSize long.
+	 * The calling thread participates in execution, and the call returns once all items are processed.
+	 * The function must have the (unsigned beginIndex, unsigned endIndex) signature.
+	 */
+	template <typename Func>
+	void parallelFor( unsigned numItems, unsigned grainSize, Func &&func ) {
+		using FuncType = std::remove_reference_t<Func>;
+		runParallelFor( numItems, grainSize, []( void *data, unsigned beginIndex, unsigned endIndex ) {
+			( *( (FuncType *)data ) )( beginIndex, endIndex );
+		}, (void *)std::addressof( func ) );
+	}
+private:
+	using RangeFn = void (*)( void *data, unsigned beginIndex, unsigned endIndex );
+
+	struct alignas( 64 ) JobQueue {
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	struct ParallelForState;
+
+	void runParallelFor( unsigned numItems, unsigned grainSize, RangeFn rangeFn, void *data );
+	static void runParallelForChunks( void *state );
+
+	void runWorker( unsigned queueIndex );
+	void enqueue( const Job &job );
+	void complete( Counter *counter );
+
+	[[nodiscard]]
+	bool tryRunPendingJob( unsigned ownQueueIndex );
+	[[nodiscard]]
+	auto ownQueueIndex() const -> unsigned;
+
+	// The first queue is for external threads, the rest ones belong to respective workers
+	std::unique_ptr<JobQueue[]> m_queues;
+	unsigned m_numQueues { 0 };
+	wsw::Vector<std::thread> m_threads;
+
+	std::mutex m_dependenciesMutex;
+
+	alignas( 64 ) std::atomic<unsigned> m_numQueuedJobs { 0 };
+	alignas( 64 ) std::atomic<unsigned> m_numSleepingWorkers { 0 };
+	std::mutex m_sleepMutex;
+	std::condition_variable m_sleepCondition;
+	bool m_isShuttingDown { false };
+};
+
+}
+
+#endif
@@ -28,7 +28,7 @@ void ReliablePipe::BackgroundRunner::RunMessageLoop() {
 ReliablePipe::ReliablePipe()
 	: reliableStorage( MakeLocalStoragePath() ) {
 	// Never actually fails?
-	this->reportsPipe = QBufPipe_Create( 128, 1 );
+	this->reportsPipe = QBufPipe_Create( 128, QBUFPIPE_BLOCKING_WRITE | QBUFPIPE_LOCKFREE_SPSC );
 
 	// Never actually fails?
 	this->backgroundWriter = new( ::malloc( sizeof( BackgroundWriter ) ) )BackgroundWriter( &reliableStorage, reportsPipe );
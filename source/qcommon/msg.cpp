@@ -21,7 +21,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "qcommon.h"
 #include "half_float.h"
 
+#include <cmath>
 #include <iterator> // std::begin(), std::end()
+#include <utility>
 
 /*
 ==============================================================================
@@ -906,13 +908,636 @@ void MSG_ReadDeltaStruct( msg_t *msg, const void *from, void *to, size_t size, c
 	MSG_ReadStructFields( msg, from, to, fields, numFields, fieldMask, sizeof( fieldMask ), byteMask );
 }
 
+//==================================================
+// SPECIALIZED DELTA CODECS
+//==================================================
+
+/*
+* Codecs of frequently sent states are generated from their field tables at compile time.
+* Loops over fields and array elements get unrolled and switches over bits/encodings are resolved statically.
+* The wire format must match MSG_WriteDeltaStruct()/MSG_ReadDeltaStruct() exactly,
+* qcommon/tests/deltacodectest.cpp checks that using random states.
+*/
+
+/*
+* Bit-packed output/input of quantized values. Values are packed starting from lower bits.
+* Every packed block occupies an integral number of bytes.
+*/
+class MsgBitWriter {
+	msg_t *const m_msg;
+	uint64_t m_bits { 0 };
+	unsigned m_numBits { 0 };
+public:
+	explicit MsgBitWriter( msg_t *msg ) : m_msg( msg ) {}
+
+	void write( uint32_t value, unsigned numBits ) {
+		assert( numBits > 0 && numBits <= 32 );
+		m_bits |= (uint64_t)( value & ( ~(uint32_t)0 >> ( 32 - numBits ) ) ) << m_numBits;
+		m_numBits += numBits;
+		while( m_numBits >= 8 ) {
+			MSG_WriteUint8( m_msg, (int)( m_bits & 0xFF ) );
+			m_bits >>= 8;
+			m_numBits -= 8;
+		}
+	}
+
+	void flush() {
+		if( m_numBits ) {
+			MSG_WriteUint8( m_msg, (int)( m_bits & 0xFF ) );
+			m_bits = 0;
+			m_numBits = 0;
+		}
+	}
+};
+
+class MsgBitReader {
+	msg_t *const m_msg;
+	uint64_t m_bits { 0 };
+	unsigned m_numBits { 0 };
+public:
+	explicit MsgBitReader( msg_t *msg ) : m_msg( msg ) {}
+
+	[[nodiscard]]
+	auto read( unsigned numBits ) -> uint32_t {
+		assert( numBits > 0 && numBits <= 32 );
+		while( m_numBits < numBits ) {
+			m_bits |= (uint64_t)( MSG_ReadUint8( m_msg ) & 0xFF ) << m_numBits;
+			m_numBits += 8;
+		}
+		const auto result = (uint32_t)( m_bits & ( ~(uint32_t)0 >> ( 32 - numBits ) ) );
+		m_bits >>= numBits;
+		m_numBits -= numBits;
+		return result;
+	}
+};
+
+// Quantized origins have 1/8 unit precision
+#define QUANT_POSITION_FRACTION_BITS    3
+// Small position changes are transmitted as signed deltas of this size
+#define QUANT_POSITION_DELTA_BITS       8
+#define QUANT_MAX_POSITION_BITS         24
+#define QUANT_ANGLE_BITS                14
+
+typedef enum {
+	PACKED_POSITION,
+	PACKED_ANGLE
+} packedFieldKind_t;
+
+// Describes a float field that is quantized and bit-packed if the quantized encoding is enabled
+typedef struct {
+	int offset;
+	packedFieldKind_t kind;
+	int axis;           // of a position
+} msg_packed_field_t;
+
+static constexpr msg_packed_field_t no_packed_fields[] = {
+	{ -1, PACKED_POSITION, 0 }
+};
+
+static inline uint32_t MSG_QuantizePosition( float value, int mins, int numBits ) {
+	const float scaled = ( value - (float)mins ) * (float)( 1 << QUANT_POSITION_FRACTION_BITS );
+	const uint32_t maxValue = ~(uint32_t)0 >> ( 32 - numBits );
+	// Note: NaN values yield zero
+	if( !( scaled > 0.0f ) ) {
+		return 0;
+	}
+	if( scaled >= (float)maxValue ) {
+		return maxValue;
+	}
+	return (uint32_t)lrintf( scaled );
+}
+
+static inline float MSG_DequantizePosition( uint32_t value, int mins ) {
+	// This is exact, so quantizing a dequantized value yields the same value
+	return (float)mins + (float)value * ( 1.0f / (float)( 1 << QUANT_POSITION_FRACTION_BITS ) );
+}
+
+static inline uint32_t MSG_QuantizeAngle( float value ) {
+	const float scale = (float)( 1 << QUANT_ANGLE_BITS ) / 360.0f;
+	return (uint32_t)lrintf( anglemod( value ) * scale ) & ( ( 1u << QUANT_ANGLE_BITS ) - 1 );
+}
+
+static inline float MSG_DequantizeAngle( uint32_t value ) {
+	return (float)value * ( 360.0f / (float)( 1 << QUANT_ANGLE_BITS ) );
+}
+
+/*
+* MSG_SetupQuantization
+*/
+void MSG_SetupQuantization( msg_quantization_t *quantization, const vec3_t mins, const vec3_t maxs ) {
+	float maxExtent = 1.0f;
+	for( int i = 0; i < 3; ++i ) {
+		// Add some margin to be sure that bounds are strict
+		quantization->mins[i] = (int)floorf( mins[i] ) - 1;
+		maxExtent = wsw::max( maxExtent, maxs[i] + 1.0f - (float)quantization->mins[i] );
+	}
+
+	const double maxValue = std::ceil( (double)maxExtent ) * (double)( 1 << QUANT_POSITION_FRACTION_BITS );
+	int numBits = 1;
+	while( numBits < QUANT_MAX_POSITION_BITS && (double)( (uint32_t)1 << numBits ) <= maxValue ) {
+		numBits++;
+	}
+	quantization->numBits = numBits;
+}
+
+/*
+* MSG_WriteQuantization
+*/
+void MSG_WriteQuantization( msg_t *msg, const msg_quantization_t *quantization ) {
+	for( int i = 0; i < 3; ++i ) {
+		MSG_WriteIntBase128( msg, quantization->mins[i] );
+	}
+	MSG_WriteUint8( msg, quantization->numBits );
+}
+
+/*
+* MSG_ReadQuantization
+*/
+void MSG_ReadQuantization( msg_t *msg, msg_quantization_t *quantization ) {
+	for( int i = 0; i < 3; ++i ) {
+		quantization->mins[i] = (int)MSG_ReadIntBase128( msg );
+	}
+	quantization->numBits = MSG_ReadUint8( msg );
+	if( quantization->numBits <= 0 || quantization->numBits > QUANT_MAX_POSITION_BITS ) {
+		Com_Error( ERR_DROP, "MSG_ReadQuantization: Illegal number of bits %d", quantization->numBits );
+	}
+}
+
+/*
+* A mask of differing bytes of two instances of a struct.
+* Integer fields are tested against this mask instead of being compared one by one.
+*/
+template <size_t Size>
+class ChangedBytesMask {
+	static constexpr size_t kNumWords = ( Size + 63 ) / 64;
+	uint64_t m_words[kNumWords] {};
+public:
+	ChangedBytesMask( const uint8_t *from, const uint8_t *to ) {
+		size_t offset = 0;
+#ifdef WSW_USE_SSE2
+		for(; offset + 16 <= Size; offset += 16 ) {
+			const __m128i xmmFrom = _mm_loadu_si128( (const __m128i *)( from + offset ) );
+			const __m128i xmmTo = _mm_loadu_si128( (const __m128i *)( to + offset ) );
+			const unsigned equalBits = (unsigned)_mm_movemask_epi8( _mm_cmpeq_epi8( xmmFrom, xmmTo ) );
+			m_words[offset / 64] |= (uint64_t)( ~equalBits & 0xFFFFu ) << ( offset % 64 );
+		}
+#endif
+		for(; offset < Size; ++offset ) {
+			if( from[offset] != to[offset] ) {
+				m_words[offset / 64] |= (uint64_t)1 << ( offset % 64 );
+			}
+		}
+	}
+
+	template <size_t Offset, size_t Length>
+	[[nodiscard]]
+	bool hasChanges() const {
+		static_assert( Length > 0 && Offset + Length <= Size );
+		uint64_t changes = 0;
+		for( size_t word = Offset / 64; word <= ( Offset + Length - 1 ) / 64; ++word ) {
+			const size_t wordStart = word * 64;
+			const size_t lo = ( Offset > wordStart ? Offset : wordStart ) - wordStart;
+			const size_t hi = ( Offset + Length < wordStart + 64 ? Offset + Length : wordStart + 64 ) - wordStart;
+			const uint64_t bits = ( hi - lo == 64 ) ? ~(uint64_t)0 : ( ( (uint64_t)1 << ( hi - lo ) ) - 1 ) << lo;
+			changes |= m_words[word] & bits;
+		}
+		return changes != 0;
+	}
+};
+
+/*
+* If packed fields are specified, the quantized encoding becomes available.
+* Changed packed fields are written as a bit-packed block that follows the field mask in this case.
+* A position is written as a small delta of quantized values if possible (otherwise as an absolute value).
+*/
+template <typename Struct, const auto &Fields, const auto &PackedFields = no_packed_fields>
+class DeltaCodec {
+	static constexpr size_t kNumFields = std::size( Fields );
+	static_assert( kNumFields > 0 && kNumFields < 256 );
+	static constexpr size_t kMaskSize = ( kNumFields + 7 ) / 8;
+
+	using ChangedBytes = ChangedBytesMask<sizeof( Struct )>;
+
+	template <int Bits>
+	static constexpr size_t kElemBytes = Bits == 0 ? sizeof( float ) : ( Bits == 1 ? sizeof( bool ) : Bits >> 3 );
+
+	template <int Bits>
+	static bool compareElem( const uint8_t *from, const uint8_t *to ) {
+		static_assert( Bits == 0 || Bits == 1 || Bits == 8 || Bits == 16 || Bits == 32 || Bits == 64 );
+		if constexpr( Bits == 0 ) {
+			return *( (const float *)to ) != *( (const float *)from );
+		} else if constexpr( Bits == 1 ) {
+			return *( (const bool *)to ) != *( (const bool *)from );
+		} else if constexpr( Bits == 8 ) {
+			return *( (const int8_t *)to ) != *( (const int8_t *)from );
+		} else if constexpr( Bits == 16 ) {
+			return *( (const int16_t *)to ) != *( (const int16_t *)from );
+		} else if constexpr( Bits == 32 ) {
+			return *( (const int32_t *)to ) != *( (const int32_t *)from );
+		} else {
+			return *( (const int64_t *)to ) != *( (const int64_t *)from );
+		}
+	}
+
+	template <int Bits, wireType_t Encoding>
+	static void writeElem( msg_t *msg, const uint8_t *to ) {
+		if constexpr( Encoding == WIRE_BOOL ) {
+			// The value is toggled by the reader
+		} else if constexpr( Encoding == WIRE_FIXED_INT8 ) {
+			MSG_WriteInt8( msg, *( (const int8_t *)to ) );
+		} else if constexpr( Encoding == WIRE_FIXED_INT16 ) {
+			MSG_WriteInt16( msg, *( (const int16_t *)to ) );
+		} else if constexpr( Encoding == WIRE_FIXED_INT32 ) {
+			MSG_WriteInt32( msg, *( (const int32_t *)to ) );
+		} else if constexpr( Encoding == WIRE_FIXED_INT64 ) {
+			MSG_WriteInt64( msg, *( (const int64_t *)to ) );
+		} else if constexpr( Encoding == WIRE_FLOAT ) {
+			MSG_WriteFloat( msg, *( (const float *)to ) );
+		} else if constexpr( Encoding == WIRE_HALF_FLOAT ) {
+			MSG_WriteHalfFloat( msg, *( (const float *)to ) );
+		} else if constexpr( Encoding == WIRE_ANGLE ) {
+			MSG_WriteHalfFloat( msg, anglemod( *( (const float *)to ) ) );
+		} else if constexpr( Encoding == WIRE_BASE128 ) {
+			static_assert( Bits == 8 || Bits == 16 || Bits == 32 || Bits == 64 );
+			if constexpr( Bits == 8 ) {
+				MSG_WriteInt8( msg, *( (const int8_t *)to ) );
+			} else if constexpr( Bits == 16 ) {
+				MSG_WriteIntBase128( msg, *( (const int16_t *)to ) );
+			} else if constexpr( Bits == 32 ) {
+				MSG_WriteIntBase128( msg, *( (const int32_t *)to ) );
+			} else {
+				MSG_WriteIntBase128( msg, *( (const int64_t *)to ) );
+			}
+		} else {
+			static_assert( Encoding == WIRE_UBASE128 );
+			static_assert( Bits == 8 || Bits == 16 || Bits == 32 || Bits == 64 );
+			if constexpr( Bits == 8 ) {
+				MSG_WriteUint8( msg, *( (const uint8_t *)to ) );
+			} else if constexpr( Bits == 16 ) {
+				MSG_WriteUintBase128( msg, *( (const uint16_t *)to ) );
+			} else if constexpr( Bits == 32 ) {
+				MSG_WriteUintBase128( msg, *( (const uint32_t *)to ) );
+			} else {
+				MSG_WriteUintBase128( msg, *( (const uint64_t *)to ) );
+			}
+		}
+	}
+
+	template <int Bits, wireType_t Encoding>
+	static void readElem( msg_t *msg, uint8_t *to ) {
+		if constexpr( Encoding == WIRE_BOOL ) {
+			*( (bool *)to ) ^= true;
+		} else if constexpr( Encoding == WIRE_FIXED_INT8 ) {
+			*( (int8_t *)to ) = MSG_ReadInt8( msg );
+		} else if constexpr( Encoding == WIRE_FIXED_INT16 ) {
+			*( (int16_t *)to ) = MSG_ReadInt16( msg );
+		} else if constexpr( Encoding == WIRE_FIXED_INT32 ) {
+			*( (int32_t *)to ) = MSG_ReadInt32( msg );
+		} else if constexpr( Encoding == WIRE_FIXED_INT64 ) {
+			*( (int64_t *)to ) = MSG_ReadInt64( msg );
+		} else if constexpr( Encoding == WIRE_FLOAT ) {
+			*( (float *)to ) = MSG_ReadFloat( msg );
+		} else if constexpr( Encoding == WIRE_HALF_FLOAT || Encoding == WIRE_ANGLE ) {
+			*( (float *)to ) = MSG_ReadHalfFloat( msg );
+		} else if constexpr( Encoding == WIRE_BASE128 ) {
+			static_assert( Bits == 8 || Bits == 16 || Bits == 32 || Bits == 64 );
+			if constexpr( Bits == 8 ) {
+				*( (int8_t *)to ) = MSG_ReadInt8( msg );
+			} else if constexpr( Bits == 16 ) {
+				*( (int16_t *)to ) = MSG_ReadIntBase128( msg );
+			} else if constexpr( Bits == 32 ) {
+				*( (int32_t *)to ) = MSG_ReadIntBase128( msg );
+			} else {
+				*( (int64_t *)to ) = MSG_ReadIntBase128( msg );
+			}
+		} else {
+			static_assert( Encoding == WIRE_UBASE128 );
+			static_assert( Bits == 8 || Bits == 16 || Bits == 32 || Bits == 64 );
+			if constexpr( Bits == 8 ) {
+				*( (uint8_t *)to ) = MSG_ReadUint8( msg );
+			} else if constexpr( Bits == 16 ) {
+				*( (uint16_t *)to ) = MSG_ReadUintBase128( msg );
+			} else if constexpr( Bits == 32 ) {
+				*( (uint32_t *)to ) = MSG_ReadUintBase128( msg );
+			} else {
+				*( (uint64_t *)to ) = MSG_ReadUintBase128( msg );
+			}
+		}
+	}
+
+	template <size_t I>
+	static bool isFieldChanged( const uint8_t *from, const uint8_t *to, const ChangedBytes &changedBytes ) {
+		constexpr msg_field_t field = Fields[I];
+		constexpr size_t elemBytes = kElemBytes<field.bits>;
+		static_assert( field.count > 0 && ( field.bits != 1 || field.count == 1 ) );
+		if constexpr( field.bits == 0 ) {
+			// Floats must be compared as floats (signed zeros are equal, NaNs are not)
+			for( int i = 0; i < field.count; ++i ) {
+				if( compareElem<0>( from + field.offset + i * elemBytes, to + field.offset + i * elemBytes ) ) {
+					return true;
+				}
+			}
+			return false;
+		} else {
+			return changedBytes.template hasChanges<(size_t)field.offset, elemBytes * field.count>();
+		}
+	}
+
+	template <size_t I>
+	static void writeDeltaArray( msg_t *msg, const uint8_t *from, const uint8_t *to ) {
+		constexpr msg_field_t field = Fields[I];
+		constexpr size_t elemBytes = kElemBytes<field.bits>;
+		static_assert( field.count <= 64, "The byte mask of array elements would wrap" );
+
+		uint8_t elemMask[( field.count + 7 ) / 8] = { 0 };
+		unsigned byteMask = 0;
+		for( int i = 0; i < field.count; ++i ) {
+			const size_t elemOffset = field.offset + i * elemBytes;
+			if( compareElem<field.bits>( from + elemOffset, to + elemOffset ) ) {
+				elemMask[i >> 3] |= ( 1 << ( i & 7 ) );
+				byteMask |= ( 1 << ( i >> 3 ) );
+			}
+		}
+
+		if constexpr( field.count <= 8 ) {
+			byteMask = 1;
+		} else {
+			MSG_WriteUintBase128( msg, byteMask );
+		}
+
+		for( size_t b = 0; b < std::size( elemMask ); ++b ) {
+			if( byteMask & ( 1 << b ) ) {
+				MSG_WriteUint8( msg, elemMask[b] );
+			}
+		}
+
+		for( int i = 0; i < field.count; ++i ) {
+			if( elemMask[i >> 3] & ( 1 << ( i & 7 ) ) ) {
+				writeElem<field.bits, field.encoding>( msg, to + field.offset + i * elemBytes );
+			}
+		}
+	}
+
+	template <size_t I>
+	static void readDeltaArray( msg_t *msg, uint8_t *to ) {
+		constexpr msg_field_t field = Fields[I];
+		constexpr size_t elemBytes = kElemBytes<field.bits>;
+
+		uint8_t elemMask[32] = { 0 };
+		unsigned byteMask;
+		if constexpr( field.count <= 8 ) {
+			byteMask = 1;
+		} else {
+			byteMask = MSG_ReadUintBase128( msg );
+		}
+
+		MSG_ReadFieldMask( msg, elemMask, sizeof( elemMask ), byteMask );
+
+		for( size_t b = field.count >> 3; b < std::size( elemMask ); ++b ) {
+			const unsigned excessBits = b == (size_t)( field.count >> 3 ) ? ~0u << ( field.count & 7 ) : ~0u;
+			if( elemMask[b] & excessBits ) {
+				Com_Error( ERR_FATAL, "DeltaCodec::readDeltaArray: an element index >= count" );
+			}
+		}
+
+		for( int i = 0; i < field.count; ++i ) {
+			if( elemMask[i >> 3] & ( 1 << ( i & 7 ) ) ) {
+				readElem<field.bits, field.encoding>( msg, to + field.offset + i * elemBytes );
+			}
+		}
+	}
+
+	static constexpr auto fieldIndexOf( int offset ) -> size_t {
+		for( size_t i = 0; i < kNumFields; ++i ) {
+			if( Fields[i].offset == offset ) {
+				return i;
+			}
+		}
+		return kNumFields;
+	}
+
+	template <size_t I>
+	static constexpr bool isPackedField() {
+		for( const msg_packed_field_t &packedField: PackedFields ) {
+			if( packedField.offset == Fields[I].offset ) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	template <size_t I, bool SkipPacked>
+	static void writeFieldIfChanged( msg_t *msg, const uint8_t *from, const uint8_t *to, const uint8_t *fieldMask ) {
+		if constexpr( !SkipPacked || !isPackedField<I>() ) {
+			if( fieldMask[I >> 3] & ( 1 << ( I & 7 ) ) ) {
+				constexpr msg_field_t field = Fields[I];
+				if constexpr( field.count > 1 ) {
+					writeDeltaArray<I>( msg, from, to );
+				} else {
+					writeElem<field.bits, field.encoding>( msg, to + field.offset );
+				}
+			}
+		}
+	}
+
+	template <size_t I, bool SkipPacked>
+	static void readFieldIfChanged( msg_t *msg, uint8_t *to, const uint8_t *fieldMask ) {
+		if constexpr( !SkipPacked || !isPackedField<I>() ) {
+			if( fieldMask[I >> 3] & ( 1 << ( I & 7 ) ) ) {
+				constexpr msg_field_t field = Fields[I];
+				if constexpr( field.count > 1 ) {
+					readDeltaArray<I>( msg, to );
+				} else {
+					readElem<field.bits, field.encoding>( msg, to + field.offset );
+				}
+			}
+		}
+	}
+
+	template <size_t P>
+	static void writePackedFieldIfChanged( MsgBitWriter *writer, const uint8_t *from, const uint8_t *to,
+										   const uint8_t *fieldMask, const msg_quantization_t *quantization ) {
+		constexpr msg_packed_field_t packedField = PackedFields[P];
+		constexpr size_t I = fieldIndexOf( packedField.offset );
+		static_assert( I < kNumFields && Fields[I].bits == 0 && Fields[I].count == 1 );
+		if( fieldMask[I >> 3] & ( 1 << ( I & 7 ) ) ) {
+			const float value = *( (const float *)( to + packedField.offset ) );
+			if constexpr( packedField.kind == PACKED_ANGLE ) {
+				writer->write( MSG_QuantizeAngle( value ), QUANT_ANGLE_BITS );
+			} else {
+				const int mins = quantization->mins[packedField.axis];
+				const int numBits = quantization->numBits;
+				const float oldValue = *( (const float *)( from + packedField.offset ) );
+				const uint32_t oldQuantized = MSG_QuantizePosition( oldValue, mins, numBits );
+				const uint32_t quantized = MSG_QuantizePosition( value, mins, numBits );
+				const int64_t delta = (int64_t)quantized - (int64_t)oldQuantized;
+				constexpr int64_t maxDelta = ( 1 << ( QUANT_POSITION_DELTA_BITS - 1 ) ) - 1;
+				if( delta >= -maxDelta - 1 && delta <= maxDelta ) {
+					writer->write( 0, 1 );
+					writer->write( (uint32_t)delta, QUANT_POSITION_DELTA_BITS );
+				} else {
+					writer->write( 1, 1 );
+					writer->write( quantized, numBits );
+				}
+			}
+		}
+	}
+
+	template <size_t P>
+	static void readPackedFieldIfChanged( MsgBitReader *reader, uint8_t *to, const uint8_t *fieldMask,
+										  const msg_quantization_t *quantization ) {
+		constexpr msg_packed_field_t packedField = PackedFields[P];
+		constexpr size_t I = fieldIndexOf( packedField.offset );
+		if( fieldMask[I >> 3] & ( 1 << ( I & 7 ) ) ) {
+			float *const value = (float *)( to + packedField.offset );
+			if constexpr( packedField.kind == PACKED_ANGLE ) {
+				*value = MSG_DequantizeAngle( reader->read( QUANT_ANGLE_BITS ) );
+			} else {
+				const int mins = quantization->mins[packedField.axis];
+				const int numBits = quantization->numBits;
+				uint32_t quantized;
+				if( !reader->read( 1 ) ) {
+					// The value is still the value of the state we are delta'ing from
+					const uint32_t oldQuantized = MSG_QuantizePosition( *value, mins, numBits );
+					const auto delta = (int8_t)(uint8_t)reader->read( QUANT_POSITION_DELTA_BITS );
+					quantized = (uint32_t)( (int64_t)oldQuantized + delta );
+				} else {
+					quantized = reader->read( numBits );
+				}
+				*value = MSG_DequantizePosition( quantized, mins );
+			}
+		}
+	}
+
+	template <size_t... I>
+	static void computeFieldMask( const uint8_t *from, const uint8_t *to, uint8_t *fieldMask, std::index_sequence<I...> ) {
+		const ChangedBytes changedBytes( from, to );
+		( ( fieldMask[I >> 3] |= (uint8_t)( isFieldChanged<I>( from, to, changedBytes ) << ( I & 7 ) ) ), ... );
+	}
+
+	template <bool SkipPacked, size_t... I>
+	static void writeFields( msg_t *msg, const uint8_t *from, const uint8_t *to, const uint8_t *fieldMask, std::index_sequence<I...> ) {
+		( writeFieldIfChanged<I, SkipPacked>( msg, from, to, fieldMask ), ... );
+	}
+
+	template <bool SkipPacked, size_t... I>
+	static void readFields( msg_t *msg, uint8_t *to, const uint8_t *fieldMask, std::index_sequence<I...> ) {
+		( readFieldIfChanged<I, SkipPacked>( msg, to, fieldMask ), ... );
+	}
+
+	template <size_t... P>
+	static void writePackedFields( msg_t *msg, const uint8_t *from, const uint8_t *to, const uint8_t *fieldMask,
+								   const msg_quantization_t *quantization, std::index_sequence<P...> ) {
+		MsgBitWriter writer( msg );
+		( writePackedFieldIfChanged<P>( &writer, from, to, fieldMask, quantization ), ... );
+		writer.flush();
+	}
+
+	template <size_t... P>
+	static void readPackedFields( msg_t *msg, uint8_t *to, const uint8_t *fieldMask,
+								  const msg_quantization_t *quantization, std::index_sequence<P...> ) {
+		MsgBitReader reader( msg );
+		( readPackedFieldIfChanged<P>( &reader, to, fieldMask, quantization ), ... );
+	}
+
+	static constexpr bool kHasPackedFields = PackedFields[0].offset >= 0;
+public:
+	/*
+	* Fills the field mask (which must be zeroed) and returns the byte mask.
+	*/
+	static unsigned compare( const Struct *from, const Struct *to, uint8_t *fieldMask ) {
+		computeFieldMask( (const uint8_t *)from, (const uint8_t *)to, fieldMask, std::make_index_sequence<kNumFields>() );
+		unsigned byteMask = 0;
+		for( size_t b = 0; b < kMaskSize; ++b ) {
+			if( fieldMask[b] ) {
+				byteMask |= ( 1 << ( b & 7 ) );
+			}
+		}
+		return byteMask;
+	}
+
+	/*
+	* Writes the field mask bytes specified by the byte mask and changed fields.
+	* Packed fields get quantized if the quantization is specified.
+	*/
+	static void writeFields( msg_t *msg, const Struct *from, const Struct *to, const uint8_t *fieldMask, unsigned byteMask,
+							 const msg_quantization_t *quantization = nullptr ) {
+		MSG_WriteFieldMask( msg, fieldMask, byteMask );
+		const auto *const fromBytes = (const uint8_t *)from;
+		const auto *const toBytes = (const uint8_t *)to;
+		if constexpr( kHasPackedFields ) {
+			if( quantization ) {
+				writePackedFields( msg, fromBytes, toBytes, fieldMask, quantization, std::make_index_sequence<std::size( PackedFields )>() );
+				writeFields<true>( msg, fromBytes, toBytes, fieldMask, std::make_index_sequence<kNumFields>() );
+				return;
+			}
+		}
+		writeFields<false>( msg, fromBytes, toBytes, fieldMask, std::make_index_sequence<kNumFields>() );
+	}
+
+	/*
+	* Reads the field mask bytes specified by the byte mask and changed fields.
+	* The struct must be initialized by the state we are delta'ing from.
+	*/
+	static void readFields( msg_t *msg, Struct *to, unsigned byteMask, const msg_quantization_t *quantization = nullptr ) {
+		uint8_t fieldMask[32] = { 0 };
+		MSG_ReadFieldMask( msg, fieldMask, sizeof( fieldMask ), byteMask );
+
+		for( size_t b = kNumFields >> 3; b < std::size( fieldMask ); ++b ) {
+			const unsigned excessBits = b == ( kNumFields >> 3 ) ? ~0u << ( kNumFields & 7 ) : ~0u;
+			if( fieldMask[b] & excessBits ) {
+				Com_Error( ERR_FATAL, "DeltaCodec::readFields: a field index >= numFields" );
+			}
+		}
+
+		auto *const toBytes = (uint8_t *)to;
+		if constexpr( kHasPackedFields ) {
+			if( quantization ) {
+				readPackedFields( msg, toBytes, fieldMask, quantization, std::make_index_sequence<std::size( PackedFields )>() );
+				readFields<true>( msg, toBytes, fieldMask, std::make_index_sequence<kNumFields>() );
+				return;
+			}
+		}
+		readFields<false>( msg, toBytes, fieldMask, std::make_index_sequence<kNumFields>() );
+	}
+
+	/*
+	* An equivalent of MSG_WriteDeltaStruct()
+	*/
+	static void writeDelta( msg_t *msg, const Struct *from, const Struct *to ) {
+		uint8_t fieldMask[kMaskSize] = { 0 };
+		unsigned byteMask = compare( from, to, fieldMask );
+		if constexpr( kNumFields <= 8 ) {
+			// we don't need the byteMask in case all field bits fit a single byte
+			byteMask = 1;
+		} else {
+			MSG_WriteUintBase128( msg, byteMask );
+		}
+		writeFields( msg, from, to, fieldMask, byteMask );
+	}
+
+	/*
+	* An equivalent of MSG_ReadDeltaStruct()
+	*/
+	static void readDelta( msg_t *msg, const Struct *from, Struct *to ) {
+		memcpy( (void *)to, (const void *)from, sizeof( Struct ) );
+		unsigned byteMask;
+		if constexpr( kNumFields <= 8 ) {
+			byteMask = 1;
+		} else {
+			byteMask = MSG_ReadUintBase128( msg );
+		}
+		readFields( msg, to, byteMask );
+	}
+};
+
 //==================================================
 // DELTA ENTITIES
 //==================================================
 
 #define ESOFS( x ) offsetof( entity_state_t,x )
 
-static const msg_field_t ent_state_fields[] = {
+static constexpr msg_field_t ent_state_fields[] = {
 	{ ESOFS( events[0] ), 32, 1, WIRE_UBASE128 },
 	{ ESOFS( eventParms[0] ), 32, 1, WIRE_BASE128 },
 
@@ -974,6 +1599,25 @@ static const msg_field_t ent_state_fields[] = {
 	{ ESOFS( light ), 32, 1, WIRE_FIXED_INT32 },
 };
 
+static constexpr msg_packed_field_t ent_state_packed_fields[] = {
+	{ ESOFS( origin[0] ), PACKED_POSITION, 0 },
+	{ ESOFS( origin[1] ), PACKED_POSITION, 1 },
+	{ ESOFS( origin[2] ), PACKED_POSITION, 2 },
+
+	{ ESOFS( angles[0] ), PACKED_ANGLE, 0 },
+	{ ESOFS( angles[1] ), PACKED_ANGLE, 0 },
+	{ ESOFS( angles[2] ), PACKED_ANGLE, 0 },
+
+	// Note: origin2 must not be packed as it often holds velocities and directions that would get clamped/truncated
+};
+
+using EntityStateCodec = DeltaCodec<entity_state_t, ent_state_fields, ent_state_packed_fields>;
+
+const msg_field_t *MSG_GetEntityStateFields( size_t *numFields ) {
+	*numFields = std::size( ent_state_fields );
+	return ent_state_fields;
+}
+
 /*
 * MSG_WriteEntityNumber
 */
@@ -988,17 +1632,11 @@ static void MSG_WriteEntityNumber( msg_t *msg, int number, bool remove, unsigned
 * Writes part of a packetentities message.
 * Can delta from either a baseline or a previous packet_entity
 */
-void MSG_WriteDeltaEntity( msg_t *msg, const entity_state_t *from, const entity_state_t *to, bool force ) {
+void MSG_WriteDeltaEntity( msg_t *msg, const entity_state_t *from, const entity_state_t *to, bool force,
+						   const msg_quantization_t *quantization ) {
 	int number;
 	unsigned byteMask;
 	uint8_t fieldMask[32] = { 0 };
-	const msg_field_t *fields = ent_state_fields;
-	int numFields = sizeof( ent_state_fields ) / sizeof( ent_state_fields[0] );
-
-	assert( numFields < 256 );
-	if( numFields > 256 ) {
-		Com_Error( ERR_FATAL, "MSG_WriteDeltaEntity: numFields == %i", numFields );
-	}
 
 	if( !to ) {
 		if( !from )
@@ -1022,7 +1660,7 @@ void MSG_WriteDeltaEntity( msg_t *msg, const entity_state_t *from, const entity_
 		return;
 	}
 
-	byteMask = MSG_CompareStructs( from, to, fields, numFields, fieldMask, sizeof( fieldMask ) );
+	byteMask = EntityStateCodec::compare( from, to, fieldMask );
 	if( !byteMask && !force ) {
 		// no changes
 		return;
@@ -1030,9 +1668,7 @@ void MSG_WriteDeltaEntity( msg_t *msg, const entity_state_t *from, const entity_
 
 	MSG_WriteEntityNumber( msg, number, false, byteMask );
 
-	MSG_WriteFieldMask( msg, fieldMask, byteMask );
-
-	MSG_WriteStructFields( msg, from, to, fields, numFields, fieldMask, byteMask );
+	EntityStateCodec::writeFields( msg, from, to, fieldMask, byteMask, quantization );
 }
 
 /*
@@ -1056,18 +1692,13 @@ int MSG_ReadEntityNumber( msg_t *msg, bool *remove, unsigned *byteMask ) {
 *
 * Can go from either a baseline or a previous packet_entity
 */
-void MSG_ReadDeltaEntity( msg_t *msg, const entity_state_t *from, entity_state_t *to, int number, unsigned byteMask ) {
-	uint8_t fieldMask[32] = { 0 };
-	const msg_field_t *fields = ent_state_fields;
-	int numFields = sizeof( ent_state_fields ) / sizeof( ent_state_fields[0] );
-
+void MSG_ReadDeltaEntity( msg_t *msg, const entity_state_t *from, entity_state_t *to, int number, unsigned byteMask,
+						  const msg_quantization_t *quantization ) {
 	// set everything to the state we are delta'ing from
 	*to = *from;
 	to->number = number;
-	
-	MSG_ReadFieldMask( msg, fieldMask, sizeof( fieldMask ), byteMask );
 
-	MSG_ReadStructFields( msg, from, to, fields, numFields, fieldMask, sizeof( fieldMask ), byteMask );
+	EntityStateCodec::readFields( msg, to, byteMask, quantization );
 }
 
 //==================================================
@@ -1118,7 +1749,7 @@ void MSG_ReadDeltaUsercmd( msg_t *msg, const usercmd_t *from, usercmd_t *move )
 
 #define PSOFS( x ) offsetof( player_state_t,x )
 
-static const msg_field_t player_state_msg_fields[] = {
+static constexpr msg_field_t player_state_msg_fields[] = {
 	{ PSOFS( pmove.pm_type ), 32, 1, WIRE_UBASE128 },
 
 	{ PSOFS( pmove.origin[0] ), 0, 1, WIRE_FLOAT },
@@ -1169,35 +1800,37 @@ static const msg_field_t player_state_msg_fields[] = {
 	{ PSOFS( inventory ), 32, MAX_ITEMS, WIRE_UBASE128 },
 };
 
+using PlayerStateCodec = DeltaCodec<player_state_t, player_state_msg_fields>;
+
+const msg_field_t *MSG_GetPlayerStateFields( size_t *numFields ) {
+	*numFields = std::size( player_state_msg_fields );
+	return player_state_msg_fields;
+}
+
 /*
 * MSG_WriteDeltaPlayerstate
 */
 void MSG_WriteDeltaPlayerState( msg_t *msg, const player_state_t *ops, const player_state_t *ps ) {
-	int numFields = sizeof( player_state_msg_fields ) / sizeof( player_state_msg_fields[0] );
-	const msg_field_t *fields = player_state_msg_fields;
 	static player_state_t dummy;
 
 	if( !ops ) {
 		ops = &dummy;
 	}
 
-	MSG_WriteDeltaStruct( msg, ops, ps, fields, numFields );
+	PlayerStateCodec::writeDelta( msg, ops, ps );
 }
 
 /*
 * MSG_ReadDeltaPlayerstate
 */
 void MSG_ReadDeltaPlayerState( msg_t *msg, const player_state_t *ops, player_state_t *ps ) {
-	int numFields = sizeof( player_state_msg_fields ) / sizeof( player_state_msg_fields[0] );
-	const msg_field_t *fields = player_state_msg_fields;
 	static player_state_t dummy;
 
 	if( !ops ) {
 		ops = &dummy;
 	}
-	memcpy( ps, ops, sizeof( player_state_t ) );
 
-	MSG_ReadDeltaStruct( msg, ops, ps, sizeof( player_state_t ), fields, numFields );
+	PlayerStateCodec::readDelta( msg, ops, ps );
 }
 
 //==================================================
@@ -1206,38 +1839,41 @@ void MSG_ReadDeltaPlayerState( msg_t *msg, const player_state_t *ops, player_sta
 
 #define GSOFS( x ) offsetof( game_state_t,x )
 
-static const msg_field_t game_state_msg_fields[] = {
+static constexpr msg_field_t game_state_msg_fields[] = {
 	{ GSOFS( stats ), 64, MAX_GAME_STATS, WIRE_BASE128 },
 };
 
+using GameStateCodec = DeltaCodec<game_state_t, game_state_msg_fields>;
+
+const msg_field_t *MSG_GetGameStateFields( size_t *numFields ) {
+	*numFields = std::size( game_state_msg_fields );
+	return game_state_msg_fields;
+}
+
 /*
 * MSG_WriteDeltaGameState
 */
 void MSG_WriteDeltaGameState( msg_t *msg, const game_state_t *from, const game_state_t *to ) {
-	int numFields = sizeof( game_state_msg_fields ) / sizeof( game_state_msg_fields[0] );
-	const msg_field_t *fields = game_state_msg_fields;
 	static game_state_t dummy;
 
 	if( !from ) {
 		from = &dummy;
 	}
 
-	MSG_WriteDeltaStruct( msg, from, to, fields, numFields );
+	GameStateCodec::writeDelta( msg, from, to );
 }
 
 /*
 * MSG_ReadDeltaGameState
 */
 void MSG_ReadDeltaGameState( msg_t *msg, const game_state_t *from, game_state_t *to ) {
-	int numFields = sizeof( game_state_msg_fields ) / sizeof( game_state_msg_fields[0] );
-	const msg_field_t *fields = game_state_msg_fields;
 	static game_state_t dummy;
 
 	if( !from ) {
 		from = &dummy;
 	}
 
-	MSG_ReadDeltaStruct( msg, from, to, sizeof( game_state_t ), fields, numFields );
+	GameStateCodec::readDelta( msg, from, to );
 }
 
 static const msg_field_t raw_scoreboard_msg_fields[] = {
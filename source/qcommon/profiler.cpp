@@ -0,0 +1,421 @@
+#include "profiler.h"
+#include "qcommon.h"
+#include "wswstaticstring.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <new>
+#include <vector>
+
+static constexpr unsigned kMaxThreads = 64;
+static constexpr unsigned kMaxNodesPerThread = 128;
+static constexpr unsigned kMaxScopeDepth = 32;
+static constexpr unsigned kHistorySize = 256;
+static constexpr size_t kMaxTraceEventsPerThread = 1u << 20;
+
+struct ProfilerNode {
+	char name[48];
+	int parent;
+	int depth;
+	// Modified only by the owner thread but could be read by the main thread concurrently
+	std::atomic<int> firstChild { -1 };
+	std::atomic<int> nextSibling { -1 };
+	// Accumulated by the owner thread, consumed by the main thread at the frame end
+	std::atomic<uint64_t> frameNanos { 0 };
+	std::atomic<uint32_t> frameCalls { 0 };
+	// Accessed only by the main thread
+	uint64_t nanosHistory[kHistorySize];
+	uint32_t callsHistory[kHistorySize];
+};
+
+struct TraceEvent {
+	uint64_t startNanos;
+	uint64_t durationNanos;
+	int node;
+};
+
+struct ProfilerThreadState {
+	ProfilerNode nodes[kMaxNodesPerThread];
+	std::atomic<unsigned> numNodes { 0 };
+
+	// Node indices and start timestamps of opened scopes. A negative index stands for a dropped scope.
+	int scopeStack[kMaxScopeDepth];
+	uint64_t scopeStartNanos[kMaxScopeDepth];
+	unsigned scopeDepth { 0 };
+	// Scopes opened above the maximal depth
+	unsigned numOverflowScopes { 0 };
+
+	std::mutex traceMutex;
+	std::vector<TraceEvent> traceEvents;
+
+	wsw::StaticString<32> name;
+	unsigned threadNum { 0 };
+};
+
+static std::mutex g_registryMutex;
+static ProfilerThreadState *g_threadStates[kMaxThreads];
+static std::atomic<unsigned> g_numThreadStates { 0 };
+static thread_local ProfilerThreadState *tl_threadState;
+
+static std::atomic<bool> g_enabled { false };
+static std::atomic<bool> g_tracing { false };
+
+// These vars are accessed only by the main thread
+static cvar_t *sv_profiler;
+static uint64_t g_frameNum;
+static bool g_isInFrame;
+static unsigned g_traceFramesLeft;
+static wsw::StaticString<MAX_QPATH> g_traceFileName;
+static uint64_t g_traceStartNanos;
+
+static inline uint64_t Prof_Nanoseconds() {
+	const auto sinceEpoch = std::chrono::steady_clock::now().time_since_epoch();
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>( sinceEpoch ).count();
+}
+
+static auto Prof_ThreadState() -> ProfilerThreadState * {
+	if( tl_threadState ) {
+		return tl_threadState;
+	}
+
+	[[maybe_unused]] std::lock_guard<std::mutex> lock( g_registryMutex );
+	const unsigned threadNum = g_numThreadStates.load( std::memory_order_relaxed );
+	if( threadNum >= kMaxThreads ) {
+		return nullptr;
+	}
+
+	// Never freed as threads may hold pointers to their states for their entire lifetime
+	auto *const state = new ProfilerThreadState;
+	state->threadNum = threadNum;
+	(void)state->name.assignf( "thread %u", threadNum );
+	g_threadStates[threadNum] = state;
+	g_numThreadStates.store( threadNum + 1, std::memory_order_release );
+	tl_threadState = state;
+	return state;
+}
+
+static int Prof_FindOrAddNode( ProfilerThreadState *state, int parent, const char *name ) {
+	const unsigned numNodes = state->numNodes.load( std::memory_order_relaxed );
+	if( parent < 0 ) {
+		// Roots are not linked, check them all
+		for( unsigned i = 0; i < numNodes; ++i ) {
+			if( state->nodes[i].parent < 0 && !strcmp( state->nodes[i].name, name ) ) {
+				return (int)i;
+			}
+		}
+	} else {
+		int child = state->nodes[parent].firstChild.load( std::memory_order_relaxed );
+		for(; child >= 0; child = state->nodes[child].nextSibling.load( std::memory_order_relaxed ) ) {
+			if( !strcmp( state->nodes[child].name, name ) ) {
+				return child;
+			}
+		}
+	}
+
+	if( numNodes >= kMaxNodesPerThread ) {
+		return -1;
+	}
+
+	ProfilerNode *const node = &state->nodes[numNodes];
+	Q_strncpyz( node->name, name, sizeof( node->name ) );
+	node->parent = parent;
+	node->depth = parent >= 0 ? state->nodes[parent].depth + 1 : 0;
+	std::fill( std::begin( node->nanosHistory ), std::end( node->nanosHistory ), 0 );
+	std::fill( std::begin( node->callsHistory ), std::end( node->callsHistory ), 0 );
+	if( parent >= 0 ) {
+		node->nextSibling.store( state->nodes[parent].firstChild.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+		state->nodes[parent].firstChild.store( (int)numNodes, std::memory_order_relaxed );
+	}
+
+	state->numNodes.store( numNodes + 1, std::memory_order_release );
+	return (int)numNodes;
+}
+
+bool Prof_IsEnabled() {
+	return g_enabled.load( std::memory_order_relaxed );
+}
+
+void Prof_SetThreadName( const char *name ) {
+	if( ProfilerThreadState *state = Prof_ThreadState() ) {
+		[[maybe_unused]] std::lock_guard<std::mutex> lock( g_registryMutex );
+		state->name.assign( wsw::StringView( name ).take( state->name.capacity() - 1 ) );
+	}
+}
+
+void Prof_BeginScope( const char *name ) {
+	ProfilerThreadState *const state = Prof_ThreadState();
+	if( !state ) {
+		return;
+	}
+
+	if( state->scopeDepth == kMaxScopeDepth ) {
+		state->numOverflowScopes++;
+		return;
+	}
+
+	int node = -1;
+	if( !state->scopeDepth ) {
+		node = Prof_FindOrAddNode( state, -1, name );
+	} else if( const int parent = state->scopeStack[state->scopeDepth - 1]; parent >= 0 ) {
+		node = Prof_FindOrAddNode( state, parent, name );
+	}
+
+	state->scopeStack[state->scopeDepth] = node;
+	state->scopeStartNanos[state->scopeDepth] = Prof_Nanoseconds();
+	state->scopeDepth++;
+}
+
+void Prof_EndScope() {
+	ProfilerThreadState *const state = tl_threadState;
+	if( !state ) {
+		return;
+	}
+
+	if( state->numOverflowScopes ) {
+		state->numOverflowScopes--;
+		return;
+	}
+
+	assert( state->scopeDepth > 0 );
+	state->scopeDepth--;
+
+	const int node = state->scopeStack[state->scopeDepth];
+	if( node < 0 ) {
+		return;
+	}
+
+	const uint64_t startNanos = state->scopeStartNanos[state->scopeDepth];
+	const uint64_t durationNanos = Prof_Nanoseconds() - startNanos;
+	state->nodes[node].frameNanos.fetch_add( durationNanos, std::memory_order_relaxed );
+	state->nodes[node].frameCalls.fetch_add( 1, std::memory_order_relaxed );
+
+	if( g_tracing.load( std::memory_order_relaxed ) ) {
+		[[maybe_unused]] std::lock_guard<std::mutex> lock( state->traceMutex );
+		if( state->traceEvents.size() < kMaxTraceEventsPerThread ) {
+			state->traceEvents.emplace_back( TraceEvent { startNanos, durationNanos, node } );
+		}
+	}
+}
+
+static void Prof_WriteTraceFile() {
+	int file;
+	if( FS_FOpenFile( g_traceFileName.data(), &file, FS_WRITE ) == -1 ) {
+		Com_Printf( S_COLOR_RED "Failed to open %s for writing\n", g_traceFileName.data() );
+		return;
+	}
+
+	size_t numEvents = 0;
+	const char *separator = "";
+	FS_Printf( file, "{\"traceEvents\":[\n" );
+
+	const unsigned numThreadStates = g_numThreadStates.load( std::memory_order_acquire );
+	for( unsigned i = 0; i < numThreadStates; ++i ) {
+		ProfilerThreadState *const state = g_threadStates[i];
+		FS_Printf( file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+				   separator, state->threadNum, state->name.data() );
+		separator = ",\n";
+
+		[[maybe_unused]] std::lock_guard<std::mutex> lock( state->traceMutex );
+		for( const TraceEvent &event: state->traceEvents ) {
+			// Events could be started prior to the trace start
+			const double startMicros = ( (double)event.startNanos - (double)g_traceStartNanos ) * 1e-3;
+			FS_Printf( file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+					   state->nodes[event.node].name, state->threadNum, startMicros, (double)event.durationNanos * 1e-3 );
+		}
+		numEvents += state->traceEvents.size();
+		state->traceEvents.clear();
+		state->traceEvents.shrink_to_fit();
+	}
+
+	FS_Printf( file, "\n]}\n" );
+	FS_FCloseFile( file );
+
+	Com_Printf( "Wrote %u trace events to %s\n", (unsigned)numEvents, g_traceFileName.data() );
+}
+
+static void Prof_DiscardAbortedFrame() {
+	// Scopes of the main thread are left open if the frame has been aborted by longjmp() on ERR_DROP.
+	// Other threads close their scopes regularly as jobs can't be aborted this way.
+	if( ProfilerThreadState *state = tl_threadState ) {
+		state->scopeDepth = 0;
+		state->numOverflowScopes = 0;
+	}
+
+	// Don't mix partial results of the aborted frame with the next one
+	const unsigned numThreadStates = g_numThreadStates.load( std::memory_order_acquire );
+	for( unsigned i = 0; i < numThreadStates; ++i ) {
+		ProfilerThreadState *const state = g_threadStates[i];
+		const unsigned numNodes = state->numNodes.load( std::memory_order_acquire );
+		for( unsigned j = 0; j < numNodes; ++j ) {
+			state->nodes[j].frameNanos.store( 0, std::memory_order_relaxed );
+			state->nodes[j].frameCalls.store( 0, std::memory_order_relaxed );
+		}
+	}
+
+	g_isInFrame = false;
+}
+
+void Prof_BeginFrame() {
+	if( g_isInFrame ) {
+		Prof_DiscardAbortedFrame();
+	}
+
+	g_enabled.store( sv_profiler && sv_profiler->integer, std::memory_order_relaxed );
+	if( !Prof_IsEnabled() ) {
+		if( g_tracing.load( std::memory_order_relaxed ) ) {
+			g_tracing.store( false, std::memory_order_relaxed );
+			Prof_WriteTraceFile();
+		}
+		return;
+	}
+
+	g_isInFrame = true;
+	Prof_BeginScope( "frame" );
+}
+
+void Prof_EndFrame() {
+	if( !g_isInFrame ) {
+		return;
+	}
+
+	Prof_EndScope();
+	g_isInFrame = false;
+
+	const unsigned historyIndex = (unsigned)( g_frameNum % kHistorySize );
+	g_frameNum++;
+
+	const unsigned numThreadStates = g_numThreadStates.load( std::memory_order_acquire );
+	for( unsigned i = 0; i < numThreadStates; ++i ) {
+		ProfilerThreadState *const state = g_threadStates[i];
+		const unsigned numNodes = state->numNodes.load( std::memory_order_acquire );
+		for( unsigned j = 0; j < numNodes; ++j ) {
+			ProfilerNode *const node = &state->nodes[j];
+			node->nanosHistory[historyIndex] = node->frameNanos.exchange( 0, std::memory_order_relaxed );
+			node->callsHistory[historyIndex] = node->frameCalls.exchange( 0, std::memory_order_relaxed );
+		}
+	}
+
+	if( g_tracing.load( std::memory_order_relaxed ) ) {
+		if( !--g_traceFramesLeft ) {
+			g_tracing.store( false, std::memory_order_relaxed );
+			Prof_WriteTraceFile();
+		}
+	}
+}
+
+static void Prof_PrintNode( const ProfilerThreadState *state, int nodeNum, unsigned numSamples ) {
+	const ProfilerNode &node = state->nodes[nodeNum];
+
+	uint64_t samples[kHistorySize];
+	uint64_t totalCalls = 0;
+	for( unsigned i = 0; i < numSamples; ++i ) {
+		samples[i] = node.nanosHistory[i];
+		totalCalls += node.callsHistory[i];
+	}
+
+	auto percentile = [&]( unsigned percents ) -> double {
+		const unsigned index = ( ( numSamples - 1 ) * percents ) / 100;
+		std::nth_element( samples, samples + index, samples + numSamples );
+		return (double)samples[index] * 1e-6;
+	};
+
+	const double p50 = percentile( 50 );
+	const double p95 = percentile( 95 );
+	const double p99 = percentile( 99 );
+	const double max = (double)*std::max_element( samples, samples + numSamples ) * 1e-6;
+	const double callsPerFrame = (double)totalCalls / numSamples;
+
+	Com_Printf( "%*s%-*s p50 %8.3f p95 %8.3f p99 %8.3f max %8.3f ms, %.1f calls/frame\n",
+				2 * node.depth, "", 40 - 2 * node.depth, node.name, p50, p95, p99, max, callsPerFrame );
+
+	// Note: children are linked in the reverse order of addition
+	int children[kMaxNodesPerThread];
+	unsigned numChildren = 0;
+	for( int child = node.firstChild.load( std::memory_order_relaxed ); child >= 0; ) {
+		children[numChildren++] = child;
+		child = state->nodes[child].nextSibling.load( std::memory_order_relaxed );
+	}
+	while( numChildren ) {
+		Prof_PrintNode( state, children[--numChildren], numSamples );
+	}
+}
+
+static void Prof_Report_f() {
+	if( !g_frameNum ) {
+		Com_Printf( "No profiling data. Set sv_profiler to 1 to enable collecting it\n" );
+		return;
+	}
+
+	const unsigned numSamples = (unsigned)wsw::min( g_frameNum, (uint64_t)kHistorySize );
+	Com_Printf( "Per-frame timings over the last %u frames:\n", numSamples );
+
+	[[maybe_unused]] std::lock_guard<std::mutex> lock( g_registryMutex );
+	const unsigned numThreadStates = g_numThreadStates.load( std::memory_order_acquire );
+	for( unsigned i = 0; i < numThreadStates; ++i ) {
+		const ProfilerThreadState *state = g_threadStates[i];
+		const unsigned numNodes = state->numNodes.load( std::memory_order_acquire );
+		if( !numNodes ) {
+			continue;
+		}
+		Com_Printf( "%s:\n", state->name.data() );
+		for( unsigned j = 0; j < numNodes; ++j ) {
+			if( state->nodes[j].parent < 0 ) {
+				Prof_PrintNode( state, (int)j, numSamples );
+			}
+		}
+	}
+}
+
+static void Prof_Trace_f() {
+	if( Cmd_Argc() < 2 ) {
+		Com_Printf( "Usage: %s <filename> [numframes]\n", Cmd_Argv( 0 ) );
+		return;
+	}
+	if( !Prof_IsEnabled() ) {
+		Com_Printf( "The profiler is disabled. Set sv_profiler to 1 to enable it\n" );
+		return;
+	}
+	if( g_tracing.load( std::memory_order_relaxed ) ) {
+		Com_Printf( "A trace capture is already in progress\n" );
+		return;
+	}
+
+	char fileName[MAX_QPATH];
+	Q_snprintfz( fileName, sizeof( fileName ), "profiler/%s", Cmd_Argv( 1 ) );
+	COM_SanitizeFilePath( fileName );
+	if( !COM_ValidateRelativeFilename( fileName ) ) {
+		Com_Printf( "Invalid filename\n" );
+		return;
+	}
+	COM_DefaultExtension( fileName, ".json", sizeof( fileName ) );
+	g_traceFileName.assign( wsw::StringView( fileName ) );
+
+	g_traceFramesLeft = Cmd_Argc() > 2 ? wsw::max( 1, atoi( Cmd_Argv( 2 ) ) ) : 100;
+	g_traceStartNanos = Prof_Nanoseconds();
+	g_tracing.store( true, std::memory_order_relaxed );
+
+	Com_Printf( "Capturing a trace of %u frames to %s\n", g_traceFramesLeft, g_traceFileName.data() );
+}
+
+void Prof_Init() {
+	sv_profiler = Cvar_Get( "sv_profiler", "0", 0 );
+
+	Prof_SetThreadName( "main" );
+
+	Cmd_AddCommand( "sv_profiler_report", Prof_Report_f );
+	Cmd_AddCommand( "sv_profiler_trace", Prof_Trace_f );
+}
+
+void Prof_Shutdown() {
+	if( g_tracing.load( std::memory_order_relaxed ) ) {
+		g_tracing.store( false, std::memory_order_relaxed );
+		Prof_WriteTraceFile();
+	}
+
+	g_enabled.store( false, std::memory_order_relaxed );
+
+	Cmd_RemoveCommand( "sv_profiler_report" );
+	Cmd_RemoveCommand( "sv_profiler_trace" );
+}
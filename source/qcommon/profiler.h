@@ -0,0 +1,58 @@
+#ifndef WSW_5657b6e9_e010_48c7_95fc_a88e5150c9a6_H
+#define WSW_5657b6e9_e010_48c7_95fc_a88e5150c9a6_H
+
+/**
+ * A lightweight hierarchical profiler.
+ * Scopes are identified by their names and nesting, each thread has its own tree of scopes.
+ * Timings are accumulated per frame (which is defined by the main thread)
+ * and a rolling window of per-frame values is kept for every scope.
+ * Collected data could be printed as percentiles or captured as a Chrome trace file
+ * (see the {@code sv_profiler_report} and {@code sv_profiler_trace} commands).
+ * Profiling is disabled unless the {@code sv_profiler} variable is set.
+ */
+
+void Prof_Init();
+void Prof_Shutdown();
+
+[[nodiscard]]
+bool Prof_IsEnabled();
+
+//! Should be called by the main thread. Starts a new frame and opens the root scope of the main thread.
+void Prof_BeginFrame();
+//! Closes the main thread root scope and rolls per-frame values of all threads into the history.
+void Prof_EndFrame();
+
+//! Names are copied once for every new scope, so these strings do not have to outlive a game module.
+void Prof_BeginScope( const char *name );
+void Prof_EndScope();
+
+//! Sets the name displayed for the calling thread.
+void Prof_SetThreadName( const char *name );
+
+namespace wsw {
+
+class ProfilerScope {
+	const bool m_active;
+public:
+	explicit ProfilerScope( const char *name ) : m_active( Prof_IsEnabled() ) {
+		if( m_active ) {
+			Prof_BeginScope( name );
+		}
+	}
+	~ProfilerScope() {
+		if( m_active ) {
+			Prof_EndScope();
+		}
+	}
+
+	ProfilerScope( const ProfilerScope & ) = delete;
+	auto operator=( const ProfilerScope & ) -> ProfilerScope & = delete;
+};
+
+}
+
+#define WSW_PROFILER_CONCAT_( a, b ) a##b
+#define WSW_PROFILER_CONCAT( a, b ) WSW_PROFILER_CONCAT_( a, b )
+#define WSW_PROFILER_SCOPE( name ) const wsw::ProfilerScope WSW_PROFILER_CONCAT( profilerScope_, __LINE__ )( name )
+
+#endif
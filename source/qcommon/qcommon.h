@@ -92,7 +92,8 @@ void MSG_WriteHalfFloat( msg_t *sb, float f );
 void MSG_WriteString( msg_t *sb, const char *s );
 #define MSG_WriteAngle16( sb, f ) ( MSG_WriteInt16( ( sb ), ANGLE2SHORT( ( f ) ) ) )
 void MSG_WriteDeltaUsercmd( msg_t *sb, const struct usercmd_s *from, struct usercmd_s *cmd );
-void MSG_WriteDeltaEntity( msg_t *msg, const struct entity_state_s *from, const struct entity_state_s *to, bool force );
+void MSG_WriteDeltaEntity( msg_t *msg, const struct entity_state_s *from, const struct entity_state_s *to, bool force,
+						   const msg_quantization_t *quantization = nullptr );
 void MSG_WriteDeltaPlayerState( msg_t *msg, const player_state_t *ops, const player_state_t *ps );
 void MSG_WriteDeltaGameState( msg_t *msg, const game_state_t *from, const game_state_t *to );
 void MSG_WriteDeltaScoreboardData( msg_t *msg, const ReplicatedScoreboardData *from, const ReplicatedScoreboardData *to );
@@ -115,7 +116,8 @@ char *MSG_ReadStringLine( msg_t *sb );
 #define MSG_ReadAngle16( sb ) ( SHORT2ANGLE( MSG_ReadInt16( ( sb ) ) ) )
 void MSG_ReadDeltaUsercmd( msg_t *sb, const struct usercmd_s *from, struct usercmd_s *cmd );
 int MSG_ReadEntityNumber( msg_t *msg, bool *remove, unsigned *byteMask );
-void MSG_ReadDeltaEntity( msg_t *msg, const entity_state_t *from, entity_state_t *to, int number, unsigned byteMask );
+void MSG_ReadDeltaEntity( msg_t *msg, const entity_state_t *from, entity_state_t *to, int number, unsigned byteMask,
+						  const msg_quantization_t *quantization = nullptr );
 void MSG_ReadDeltaPlayerState( msg_t *msg, const player_state_t *ops, player_state_t *ps );
 void MSG_ReadDeltaGameState( msg_t *msg, const game_state_t *from, game_state_t *to );
 void MSG_ReadDeltaScoreboardData( msg_t *msg, const ReplicatedScoreboardData *from, ReplicatedScoreboardData *to );
@@ -123,6 +125,17 @@ void MSG_ReadDir( msg_t *sb, vec3_t vector );
 void MSG_ReadData( msg_t *sb, void *buffer, size_t length );
 void MSG_ReadDeltaStruct( msg_t *msg, const void *from, void *to, size_t size, const msg_field_t *fields, size_t numFields );
 int MSG_BytesLeft( const msg_t *msg );
+
+// Field tables of states that have specialized delta codecs.
+// The generic MSG_WriteDeltaStruct()/MSG_ReadDeltaStruct() must produce the same results for these tables.
+const msg_field_t *MSG_GetEntityStateFields( size_t *numFields );
+const msg_field_t *MSG_GetPlayerStateFields( size_t *numFields );
+const msg_field_t *MSG_GetGameStateFields( size_t *numFields );
+
+// Quantized entity positions are stored relative to the given bounds with a 1/8 unit precision
+void MSG_SetupQuantization( msg_quantization_t *quantization, const vec3_t mins, const vec3_t maxs );
+void MSG_WriteQuantization( msg_t *msg, const msg_quantization_t *quantization );
+void MSG_ReadQuantization( msg_t *msg, msg_quantization_t *quantization );
 //============================================================================
 
 typedef struct purelist_s {
@@ -150,8 +163,9 @@ struct snapshot_s *SNAP_ParseFrame( struct msg_s *msg, struct snapshot_s *lastFr
 
 void SNAP_WriteFrameSnapToClient( const struct ginfo_s *gi, struct client_s *client, struct msg_s *msg,
 								  int64_t frameNum, int64_t gameTime,
-								  const entity_state_t *baselines, const struct client_entities_s *client_entities,
-								  int numcmds, const gcommand_t *commands, const char *commandsData );
+								  const entity_state_t *baselines, struct client_entities_s *client_entities,
+								  int numcmds, const gcommand_t *commands, const char *commandsData, int maxSnapBytes,
+								  const msg_quantization_t *quantization );
 
 // Use PVS culling for sounds.
 // Note: changes gameplay experience, use with caution.
@@ -303,6 +317,7 @@ enum clc_ops_e {
 #define FRAMESNAP_FLAG_DELTA        ( 1 << 0 )
 #define FRAMESNAP_FLAG_ALLENTITIES  ( 1 << 1 )
 #define FRAMESNAP_FLAG_MULTIPOV     ( 1 << 2 )
+#define FRAMESNAP_FLAG_QUANTIZED    ( 1 << 3 )
 
 /*
 ==============================================================
@@ -674,6 +689,15 @@ void    FS_FreeBaseFile( void *buffer );
 void    *FS_MMapBaseFile( int file, size_t size, size_t offset );
 void    FS_UnMMapBaseFile( int file, void *data );
 
+/**
+* Maps the entire contents of an opened file for reading.
+* This works for regular files and for pak entries that are stored without compression.
+* The mapping should be released by FS_UnMMapBaseFile() prior to closing the file.
+*
+* @return mapped pointer to data on disk or NULL if the file cannot be mapped.
+*/
+void    *FS_MMapFile( int file, size_t *size );
+
 int     FS_GetNotifications( void );
 int     FS_RemoveNotifications( int bitmask );
 
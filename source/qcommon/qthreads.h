@@ -53,6 +53,12 @@ void QThread_Yield( void );
 void QThreads_Init( void );
 void QThreads_Shutdown( void );
 
+// Flags of QBufPipe_Create()
+// Wait for free space instead of dropping commands if the buffer is full
+#define QBUFPIPE_BLOCKING_WRITE 1
+// Use a lock-free ring buffer. Only a single thread is allowed to write commands in this case.
+#define QBUFPIPE_LOCKFREE_SPSC 2
+
 qbufPipe_t *QBufPipe_Create( size_t bufSize, int flags );
 void QBufPipe_Destroy( qbufPipe_t **pqueue );
 void QBufPipe_Finish( qbufPipe_t *queue );
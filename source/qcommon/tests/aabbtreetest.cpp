@@ -0,0 +1,431 @@
+#include "aabbtreetest.h"
+#include "../aabbtree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+static constexpr unsigned kMaxObjects = 1024;
+
+struct Box {
+	float mins[3];
+	float maxs[3];
+
+	[[nodiscard]]
+	bool intersects( const Box &that ) const {
+		for( int i = 0; i < 3; ++i ) {
+			if( mins[i] > that.maxs[i] || maxs[i] < that.mins[i] ) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+/**
+ * A scene that resembles a huge map with some static items, a few players and lots of fast projectiles.
+ * Objects are clustered around few spots of action, as it happens in actual games.
+ */
+class Scene {
+	struct Object {
+		float origin[3];
+		float velocity[3];
+		float halfSize[3];
+		unsigned spotNum;
+		bool isLinked;
+	};
+
+	static constexpr unsigned kNumSpots = 4;
+	static constexpr float kSpotExtent = 1024.0f;
+
+	std::mt19937 m_rng { 1337 };
+	std::vector<Object> m_objects;
+	float m_spots[kNumSpots][3];
+public:
+	static constexpr float kWorldExtent = 32768.0f;
+
+	explicit Scene( unsigned numObjects ) {
+		std::uniform_real_distribution<float> coordDist( -kWorldExtent + kSpotExtent, +kWorldExtent - kSpotExtent );
+		for( auto &spot: m_spots ) {
+			for( float &coord: spot ) {
+				coord = coordDist( m_rng );
+			}
+		}
+		for( unsigned i = 0; i < numObjects; ++i ) {
+			Object object {};
+			object.spotNum = ( i / 16 ) % kNumSpots;
+			setRandomOrigin( &object );
+			if( i % 4 == 0 ) {
+				// Items
+				object.halfSize[0] = object.halfSize[1] = object.halfSize[2] = 16.0f;
+			} else if( i % 16 == 1 ) {
+				// Players
+				object.halfSize[0] = object.halfSize[1] = 16.0f;
+				object.halfSize[2] = 28.0f;
+				setRandomVelocity( &object, 5.0f );
+			} else {
+				// Projectiles
+				object.halfSize[0] = object.halfSize[1] = object.halfSize[2] = 2.0f;
+				setRandomVelocity( &object, 10.0f + 30.0f * std::uniform_real_distribution<float>()( m_rng ) );
+			}
+			object.isLinked = true;
+			m_objects.push_back( object );
+		}
+	}
+
+	void setRandomOrigin( Object *object ) {
+		std::uniform_real_distribution<float> offsetDist( -kSpotExtent, +kSpotExtent );
+		for( int i = 0; i < 3; ++i ) {
+			object->origin[i] = m_spots[object->spotNum][i] + offsetDist( m_rng );
+		}
+	}
+
+	void setRandomVelocity( Object *object, float speed ) {
+		std::normal_distribution<float> dirDist;
+		float dir[3], squareLength = 0.0f;
+		do {
+			for( float &coord: dir ) {
+				coord = dirDist( m_rng );
+			}
+			squareLength = dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2];
+		} while( squareLength < 1e-3f );
+		const float scale = speed / std::sqrt( squareLength );
+		for( int i = 0; i < 3; ++i ) {
+			object->velocity[i] = dir[i] * scale;
+		}
+	}
+
+	[[nodiscard]]
+	auto numObjects() const -> unsigned { return (unsigned)m_objects.size(); }
+	[[nodiscard]]
+	bool isLinked( unsigned id ) const { return m_objects[id].isLinked; }
+
+	[[nodiscard]]
+	auto boundsOf( unsigned id ) const -> Box {
+		const Object &object = m_objects[id];
+		Box result;
+		for( int i = 0; i < 3; ++i ) {
+			result.mins[i] = object.origin[i] - object.halfSize[i];
+			result.maxs[i] = object.origin[i] + object.halfSize[i];
+		}
+		return result;
+	}
+
+	//! Moves objects, projectiles occasionally disappear and reappear (as if they have been freed and spawned again).
+	template <typename OnMoved, typename OnRemoved>
+	void advance( OnMoved &&onMoved, OnRemoved &&onRemoved ) {
+		for( unsigned id = 0; id < m_objects.size(); ++id ) {
+			Object &object = m_objects[id];
+			if( object.velocity[0] == 0.0f && object.velocity[1] == 0.0f && object.velocity[2] == 0.0f ) {
+				continue;
+			}
+			if( object.isLinked && m_rng() % 64 == 0 ) {
+				object.isLinked = false;
+				onRemoved( id );
+				continue;
+			}
+			if( !object.isLinked ) {
+				if( m_rng() % 4 ) {
+					continue;
+				}
+				// Respawn at some random point
+				setRandomOrigin( &object );
+				object.isLinked = true;
+			}
+			for( int i = 0; i < 3; ++i ) {
+				object.origin[i] += object.velocity[i];
+				if( std::fabs( object.origin[i] - m_spots[object.spotNum][i] ) > kSpotExtent ) {
+					object.velocity[i] = -object.velocity[i];
+				}
+			}
+			onMoved( id );
+		}
+	}
+
+	//! Produces bounds of short movement traces, long hitscan traces and splash damage areas.
+	[[nodiscard]]
+	auto nextQuery() -> Box {
+		const unsigned id = ( m_rng() % ( m_objects.size() / 16 ) ) * 16 + 1;
+		const Box bounds = boundsOf( std::min( id, numObjects() - 1 ) );
+		const unsigned kind = m_rng() % 8;
+		Box result = bounds;
+		if( kind < 5 ) {
+			for( int i = 0; i < 3; ++i ) {
+				result.mins[i] -= 24.0f;
+				result.maxs[i] += 24.0f;
+			}
+		} else if( kind < 7 ) {
+			// Extend the box along a random axis
+			const int axis = (int)( m_rng() % 3 );
+			if( m_rng() % 2 ) {
+				result.maxs[axis] += 2048.0f;
+			} else {
+				result.mins[axis] -= 2048.0f;
+			}
+		} else {
+			for( int i = 0; i < 3; ++i ) {
+				result.mins[i] -= 160.0f;
+				result.maxs[i] += 160.0f;
+			}
+		}
+		return result;
+	}
+};
+
+/**
+ * This is a replica of the uniform grid that was used for linking game entities.
+ */
+class AreaGrid {
+	static constexpr int kGridSize = 128;
+	static constexpr float kMinCellSize = 64.0f;
+	static constexpr int kMaxObjectCells = 16;
+
+	struct Link {
+		Link *prev, *next;
+		unsigned id;
+	};
+
+	Link m_cells[kGridSize * kGridSize];
+	Link m_outside;
+	Link m_objectLinks[kMaxObjects][kMaxObjectCells];
+	bool m_isObjectLinked[kMaxObjects];
+	int m_objectMarks[kMaxObjects];
+	int m_mark { 1 };
+	float m_bias[2], m_scale[2];
+
+	static void clearLink( Link *l ) { l->prev = l->next = l; }
+
+	static void insertLinkBefore( Link *l, Link *before, unsigned id ) {
+		l->next = before;
+		l->prev = before->prev;
+		l->prev->next = l;
+		l->next->prev = l;
+		l->id = id;
+	}
+public:
+	AreaGrid( float worldMins, float worldMaxs ) {
+		for( int i = 0; i < 2; ++i ) {
+			const float size = std::max( worldMaxs - worldMins, kGridSize * kMinCellSize );
+			m_bias[i] = -( worldMins + worldMaxs - size ) * 0.5f;
+			m_scale[i] = kGridSize / size;
+		}
+		clearLink( &m_outside );
+		for( Link &cell: m_cells ) {
+			clearLink( &cell );
+		}
+		std::fill( std::begin( m_isObjectLinked ), std::end( m_isObjectLinked ), false );
+		std::fill( std::begin( m_objectMarks ), std::end( m_objectMarks ), 0 );
+	}
+
+	void unlink( unsigned id ) {
+		if( !m_isObjectLinked[id] ) {
+			return;
+		}
+		for( Link &l: m_objectLinks[id] ) {
+			if( !l.prev ) {
+				break;
+			}
+			l.next->prev = l.prev;
+			l.prev->next = l.next;
+			l.prev = l.next = nullptr;
+		}
+		m_isObjectLinked[id] = false;
+	}
+
+	void link( unsigned id, const Box &box ) {
+		unlink( id );
+		m_isObjectLinked[id] = true;
+		for( Link &l: m_objectLinks[id] ) {
+			l.prev = l.next = nullptr;
+		}
+
+		int mins[2], maxs[2];
+		for( int i = 0; i < 2; ++i ) {
+			mins[i] = (int)std::floor( ( box.mins[i] + m_bias[i] ) * m_scale[i] );
+			maxs[i] = (int)std::floor( ( box.maxs[i] + m_bias[i] ) * m_scale[i] ) + 1;
+		}
+		if( mins[0] < 0 || maxs[0] > kGridSize || mins[1] < 0 || maxs[1] > kGridSize ||
+			( maxs[0] - mins[0] ) * ( maxs[1] - mins[1] ) > kMaxObjectCells ) {
+			insertLinkBefore( &m_objectLinks[id][0], &m_outside, id );
+			return;
+		}
+
+		int linkNum = 0;
+		for( int y = mins[1]; y < maxs[1]; ++y ) {
+			for( int x = mins[0]; x < maxs[0]; ++x ) {
+				insertLinkBefore( &m_objectLinks[id][linkNum++], &m_cells[y * kGridSize + x], id );
+			}
+		}
+	}
+
+	template <typename Callback>
+	void query( const Box &box, Callback &&callback ) {
+		m_mark++;
+
+		int mins[2], maxs[2];
+		for( int i = 0; i < 2; ++i ) {
+			mins[i] = std::max( 0, (int)std::floor( ( box.mins[i] + m_bias[i] ) * m_scale[i] ) );
+			maxs[i] = std::min( kGridSize, (int)std::floor( ( box.maxs[i] + m_bias[i] ) * m_scale[i] ) + 1 );
+		}
+
+		for( Link *l = m_outside.next; l != &m_outside; l = l->next ) {
+			if( m_objectMarks[l->id] != m_mark ) {
+				m_objectMarks[l->id] = m_mark;
+				callback( l->id );
+			}
+		}
+
+		for( int y = mins[1]; y < maxs[1]; ++y ) {
+			for( int x = mins[0]; x < maxs[0]; ++x ) {
+				Link *const cell = &m_cells[y * kGridSize + x];
+				for( Link *l = cell->next; l != cell; l = l->next ) {
+					if( m_objectMarks[l->id] != m_mark ) {
+						m_objectMarks[l->id] = m_mark;
+						callback( l->id );
+					}
+				}
+			}
+		}
+	}
+};
+
+static constexpr int kNumFrames = 200;
+static constexpr int kNumQueriesPerFrame = 64;
+
+void AabbTreeTest::test_queries() {
+	Scene scene( kMaxObjects );
+	wsw::AabbTree tree( kMaxObjects );
+	for( unsigned id = 0; id < scene.numObjects(); ++id ) {
+		const Box box = scene.boundsOf( id );
+		(void)tree.link( id, box.mins, box.maxs );
+	}
+	QVERIFY( tree.validate() );
+	QCOMPARE( tree.numObjects(), kMaxObjects );
+
+	std::vector<int> found( kMaxObjects );
+	std::vector<bool> isFound( kMaxObjects );
+	for( int frame = 0; frame < kNumFrames; ++frame ) {
+		scene.advance( [&]( unsigned id ) {
+			const Box box = scene.boundsOf( id );
+			(void)tree.link( id, box.mins, box.maxs );
+		}, [&]( unsigned id ) {
+			tree.unlink( id );
+		});
+		QVERIFY( tree.validate() );
+
+		for( int i = 0; i < kNumQueriesPerFrame; ++i ) {
+			const Box query = scene.nextQuery();
+			const int numFound = tree.query( query.mins, query.maxs, found.data(), (int)found.size() );
+			QVERIFY( numFound <= (int)found.size() );
+
+			std::fill( isFound.begin(), isFound.end(), false );
+			for( int j = 0; j < numFound; ++j ) {
+				const unsigned id = (unsigned)found[j];
+				// No duplicates, no removed objects
+				QVERIFY( !isFound[id] );
+				QVERIFY( scene.isLinked( id ) );
+				isFound[id] = true;
+			}
+			for( unsigned id = 0; id < scene.numObjects(); ++id ) {
+				if( scene.isLinked( id ) && scene.boundsOf( id ).intersects( query ) ) {
+					QVERIFY( isFound[id] );
+				}
+			}
+		}
+	}
+
+	// The tree must stay reasonably balanced
+	QVERIFY( tree.height() <= 4 * (int)std::log2( (float)kMaxObjects ) );
+
+	for( unsigned id = 0; id < scene.numObjects(); ++id ) {
+		tree.unlink( id );
+	}
+	QCOMPARE( tree.numObjects(), 0u );
+	QCOMPARE( tree.height(), 0 );
+	QVERIFY( tree.validate() );
+}
+
+void AabbTreeTest::test_relinking() {
+	wsw::AabbTree tree( 4, 8.0f );
+	const float mins[3] { 0.0f, 0.0f, 0.0f };
+	const float maxs[3] { 16.0f, 16.0f, 16.0f };
+	QVERIFY( tree.link( 1, mins, maxs ) );
+	QVERIFY( tree.isLinked( 1 ) );
+	QVERIFY( !tree.isLinked( 0 ) );
+
+	// Small movements should be absorbed by the fat box
+	const float movedMins[3] { 4.0f, 4.0f, -4.0f };
+	const float movedMaxs[3] { 20.0f, 20.0f, 12.0f };
+	QVERIFY( !tree.link( 1, movedMins, movedMaxs ) );
+
+	const float farMins[3] { 100.0f, 0.0f, 0.0f };
+	const float farMaxs[3] { 116.0f, 16.0f, 16.0f };
+	QVERIFY( tree.link( 1, farMins, farMaxs ) );
+	QCOMPARE( tree.numObjects(), 1u );
+
+	int list[4];
+	QCOMPARE( tree.query( mins, maxs, list, 4 ), 0 );
+	QCOMPARE( tree.query( farMins, farMaxs, list, 4 ), 1 );
+	QCOMPARE( list[0], 1 );
+
+	tree.clear();
+	QVERIFY( !tree.isLinked( 1 ) );
+	QCOMPARE( tree.query( farMins, farMaxs, list, 4 ), 0 );
+}
+
+void AabbTreeTest::benchmark_treeQueries() {
+	Scene scene( kMaxObjects );
+	wsw::AabbTree tree( kMaxObjects );
+	for( unsigned id = 0; id < scene.numObjects(); ++id ) {
+		const Box box = scene.boundsOf( id );
+		(void)tree.link( id, box.mins, box.maxs );
+	}
+
+	unsigned numHits = 0;
+	QBENCHMARK {
+		for( int frame = 0; frame < kNumFrames; ++frame ) {
+			scene.advance( [&]( unsigned id ) {
+				const Box box = scene.boundsOf( id );
+				(void)tree.link( id, box.mins, box.maxs );
+			}, [&]( unsigned id ) {
+				tree.unlink( id );
+			});
+			for( int i = 0; i < kNumQueriesPerFrame; ++i ) {
+				const Box query = scene.nextQuery();
+				tree.query( query.mins, query.maxs, [&]( unsigned id ) {
+					numHits += scene.boundsOf( id ).intersects( query );
+					return true;
+				});
+			}
+		}
+	}
+	QVERIFY( numHits > 0 );
+}
+
+void AabbTreeTest::benchmark_gridQueries() {
+	Scene scene( kMaxObjects );
+	auto grid = std::make_unique<AreaGrid>( -Scene::kWorldExtent, +Scene::kWorldExtent );
+	for( unsigned id = 0; id < scene.numObjects(); ++id ) {
+		grid->link( id, scene.boundsOf( id ) );
+	}
+
+	unsigned numHits = 0;
+	QBENCHMARK {
+		for( int frame = 0; frame < kNumFrames; ++frame ) {
+			scene.advance( [&]( unsigned id ) {
+				grid->link( id, scene.boundsOf( id ) );
+			}, [&]( unsigned id ) {
+				grid->unlink( id );
+			});
+			for( int i = 0; i < kNumQueriesPerFrame; ++i ) {
+				const Box query = scene.nextQuery();
+				grid->query( query, [&]( unsigned id ) {
+					numHits += scene.boundsOf( id ).intersects( query );
+				});
+			}
+		}
+	}
+	QVERIFY( numHits > 0 );
+}
@@ -0,0 +1,16 @@
+#ifndef WSW_0388bbc7_6084_4f36_bfe4_bd4df3f6365f_H
+#define WSW_0388bbc7_6084_4f36_bfe4_bd4df3f6365f_H
+
+#include <QtTest/QtTest>
+
+class AabbTreeTest : public QObject {
+	Q_OBJECT
+
+private slots:
+	void test_queries();
+	void test_relinking();
+	void benchmark_treeQueries();
+	void benchmark_gridQueries();
+};
+
+#endif
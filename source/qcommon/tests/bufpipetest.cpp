@@ -0,0 +1,251 @@
+#include "bufpipetest.h"
+#include "../qcommon.h"
+
+#include <atomic>
+#include <random>
+#include <thread>
+
+void Sys_Error( const char *format, ... ) {
+	va_list va;
+	va_start( va, format );
+	vprintf( format, va );
+	va_end( va );
+	abort();
+}
+
+enum : int { TestCmdId, TerminateCmdId };
+
+// Resembles commands of the sound backend (see PipeAdapter) but has a variable size
+struct TestCmd {
+	int id;
+	uint32_t seq;
+	uint32_t payloadSize;
+	uint32_t checksum;
+	uint8_t payload[112];
+};
+
+static constexpr unsigned kCmdHeaderSize = offsetof( TestCmd, payload );
+
+[[nodiscard]]
+static auto padCmdSize( size_t size ) -> unsigned {
+	return (unsigned)( ( size + 15 ) & ~(size_t)15 );
+}
+
+[[nodiscard]]
+static auto computeChecksum( const uint8_t *bytes, size_t size ) -> uint32_t {
+	uint32_t result = 0;
+	for( size_t i = 0; i < size; ++i ) {
+		result = result * 31 + bytes[i];
+	}
+	return result;
+}
+
+class PipeReader {
+public:
+	// Allows checking sequences of commands that could be dropped
+	PipeReader( qbufPipe_t *pipe, bool requireContiguousSeqs )
+		: m_pipe( pipe ), m_requireContiguousSeqs( requireContiguousSeqs ), m_thread( &PipeReader::run, this ) {}
+
+	~PipeReader() {
+		if( m_thread.joinable() ) {
+			m_thread.join();
+		}
+	}
+
+	void join() { m_thread.join(); }
+
+	[[nodiscard]]
+	auto numHandledCmds() const -> uint64_t { return m_numHandledCmds.load( std::memory_order_acquire ); }
+	[[nodiscard]]
+	auto lastSeq() const -> int64_t { return m_lastSeq; }
+	[[nodiscard]]
+	bool hasErrors() const { return m_hasErrors; }
+private:
+	void run() {
+		QBufPipe_Wait( m_pipe, &PipeReader::waiterFn, this, &PipeReader::handlerFn, 1 );
+	}
+
+	static int waiterFn( qbufPipe_t *pipe, void *reader, PipeHandlerFn handlerFn, bool ) {
+		return QBufPipe_ReadCmds( pipe, reader, handlerFn );
+	}
+
+	static auto handlerFn( void *arg, int id, uint8_t *data ) -> size_t {
+		auto *const reader = (PipeReader *)arg;
+		if( id == TerminateCmdId ) {
+			return 0;
+		}
+		TestCmd cmd;
+		std::memcpy( &cmd, data, kCmdHeaderSize );
+		if( id != TestCmdId || cmd.payloadSize > sizeof( cmd.payload ) ) {
+			reader->m_hasErrors = true;
+			return 0;
+		}
+		if( computeChecksum( data + kCmdHeaderSize, cmd.payloadSize ) != cmd.checksum ) {
+			reader->m_hasErrors = true;
+		}
+		if( reader->m_requireContiguousSeqs ? cmd.seq != reader->m_lastSeq + 1 : cmd.seq <= reader->m_lastSeq ) {
+			reader->m_hasErrors = true;
+		}
+		reader->m_lastSeq = cmd.seq;
+		reader->m_numHandledCmds.fetch_add( 1, std::memory_order_release );
+		return padCmdSize( kCmdHeaderSize + cmd.payloadSize );
+	}
+
+	qbufPipe_t *const m_pipe;
+	const bool m_requireContiguousSeqs;
+	int64_t m_lastSeq { -1 };
+	bool m_hasErrors { false };
+	std::atomic<uint64_t> m_numHandledCmds { 0 };
+	std::thread m_thread;
+};
+
+class CmdWriter {
+public:
+	explicit CmdWriter( qbufPipe_t *pipe, bool useVariableSize ) : m_pipe( pipe ), m_useVariableSize( useVariableSize ) {}
+
+	void writeCmd() {
+		TestCmd cmd;
+		cmd.id = TestCmdId;
+		cmd.seq = m_seq++;
+		cmd.payloadSize = m_useVariableSize ? m_rng() % sizeof( cmd.payload ) : 16;
+		for( uint32_t i = 0; i < cmd.payloadSize; ++i ) {
+			cmd.payload[i] = (uint8_t)( cmd.seq + i );
+		}
+		cmd.checksum = computeChecksum( cmd.payload, cmd.payloadSize );
+		const unsigned size = kCmdHeaderSize + cmd.payloadSize;
+		QBufPipe_WriteCmd( m_pipe, &cmd, padCmdSize( size ), size );
+	}
+
+	void writeTerminateCmd() {
+		const int cmd = TerminateCmdId;
+		QBufPipe_WriteCmd( m_pipe, &cmd, padCmdSize( sizeof( int ) ), sizeof( int ) );
+	}
+private:
+	qbufPipe_t *const m_pipe;
+	std::minstd_rand m_rng;
+	uint32_t m_seq { 0 };
+	const bool m_useVariableSize;
+};
+
+static void testTransfer( int flags ) {
+	constexpr unsigned kNumCmds = 1000000;
+	// Make sure the buffer wraps often
+	qbufPipe_t *pipe = QBufPipe_Create( 4096, flags | QBUFPIPE_BLOCKING_WRITE );
+	{
+		PipeReader reader( pipe, true );
+		CmdWriter writer( pipe, true );
+		for( unsigned i = 0; i < kNumCmds; ++i ) {
+			writer.writeCmd();
+		}
+		writer.writeTerminateCmd();
+		reader.join();
+
+		QVERIFY( !reader.hasErrors() );
+		QCOMPARE( reader.numHandledCmds(), (uint64_t)kNumCmds );
+	}
+	QBufPipe_Destroy( &pipe );
+	QVERIFY( !pipe );
+}
+
+static void testDroppingWrites( int flags ) {
+	constexpr unsigned kNumCmds = 1000000;
+	qbufPipe_t *pipe = QBufPipe_Create( 4096, flags );
+	{
+		PipeReader reader( pipe, false );
+		CmdWriter writer( pipe, true );
+		for( unsigned i = 0; i < kNumCmds; ++i ) {
+			writer.writeCmd();
+		}
+		// Make sure the terminate command does not get dropped
+		QBufPipe_Finish( pipe );
+		writer.writeTerminateCmd();
+		reader.join();
+
+		// Commands could be dropped but should not be corrupted or reordered
+		QVERIFY( !reader.hasErrors() );
+		QVERIFY( reader.numHandledCmds() > 0 && reader.numHandledCmds() <= kNumCmds );
+		QVERIFY( reader.lastSeq() < kNumCmds );
+	}
+	QBufPipe_Destroy( &pipe );
+}
+
+static void benchmarkThroughput( int flags ) {
+	constexpr unsigned kNumCmds = 2000000;
+	// The sound backend pipe size
+	qbufPipe_t *pipe = QBufPipe_Create( 0x100000, flags | QBUFPIPE_BLOCKING_WRITE );
+	{
+		PipeReader reader( pipe, true );
+		CmdWriter writer( pipe, false );
+		uint64_t numWrittenCmds = 0;
+		QBENCHMARK {
+			for( unsigned i = 0; i < kNumCmds; ++i ) {
+				writer.writeCmd();
+			}
+			numWrittenCmds += kNumCmds;
+			QBufPipe_Finish( pipe );
+		}
+		writer.writeTerminateCmd();
+		reader.join();
+
+		QVERIFY( !reader.hasErrors() );
+		QCOMPARE( reader.numHandledCmds(), numWrittenCmds );
+	}
+	QBufPipe_Destroy( &pipe );
+}
+
+// Measures the round trip of a command to an idle reader
+static void benchmarkLatency( int flags ) {
+	constexpr unsigned kNumRoundTrips = 1000;
+	qbufPipe_t *pipe = QBufPipe_Create( 0x100000, flags | QBUFPIPE_BLOCKING_WRITE );
+	{
+		PipeReader reader( pipe, true );
+		CmdWriter writer( pipe, false );
+		uint64_t numWrittenCmds = 0;
+		QBENCHMARK {
+			for( unsigned i = 0; i < kNumRoundTrips; ++i ) {
+				writer.writeCmd();
+				numWrittenCmds++;
+				while( reader.numHandledCmds() != numWrittenCmds ) {
+					std::this_thread::yield();
+				}
+			}
+		}
+		writer.writeTerminateCmd();
+		reader.join();
+
+		QVERIFY( !reader.hasErrors() );
+	}
+	QBufPipe_Destroy( &pipe );
+}
+
+void BufPipeTest::test_lockingPipeTransfer() {
+	testTransfer( 0 );
+}
+
+void BufPipeTest::test_spscPipeTransfer() {
+	testTransfer( QBUFPIPE_LOCKFREE_SPSC );
+}
+
+void BufPipeTest::test_lockingPipeDroppingWrites() {
+	testDroppingWrites( 0 );
+}
+
+void BufPipeTest::test_spscPipeDroppingWrites() {
+	testDroppingWrites( QBUFPIPE_LOCKFREE_SPSC );
+}
+
+void BufPipeTest::benchmark_lockingPipeThroughput() {
+	benchmarkThroughput( 0 );
+}
+
+void BufPipeTest::benchmark_spscPipeThroughput() {
+	benchmarkThroughput( QBUFPIPE_LOCKFREE_SPSC );
+}
+
+void BufPipeTest::benchmark_lockingPipeLatency() {
+	benchmarkLatency( 0 );
+}
+
+void BufPipeTest::benchmark_spscPipeLatency() {
+	benchmarkLatency( QBUFPIPE_LOCKFREE_SPSC );
+}
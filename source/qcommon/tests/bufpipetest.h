@@ -0,0 +1,20 @@
+#ifndef WSW_03d427ec_c90f_43d4_a586_cf6b36d499ae_H
+#define WSW_03d427ec_c90f_43d4_a586_cf6b36d499ae_H
+
+#include <QtTest/QtTest>
+
+class BufPipeTest : public QObject {
+	Q_OBJECT
+
+private slots:
+	void test_lockingPipeTransfer();
+	void test_spscPipeTransfer();
+	void test_lockingPipeDroppingWrites();
+	void test_spscPipeDroppingWrites();
+	void benchmark_lockingPipeThroughput();
+	void benchmark_spscPipeThroughput();
+	void benchmark_lockingPipeLatency();
+	void benchmark_spscPipeLatency();
+};
+
+#endif
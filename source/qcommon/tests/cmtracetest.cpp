@@ -0,0 +1,454 @@
+#include "cmtracetest.h"
+#include "../qcommon.h"
+#include "../cm_local.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+unsigned Sys_GetProcessorFeatures() {
+	// Brushes of the synthetic world have no SIMD data, so the generic code path is tested
+	return 0;
+}
+
+int SignbitsForPlane( const cplane_t *plane ) {
+	int bits = 0;
+	for( int i = 0; i < 3; ++i ) {
+		if( plane->normal[i] < 0 ) {
+			bits |= 1 << i;
+		}
+	}
+	return bits;
+}
+
+int CM_BoxLeafnums( const cmodel_state_t *, const vec3_t, const vec3_t, int *, int, int *topnode, int ) {
+	// Shape lists are not built from the tree by these tests
+	*topnode = 0;
+	return 0;
+}
+
+/**
+ * A BSP tree of axial (and a single non-axial) planes over randomly placed box brushes.
+ * Every leaf holds copies of brushes that touch its bounds.
+ */
+struct CMTraceTest::SyntheticWorld {
+	static constexpr int kNumBrushes = 300;
+	static constexpr float kExtent = 1000.0f;
+	// Sound environment sampling casts rays from a source in many directions, benchmarks do the same
+	static constexpr int kBenchmarkRaysPerOrigin = 80;
+	static constexpr int kNumBenchmarkRays = 100 * kBenchmarkRaysPerOrigin;
+	// Particles of a flock are clipped against shapes in the flock bounds, and move by few units per step
+	static constexpr float kClippingExtent = 400.0f;
+	static constexpr int kNumClippingPoints = 4000;
+
+	std::minstd_rand0 rng { 1 };
+	std::vector<cbrush_t> brushes;
+	std::vector<cbrushside_t> brushSides;
+	std::vector<cplane_t> planes;
+	std::vector<cnode_t> nodes;
+	std::vector<cleaf_t> leafs;
+	std::vector<std::vector<cbrush_t>> leafBrushes;
+	cmodel_t worldModel {};
+	cmodel_state_t cms {};
+
+	vec3_t benchmarkStarts[kNumBenchmarkRays];
+	vec3_t benchmarkEnds[kNumBenchmarkRays];
+	trace_t benchmarkTraces[kNumBenchmarkRays];
+
+	CMShapeList *allShapes { nullptr };
+	CMShapeList *clippedShapes { nullptr };
+	vec3_t clippingStarts[kNumClippingPoints];
+	vec3_t clippingEnds[kNumClippingPoints];
+	trace_t clippingTraces[kNumClippingPoints];
+
+	SyntheticWorld();
+	~SyntheticWorld();
+
+	[[nodiscard]]
+	auto randomFloat( float lo, float hi ) -> float {
+		return lo + ( hi - lo ) * (float)( rng() - rng.min() ) / (float)( rng.max() - rng.min() );
+	}
+
+	void addBrush( const vec3_t center, const vec3_t halfExtents );
+	[[nodiscard]]
+	auto addPlane( const vec3_t normal, float dist ) -> int;
+	[[nodiscard]]
+	auto buildTree( const vec3_t mins, const vec3_t maxs, int depth, int axis ) -> int;
+};
+
+CMTraceTest::SyntheticWorld::SyntheticWorld() {
+	brushSides.resize( 6 * kNumBrushes );
+	for( int i = 0; i < kNumBrushes; ++i ) {
+		vec3_t center, halfExtents;
+		for( int j = 0; j < 3; ++j ) {
+			center[j] = randomFloat( -kExtent, +kExtent );
+			halfExtents[j] = randomFloat( 8.0f, 64.0f );
+		}
+		addBrush( center, halfExtents );
+	}
+
+	// Planes are referred by indices until all planes are added
+	nodes.emplace_back( cnode_t {} );
+	const vec3_t diagonal { 1.0f / std::sqrt( 2.0f ), 1.0f / std::sqrt( 2.0f ), 0.0f };
+	nodes[0].plane = (cplane_t *)(intptr_t)addPlane( diagonal, 37.0f );
+	const vec3_t mins { -1.1f * kExtent, -1.1f * kExtent, -1.1f * kExtent };
+	const vec3_t maxs { +1.1f * kExtent, +1.1f * kExtent, +1.1f * kExtent };
+	const int frontChild = buildTree( mins, maxs, 7, 0 );
+	const int backChild = buildTree( mins, maxs, 6, 1 );
+	nodes[0].children[0] = frontChild;
+	nodes[0].children[1] = backChild;
+
+	for( cnode_t &node: nodes ) {
+		node.plane = &planes[(intptr_t)node.plane];
+	}
+	for( size_t i = 0; i < leafs.size(); ++i ) {
+		leafs[i].brushes = leafBrushes[i].data();
+		leafs[i].numbrushes = (int)leafBrushes[i].size();
+	}
+
+	cms.map_cmodels = &worldModel;
+	cms.numnodes = (int)nodes.size();
+	cms.map_nodes = nodes.data();
+	cms.numleafs = (int)leafs.size();
+	cms.map_leafs = leafs.data();
+	cms.ops = CM_GetOps( &cms );
+
+	for( int i = 0; i < kNumBenchmarkRays; i += kBenchmarkRaysPerOrigin ) {
+		const vec3_t origin { randomFloat( -kExtent, +kExtent ), randomFloat( -kExtent, +kExtent ), randomFloat( -kExtent, +kExtent ) };
+		for( int j = i; j < i + kBenchmarkRaysPerOrigin; ++j ) {
+			VectorCopy( origin, benchmarkStarts[j] );
+			for( int k = 0; k < 3; ++k ) {
+				benchmarkEnds[j][k] = origin[k] + randomFloat( -700.0f, +700.0f );
+			}
+		}
+	}
+
+	allShapes = CM_AllocShapeList( &cms );
+	clippedShapes = CM_AllocShapeList( &cms );
+	for( int i = 0; i < kNumBrushes; ++i ) {
+		allShapes->shapes[i] = &brushes[i];
+	}
+	allShapes->numShapes = kNumBrushes;
+	allShapes->possibleContents = CONTENTS_SOLID;
+	const vec3_t clippingMins { -kClippingExtent, -kClippingExtent, -kClippingExtent };
+	const vec3_t clippingMaxs { +kClippingExtent, +kClippingExtent, +kClippingExtent };
+	CM_ClipShapeList( &cms, clippedShapes, allShapes, clippingMins, clippingMaxs );
+
+	for( int i = 0; i < kNumClippingPoints; ++i ) {
+		for( int j = 0; j < 3; ++j ) {
+			clippingStarts[i][j] = randomFloat( -kClippingExtent - 50.0f, +kClippingExtent + 50.0f );
+			clippingEnds[i][j] = clippingStarts[i][j] + randomFloat( -40.0f, +40.0f );
+		}
+	}
+}
+
+CMTraceTest::SyntheticWorld::~SyntheticWorld() {
+	CM_FreeShapeList( &cms, clippedShapes );
+	CM_FreeShapeList( &cms, allShapes );
+}
+
+void CMTraceTest::SyntheticWorld::addBrush( const vec3_t center, const vec3_t halfExtents ) {
+	cbrush_t brush {};
+	VectorCopy( center, brush.center );
+	VectorSubtract( center, halfExtents, brush.mins );
+	VectorAdd( center, halfExtents, brush.maxs );
+	brush.radius = VectorLength( halfExtents );
+	brush.contents = CONTENTS_SOLID;
+	brush.numsides = 6;
+	brush.brushsides = &brushSides[6 * brushes.size()];
+	for( int i = 0; i < 6; ++i ) {
+		const int axis = i >> 1;
+		cplane_t plane {};
+		if( i & 1 ) {
+			plane.normal[axis] = -1.0f;
+			plane.dist = -brush.mins[axis];
+			plane.type = PLANE_NONAXIAL;
+		} else {
+			plane.normal[axis] = +1.0f;
+			plane.dist = brush.maxs[axis];
+			plane.type = axis;
+		}
+		plane.signbits = SignbitsForPlane( &plane );
+		CM_CopyRawToCMPlane( &plane, &brush.brushsides[i].plane );
+	}
+	brushes.push_back( brush );
+}
+
+auto CMTraceTest::SyntheticWorld::addPlane( const vec3_t normal, float dist ) -> int {
+	cplane_t plane {};
+	VectorCopy( normal, plane.normal );
+	plane.dist = dist;
+	plane.type = PLANE_NONAXIAL;
+	for( int i = 0; i < 3; ++i ) {
+		if( normal[i] == 1.0f ) {
+			plane.type = i;
+		}
+	}
+	plane.signbits = SignbitsForPlane( &plane );
+	planes.push_back( plane );
+	return (int)planes.size() - 1;
+}
+
+auto CMTraceTest::SyntheticWorld::buildTree( const vec3_t mins, const vec3_t maxs, int depth, int axis ) -> int {
+	if( !depth ) {
+		std::vector<cbrush_t> touchingBrushes;
+		for( const cbrush_t &brush: brushes ) {
+			bool touches = true;
+			for( int i = 0; i < 3; ++i ) {
+				touches &= brush.mins[i] <= maxs[i] + 1.0f && brush.maxs[i] >= mins[i] - 1.0f;
+			}
+			if( touches ) {
+				touchingBrushes.push_back( brush );
+			}
+		}
+		leafBrushes.emplace_back( std::move( touchingBrushes ) );
+		leafs.emplace_back( cleaf_t {} );
+		leafs.back().contents = CONTENTS_SOLID;
+		return -(int)leafs.size();
+	}
+
+	// Split planes are a bit off the middle to avoid ones that are aligned with each other
+	vec3_t normal { 0.0f, 0.0f, 0.0f };
+	normal[axis] = 1.0f;
+	const float dist = 0.5f * ( mins[axis] + maxs[axis] ) + ( depth % 2 ? 13.0f : -7.0f );
+
+	const int nodeNum = (int)nodes.size();
+	nodes.emplace_back( cnode_t {} );
+	nodes[nodeNum].plane = (cplane_t *)(intptr_t)addPlane( normal, dist );
+
+	vec3_t frontMins, backMaxs;
+	VectorCopy( mins, frontMins );
+	VectorCopy( maxs, backMaxs );
+	frontMins[axis] = dist;
+	backMaxs[axis] = dist;
+	const int frontChild = buildTree( frontMins, maxs, depth - 1, ( axis + 1 ) % 3 );
+	const int backChild = buildTree( mins, backMaxs, depth - 1, ( axis + 1 ) % 3 );
+	nodes[nodeNum].children[0] = frontChild;
+	nodes[nodeNum].children[1] = backChild;
+	return nodeNum;
+}
+
+void CMTraceTest::initTestCase() {
+	m_world = new SyntheticWorld;
+}
+
+void CMTraceTest::cleanupTestCase() {
+	delete m_world;
+	m_world = nullptr;
+}
+
+void CMTraceTest::comparePointsTraces( const float ( *starts )[3], const float ( *ends )[3], int numTraces ) {
+	const cmodel_state_t *cms = &m_world->cms;
+
+	std::vector<trace_t> traces( numTraces );
+	CM_TracePointsInWorld( cms, traces.data(), starts, ends, numTraces, MASK_SOLID );
+
+	for( int i = 0; i < numTraces; ++i ) {
+		trace_t expected;
+		CM_TransformedBoxTrace( cms, &expected, starts[i], ends[i], vec3_origin, vec3_origin, nullptr, MASK_SOLID, nullptr, nullptr );
+		const trace_t &actual = traces[i];
+		QCOMPARE( actual.fraction, expected.fraction );
+		QCOMPARE( actual.startsolid, expected.startsolid );
+		QCOMPARE( actual.allsolid, expected.allsolid );
+		QCOMPARE( actual.contents, expected.contents );
+		QVERIFY( VectorCompare( actual.endpos, expected.endpos ) );
+		QVERIFY( VectorCompare( actual.plane.normal, expected.plane.normal ) );
+		QCOMPARE( actual.plane.dist, expected.plane.dist );
+	}
+}
+
+void CMTraceTest::compareClippedPoints( const float ( *starts )[3], const float ( *ends )[3], int numTraces ) {
+	cmodel_state_t *cms = &m_world->cms;
+	const CMShapeList *list = m_world->clippedShapes;
+
+	std::vector<trace_t> traces( numTraces );
+	CM_ClipPointsToShapeList( cms, list, traces.data(), starts, ends, (unsigned)numTraces, MASK_SOLID );
+
+	for( int i = 0; i < numTraces; ++i ) {
+		trace_t expected;
+		CM_ClipToShapeList( cms, list, &expected, starts[i], ends[i], vec3_origin, vec3_origin, MASK_SOLID );
+		const trace_t &actual = traces[i];
+		QCOMPARE( actual.fraction, expected.fraction );
+		QCOMPARE( actual.startsolid, expected.startsolid );
+		QCOMPARE( actual.allsolid, expected.allsolid );
+		QCOMPARE( actual.contents, expected.contents );
+		QVERIFY( VectorCompare( actual.endpos, expected.endpos ) );
+		QVERIFY( VectorCompare( actual.plane.normal, expected.plane.normal ) );
+		QCOMPARE( actual.plane.dist, expected.plane.dist );
+	}
+}
+
+// Rays are grouped by 80, so calls span multiple packets, and rays of a group share the start point
+
+void CMTraceTest::test_pointsTraces_allMiss() {
+	const cmodel_state_t *cms = &m_world->cms;
+
+	int numRays = 0, numAttempts = 0;
+	vec3_t starts[80], ends[80];
+	// Collect short rays that do not hit anything
+	while( numRays < 80 && numAttempts++ < 100000 ) {
+		vec3_t start, end;
+		for( int i = 0; i < 3; ++i ) {
+			start[i] = m_world->randomFloat( -1000.0f, +1000.0f );
+			end[i] = start[i] + m_world->randomFloat( -48.0f, +48.0f );
+		}
+		trace_t trace;
+		CM_TransformedBoxTrace( cms, &trace, start, end, vec3_origin, vec3_origin, nullptr, MASK_SOLID, nullptr, nullptr );
+		if( trace.fraction == 1.0f && !trace.startsolid ) {
+			VectorCopy( start, starts[numRays] );
+			VectorCopy( end, ends[numRays] );
+			numRays++;
+		}
+	}
+
+	QCOMPARE( numRays, 80 );
+	comparePointsTraces( starts, ends, numRays );
+}
+
+void CMTraceTest::test_pointsTraces_allHit() {
+	const cmodel_state_t *cms = &m_world->cms;
+
+	vec3_t starts[80], ends[80];
+	// Shoot rays through centers of brushes from outside
+	for( int i = 0; i < 80; ++i ) {
+		const cbrush_t &brush = m_world->brushes[i];
+		vec3_t dir;
+		for( int j = 0; j < 3; ++j ) {
+			dir[j] = m_world->randomFloat( -1.0f, +1.0f );
+		}
+		VectorNormalize( dir );
+		VectorMA( brush.center, 2.0f * brush.radius, dir, starts[i] );
+		VectorMA( brush.center, -2.0f * brush.radius, dir, ends[i] );
+	}
+
+	for( int i = 0; i < 80; ++i ) {
+		trace_t trace;
+		CM_TransformedBoxTrace( cms, &trace, starts[i], ends[i], vec3_origin, vec3_origin, nullptr, MASK_SOLID, nullptr, nullptr );
+		QVERIFY( trace.fraction < 1.0f );
+	}
+
+	comparePointsTraces( starts, ends, 80 );
+}
+
+void CMTraceTest::test_pointsTraces_mixed() {
+	for( int group = 0; group < 200; ++group ) {
+		vec3_t starts[80], ends[80];
+		const vec3_t origin { m_world->randomFloat( -1000.0f, +1000.0f ), m_world->randomFloat( -1000.0f, +1000.0f ),
+							  m_world->randomFloat( -1000.0f, +1000.0f ) };
+		const int numRays = 1 + group % 80;
+		for( int i = 0; i < numRays; ++i ) {
+			VectorCopy( origin, starts[i] );
+			for( int j = 0; j < 3; ++j ) {
+				ends[i][j] = m_world->randomFloat( -1200.0f, +1200.0f );
+			}
+		}
+		comparePointsTraces( starts, ends, numRays );
+	}
+}
+
+void CMTraceTest::test_pointsTraces_degenerate() {
+	vec3_t starts[80], ends[80];
+	// Mix position tests inside and outside of brushes with regular rays
+	for( int i = 0; i < 80; ++i ) {
+		if( i % 3 ) {
+			const cbrush_t &brush = m_world->brushes[i];
+			VectorCopy( brush.center, starts[i] );
+			if( !( i % 2 ) ) {
+				starts[i][2] += 2.0f * brush.radius;
+			}
+			VectorCopy( starts[i], ends[i] );
+		} else {
+			for( int j = 0; j < 3; ++j ) {
+				starts[i][j] = m_world->randomFloat( -1000.0f, +1000.0f );
+				ends[i][j] = starts[i][j] + m_world->randomFloat( -500.0f, +500.0f );
+			}
+		}
+	}
+
+	comparePointsTraces( starts, ends, 80 );
+}
+
+void CMTraceTest::test_clipPoints_mixed() {
+	QVERIFY( CM_GetNumShapesInShapeList( m_world->clippedShapes ) > 0 );
+
+	// Make sure that the data is not trivial
+	int numHits = 0;
+	for( int i = 0; i < SyntheticWorld::kNumClippingPoints; ++i ) {
+		trace_t trace;
+		CM_ClipToShapeList( &m_world->cms, m_world->clippedShapes, &trace, m_world->clippingStarts[i],
+							m_world->clippingEnds[i], vec3_origin, vec3_origin, MASK_SOLID );
+		numHits += trace.fraction < 1.0f ? 1 : 0;
+	}
+	QVERIFY( numHits > 0 && numHits < SyntheticWorld::kNumClippingPoints );
+
+	// Check batches that are smaller and larger than a chunk of points which are clipped at once
+	for( int numTraces: { 1, 7, 32, 33, 1000, SyntheticWorld::kNumClippingPoints } ) {
+		compareClippedPoints( m_world->clippingStarts, m_world->clippingEnds, numTraces );
+	}
+}
+
+void CMTraceTest::test_clipPoints_degenerate() {
+	vec3_t starts[200], ends[200];
+	// Particles which are at rest (or stuck in solid) are clipped with coinciding start and end points
+	for( int i = 0; i < 200; ++i ) {
+		const cbrush_t *brush = m_world->clippedShapes->shapes[i % m_world->clippedShapes->numShapes];
+		if( i % 2 ) {
+			VectorCopy( brush->center, starts[i] );
+		} else {
+			for( int j = 0; j < 3; ++j ) {
+				starts[i][j] = m_world->randomFloat( -SyntheticWorld::kClippingExtent, +SyntheticWorld::kClippingExtent );
+			}
+		}
+		VectorCopy( starts[i], ends[i] );
+		if( !( i % 5 ) ) {
+			ends[i][2] -= 16.0f;
+		}
+	}
+
+	compareClippedPoints( starts, ends, 200 );
+}
+
+void CMTraceTest::benchmark_singleTraces() {
+	const cmodel_state_t *cms = &m_world->cms;
+	const auto *starts = m_world->benchmarkStarts, *ends = m_world->benchmarkEnds;
+	auto *const traces = m_world->benchmarkTraces;
+	QBENCHMARK {
+		for( int i = 0; i < SyntheticWorld::kNumBenchmarkRays; ++i ) {
+			CM_TransformedBoxTrace( cms, &traces[i], starts[i], ends[i], vec3_origin, vec3_origin,
+									nullptr, MASK_SOLID, nullptr, nullptr );
+		}
+	}
+}
+
+void CMTraceTest::benchmark_pointsTraces() {
+	const cmodel_state_t *cms = &m_world->cms;
+	const auto *starts = m_world->benchmarkStarts, *ends = m_world->benchmarkEnds;
+	auto *const traces = m_world->benchmarkTraces;
+	QBENCHMARK {
+		for( int i = 0; i < SyntheticWorld::kNumBenchmarkRays; i += SyntheticWorld::kBenchmarkRaysPerOrigin ) {
+			CM_TracePointsInWorld( cms, traces + i, starts + i, ends + i, SyntheticWorld::kBenchmarkRaysPerOrigin, MASK_SOLID );
+		}
+	}
+}
+
+void CMTraceTest::benchmark_singleClipping() {
+	cmodel_state_t *cms = &m_world->cms;
+	const CMShapeList *list = m_world->clippedShapes;
+	const auto *starts = m_world->clippingStarts, *ends = m_world->clippingEnds;
+	auto *const traces = m_world->clippingTraces;
+	QBENCHMARK {
+		for( int i = 0; i < SyntheticWorld::kNumClippingPoints; ++i ) {
+			CM_ClipToShapeList( cms, list, &traces[i], starts[i], ends[i], vec3_origin, vec3_origin, MASK_SOLID );
+		}
+	}
+}
+
+void CMTraceTest::benchmark_pointsClipping() {
+	cmodel_state_t *cms = &m_world->cms;
+	const CMShapeList *list = m_world->clippedShapes;
+	const auto *starts = m_world->clippingStarts, *ends = m_world->clippingEnds;
+	auto *const traces = m_world->clippingTraces;
+	QBENCHMARK {
+		CM_ClipPointsToShapeList( cms, list, traces, starts, ends, SyntheticWorld::kNumClippingPoints, MASK_SOLID );
+	}
+}
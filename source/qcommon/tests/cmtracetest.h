@@ -0,0 +1,30 @@
+#ifndef WSW_682a1e4e_ec7f_4bd9_bd54_a1b5b0f7323b_H
+#define WSW_682a1e4e_ec7f_4bd9_bd54_a1b5b0f7323b_H
+
+#include <QtTest/QtTest>
+
+class CMTraceTest : public QObject {
+	Q_OBJECT
+
+	struct SyntheticWorld;
+	SyntheticWorld *m_world { nullptr };
+
+	void comparePointsTraces( const float ( *starts )[3], const float ( *ends )[3], int numTraces );
+	void compareClippedPoints( const float ( *starts )[3], const float ( *ends )[3], int numTraces );
+
+private slots:
+	void initTestCase();
+	void cleanupTestCase();
+	void test_pointsTraces_allMiss();
+	void test_pointsTraces_allHit();
+	void test_pointsTraces_mixed();
+	void test_pointsTraces_degenerate();
+	void test_clipPoints_mixed();
+	void test_clipPoints_degenerate();
+	void benchmark_singleTraces();
+	void benchmark_pointsTraces();
+	void benchmark_singleClipping();
+	void benchmark_pointsClipping();
+};
+
+#endif
@@ -0,0 +1,303 @@
+#include "deltacodectest.h"
+#include "../qcommon.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+
+// Specialized codecs must produce exactly the same output as the generic field table interpreter.
+// States are generated randomly, every field of a generated state has a chance to be changed.
+
+void Com_Printf( const char *, ... ) {}
+
+void Com_Error( com_error_code_t, const char *format, ... ) {
+	throw std::runtime_error( format );
+}
+
+void ByteToDir( int, float *dir ) {
+	dir[0] = dir[1] = dir[2] = 0.0f;
+}
+
+int DirToByte( const float * ) {
+	return 0;
+}
+
+static constexpr int kNumIterations = 10000;
+static constexpr size_t kBufferSize = 1 << 16;
+
+static auto fieldElemBytes( const msg_field_t &field ) -> size_t {
+	return field.bits == 0 ? sizeof( float ) : ( field.bits == 1 ? sizeof( bool ) : field.bits >> 3 );
+}
+
+class RandomStateGenerator {
+	std::mt19937 m_rng { 1337 };
+public:
+	[[nodiscard]]
+	auto nextFloat() -> float {
+		switch( m_rng() % 8 ) {
+			case 0: return 0.0f;
+			case 1: return -0.0f;
+			case 2: return (float)( (int)( m_rng() % 4096 ) - 2048 );
+			default: return std::uniform_real_distribution<float>( -8192.0f, 8192.0f )( m_rng );
+		}
+	}
+
+	void randomizeFields( uint8_t *state, const msg_field_t *fields, size_t numFields, unsigned changeChance ) {
+		for( size_t i = 0; i < numFields; ++i ) {
+			const msg_field_t &field = fields[i];
+			const size_t elemBytes = fieldElemBytes( field );
+			for( int elem = 0; elem < field.count; ++elem ) {
+				if( m_rng() % 100 >= changeChance ) {
+					continue;
+				}
+				uint8_t *p = state + field.offset + elem * elemBytes;
+				if( field.bits == 0 ) {
+					const float value = nextFloat();
+					std::memcpy( p, &value, sizeof( float ) );
+				} else if( field.bits == 1 ) {
+					*( (bool *)p ) = ( m_rng() % 2 ) != 0;
+				} else {
+					// Keep values small sometimes to test short base-128 encodings
+					const bool isSmall = ( m_rng() % 2 ) != 0;
+					for( size_t byte = 0; byte < elemBytes; ++byte ) {
+						p[byte] = ( isSmall && byte > 0 ) ? 0 : (uint8_t)m_rng();
+					}
+				}
+			}
+		}
+	}
+
+	[[nodiscard]]
+	auto nextChangeChance() -> unsigned {
+		const unsigned chances[] { 0, 1, 5, 25, 100 };
+		return chances[m_rng() % std::size( chances )];
+	}
+};
+
+template <typename Struct>
+static bool fieldsAreEqual( const Struct &lhs, const Struct &rhs, const msg_field_t *fields, size_t numFields ) {
+	for( size_t i = 0; i < numFields; ++i ) {
+		const size_t size = fieldElemBytes( fields[i] ) * fields[i].count;
+		if( std::memcmp( (const uint8_t *)&lhs + fields[i].offset, (const uint8_t *)&rhs + fields[i].offset, size ) != 0 ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void DeltaCodecTest::test_entityStates() {
+	size_t numFields = 0;
+	const msg_field_t *fields = MSG_GetEntityStateFields( &numFields );
+
+	RandomStateGenerator generator;
+	std::vector<uint8_t> specializedData( kBufferSize ), genericData( kBufferSize );
+	for( int i = 0; i < kNumIterations; ++i ) {
+		entity_state_t from {}, to {};
+		generator.randomizeFields( (uint8_t *)&from, fields, numFields, 100 );
+		to = from;
+		generator.randomizeFields( (uint8_t *)&to, fields, numFields, generator.nextChangeChance() );
+		from.number = to.number = 1 + i % ( MAX_EDICTS - 1 );
+		const bool force = ( i % 3 ) == 0;
+
+		msg_t specializedMsg, genericMsg;
+		MSG_Init( &specializedMsg, specializedData.data(), specializedData.size() );
+		MSG_Init( &genericMsg, genericData.data(), genericData.size() );
+
+		MSG_WriteDeltaEntity( &specializedMsg, &from, &to, force );
+
+		// The entity number followed by the generic struct delta (which starts with the byte mask)
+		MSG_WriteIntBase128( &genericMsg, to.number << 1 );
+		const size_t structDeltaStart = genericMsg.cursize;
+		MSG_WriteDeltaStruct( &genericMsg, &from, &to, fields, numFields );
+		// Nothing should be written for unchanged entities unless forced (a zero byte mask is a single byte)
+		if( !force && genericMsg.cursize == structDeltaStart + 1 ) {
+			genericMsg.cursize = 0;
+		}
+
+		QCOMPARE( specializedMsg.cursize, genericMsg.cursize );
+		QVERIFY( std::memcmp( specializedData.data(), genericData.data(), genericMsg.cursize ) == 0 );
+		if( !specializedMsg.cursize ) {
+			continue;
+		}
+
+		entity_state_t specializedRead, genericRead;
+		MSG_BeginReading( &specializedMsg );
+		bool remove = true;
+		unsigned byteMask = 0;
+		const int number = MSG_ReadEntityNumber( &specializedMsg, &remove, &byteMask );
+		QCOMPARE( number, to.number );
+		QVERIFY( !remove );
+		MSG_ReadDeltaEntity( &specializedMsg, &from, &specializedRead, number, byteMask );
+		QCOMPARE( specializedMsg.readcount, specializedMsg.cursize );
+
+		MSG_BeginReading( &genericMsg );
+		(void)MSG_ReadIntBase128( &genericMsg );
+		MSG_ReadDeltaStruct( &genericMsg, &from, &genericRead, sizeof( entity_state_t ), fields, numFields );
+		QCOMPARE( genericMsg.readcount, genericMsg.cursize );
+
+		QVERIFY( fieldsAreEqual( specializedRead, genericRead, fields, numFields ) );
+	}
+}
+
+void DeltaCodecTest::test_playerStates() {
+	size_t numFields = 0;
+	const msg_field_t *fields = MSG_GetPlayerStateFields( &numFields );
+
+	RandomStateGenerator generator;
+	std::vector<uint8_t> specializedData( kBufferSize ), genericData( kBufferSize );
+	for( int i = 0; i < kNumIterations; ++i ) {
+		player_state_t from {}, to {};
+		generator.randomizeFields( (uint8_t *)&from, fields, numFields, 100 );
+		to = from;
+		generator.randomizeFields( (uint8_t *)&to, fields, numFields, generator.nextChangeChance() );
+
+		msg_t specializedMsg, genericMsg;
+		MSG_Init( &specializedMsg, specializedData.data(), specializedData.size() );
+		MSG_Init( &genericMsg, genericData.data(), genericData.size() );
+
+		MSG_WriteDeltaPlayerState( &specializedMsg, &from, &to );
+		MSG_WriteDeltaStruct( &genericMsg, &from, &to, fields, numFields );
+
+		QCOMPARE( specializedMsg.cursize, genericMsg.cursize );
+		QVERIFY( std::memcmp( specializedData.data(), genericData.data(), genericMsg.cursize ) == 0 );
+
+		player_state_t specializedRead, genericRead;
+		MSG_BeginReading( &specializedMsg );
+		MSG_ReadDeltaPlayerState( &specializedMsg, &from, &specializedRead );
+		QCOMPARE( specializedMsg.readcount, specializedMsg.cursize );
+
+		MSG_BeginReading( &genericMsg );
+		MSG_ReadDeltaStruct( &genericMsg, &from, &genericRead, sizeof( player_state_t ), fields, numFields );
+		QCOMPARE( genericMsg.readcount, genericMsg.cursize );
+
+		QVERIFY( fieldsAreEqual( specializedRead, genericRead, fields, numFields ) );
+	}
+}
+
+void DeltaCodecTest::test_gameStates() {
+	size_t numFields = 0;
+	const msg_field_t *fields = MSG_GetGameStateFields( &numFields );
+
+	RandomStateGenerator generator;
+	std::vector<uint8_t> specializedData( kBufferSize ), genericData( kBufferSize );
+	for( int i = 0; i < kNumIterations; ++i ) {
+		game_state_t from {}, to {};
+		generator.randomizeFields( (uint8_t *)&from, fields, numFields, 100 );
+		to = from;
+		generator.randomizeFields( (uint8_t *)&to, fields, numFields, generator.nextChangeChance() );
+
+		msg_t specializedMsg, genericMsg;
+		MSG_Init( &specializedMsg, specializedData.data(), specializedData.size() );
+		MSG_Init( &genericMsg, genericData.data(), genericData.size() );
+
+		MSG_WriteDeltaGameState( &specializedMsg, &from, &to );
+		MSG_WriteDeltaStruct( &genericMsg, &from, &to, fields, numFields );
+
+		QCOMPARE( specializedMsg.cursize, genericMsg.cursize );
+		QVERIFY( std::memcmp( specializedData.data(), genericData.data(), genericMsg.cursize ) == 0 );
+
+		game_state_t specializedRead, genericRead;
+		MSG_BeginReading( &specializedMsg );
+		MSG_ReadDeltaGameState( &specializedMsg, &from, &specializedRead );
+		QCOMPARE( specializedMsg.readcount, specializedMsg.cursize );
+
+		MSG_BeginReading( &genericMsg );
+		MSG_ReadDeltaStruct( &genericMsg, &from, &genericRead, sizeof( game_state_t ), fields, numFields );
+		QCOMPARE( genericMsg.readcount, genericMsg.cursize );
+
+		QVERIFY( fieldsAreEqual( specializedRead, genericRead, fields, numFields ) );
+	}
+}
+
+// A client parses a chain of quantized deltas, errors must not accumulate
+void DeltaCodecTest::test_quantizedEntityStates() {
+	size_t numFields = 0;
+	const msg_field_t *fields = MSG_GetEntityStateFields( &numFields );
+
+	const vec3_t worldMins { -8192.0f, -8192.0f, -8192.0f };
+	const vec3_t worldMaxs { +8192.0f, +8192.0f, +8192.0f };
+	msg_quantization_t quantization;
+	MSG_SetupQuantization( &quantization, worldMins, worldMaxs );
+	QVERIFY( quantization.mins[0] <= -8192 );
+	QCOMPARE( quantization.numBits, 18 );
+
+	msg_t quantizationMsg;
+	uint8_t quantizationData[32];
+	MSG_Init( &quantizationMsg, quantizationData, sizeof( quantizationData ) );
+	MSG_WriteQuantization( &quantizationMsg, &quantization );
+	MSG_BeginReading( &quantizationMsg );
+	msg_quantization_t readQuantization;
+	MSG_ReadQuantization( &quantizationMsg, &readQuantization );
+	QVERIFY( std::memcmp( &quantization, &readQuantization, sizeof( quantization ) ) == 0 );
+
+	const float maxPositionError = 1.0f / 16.0f + 1e-3f;
+	const float maxAngleError = 180.0f / 16384.0f + 1e-3f;
+	auto angleError = []( float lhs, float rhs ) {
+		const float diff = std::fabs( anglemod( lhs ) - anglemod( rhs ) );
+		return std::min( diff, 360.0f - diff );
+	};
+
+	RandomStateGenerator generator;
+	std::mt19937 rng( 7 );
+	std::uniform_real_distribution<float> smallMoves( -12.0f, 12.0f );
+	std::vector<uint8_t> quantizedData( kBufferSize ), plainData( kBufferSize );
+	size_t totalQuantizedBytes = 0, totalPlainBytes = 0;
+
+	for( int chain = 0; chain < 100; ++chain ) {
+		entity_state_t serverState {}, clientState {}, plainClientState {};
+		serverState.number = clientState.number = plainClientState.number = 1 + chain;
+		for( int i = 0; i < kNumIterations / 100; ++i ) {
+			entity_state_t newServerState = serverState;
+			generator.randomizeFields( (uint8_t *)&newServerState, fields, numFields, generator.nextChangeChance() );
+			// Mostly continuous movement
+			for( int j = 0; j < 3; ++j ) {
+				if( rng() % 4 ) {
+					const float origin = serverState.origin[j] + smallMoves( rng );
+					newServerState.origin[j] = std::clamp( origin, -8192.0f, +8192.0f );
+				}
+			}
+
+			msg_t quantizedMsg, plainMsg;
+			MSG_Init( &quantizedMsg, quantizedData.data(), quantizedData.size() );
+			MSG_Init( &plainMsg, plainData.data(), plainData.size() );
+			MSG_WriteDeltaEntity( &quantizedMsg, &serverState, &newServerState, false, &quantization );
+			MSG_WriteDeltaEntity( &plainMsg, &serverState, &newServerState, false );
+			totalQuantizedBytes += quantizedMsg.cursize;
+			totalPlainBytes += plainMsg.cursize;
+			serverState = newServerState;
+			if( !quantizedMsg.cursize ) {
+				QCOMPARE( plainMsg.cursize, 0 );
+				continue;
+			}
+
+			MSG_BeginReading( &quantizedMsg );
+			bool remove = true;
+			unsigned byteMask = 0;
+			const int number = MSG_ReadEntityNumber( &quantizedMsg, &remove, &byteMask );
+			QCOMPARE( number, serverState.number );
+			entity_state_t newClientState;
+			MSG_ReadDeltaEntity( &quantizedMsg, &clientState, &newClientState, number, byteMask, &quantization );
+			QCOMPARE( quantizedMsg.readcount, quantizedMsg.cursize );
+			clientState = newClientState;
+
+			MSG_BeginReading( &plainMsg );
+			(void)MSG_ReadEntityNumber( &plainMsg, &remove, &byteMask );
+			MSG_ReadDeltaEntity( &plainMsg, &plainClientState, &newClientState, number, byteMask );
+			plainClientState = newClientState;
+
+			for( int j = 0; j < 3; ++j ) {
+				QVERIFY( std::fabs( clientState.origin[j] - serverState.origin[j] ) <= maxPositionError );
+				QVERIFY( angleError( clientState.angles[j], serverState.angles[j] ) <= maxAngleError );
+			}
+
+			// Other fields must be the same as if the plain encoding was used
+			entity_state_t expectedState = plainClientState;
+			VectorCopy( clientState.origin, expectedState.origin );
+			VectorCopy( clientState.angles, expectedState.angles );
+			QVERIFY( fieldsAreEqual( expectedState, clientState, fields, numFields ) );
+		}
+	}
+
+	QVERIFY( totalQuantizedBytes < totalPlainBytes );
+}
@@ -0,0 +1,16 @@
+#ifndef WSW_187f5bd7_96d6_4884_a842_6d727ac54d17_H
+#define WSW_187f5bd7_96d6_4884_a842_6d727ac54d17_H
+
+#include <QtTest/QtTest>
+
+class DeltaCodecTest : public QObject {
+	Q_OBJECT
+
+private slots:
+	void test_entityStates();
+	void test_playerStates();
+	void test_gameStates();
+	void test_quantizedEntityStates();
+};
+
+#endif
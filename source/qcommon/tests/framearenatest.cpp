@@ -0,0 +1,206 @@
+#include "framearenatest.h"
+#include "../framearena.h"
+
+#include <algorithm>
+#include <vector>
+
+// These are defined by the test executable
+void *Q_malloc( size_t size );
+void Q_free( void *p );
+
+void FrameArenaTest::test_alignment() {
+	wsw::FrameArena arena( 64 * 1024 );
+
+	std::vector<std::pair<uint8_t *, size_t>> chunks;
+	for( size_t i = 0; i < 256; ++i ) {
+		const size_t alignment = (size_t)1 << ( i % 8 );
+		const size_t size = 1 + ( i * 7 ) % 61;
+		auto *const p = (uint8_t *)arena.allocate( size, alignment );
+		QVERIFY( !( (uintptr_t)p % alignment ) );
+		std::fill( p, p + size, (uint8_t)i );
+		chunks.emplace_back( p, size );
+	}
+
+	// Check that chunks do not overlap
+	for( size_t i = 0; i < chunks.size(); ++i ) {
+		const auto [p, size] = chunks[i];
+		QVERIFY( std::all_of( p, p + size, [=]( uint8_t b ) { return b == (uint8_t)i; } ) );
+	}
+
+	QCOMPARE( arena.numOverflows(), 0u );
+}
+
+void FrameArenaTest::test_scopedRewind() {
+	wsw::FrameArena arena( 64 * 1024 );
+
+	(void)arena.allocate( 100 );
+	const size_t bytesInUse = arena.bytesInUse();
+	void *firstScopeAddress = nullptr;
+	for( int i = 0; i < 4; ++i ) {
+		wsw::FrameArena::ScopedRewind rewind( &arena );
+		void *p = arena.allocate( 1000 );
+		if( !i ) {
+			firstScopeAddress = p;
+		}
+		// The same memory should be reused by every iteration
+		QCOMPARE( p, firstScopeAddress );
+		(void)arena.allocate( 1000 );
+		QVERIFY( arena.bytesInUse() >= bytesInUse + 2000 );
+	}
+
+	QCOMPARE( arena.bytesInUse(), bytesInUse );
+
+	arena.beginFrame();
+	QCOMPARE( arena.bytesInUse(), (size_t)0 );
+}
+
+void FrameArenaTest::test_overflowAndGrowth() {
+	constexpr size_t kInitialCapacity = 4096;
+	wsw::FrameArena arena( kInitialCapacity );
+
+	const auto runFrame = [&]() {
+		std::vector<uint32_t *> arrays;
+		for( uint32_t i = 0; i < 64; ++i ) {
+			auto *const array = arena.allocArray<uint32_t>( 64 );
+			std::fill( array, array + 64, i );
+			arrays.push_back( array );
+		}
+		for( uint32_t i = 0; i < 64; ++i ) {
+			if( !std::all_of( arrays[i], arrays[i] + 64, [=]( uint32_t v ) { return v == i; } ) ) {
+				return false;
+			}
+		}
+		return true;
+	};
+
+	QVERIFY( runFrame() );
+	QVERIFY( arena.numOverflows() > 0 );
+	const unsigned numOverflows = arena.numOverflows();
+
+	// The overflow should have been accounted upon frame start
+	arena.beginFrame();
+	QVERIFY( arena.capacity() > kInitialCapacity );
+	QVERIFY( arena.capacity() >= arena.lastFramePeakUsage() );
+	QVERIFY( arena.lastFramePeakUsage() >= 64 * 64 * sizeof( uint32_t ) );
+
+	// The same workload should fit the grown primary block
+	for( int i = 0; i < 3; ++i ) {
+		QVERIFY( runFrame() );
+		arena.beginFrame();
+	}
+
+	QCOMPARE( arena.numOverflows(), numOverflows );
+}
+
+void FrameArenaTest::test_peakUsage() {
+	wsw::FrameArena arena( 64 * 1024 );
+
+	{
+		wsw::FrameArena::ScopedRewind rewind( &arena );
+		(void)arena.allocate( 10000, 1 );
+	}
+	{
+		wsw::FrameArena::ScopedRewind rewind( &arena );
+		(void)arena.allocate( 3000, 1 );
+	}
+
+	QCOMPARE( arena.bytesInUse(), (size_t)0 );
+	QCOMPARE( arena.peakUsage(), (size_t)10000 );
+
+	arena.beginFrame();
+	QCOMPARE( arena.lastFramePeakUsage(), (size_t)10000 );
+
+	(void)arena.allocate( 500, 1 );
+	arena.beginFrame();
+	QCOMPARE( arena.lastFramePeakUsage(), (size_t)500 );
+	QCOMPARE( arena.peakUsage(), (size_t)10000 );
+}
+
+void FrameArenaTest::test_stlAllocator() {
+	wsw::FrameArena arena( 16 * 1024 );
+
+	std::vector<int, wsw::FrameArenaAllocator<int>> values { wsw::FrameArenaAllocator<int>( &arena ) };
+	for( int i = 0; i < 10000; ++i ) {
+		values.push_back( i );
+	}
+
+	// Growth of the vector should have caused overflows of this small arena
+	QVERIFY( arena.numOverflows() > 0 );
+	for( int i = 0; i < 10000; ++i ) {
+		QCOMPARE( values[i], i );
+	}
+
+	std::sort( values.begin(), values.end(), []( int lhs, int rhs ) { return lhs > rhs; } );
+	QCOMPARE( values.front(), 9999 );
+	QCOMPARE( values.back(), 0 );
+}
+
+// Mimics allocation patterns of building and writing snapshots
+template <typename ClientScope, typename BeginFrame, typename Alloc, typename Free>
+void FrameArenaTest::runServerFrames( BeginFrame &&beginFrame, Alloc &&alloc, Free &&free ) {
+	constexpr int kNumFrames = 20;
+	constexpr int kNumClients = 64;
+	constexpr int kNumEntities = 256;
+	constexpr size_t kMsgLen = 32768;
+
+	struct Update { const void *oldState; void *newState; float priority; int dataOffset, dataSize; };
+
+	uint64_t checksum = 0;
+	for( int frameNum = 0; frameNum < kNumFrames; ++frameNum ) {
+		beginFrame();
+		for( int clientNum = 0; clientNum < kNumClients; ++clientNum ) {
+			[[maybe_unused]] ClientScope clientScope;
+			const int numUpdates = kNumEntities + ( clientNum * 13 + frameNum ) % kNumEntities;
+			auto *const updates = (Update *)alloc( sizeof( Update ) * numUpdates );
+			auto *const msgData = (uint8_t *)alloc( kMsgLen );
+			auto *const deferrable = (Update **)alloc( sizeof( Update * ) * numUpdates );
+
+			int numDeferrable = 0;
+			for( int i = 0; i < numUpdates; ++i ) {
+				updates[i].priority = (float)( ( i * 31 + clientNum ) % 97 );
+				updates[i].dataOffset = i * 16;
+				updates[i].dataSize = 16;
+				msgData[( i * 16 ) % kMsgLen] = (uint8_t)i;
+				if( i % 3 ) {
+					deferrable[numDeferrable++] = &updates[i];
+				}
+			}
+
+			std::sort( deferrable, deferrable + numDeferrable, []( const Update *lhs, const Update *rhs ) {
+				return lhs->priority > rhs->priority;
+			});
+			checksum += (uint64_t)deferrable[0]->priority + msgData[16];
+
+			free( deferrable );
+			free( msgData );
+			free( updates );
+		}
+	}
+
+	QVERIFY( checksum > 0 );
+}
+
+struct NoClientScope {};
+
+struct ArenaClientScope : public wsw::FrameArena::ScopedRewind {
+	ArenaClientScope() : wsw::FrameArena::ScopedRewind( wsw::FrameArena::instance() ) {}
+};
+
+void FrameArenaTest::benchmark_serverFramesHeap() {
+	QBENCHMARK {
+		runServerFrames<NoClientScope>( []() {},
+										[]( size_t size ) { return Q_malloc( size ); },
+										[]( void *p ) { Q_free( p ); } );
+	}
+}
+
+void FrameArenaTest::benchmark_serverFramesArena() {
+	wsw::FrameArena *const arena = wsw::FrameArena::instance();
+	QBENCHMARK {
+		runServerFrames<ArenaClientScope>( [=]() { arena->beginFrame(); },
+										   [=]( size_t size ) { return arena->allocate( size ); },
+										   []( void * ) {} );
+	}
+	// The steady state should not require heap allocations
+	QCOMPARE( arena->numOverflows(), 0u );
+}
@@ -0,0 +1,22 @@
+#ifndef WSW_9a4e2c71_5b3d_4e8f_a062_d17c3f8b5e24_H
+#define WSW_9a4e2c71_5b3d_4e8f_a062_d17c3f8b5e24_H
+
+#include <QtTest/QtTest>
+
+class FrameArenaTest : public QObject {
+	Q_OBJECT
+
+	template <typename ClientScope, typename BeginFrame, typename Alloc, typename Free>
+	void runServerFrames( BeginFrame &&beginFrame, Alloc &&alloc, Free &&free );
+
+private slots:
+	void test_alignment();
+	void test_scopedRewind();
+	void test_overflowAndGrowth();
+	void test_peakUsage();
+	void test_stlAllocator();
+	void benchmark_serverFramesHeap();
+	void benchmark_serverFramesArena();
+};
+
+#endif
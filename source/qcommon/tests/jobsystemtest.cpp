@@ -0,0 +1,221 @@
+#include "jobsystemtest.h"
+#include "../jobsystem.h"
+
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <thread>
+
+using wsw::JobSystem;
+
+// Contention is the point, so there are more workers than processors on most machines
+static constexpr unsigned kNumWorkers = 7;
+
+struct CountingJobs {
+	static constexpr unsigned kNumJobs = 1024;
+
+	std::atomic<unsigned> counters[kNumJobs] {};
+
+	void submit( JobSystem *jobSystem, JobSystem::Counter *counter ) {
+		for( unsigned i = 0; i < kNumJobs; ++i ) {
+			jobSystem->submit( &CountingJobs::run, this, counter );
+		}
+	}
+
+	static void run( void *data ) {
+		auto *const jobs = (CountingJobs *)data;
+		// Every job increments the next counter which was not incremented yet
+		for( std::atomic<unsigned> &counter: jobs->counters ) {
+			unsigned expected = 0;
+			if( counter.compare_exchange_strong( expected, 1, std::memory_order_relaxed ) ) {
+				return;
+			}
+		}
+	}
+
+	[[nodiscard]]
+	bool areAllCountersSet() const {
+		for( const std::atomic<unsigned> &counter: counters ) {
+			if( counter.load( std::memory_order_relaxed ) != 1 ) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+void JobSystemTest::test_submitAndWait() {
+	for( const unsigned numWorkers: { 0u, 1u, kNumWorkers } ) {
+		JobSystem jobSystem( numWorkers );
+		QCOMPARE( jobSystem.numWorkers(), numWorkers );
+		for( unsigned round = 0; round < 20; ++round ) {
+			auto jobs = std::make_unique<CountingJobs>();
+			JobSystem::Counter counter;
+			jobs->submit( &jobSystem, &counter );
+			jobSystem.waitFor( &counter );
+			QVERIFY( counter.isDone() );
+			QVERIFY( jobs->areAllCountersSet() );
+		}
+	}
+}
+
+void JobSystemTest::test_concurrentSubmitters() {
+	JobSystem jobSystem( kNumWorkers );
+
+	constexpr unsigned kNumSubmitters = 4;
+	std::atomic<unsigned> numFailures { 0 };
+	std::thread submitters[kNumSubmitters];
+	for( std::thread &submitter: submitters ) {
+		submitter = std::thread( [&]() {
+			for( unsigned round = 0; round < 25; ++round ) {
+				auto jobs = std::make_unique<CountingJobs>();
+				JobSystem::Counter counter;
+				jobs->submit( &jobSystem, &counter );
+				jobSystem.waitFor( &counter );
+				if( !jobs->areAllCountersSet() ) {
+					numFailures.fetch_add( 1, std::memory_order_relaxed );
+				}
+			}
+		});
+	}
+	for( std::thread &submitter: submitters ) {
+		submitter.join();
+	}
+
+	QCOMPARE( numFailures.load(), 0u );
+}
+
+void JobSystemTest::test_dependencies() {
+	JobSystem jobSystem( kNumWorkers );
+
+	struct Stage {
+		std::atomic<unsigned> *numCompletedJobsOfPrevStage;
+		unsigned numJobsOfPrevStage;
+		std::atomic<unsigned> numCompletedJobs { 0 };
+		std::atomic<unsigned> numViolations { 0 };
+
+		static void run( void *data ) {
+			auto *const stage = (Stage *)data;
+			if( stage->numCompletedJobsOfPrevStage ) {
+				if( stage->numCompletedJobsOfPrevStage->load( std::memory_order_relaxed ) != stage->numJobsOfPrevStage ) {
+					stage->numViolations.fetch_add( 1, std::memory_order_relaxed );
+				}
+			}
+			// Make stages last long enough to expose violations
+			std::this_thread::yield();
+			stage->numCompletedJobs.fetch_add( 1, std::memory_order_relaxed );
+		}
+	};
+
+	constexpr unsigned kNumStages = 8;
+	constexpr unsigned kNumJobsPerStage = 64;
+	for( unsigned round = 0; round < 20; ++round ) {
+		Stage stages[kNumStages];
+		JobSystem::Counter counters[kNumStages];
+		// Jobs of all stages are submitted at once, and jobs of a stage are held until the previous stage is completed
+		for( unsigned stageIndex = 0; stageIndex < kNumStages; ++stageIndex ) {
+			Stage &stage = stages[stageIndex];
+			stage.numCompletedJobsOfPrevStage = stageIndex ? &stages[stageIndex - 1].numCompletedJobs : nullptr;
+			stage.numJobsOfPrevStage = kNumJobsPerStage;
+			JobSystem::Counter *const dependency = stageIndex ? &counters[stageIndex - 1] : nullptr;
+			for( unsigned jobNum = 0; jobNum < kNumJobsPerStage; ++jobNum ) {
+				jobSystem.submit( &Stage::run, &stage, &counters[stageIndex], dependency );
+			}
+		}
+
+		jobSystem.waitFor( &counters[kNumStages - 1] );
+		// Waiting for the last stage implies waiting for all stages
+		for( unsigned stageIndex = 0; stageIndex < kNumStages; ++stageIndex ) {
+			QVERIFY( counters[stageIndex].isDone() );
+			QCOMPARE( stages[stageIndex].numCompletedJobs.load(), kNumJobsPerStage );
+			QCOMPARE( stages[stageIndex].numViolations.load(), 0u );
+		}
+		for( JobSystem::Counter &counter: counters ) {
+			jobSystem.waitFor( &counter );
+		}
+	}
+}
+
+void JobSystemTest::test_parallelFor() {
+	JobSystem jobSystem( kNumWorkers );
+
+	constexpr unsigned kMaxItems = 1000;
+	auto hits = std::make_unique<std::atomic<unsigned>[]>( kMaxItems );
+	for( const unsigned numItems: { 0u, 1u, 2u, 7u, 64u, 999u, kMaxItems } ) {
+		for( const unsigned grainSize: { 0u, 1u, 3u, 16u, 2000u } ) {
+			for( unsigned i = 0; i < kMaxItems; ++i ) {
+				hits[i].store( 0, std::memory_order_relaxed );
+			}
+			bool hasBadRanges = false;
+			jobSystem.parallelFor( numItems, grainSize, [&]( unsigned beginIndex, unsigned endIndex ) {
+				if( beginIndex >= endIndex || endIndex > numItems || endIndex - beginIndex > std::max( 1u, grainSize ) ) {
+					hasBadRanges = true;
+				}
+				for( unsigned i = beginIndex; i < endIndex; ++i ) {
+					hits[i].fetch_add( 1, std::memory_order_relaxed );
+				}
+			});
+			QVERIFY( !hasBadRanges );
+			for( unsigned i = 0; i < kMaxItems; ++i ) {
+				QCOMPARE( hits[i].load( std::memory_order_relaxed ), i < numItems ? 1u : 0u );
+			}
+		}
+	}
+}
+
+void JobSystemTest::test_nestedParallelFor() {
+	JobSystem jobSystem( kNumWorkers );
+
+	constexpr unsigned kNumOuterItems = 32, kNumInnerItems = 256;
+	std::atomic<unsigned> numHits { 0 };
+	// Workers have to execute jobs of inner loops while waiting for their completion
+	jobSystem.parallelFor( kNumOuterItems, 1, [&]( unsigned beginIndex, unsigned endIndex ) {
+		for( unsigned i = beginIndex; i < endIndex; ++i ) {
+			jobSystem.parallelFor( kNumInnerItems, 8, [&]( unsigned innerBeginIndex, unsigned innerEndIndex ) {
+				numHits.fetch_add( innerEndIndex - innerBeginIndex, std::memory_order_relaxed );
+			});
+		}
+	});
+
+	QCOMPARE( numHits.load(), kNumOuterItems * kNumInnerItems );
+}
+
+// Measures the dispatch overhead of jobs that do nothing
+void JobSystemTest::benchmark_tinyJobs() {
+	JobSystem jobSystem( std::max( 1u, std::thread::hardware_concurrency() ) - 1 );
+
+	constexpr unsigned kNumJobs = 10000;
+	std::atomic<unsigned> numExecutedJobs { 0 };
+	QBENCHMARK {
+		JobSystem::Counter counter;
+		for( unsigned i = 0; i < kNumJobs; ++i ) {
+			jobSystem.submit( []( void *data ) {
+				( (std::atomic<unsigned> *)data )->fetch_add( 1, std::memory_order_relaxed );
+			}, &numExecutedJobs, &counter );
+		}
+		jobSystem.waitFor( &counter );
+	}
+
+	QVERIFY( numExecutedJobs.load() >= kNumJobs );
+}
+
+// Measures the scaling of jobs that are heavy enough to amortize the dispatch overhead
+void JobSystemTest::benchmark_largeJobs() {
+	JobSystem jobSystem( std::max( 1u, std::thread::hardware_concurrency() ) - 1 );
+
+	constexpr unsigned kNumItems = 1 << 16;
+	auto values = std::make_unique<float[]>( kNumItems );
+	QBENCHMARK {
+		jobSystem.parallelFor( kNumItems, 1024, [&]( unsigned beginIndex, unsigned endIndex ) {
+			for( unsigned i = beginIndex; i < endIndex; ++i ) {
+				float value = (float)i;
+				for( unsigned j = 0; j < 64; ++j ) {
+					value = std::sqrt( value * value + 1.0f );
+				}
+				values[i] = value;
+			}
+		});
+	}
+
+	QVERIFY( values[kNumItems - 1] >= (float)( kNumItems - 1 ) );
+}
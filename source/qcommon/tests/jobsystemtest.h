@@ -0,0 +1,19 @@
+#ifndef WSW_1edd6528_0824_4a9c_aa42_43ed870949aa_H
+#define WSW_1edd6528_0824_4a9c_aa42_43ed870949aa_H
+
+#include <QtTest/QtTest>
+
+class JobSystemTest : public QObject {
+	Q_OBJECT
+
+private slots:
+	void test_submitAndWait();
+	void test_concurrentSubmitters();
+	void test_dependencies();
+	void test_parallelFor();
+	void test_nestedParallelFor();
+	void benchmark_tinyJobs();
+	void benchmark_largeJobs();
+};
+
+#endif
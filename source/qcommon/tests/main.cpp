@@ -1,10 +1,16 @@
+#include "aabbtreetest.h"
 #include "boundsbuildertest.h"
+#include "bufpipetest.h"
 #include "bufferedreadertest.h"
+#include "cmtracetest.h"
 #include "configstringstoragetest.h"
+#include "deltacodectest.h"
 #include "demometadatatest.h"
 #include "enumtokenmatchertest.h"
 #include "fsutilstest.h"
+#include "framearenatest.h"
 #include "freelistallocatortest.h"
+#include "jobsystemtest.h"
 #include "staticstringtest.h"
 #include "stringsplittertest.h"
 #include "stringspanstoragetest.h"
@@ -39,6 +45,11 @@ int main( int argc, char **argv ) {
 		result |= QTest::qExec( &stringSpanStorageTest, argc, argv );
 	}
 
+	{
+		AabbTreeTest aabbTreeTest;
+		result |= QTest::qExec( &aabbTreeTest, argc, argv );
+	}
+
 	{
 		BoundsBuilderTest boundsBuilderTest;
 		result |= QTest::qExec( &boundsBuilderTest, argc, argv );
@@ -49,11 +60,26 @@ int main( int argc, char **argv ) {
 		result |= QTest::qExec( &bufferedReaderTest, argc, argv );
 	}
 
+	{
+		BufPipeTest bufPipeTest;
+		result |= QTest::qExec( &bufPipeTest, argc, argv );
+	}
+
+	{
+		CMTraceTest cmTraceTest;
+		result |= QTest::qExec( &cmTraceTest, argc, argv );
+	}
+
 	{
 		ConfigStringStorageTest configStringStorageTest;
 		result |= QTest::qExec( &configStringStorageTest, argc, argv );
 	}
 
+	{
+		DeltaCodecTest deltaCodecTest;
+		result |= QTest::qExec( &deltaCodecTest, argc, argv );
+	}
+
 	{
 		DemoMetadataTest demoMetadataTest;
 		result |= QTest::qExec( &demoMetadataTest, argc, argv );
@@ -64,6 +90,11 @@ int main( int argc, char **argv ) {
 		result |= QTest::qExec( &enumTokenMatcherTest, argc, argv );
 	}
 
+	{
+		FrameArenaTest frameArenaTest;
+		result |= QTest::qExec( &frameArenaTest, argc, argv );
+	}
+
 	{
 		FreelistAllocatorTest freelistAllocatorTest;
 		result |= QTest::qExec( &freelistAllocatorTest, argc, argv );
@@ -74,6 +105,11 @@ int main( int argc, char **argv ) {
 		result |= QTest::qExec( &fsUtilsTest, argc, argv );
 	}
 
+	{
+		JobSystemTest jobSystemTest;
+		result |= QTest::qExec( &jobSystemTest, argc, argv );
+	}
+
 	{
 		ToNumTest toNumTest;
 		result |= QTest::qExec( &toNumTest, argc, argv );
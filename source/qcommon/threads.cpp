@@ -21,6 +21,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "qcommon.h"
 #include "sys_threads.h"
 
+#include <atomic>
+#include <thread>
+#include <xmmintrin.h>
+
 /*
 * QMutex_Create
 */
@@ -143,6 +147,214 @@ void QThreads_Shutdown( void ) {
 
 // ============================================================================
 
+/**
+ * A single-producer/single-consumer lock-free implementation of the pipe.
+ * The wire format of commands is the same as of the default (locking) implementation.
+ * Writing a command does not touch any lock unless the reader thread is parked.
+ */
+class SpscCmdRing {
+public:
+	SpscCmdRing( uint8_t *buffer, size_t capacity, bool blockWrite )
+		: m_buffer( buffer ), m_capacity( capacity ), m_blockWrite( blockWrite ),
+		// Spinning just steals time from the other side in this case
+		m_useSpinning( std::thread::hardware_concurrency() > 1 ) {
+		assert( capacity && !( capacity & ( capacity - 1 ) ) );
+		m_parkingMutex = QMutex_Create();
+		m_parkingCondVar = QCondVar_Create();
+	}
+
+	~SpscCmdRing() {
+		QMutex_Destroy( &m_parkingMutex );
+		QCondVar_Destroy( &m_parkingCondVar );
+	}
+
+	[[nodiscard]]
+	bool isTerminated() const { return m_terminated.load( std::memory_order_acquire ); }
+
+	void writeCmd( const void *cmd, unsigned bytesToAdvance, unsigned bytesOfCmdToCopy );
+	[[nodiscard]]
+	auto readCmds( void *handlerArg, PipeHandlerFn handlerFn ) -> int;
+	/**
+	 * Spins for a while, then parks the reader until there are commands or the timeout expires.
+	 * @return false on timeout
+	 */
+	[[nodiscard]]
+	bool waitForCmds( unsigned timeoutMillis );
+	void finish();
+private:
+	static constexpr unsigned kNumSpinsBeforeParking = 1024;
+	static constexpr unsigned kNumSpinsBeforeYielding = 64;
+
+	[[nodiscard]]
+	bool hasPendingCmds() const {
+		return m_writeOffset.load( std::memory_order_acquire ) != m_readOffset.load( std::memory_order_relaxed );
+	}
+
+	void wakeParkedReader();
+
+	// Offsets grow monotonically and get wrapped only for addressing the buffer.
+	// Keep offsets that are modified by different threads on different cache lines.
+	alignas( 64 ) std::atomic<uint64_t> m_writeOffset { 0 };
+	// The last seen read offset, so the writer does not have to touch the reader cache line for every command
+	uint64_t m_cachedReadOffset { 0 };
+	alignas( 64 ) std::atomic<uint64_t> m_readOffset { 0 };
+	alignas( 64 ) std::atomic<bool> m_isReaderParked { false };
+	std::atomic<bool> m_terminated { false };
+
+	uint8_t *const m_buffer;
+	const size_t m_capacity;
+	const bool m_blockWrite;
+	const bool m_useSpinning;
+	qmutex_t *m_parkingMutex { nullptr };
+	qcondvar_t *m_parkingCondVar { nullptr };
+};
+
+void SpscCmdRing::writeCmd( const void *cmd, unsigned bytesToAdvance, unsigned bytesOfCmdToCopy ) {
+	assert( bytesOfCmdToCopy <= bytesToAdvance );
+	if( m_terminated.load( std::memory_order_relaxed ) ) {
+		return;
+	}
+
+	uint64_t writeOffset = m_writeOffset.load( std::memory_order_relaxed );
+	const size_t writeRemains = m_capacity - ( writeOffset & ( m_capacity - 1 ) );
+	// Commands are contiguous, skip the tail of the buffer if the command does not fit
+	const size_t bytesToSkip = bytesToAdvance > writeRemains ? writeRemains : 0;
+	const size_t requiredSpace = bytesToSkip + bytesToAdvance;
+	if( requiredSpace > m_capacity ) {
+		assert( false );
+		return;
+	}
+
+	if( writeOffset + requiredSpace - m_cachedReadOffset > m_capacity ) {
+		for( unsigned numSpins = 0;; ++numSpins ) {
+			m_cachedReadOffset = m_readOffset.load( std::memory_order_acquire );
+			if( writeOffset + requiredSpace - m_cachedReadOffset <= m_capacity ) {
+				break;
+			}
+			if( !m_blockWrite || m_terminated.load( std::memory_order_relaxed ) ) {
+				return;
+			}
+			if( m_useSpinning && numSpins < kNumSpinsBeforeYielding ) {
+				_mm_pause();
+			} else {
+				QThread_Yield();
+			}
+		}
+	}
+
+	if( bytesToSkip ) {
+		// Put an explicit pointer reset cmd if it fits, the reader skips the tail implicitly otherwise
+		if( bytesToSkip >= sizeof( int ) ) {
+			const int resetCmd = -1;
+			memcpy( m_buffer + ( writeOffset & ( m_capacity - 1 ) ), &resetCmd, sizeof( int ) );
+		}
+		writeOffset += bytesToSkip;
+	}
+
+	memcpy( m_buffer + ( writeOffset & ( m_capacity - 1 ) ), cmd, bytesOfCmdToCopy );
+	m_writeOffset.store( writeOffset + bytesToAdvance, std::memory_order_release );
+
+	// Pairs with the fence in waitForCmds()
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+	if( m_isReaderParked.load( std::memory_order_relaxed ) ) {
+		// Wake the reader only once, subsequent commands don't need it
+		if( m_isReaderParked.exchange( false, std::memory_order_relaxed ) ) {
+			wakeParkedReader();
+		}
+	}
+}
+
+void SpscCmdRing::wakeParkedReader() {
+	// Locking guarantees that the reader is either already waiting or has not checked for commands yet
+	QMutex_Lock( m_parkingMutex );
+	QCondVar_Wake( m_parkingCondVar );
+	QMutex_Unlock( m_parkingMutex );
+}
+
+auto SpscCmdRing::readCmds( void *handlerArg, PipeHandlerFn handlerFn ) -> int {
+	int read = 0;
+
+	uint64_t readOffset = m_readOffset.load( std::memory_order_relaxed );
+	// Process all commands that are visible at the moment of loading the write offset in a batch,
+	// and make the consumed space available to the writer only after the batch is processed.
+	uint64_t writeOffset;
+	while( ( writeOffset = m_writeOffset.load( std::memory_order_acquire ) ) != readOffset ) {
+		if( m_terminated.load( std::memory_order_relaxed ) ) {
+			return -1;
+		}
+		do {
+			const size_t readPos = readOffset & ( m_capacity - 1 );
+			const size_t readRemains = m_capacity - readPos;
+			if( readRemains < sizeof( int ) ) {
+				// implicit reset
+				readOffset += readRemains;
+				continue;
+			}
+
+			int cmd;
+			memcpy( &cmd, m_buffer + readPos, sizeof( int ) );
+			if( cmd == -1 ) {
+				// this cmd is special
+				readOffset += readRemains;
+				continue;
+			}
+
+			const size_t cmdSize = handlerFn( handlerArg, cmd, m_buffer + readPos );
+			read++;
+
+			if( !cmdSize || cmdSize > writeOffset - readOffset ) {
+				assert( cmdSize <= writeOffset - readOffset );
+				m_readOffset.store( writeOffset, std::memory_order_release );
+				m_terminated.store( true, std::memory_order_release );
+				return -1;
+			}
+
+			readOffset += cmdSize;
+		} while( readOffset != writeOffset );
+
+		m_readOffset.store( readOffset, std::memory_order_release );
+	}
+
+	return m_terminated.load( std::memory_order_relaxed ) ? -1 : read;
+}
+
+bool SpscCmdRing::waitForCmds( unsigned timeoutMillis ) {
+	const unsigned numSpins = m_useSpinning ? kNumSpinsBeforeParking : 0;
+	for( unsigned i = 0; i < numSpins; ++i ) {
+		if( hasPendingCmds() || isTerminated() ) {
+			return true;
+		}
+		_mm_pause();
+	}
+
+	bool hasCmds;
+	QMutex_Lock( m_parkingMutex );
+	m_isReaderParked.store( true, std::memory_order_relaxed );
+	// Pairs with the fence in writeCmd()
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+	hasCmds = hasPendingCmds() || isTerminated();
+	if( !hasCmds ) {
+		(void)QCondVar_Wait( m_parkingCondVar, m_parkingMutex, timeoutMillis );
+		hasCmds = hasPendingCmds() || isTerminated();
+	}
+	m_isReaderParked.store( false, std::memory_order_relaxed );
+	QMutex_Unlock( m_parkingMutex );
+
+	return hasCmds;
+}
+
+void SpscCmdRing::finish() {
+	while( m_readOffset.load( std::memory_order_acquire ) != m_writeOffset.load( std::memory_order_relaxed ) ) {
+		if( isTerminated() ) {
+			break;
+		}
+		wakeParkedReader();
+		QThread_Yield();
+	}
+}
+
+// ============================================================================
+
 struct qbufPipe_s {
 	int blockWrite;
 	volatile int terminated;
@@ -154,15 +366,31 @@ struct qbufPipe_s {
 	qcondvar_t *nonempty_condvar;
 	qmutex_t *nonempty_mutex;
 	char *buf;
+	SpscCmdRing *spscRing;
 };
 
 /*
 * QBufPipe_Create
 */
 qbufPipe_t *QBufPipe_Create( size_t bufSize, int flags ) {
+	if( flags & QBUFPIPE_LOCKFREE_SPSC ) {
+		size_t capacity = 64;
+		while( capacity < bufSize ) {
+			capacity <<= 1;
+		}
+		qbufPipe_t *pipe = (qbufPipe_t *)malloc( sizeof( *pipe ) + sizeof( SpscCmdRing ) + alignof( SpscCmdRing ) + capacity );
+		memset( pipe, 0, sizeof( *pipe ) );
+		pipe->blockWrite = flags & QBUFPIPE_BLOCKING_WRITE;
+		pipe->bufSize = capacity;
+		void *const ringMem = (void *)( ( (uintptr_t)( pipe + 1 ) + alignof( SpscCmdRing ) - 1 ) & ~( alignof( SpscCmdRing ) - 1 ) );
+		pipe->buf = (char *)ringMem + sizeof( SpscCmdRing );
+		pipe->spscRing = new( ringMem )SpscCmdRing( (uint8_t *)pipe->buf, capacity, pipe->blockWrite != 0 );
+		return pipe;
+	}
+
 	qbufPipe_t *pipe = (qbufPipe_t *)malloc( sizeof( *pipe ) + bufSize );
 	memset( pipe, 0, sizeof( *pipe ) );
-	pipe->blockWrite = flags & 1;
+	pipe->blockWrite = flags & QBUFPIPE_BLOCKING_WRITE;
 	pipe->buf = (char *)( pipe + 1 );
 	pipe->bufSize = bufSize;
 	pipe->cmdbuf_mutex = QMutex_Create();
@@ -185,6 +413,12 @@ void QBufPipe_Destroy( qbufPipe_t **ppipe ) {
 	pipe = *ppipe;
 	*ppipe = NULL;
 
+	if( pipe->spscRing ) {
+		pipe->spscRing->~SpscCmdRing();
+		free( pipe );
+		return;
+	}
+
 	QMutex_Destroy( &pipe->cmdbuf_mutex );
 	QMutex_Destroy( &pipe->nonempty_mutex );
 	QCondVar_Destroy( &pipe->nonempty_condvar );
@@ -207,6 +441,11 @@ static void QBufPipe_Wake( qbufPipe_t *pipe ) {
 * or terminates with an error.
 */
 void QBufPipe_Finish( qbufPipe_t *pipe ) {
+	if( pipe->spscRing ) {
+		pipe->spscRing->finish();
+		return;
+	}
+
 	while( Sys_Atomic_CAS( &pipe->cmdbuf_len, 0, 0, pipe->cmdbuf_mutex ) == false && !pipe->terminated ) {
 		QMutex_Lock( pipe->nonempty_mutex );
 		QBufPipe_Wake( pipe );
@@ -247,6 +486,10 @@ void QBufPipe_WriteCmd( qbufPipe_t *pipe, const void *pcmd, unsigned bytesToAdva
 	if( !pipe ) {
 		return;
 	}
+	if( pipe->spscRing ) {
+		pipe->spscRing->writeCmd( pcmd, bytesToAdvance, bytesOfCmdToCopy );
+		return;
+	}
 	if( pipe->terminated ) {
 		return;
 	}
@@ -322,6 +565,9 @@ int QBufPipe_ReadCmds( qbufPipe_t *pipe, void *handlerArg, PipeHandlerFn handler
 	if( !pipe ) {
 		return -1;
 	}
+	if( pipe->spscRing ) {
+		return pipe->spscRing->readCmds( handlerArg, handlerFn );
+	}
 
 	while( Sys_Atomic_CAS( &pipe->cmdbuf_len, 0, 0, pipe->cmdbuf_mutex ) == false && !pipe->terminated ) {
 		int cmd;
@@ -375,6 +621,16 @@ int QBufPipe_ReadCmds( qbufPipe_t *pipe, void *handlerArg, PipeHandlerFn handler
 * QBufPipe_Wait
 */
 void QBufPipe_Wait( qbufPipe_t *pipe, PipeWaiterFn waiterFn, void *handlerArg, PipeHandlerFn handlerFn, unsigned timeout_msec ) {
+	if( pipe->spscRing ) {
+		while( !pipe->spscRing->isTerminated() ) {
+			const bool timeout = !pipe->spscRing->waitForCmds( timeout_msec );
+			if( waiterFn( pipe, handlerArg, handlerFn, timeout ) < 0 ) {
+				return;
+			}
+		}
+		return;
+	}
+
 	while( !pipe->terminated ) {
 		int res;
 		bool timeout = false;
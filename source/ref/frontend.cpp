@@ -97,7 +97,15 @@ void Frontend::submitDrawSceneRequest( DrawSceneRequest *request ) {
 	m_drawSceneRequestHolder.clear();
 }
 
-Frontend::Frontend() {
+// Culling jobs are short, so don't occupy all cores (other subsystems run their threads as well)
+static auto suggestNumberOfCullingThreads() -> unsigned {
+	unsigned numPhysicalProcessors = 1, numLogicalProcessors = 1;
+	(void)Sys_GetNumberOfProcessors( &numPhysicalProcessors, &numLogicalProcessors );
+	// The render thread takes part in execution of jobs as well
+	return wsw::min( numPhysicalProcessors > 1 ? numPhysicalProcessors - 1 : 0u, 3u );
+}
+
+Frontend::Frontend() : m_jobRunner( suggestNumberOfCullingThreads() ) {
 }
 
 alignas( 32 ) static SingletonHolder<Frontend> sceneInstanceHolder;
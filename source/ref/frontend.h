@@ -22,9 +22,13 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #ifndef WSW_63ccf348_3b16_4f9c_9a49_cd5849918618_H
 #define WSW_63ccf348_3b16_4f9c_9a49_cd5849918618_H
 
+#include "jobrunner.h"
+
 #include <memory>
 #include <span>
 
+class FrontendCullingTest;
+
 struct alignas( 32 )Frustum {
 	alignas( 32 ) float planeX[8];
 	alignas( 32 ) float planeY[8];
@@ -45,6 +49,7 @@ struct alignas( 32 )Frustum {
 namespace wsw::ref {
 
 class alignas( 32 ) Frontend {
+	friend class ::FrontendCullingTest;
 public:
 	Frontend();
 
@@ -202,7 +207,44 @@ private:
 	// Make sure it can be supplied to the generic culling subroutine
 	static_assert( offsetof( VisTestedModel, absMins ) + 4 * sizeof( float ) == offsetof( VisTestedModel, absMaxs ) );
 
-	BufferHolder<VisTestedModel> m_visTestedModelsBuffer;
+	// Culling passes that are independent once the visible world leaves and frusta of occluders are known
+	enum CullingJob : unsigned {
+		// Put heavy jobs first
+		WorldSurfacesCullingJob,
+		AliasModelsCullingJob,
+		SkeletalModelsCullingJob,
+		LightsCullingJob,
+		ParticlesCullingJob,
+		NullModelsCullingJob,
+		BrushModelsCullingJob,
+		SpritesCullingJob,
+		DynamicMeshesCullingJob,
+		CompoundDynamicMeshesCullingJob,
+		QuadPolysCullingJob,
+		kNumCullingJobs
+	};
+
+	static constexpr unsigned kEntitiesCullingJobsMask =
+		( 1u << AliasModelsCullingJob ) | ( 1u << SkeletalModelsCullingJob ) | ( 1u << NullModelsCullingJob ) |
+		( 1u << BrushModelsCullingJob ) | ( 1u << SpritesCullingJob ) | ( 1u << DynamicMeshesCullingJob ) |
+		( 1u << CompoundDynamicMeshesCullingJob );
+
+	// Every job has its own buffers so they can run concurrently (keep them apart to avoid false sharing)
+	struct alignas( 64 ) CullingJobState {
+		BufferHolder<VisTestedModel> visTestedModels;
+		BufferHolder<uint16_t> tmpIndices;
+		BufferHolder<uint16_t> tmpIndices2;
+		std::span<const uint16_t> visibleIndices;
+	};
+
+	CullingJobState m_cullingJobStates[kNumCullingJobs];
+
+	std::span<const unsigned> m_nonOccludedLeaves;
+	std::span<const unsigned> m_partiallyOccludedLeaves;
+	std::span<const uint16_t> m_visibleProgramLightIndicesSpan;
+	std::span<const uint16_t> m_visibleCoronaLightIndicesSpan;
+
+	JobRunner m_jobRunner;
 
 	BufferHolder<uint32_t> m_leafLightBitsOfSurfacesHolder;
 
@@ -229,14 +271,24 @@ private:
 	void updatePortalSurface( portalSurface_t *portalSurface, const mesh_t *mesh,
 							  const float *mins, const float *maxs, const shader_t *shader, void *drawSurf );
 
-	void collectVisiblePolys( Scene *scene, std::span<const Frustum> frusta );
+	[[nodiscard]]
+	auto collectVisibleWorldLeavesAndOccluders() -> std::pair<std::span<const unsigned>, std::span<const Frustum>>;
 
 	[[nodiscard]]
-	auto cullWorldSurfaces() -> std::tuple<std::span<const Frustum>, std::span<const unsigned>, std::span<const unsigned>>;
+	auto cullWorldSurfaces( std::span<const unsigned> visibleLeaves, std::span<const Frustum> occluderFrusta )
+		-> std::pair<std::span<const unsigned>, std::span<const unsigned>>;
 
-	void addVisibleWorldSurfacesToSortList( Scene *scene );
+	void runCullingJobs( Scene *scene, unsigned jobsMask,
+						 std::span<const unsigned> visibleLeaves,
+						 std::span<const Frustum> occluderFrusta );
+
+	void runCullingJob( Scene *scene, CullingJob job,
+						std::span<const unsigned> visibleLeaves,
+						std::span<const Frustum> occluderFrusta );
 
-	void collectVisibleEntities( Scene *scene, std::span<const Frustum> frusta );
+	void addCulledEntriesToSortList( Scene *scene, unsigned jobsMask );
+
+	void addVisibleWorldSurfacesToSortList( Scene *scene );
 
 	[[nodiscard]]
 	auto collectVisibleLights( Scene *scene, std::span<const Frustum> frusta )
@@ -291,16 +343,12 @@ private:
 					 uint16_t *tmpProgramLightIndices )
 					 -> std::tuple<std::span<const uint16_t>, std::span<const uint16_t>, std::span<const uint16_t>>;
 
-	void collectVisibleParticles( Scene *scene, std::span<const Frustum> frusta );
-
 	[[nodiscard]]
 	auto cullParticleAggregates( std::span<const Scene::ParticlesAggregate> aggregates,
 								 const Frustum *__restrict primaryFrustum,
 								 std::span<const Frustum> occluderFrusta,
 								 uint16_t *tmpIndices ) -> std::span<const uint16_t>;
 
-	void collectVisibleDynamicMeshes( Scene *scene, std::span<const Frustum> frusta );
-
 	[[nodiscard]]
 	auto cullCompoundDynamicMeshes( std::span<const Scene::CompoundDynamicMesh> meshes,
 									const Frustum *__restrict primaryFrustum,
@@ -382,15 +430,15 @@ private:
 
 	template <unsigned Arch>
 	[[nodiscard]]
-	auto cullEntriesWithBoundsArch( const void *entries, unsigned numEntries, unsigned boundsFieldOffset,
-								unsigned strideInBytes, const Frustum *__restrict primaryFrustum,
-								std::span<const Frustum> occluderFrusta, uint16_t *tmpIndices ) -> std::span<const uint16_t>;
+	static auto cullEntriesWithBoundsArch( const void *entries, unsigned numEntries, unsigned boundsFieldOffset,
+										unsigned strideInBytes, const Frustum *__restrict primaryFrustum,
+										std::span<const Frustum> occluderFrusta, uint16_t *tmpIndices ) -> std::span<const uint16_t>;
 
 	template <unsigned Arch>
 	[[nodiscard]]
-	auto cullEntryPtrsWithBoundsArch( const void **entryPtrs, unsigned numEntries, unsigned boundsFieldOffset,
-								      const Frustum *__restrict primaryFrustum, std::span<const Frustum> occluderFrusta,
-								      uint16_t *tmpIndices ) -> std::span<const uint16_t>;
+	static auto cullEntryPtrsWithBoundsArch( const void **entryPtrs, unsigned numEntries, unsigned boundsFieldOffset,
+										      const Frustum *__restrict primaryFrustum, std::span<const Frustum> occluderFrusta,
+										      uint16_t *tmpIndices ) -> std::span<const uint16_t>;
 
 	[[nodiscard]]
 	auto collectVisibleWorldLeavesSse2() -> std::span<const unsigned>;
@@ -408,15 +456,15 @@ private:
 												 MergedSurfSpan *mergedSurfSpans );
 
 	[[nodiscard]]
-	auto cullEntriesWithBoundsSse2( const void *entries, unsigned numEntries, unsigned boundsFieldOffset,
-									unsigned strideInBytes, const Frustum *__restrict primaryFrustum,
-									std::span<const Frustum> occluderFrusta, uint16_t *tmpIndices ) -> std::span<const uint16_t>;
+	static auto cullEntriesWithBoundsSse2( const void *entries, unsigned numEntries, unsigned boundsFieldOffset,
+											unsigned strideInBytes, const Frustum *__restrict primaryFrustum,
+											std::span<const Frustum> occluderFrusta, uint16_t *tmpIndices ) -> std::span<const uint16_t>;
 
 	// Allows supplying an array of pointers instead of a contignuous array
 	[[nodiscard]]
-	auto cullEntryPtrsWithBoundsSse2( const void **entryPtrs, unsigned numEntries, unsigned boundsFieldOffset,
-									  const Frustum *__restrict primaryFrustum, std::span<const Frustum> occluderFrusta,
-									  uint16_t *tmpIndices ) -> std::span<const uint16_t>;
+	static auto cullEntryPtrsWithBoundsSse2( const void **entryPtrs, unsigned numEntries, unsigned boundsFieldOffset,
+											  const Frustum *__restrict primaryFrustum, std::span<const Frustum> occluderFrusta,
+											  uint16_t *tmpIndices ) -> std::span<const uint16_t>;
 
 	[[nodiscard]]
 	auto collectVisibleWorldLeaves() -> std::span<const unsigned>;
@@ -434,15 +482,15 @@ private:
 											 MergedSurfSpan *mergedSurfSpans );
 
 	[[nodiscard]]
-	auto cullEntriesWithBounds( const void *entries, unsigned numEntries, unsigned boundsFieldOffset,
-								unsigned strideInBytes, const Frustum *__restrict primaryFrustum,
-								std::span<const Frustum> occluderFrusta, uint16_t *tmpIndices ) -> std::span<const uint16_t>;
+	static auto cullEntriesWithBounds( const void *entries, unsigned numEntries, unsigned boundsFieldOffset,
+										unsigned strideInBytes, const Frustum *__restrict primaryFrustum,
+										std::span<const Frustum> occluderFrusta, uint16_t *tmpIndices ) -> std::span<const uint16_t>;
 
 	// Allows supplying an array of pointers instead of a contignuous array
 	[[nodiscard]]
-	auto cullEntryPtrsWithBounds( const void **entryPtrs, unsigned numEntries, unsigned boundsFieldOffset,
-								  const Frustum *__restrict primaryFrustum, std::span<const Frustum> occluderFrusta,
-								  uint16_t *tmpIndices ) -> std::span<const uint16_t>;
+	static auto cullEntryPtrsWithBounds( const void **entryPtrs, unsigned numEntries, unsigned boundsFieldOffset,
+										  const Frustum *__restrict primaryFrustum, std::span<const Frustum> occluderFrusta,
+										  uint16_t *tmpIndices ) -> std::span<const uint16_t>;
 
 	void markSurfacesOfLeavesAsVisible( std::span<const unsigned> indicesOfLeaves, MergedSurfSpan *mergedSurfSpans );
 
@@ -26,64 +26,12 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include <algorithm>
 
-void Frustum::setPlaneComponentsAtIndex( unsigned index, const float *n, float d ) {
-	const uint32_t blendsForSign[2] { 0, ~( (uint32_t)0 ) };
-
-	const float nX = planeX[index] = n[0];
-	const float nY = planeY[index] = n[1];
-	const float nZ = planeZ[index] = n[2];
-
-	planeD[index] = d;
-
-	xBlendMasks[index] = blendsForSign[nX < 0];
-	yBlendMasks[index] = blendsForSign[nY < 0];
-	zBlendMasks[index] = blendsForSign[nZ < 0];
-}
-
-void Frustum::fillComponentTails( unsigned indexOfPlaneToReplicate ) {
-	// Sanity check
-	assert( indexOfPlaneToReplicate >= 3 && indexOfPlaneToReplicate < 8 );
-	for( unsigned i = indexOfPlaneToReplicate; i < 8; ++i ) {
-		planeX[i] = planeX[indexOfPlaneToReplicate];
-		planeY[i] = planeY[indexOfPlaneToReplicate];
-		planeZ[i] = planeZ[indexOfPlaneToReplicate];
-		planeD[i] = planeD[indexOfPlaneToReplicate];
-		xBlendMasks[i] = xBlendMasks[indexOfPlaneToReplicate];
-		yBlendMasks[i] = yBlendMasks[indexOfPlaneToReplicate];
-		zBlendMasks[i] = zBlendMasks[indexOfPlaneToReplicate];
-	}
-}
-
-void Frustum::setupFor4Planes( const float *viewOrigin, const mat3_t viewAxis, float fovX, float fovY ) {
-	const float *const forward = &viewAxis[AXIS_FORWARD];
-	const float *const left    = &viewAxis[AXIS_RIGHT];
-	const float *const up      = &viewAxis[AXIS_UP];
-
-	const vec3_t right { -left[0], -left[1], -left[2] };
-
-	const float xRotationAngle = 90.0f - 0.5f * fovX;
-	const float yRotationAngle = 90.0f - 0.5f * fovY;
-
-	vec3_t planeNormals[4];
-	RotatePointAroundVector( planeNormals[0], up, forward, -xRotationAngle );
-	RotatePointAroundVector( planeNormals[1], up, forward, +xRotationAngle );
-	RotatePointAroundVector( planeNormals[2], right, forward, +yRotationAngle );
-	RotatePointAroundVector( planeNormals[3], right, forward, -yRotationAngle );
-
-	for( unsigned i = 0; i < 4; ++i ) {
-		setPlaneComponentsAtIndex( i, planeNormals[i], DotProduct( viewOrigin, planeNormals[i] ) );
-	}
-}
-
 namespace wsw::ref {
 
-auto Frontend::cullWorldSurfaces()
-	-> std::tuple<std::span<const Frustum>, std::span<const unsigned>, std::span<const unsigned>> {
-
+auto Frontend::collectVisibleWorldLeavesAndOccluders() -> std::pair<std::span<const unsigned>, std::span<const Frustum>> {
 	m_occludersSelectionFrame++;
 	m_occlusionCullingFrame++;
 
-	const unsigned numMergedSurfaces = rsh.worldBrushModel->numDrawSurfaces;
 	const unsigned numWorldSurfaces = rsh.worldBrushModel->numModelSurfaces;
 	const unsigned numWorldLeaves = rsh.worldBrushModel->numvisleafs;
 
@@ -96,6 +44,29 @@ auto Frontend::cullWorldSurfaces()
 	m_visibleOccludersBuffer.reserve( rsh.worldBrushModel->numOccluders );
 	m_sortedOccludersBuffer.reserve( rsh.worldBrushModel->numOccluders );
 
+	std::span<const unsigned> visibleLeaves;
+	std::span<const Frustum> occluderFrusta;
+
+	// Selection of occluders does not depend on visible leaves, so these passes can run in parallel
+	m_jobRunner.parallelFor( 2, [&]( unsigned jobIndex ) {
+		if( jobIndex == 0 ) {
+			// Collect occluder surfaces that fall into the primary frustum and that are "good enough"
+			const std::span<const SortedOccluder> visibleOccluders = collectVisibleOccluders();
+			// Build frusta of occluders, while performing some additional frusta pruning
+			occluderFrusta = buildFrustaOfOccluders( visibleOccluders );
+		} else {
+			// Cull world leaves by the primary frustum
+			visibleLeaves = collectVisibleWorldLeaves();
+		}
+	});
+
+	return { visibleLeaves, occluderFrusta };
+}
+
+auto Frontend::cullWorldSurfaces( std::span<const unsigned> visibleLeaves, std::span<const Frustum> occluderFrusta )
+	-> std::pair<std::span<const unsigned>, std::span<const unsigned>> {
+	const unsigned numMergedSurfaces = rsh.worldBrushModel->numDrawSurfaces;
+
 	m_drawSurfSurfSpans.reserve( numMergedSurfaces );
 	MergedSurfSpan *const mergedSurfSpans = m_drawSurfSurfSpans.data.get();
 	for( unsigned i = 0; i < numMergedSurfaces; ++i ) {
@@ -103,15 +74,6 @@ auto Frontend::cullWorldSurfaces()
 		mergedSurfSpans[i].lastSurface = std::numeric_limits<int>::min();
 	}
 
-	// Cull world leaves by the primary frustum
-	const std::span<const unsigned> visibleLeaves = collectVisibleWorldLeaves();
-
-	// TODO: Can run in parallel with leaves collection
-	// Collect occluder surfaces of leaves that fall into the primary frustum and that are "good enough"
-	const std::span<const SortedOccluder> visibleOccluders  = collectVisibleOccluders();
-	// Build frusta of occluders, while performing some additional frusta pruning
-	const std::span<const Frustum> occluderFrusta = buildFrustaOfOccluders( visibleOccluders );
-
 	std::span<const unsigned> nonOccludedLeaves;
 	std::span<const unsigned> partiallyOccludedLeaves;
 	if( occluderFrusta.empty() ) {
@@ -127,73 +89,150 @@ auto Frontend::cullWorldSurfaces()
 		cullSurfacesInVisLeavesByOccluders( partiallyOccludedLeaves, occluderFrusta, mergedSurfSpans );
 	}
 
-	return { occluderFrusta, nonOccludedLeaves, partiallyOccludedLeaves };
+	return { nonOccludedLeaves, partiallyOccludedLeaves };
 }
 
-void Frontend::collectVisiblePolys( Scene *scene, std::span<const Frustum> frusta ) {
-	VisTestedModel *tmpModels = m_visTestedModelsBuffer.data.get();
-	QuadPoly **quadPolys      = scene->m_quadPolys.data();
-
-	uint16_t tmpIndices[MAX_QUAD_POLYS];
-	const auto visibleIndices = cullQuadPolys( quadPolys, scene->m_quadPolys.size(), &m_stateForActiveCamera->frustum,
-											   frusta, tmpIndices, tmpModels );
-
-	const auto *polyEntity = scene->m_polyent;
-	for( const unsigned index: visibleIndices ) {
-		QuadPoly *const p = quadPolys[index];
-		(void)addEntryToSortList( polyEntity, nullptr, p->material, 0, index, nullptr, quadPolys[index], ST_QUAD_POLY );
+void Frontend::runCullingJobs( Scene *scene, unsigned jobsMask,
+							   std::span<const unsigned> visibleLeaves,
+							   std::span<const Frustum> occluderFrusta ) {
+	// Lights of world surfaces are marked using these spans even if the world is not drawn
+	m_nonOccludedLeaves       = {};
+	m_partiallyOccludedLeaves = {};
+
+	CullingJob jobs[kNumCullingJobs];
+	unsigned numJobs = 0;
+	for( unsigned job = 0; job < kNumCullingJobs; ++job ) {
+		if( jobsMask & ( 1u << job ) ) {
+			jobs[numJobs++] = (CullingJob)job;
+		}
 	}
-}
 
-void Frontend::collectVisibleEntities( Scene *scene, std::span<const Frustum> frusta ) {
-	uint16_t indices[MAX_ENTITIES], indices2[MAX_ENTITIES];
-	m_visTestedModelsBuffer.reserve( MAX_ENTITIES );
-
-	VisTestedModel *const visModels = m_visTestedModelsBuffer.data.get();
-	const Frustum *const frustum    = &m_stateForActiveCamera->frustum;
+	m_jobRunner.parallelFor( numJobs, [&]( unsigned jobIndex ) {
+		runCullingJob( scene, jobs[jobIndex], visibleLeaves, occluderFrusta );
+	});
+}
 
-	const std::span<const entity_t> nullModelEntities = scene->m_nullModelEntities;
-	const auto nullModelIndices = cullNullModelEntities( nullModelEntities, frustum, frusta, indices, visModels );
-	addNullModelEntitiesToSortList( nullModelEntities.data(), nullModelIndices );
+void Frontend::runCullingJob( Scene *scene, CullingJob job,
+							  std::span<const unsigned> visibleLeaves,
+							  std::span<const Frustum> occluderFrusta ) {
+	const Frustum *const frustum = &m_stateForActiveCamera->frustum;
 
-	const std::span<const entity_t> aliasModelEntities = scene->m_aliasModelEntities;
-	const auto aliasModelIndices = cullAliasModelEntities( aliasModelEntities, frustum, frusta, indices, visModels );
-	addAliasModelEntitiesToSortList( aliasModelEntities.data(), { visModels, aliasModelIndices.size() }, aliasModelIndices );
+	CullingJobState *const state = &m_cullingJobStates[job];
+	// Reserving is cheap once buffers have grown
+	state->visTestedModels.reserve( MAX_ENTITIES );
+	state->tmpIndices.reserve( MAX_ENTITIES );
+	state->tmpIndices2.reserve( MAX_ENTITIES );
+	VisTestedModel *const visModels = state->visTestedModels.data.get();
+	uint16_t *const tmpIndices      = state->tmpIndices.data.get();
+
+	static_assert( MAX_QUAD_POLYS <= MAX_ENTITIES && Scene::kMaxParticleAggregates <= MAX_ENTITIES );
+	static_assert( Scene::kMaxDynamicMeshes <= MAX_ENTITIES && Scene::kMaxCompoundDynamicMeshes <= MAX_ENTITIES );
+
+	switch( job ) {
+		case WorldSurfacesCullingJob:
+			std::tie( m_nonOccludedLeaves, m_partiallyOccludedLeaves ) = cullWorldSurfaces( visibleLeaves, occluderFrusta );
+			break;
+		case AliasModelsCullingJob:
+			state->visibleIndices = cullAliasModelEntities( scene->m_aliasModelEntities, frustum, occluderFrusta,
+															tmpIndices, visModels );
+			break;
+		case SkeletalModelsCullingJob:
+			state->visibleIndices = cullSkeletalModelEntities( scene->m_skeletalModelEntities, frustum, occluderFrusta,
+															   tmpIndices, visModels );
+			break;
+		case LightsCullingJob:
+			std::tie( m_visibleProgramLightIndicesSpan, m_visibleCoronaLightIndicesSpan ) =
+				collectVisibleLights( scene, occluderFrusta );
+			break;
+		case ParticlesCullingJob:
+			state->visibleIndices = cullParticleAggregates( scene->m_particles, frustum, occluderFrusta, tmpIndices );
+			break;
+		case NullModelsCullingJob:
+			state->visibleIndices = cullNullModelEntities( scene->m_nullModelEntities, frustum, occluderFrusta,
+														   tmpIndices, visModels );
+			break;
+		case BrushModelsCullingJob:
+			state->visibleIndices = cullBrushModelEntities( scene->m_brushModelEntities, frustum, occluderFrusta,
+															tmpIndices, visModels );
+			break;
+		case SpritesCullingJob:
+			state->visibleIndices = cullSpriteEntities( scene->m_spriteEntities, frustum, occluderFrusta,
+														tmpIndices, state->tmpIndices2.data.get(), visModels );
+			break;
+		case DynamicMeshesCullingJob:
+			state->visibleIndices = cullDynamicMeshes( scene->m_dynamicMeshes.data(), scene->m_dynamicMeshes.size(),
+													   frustum, occluderFrusta, tmpIndices );
+			break;
+		case CompoundDynamicMeshesCullingJob:
+			state->visibleIndices = cullCompoundDynamicMeshes( scene->m_compoundDynamicMeshes, frustum, occluderFrusta,
+															   tmpIndices );
+			break;
+		case QuadPolysCullingJob:
+			state->visibleIndices = cullQuadPolys( scene->m_quadPolys.data(), scene->m_quadPolys.size(), frustum,
+												   occluderFrusta, tmpIndices, visModels );
+			break;
+		default:
+			assert( false );
+	}
+}
 
-	const std::span<const entity_t> skeletalModelEntities = scene->m_skeletalModelEntities;
-	const auto skeletalModelIndices = cullSkeletalModelEntities( skeletalModelEntities, frustum, frusta, indices, visModels );
-	addSkeletalModelEntitiesToSortList( skeletalModelEntities.data(), { visModels, skeletalModelIndices.size() }, skeletalModelIndices );
+void Frontend::addCulledEntriesToSortList( Scene *scene, unsigned jobsMask ) {
+	const auto *const polyEntity = scene->m_polyent;
 
-	const std::span<const entity_t> brushModelEntities = scene->m_brushModelEntities;
-	const auto brushModelIndices = cullBrushModelEntities( brushModelEntities, frustum, frusta, indices, visModels );
-	const std::span<const Scene::DynamicLight> dynamicLights { scene->m_dynamicLights.data(), scene->m_dynamicLights.size() };
-	const std::span<const VisTestedModel> brushVisModels { visModels, brushModelIndices.size() };
-	addBrushModelEntitiesToSortList( brushModelEntities.data(), brushVisModels, brushModelIndices, dynamicLights );
+	// Keep the order of additions fixed, so the sort list does not depend on scheduling of jobs
 
-	const std::span<const entity_t> spriteEntities = scene->m_spriteEntities;
-	const auto spriteModelIndices = cullSpriteEntities( spriteEntities, frustum, frusta, indices, indices2, visModels );
-	addSpriteEntitiesToSortList( spriteEntities.data(), spriteModelIndices );
-}
+	if( jobsMask & ( 1u << QuadPolysCullingJob ) ) {
+		QuadPoly **const quadPolys = scene->m_quadPolys.data();
+		for( const unsigned index: m_cullingJobStates[QuadPolysCullingJob].visibleIndices ) {
+			QuadPoly *const p = quadPolys[index];
+			(void)addEntryToSortList( polyEntity, nullptr, p->material, 0, index, nullptr, p, ST_QUAD_POLY );
+		}
+	}
 
-void Frontend::collectVisibleParticles( Scene *scene, std::span<const Frustum> frusta ) {
-	uint16_t tmpIndices[1024];
-	const auto visibleAggregateIndices = cullParticleAggregates( scene->m_particles, &m_stateForActiveCamera->frustum,
-																 frusta, tmpIndices );
-	addParticlesToSortList( scene->m_polyent, scene->m_particles.data(), visibleAggregateIndices );
-}
+	if( jobsMask & ( 1u << LightsCullingJob ) ) {
+		const int dynamicLightValue = r_dynamiclight->integer;
+		if( dynamicLightValue & 2 ) {
+			addCoronaLightsToSortList( polyEntity, scene->m_dynamicLights.data(), m_visibleCoronaLightIndicesSpan );
+		}
+		if( dynamicLightValue & 1 ) {
+			std::span<const unsigned> spansStorage[2] { m_nonOccludedLeaves, m_partiallyOccludedLeaves };
+			std::span<std::span<const unsigned>> spansOfLeaves = { spansStorage, 2 };
+			markLightsOfSurfaces( scene, spansOfLeaves, m_visibleProgramLightIndicesSpan );
+		}
+	}
 
-void Frontend::collectVisibleDynamicMeshes( Scene *scene, std::span<const Frustum> frusta ) {
-	uint16_t tmpIndices[wsw::max( Scene::kMaxDynamicMeshes, Scene::kMaxCompoundDynamicMeshes )];
+	if( jobsMask & ( 1u << WorldSurfacesCullingJob ) ) {
+		// We must know lights at this point
+		addVisibleWorldSurfacesToSortList( scene );
+	}
 
-	const Frustum *const frustum = &m_stateForActiveCamera->frustum;
+	if( jobsMask & kEntitiesCullingJobsMask ) {
+		const auto modelsOf = [this]( CullingJob job ) -> std::span<const VisTestedModel> {
+			const CullingJobState &state = m_cullingJobStates[job];
+			return { state.visTestedModels.data.get(), state.visibleIndices.size() };
+		};
+		const auto indicesOf = [this]( CullingJob job ) -> std::span<const uint16_t> {
+			return m_cullingJobStates[job].visibleIndices;
+		};
 
-	const std::span<const DynamicMesh *> meshes = scene->m_dynamicMeshes;
-	const auto visibleDynamicMeshIndices = cullDynamicMeshes( meshes.data(), meshes.size(), frustum, frusta, tmpIndices );
-	addDynamicMeshesToSortList( scene->m_polyent, scene->m_dynamicMeshes.data(), visibleDynamicMeshIndices );
+		addNullModelEntitiesToSortList( scene->m_nullModelEntities.data(), indicesOf( NullModelsCullingJob ) );
+		addAliasModelEntitiesToSortList( scene->m_aliasModelEntities.data(), modelsOf( AliasModelsCullingJob ),
+										 indicesOf( AliasModelsCullingJob ) );
+		addSkeletalModelEntitiesToSortList( scene->m_skeletalModelEntities.data(), modelsOf( SkeletalModelsCullingJob ),
+											indicesOf( SkeletalModelsCullingJob ) );
+		const std::span<const Scene::DynamicLight> dynamicLights { scene->m_dynamicLights.data(), scene->m_dynamicLights.size() };
+		addBrushModelEntitiesToSortList( scene->m_brushModelEntities.data(), modelsOf( BrushModelsCullingJob ),
+										 indicesOf( BrushModelsCullingJob ), dynamicLights );
+		addSpriteEntitiesToSortList( scene->m_spriteEntities.data(), indicesOf( SpritesCullingJob ) );
+
+		addDynamicMeshesToSortList( polyEntity, scene->m_dynamicMeshes.data(), indicesOf( DynamicMeshesCullingJob ) );
+		addCompoundDynamicMeshesToSortList( polyEntity, scene->m_compoundDynamicMeshes.data(),
+											indicesOf( CompoundDynamicMeshesCullingJob ) );
+	}
 
-	const std::span<const Scene::CompoundDynamicMesh> compoundMeshes = scene->m_compoundDynamicMeshes;
-	const auto visibleCompoundMeshesIndices = cullCompoundDynamicMeshes( compoundMeshes, frustum, frusta, tmpIndices );
-	addCompoundDynamicMeshesToSortList( scene->m_polyent, scene->m_compoundDynamicMeshes.data(), visibleCompoundMeshesIndices );
+	if( jobsMask & ( 1u << ParticlesCullingJob ) ) {
+		addParticlesToSortList( polyEntity, scene->m_particles.data(), m_cullingJobStates[ParticlesCullingJob].visibleIndices );
+	}
 }
 
 auto Frontend::collectVisibleLights( Scene *scene, std::span<const Frustum> occluderFrusta )
@@ -499,9 +499,8 @@ void Frontend::renderViewFromThisCamera( Scene *scene, StateForCamera *stateForC
 
 	m_visFrameCount++;
 
+	std::span<const unsigned> visibleLeaves;
 	std::span<const Frustum> occluderFrusta;
-	std::span<const unsigned> nonOccludedLeaves;
-	std::span<const unsigned> partiallyOccludedLeaves;
 
 	m_numAllVisibleLights     = 0;
 	m_numVisibleProgramLights = 0;
@@ -511,37 +510,26 @@ void Frontend::renderViewFromThisCamera( Scene *scene, StateForCamera *stateForC
 	if( !( m_stateForActiveCamera->refdef.rdflags & RDF_NOWORLDMODEL ) ) {
 		if( r_drawworld->integer && rsh.worldModel ) {
 			drawWorld = true;
-			std::tie( occluderFrusta, nonOccludedLeaves, partiallyOccludedLeaves ) = cullWorldSurfaces();
+			std::tie( visibleLeaves, occluderFrusta ) = collectVisibleWorldLeavesAndOccluders();
 			// TODO: Update far clip, update view matrices
 		}
 	}
 
-	collectVisiblePolys( scene, occluderFrusta );
-
-	if( const int dynamicLightValue = r_dynamiclight->integer ) {
-		[[maybe_unused]]
-		const auto [visibleProgramLightIndices, visibleCoronaLightIndices] = collectVisibleLights( scene, occluderFrusta );
-		if( dynamicLightValue & 2 ) {
-			addCoronaLightsToSortList( scene->m_polyent, scene->m_dynamicLights.data(), visibleCoronaLightIndices );
-		}
-		if( dynamicLightValue & 1 ) {
-			std::span<const unsigned> spansStorage[2] { nonOccludedLeaves, partiallyOccludedLeaves };
-			std::span<std::span<const unsigned>> spansOfLeaves = { spansStorage, 2 };
-			markLightsOfSurfaces( scene, spansOfLeaves, visibleProgramLightIndices );
-		}
-	}
-
+	unsigned cullingJobsMask = ( 1u << QuadPolysCullingJob ) | ( 1u << ParticlesCullingJob );
 	if( drawWorld ) {
-		// We must know lights at this point
-		addVisibleWorldSurfacesToSortList( scene );
+		cullingJobsMask |= ( 1u << WorldSurfacesCullingJob );
+	}
+	if( r_dynamiclight->integer ) {
+		cullingJobsMask |= ( 1u << LightsCullingJob );
 	}
-
 	if( r_drawentities->integer ) {
-		collectVisibleEntities( scene, occluderFrusta );
-		collectVisibleDynamicMeshes( scene, occluderFrusta );
+		cullingJobsMask |= kEntitiesCullingJobsMask;
 	}
 
-	collectVisibleParticles( scene, occluderFrusta );
+	// Culling passes are independent at this point, so they run in parallel
+	runCullingJobs( scene, cullingJobsMask, visibleLeaves, occluderFrusta );
+
+	addCulledEntriesToSortList( scene, cullingJobsMask );
 
 	const auto cmp = []( const sortedDrawSurf_t &lhs, const sortedDrawSurf_t &rhs ) {
 		// TODO: Avoid runtime coposition of keys
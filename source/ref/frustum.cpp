@@ -0,0 +1,74 @@
+/*
+Copyright (C) 2007 Victor Luchits
+Copyright (C) 2021 Chasseur de bots
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+// Kept separately from the rest of the culling code, so it can be used without the frontend
+
+#include "local.h"
+#include "frontend.h"
+
+void Frustum::setPlaneComponentsAtIndex( unsigned index, const float *n, float d ) {
+	const uint32_t blendsForSign[2] { 0, ~( (uint32_t)0 ) };
+
+	const float nX = planeX[index] = n[0];
+	const float nY = planeY[index] = n[1];
+	const float nZ = planeZ[index] = n[2];
+
+	planeD[index] = d;
+
+	xBlendMasks[index] = blendsForSign[nX < 0];
+	yBlendMasks[index] = blendsForSign[nY < 0];
+	zBlendMasks[index] = blendsForSign[nZ < 0];
+}
+
+void Frustum::fillComponentTails( unsigned indexOfPlaneToReplicate ) {
+	// Sanity check
+	assert( indexOfPlaneToReplicate >= 3 && indexOfPlaneToReplicate < 8 );
+	for( unsigned i = indexOfPlaneToReplicate; i < 8; ++i ) {
+		planeX[i] = planeX[indexOfPlaneToReplicate];
+		planeY[i] = planeY[indexOfPlaneToReplicate];
+		planeZ[i] = planeZ[indexOfPlaneToReplicate];
+		planeD[i] = planeD[indexOfPlaneToReplicate];
+		xBlendMasks[i] = xBlendMasks[indexOfPlaneToReplicate];
+		yBlendMasks[i] = yBlendMasks[indexOfPlaneToReplicate];
+		zBlendMasks[i] = zBlendMasks[indexOfPlaneToReplicate];
+	}
+}
+
+void Frustum::setupFor4Planes( const float *viewOrigin, const mat3_t viewAxis, float fovX, float fovY ) {
+	const float *const forward = &viewAxis[AXIS_FORWARD];
+	const float *const left    = &viewAxis[AXIS_RIGHT];
+	const float *const up      = &viewAxis[AXIS_UP];
+
+	const vec3_t right { -left[0], -left[1], -left[2] };
+
+	const float xRotationAngle = 90.0f - 0.5f * fovX;
+	const float yRotationAngle = 90.0f - 0.5f * fovY;
+
+	vec3_t planeNormals[4];
+	RotatePointAroundVector( planeNormals[0], up, forward, -xRotationAngle );
+	RotatePointAroundVector( planeNormals[1], up, forward, +xRotationAngle );
+	RotatePointAroundVector( planeNormals[2], right, forward, +yRotationAngle );
+	RotatePointAroundVector( planeNormals[3], right, forward, -yRotationAngle );
+
+	for( unsigned i = 0; i < 4; ++i ) {
+		setPlaneComponentsAtIndex( i, planeNormals[i], DotProduct( viewOrigin, planeNormals[i] ) );
+	}
+}
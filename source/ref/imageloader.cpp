@@ -0,0 +1,191 @@
+#include "imageloader.h"
+#include "../qcommon/hash.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "../../third-party/stb/stb_image.h"
+
+auto decodeImageFileData( const uint8_t *fileData, size_t fileSize ) -> std::optional<DecodedImage> {
+	constexpr size_t kMaxSaneBitmapDataSize = 2048 * 2048 * 4;
+
+	int width = 0, height = 0, samples = 0;
+	// Check the header first (disallow huge bogus allocations)
+	if( !stbi_info_from_memory( (const stbi_uc *)fileData, (int)fileSize, &width, &height, &samples ) ) {
+		return std::nullopt;
+	}
+	if( width <= 0 || height <= 0 || samples <= 0 ) {
+		return std::nullopt;
+	}
+	if( (size_t)width * (size_t)height * (size_t)samples > kMaxSaneBitmapDataSize ) {
+		return std::nullopt;
+	}
+
+	// Note: stb_image uses the default malloc()/free() allocators, so the data can be owned by DecodedImage
+	uint8_t *bytes = stbi_load_from_memory( (const stbi_uc *)fileData, (int)fileSize, &width, &height, &samples, 0 );
+	if( !bytes ) {
+		return std::nullopt;
+	}
+
+	assert( width > 0 && height > 0 && samples > 0 );
+	return DecodedImage( bytes, BitmapProps { (uint16_t)width, (uint16_t)height, (uint16_t)samples } );
+}
+
+static auto getMillisSinceEpoch() -> int64_t {
+	using namespace std::chrono;
+	return duration_cast<milliseconds>( steady_clock::now().time_since_epoch() ).count();
+}
+
+void ImageLoadingPipeline::add( const wsw::StringView &name ) {
+	// Discard results of a run that has been interrupted (e.g. by an error) without finishing
+	if( m_started ) {
+		(void)finish();
+	}
+	if( name.empty() || findRequest( name ) ) {
+		return;
+	}
+
+	const uint32_t hash = wsw::getHashForLength( name.data(), name.size() );
+	const unsigned binIndex = hash % kNumBins;
+	m_names.emplace_back( wsw::String( name.data(), name.size() ) );
+	m_hashes.push_back( hash );
+	// Bin heads and links are stored as index + 1, so zero could be used as a null link
+	m_nextInBin.push_back( m_binHeads[binIndex] );
+	m_binHeads[binIndex] = (unsigned)m_names.size();
+}
+
+auto ImageLoadingPipeline::findRequest( const wsw::StringView &name ) const -> std::optional<unsigned> {
+	const uint32_t hash = wsw::getHashForLength( name.data(), name.size() );
+	for( unsigned link = m_binHeads[hash % kNumBins]; link; link = m_nextInBin[link - 1] ) {
+		const unsigned index = link - 1;
+		if( m_hashes[index] == hash && name.equalsIgnoreCase( wsw::StringView( m_names[index].data(), m_names[index].size() ) ) ) {
+			return index;
+		}
+	}
+	return std::nullopt;
+}
+
+void ImageLoadingPipeline::start( unsigned numThreads ) {
+	if( m_started ) {
+		(void)finish();
+	}
+	m_started = true;
+	m_startTimestamp = getMillisSinceEpoch();
+
+	m_requests.reset( new Request[m_names.size()] );
+	if( m_names.empty() ) {
+		return;
+	}
+
+	numThreads = std::min( numThreads, (unsigned)m_names.size() );
+	m_threads.reserve( numThreads );
+	for( unsigned i = 0; i < numThreads; ++i ) {
+		m_threads.emplace_back( std::thread( &ImageLoadingPipeline::runWorker, this ) );
+	}
+}
+
+void ImageLoadingPipeline::runWorker() {
+	wsw::Vector<uint8_t> buffer;
+	while( !m_interrupted.load( std::memory_order_relaxed ) ) {
+		const unsigned index = m_nextRequestIndex.fetch_add( 1, std::memory_order_relaxed );
+		if( index >= m_names.size() ) {
+			break;
+		}
+		Request *const request = &m_requests[index];
+		int expected = Queued;
+		// The request could be already executed in place
+		if( request->state.compare_exchange_strong( expected, InProgress, std::memory_order_acq_rel ) ) {
+			execute( request, index, &buffer );
+		}
+	}
+}
+
+void ImageLoadingPipeline::execute( Request *request, unsigned index, wsw::Vector<uint8_t> *buffer ) {
+	buffer->clear();
+	std::optional<DecodedImage> maybeImage;
+	const wsw::String &name = m_names[index];
+	if( m_fileReader( wsw::StringView( name.data(), name.size(), wsw::StringView::ZeroTerminated ), buffer ) ) {
+		maybeImage = decodeImageFileData( buffer->data(), buffer->size() );
+	}
+
+	if( maybeImage ) {
+		request->image = std::move( *maybeImage );
+		request->succeeded = true;
+		m_numDecoded.fetch_add( 1, std::memory_order_relaxed );
+	} else {
+		m_numMissing.fetch_add( 1, std::memory_order_relaxed );
+	}
+
+	{
+		[[maybe_unused]] std::lock_guard<std::mutex> lock( m_mutex );
+		request->state.store( Completed, std::memory_order_release );
+	}
+	m_completionCondition.notify_all();
+}
+
+auto ImageLoadingPipeline::take( const wsw::StringView &name, DecodedImage *image ) -> TakeResult {
+	if( !m_started ) {
+		return TakeResult::NotRequested;
+	}
+	const std::optional<unsigned> maybeIndex = findRequest( name );
+	if( !maybeIndex ) {
+		return TakeResult::NotRequested;
+	}
+
+	Request *const request = &m_requests[*maybeIndex];
+	int expected = Queued;
+	if( request->state.compare_exchange_strong( expected, InProgress, std::memory_order_acq_rel ) ) {
+		// Don't wait for workers if nobody has started loading it yet
+		execute( request, *maybeIndex, &m_inPlaceReadBuffer );
+		m_numExecutedInPlace++;
+	} else if( expected != Completed ) {
+		std::unique_lock<std::mutex> lock( m_mutex );
+		m_completionCondition.wait( lock, [=]() { return request->state.load( std::memory_order_acquire ) == Completed; } );
+	}
+
+	if( request->taken ) {
+		return TakeResult::NotRequested;
+	}
+	request->taken = true;
+	if( !request->succeeded ) {
+		return TakeResult::Missing;
+	}
+	*image = std::move( request->image );
+	return TakeResult::Taken;
+}
+
+auto ImageLoadingPipeline::finish() -> Stats {
+	if( !m_started ) {
+		return Stats {};
+	}
+
+	m_interrupted.store( true, std::memory_order_relaxed );
+	for( std::thread &thread: m_threads ) {
+		thread.join();
+	}
+
+	Stats stats;
+	stats.numRequested = (unsigned)m_names.size();
+	stats.numDecoded = m_numDecoded.load( std::memory_order_relaxed );
+	stats.numMissing = m_numMissing.load( std::memory_order_relaxed );
+	stats.numExecutedInPlace = m_numExecutedInPlace;
+	stats.numThreads = (unsigned)m_threads.size();
+	stats.millis = (unsigned)( getMillisSinceEpoch() - m_startTimestamp );
+
+	m_threads.clear();
+	m_requests.reset();
+	m_names.clear();
+	m_hashes.clear();
+	m_nextInBin.clear();
+	std::fill( std::begin( m_binHeads ), std::end( m_binHeads ), 0 );
+	m_nextRequestIndex.store( 0, std::memory_order_relaxed );
+	m_numDecoded.store( 0, std::memory_order_relaxed );
+	m_numMissing.store( 0, std::memory_order_relaxed );
+	m_interrupted.store( false, std::memory_order_relaxed );
+	m_numExecutedInPlace = 0;
+	m_started = false;
+
+	return stats;
+}
@@ -0,0 +1,164 @@
+#ifndef WSW_d3d71c2e_e6f5_477a_8760_f9e8f35f6bb2_H
+#define WSW_d3d71c2e_e6f5_477a_8760_f9e8f35f6bb2_H
+
+#include "../qcommon/wswstring.h"
+#include "../qcommon/wswstringview.h"
+#include "../qcommon/wswvector.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+struct BitmapProps {
+	uint16_t width { 0 }, height { 0 }, samples { 0 };
+	[[nodiscard]]
+	bool operator!=( const BitmapProps &that ) const {
+		return width != that.width || height != that.height || samples != that.samples;
+	}
+};
+
+/**
+ * Bitmap data of a decoded image file that owns its (malloc-allocated) data.
+ */
+class DecodedImage {
+	uint8_t *m_data { nullptr };
+	BitmapProps m_props;
+public:
+	DecodedImage() = default;
+	DecodedImage( uint8_t *data, const BitmapProps &props ) : m_data( data ), m_props( props ) {}
+	~DecodedImage() { ::free( m_data ); }
+
+	DecodedImage( const DecodedImage & ) = delete;
+	auto operator=( const DecodedImage & ) -> DecodedImage & = delete;
+
+	DecodedImage( DecodedImage &&that ) noexcept : m_data( that.m_data ), m_props( that.m_props ) {
+		that.m_data = nullptr;
+	}
+	auto operator=( DecodedImage &&that ) noexcept -> DecodedImage & {
+		::free( m_data );
+		m_data = that.m_data;
+		m_props = that.m_props;
+		that.m_data = nullptr;
+		return *this;
+	}
+
+	[[nodiscard]]
+	auto data() const -> const uint8_t * { return m_data; }
+	[[nodiscard]]
+	auto props() const -> const BitmapProps & { return m_props; }
+	[[nodiscard]]
+	auto dataSize() const -> size_t {
+		return (size_t)m_props.width * (size_t)m_props.height * (size_t)m_props.samples;
+	}
+};
+
+/**
+ * Decodes bitmap data of an image file (of any format that is supported by stb_image).
+ * This does not touch any global state so it's safe to call from any thread.
+ */
+[[nodiscard]]
+auto decodeImageFileData( const uint8_t *fileData, size_t fileSize ) -> std::optional<DecodedImage>;
+
+/**
+ * Reads and decodes images in worker threads while the caller (the render thread) consumes results
+ * that are ready and uploads them (requests that have not been picked by workers yet are executed in place).
+ * Names are matched case-insensitively.
+ * Missing files are remembered as well, so the caller does not have to look them up again.
+ */
+class ImageLoadingPipeline {
+public:
+	/**
+	 * A function that reads the file contents for the given name (that has no extension) into the buffer.
+	 * It gets called from worker threads and must be thread-safe.
+	 */
+	using FileReader = bool (*)( const wsw::StringView &name, wsw::Vector<uint8_t> *buffer );
+
+	struct Stats {
+		unsigned numRequested { 0 };
+		unsigned numDecoded { 0 };
+		unsigned numMissing { 0 };
+		unsigned numExecutedInPlace { 0 };
+		unsigned numThreads { 0 };
+		unsigned millis { 0 };
+	};
+
+	enum class TakeResult {
+		NotRequested,
+		Missing,
+		Taken,
+	};
+
+	explicit ImageLoadingPipeline( FileReader fileReader ) : m_fileReader( fileReader ) {}
+	~ImageLoadingPipeline() { (void)finish(); }
+
+	ImageLoadingPipeline( const ImageLoadingPipeline & ) = delete;
+	auto operator=( const ImageLoadingPipeline & ) -> ImageLoadingPipeline & = delete;
+
+	//! Adds a request (duplicates are ignored). Requests should be added prior to start().
+	void add( const wsw::StringView &name );
+
+	[[nodiscard]]
+	auto numRequests() const -> unsigned { return (unsigned)m_names.size(); }
+
+	//! Launches workers. A zero number of threads is allowed (requests get executed in place in this case).
+	void start( unsigned numThreads );
+
+	/**
+	 * Waits for completion of the request for the given name (or executes it in place), and moves the data out.
+	 * An image can be taken only once, NotRequested is returned for subsequent calls.
+	 */
+	[[nodiscard]]
+	auto take( const wsw::StringView &name, DecodedImage *image ) -> TakeResult;
+
+	/**
+	 * Interrupts workers, waits for their termination and releases results that were not taken.
+	 */
+	[[nodiscard]]
+	auto finish() -> Stats;
+private:
+	enum State : int { Queued, InProgress, Completed };
+
+	struct Request {
+		std::atomic<int> state { Queued };
+		bool succeeded { false };
+		bool taken { false };
+		DecodedImage image;
+	};
+
+	void runWorker();
+	void execute( Request *request, unsigned index, wsw::Vector<uint8_t> *buffer );
+
+	[[nodiscard]]
+	auto findRequest( const wsw::StringView &name ) const -> std::optional<unsigned>;
+
+	static constexpr unsigned kNumBins = 239;
+
+	const FileReader m_fileReader;
+
+	wsw::Vector<wsw::String> m_names;
+	wsw::Vector<uint32_t> m_hashes;
+	wsw::Vector<unsigned> m_nextInBin;
+	unsigned m_binHeads[kNumBins] {};
+
+	std::unique_ptr<Request[]> m_requests;
+	wsw::Vector<std::thread> m_threads;
+	wsw::Vector<uint8_t> m_inPlaceReadBuffer;
+
+	std::mutex m_mutex;
+	std::condition_variable m_completionCondition;
+
+	std::atomic<unsigned> m_nextRequestIndex { 0 };
+	std::atomic<unsigned> m_numDecoded { 0 };
+	std::atomic<unsigned> m_numMissing { 0 };
+	std::atomic<bool> m_interrupted { false };
+	unsigned m_numExecutedInPlace { 0 };
+	int64_t m_startTimestamp { 0 };
+	bool m_started { false };
+};
+
+#endif
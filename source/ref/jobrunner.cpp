@@ -0,0 +1,97 @@
+#include "jobrunner.h"
+
+namespace wsw::ref {
+
+JobRunner::JobRunner( unsigned numThreads ) {
+	m_threads.reserve( numThreads );
+	for( unsigned i = 0; i < numThreads; ++i ) {
+		m_threads.emplace_back( std::thread( &JobRunner::runWorker, this ) );
+	}
+}
+
+JobRunner::~JobRunner() {
+	{
+		[[maybe_unused]] std::lock_guard<std::mutex> lock( m_mutex );
+		m_isShuttingDown = true;
+	}
+	m_startCondition.notify_all();
+	for( std::thread &thread: m_threads ) {
+		thread.join();
+	}
+}
+
+void JobRunner::runJobs( unsigned numJobs, JobFn jobFn, void *jobData ) {
+	// Don't bother waking up workers in this case
+	if( m_threads.empty() || numJobs < 2 ) {
+		for( unsigned jobIndex = 0; jobIndex < numJobs; ++jobIndex ) {
+			jobFn( jobData, jobIndex );
+		}
+		return;
+	}
+
+	{
+		[[maybe_unused]] std::lock_guard<std::mutex> lock( m_mutex );
+		// Workers of the previous batch must have left it (this is guaranteed by waiting for completion)
+		assert( !m_numActiveWorkers );
+		m_jobFn   = jobFn;
+		m_jobData = jobData;
+		m_numJobs = numJobs;
+		m_nextJobIndex.store( 0, std::memory_order_relaxed );
+		m_batchNum++;
+	}
+	m_startCondition.notify_all();
+
+	executeJobs( numJobs, jobFn, jobData );
+
+	// All jobs have been picked at this point, wait for completion of ones that are executed by workers
+	std::unique_lock<std::mutex> lock( m_mutex );
+	m_completionCondition.wait( lock, [this]() { return m_numActiveWorkers == 0; } );
+}
+
+void JobRunner::executeJobs( unsigned numJobs, JobFn jobFn, void *jobData ) {
+	for(;; ) {
+		const unsigned jobIndex = m_nextJobIndex.fetch_add( 1, std::memory_order_relaxed );
+		if( jobIndex >= numJobs ) {
+			break;
+		}
+		jobFn( jobData, jobIndex );
+	}
+}
+
+void JobRunner::runWorker() {
+	uint64_t lastSeenBatchNum = 0;
+	for(;; ) {
+		JobFn jobFn;
+		void *jobData;
+		unsigned numJobs;
+		{
+			std::unique_lock<std::mutex> lock( m_mutex );
+			m_startCondition.wait( lock, [&]() { return m_isShuttingDown || m_batchNum != lastSeenBatchNum; } );
+			if( m_isShuttingDown ) {
+				return;
+			}
+			lastSeenBatchNum = m_batchNum;
+			// Don't join a batch which jobs have been already picked, so the submitter could safely reuse the state
+			if( m_nextJobIndex.load( std::memory_order_relaxed ) >= m_numJobs ) {
+				continue;
+			}
+			m_numActiveWorkers++;
+			jobFn   = m_jobFn;
+			jobData = m_jobData;
+			numJobs = m_numJobs;
+		}
+
+		executeJobs( numJobs, jobFn, jobData );
+
+		bool isTheLastOne;
+		{
+			[[maybe_unused]] std::lock_guard<std::mutex> lock( m_mutex );
+			isTheLastOne = !( --m_numActiveWorkers );
+		}
+		if( isTheLastOne ) {
+			m_completionCondition.notify_one();
+		}
+	}
+}
+
+}
@@ -0,0 +1,70 @@
+#ifndef WSW_5f5f8d28_13ad_4157_a03a_f7f80b298a51_H
+#define WSW_5f5f8d28_13ad_4157_a03a_f7f80b298a51_H
+
+#include "../qcommon/wswvector.h"
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+namespace wsw::ref {
+
+/**
+ * Persistent threads that help the calling thread to execute batches of independent jobs.
+ * The calling thread takes part in execution of a batch, and the call returns when all jobs of the batch are completed.
+ * Jobs are picked in the order of their indices, so it's better to put heavy jobs first.
+ * @note Only a single thread is allowed to submit batches.
+ */
+class JobRunner {
+public:
+	explicit JobRunner( unsigned numThreads );
+	~JobRunner();
+
+	JobRunner( const JobRunner & ) = delete;
+	auto operator=( const JobRunner & ) -> JobRunner & = delete;
+
+	[[nodiscard]]
+	auto numThreads() const -> unsigned { return (unsigned)m_threads.size(); }
+
+	/**
+	 * Calls the function for every job index in [0, numJobs) and waits for completion of all calls.
+	 * The function must be safe to call concurrently for different indices.
+	 */
+	template <typename Func>
+	void parallelFor( unsigned numJobs, Func &&func ) {
+		using FuncType = std::remove_reference_t<Func>;
+		runJobs( numJobs, []( void *data, unsigned jobIndex ) {
+			( *( (FuncType *)data ) )( jobIndex );
+		}, (void *)std::addressof( func ) );
+	}
+private:
+	using JobFn = void (*)( void *data, unsigned jobIndex );
+
+	void runJobs( unsigned numJobs, JobFn jobFn, void *jobData );
+	void runWorker();
+	void executeJobs( unsigned numJobs, JobFn jobFn, void *jobData );
+
+	wsw::Vector<std::thread> m_threads;
+
+	std::mutex m_mutex;
+	std::condition_variable m_startCondition;
+	std::condition_variable m_completionCondition;
+
+	// Parameters of the current batch (guarded by the mutex)
+	JobFn m_jobFn { nullptr };
+	void *m_jobData { nullptr };
+	unsigned m_numJobs { 0 };
+	uint64_t m_batchNum { 0 };
+	unsigned m_numActiveWorkers { 0 };
+	bool m_isShuttingDown { false };
+
+	std::atomic<unsigned> m_nextJobIndex { 0 };
+};
+
+}
+
+#endif
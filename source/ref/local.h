@@ -72,6 +72,7 @@ typedef struct superLightStyle_s {
 #include "surface.h"
 
 #include "../qcommon/wswvector.h"
+#include "imageloader.h"
 
 enum {
 	IT_NONE
@@ -133,14 +134,6 @@ enum class BuiltinTexNum {
 	Portal0
 };
 
-struct BitmapProps {
-	uint16_t width { 0 }, height { 0 }, samples { 0 };
-	[[nodiscard]]
-	bool operator!=( const BitmapProps &that ) const {
-		return width != that.width || height != that.height || samples != that.samples;
-	}
-};
-
 class Texture {
 public:
 	enum Links { ListLinks, BinLinks };
@@ -314,6 +307,12 @@ private:
 	TextureFilter m_textureFilter { Trilinear };
 	int m_anisoLevel { 1 };
 
+	[[nodiscard]]
+	static bool readMaterialImageFile( const wsw::StringView &name, wsw::Vector<uint8_t> *buffer );
+
+	// Supplies material textures that were read and decoded in background (if any)
+	ImageLoadingPipeline m_loadingPipeline { &readMaterialImageFile };
+
 	/**
 	 * The name is a little reference to {@code java.lang.String::intern()}
 	 */
@@ -506,6 +505,19 @@ public:
 
 	void freeUnusedWorldTextures();
 	void freeAllUnusedTextures();
+
+	/**
+	 * Adds an image that is likely to be loaded as a material texture to the set of prefetched images.
+	 * Images that are already loaded are skipped.
+	 */
+	void addMaterialTextureToPrefetch( const wsw::StringView &name, const wsw::StringView &suffix = wsw::StringView() );
+	/**
+	 * Starts reading and decoding added images in background,
+	 * so loading of material textures is reduced to uploading of the data until the prefetching is finished.
+	 */
+	void startPrefetchingMaterialTextures();
+	[[nodiscard]]
+	auto finishPrefetchingMaterialTextures() -> ImageLoadingPipeline::Stats;
 };
 
 // TODO: This should belong to RenderTargetManager
@@ -798,10 +810,16 @@ struct OccluderDataEntry {
 	vec3_t data[7];
 };
 
+namespace wsw::bsp { class MapImage; }
+
 typedef struct mbrushmodel_s {
 	const bspFormatDesc_t *format;
 
+	// the map file image that is shared with the collision code, some lumps are referred directly
+	wsw::bsp::MapImage *mapImage;
+
 	dvis_t          *pvs;
+	bool isPvsShared;
 
 	unsigned int numsubmodels;
 	mmodel_t        *submodels;
@@ -831,6 +849,7 @@ typedef struct mbrushmodel_s {
 
 	unsigned int numlightgridelems;
 	mgridlight_t    *lightgrid;
+	bool isLightgridShared;
 
 	unsigned int numlightarrayelems;
 	int             *lightarray;
@@ -1022,6 +1041,9 @@ typedef struct mskmodel_s {
 	mskframe_t      *frames;
 	bonepose_t      *invbaseposes;
 	void            *stringsDataToFree;
+
+	// allows transforming boneposes in batches
+	BoneHierarchyLevels boneLevels;
 } mskmodel_t;
 
 //===================================================================
@@ -25,6 +25,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "program.h"
 #include "../qcommon/hash.h"
 #include "../qcommon/links.h"
+#include "../qcommon/md5.h"
 #include "../qcommon/memspecbuilder.h"
 #include "../qcommon/singletonholder.h"
 #include "../qcommon/wswstringsplitter.h"
@@ -47,12 +48,29 @@ auto MaterialCache::instance() -> MaterialCache * {
 	return ::materialCacheInstanceHolder.instance();
 }
 
+static const wsw::StringView kMaterialSourceCachePath( "materials/scripts.mcache" );
+
 MaterialCache::MaterialCache() {
+	loadSourceCache();
+
 	for( const wsw::StringView &dir : { "<scripts"_asView, ">scripts"_asView, "scripts"_asView } ) {
 		// TODO: Must be checked if exists
 		loadDirContents( dir );
 	}
 
+	// Check whether some files have been removed as well
+	if( m_isSourceCacheDirty || m_numSourceCacheHits != m_cachedFileRecords.size() ) {
+		saveSourceCache();
+	}
+
+	Com_DPrintf( "Restored %u of %u material files from the cache\n",
+				 m_numSourceCacheHits, (unsigned)m_sourceCacheEntries.size() );
+
+	// Release the construction-time data
+	wsw::Vector<MaterialSourceCache::FileRecord>().swap( m_cachedFileRecords );
+	wsw::Vector<uint8_t>().swap( m_sourceCacheImage );
+	wsw::Vector<SourceCacheEntry>().swap( m_sourceCacheEntries );
+
 	for( unsigned i = 0; i < MAX_SHADERS; ++i ) {
 		m_freeMaterialIds.push_back( i );
 	}
@@ -282,6 +300,40 @@ shader_t *MaterialCache::loadDefaultMaterial( const wsw::StringView &name, int t
     return loadMaterial( name, type, true );
 }
 
+void MaterialCache::addTexturesOfMaterialToPrefetch( const wsw::StringView &name, int type ) {
+	const wsw::HashedStringView cleanName( makeCleanName( name ) );
+	const unsigned binIndex = cleanName.getHash() % kNumBins;
+	for( shader_t *material = m_materialBins[binIndex]; material; material = material->next[shader_t::BinLinks] ) {
+		if( cleanName.equalsIgnoreCase( material->name ) && material->type == type ) {
+			return;
+		}
+	}
+
+	auto *const textureCache = TextureCache::instance();
+
+	bool usesDefaultMaterialImages;
+	if( const MaterialSource *source = findSourceByName( cleanName ) ) {
+		wsw::Vector<wsw::StringView> imageNames;
+		usesDefaultMaterialImages = source->findReferencedImages( &imageNames );
+		for( const wsw::StringView &imageName: imageNames ) {
+			textureCache->addMaterialTextureToPrefetch( imageName );
+		}
+	} else {
+		// Default materials use the image of the same name (see MaterialFactory::newDefaultMaterial())
+		textureCache->addMaterialTextureToPrefetch( name );
+		usesDefaultMaterialImages = ( type == SHADER_TYPE_DELUXEMAP );
+	}
+
+	if( usesDefaultMaterialImages ) {
+		textureCache->addMaterialTextureToPrefetch( name, kNormSuffix );
+		if( r_lighting_specular->integer ) {
+			textureCache->addMaterialTextureToPrefetch( name, kGlossSuffix );
+		}
+		// The "add" image is just a fallback for a missing "decal" one, don't waste time on it
+		textureCache->addMaterialTextureToPrefetch( name, kDecalSuffix );
+	}
+}
+
 shader_t *R_RegisterPic( const char *name ) {
 	return MaterialCache::instance()->loadMaterial( wsw::StringView( name ), SHADER_TYPE_2D, false );
 }
@@ -407,14 +459,65 @@ auto MaterialCache::readRawContents( const wsw::StringView &fileName ) -> const
 	return &m_fileContentsBuffer;
 }
 
-auto MaterialCache::loadFileContents( const wsw::StringView &fileName ) -> MaterialFileContents * {
-	const wsw::String *rawContents = readRawContents( fileName );
-	if( !rawContents ) {
-		return nullptr;
+void MaterialCache::loadSourceCache() {
+	auto maybeHandle = wsw::fs::openAsReadHandle( kMaterialSourceCachePath, wsw::fs::UseCacheFS );
+	if( !maybeHandle ) {
+		return;
+	}
+
+	const size_t size = maybeHandle->getInitialFileSize();
+	m_sourceCacheImage.resize( size );
+	if( !maybeHandle->readExact( m_sourceCacheImage.data(), size ) ) {
+		Com_Printf( S_COLOR_YELLOW "Failed to read the material source cache\n" );
+		return;
 	}
 
-	const int offsetShift = startsWithUtf8Bom( rawContents->data(), rawContents->size() ) ? 3 : 0;
-	TokenSplitter splitter( rawContents->data() + offsetShift, rawContents->size() - offsetShift );
+	if( auto maybeRecords = MaterialSourceCache::parse( m_sourceCacheImage.data(), m_sourceCacheImage.size() ) ) {
+		m_cachedFileRecords = std::move( *maybeRecords );
+	} else {
+		Com_Printf( S_COLOR_YELLOW "The material source cache is malformed or outdated, ignoring it\n" );
+	}
+}
+
+void MaterialCache::saveSourceCache() {
+	wsw::Vector<MaterialSourceCache::FileRecord> records;
+	records.reserve( m_sourceCacheEntries.size() );
+	for( const SourceCacheEntry &entry: m_sourceCacheEntries ) {
+		MaterialSourceCache::FileRecord &record = records.emplace_back();
+		record.fileName = wsw::StringView( entry.fileName.data(), entry.fileName.size() );
+		record.checksum = entry.checksum;
+		record.rawSize = entry.rawSize;
+		record.spans = entry.contents->spans;
+		record.numSpans = entry.contents->numSpans;
+		record.data = entry.contents->data;
+		record.dataSize = entry.contents->dataSize;
+		record.sourceSpans = entry.sourceSpans.data();
+		record.numSources = (unsigned)entry.sourceSpans.size();
+	}
+
+	wsw::Vector<uint8_t> image;
+	MaterialSourceCache::write( records.data(), records.size(), &image );
+
+	auto maybeHandle = wsw::fs::openAsWriteHandle( kMaterialSourceCachePath, wsw::fs::UseCacheFS );
+	// Note: a partially written file fails the size check on loading
+	if( !maybeHandle || !maybeHandle->write( image.data(), image.size() ) ) {
+		Com_Printf( S_COLOR_YELLOW "Failed to write the material source cache\n" );
+	}
+}
+
+auto MaterialCache::findCachedFileRecord( const wsw::StringView &fileName, uint32_t checksum, uint32_t rawSize ) const
+	-> const MaterialSourceCache::FileRecord * {
+	for( const MaterialSourceCache::FileRecord &record: m_cachedFileRecords ) {
+		if( record.checksum == checksum && record.rawSize == rawSize && record.fileName.equals( fileName ) ) {
+			return &record;
+		}
+	}
+	return nullptr;
+}
+
+auto MaterialCache::tokenizeFileContents( const wsw::String &rawContents ) -> MaterialFileContents * {
+	const int offsetShift = startsWithUtf8Bom( rawContents.data(), rawContents.size() ) ? 3 : 0;
+	TokenSplitter splitter( rawContents.data() + offsetShift, rawContents.size() - offsetShift );
 
 	m_fileTokenSpans.clear();
 
@@ -450,7 +553,7 @@ auto MaterialCache::loadFileContents( const wsw::StringView &fileName ) -> Mater
 		auto *copiedSpan = &result->spans[result->numSpans++];
 		*copiedSpan = parsedSpan;
 		copiedSpan->offset = result->dataSize;
-		std::memcpy( data + copiedSpan->offset, rawContents->data() + parsedSpan.offset, parsedSpan.len );
+		std::memcpy( data + copiedSpan->offset, rawContents.data() + parsedSpan.offset, parsedSpan.len );
 		result->dataSize += parsedSpan.len;
 		assert( parsedSpan.len == copiedSpan->len && parsedSpan.line == copiedSpan->line );
 	}
@@ -462,20 +565,45 @@ auto MaterialCache::loadFileContents( const wsw::StringView &fileName ) -> Mater
 }
 
 void MaterialCache::addFileContents( const wsw::StringView &fileName ) {
-	if( MaterialFileContents *contents = loadFileContents( fileName ) ) {
-		if( tryAddingFileContents( contents ) ) {
-			assert( !contents->next );
-			contents->next = m_fileContentsHead;
-			m_fileContentsHead = contents;
-		} else {
-			contents->~MaterialFileContents();
-			free( contents );
+	const wsw::String *rawContents = readRawContents( fileName );
+	if( !rawContents ) {
+		return;
+	}
+
+	// Exclude the terminating zero
+	const auto rawSize = (uint32_t)( rawContents->size() - 1 );
+	const uint32_t checksum = md5_digest32( rawContents->data(), (int)rawSize );
+
+	MaterialFileContents *contents = nullptr;
+	bool succeeded = false;
+	if( const MaterialSourceCache::FileRecord *record = findCachedFileRecord( fileName, checksum, rawSize ) ) {
+		// Skip tokenization and splitting the file into sources
+		if( ( contents = MaterialSourceCache::makeFileContents( *record ) ) ) {
+			m_fileSourceSpans.assign( record->sourceSpans, record->sourceSpans + record->numSources );
+			succeeded = addSources( contents );
+			m_numSourceCacheHits++;
 		}
+	} else {
+		if( ( contents = tokenizeFileContents( *rawContents ) ) ) {
+			succeeded = findSourceSpans( contents ) && addSources( contents );
+		}
+		m_isSourceCacheDirty = true;
+	}
+
+	if( succeeded ) {
+		assert( !contents->next );
+		contents->next = m_fileContentsHead;
+		m_fileContentsHead = contents;
+		m_sourceCacheEntries.emplace_back( SourceCacheEntry {
+			wsw::String( fileName.data(), fileName.size() ), checksum, rawSize, contents, m_fileSourceSpans
+		});
+	} else if( contents ) {
+		contents->~MaterialFileContents();
+		free( contents );
 	}
 }
 
-bool MaterialCache::tryAddingFileContents( const MaterialFileContents *contents ) {
-	m_fileMaterialNames.clear();
+bool MaterialCache::findSourceSpans( const MaterialFileContents *contents ) {
 	m_fileSourceSpans.clear();
 
 	unsigned tokenNum = 0;
@@ -520,30 +648,34 @@ bool MaterialCache::tryAddingFileContents( const MaterialFileContents *contents
 			}
 		}
 
-		m_fileMaterialNames.emplace_back( *maybeNameToken );
 		assert( tokenNum > shaderSpanStart );
 		// Exclude the closing brace from the range
 		m_fileSourceSpans.emplace_back( std::make_pair( shaderSpanStart, tokenNum - shaderSpanStart - 1 ) );
 	}
 
-	auto *mem = (uint8_t *)::malloc( sizeof( MaterialSource ) * m_fileMaterialNames.size() );
+	return true;
+}
+
+bool MaterialCache::addSources( const MaterialFileContents *contents ) {
+	auto *mem = (uint8_t *)::malloc( sizeof( MaterialSource ) * m_fileSourceSpans.size() );
 	if( !mem ) {
 		return false;
 	}
 
 	auto *const firstInSameMemChunk = (MaterialSource *)mem;
 
-	assert( m_fileMaterialNames.size() == m_fileSourceSpans.size() );
-	for( size_t i = 0; i < m_fileMaterialNames.size(); ++i ) {
+	for( const auto &[from, len]: m_fileSourceSpans ) {
 		auto *const source = new( mem )MaterialSource;
 		mem += sizeof( MaterialSource );
 
-		const auto &[from, len] = m_fileSourceSpans[i];
+		// The name token precedes the opening brace
+		assert( from >= 2 );
+		const TokenSpan &nameSpan = contents->spans[from - 2];
 		source->m_tokenSpansOffset = from;
 		source->m_numTokens = len;
 		source->m_fileContents = contents;
 		source->m_firstInSameMemChunk = firstInSameMemChunk;
-		source->m_name = wsw::HashedStringView( m_fileMaterialNames[i] );
+		source->m_name = wsw::HashedStringView( contents->data + nameSpan.offset, nameSpan.len );
 		source->m_nextInList = m_sourcesHead;
 		m_sourcesHead = source;
 
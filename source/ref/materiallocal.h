@@ -538,6 +538,57 @@ public:
 	bool expandTemplate( const wsw::StringView *args, size_t numArgs,
 						 wsw::String &expansionBuffer,
 						 wsw::Vector<TokenSpan> &resultingTokens );
+
+	/**
+	 * Collects names of images that are referred by map, animmap, material and distortion keys
+	 * (this is a lexical pass, so images of disabled conditional blocks are included as well).
+	 * Template placeholders and builtin images are skipped.
+	 * @return true if default companion images of the material (named by suffixes) are going to be loaded as well.
+	 */
+	[[nodiscard]]
+	bool findReferencedImages( wsw::Vector<wsw::StringView> *imageNames ) const;
+};
+
+/**
+ * A binary image of tokenized and indexed material files, so scripts that have not changed
+ * do not have to be tokenized and split into material sources on startup.
+ * Files are identified by names and validated by checksums of their raw contents.
+ * Records refer to the data of the image directly, so the image must outlive them.
+ * @note The data is stored in the native byte order as it's not supposed to be shared between machines.
+ */
+class MaterialSourceCache {
+public:
+	struct FileRecord {
+		wsw::StringView fileName;
+		uint32_t checksum { 0 };
+		uint32_t rawSize { 0 };
+		// Spans of compactified tokens, offsets refer to the data
+		const TokenSpan *spans { nullptr };
+		unsigned numSpans { 0 };
+		const char *data { nullptr };
+		unsigned dataSize { 0 };
+		// Pairs of the first token and the number of tokens of every material in the file
+		const std::pair<uint32_t, uint32_t> *sourceSpans { nullptr };
+		unsigned numSources { 0 };
+	};
+
+	static constexpr uint32_t kVersion = 1;
+
+	/**
+	 * Parses records of the image.
+	 * @return nullopt if the image is malformed or has an incompatible version.
+	 */
+	[[nodiscard]]
+	static auto parse( const uint8_t *data, size_t dataSize ) -> std::optional<wsw::Vector<FileRecord>>;
+
+	static void write( const FileRecord *records, size_t numRecords, wsw::Vector<uint8_t> *buffer );
+
+	/**
+	 * Creates file contents that are equivalent to contents of the tokenized file.
+	 * @return null on allocation failure.
+	 */
+	[[nodiscard]]
+	static auto makeFileContents( const FileRecord &record ) -> MaterialFileContents *;
 };
 
 // MSVC: Keep it defined as struct for now
@@ -636,15 +687,29 @@ class MaterialCache {
 
 	wsw::Vector<TokenSpan> m_fileTokenSpans;
 
-	wsw::Vector<wsw::StringView> m_fileMaterialNames;
-	wsw::Vector<std::pair<unsigned, unsigned>> m_fileSourceSpans;
+	wsw::Vector<std::pair<uint32_t, uint32_t>> m_fileSourceSpans;
+
+	// An entry of the source cache that is going to be written (kept only during construction)
+	struct SourceCacheEntry {
+		wsw::String fileName;
+		uint32_t checksum { 0 };
+		uint32_t rawSize { 0 };
+		const MaterialFileContents *contents { nullptr };
+		wsw::Vector<std::pair<uint32_t, uint32_t>> sourceSpans;
+	};
+
+	wsw::Vector<uint8_t> m_sourceCacheImage;
+	wsw::Vector<MaterialSourceCache::FileRecord> m_cachedFileRecords;
+	wsw::Vector<SourceCacheEntry> m_sourceCacheEntries;
+	unsigned m_numSourceCacheHits { 0 };
+	bool m_isSourceCacheDirty { false };
 
 	wsw::StaticVector<uint16_t, MAX_SHADERS> m_freeMaterialIds;
 
 	wsw::MemberBasedFreelistAllocator<sizeof( Skin ), 16> m_skinsAllocator;
 
 	[[nodiscard]]
-	auto loadFileContents( const wsw::StringView &fileName ) -> MaterialFileContents *;
+	auto tokenizeFileContents( const wsw::String &rawContents ) -> MaterialFileContents *;
 	[[nodiscard]]
 	auto readRawContents( const wsw::StringView &fileName ) -> const wsw::String *;
 
@@ -653,7 +718,16 @@ class MaterialCache {
 	void addFileContents( const wsw::StringView &fileName );
 
 	[[nodiscard]]
-	bool tryAddingFileContents( const MaterialFileContents *contents );
+	bool findSourceSpans( const MaterialFileContents *contents );
+	[[nodiscard]]
+	bool addSources( const MaterialFileContents *contents );
+
+	void loadSourceCache();
+	void saveSourceCache();
+
+	[[nodiscard]]
+	auto findCachedFileRecord( const wsw::StringView &fileName, uint32_t checksum, uint32_t rawSize ) const
+		-> const MaterialSourceCache::FileRecord *;
 
 	void unlinkAndFree( shader_t *material );
 
@@ -709,6 +783,12 @@ public:
 	[[nodiscard]]
 	auto loadDefaultMaterial( const wsw::StringView &name, int type ) -> shader_t *;
 
+	/**
+	 * Adds images that are going to be loaded for the material to the set of images prefetched by TextureCache.
+	 * Does nothing if the material is already loaded.
+	 */
+	void addTexturesOfMaterialToPrefetch( const wsw::StringView &name, int type );
+
 	[[nodiscard]]
 	auto registerSkin( const wsw::StringView &name ) -> Skin *;
 
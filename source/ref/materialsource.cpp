@@ -157,4 +157,64 @@ bool MaterialSource::expandTemplate( const ExpansionParams &params, ExpansionSta
 
 	addTheRest( state, lastTokenNum, numSpans );
 	return true;
-}
\ No newline at end of file
+}
+[[nodiscard]]
+static bool isAPrefetchableImageName( const wsw::StringView &token ) {
+	// Skip builtin images, lightmaps, template placeholders and numeric arguments
+	if( token.empty() || token.startsWith( '$' ) || token.startsWith( '*' ) || token.contains( '$' ) ) {
+		return false;
+	}
+	if( token.length() == 1 && token[0] == '-' ) {
+		return false;
+	}
+	return std::find_if( token.begin(), token.end(), []( char ch ) { return !isdigit( ch ); } ) != token.end();
+}
+
+bool MaterialSource::findReferencedImages( wsw::Vector<wsw::StringView> *imageNames ) const {
+	using wsw::operator""_asView;
+
+	const auto [spans, numTokens] = getTokenSpans();
+	const char *const data = getCharData();
+
+	bool usesDefaultMaterialImages = false;
+	for( unsigned keyTokenNum = 0; keyTokenNum < numTokens; ) {
+		const wsw::StringView key( data + spans[keyTokenNum].offset, spans[keyTokenNum].len );
+		const unsigned argsStart = keyTokenNum + 1;
+		unsigned argsEnd = argsStart;
+		while( argsEnd < numTokens && spans[argsEnd].line == spans[keyTokenNum].line ) {
+			argsEnd++;
+		}
+		keyTokenNum = argsEnd;
+
+		unsigned firstImageArg = argsStart;
+		unsigned lastImageArg = argsEnd;
+		if( key.equalsIgnoreCase( "map"_asView ) || key.equalsIgnoreCase( "clampMap"_asView ) ) {
+			lastImageArg = wsw::min( argsEnd, argsStart + 1 );
+		} else if( key.equalsIgnoreCase( "animMap"_asView ) || key.equalsIgnoreCase( "animClampMap"_asView ) ) {
+			// Skip the frequency
+			firstImageArg = argsStart + 1;
+		} else if( key.equalsIgnoreCase( "material"_asView ) ) {
+			unsigned numImageArgs = 0;
+			for( unsigned i = argsStart; i < argsEnd; ++i ) {
+				numImageArgs += isAPrefetchableImageName( wsw::StringView( data + spans[i].offset, spans[i].len ) );
+			}
+			// The diffuse image defaults to the material name
+			if( !numImageArgs ) {
+				imageNames->push_back( m_name );
+			}
+			// Companion images are loaded by suffixes if the normalmap is not specified
+			usesDefaultMaterialImages |= numImageArgs < 2;
+		} else if( !key.equalsIgnoreCase( "distortion"_asView ) ) {
+			continue;
+		}
+
+		for( unsigned i = firstImageArg; i < lastImageArg; ++i ) {
+			const wsw::StringView token( data + spans[i].offset, spans[i].len );
+			if( isAPrefetchableImageName( token ) ) {
+				imageNames->push_back( token );
+			}
+		}
+	}
+
+	return usesDefaultMaterialImages;
+}
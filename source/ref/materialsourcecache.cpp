@@ -0,0 +1,161 @@
+#include "materiallocal.h"
+
+#include <cstring>
+
+struct MaterialSourceCacheHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t tokenSpanSize;
+	uint32_t numFiles;
+};
+
+struct MaterialSourceCacheFileHeader {
+	uint32_t fileNameLength;
+	uint32_t checksum;
+	uint32_t rawSize;
+	uint32_t numSpans;
+	uint32_t dataSize;
+	uint32_t numSources;
+};
+
+static const char kMaterialSourceCacheMagic[4] { 'M', 'T', 'R', 'C' };
+
+// Keep records aligned so spans could be referred directly
+[[nodiscard]]
+static auto alignRecordSize( size_t size ) -> size_t {
+	return ( size + 3u ) & ~(size_t)3u;
+}
+
+auto MaterialSourceCache::parse( const uint8_t *data, size_t dataSize ) -> std::optional<wsw::Vector<FileRecord>> {
+	static_assert( alignof( TokenSpan ) <= 4 && alignof( std::pair<uint32_t, uint32_t> ) <= 4 );
+	assert( ( (uintptr_t)data % 4 ) == 0 );
+
+	MaterialSourceCacheHeader header;
+	if( dataSize < sizeof( header ) ) {
+		return std::nullopt;
+	}
+	std::memcpy( &header, data, sizeof( header ) );
+	if( std::memcmp( header.magic, kMaterialSourceCacheMagic, 4 ) != 0 ) {
+		return std::nullopt;
+	}
+	if( header.version != kVersion || header.tokenSpanSize != sizeof( TokenSpan ) ) {
+		return std::nullopt;
+	}
+
+	wsw::Vector<FileRecord> records;
+	records.reserve( header.numFiles );
+
+	size_t offset = sizeof( header );
+	for( unsigned fileNum = 0; fileNum < header.numFiles; ++fileNum ) {
+		MaterialSourceCacheFileHeader fileHeader;
+		if( offset + sizeof( fileHeader ) > dataSize ) {
+			return std::nullopt;
+		}
+		std::memcpy( &fileHeader, data + offset, sizeof( fileHeader ) );
+		offset += sizeof( fileHeader );
+
+		const size_t spansSize       = sizeof( TokenSpan ) * (size_t)fileHeader.numSpans;
+		const size_t sourceSpansSize = sizeof( std::pair<uint32_t, uint32_t> ) * (size_t)fileHeader.numSources;
+		const size_t bytesLeft       = dataSize - offset;
+		const size_t charsSize       = (size_t)fileHeader.fileNameLength + (size_t)fileHeader.dataSize;
+		if( spansSize > bytesLeft || sourceSpansSize > bytesLeft || charsSize > bytesLeft ) {
+			return std::nullopt;
+		}
+		const size_t recordSize = alignRecordSize( spansSize + sourceSpansSize + charsSize );
+		if( recordSize > bytesLeft ) {
+			return std::nullopt;
+		}
+
+		FileRecord record;
+		record.checksum    = fileHeader.checksum;
+		record.rawSize     = fileHeader.rawSize;
+		record.spans       = (const TokenSpan *)( data + offset );
+		record.numSpans    = fileHeader.numSpans;
+		record.sourceSpans = (const std::pair<uint32_t, uint32_t> *)( data + offset + spansSize );
+		record.numSources  = fileHeader.numSources;
+		const char *const chars = (const char *)( data + offset + spansSize + sourceSpansSize );
+		record.fileName    = wsw::StringView( chars, fileHeader.fileNameLength );
+		record.data        = chars + fileHeader.fileNameLength;
+		record.dataSize    = fileHeader.dataSize;
+
+		// Validate references so the rest of the code could trust the data
+		for( unsigned i = 0; i < record.numSpans; ++i ) {
+			const TokenSpan &span = record.spans[i];
+			if( span.offset < 0 || (size_t)span.offset + span.len > record.dataSize ) {
+				return std::nullopt;
+			}
+		}
+		for( unsigned i = 0; i < record.numSources; ++i ) {
+			const auto [from, len] = record.sourceSpans[i];
+			// The name and the opening brace precede the first token of the material
+			if( from < 2 || (size_t)from + len > record.numSpans ) {
+				return std::nullopt;
+			}
+		}
+
+		records.push_back( record );
+		offset += recordSize;
+	}
+
+	if( offset != dataSize ) {
+		return std::nullopt;
+	}
+
+	return records;
+}
+
+void MaterialSourceCache::write( const FileRecord *records, size_t numRecords, wsw::Vector<uint8_t> *buffer ) {
+	buffer->clear();
+
+	const auto append = [=]( const void *bytes, size_t size ) {
+		buffer->insert( buffer->end(), (const uint8_t *)bytes, (const uint8_t *)bytes + size );
+	};
+
+	MaterialSourceCacheHeader header;
+	std::memcpy( header.magic, kMaterialSourceCacheMagic, 4 );
+	header.version = kVersion;
+	header.tokenSpanSize = sizeof( TokenSpan );
+	header.numFiles = (uint32_t)numRecords;
+	append( &header, sizeof( header ) );
+
+	for( size_t i = 0; i < numRecords; ++i ) {
+		const FileRecord &record = records[i];
+
+		MaterialSourceCacheFileHeader fileHeader;
+		fileHeader.fileNameLength = (uint32_t)record.fileName.size();
+		fileHeader.checksum       = record.checksum;
+		fileHeader.rawSize        = record.rawSize;
+		fileHeader.numSpans       = record.numSpans;
+		fileHeader.dataSize       = record.dataSize;
+		fileHeader.numSources     = record.numSources;
+		append( &fileHeader, sizeof( fileHeader ) );
+
+		const size_t recordStart = buffer->size();
+		append( record.spans, sizeof( TokenSpan ) * record.numSpans );
+		append( record.sourceSpans, sizeof( std::pair<uint32_t, uint32_t> ) * record.numSources );
+		append( record.fileName.data(), record.fileName.size() );
+		append( record.data, record.dataSize );
+		buffer->resize( recordStart + alignRecordSize( buffer->size() - recordStart ), 0 );
+	}
+}
+
+auto MaterialSourceCache::makeFileContents( const FileRecord &record ) -> MaterialFileContents * {
+	wsw::MemSpecBuilder memSpec( wsw::MemSpecBuilder::initiallyEmpty() );
+	const auto headerSpec = memSpec.add<MaterialFileContents>();
+	const auto spansSpec = memSpec.add<TokenSpan>( record.numSpans );
+	const auto contentsSpec = memSpec.add<char>( record.dataSize );
+
+	auto *const mem = (uint8_t *)::malloc( memSpec.sizeSoFar() );
+	if( !mem ) {
+		return nullptr;
+	}
+
+	auto *const result = new( headerSpec.get( mem ) )MaterialFileContents();
+	result->spans = spansSpec.get( mem );
+	result->data = contentsSpec.get( mem );
+	result->numSpans = record.numSpans;
+	result->dataSize = record.dataSize;
+	std::memcpy( result->spans, record.spans, sizeof( TokenSpan ) * record.numSpans );
+	std::memcpy( contentsSpec.get( mem ), record.data, record.dataSize );
+	return result;
+}
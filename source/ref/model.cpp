@@ -23,14 +23,18 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "local.h"
 #include "iqm.h"
+#include "../qcommon/bspimage.h"
+#include "../qcommon/md5.h"
 
 #include "../../third-party/recastnavigation/Recast/Include/Recast.h"
 #include "../gameshared/gs_qrespath.h"
 #include "../game/ai/vec3.h"
 
 #include <algorithm>
+#include <atomic>
 #include <numeric>
 #include <span>
+#include <thread>
 #include <unordered_map>
 
 typedef struct {
@@ -255,11 +259,15 @@ private:
 	rcPolyMesh *m_polyMesh { nullptr };
 };
 
-static wsw::Vector<Vec3> g_tmpVerticesBuffer;
-static wsw::Vector<int> g_tmpIndicesBuffer;
-static wsw::Vector<uint8_t> g_tmpAreaFlagsBuffer;
+// Every thread that builds occluders has its own buffers
+struct OccluderBuildBuffers {
+	wsw::Vector<Vec3> vertices;
+	wsw::Vector<int> indices;
+	wsw::Vector<uint8_t> areaFlags;
+};
 
 static bool Mod_AddOccludersFromListOfSurfs( const wsw::Vector<const msurface_t *> &surfs,
+											 OccluderBuildBuffers *buffers,
 											 wsw::Vector<OccluderBoundsEntry> *occluderBoundsEntries,
 											 wsw::Vector<OccluderDataEntry> *occluderDataEntries ) {
 	BoundsBuilder boundsBuilder;
@@ -274,7 +282,7 @@ static bool Mod_AddOccludersFromListOfSurfs( const wsw::Vector<const msurface_t
 		return false;
 	}
 
-	RecastPolyMeshBuilder meshBuilder( &g_tmpVerticesBuffer, &g_tmpIndicesBuffer, &g_tmpAreaFlagsBuffer );
+	RecastPolyMeshBuilder meshBuilder( &buffers->vertices, &buffers->indices, &buffers->areaFlags );
 
 	mat3_t toRecastXForm;
 	const vec3_t kRecastGroundNormal { 0.0f, 1.0f, 0.0f };
@@ -381,8 +389,124 @@ namespace std {
 	};
 }
 
+/*
+* Occluders cache
+*
+* Building occluders is expensive for large maps, so results are saved in the cache directory.
+* Cached occluders are valid as long as the map file and the set of surfaces that are suitable for occluders
+* (this depends on materials) remain the same.
+*/
+#define OCCLUDERS_CACHE_DIRECTORY "occluders"
+#define OCCLUDERS_CACHE_EXTENSION ".occl"
+// Must be changed if parameters of building occluders get changed
+#define OCCLUDERS_CACHE_VERSION 1
+
+struct OccludersCacheHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t boundsEntrySize;
+	uint32_t dataEntrySize;
+	uint32_t mapChecksum;
+	uint32_t surfsChecksum;
+	uint32_t numOccluders;
+};
+
+static const char kOccludersCacheMagic[4] { 'O', 'C', 'C', 'L' };
+
+static void Mod_MakeOccludersCachePath( const model_t *model, char *buffer, size_t bufferSize ) {
+	char shortname[MAX_QPATH];
+	Q_strncpyz( shortname, model->name, sizeof( shortname ) );
+	COM_StripExtension( shortname );
+	Q_snprintfz( buffer, bufferSize, "%s/%s%s", OCCLUDERS_CACHE_DIRECTORY, shortname, OCCLUDERS_CACHE_EXTENSION );
+}
+
+static void Mod_PrepareOccludersCacheHeader( unsigned mapChecksum, unsigned surfsChecksum,
+											 unsigned numOccluders, OccludersCacheHeader *header ) {
+	memcpy( header->magic, kOccludersCacheMagic, sizeof( kOccludersCacheMagic ) );
+	header->version         = OCCLUDERS_CACHE_VERSION;
+	header->boundsEntrySize = sizeof( OccluderBoundsEntry );
+	header->dataEntrySize   = sizeof( OccluderDataEntry );
+	header->mapChecksum     = mapChecksum;
+	header->surfsChecksum   = surfsChecksum;
+	header->numOccluders    = numOccluders;
+}
+
+static bool Mod_LoadCachedOccluders( model_t *model, unsigned mapChecksum, unsigned surfsChecksum ) {
+	char path[MAX_QPATH + 32];
+	Mod_MakeOccludersCachePath( model, path, sizeof( path ) );
+
+	int filenum = 0;
+	const int length = FS_FOpenFile( path, &filenum, FS_READ | FS_CACHE );
+	if( !filenum ) {
+		return false;
+	}
+
+	OccludersCacheHeader header, expectedHeader;
+	if( length < (int)sizeof( header ) || FS_Read( &header, sizeof( header ), filenum ) != (int)sizeof( header ) ) {
+		FS_FCloseFile( filenum );
+		return false;
+	}
+
+	Mod_PrepareOccludersCacheHeader( mapChecksum, surfsChecksum, header.numOccluders, &expectedHeader );
+	const size_t entrySize = sizeof( OccluderBoundsEntry ) + sizeof( OccluderDataEntry );
+	if( memcmp( &header, &expectedHeader, sizeof( header ) ) != 0 || length != (int)( sizeof( header ) + header.numOccluders * entrySize ) ) {
+		FS_FCloseFile( filenum );
+		return false;
+	}
+
+	const unsigned numOccluders = header.numOccluders;
+	auto *const boundsEntries = (OccluderBoundsEntry *)Q_malloc( sizeof( OccluderBoundsEntry ) * numOccluders );
+	auto *const dataEntries   = (OccluderDataEntry *)Q_malloc( sizeof( OccluderDataEntry ) * numOccluders );
+
+	const int boundsSize = (int)( sizeof( OccluderBoundsEntry ) * numOccluders );
+	const int dataSize   = (int)( sizeof( OccluderDataEntry ) * numOccluders );
+	const bool succeeded = FS_Read( boundsEntries, boundsSize, filenum ) == boundsSize && FS_Read( dataEntries, dataSize, filenum ) == dataSize;
+	FS_FCloseFile( filenum );
+
+	if( !succeeded ) {
+		Q_free( boundsEntries );
+		Q_free( dataEntries );
+		return false;
+	}
+
+	auto *const loadbmodel = ( ( mbrushmodel_t * )model->extradata );
+	loadbmodel->numOccluders          = numOccluders;
+	loadbmodel->occluderBoundsEntries = boundsEntries;
+	loadbmodel->occluderDataEntries   = dataEntries;
+	return true;
+}
+
+static void Mod_SaveCachedOccluders( const model_t *model, unsigned mapChecksum, unsigned surfsChecksum ) {
+	char path[MAX_QPATH + 32];
+	Mod_MakeOccludersCachePath( model, path, sizeof( path ) );
+
+	int filenum = 0;
+	if( FS_FOpenFile( path, &filenum, FS_WRITE | FS_CACHE ) < 0 ) {
+		Com_Printf( S_COLOR_YELLOW "Failed to open %s for writing\n", path );
+		return;
+	}
+
+	const auto *const loadbmodel = ( ( const mbrushmodel_t * )model->extradata );
+	OccludersCacheHeader header;
+	Mod_PrepareOccludersCacheHeader( mapChecksum, surfsChecksum, loadbmodel->numOccluders, &header );
+
+	const size_t boundsSize = sizeof( OccluderBoundsEntry ) * loadbmodel->numOccluders;
+	const size_t dataSize   = sizeof( OccluderDataEntry ) * loadbmodel->numOccluders;
+	bool succeeded = FS_Write( &header, sizeof( header ), filenum ) == (int)sizeof( header );
+	succeeded = succeeded && FS_Write( loadbmodel->occluderBoundsEntries, boundsSize, filenum ) == (int)boundsSize;
+	succeeded = succeeded && FS_Write( loadbmodel->occluderDataEntries, dataSize, filenum ) == (int)dataSize;
+	FS_FCloseFile( filenum );
+
+	// Note: a partially written file fails the size check on loading
+	if( !succeeded ) {
+		Com_Printf( S_COLOR_YELLOW "Failed to write %s\n", path );
+	}
+}
+
 static void Mod_BuildOccluders( model_t *model ) {
 	std::unordered_map<PlaneKey, wsw::Vector<const msurface_t *>> surfsBinnedByPlanes;
+	// Numbers of surfaces that are suitable for occluders, used as a part of the cache key
+	wsw::Vector<uint32_t> suitableSurfNums;
 
 	mbrushmodel_t *const loadbmodel = ( ( mbrushmodel_t * )model->extradata );
 	for( unsigned i = 0; i < loadbmodel->numModelSurfaces; i++ ) {
@@ -393,6 +517,7 @@ static void Mod_BuildOccluders( model_t *model ) {
 		if( !( surf->shader && surf->shader->sort == SHADER_SORT_OPAQUE ) ) {
 			continue;
 		}
+		suitableSurfNums.push_back( i );
 		const PlaneKey planeKey { .plane = surf->plane };
 		auto it = surfsBinnedByPlanes.find( planeKey );
 		if( it != surfsBinnedByPlanes.end() ) {
@@ -402,26 +527,83 @@ static void Mod_BuildOccluders( model_t *model ) {
 		}
 	}
 
-	std::vector<OccluderBoundsEntry> occluderBoundsEntries;
-	std::vector<OccluderDataEntry> occluderDataEntries;
+	// The cache is keyed by the map checksum, so it's available only for shared map images
+	const bool useCache = loadbmodel->mapImage != nullptr;
+	unsigned mapChecksum = 0, surfsChecksum = 0;
+	if( useCache ) {
+		mapChecksum   = loadbmodel->mapImage->checksum();
+		surfsChecksum = md5_digest32( suitableSurfNums.data(), (int)( suitableSurfNums.size() * sizeof( uint32_t ) ) );
+		if( Mod_LoadCachedOccluders( model, mapChecksum, surfsChecksum ) ) {
+			Com_DPrintf( "Loaded %u cached occluders for %s\n", loadbmodel->numOccluders, model->name );
+			return;
+		}
+	}
+
+	const int64_t startTime = Sys_Milliseconds();
 
-	unsigned numSuitableSurfGroups = 0;
+	wsw::Vector<const wsw::Vector<const msurface_t *> *> surfGroups;
+	surfGroups.reserve( surfsBinnedByPlanes.size() );
 	for( const auto &[_, listOfSurfs]: surfsBinnedByPlanes ) {
-		if( Mod_AddOccludersFromListOfSurfs( listOfSurfs, &occluderBoundsEntries, &occluderDataEntries ) ) {
-			numSuitableSurfGroups++;
+		surfGroups.push_back( std::addressof( listOfSurfs ) );
+	}
+
+	struct GroupOccluders {
+		wsw::Vector<OccluderBoundsEntry> boundsEntries;
+		wsw::Vector<OccluderDataEntry> dataEntries;
+	};
+
+	// Surface groups are independent, so they get processed by multiple threads.
+	// Results are stored per group so the final order does not depend on scheduling.
+	wsw::Vector<GroupOccluders> groupOccluders( surfGroups.size() );
+	std::atomic<unsigned> nextGroupNum { 0 };
+	auto buildGroups = [&]() {
+		OccluderBuildBuffers buffers;
+		for(;; ) {
+			const unsigned groupNum = nextGroupNum.fetch_add( 1, std::memory_order_relaxed );
+			if( groupNum >= surfGroups.size() ) {
+				break;
+			}
+			GroupOccluders *const results = &groupOccluders[groupNum];
+			(void)Mod_AddOccludersFromListOfSurfs( *surfGroups[groupNum], &buffers, &results->boundsEntries, &results->dataEntries );
 		}
+	};
+
+	unsigned numPhysicalProcessors = 1, numLogicalProcessors = 1;
+	(void)Sys_GetNumberOfProcessors( &numPhysicalProcessors, &numLogicalProcessors );
+	const auto numThreads = (unsigned)wsw::min<size_t>( wsw::max( 1u, numPhysicalProcessors ), surfGroups.size() );
+
+	wsw::Vector<std::thread> threads;
+	for( unsigned i = 1; i < numThreads; ++i ) {
+		threads.emplace_back( std::thread( buildGroups ) );
+	}
+	// The caller thread does its share of work as well
+	buildGroups();
+	for( std::thread &thread: threads ) {
+		thread.join();
 	}
 
-	assert( occluderBoundsEntries.size() == occluderDataEntries.size() );
-	const unsigned numOccluders = occluderDataEntries.size();
+	unsigned numOccluders = 0;
+	for( const GroupOccluders &results: groupOccluders ) {
+		assert( results.boundsEntries.size() == results.dataEntries.size() );
+		numOccluders += results.dataEntries.size();
+	}
 
 	loadbmodel->numOccluders          = numOccluders;
 	loadbmodel->occluderBoundsEntries = (OccluderBoundsEntry *)Q_malloc( sizeof( OccluderBoundsEntry ) * numOccluders );
 	loadbmodel->occluderDataEntries   = (OccluderDataEntry *)Q_malloc( sizeof( OccluderDataEntry ) * numOccluders );
 
-	for( unsigned i = 0; i < numOccluders; ++i ) {
-		loadbmodel->occluderBoundsEntries[i] = occluderBoundsEntries[i];
-		loadbmodel->occluderDataEntries[i]   = occluderDataEntries[i];
+	unsigned occluderNum = 0;
+	for( const GroupOccluders &results: groupOccluders ) {
+		std::copy( results.boundsEntries.begin(), results.boundsEntries.end(), loadbmodel->occluderBoundsEntries + occluderNum );
+		std::copy( results.dataEntries.begin(), results.dataEntries.end(), loadbmodel->occluderDataEntries + occluderNum );
+		occluderNum += results.dataEntries.size();
+	}
+
+	Com_DPrintf( "Built %u occluders for %s using %u threads in %d ms\n",
+				 numOccluders, model->name, numThreads, (int)( Sys_Milliseconds() - startTime ) );
+
+	if( useCache ) {
+		Mod_SaveCachedOccluders( model, mapChecksum, surfsChecksum );
 	}
 }
 
@@ -1242,7 +1424,17 @@ model_t *Mod_ForName( const char *name, bool crash ) {
 	// load the file
 	//
 	unsigned *buf;
-	(void)R_LoadFile( name, (void **)&buf );
+	// map files are shared with the collision code (the brush model loader takes its own reference)
+	wsw::bsp::MapImage *mapImage = nullptr;
+	if( !Q_stricmp( extension, "bsp" ) ) {
+		if( ( mapImage = wsw::bsp::MapImage::acquire( name ) ) ) {
+			buf = (unsigned *)mapImage->data();
+		} else {
+			buf = nullptr;
+		}
+	} else {
+		(void)R_LoadFile( name, (void **)&buf );
+	}
 	if( !buf && crash ) {
 		Com_Error( ERR_DROP, "Mod_NumForName: %s not found", name );
 	}
@@ -1261,6 +1453,9 @@ model_t *Mod_ForName( const char *name, bool crash ) {
 	const auto *descr = Q_FindFormatDescriptor( mod_supportedformats, ( const uint8_t * )buf, (const bspFormatDesc_t **)&bspFormat );
 	if( !descr ) {
 		Com_DPrintf( S_COLOR_YELLOW "Mod_NumForName: unknown fileid for %s", mod->name );
+		if( mapImage ) {
+			wsw::bsp::MapImage::release( mapImage );
+		}
 		return nullptr;
 	}
 
@@ -1270,7 +1465,11 @@ model_t *Mod_ForName( const char *name, bool crash ) {
 	}
 
 	descr->loader( mod, nullptr, buf, bspFormat );
-	R_FreeFile( buf );
+	if( mapImage ) {
+		wsw::bsp::MapImage::release( mapImage );
+	} else {
+		R_FreeFile( buf );
+	}
 
 	if( mod->type == mod_bad ) {
 		return nullptr;
@@ -24,6 +24,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "local.h"
 #include "../qcommon/qcommon.h"
 #include "materiallocal.h"
+#include "../qcommon/bspimage.h"
 #include <array>
 
 typedef struct {
@@ -51,6 +52,9 @@ static mshaderref_t *loadmodel_shaderrefs;
 static int loadmodel_numsurfaces;
 static rdface_t *loadmodel_dsurfaces;
 
+static ImageLoadingPipeline::Stats loadmodel_imageLoadingStats;
+static int64_t loadmodel_materialsLoadingMillis;
+
 static int loadmodel_numpatchgroups;
 static int loadmodel_maxpatchgroups;
 static mpatchgroup_t *loadmodel_patchgroups;
@@ -67,13 +71,13 @@ BRUSHMODEL LOADING
 ===============================================================================
 */
 
-static uint8_t *mod_base;
+static const uint8_t *mod_base;
 static mbrushmodel_t *loadbmodel;
 
 /*
 * Mod_CheckDeluxemaps
 */
-static void Mod_CheckDeluxemaps( const lump_t *l, uint8_t *lmData ) {
+static void Mod_CheckDeluxemaps( const lump_t *l, const uint8_t *lmData ) {
 	int i, j;
 	int surfaces, lightmap;
 
@@ -206,6 +210,19 @@ static void Mod_FaceToRavenFace( const dface_t *in, rdface_t *rdf ) {
 	rdf->numelems = in->numelems;
 }
 
+/*
+* Mod_ShaderRefForFace
+*/
+static mshaderref_t *Mod_ShaderRefForFace( const rdface_t *in, shaderType_e *shaderType ) {
+	const int shaderNum = LittleLong( in->shadernum );
+	if( shaderNum < 0 || shaderNum >= loadmodel_numshaderrefs ) {
+		Com_Error( ERR_DROP, "MOD_LoadBmodel: bad shader number" );
+	}
+
+	*shaderType = ( in->lightmapStyles[0] == 255 ) ? SHADER_TYPE_VERTEX : SHADER_TYPE_DELUXEMAP;
+	return loadmodel_shaderrefs + shaderNum;
+}
+
 /*
 * Mod_PreloadFaces
 */
@@ -254,33 +271,43 @@ static void Mod_PreloadFaces( const lump_t *l ) {
 		}
 	}
 
-	// preload shaders (images will start loading in background threads while we're still busy with the map)
+	// preload shaders (images are read and decoded in background threads while materials are parsed)
+	auto *const materialCache = MaterialCache::instance();
+	auto *const textureCache = TextureCache::instance();
+
+	const int64_t loadingStartTimestamp = Sys_Milliseconds();
+
+	wsw::Vector<bool> isAddedToPrefetch( loadmodel_numshaderrefs * 2, false );
 	in = loadmodel_dsurfaces;
 	for( i = 0; i < loadmodel_numsurfaces; i++, in++ ) {
-		// load shader
-		int shaderNum;
-		mshaderref_t *shaderRef;
 		shaderType_e shaderType;
-
-		shaderNum = LittleLong( in->shadernum );
-		if( shaderNum < 0 || shaderNum >= loadmodel_numshaderrefs ) {
-			Com_Error( ERR_DROP, "MOD_LoadBmodel: bad shader number" );
+		const mshaderref_t *shaderRef = Mod_ShaderRefForFace( in, &shaderType );
+		if( shaderRef->name[0] ) {
+			const auto flagIndex = 2 * ( shaderRef - loadmodel_shaderrefs ) + ( shaderType == SHADER_TYPE_DELUXEMAP );
+			if( !isAddedToPrefetch[flagIndex] ) {
+				isAddedToPrefetch[flagIndex] = true;
+				materialCache->addTexturesOfMaterialToPrefetch( wsw::StringView( shaderRef->name ), shaderType );
+			}
 		}
-		shaderRef = loadmodel_shaderrefs + shaderNum;
+	}
+
+	textureCache->startPrefetchingMaterialTextures();
+
+	in = loadmodel_dsurfaces;
+	for( i = 0; i < loadmodel_numsurfaces; i++, in++ ) {
+		shaderType_e shaderType;
+		mshaderref_t *shaderRef = Mod_ShaderRefForFace( in, &shaderType );
 		if( !shaderRef->name[0] ) {
 			continue;
 		}
 
-		if( in->lightmapStyles[0] == 255 ) {
-			shaderType = SHADER_TYPE_VERTEX;
-		} else {
-			shaderType = SHADER_TYPE_DELUXEMAP;
-		}
-
 		if( !shaderRef->shaders[shaderType - SHADER_TYPE_BSP_MIN] ) {
 			shaderRef->shaders[shaderType - SHADER_TYPE_BSP_MIN] = R_RegisterShader( shaderRef->name, shaderType );
 		}
 	}
+
+	loadmodel_imageLoadingStats = textureCache->finishPrefetchingMaterialTextures();
+	loadmodel_materialsLoadingMillis = Sys_Milliseconds() - loadingStartTimestamp;
 }
 
 /*
@@ -1350,12 +1377,18 @@ static void Mod_LoadLightgrid_RBSP( const lump_t *l ) {
 		Com_Error( ERR_DROP, "Mod_LoadLightgrid: funny lump size in %s", loadmodel->name );
 	}
 	count = l->filelen / sizeof( *in );
-	out = (mgridlight_t *)Q_malloc( count * sizeof( *out ) );
-
-	loadbmodel->lightgrid = out;
 	loadbmodel->numlightgridelems = count;
 
-	// lightgrid is all 8 bit
+	// lightgrid is all 8 bit, so it could be referred directly
+	static_assert( sizeof( mgridlight_t ) == sizeof( rdgridlight_t ) && alignof( mgridlight_t ) == 1 );
+	if( loadbmodel->mapImage ) {
+		loadbmodel->lightgrid = (mgridlight_t *)in;
+		loadbmodel->isLightgridShared = true;
+		return;
+	}
+
+	out = (mgridlight_t *)Q_malloc( count * sizeof( *out ) );
+	loadbmodel->lightgrid = out;
 	memcpy( out, in, count * sizeof( *out ) );
 }
 
@@ -1417,6 +1450,15 @@ static void Mod_LoadVisibility( const lump_t *l ) {
 	}
 
 	in = (dvis_t *)( mod_base + l->fileofs );
+	// refer to the map image directly if the data is usable as-is
+	if( loadbmodel->mapImage && loadbmodel->mapImage->isLumpAligned( l->fileofs, alignof( dvis_t ) ) ) {
+		if( LittleLong( in->numclusters ) == in->numclusters && LittleLong( in->rowsize ) == in->rowsize ) {
+			loadbmodel->pvs = (dvis_t *)in;
+			loadbmodel->isPvsShared = true;
+			return;
+		}
+	}
+
 	out = (dvis_t *)Q_malloc( l->filelen );
 	loadbmodel->pvs = out;
 
@@ -1444,11 +1486,16 @@ static void Mod_LoadEntities( const lump_t *l, vec3_t gridSize, vec3_t ambient,
 	VectorClear( ambient );
 	VectorClear( outline );
 
-	data = (char *)mod_base + l->fileofs;
-	if( !data || !data[0] ) {
+	if( l->filelen <= 0 || !mod_base[l->fileofs] ) {
 		return;
 	}
 
+	// the lump is not zero-terminated within the read-only map image
+	char *const entityString = (char *)Q_malloc( l->filelen + 1 );
+	memcpy( entityString, mod_base + l->fileofs, l->filelen );
+	entityString[l->filelen] = '\0';
+	data = entityString;
+
 	for(; ( token = COM_Parse( &data ) ) && token[0] == '{'; ) {
 		isworld = false;
 
@@ -1523,6 +1570,8 @@ static void Mod_LoadEntities( const lump_t *l, vec3_t gridSize, vec3_t ambient,
 			break;
 		}
 	}
+
+	Q_free( entityString );
 }
 
 /*
@@ -1710,9 +1759,11 @@ static void Mod_Finish( const lump_t *faces, const lump_t *light, vec3_t gridSiz
 */
 void Mod_LoadQ3BrushModel( model_t *mod, model_t *parent, void *buffer, bspFormatDesc_t *format ) {
 	int i;
-	dheader_t *header;
+	dheader_t header;
 	vec3_t gridSize, ambient, outline;
 
+	const int64_t loadingStartTimestamp = Sys_Milliseconds();
+
 	mod->type = mod_brush;
 	mod->registrationSequence = rsh.registrationSequence;
 	if( rsh.worldModel != NULL ) {
@@ -1723,44 +1774,60 @@ void Mod_LoadQ3BrushModel( model_t *mod, model_t *parent, void *buffer, bspForma
 
 	mod_bspFormat = format;
 
-	header = (dheader_t *)buffer;
-	mod_base = (uint8_t *)header;
+	// the buffer is read-only, swap a copy of the header
+	header = *(const dheader_t *)buffer;
+	mod_base = (const uint8_t *)buffer;
 
 	// swap all the lumps
-	for( i = 0; i < sizeof( dheader_t ) / 4; i++ )
-		( (int *)header )[i] = LittleLong( ( (int *)header )[i] );
+	for( i = 0; i < (int)( sizeof( dheader_t ) / 4 ); i++ )
+		( (int *)&header )[i] = LittleLong( ( (int *)&header )[i] );
 
 	// load into heap
-	Mod_LoadSubmodels( &header->lumps[LUMP_MODELS] );
-	Mod_LoadVisibility( &header->lumps[LUMP_VISIBILITY] );
-	Mod_LoadEntities( &header->lumps[LUMP_ENTITIES], gridSize, ambient, outline );
-	Mod_LoadLighting( &header->lumps[LUMP_LIGHTING], &header->lumps[LUMP_FACES] );
-	Mod_LoadShaderrefs( &header->lumps[LUMP_SHADERREFS] );
-	Mod_PreloadFaces( &header->lumps[LUMP_FACES] );
-	Mod_LoadPlanes( &header->lumps[LUMP_PLANES] );
-	Mod_LoadFogs( &header->lumps[LUMP_FOGS], &header->lumps[LUMP_BRUSHES], &header->lumps[LUMP_BRUSHSIDES] );
-	Mod_LoadFaces( &header->lumps[LUMP_FACES] );
+	Mod_LoadSubmodels( &header.lumps[LUMP_MODELS] );
+
+	// hold the map image if the buffer belongs to it, so lumps could be referred directly
+	if( wsw::bsp::MapImage *image = wsw::bsp::MapImage::acquire( mod->name ) ) {
+		if( image->data() == mod_base ) {
+			loadbmodel->mapImage = image;
+		} else {
+			wsw::bsp::MapImage::release( image );
+		}
+	}
+
+	Mod_LoadVisibility( &header.lumps[LUMP_VISIBILITY] );
+	Mod_LoadEntities( &header.lumps[LUMP_ENTITIES], gridSize, ambient, outline );
+	Mod_LoadLighting( &header.lumps[LUMP_LIGHTING], &header.lumps[LUMP_FACES] );
+	Mod_LoadShaderrefs( &header.lumps[LUMP_SHADERREFS] );
+	Mod_PreloadFaces( &header.lumps[LUMP_FACES] );
+	Mod_LoadPlanes( &header.lumps[LUMP_PLANES] );
+	Mod_LoadFogs( &header.lumps[LUMP_FOGS], &header.lumps[LUMP_BRUSHES], &header.lumps[LUMP_BRUSHSIDES] );
+	Mod_LoadFaces( &header.lumps[LUMP_FACES] );
 	if( mod_bspFormat->flags & BSP_RAVEN ) {
-		Mod_LoadVertexes_RBSP( &header->lumps[LUMP_VERTEXES] );
+		Mod_LoadVertexes_RBSP( &header.lumps[LUMP_VERTEXES] );
 	} else {
-		Mod_LoadVertexes( &header->lumps[LUMP_VERTEXES] );
+		Mod_LoadVertexes( &header.lumps[LUMP_VERTEXES] );
 	}
-	Mod_LoadElems( &header->lumps[LUMP_ELEMENTS] );
+	Mod_LoadElems( &header.lumps[LUMP_ELEMENTS] );
 	if( mod_bspFormat->flags & BSP_RAVEN ) {
-		Mod_LoadLightgrid_RBSP( &header->lumps[LUMP_LIGHTGRID] );
+		Mod_LoadLightgrid_RBSP( &header.lumps[LUMP_LIGHTGRID] );
 	} else {
-		Mod_LoadLightgrid( &header->lumps[LUMP_LIGHTGRID] );
+		Mod_LoadLightgrid( &header.lumps[LUMP_LIGHTGRID] );
 	}
-	Mod_LoadPatchGroups( &header->lumps[LUMP_FACES] );
-	Mod_LoadLeafs( &header->lumps[LUMP_LEAFS], &header->lumps[LUMP_LEAFFACES] );
-	Mod_LoadNodes( &header->lumps[LUMP_NODES] );
+	Mod_LoadPatchGroups( &header.lumps[LUMP_FACES] );
+	Mod_LoadLeafs( &header.lumps[LUMP_LEAFS], &header.lumps[LUMP_LEAFFACES] );
+	Mod_LoadNodes( &header.lumps[LUMP_NODES] );
 	if( mod_bspFormat->flags & BSP_RAVEN ) {
-		Mod_LoadLightArray_RBSP( &header->lumps[LUMP_LIGHTARRAY] );
+		Mod_LoadLightArray_RBSP( &header.lumps[LUMP_LIGHTARRAY] );
 	} else {
 		Mod_LoadLightArray();
 	}
 
-	Mod_Finish( &header->lumps[LUMP_FACES], &header->lumps[LUMP_LIGHTING], gridSize, ambient, outline );
+	Mod_Finish( &header.lumps[LUMP_FACES], &header.lumps[LUMP_LIGHTING], gridSize, ambient, outline );
+
+	const ImageLoadingPipeline::Stats &stats = loadmodel_imageLoadingStats;
+	Com_Printf( "Loaded %s in %d ms (materials: %d ms, images: %u decoded, %u missing, %u in place, %u threads)\n",
+				mod->name, (int)( Sys_Milliseconds() - loadingStartTimestamp ), (int)loadmodel_materialsLoadingMillis,
+				stats.numDecoded, stats.numMissing, stats.numExecutedInPlace, stats.numThreads );
 }
 
 void Mod_DestroyQ3BrushModel( mbrushmodel_t *model ) {
@@ -1771,8 +1838,15 @@ void Mod_DestroyQ3BrushModel( mbrushmodel_t *model ) {
 		Q_free( model->leafs[i].visSurfaces );
 	}
 
-	Q_free( model->pvs );
-	Q_free( model->lightgrid );
+	if( !model->isPvsShared ) {
+		Q_free( model->pvs );
+	}
+	if( !model->isLightgridShared ) {
+		Q_free( model->lightgrid );
+	}
+	if( model->mapImage ) {
+		wsw::bsp::MapImage::release( model->mapImage );
+	}
 	Q_free( model->lightarray );
 	Q_free( model->superLightStyles );
 	Q_free( model->lightmapImages );
@@ -164,6 +164,7 @@ void Mod_LoadSkeletalModel( model_t *mod, model_t *parent, void *buffer, bspForm
 	iqmvertexarray_t *vas, va;
 	iqmjoint_t *joints, joint;
 	bonepose_t *baseposes;
+	int parents[BoneHierarchyLevels::kMaxBones];
 	iqmpose_t *poses, pose;
 	unsigned short *framedata;
 	const int *inelems;
@@ -358,6 +359,11 @@ void Mod_LoadSkeletalModel( model_t *mod, model_t *parent, void *buffer, bspForm
 		goto error;
 	}
 
+	if( header->num_joints > BoneHierarchyLevels::kMaxBones ) {
+		Com_Printf( S_COLOR_RED "ERROR: %s has too many joints: %i\n", mod->name, header->num_joints );
+		goto error;
+	}
+
 	// load joints
 	memsize = 0;
 	memsize += sizeof( bonepose_t ) * header->num_joints;
@@ -413,6 +419,13 @@ void Mod_LoadSkeletalModel( model_t *mod, model_t *parent, void *buffer, bspForm
 		DualQuat_Invert( poutmodel->invbaseposes[i].dualquat );
 	}
 
+	for( i = 0; i < poutmodel->numbones; i++ ) {
+		parents[i] = poutmodel->bones[i].parent;
+	}
+	if( !poutmodel->boneLevels.build( parents, poutmodel->numbones ) ) {
+		Com_Printf( S_COLOR_RED "ERROR: %s has an illegal hierarchy of bones\n", mod->name );
+		goto error;
+	}
 
 	// load frames
 	poses = ( iqmpose_t * )( pbase + header->ofs_poses );
@@ -1077,14 +1090,10 @@ void R_ShutdownSkeletalCache( void ) {
 }
 
 static void R_CacheBoneTransforms( skmcacheentry_t *cache, const entity_t *e ) {
-	unsigned i, j;
-	float frontlerp;
-	bonepose_t tempbonepose[256];
-	const bonepose_t *bp, *oldbp, *bonepose, *oldbonepose, *lerpedbonepose;
-	bonepose_t *out, tp;
-	mskbone_t *bone;
+	bonepose_t tempbonepose[BoneHierarchyLevels::kMaxBones];
+	const bonepose_t *bp, *oldbp, *lerpedbonepose;
 	const mskmodel_t *skmodel;
-	dualquat_t *bonePoseRelativeDQ;
+	float frontlerp;
 
 	skmodel = cache->skmodel;
 	bp = cache->boneposes;
@@ -1099,51 +1108,19 @@ static void R_CacheBoneTransforms( skmcacheentry_t *cache, const entity_t *e ) {
 			// assume that parent transforms have already been applied
 			lerpedbonepose = bp;
 		} else {
-			for( i = 0; i < skmodel->numbones; i++ ) {
-				j = i;
-				out = tempbonepose + j;
-				bonepose = bp + j;
-				bone = skmodel->bones + j;
-
-				if( bone->parent >= 0 ) {
-					DualQuat_Multiply( tempbonepose[bone->parent].dualquat, bonepose->dualquat, out->dualquat );
-				} else {
-					DualQuat_Copy( bonepose->dualquat, out->dualquat );
-				}
-			}
+			DualQuat_TransformHierarchy( &skmodel->boneLevels, &bp->dualquat, &tempbonepose->dualquat );
 		}
 	} else {
-		if( e->boneposes ) {
-			// lerp, assume that parent transforms have already been applied
-			for( i = 0, out = tempbonepose, bonepose = bp, oldbonepose = oldbp, bone = skmodel->bones; i < skmodel->numbones; i++, out++, bonepose++, oldbonepose++, bone++ ) {
-				DualQuat_Lerp( oldbonepose->dualquat, bonepose->dualquat, frontlerp, out->dualquat );
-			}
-		} else {
-			// lerp and transform
-			for( i = 0; i < skmodel->numbones; i++ ) {
-				j = i;
-				out = tempbonepose + j;
-				bonepose = bp + j;
-				oldbonepose = oldbp + j;
-				bone = skmodel->bones + j;
-
-				DualQuat_Lerp( oldbonepose->dualquat, bonepose->dualquat, frontlerp, out->dualquat );
-
-				if( bone->parent >= 0 ) {
-					DualQuat_Copy( out->dualquat, tp.dualquat );
-					DualQuat_Multiply( tempbonepose[bone->parent].dualquat, tp.dualquat, out->dualquat );
-				}
-			}
+		DualQuat_LerpMany( &oldbp->dualquat, &bp->dualquat, frontlerp, &tempbonepose->dualquat, skmodel->numbones );
+		// transform unless parent transforms have already been applied
+		if( !e->boneposes ) {
+			DualQuat_TransformHierarchy( &skmodel->boneLevels, &tempbonepose->dualquat, &tempbonepose->dualquat );
 		}
 	}
 
-	bonePoseRelativeDQ = ( dualquat_t * )cache->data;
-
 	// generate dual quaternions for all bones
-	for( i = 0; i < skmodel->numbones; i++ ) {
-		DualQuat_Multiply( lerpedbonepose[i].dualquat, skmodel->invbaseposes[i].dualquat, bonePoseRelativeDQ[i] );
-		DualQuat_Normalize( bonePoseRelativeDQ[i] );
-	}
+	DualQuat_MultiplyAndNormalizeMany( &lerpedbonepose->dualquat, &skmodel->invbaseposes->dualquat,
+									   ( dualquat_t * )cache->data, skmodel->numbones );
 }
 
 /*
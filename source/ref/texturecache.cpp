@@ -381,4 +381,28 @@ void TextureCache::freeUnusedWorldTextures() {
 
 void TextureCache::freeAllUnusedTextures() {
 	freeUnusedWorldTextures();
-}
\ No newline at end of file
+}
+void TextureCache::addMaterialTextureToPrefetch( const wsw::StringView &name, const wsw::StringView &suffix ) {
+	if( const auto maybeCleanName = makeCleanName( name, suffix ) ) {
+		const wsw::HashedStringView hashedCleanName( *maybeCleanName );
+		const auto binIndex = hashedCleanName.getHash() % kNumHashBins;
+		Material2DTexture *texture = m_materialTextureBins[binIndex];
+		for(; texture; texture = (Material2DTexture *)texture->next[Texture::BinLinks] ) {
+			if( texture->getName().equalsIgnoreCase( hashedCleanName ) ) {
+				return;
+			}
+		}
+		m_factory.m_loadingPipeline.add( hashedCleanName );
+	}
+}
+
+void TextureCache::startPrefetchingMaterialTextures() {
+	unsigned numPhysicalProcessors = 1, numLogicalProcessors = 1;
+	(void)Sys_GetNumberOfProcessors( &numPhysicalProcessors, &numLogicalProcessors );
+	// The render thread parses materials and uploads textures meanwhile
+	m_factory.m_loadingPipeline.start( numPhysicalProcessors > 1 ? numPhysicalProcessors - 1 : 1 );
+}
+
+auto TextureCache::finishPrefetchingMaterialTextures() -> ImageLoadingPipeline::Stats {
+	return m_factory.m_loadingPipeline.finish();
+}
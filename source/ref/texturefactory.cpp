@@ -38,8 +38,6 @@ auto rasterizeSvg( const void *rawSvgData, size_t rawSvgDataSize, void *dest, si
 				   const ImageOptions &options ) -> std::optional<std::pair<unsigned, unsigned>>;
 }
 
-#define STB_IMAGE_IMPLEMENTATION
-#include "../../third-party/stb/stb_image.h"
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "../../third-party/stb/stb_image_write.h"
 
@@ -308,12 +306,10 @@ static ImageBuffer cubemapBuffer[6];
 static ImageBuffer loadingBuffer;
 static ImageBuffer conversionBuffer;
 
-auto TextureFactory::loadTextureDataFromFile( const wsw::StringView &name,
-											  ImageBuffer *readBuffer,
-											  ImageBuffer *dataBuffer,
-											  ImageBuffer *conversionBuffer,
-											  const ImageOptions &options )
-											-> std::optional<std::pair<uint8_t *, BitmapProps>> {
+constexpr size_t kMaxSaneBitmapDataSize = 2048 * 2048 * 4;
+
+[[nodiscard]]
+static auto findImageFile( const wsw::StringView &name ) -> std::optional<std::pair<wsw::StringView, wsw::StringView>> {
 	assert( name.isZeroTerminated() );
 	assert( NUM_IMAGE_EXTENSIONS == 4 );
 	// TODO: Adopt the sane FS interface over the codebase
@@ -324,7 +320,43 @@ auto TextureFactory::loadTextureDataFromFile( const wsw::StringView &name,
 		wsw::StringView( IMAGE_EXTENSIONS[3] )
 	};
 
-	const auto maybePartsPair = wsw::fs::findFirstExtension( name, std::begin( extensions ), std::end( extensions ) );
+	return wsw::fs::findFirstExtension( name, std::begin( extensions ), std::end( extensions ) );
+}
+
+bool TextureFactory::readMaterialImageFile( const wsw::StringView &name, wsw::Vector<uint8_t> *buffer ) {
+	const auto maybePartsPair = findImageFile( name );
+	if( !maybePartsPair ) {
+		return false;
+	}
+
+	// Vector images require explicitly supplied options, leave them for loadTextureDataFromFile()
+	if( maybePartsPair->second.equalsIgnoreCase( ".svg"_asView ) ) {
+		return false;
+	}
+
+	wsw::StaticString<MAX_QPATH> path;
+	path << maybePartsPair->first << maybePartsPair->second;
+	auto maybeHandle = wsw::fs::openAsReadHandle( path.asView() );
+	if( !maybeHandle ) {
+		return false;
+	}
+
+	const size_t fileSize = maybeHandle->getInitialFileSize();
+	if( fileSize > kMaxSaneBitmapDataSize + 8192 ) {
+		return false;
+	}
+
+	buffer->resize( fileSize );
+	return maybeHandle->readExact( buffer->data(), fileSize );
+}
+
+auto TextureFactory::loadTextureDataFromFile( const wsw::StringView &name,
+											  ImageBuffer *readBuffer,
+											  ImageBuffer *dataBuffer,
+											  ImageBuffer *conversionBuffer,
+											  const ImageOptions &options )
+											-> std::optional<std::pair<uint8_t *, BitmapProps>> {
+	const auto maybePartsPair = findImageFile( name );
 	if( !maybePartsPair ) {
 		return std::nullopt;
 	}
@@ -338,7 +370,6 @@ auto TextureFactory::loadTextureDataFromFile( const wsw::StringView &name,
 
 	const bool isSvg = maybePartsPair->second.equalsIgnoreCase( ".svg"_asView );
 
-	constexpr size_t kMaxSaneBitmapDataSize = 2048 * 2048 * 4;
 	// In case of regular images, consider that the data size cannot be greater than 2048x2048 RGBA + some header bytes
 	const size_t maxSaneImageDataSize = isSvg ? 1024 * 1024 : ( kMaxSaneBitmapDataSize + 8192 );
 	const size_t fileSize = maybeHandle->getInitialFileSize();
@@ -353,7 +384,8 @@ auto TextureFactory::loadTextureDataFromFile( const wsw::StringView &name,
 
 	int width = 0, height = 0, samples = 0;
 	size_t imageDataSize = 0;
-	uint8_t *bytes = nullptr;
+	const uint8_t *bytes = nullptr;
+	std::optional<DecodedImage> maybeDecodedImage;
 	if( isSvg ) {
 		// It's only gets used in this case.
 		// TODO: Redesign supplying of desired texture parameters
@@ -364,21 +396,24 @@ auto TextureFactory::loadTextureDataFromFile( const wsw::StringView &name,
 		samples = 4;
 		const auto [desiredWidth, desiredHeight] = *options.desiredSize;
 		const auto bufferDataSize = (size_t)desiredWidth * (size_t)desiredHeight * (size_t)samples;
-		bytes = conversionBuffer->reserveAndGet( bufferDataSize );
-		const auto maybeSize = wsw::ui::rasterizeSvg( fileBufferBytes, fileSize, bytes, bufferDataSize, options );
+		uint8_t *const rasterizedBytes = conversionBuffer->reserveAndGet( bufferDataSize );
+		const auto maybeSize = wsw::ui::rasterizeSvg( fileBufferBytes, fileSize, rasterizedBytes, bufferDataSize, options );
 		if( !maybeSize ) {
 			return std::nullopt;
 		}
 		std::tie( width, height ) = *maybeSize;
 		imageDataSize = (size_t)width * (size_t)height * (size_t)samples;
 		assert( imageDataSize <= bufferDataSize );
+		bytes = rasterizedBytes;
 	} else {
-		bytes = stbi_load_from_memory( (const stbi_uc *)fileBufferBytes, (int)fileSize, &width, &height, &samples, 0 );
-		if( !bytes ) {
+		if( !( maybeDecodedImage = decodeImageFileData( fileBufferBytes, fileSize ) ) ) {
 			return std::nullopt;
 		}
-		assert( width > 0 && height > 0 && samples > 0 );
-		imageDataSize = (size_t)width * (size_t)height * (size_t)samples;
+		bytes = maybeDecodedImage->data();
+		width = maybeDecodedImage->props().width;
+		height = maybeDecodedImage->props().height;
+		samples = maybeDecodedImage->props().samples;
+		imageDataSize = maybeDecodedImage->dataSize();
 	}
 
 	assert( imageDataSize );
@@ -398,13 +433,6 @@ auto TextureFactory::loadTextureDataFromFile( const wsw::StringView &name,
 		std::memcpy( imageData, bytes, imageDataSize );
 	}
 
-	if( !isSvg ) {
-		// This is not that easy as we use stb in the UI code as well.
-		// TODO: Provide allocators for stb that use the loading buffer?
-		// TODO: Unify image loading code with the UI?
-		stbi_image_free( bytes );
-	}
-
 	return std::make_pair( imageData, BitmapProps { (uint16_t)width, (uint16_t)height, (uint16_t)samples } );
 }
 
@@ -488,14 +516,25 @@ auto TextureFactory::loadMaterialTexture( const wsw::HashedStringView &name, uns
 		return nullptr;
 	}
 
-	auto maybeFileData = loadTextureDataFromFile( name, &::readFileBuffer, &::loadingBuffer,
-												  &::conversionBuffer, ImageOptions {} );
-	if( !maybeFileData ) {
+	const uint8_t *fileBytes;
+	BitmapProps bitmapProps;
+	DecodedImage prefetchedImage;
+	// Use the data that has been read and decoded in background if the image was requested
+	const auto takeResult = m_loadingPipeline.take( name, &prefetchedImage );
+	if( takeResult == ImageLoadingPipeline::TakeResult::Taken ) {
+		fileBytes = prefetchedImage.data();
+		bitmapProps = prefetchedImage.props();
+	} else if( takeResult == ImageLoadingPipeline::TakeResult::Missing ) {
 		return nullptr;
+	} else {
+		auto maybeFileData = loadTextureDataFromFile( name, &::readFileBuffer, &::loadingBuffer,
+													  &::conversionBuffer, ImageOptions {} );
+		if( !maybeFileData ) {
+			return nullptr;
+		}
+		std::tie( fileBytes, bitmapProps ) = *maybeFileData;
 	}
 
-	auto [fileBytes, bitmapProps] = *maybeFileData;
-
 	qglPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
 
 	const GLuint handle = generateHandle( name );
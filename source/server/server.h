@@ -71,6 +71,7 @@ typedef struct server_s {
 	wsw::ConfigStringStorage configStrings;
 
 	entity_state_t baselines[MAX_EDICTS];
+	msg_quantization_t snapQuantization;    // entity positions are quantized relative to world bounds
 	int num_mv_clients;     // current number, <= sv_maxmvclients
 
 	//
@@ -87,6 +88,7 @@ typedef struct server_s {
 		configStrings.clear();
 
 		memset( &baselines, 0, sizeof( baselines ) );
+		memset( &snapQuantization, 0, sizeof( snapQuantization ) );
 		num_mv_clients = 0;
 		memset( &gi, 0, sizeof( gi ) );
 	}
@@ -138,6 +140,15 @@ typedef struct {
 
 #define HTTP_CLIENT_SESSION_SIZE 16
 
+typedef struct {
+	int64_t numSnaps;
+	int64_t totalBytes;             // of snapshot frames only (reliable commands are not counted)
+	int64_t totalDeferredEntities;
+	int maxBytes;
+	int lastBytes;
+	int lastDeferredEntities;
+} client_snap_stats_t;
+
 typedef struct client_s {
 	sv_client_state_t state;
 
@@ -148,6 +159,7 @@ typedef struct client_s {
 	bool reliable;                  // no need for acks, connection is reliable
 	bool mv;                        // send multiview data to the client
 	bool individual_socket;         // client has it's own socket that has to be checked separately
+	bool quantizedSnaps;            // the client accepts quantized entity positions (see sv_snap_quantization)
 
 	socket_t socket;
 
@@ -188,6 +200,10 @@ typedef struct client_s {
 
 	client_snapshot_t snapShots[UPDATE_BACKUP]; // updates can be delta'd from here
 
+	// accumulated transmission priorities of entities that have pending updates (see sv_snap_max_bytes)
+	float snapEntityPriorities[MAX_EDICTS];
+	client_snap_stats_t snapStats;
+
 	client_download_t download;
 
 	int challenge;                  // challenge of this user, randomly generated
@@ -342,6 +358,8 @@ extern cvar_t *sv_enforcetime;
 extern cvar_t *sv_showRcon;
 extern cvar_t *sv_showChallenge;
 extern cvar_t *sv_showInfoQueries;
+extern cvar_t *sv_oobRate;
+extern cvar_t *sv_oobBurst;
 extern cvar_t *sv_highchars;
 
 //wsw : jal
@@ -376,6 +394,10 @@ extern cvar_t *sv_snap_raycast_players_culling;
 // "fov" sounds more clear than "view dir" though its not very accurate
 extern cvar_t *sv_snap_aggressive_fov_culling;
 extern cvar_t *sv_snap_shadow_events_data;
+// A desired limit of a snapshot message size, low-priority entity updates get deferred to fit it (0 disables)
+extern cvar_t *sv_snap_max_bytes;
+// Allows sending quantized bit-packed entity positions and angles to clients that support it
+extern cvar_t *sv_snap_quantization;
 
 //===========================================================
 
@@ -405,6 +427,8 @@ void SV_UpdateActivity( void );
 // sv_oob.c
 //
 void SV_ConnectionlessPacket( const socket_t *socket, const netadr_t *address, msg_t *msg );
+void SV_OobStats_f( void );
+void SV_OobBenchmark_f( void );
 void SV_InitInfoServers( void );
 void SV_UpdateInfoServers( void );
 
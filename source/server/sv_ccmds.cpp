@@ -232,6 +232,40 @@ void SV_Status_f( void ) {
 	Com_Printf( "\n" );
 }
 
+/*
+* SV_SnapStats_f
+*/
+static void SV_SnapStats_f( void ) {
+	if( !svs.clients ) {
+		Com_Printf( "No server running.\n" );
+		return;
+	}
+
+	const bool reset = Cmd_Argc() == 2 && !Q_stricmp( Cmd_Argv( 1 ), "reset" );
+
+	Com_Printf( "snapshot byte budget: %i\n", sv_snap_max_bytes->integer );
+	Com_Printf( "num name              snaps avgbytes maxbytes lastbytes avgdeferred lastdeferred\n" );
+	Com_Printf( "--- --------------- ------- -------- -------- --------- ----------- ------------\n" );
+	for( int i = 0; i < sv_maxclients->integer; i++ ) {
+		client_t *cl = svs.clients + i;
+		if( cl->state < CS_SPAWNED ) {
+			continue;
+		}
+		if( cl->edict && ( cl->edict->r.svflags & SVF_FAKECLIENT ) ) {
+			continue;
+		}
+
+		client_snap_stats_t *stats = &cl->snapStats;
+		const double numSnaps = stats->numSnaps ? (double)stats->numSnaps : 1.0;
+		Com_Printf( "%3i %-15s %7" PRIi64 " %8.1f %8i %9i %11.2f %12i\n", i, COM_RemoveColorTokens( cl->name ),
+					stats->numSnaps, (double)stats->totalBytes / numSnaps, stats->maxBytes, stats->lastBytes,
+					(double)stats->totalDeferredEntities / numSnaps, stats->lastDeferredEntities );
+		if( reset ) {
+			memset( stats, 0, sizeof( *stats ) );
+		}
+	}
+}
+
 /*
 * SV_Heartbeat_f
 */
@@ -327,6 +361,7 @@ static void SV_CvarCheck_f( void ) {
 void SV_InitOperatorCommands( void ) {
 	Cmd_AddCommand( "heartbeat", SV_Heartbeat_f );
 	Cmd_AddCommand( "status", SV_Status_f );
+	Cmd_AddCommand( "snapstats", SV_SnapStats_f );
 	Cmd_AddCommand( "serverinfo", SV_Serverinfo_f );
 	Cmd_AddCommand( "dumpuser", SV_DumpUser_f );
 
@@ -344,6 +379,9 @@ void SV_InitOperatorCommands( void ) {
 
 	Cmd_AddCommand( "cvarcheck", SV_CvarCheck_f );
 
+	Cmd_AddCommand( "oobstats", SV_OobStats_f );
+	Cmd_AddCommand( "oobbench", SV_OobBenchmark_f );
+
 	Cmd_SetCompletionFunc( "map", SV_MapComplete_f );
 	Cmd_SetCompletionFunc( "devmap", SV_MapComplete_f );
 	Cmd_SetCompletionFunc( "gamemap", SV_MapComplete_f );
@@ -355,6 +393,7 @@ void SV_InitOperatorCommands( void ) {
 void SV_ShutdownOperatorCommands( void ) {
 	Cmd_RemoveCommand( "heartbeat" );
 	Cmd_RemoveCommand( "status" );
+	Cmd_RemoveCommand( "snapstats" );
 	Cmd_RemoveCommand( "serverinfo" );
 	Cmd_RemoveCommand( "dumpuser" );
 
@@ -371,4 +410,7 @@ void SV_ShutdownOperatorCommands( void ) {
 	Cmd_RemoveCommand( "purelist" );
 
 	Cmd_RemoveCommand( "cvarcheck" );
+
+	Cmd_RemoveCommand( "oobstats" );
+	Cmd_RemoveCommand( "oobbench" );
 }
@@ -48,6 +48,7 @@ void SV_ClientResetCommandBuffers( client_t *client ) {
 	// reset snapshots delta-compression
 	client->lastframe = -1;
 	client->lastSentFrameNum = 0;
+	memset( client->snapEntityPriorities, 0, sizeof( client->snapEntityPriorities ) );
 }
 
 void SV_ClientCloseDownload( client_t *client ) {
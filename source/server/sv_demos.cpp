@@ -20,6 +20,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "server.h"
 #include "sv_snap.h"
+#include "sv_demowriter.h"
 #include "../qcommon/demometadata.h"
 
 using wsw::operator""_asView;
@@ -29,7 +30,7 @@ using wsw::operator""_asView;
 /*
 * SV_Demo_WriteMessage
 *
-* Writes given message to the demofile
+* Enqueues given message for writing to the demofile by the background writer
 */
 static void SV_Demo_WriteMessage( msg_t *msg ) {
 	assert( svs.demo.file );
@@ -37,7 +38,7 @@ static void SV_Demo_WriteMessage( msg_t *msg ) {
 		return;
 	}
 
-	SNAP_RecordDemoMessage( svs.demo.file, msg, 0 );
+	DemoBackgroundWriter::instance()->enqueueMessage( msg );
 }
 
 /*
@@ -187,6 +188,9 @@ void SV_Demo_Start_f( void ) {
 	svs.demo.localtime = time( NULL );
 	SV_Demo_WriteStartMessages();
 
+	// Start messages are written synchronously, the background writer owns the file from now on
+	DemoBackgroundWriter::init( svs.demo.file );
+
 	// Clearing tables won't harm...
 	SnapVisTable::Instance()->Clear();
 	SnapShadowTable::Instance()->Clear();
@@ -208,6 +212,9 @@ static void SV_Demo_Stop( bool cancel, bool silent ) {
 		return;
 	}
 
+	// Wait for writing all enqueued messages
+	DemoBackgroundWriter::shutdown();
+
 	if( cancel ) {
 		Com_Printf( "Canceled server demo recording: %s\n", svs.demo.filename );
 	} else {
@@ -0,0 +1,131 @@
+#include "sv_demowriter.h"
+#include "../qcommon/profiler.h"
+#include "../qcommon/qthreads.h"
+#include "../qcommon/singletonholder.h"
+
+static SingletonHolder<DemoBackgroundWriter> demoWriterHolder;
+
+void DemoBackgroundWriter::init( int file ) {
+	demoWriterHolder.init( file );
+}
+
+void DemoBackgroundWriter::shutdown() {
+	demoWriterHolder.shutdown();
+}
+
+auto DemoBackgroundWriter::instance() -> DemoBackgroundWriter * {
+	return demoWriterHolder.instance();
+}
+
+DemoBackgroundWriter::DemoBackgroundWriter( int file )
+	: m_buffer( (uint8_t *)Q_malloc( kCapacity ) ), m_file( file ) {
+	// Never returns on failure
+	m_thread = QThread_Create( &DemoBackgroundWriter::threadFunc, this );
+}
+
+DemoBackgroundWriter::~DemoBackgroundWriter() {
+	// The thread is going to write all enqueued messages prior to termination
+	m_signaledForTermination.store( true, std::memory_order_release );
+	QThread_Join( m_thread );
+
+	if( m_numStalls ) {
+		Com_Printf( S_COLOR_YELLOW "The demo writer has stalled the server %u times\n", m_numStalls );
+	}
+	Com_DPrintf( "The demo writer peak queue size was %u bytes\n", (unsigned)m_peakQueuedBytes );
+
+	Q_free( m_buffer );
+}
+
+void DemoBackgroundWriter::copyToBuffer( uint64_t offset, const void *data, size_t size ) {
+	const size_t start = (size_t)( offset & ( kCapacity - 1 ) );
+	const size_t firstPartSize = wsw::min( size, kCapacity - start );
+	memcpy( m_buffer + start, data, firstPartSize );
+	memcpy( m_buffer, (const uint8_t *)data + firstPartSize, size - firstPartSize );
+}
+
+void DemoBackgroundWriter::copyFromBuffer( uint64_t offset, void *data, size_t size ) const {
+	const size_t start = (size_t)( offset & ( kCapacity - 1 ) );
+	const size_t firstPartSize = wsw::min( size, kCapacity - start );
+	memcpy( data, m_buffer + start, firstPartSize );
+	memcpy( (uint8_t *)data + firstPartSize, m_buffer, size - firstPartSize );
+}
+
+void DemoBackgroundWriter::enqueueMessage( const msg_t *msg ) {
+	const auto size = (uint32_t)msg->cursize;
+	if( !size ) {
+		return;
+	}
+
+	assert( size <= MAX_MSGLEN );
+	const uint64_t requiredSpace = sizeof( uint32_t ) + size;
+	// Only this thread modifies the write offset
+	const uint64_t writeOffset = m_writeOffset.load( std::memory_order_relaxed );
+	uint64_t readOffset = m_readOffset.load( std::memory_order_acquire );
+	if( writeOffset + requiredSpace - readOffset > kCapacity ) {
+		m_numStalls++;
+		do {
+			QThread_Yield();
+			readOffset = m_readOffset.load( std::memory_order_acquire );
+		} while( writeOffset + requiredSpace - readOffset > kCapacity );
+	}
+
+	copyToBuffer( writeOffset, &size, sizeof( uint32_t ) );
+	copyToBuffer( writeOffset + sizeof( uint32_t ), msg->data, size );
+	m_writeOffset.store( writeOffset + requiredSpace, std::memory_order_release );
+
+	m_peakQueuedBytes = wsw::max( m_peakQueuedBytes, writeOffset + requiredSpace - readOffset );
+}
+
+void *DemoBackgroundWriter::threadFunc( void *param ) {
+	( (DemoBackgroundWriter *)param )->runMessageLoop();
+	return nullptr;
+}
+
+void DemoBackgroundWriter::runMessageLoop() {
+	Prof_SetThreadName( "demo writer" );
+
+	for(;; ) {
+		if( !writeQueuedMessages() ) {
+			// Make sure we check the termination status after the last check for messages
+			if( m_signaledForTermination.load( std::memory_order_acquire ) ) {
+				// The producer does not write anything once the termination is requested
+				(void)writeQueuedMessages();
+				return;
+			}
+			Sys_Sleep( 4 );
+		}
+	}
+}
+
+bool DemoBackgroundWriter::writeQueuedMessages() {
+	// Only this thread modifies the read offset
+	uint64_t readOffset = m_readOffset.load( std::memory_order_relaxed );
+	const uint64_t writeOffset = m_writeOffset.load( std::memory_order_acquire );
+	if( readOffset == writeOffset ) {
+		return false;
+	}
+
+	alignas( 16 ) uint8_t msgBuffer[MAX_MSGLEN];
+	msg_t msg;
+	MSG_Init( &msg, msgBuffer, sizeof( msgBuffer ) );
+
+	do {
+		uint32_t size;
+		copyFromBuffer( readOffset, &size, sizeof( uint32_t ) );
+		assert( size <= MAX_MSGLEN );
+		copyFromBuffer( readOffset + sizeof( uint32_t ), msgBuffer, size );
+		msg.cursize = size;
+
+		// Compression (if any) happens here as well
+		{
+			WSW_PROFILER_SCOPE( "SNAP_RecordDemoMessage" );
+			SNAP_RecordDemoMessage( m_file, &msg, 0 );
+		}
+
+		readOffset += sizeof( uint32_t ) + size;
+		// Release the space as soon as possible
+		m_readOffset.store( readOffset, std::memory_order_release );
+	} while( readOffset != writeOffset );
+
+	return true;
+}
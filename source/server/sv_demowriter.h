@@ -0,0 +1,61 @@
+#ifndef WSW_78d8cb30_0ff2_4af6_ba7f_e094354a82c2_H
+#define WSW_78d8cb30_0ff2_4af6_ba7f_e094354a82c2_H
+
+#include "../qcommon/qcommon.h"
+
+#include <atomic>
+
+/**
+ * Writes serialized server demo messages to a file in a background thread.
+ * Messages are still built on the game thread (they depend on the game state)
+ * but writing (and possibly compressing) them is performed by the writer thread,
+ * so disk latency spikes do not stall the server frame.
+ * Messages are transferred via a single-producer/single-consumer lock-free ring buffer.
+ * @note The file must not be accessed by other code while a writer is active.
+ */
+class DemoBackgroundWriter {
+	template <typename> friend class SingletonHolder;
+
+	// Must be a power of two. Holds 64 messages of the maximal size which should be sufficient for any sane disk.
+	static constexpr size_t kCapacity = 64 * MAX_MSGLEN;
+	static_assert( !( kCapacity & ( kCapacity - 1 ) ) );
+
+	// Offsets grow monotonically and get wrapped only for addressing the buffer.
+	// Keep offsets that are modified by different threads on different cache lines.
+	alignas( 64 ) std::atomic<uint64_t> m_writeOffset { 0 };
+	alignas( 64 ) std::atomic<uint64_t> m_readOffset { 0 };
+	alignas( 64 ) std::atomic<bool> m_signaledForTermination { false };
+
+	uint8_t *const m_buffer;
+	struct qthread_s *m_thread { nullptr };
+	const int m_file;
+
+	// Producer-side stats
+	uint64_t m_peakQueuedBytes { 0 };
+	unsigned m_numStalls { 0 };
+
+	explicit DemoBackgroundWriter( int file );
+	~DemoBackgroundWriter();
+
+	void copyToBuffer( uint64_t offset, const void *data, size_t size );
+	void copyFromBuffer( uint64_t offset, void *data, size_t size ) const;
+
+	static void *threadFunc( void *param );
+	void runMessageLoop();
+	[[nodiscard]]
+	bool writeQueuedMessages();
+public:
+	static void init( int file );
+	static void shutdown();
+	[[nodiscard]]
+	static auto instance() -> DemoBackgroundWriter *;
+
+	/**
+	 * Enqueues the message for writing.
+	 * This call blocks only if the writer thread is so late that the ring buffer is exhausted,
+	 * as dropping messages would corrupt the delta-encoded demo.
+	 */
+	void enqueueMessage( const msg_t *msg );
+};
+
+#endif
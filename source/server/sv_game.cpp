@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "sv_mm.h"
 #include "../qcommon/compression.h"
 #include "../qcommon/loglines.h"
+#include "../qcommon/profiler.h"
 
 game_export_t *ge;
 
@@ -592,6 +593,10 @@ void SV_InitGameProgs( void ) {
 	import.MM_SendQuery = SV_MM_SendQuery;
 	import.MM_EnqueueReport = SV_MM_EnqueueReport;
 
+	import.Prof_IsEnabled = Prof_IsEnabled;
+	import.Prof_BeginScope = Prof_BeginScope;
+	import.Prof_EndScope = Prof_EndScope;
+
 	// clear module manifest string
 	assert( sizeof( manifest ) >= MAX_INFO_STRING );
 	memset( manifest, 0, sizeof( manifest ) );
@@ -226,6 +226,10 @@ static void SV_SpawnServer( const char *server, bool devmap ) {
 	unsigned checksum;
 	CM_LoadMap( svs.cms, tmp.data(), false, &checksum );
 
+	vec3_t worldMins, worldMaxs;
+	CM_InlineModelBounds( svs.cms, CM_InlineModel( svs.cms, 0 ), worldMins, worldMaxs );
+	MSG_SetupQuantization( &sv.snapQuantization, worldMins, worldMaxs );
+
 	(void)tmp.assignf( "%d", checksum );
 	sv.configStrings.setMapCheckSum( tmp.asView() );
 
@@ -21,6 +21,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "server.h"
 #include "sv_mm.h"
 #include "sv_snap.h"
+#include "../qcommon/profiler.h"
 
 static bool sv_initialized = false;
 
@@ -67,6 +68,8 @@ cvar_t *sv_showclamp;
 cvar_t *sv_showRcon;
 cvar_t *sv_showChallenge;
 cvar_t *sv_showInfoQueries;
+cvar_t *sv_oobRate;        // connectionless packets per second allowed from a single address
+cvar_t *sv_oobBurst;
 cvar_t *sv_highchars;
 
 cvar_t *sv_hostname;
@@ -100,6 +103,8 @@ cvar_t *sv_snap_aggressive_sound_culling;
 cvar_t *sv_snap_raycast_players_culling;
 cvar_t *sv_snap_aggressive_fov_culling;
 cvar_t *sv_snap_shadow_events_data;
+cvar_t *sv_snap_max_bytes;
+cvar_t *sv_snap_quantization;
 
 //============================================================================
 
@@ -499,6 +504,7 @@ static bool SV_RunGameFrame( int msec ) {
 			}
 			opened_sockets[open_ind] = NULL;
 
+			WSW_PROFILER_SCOPE( "NET_Sleep" );
 			NET_Sleep( sleeptime, opened_sockets );
 		}
 	}
@@ -524,7 +530,10 @@ static bool SV_RunGameFrame( int msec ) {
 			time_before_game = Sys_Milliseconds();
 		}
 
-		ge->RunFrame( moduleTime, svs.gametime );
+		{
+			WSW_PROFILER_SCOPE( "ge->RunFrame" );
+			ge->RunFrame( moduleTime, svs.gametime );
+		}
 
 		if( host_speeds->integer ) {
 			time_after_game = Sys_Milliseconds();
@@ -537,7 +546,10 @@ static bool SV_RunGameFrame( int msec ) {
 
 		// set up for sending a snapshot
 		sv.framenum++;
-		ge->SnapFrame();
+		{
+			WSW_PROFILER_SCOPE( "ge->SnapFrame" );
+			ge->SnapFrame();
+		}
 
 		// set time for next snapshot
 		extraSnapTime = (int)( svs.gametime - sv.nextSnapTime );
@@ -661,11 +673,16 @@ void SV_Frame( unsigned realmsec, unsigned gamemsec ) {
 	svs.realtime += realmsec;
 	svs.gametime += gamemsec;
 
+	Prof_BeginFrame();
+
 	// check timeouts
 	SV_CheckTimeouts();
 
 	// get packets from clients
-	SV_ReadPackets();
+	{
+		WSW_PROFILER_SCOPE( "SV_ReadPackets" );
+		SV_ReadPackets();
+	}
 
 	// apply latched userinfo changes
 	SV_CheckLatchedUserinfoChanges();
@@ -679,10 +696,16 @@ void SV_Frame( unsigned realmsec, unsigned gamemsec ) {
 		SnapShadowTable::Instance()->Clear();
 
 		// send messages back to the clients that had packets read this frame
-		SV_SendClientMessages();
+		{
+			WSW_PROFILER_SCOPE( "SV_SendClientMessages" );
+			SV_SendClientMessages();
+		}
 
 		// write snap to server demo file
-		SV_Demo_WriteSnap();
+		{
+			WSW_PROFILER_SCOPE( "SV_Demo_WriteSnap" );
+			SV_Demo_WriteSnap();
+		}
 
 		// run matchmaker stuff
 		SVStatsowFacade::Instance()->Frame();
@@ -693,6 +716,8 @@ void SV_Frame( unsigned realmsec, unsigned gamemsec ) {
 		// clear teleport flags, etc for next frame
 		ge->ClearSnap();
 	}
+
+	Prof_EndFrame();
 }
 
 //============================================================================
@@ -756,6 +781,10 @@ void SV_UserinfoChanged( client_t *client ) {
 	}
 	Q_strncpyz( client->name, val, sizeof( client->name ) );
 
+	// clients that are unaware of the quantized encoding just do not set it
+	val = Info_ValueForKey( client->userinfo, "cl_quantized_snaps" );
+	client->quantizedSnaps = val && atoi( val ) != 0;
+
 #ifndef RATEKILLED
 	// rate command
 	if( NET_IsLANAddress( &client->netchan.remoteAddress ) ) {
@@ -803,6 +832,8 @@ void SV_Init( void ) {
 
 	SV_InitOperatorCommands();
 
+	Prof_Init();
+
 	Cvar_Get( "sv_cheats", "0", CVAR_SERVERINFO | CVAR_LATCH );
 	Cvar_Get( "protocol", va( "%i", APP_PROTOCOL_VERSION ), CVAR_SERVERINFO | CVAR_NOSET );
 
@@ -835,6 +866,8 @@ void SV_Init( void ) {
 	sv_showRcon =           Cvar_Get( "sv_showRcon", "1", 0 );
 	sv_showChallenge =      Cvar_Get( "sv_showChallenge", "0", 0 );
 	sv_showInfoQueries =    Cvar_Get( "sv_showInfoQueries", "0", 0 );
+	sv_oobRate =            Cvar_Get( "sv_oobRate", "10", CVAR_ARCHIVE );
+	sv_oobBurst =           Cvar_Get( "sv_oobBurst", "20", CVAR_ARCHIVE );
 	sv_highchars =          Cvar_Get( "sv_highchars", "1", 0 );
 
 	sv_uploads_http =       Cvar_Get( "sv_uploads_http", "1", CVAR_READONLY );
@@ -935,6 +968,9 @@ void SV_Init( void ) {
 	sv_snap_raycast_players_culling = Cvar_Get( SNAP_VAR_USE_RAYCAST_CULLING, "1", CVAR_SERVERINFO | CVAR_ARCHIVE );
 	sv_snap_aggressive_fov_culling = Cvar_Get( SNAP_VAR_USE_VIEWDIR_CULLING, "0", CVAR_SERVERINFO | CVAR_ARCHIVE );
 	sv_snap_shadow_events_data = Cvar_Get( SNAP_VAR_SHADOW_EVENTS_DATA, "1", CVAR_SERVERINFO | CVAR_ARCHIVE );
+	// Off by default as clients see deferred entities stopping and then jumping (see SNAP_EmitBudgetedPacketEntities())
+	sv_snap_max_bytes = Cvar_Get( "sv_snap_max_bytes", "0", CVAR_ARCHIVE );
+	sv_snap_quantization = Cvar_Get( "sv_snap_quantization", "0", CVAR_ARCHIVE );
 
 	Com_Printf( "Game running at %i fps. Server transmit at %i pps\n", sv_fps->integer, sv_pps->integer );
 
@@ -974,6 +1010,8 @@ void SV_Shutdown( const char *finalmsg ) {
 	SVStatsowFacade::Shutdown();
 
 	SV_ShutdownOperatorCommands();
+
+	Prof_Shutdown();
 }
 
 void SV_SetupSnapTables( cmodel_state_t *cms ) {
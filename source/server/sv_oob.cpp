@@ -21,6 +21,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "server.h"
 #include "sv_mm.h"
 
+#include <cinttypes>
+#include <ctime>
+#include <iterator>
+
 typedef struct sv_infoserver_s {
 	netadr_t address;
 	bool steam;
@@ -365,6 +369,220 @@ static char *SV_ShortInfoString( void ) {
 	return string;
 }
 
+//==============================================================================
+//
+//CACHED INFO STRINGS
+//
+//==============================================================================
+
+// Building info strings involves dumping serverinfo cvars and formatting every client,
+// so the built strings are kept and reused by all queries until something they depend on changes.
+// Responses can't exceed a single packet anyway, so only a packet-sized prefix of a string is kept.
+typedef struct {
+	uint64_t clientsHash;
+	unsigned serverinfoRevision;
+	int spawncount;
+	bool isValid;
+	size_t length;
+	char data[MAX_PACKETLEN];
+	uint64_t numHits, numMisses;
+} sv_infostringcache_t;
+
+static sv_infostringcache_t sv_shortInfoCache;
+static sv_infostringcache_t sv_longInfoCache;
+static sv_infostringcache_t sv_statusInfoCache;
+
+/*
+* SV_HashInfoClients
+* Returns a fingerprint of everything in the clients list that info strings depend on
+*/
+static uint64_t SV_HashInfoClients( bool withScores ) {
+	// FNV-1a applied to whole values, it's only used for detecting changes
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	const auto mix = [&]( uint64_t value ) { hash = ( hash ^ value ) * 0x100000001b3ULL; };
+
+	mix( sv_maxclients->integer );
+	mix( SVStatsowFacade::Instance()->IsValid() );
+	for( int i = 0; i < sv_maxclients->integer; i++ ) {
+		const client_t *cl = &svs.clients[i];
+		if( cl->state < CS_CONNECTED ) {
+			continue;
+		}
+		mix( i );
+		mix( ( cl->edict->r.svflags & SVF_FAKECLIENT ) != 0 );
+		if( withScores ) {
+			mix( (uint32_t)cl->edict->r.client->m_frags );
+			mix( (uint32_t)cl->ping );
+			mix( (uint32_t)cl->edict->s.team );
+			for( const char *p = cl->name; *p; ++p ) {
+				mix( (uint8_t)*p );
+			}
+		}
+	}
+
+	return hash;
+}
+
+/*
+* SV_GetCachedInfoString
+* Returns an info string of the cache, rebuilding it if it's stale
+*/
+static const sv_infostringcache_t *SV_GetCachedInfoString( sv_infostringcache_t *cache, bool withScores,
+														   const char *( *buildFn )( void ) ) {
+	const uint64_t clientsHash = SV_HashInfoClients( withScores );
+	if( cache->isValid && cache->clientsHash == clientsHash &&
+		cache->serverinfoRevision == serverinfo_revision && cache->spawncount == svs.spawncount ) {
+		cache->numHits++;
+		return cache;
+	}
+
+	cache->numMisses++;
+	const char *string = buildFn();
+	cache->length = wsw::min( strlen( string ), sizeof( cache->data ) - 1 );
+	memcpy( cache->data, string, cache->length );
+	cache->data[cache->length] = '\0';
+	cache->clientsHash = clientsHash;
+	// Building may touch info cvars (e.g. by reading not yet registered ones), so save the revision afterwards
+	cache->serverinfoRevision = serverinfo_revision;
+	cache->spawncount = svs.spawncount;
+	cache->isValid = true;
+	return cache;
+}
+
+static const char *SV_BuildShortInfoString( void ) { return SV_ShortInfoString(); }
+static const char *SV_BuildLongInfoString( void ) { return SV_LongInfoString( false ); }
+static const char *SV_BuildStatusInfoString( void ) { return SV_LongInfoString( true ); }
+
+//==============================================================================
+//
+//CONNECTIONLESS PACKETS RATE LIMITING
+//
+//==============================================================================
+
+// A token bucket of a source address. Buckets are kept in a small set-associative table,
+// so a flood from many addresses can only evict buckets of the same set.
+typedef struct {
+	netadr_t address;
+	int64_t lastRefillAt;
+	float tokens;
+} sv_oobbucket_t;
+
+#define OOB_BUCKET_SETS     256
+#define OOB_BUCKET_SET_SIZE 4
+
+static sv_oobbucket_t sv_oobBuckets[OOB_BUCKET_SETS][OOB_BUCKET_SET_SIZE];
+
+// Responses are counted instead of being sent while a benchmark is running
+static struct {
+	bool active;
+	uint64_t numPackets;
+	uint64_t numBytes;
+} sv_oobSink;
+
+/*
+* SV_OobBucketSetForAddress
+*/
+static sv_oobbucket_t *SV_OobBucketSetForAddress( const netadr_t *address ) {
+	const uint8_t *ip;
+	size_t ipSize;
+	if( address->type == NA_IP6 ) {
+		ip = address->address.ipv6.ip;
+		ipSize = sizeof( address->address.ipv6.ip );
+	} else {
+		ip = address->address.ipv4.ip;
+		ipSize = sizeof( address->address.ipv4.ip );
+	}
+
+	uint32_t hash = 2166136261u;
+	for( size_t i = 0; i < ipSize; i++ ) {
+		hash = ( hash ^ ip[i] ) * 16777619u;
+	}
+
+	return sv_oobBuckets[( hash ^ ( hash >> 16 ) ) % OOB_BUCKET_SETS];
+}
+
+/*
+* SV_ConsumeOobToken
+* Returns false if the source address has exceeded its packets rate
+*/
+static bool SV_ConsumeOobToken( const netadr_t *address ) {
+	if( sv_oobRate->value <= 0 ) {
+		return true;
+	}
+	if( address->type != NA_IP && address->type != NA_IP6 ) {
+		return true;
+	}
+
+	const float burst = wsw::max( 1.0f, sv_oobBurst->value );
+	const int64_t now = Sys_Milliseconds();
+
+	sv_oobbucket_t *const set = SV_OobBucketSetForAddress( address );
+	sv_oobbucket_t *bucket = nullptr;
+	sv_oobbucket_t *victim = &set[0];
+	for( int i = 0; i < OOB_BUCKET_SET_SIZE; i++ ) {
+		if( set[i].address.type == address->type && NET_CompareBaseAddress( &set[i].address, address ) ) {
+			bucket = &set[i];
+			break;
+		}
+		if( set[i].address.type == NA_NOTRANSMIT ) {
+			victim = &set[i];
+		} else if( victim->address.type != NA_NOTRANSMIT && set[i].lastRefillAt < victim->lastRefillAt ) {
+			victim = &set[i];
+		}
+	}
+
+	if( !bucket ) {
+		bucket = victim;
+		bucket->address = *address;
+		bucket->lastRefillAt = now;
+		bucket->tokens = burst;
+	} else if( now > bucket->lastRefillAt ) {
+		const float refilled = bucket->tokens + 0.001f * (float)( now - bucket->lastRefillAt ) * sv_oobRate->value;
+		bucket->tokens = wsw::min( burst, refilled );
+		bucket->lastRefillAt = now;
+	}
+
+	if( bucket->tokens < 1.0f ) {
+		return false;
+	}
+
+	bucket->tokens -= 1.0f;
+	return true;
+}
+
+/*
+* SV_OutOfBand
+*/
+static void SV_OutOfBand( const socket_t *socket, const netadr_t *address, const char *data, size_t length ) {
+	if( sv_oobSink.active ) {
+		sv_oobSink.numPackets++;
+		sv_oobSink.numBytes += length;
+	} else {
+		Netchan_OutOfBand( socket, address, length, (const uint8_t *)data );
+	}
+}
+
+/*
+* SV_OutOfBandPrint
+*/
+#ifndef _MSC_VER
+static void SV_OutOfBandPrint( const socket_t *socket, const netadr_t *address, const char *format, ... )
+	__attribute__( ( format( printf, 3, 4 ) ) );
+#else
+static void SV_OutOfBandPrint( const socket_t *socket, const netadr_t *address, _Printf_format_string_ const char *format, ... );
+#endif
+static void SV_OutOfBandPrint( const socket_t *socket, const netadr_t *address, const char *format, ... ) {
+	va_list argptr;
+	char string[MAX_PACKETLEN - 4];
+
+	va_start( argptr, format );
+	Q_vsnprintfz( string, sizeof( string ), format, argptr );
+	va_end( argptr );
+
+	SV_OutOfBand( socket, address, string, strlen( string ) );
+}
+
+
 
 
 //==============================================================================
@@ -387,7 +605,7 @@ static void SVC_Ack( const socket_t *socket, const netadr_t *address ) {
 */
 static void SVC_Ping( const socket_t *socket, const netadr_t *address ) {
 	// send any arguments back with ack
-	Netchan_OutOfBandPrint( socket, address, "ack %s", Cmd_Args() );
+	SV_OutOfBandPrint( socket, address, "ack %s", Cmd_Args() );
 }
 
 /*
@@ -398,7 +616,6 @@ static void SVC_Ping( const socket_t *socket, const netadr_t *address ) {
 */
 static void SVC_InfoResponse( const socket_t *socket, const netadr_t *address ) {
 	int i, count;
-	char *string;
 	bool allow_empty = false, allow_full = false;
 
 	if( sv_showInfoQueries->integer ) {
@@ -452,17 +669,17 @@ static void SVC_InfoResponse( const socket_t *socket, const netadr_t *address )
 		return;
 	}
 
-	string = SV_ShortInfoString();
-	if( string ) {
-		Netchan_OutOfBandPrint( socket, address, "info\n%s", string );
-	}
+	const sv_infostringcache_t *cache = SV_GetCachedInfoString( &sv_shortInfoCache, false, SV_BuildShortInfoString );
+	SV_OutOfBandPrint( socket, address, "info\n%s", cache->data );
 }
 
 /*
 * SVC_SendInfoString
 */
 static void SVC_SendInfoString( const socket_t *socket, const netadr_t *address, const char *requestType, const char *responseType, bool fullStatus ) {
-	char *string;
+	const sv_infostringcache_t *cache;
+	char response[MAX_PACKETLEN - 4];
+	size_t length;
 
 	if( sv_showInfoQueries->integer ) {
 		Com_Printf( "%s Packet %s\n", requestType, NET_AddressToString( address ) );
@@ -485,10 +702,24 @@ static void SVC_SendInfoString( const socket_t *socket, const netadr_t *address,
 	//	return;
 
 	// send the same string that we would give for a status OOB command
-	string = SV_LongInfoString( fullStatus );
-	if( string ) {
-		Netchan_OutOfBandPrint( socket, address, "%s\n\\challenge\\%s%s", responseType, Cmd_Argv( 1 ), string );
+	if( fullStatus ) {
+		cache = SV_GetCachedInfoString( &sv_statusInfoCache, true, SV_BuildStatusInfoString );
+	} else {
+		cache = SV_GetCachedInfoString( &sv_longInfoCache, false, SV_BuildLongInfoString );
+	}
+
+	// only the challenge differs between responses, so just prepend it to the cached string
+	Q_snprintfz( response, sizeof( response ), "%s\n\\challenge\\%s", responseType, Cmd_Argv( 1 ) );
+	length = strlen( response );
+	if( length + cache->length >= sizeof( response ) ) {
+		memcpy( response + length, cache->data, sizeof( response ) - length - 1 );
+		length = sizeof( response ) - 1;
+	} else {
+		memcpy( response + length, cache->data, cache->length );
+		length += cache->length;
 	}
+
+	SV_OutOfBand( socket, address, response, length );
 }
 
 /*
@@ -546,7 +777,7 @@ static void SVC_GetChallenge( const socket_t *socket, const netadr_t *address )
 		i = oldest;
 	}
 
-	Netchan_OutOfBandPrint( socket, address, "challenge %i", svs.challenges[i].challenge );
+	SV_OutOfBandPrint( socket, address, "challenge %i", svs.challenges[i].challenge );
 }
 
 
@@ -570,10 +801,10 @@ static void SVC_DirectConnect( const socket_t *socket, const netadr_t *address )
 	version = atoi( Cmd_Argv( 1 ) );
 	if( version != APP_PROTOCOL_VERSION ) {
 		if( version <= 6 ) { // before reject packet was added
-			Netchan_OutOfBandPrint( socket, address, "print\nServer is version %4.2f. Protocol %3i\n",
+			SV_OutOfBandPrint( socket, address, "print\nServer is version %4.2f. Protocol %3i\n",
 									APP_VERSION, APP_PROTOCOL_VERSION );
 		} else {
-			Netchan_OutOfBandPrint( socket, address,
+			SV_OutOfBandPrint( socket, address,
 									"reject\n%i\n%i\nServer and client don't have the same version\n", DROP_TYPE_GENERAL, 0 );
 		}
 		Com_DPrintf( "    rejected connect from protocol %i\n", version );
@@ -584,7 +815,7 @@ static void SVC_DirectConnect( const socket_t *socket, const netadr_t *address )
 	challenge = atoi( Cmd_Argv( 3 ) );
 
 	if( !Info_Validate( Cmd_Argv( 4 ) ) ) {
-		Netchan_OutOfBandPrint( socket, address, "reject\n%i\n%i\nInvalid userinfo string\n", DROP_TYPE_GENERAL, 0 );
+		SV_OutOfBandPrint( socket, address, "reject\n%i\n%i\nInvalid userinfo string\n", DROP_TYPE_GENERAL, 0 );
 		Com_DPrintf( "Connection from %s refused: invalid userinfo string\n", NET_AddressToString( address ) );
 		return;
 	}
@@ -593,13 +824,13 @@ static void SVC_DirectConnect( const socket_t *socket, const netadr_t *address )
 
 	// force the IP key/value pair so the game can filter based on ip
 	if( !Info_SetValueForKey( userinfo, "socket", NET_SocketTypeToString( socket->type ) ) ) {
-		Netchan_OutOfBandPrint( socket, address, "reject\n%i\n%i\nError: Couldn't set userinfo (socket)\n",
+		SV_OutOfBandPrint( socket, address, "reject\n%i\n%i\nError: Couldn't set userinfo (socket)\n",
 								DROP_TYPE_GENERAL, 0 );
 		Com_DPrintf( "Connection from %s refused: couldn't set userinfo (socket)\n", NET_AddressToString( address ) );
 		return;
 	}
 	if( !Info_SetValueForKey( userinfo, "ip", NET_AddressToString( address ) ) ) {
-		Netchan_OutOfBandPrint( socket, address, "reject\n%i\n%i\nError: Couldn't set userinfo (ip)\n",
+		SV_OutOfBandPrint( socket, address, "reject\n%i\n%i\nError: Couldn't set userinfo (ip)\n",
 								DROP_TYPE_GENERAL, 0 );
 		Com_DPrintf( "Connection from %s refused: couldn't set userinfo (ip)\n", NET_AddressToString( address ) );
 		return;
@@ -649,13 +880,13 @@ static void SVC_DirectConnect( const socket_t *socket, const netadr_t *address )
 				NET_InitAddress( &svs.challenges[i].adr, NA_NOTRANSMIT );
 				break; // good
 			}
-			Netchan_OutOfBandPrint( socket, address, "reject\n%i\n%i\nBad challenge\n",
+			SV_OutOfBandPrint( socket, address, "reject\n%i\n%i\nBad challenge\n",
 									DROP_TYPE_GENERAL, DROP_FLAG_AUTORECONNECT );
 			return;
 		}
 	}
 	if( i == MAX_CHALLENGES ) {
-		Netchan_OutOfBandPrint( socket, address, "reject\n%i\n%i\nNo challenge for address\n",
+		SV_OutOfBandPrint( socket, address, "reject\n%i\n%i\nNo challenge for address\n",
 								DROP_TYPE_GENERAL, DROP_FLAG_AUTORECONNECT );
 		return;
 	}
@@ -678,7 +909,7 @@ static void SVC_DirectConnect( const socket_t *socket, const netadr_t *address )
 		}
 
 		if( previousclients >= sv_iplimit->integer * 2 ) {
-			Netchan_OutOfBandPrint( socket, address, "reject\n%i\n%i\nToo many connections from your host\n", DROP_TYPE_GENERAL,
+			SV_OutOfBandPrint( socket, address, "reject\n%i\n%i\nToo many connections from your host\n", DROP_TYPE_GENERAL,
 									DROP_FLAG_AUTORECONNECT );
 			Com_DPrintf( "%s:connect rejected : too many connections\n", NET_AddressToString( address ) );
 			return;
@@ -719,7 +950,7 @@ static void SVC_DirectConnect( const socket_t *socket, const netadr_t *address )
 			}
 		}
 		if( !newcl ) {
-			Netchan_OutOfBandPrint( socket, address, "reject\n%i\n%i\nServer is full\n", DROP_TYPE_GENERAL,
+			SV_OutOfBandPrint( socket, address, "reject\n%i\n%i\nServer is full\n", DROP_TYPE_GENERAL,
 									DROP_FLAG_AUTORECONNECT );
 			Com_DPrintf( "Server is full. Rejected a connection.\n" );
 			return;
@@ -749,14 +980,14 @@ static void SVC_DirectConnect( const socket_t *socket, const netadr_t *address )
 			rejmsg = "Game module rejected connection";
 		}
 
-		Netchan_OutOfBandPrint( socket, address, "reject\n%s\n%s\n", rejtypeflag, rejmsg );
+		SV_OutOfBandPrint( socket, address, "reject\n%s\n%s\n", rejtypeflag, rejmsg );
 
 		Com_DPrintf( "Game rejected a connection.\n" );
 		return;
 	}
 
 	// send the connect packet to the client
-	Netchan_OutOfBandPrint( socket, address, "client_connect\n%s", newcl->session );
+	SV_OutOfBandPrint( socket, address, "client_connect\n%s", newcl->session );
 
 	// free the incoming entry
 #ifdef TCP_ALLOW_CONNECT
@@ -919,6 +1150,8 @@ static void SV_GetSteamTags( char *tags ) {
 typedef struct {
 	const char *name;
 	void ( *func )( const socket_t *socket, const netadr_t *address );
+	uint64_t numAccepted;
+	uint64_t numDropped;
 } connectionless_cmd_t;
 
 connectionless_cmd_t connectionless_cmds[] =
@@ -933,6 +1166,7 @@ connectionless_cmd_t connectionless_cmds[] =
 	{ "rcon", SVC_RemoteCommand },
 	//{ "cmd", SV_MMC_Cmd },
 
+	// also holds counters of unknown commands
 	{ NULL, NULL }
 };
 
@@ -960,10 +1194,138 @@ void SV_ConnectionlessPacket( const socket_t *socket, const netadr_t *address, m
 
 	for( cmd = connectionless_cmds; cmd->name; cmd++ ) {
 		if( !strcmp( c, cmd->name ) ) {
-			cmd->func( socket, address );
-			return;
+			break;
 		}
 	}
 
+	// all commands share the same bucket, so a flood of cheap ones can't open the way for expensive ones
+	if( !SV_ConsumeOobToken( address ) ) {
+		cmd->numDropped++;
+		return;
+	}
+
+	cmd->numAccepted++;
+	if( cmd->func ) {
+		cmd->func( socket, address );
+		return;
+	}
+
 	Com_DPrintf( "Bad connectionless packet from %s:\n%s\n", NET_AddressToString( address ), s );
 }
+
+/*
+* SV_OobStats_f
+* Prints counters of connectionless packets and info strings caching
+*/
+void SV_OobStats_f( void ) {
+	connectionless_cmd_t *cmd;
+
+	Com_Printf( "%-14s %12s %12s\n", "command", "accepted", "dropped" );
+	for( cmd = connectionless_cmds;; cmd++ ) {
+		Com_Printf( "%-14s %12" PRIu64 " %12" PRIu64 "\n", cmd->name ? cmd->name : "(unknown)", cmd->numAccepted, cmd->numDropped );
+		if( !cmd->name ) {
+			break;
+		}
+	}
+
+	Com_Printf( "%-14s %12s %12s\n", "info string", "hits", "misses" );
+	Com_Printf( "%-14s %12" PRIu64 " %12" PRIu64 "\n", "short", sv_shortInfoCache.numHits, sv_shortInfoCache.numMisses );
+	Com_Printf( "%-14s %12" PRIu64 " %12" PRIu64 "\n", "info", sv_longInfoCache.numHits, sv_longInfoCache.numMisses );
+	Com_Printf( "%-14s %12" PRIu64 " %12" PRIu64 "\n", "status", sv_statusInfoCache.numHits, sv_statusInfoCache.numMisses );
+
+	if( Cmd_Argc() > 1 && !Q_stricmp( Cmd_Argv( 1 ), "reset" ) ) {
+		for( cmd = connectionless_cmds;; cmd++ ) {
+			cmd->numAccepted = cmd->numDropped = 0;
+			if( !cmd->name ) {
+				break;
+			}
+		}
+		for( sv_infostringcache_t *cache: { &sv_shortInfoCache, &sv_longInfoCache, &sv_statusInfoCache } ) {
+			cache->numHits = cache->numMisses = 0;
+		}
+		Com_Printf( "The counters have been reset\n" );
+	}
+}
+
+/*
+* SV_OobBenchmarkRun
+* Feeds synthetic packets from the given number of LAN sources and returns the number of responses
+*/
+static uint64_t SV_OobBenchmarkRun( const char *line, int numPackets, int numSources, bool useCache,
+									uint64_t *wallMicros, double *cpuMillis ) {
+	uint8_t packetData[MAX_PACKETLEN];
+	msg_t packet;
+	netadr_t address;
+
+	MSG_Init( &packet, packetData, sizeof( packetData ) );
+	MSG_WriteInt32( &packet, -1 );
+	MSG_WriteData( &packet, line, strlen( line ) );
+
+	NET_InitAddress( &address, NA_IP );
+	address.address.ipv4.ip[0] = 192;
+	address.address.ipv4.ip[1] = 168;
+
+	sv_oobSink.numPackets = 0;
+	sv_oobSink.numBytes = 0;
+
+	const uint64_t startMicros = Sys_Microseconds();
+	const std::clock_t startClock = std::clock();
+	for( int i = 0; i < numPackets; i++ ) {
+		if( !useCache ) {
+			sv_shortInfoCache.isValid = sv_longInfoCache.isValid = sv_statusInfoCache.isValid = false;
+		}
+		const int source = i % numSources;
+		address.address.ipv4.ip[2] = (uint8_t)( source >> 8 );
+		address.address.ipv4.ip[3] = (uint8_t)( source & 255 );
+		SV_ConnectionlessPacket( &svs.socket_udp, &address, &packet );
+	}
+	*cpuMillis = 1000.0 * (double)( std::clock() - startClock ) / (double)CLOCKS_PER_SEC;
+	*wallMicros = Sys_Microseconds() - startMicros;
+
+	return sv_oobSink.numPackets;
+}
+
+/*
+* SV_OobBenchmark_f
+* Measures the throughput of connectionless packets handling (responses are not sent)
+*/
+void SV_OobBenchmark_f( void ) {
+	static const char *lines[] = { "getinfo 12345", "getstatus 12345", "getchallenge", "ping" };
+
+	if( sv.state != ss_game ) {
+		Com_Printf( "The benchmark requires a running game server\n" );
+		return;
+	}
+
+	const int numPackets = Cmd_Argc() > 1 ? wsw::max( 1, atoi( Cmd_Argv( 1 ) ) ) : 20000;
+	const int numSources = Cmd_Argc() > 2 ? wsw::clamp( atoi( Cmd_Argv( 2 ) ), 1, 65536 ) : 1000;
+
+	// the benchmark should not affect the real server state
+	auto *const savedChallenges = new challenge_t[MAX_CHALLENGES];
+	memcpy( savedChallenges, svs.challenges, sizeof( challenge_t ) * MAX_CHALLENGES );
+	auto *const savedCmds = new connectionless_cmd_t[std::size( connectionless_cmds )];
+	std::copy( std::begin( connectionless_cmds ), std::end( connectionless_cmds ), savedCmds );
+	sv_oobSink.active = true;
+
+	Com_Printf( "Feeding %d packets from %d sources (rate %.1f, burst %.1f)\n",
+				numPackets, numSources, sv_oobRate->value, sv_oobBurst->value );
+	for( const char *line: lines ) {
+		for( const bool useCache: { false, true } ) {
+			memset( sv_oobBuckets, 0, sizeof( sv_oobBuckets ) );
+			uint64_t wallMicros = 0;
+			double cpuMillis = 0.0;
+			const uint64_t numResponses = SV_OobBenchmarkRun( line, numPackets, numSources, useCache, &wallMicros, &cpuMillis );
+			const double seconds = wsw::max( 1e-6, 1e-6 * (double)wallMicros );
+			Com_Printf( "%-16s %-8s: %8" PRIu64 " responses, %10.0f responses/s, %8.3f us/packet, %8.1f ms cpu\n",
+						line, useCache ? "cached" : "uncached", numResponses, (double)numResponses / seconds,
+						(double)wallMicros / (double)numPackets, cpuMillis );
+		}
+	}
+
+	sv_oobSink.active = false;
+	std::copy( savedCmds, savedCmds + std::size( connectionless_cmds ), std::begin( connectionless_cmds ) );
+	delete[] savedCmds;
+	memcpy( svs.challenges, savedChallenges, sizeof( challenge_t ) * MAX_CHALLENGES );
+	delete[] savedChallenges;
+	memset( sv_oobBuckets, 0, sizeof( sv_oobBuckets ) );
+}
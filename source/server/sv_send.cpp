@@ -420,8 +420,16 @@ void SV_ResetClientFrameCounters( void ) {
 * SV_WriteFrameSnapToClient
 */
 void SV_WriteFrameSnapToClient( client_t *client, msg_t *msg ) {
+	// Demos must be complete, so updates of entities are never deferred for the demo client
+	const bool isDemoClient = client == &svs.demo.client;
+	const int maxSnapBytes = isDemoClient ? 0 : sv_snap_max_bytes->integer;
+	// Demos keep the full precision as well
+	const msg_quantization_t *quantization = nullptr;
+	if( !isDemoClient && client->quantizedSnaps && sv_snap_quantization->integer ) {
+		quantization = &sv.snapQuantization;
+	}
 	SNAP_WriteFrameSnapToClient( &sv.gi, client, msg, sv.framenum, svs.gametime, sv.baselines,
-								 &svs.client_entities, 0, NULL, NULL );
+								 &svs.client_entities, 0, NULL, NULL, maxSnapBytes, quantization );
 }
 
 /*
@@ -22,16 +22,21 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "sv_snap.h"
 
 #include "../gameshared/gs_public.h"
+#include "../qcommon/framearena.h"
+
+#include <algorithm>
+#include <vector>
 
 static inline void SNAP_WriteDeltaEntity( msg_t *msg, const entity_state_t *from, const entity_state_t *to,
-										  const client_snapshot_t *frame, bool force ) {
+										  const client_snapshot_t *frame, bool force,
+										  const msg_quantization_t *quantization ) {
 	if( !to ) {
-		MSG_WriteDeltaEntity( msg, from, to, force );
+		MSG_WriteDeltaEntity( msg, from, to, force, quantization );
 		return;
 	}
 
 	if( !SnapShadowTable::Instance()->IsEntityShadowed( frame->ps->playerNum, to->number ) ) {
-		MSG_WriteDeltaEntity( msg, from, to, force );
+		MSG_WriteDeltaEntity( msg, from, to, force, quantization );
 		return;
 	}
 
@@ -44,7 +49,7 @@ static inline void SNAP_WriteDeltaEntity( msg_t *msg, const entity_state_t *from
 		( (float *)( to->angles ) )[i] = -180.0f + 360.0f * random();
 	}
 
-	MSG_WriteDeltaEntity( msg, from, to, force );
+	MSG_WriteDeltaEntity( msg, from, to, force, quantization );
 
 	Vector2Copy( backupAngles, (float *)( to->angles ) );
 }
@@ -64,7 +69,8 @@ Encode a client frame onto the network channel
 */
 static void SNAP_EmitPacketEntities( const client_snapshot_t *from, const client_snapshot_t *to,
 								     msg_t *msg, const entity_state_t *baselines,
-								     const entity_state_t *client_entities, int num_client_entities ) {
+								     const entity_state_t *client_entities, int num_client_entities,
+								     const msg_quantization_t *quantization ) {
 	MSG_WriteUint8( msg, svc_packetentities );
 
 	const int from_num_entities = !from ? 0 : from->num_entities;
@@ -92,7 +98,7 @@ static void SNAP_EmitPacketEntities( const client_snapshot_t *from, const client
 			// in any bytes being emited if the entity has not changed at all
 			// note that players are always 'newentities', this updates their oldorigin always
 			// and prevents warping ( wsw : jal : I removed it from the players )
-			SNAP_WriteDeltaEntity( msg, oldent, newent, to, false );
+			SNAP_WriteDeltaEntity( msg, oldent, newent, to, false, quantization );
 			oldindex++;
 			newindex++;
 			continue;
@@ -100,20 +106,243 @@ static void SNAP_EmitPacketEntities( const client_snapshot_t *from, const client
 
 		if( newnum < oldnum ) {
 			// this is a new entity, send it from the baseline
-			SNAP_WriteDeltaEntity( msg, &baselines[newnum], newent, to, true );
+			SNAP_WriteDeltaEntity( msg, &baselines[newnum], newent, to, true, quantization );
 			newindex++;
 			continue;
 		}
 
 		if( newnum > oldnum ) {
 			// the old entity isn't present in the new message
-			SNAP_WriteDeltaEntity( msg, oldent, nullptr, to, false );
+			SNAP_WriteDeltaEntity( msg, oldent, nullptr, to, false, quantization );
+			oldindex++;
+			continue;
+		}
+	}
+
+	MSG_WriteInt16( msg, 0 ); // end of packetentities
+}
+
+/*
+=========================================================================
+
+Fit entity updates into a byte budget
+
+Every changed or new entity accumulates a transmission priority that depends
+on its kind and on the distance to the viewer. Updates are written in order of
+priority while they fit the budget, remaining ones are deferred to next snapshots
+(their accumulated priority keeps growing, so they eventually get transmitted).
+A deferred update of an entity known by the client keeps the last transmitted state
+in the frame, so further deltas from this frame remain valid.
+A deferred new entity is excluded from the frame.
+
+=========================================================================
+*/
+
+typedef struct {
+	const entity_state_t *oldState;     // a baseline for new entities
+	entity_state_t *newState;           // null for removed entities
+	float priority;
+	bool isNew;
+	bool isDeferred;
+	int dataOffset;                     // into the scratch buffer
+	int dataSize;
+} snap_entity_update_t;
+
+static bool deferredNewSnapEntities[MAX_EDICTS];
+
+// Should be large enough for any single entity update
+#define MAX_SNAP_ENTITY_UPDATE_BYTES 1024
+
+/*
+* SNAP_IsMandatoryEntityUpdate
+*
+* Updates of these entities are never deferred
+*/
+static bool SNAP_IsMandatoryEntityUpdate( const entity_state_t *state, const client_snapshot_t *frame ) {
+	const player_state_t *ps = &frame->ps[0];
+	if( state->number == (int)ps->playerNum + 1 || state->number == (int)ps->POVnum ) {
+		return true;
+	}
+	// Events would be lost otherwise
+	if( ISEVENTENTITY( state ) || state->events[0] || state->events[1] || state->teleported ) {
+		return true;
+	}
+	// Shadowed entities are always considered changed
+	return SnapShadowTable::Instance()->IsEntityShadowed( ps->playerNum, state->number );
+}
+
+/*
+* SNAP_EntityPriorityIncrement
+*/
+static float SNAP_EntityPriorityIncrement( const entity_state_t *state, const vec3_t viewOrigin ) {
+	float relevance = 1.0f;
+	if( state->type == ET_PLAYER ) {
+		relevance = 4.0f;
+	} else if( state->svflags & SVF_PROJECTILE ) {
+		relevance = 2.0f;
+	}
+
+	// Halve the increment every 512 units of distance
+	return relevance / ( 1.0f + DistanceFast( state->origin, viewOrigin ) * ( 1.0f / 512.0f ) );
+}
+
+/*
+* SNAP_EmitBudgetedPacketEntities
+*
+* Writes a delta update of an entity_state_t list to the message, deferring low-priority updates
+* that do not fit the byte budget. The frame is modified according to what has been really sent.
+* Returns the number of deferred entity updates.
+* Note: a deferred entity keeps the last state known to the client, so the client sees it standing still
+* and then snapping to the actual position once the update gets sent. A budget close to FRAGMENT_SIZE
+* should be used only if this is preferable to fragmentation of snapshots (e.g. for lossy connections).
+*/
+static int SNAP_EmitBudgetedPacketEntities( const client_snapshot_t *from, client_snapshot_t *to,
+											msg_t *msg, const entity_state_t *baselines,
+											entity_state_t *client_entities, int num_client_entities,
+											client_t *client, int byteBudget, const msg_quantization_t *quantization ) {
+	MSG_WriteUint8( msg, svc_packetentities );
+
+	const int from_num_entities = !from ? 0 : from->num_entities;
+
+	// Scratch buffers are released upon return, so they get reused by every client
+	wsw::FrameArena *const arena = wsw::FrameArena::instance();
+	wsw::FrameArena::ScopedRewind scratchRewind( arena );
+
+	const int maxUpdates = to->num_entities + from_num_entities;
+	auto *const snapEntityUpdates = arena->allocArray<snap_entity_update_t>( maxUpdates );
+	auto *const snapEntityUpdatesData = arena->allocArray<uint8_t>( MAX_MSGLEN );
+
+	// Match entities of frames (this loop is the same as in SNAP_EmitPacketEntities)
+	int numUpdates = 0;
+	int newindex = 0;
+	int oldindex = 0;
+	while( newindex < to->num_entities || oldindex < from_num_entities ) {
+		int newnum = 9999;
+		entity_state_t *newent = nullptr;
+		if( newindex < to->num_entities ) {
+			newent = &client_entities[( to->first_entity + newindex ) % num_client_entities];
+			newnum = newent->number;
+		}
+
+		int oldnum = 9999;
+		const entity_state_t *oldent = nullptr;
+		if( oldindex < from_num_entities ) {
+			oldent = &client_entities[( from->first_entity + oldindex ) % num_client_entities];
+			oldnum = oldent->number;
+		}
+
+		snap_entity_update_t *update = &snapEntityUpdates[numUpdates++];
+		update->priority = 0.0f;
+		update->isDeferred = false;
+		update->dataOffset = 0;
+		update->dataSize = 0;
+		if( newnum == oldnum ) {
+			update->oldState = oldent;
+			update->newState = newent;
+			update->isNew = false;
 			oldindex++;
+			newindex++;
+		} else if( newnum < oldnum ) {
+			update->oldState = &baselines[newnum];
+			update->newState = newent;
+			update->isNew = true;
+			newindex++;
+		} else {
+			update->oldState = oldent;
+			update->newState = nullptr;
+			update->isNew = false;
+			oldindex++;
+		}
+	}
+
+	vec3_t viewOrigin;
+	VectorCopy( to->ps[0].pmove.origin, viewOrigin );
+	viewOrigin[2] += to->ps[0].viewheight;
+
+	msg_t data;
+	MSG_Init( &data, snapEntityUpdatesData, MAX_MSGLEN );
+
+	// Write mandatory updates first, collect deferrable ones
+	using UpdatePtrAllocator = wsw::FrameArenaAllocator<snap_entity_update_t *>;
+	std::vector<snap_entity_update_t *, UpdatePtrAllocator> deferrableUpdates { UpdatePtrAllocator( arena ) };
+	deferrableUpdates.reserve( maxUpdates );
+	float *const priorities = client->snapEntityPriorities;
+	for( int i = 0; i < numUpdates; ++i ) {
+		snap_entity_update_t *update = &snapEntityUpdates[i];
+		if( update->newState && !SNAP_IsMandatoryEntityUpdate( update->newState, to ) ) {
+			float *const priority = &priorities[update->newState->number];
+			*priority += SNAP_EntityPriorityIncrement( update->newState, viewOrigin );
+			update->priority = *priority;
+			deferrableUpdates.push_back( update );
 			continue;
 		}
+		update->dataOffset = (int)data.cursize;
+		SNAP_WriteDeltaEntity( &data, update->oldState, update->newState, to, update->isNew, quantization );
+		update->dataSize = (int)data.cursize - update->dataOffset;
+	}
+
+	std::sort( deferrableUpdates.begin(), deferrableUpdates.end(),
+			   []( const snap_entity_update_t *lhs, const snap_entity_update_t *rhs ) {
+		return lhs->priority > rhs->priority;
+	});
+
+	// Always account the end of packet entities
+	int remainingBytes = byteBudget - (int)msg->cursize - (int)data.cursize - 2;
+	int numDeferredUpdates = 0;
+	for( snap_entity_update_t *update: deferrableUpdates ) {
+		// Updates still have to be written to check whether there are changes at all
+		if( data.cursize + MAX_SNAP_ENTITY_UPDATE_BYTES <= data.maxsize ) {
+			update->dataOffset = (int)data.cursize;
+			SNAP_WriteDeltaEntity( &data, update->oldState, update->newState, to, update->isNew, quantization );
+			update->dataSize = (int)data.cursize - update->dataOffset;
+			if( update->dataSize <= remainingBytes ) {
+				remainingBytes -= update->dataSize;
+				// Sent (or there were no changes)
+				priorities[update->newState->number] = 0.0f;
+				continue;
+			}
+			data.cursize = update->dataOffset;
+			update->dataSize = 0;
+		}
+
+		update->isDeferred = true;
+		if( update->isNew ) {
+			deferredNewSnapEntities[update->newState->number] = true;
+		} else {
+			// Keep the state the client is aware of
+			*update->newState = *update->oldState;
+		}
+		numDeferredUpdates++;
+	}
+
+	// Emit updates in the regular order
+	for( int i = 0; i < numUpdates; ++i ) {
+		const snap_entity_update_t *update = &snapEntityUpdates[i];
+		if( !update->isDeferred && update->dataSize ) {
+			MSG_CopyData( msg, snapEntityUpdatesData + update->dataOffset, update->dataSize );
+		}
 	}
 
 	MSG_WriteInt16( msg, 0 ); // end of packetentities
+
+	// Exclude deferred new entities from the frame
+	if( numDeferredUpdates ) {
+		int numKeptEntities = 0;
+		for( int i = 0; i < to->num_entities; ++i ) {
+			const entity_state_t *state = &client_entities[( to->first_entity + i ) % num_client_entities];
+			if( deferredNewSnapEntities[state->number] ) {
+				deferredNewSnapEntities[state->number] = false;
+				continue;
+			}
+			if( numKeptEntities != i ) {
+				client_entities[( to->first_entity + numKeptEntities ) % num_client_entities] = *state;
+			}
+			numKeptEntities++;
+		}
+		to->num_entities = numKeptEntities;
+	}
+
+	return numDeferredUpdates;
 }
 
 /*
@@ -245,10 +474,11 @@ static void SNAP_WriteMultiPOVCommands( const ginfo_t *gi, const client_t *clien
 * SNAP_WriteFrameSnapToClient
 */
 void SNAP_WriteFrameSnapToClient( const ginfo_t *gi, client_t *client, msg_t *msg, int64_t frameNum, int64_t gameTime,
-								  const entity_state_t *baselines, const client_entities_t *client_entities,
-								  int numcmds, const gcommand_t *commands, const char *commandsData ) {
+								  const entity_state_t *baselines, client_entities_t *client_entities,
+								  int numcmds, const gcommand_t *commands, const char *commandsData, int maxSnapBytes,
+								  const msg_quantization_t *quantization ) {
 	// this is the frame we are creating
-	const client_snapshot_t *frame = &client->snapShots[frameNum & UPDATE_MASK];
+	client_snapshot_t *frame = &client->snapShots[frameNum & UPDATE_MASK];
 
 	// for non-reliable clients we need to send nodelta frame until the client responds
 	if( client->nodelta && !client->reliable ) {
@@ -300,8 +530,15 @@ void SNAP_WriteFrameSnapToClient( const ginfo_t *gi, client_t *client, msg_t *ms
 	}
 	if( frame->multipov ) {
 		flags |= FRAMESNAP_FLAG_MULTIPOV;
+	} else if( quantization ) {
+		flags |= FRAMESNAP_FLAG_QUANTIZED;
 	}
 	MSG_WriteUint8( msg, flags );
+	if( flags & FRAMESNAP_FLAG_QUANTIZED ) {
+		MSG_WriteQuantization( msg, quantization );
+	} else {
+		quantization = nullptr;
+	}
 
 #ifdef RATEKILLED
 	const int supcnt = client->suppressCount;
@@ -358,9 +595,15 @@ void SNAP_WriteFrameSnapToClient( const ginfo_t *gi, client_t *client, msg_t *ms
 	MSG_WriteUint8( msg, 0 );
 
 	// delta encode the entities
-	const entity_state_t *entityStates = client_entities ? client_entities->entities : nullptr;
+	entity_state_t *entityStates = client_entities ? client_entities->entities : nullptr;
 	const int numEntities = client_entities ? client_entities->num_entities : 0;
-	SNAP_EmitPacketEntities( oldframe, frame, msg, baselines, entityStates, numEntities );
+	int numDeferredEntities = 0;
+	if( maxSnapBytes > 0 && !frame->multipov ) {
+		numDeferredEntities = SNAP_EmitBudgetedPacketEntities( oldframe, frame, msg, baselines, entityStates,
+															   numEntities, client, maxSnapBytes, quantization );
+	} else {
+		SNAP_EmitPacketEntities( oldframe, frame, msg, baselines, entityStates, numEntities, quantization );
+	}
 
 	// write length into reserved space
 	const int length = msg->cursize - pos - 2;
@@ -369,6 +612,14 @@ void SNAP_WriteFrameSnapToClient( const ginfo_t *gi, client_t *client, msg_t *ms
 	msg->cursize += length;
 
 	client->lastSentFrameNum = frameNum;
+
+	client_snap_stats_t *const stats = &client->snapStats;
+	stats->numSnaps++;
+	stats->totalBytes += length;
+	stats->totalDeferredEntities += numDeferredEntities;
+	stats->maxBytes = wsw::max( stats->maxBytes, length );
+	stats->lastBytes = length;
+	stats->lastDeferredEntities = numDeferredEntities;
 }
 
 /*
@@ -4,6 +4,8 @@
 #include "snd_local.h"
 #include "snd_env_sampler.h"
 
+#include <algorithm>
+
 static SingletonHolder<wsw::snd::ALSoundSystem> alSoundSystemHolder;
 static bool s_registering;
 static int s_registration_sequence = 1;
@@ -18,7 +20,7 @@ wsw::snd::ALSoundSystem *wsw::snd::ALSoundSystem::tryCreate( client_state_s *cli
 		return nullptr;
 	}
 
-	qbufPipe_s *pipe = QBufPipe_Create( 0x100000, 0 );
+	qbufPipe_s *pipe = QBufPipe_Create( 0x100000, QBUFPIPE_LOCKFREE_SPSC );
 	if( !pipe ) {
 		Q_free( arg );
 		return nullptr;
@@ -68,6 +70,8 @@ ALSoundSystem::ALSoundSystem( client_state_s *client, qbufPipe_s *pipe, qthread_
 }
 
 ALSoundSystem::~ALSoundSystem() {
+	Cmd_RemoveCommand( "sounddecodebench" );
+
 	stopAllSounds( StopAndClear | StopMusic );
 	// wake up the mixer
 	activate( true );
@@ -92,6 +96,8 @@ ALSoundSystem::~ALSoundSystem() {
 
 void ALSoundSystem::postInit() {
 	ENV_Init();
+
+	Cmd_AddCommand( "sounddecodebench", S_DecodeBenchmark_f );
 }
 
 void ALSoundSystem::beginRegistration() {
@@ -107,7 +113,9 @@ void ALSoundSystem::beginRegistration() {
 }
 
 void ALSoundSystem::endRegistration() {
-	// wait for the queue to be processed
+	flushPendingLoads();
+
+	// wait for the queue to be processed (this includes loading of all registered sounds)
 	QBufPipe_Finish( m_pipe );
 
 	S_ForEachBuffer( [this]( sfx_t *sfx ) {
@@ -131,8 +139,26 @@ void ALSoundSystem::endRegistration() {
 }
 
 sfx_t *ALSoundSystem::registerSound( const char *name ) {
-	// TODO: All of that should just be sync...
 	sfx_t *sfx = S_FindBuffer( getPathForName( name, &m_tmpPathBuffer1 ) );
+	if( s_registering ) {
+		// Don't wait for loading, just check whether the file exists so the result is consistent with the sync path.
+		// Starting a sound that is not loaded yet gets deferred until its batch is loaded (or it gets loaded in place).
+		if( !S_HasSoundFile( sfx->filename ) ) {
+			S_MarkBufferFree( sfx );
+			return nullptr;
+		}
+		sfx->used = Sys_Milliseconds();
+		sfx->registration_sequence = s_registration_sequence;
+		if( std::find( m_pendingLoadIds.begin(), m_pendingLoadIds.end(), sfx->id ) == m_pendingLoadIds.end() ) {
+			m_pendingLoadIds.push_back( sfx->id );
+			if( m_pendingLoadIds.size() >= kMaxPendingLoads ) {
+				flushPendingLoads();
+			}
+		}
+		return sfx;
+	}
+
+	// TODO: All of that should just be sync...
 	m_loadSfxCall.exec( sfx->id );
 	QBufPipe_Finish( m_pipe );
 	if( sfx->buffer ) {
@@ -144,6 +170,18 @@ sfx_t *ALSoundSystem::registerSound( const char *name ) {
 	return nullptr;
 }
 
+void ALSoundSystem::flushPendingLoads() {
+	if( m_pendingLoadIds.empty() ) {
+		return;
+	}
+
+	// The backend takes the ownership
+	auto *ids = (int *)Q_malloc( sizeof( int ) * m_pendingLoadIds.size() );
+	std::copy( m_pendingLoadIds.begin(), m_pendingLoadIds.end(), ids );
+	m_loadSfxBatchCall.exec( (uintptr_t)ids, (unsigned)m_pendingLoadIds.size() );
+	m_pendingLoadIds.clear();
+}
+
 void ALSoundSystem::activate( bool active ) {
 	if( !active && s_globalfocus->integer ) {
 		return;
@@ -3,6 +3,7 @@
 
 #include "backend.h"
 #include "../qcommon/pipeadapter.h"
+#include "../qcommon/wswvector.h"
 #include "snd_local.h"
 
 namespace wsw::snd {
@@ -101,6 +102,13 @@ public:
 		m_advanceBackgroundTrackCall.exec( 0 );
 	}
 private:
+	void flushPendingLoads();
+
+	// Sounds that are registered during the registration get loaded in batches in the background
+	static constexpr unsigned kMaxPendingLoads = 64;
+
+	wsw::Vector<int> m_pendingLoadIds;
+
 	wsw::String m_tmpPathBuffer1;
 	wsw::String m_tmpPathBuffer2;
 
@@ -123,6 +131,8 @@ private:
 
 	InterThreadCall1<Backend, int> m_freeSfxCall { this, "freeSound", &m_backend, &Backend::freeSound };
 	InterThreadCall1<Backend, int> m_loadSfxCall { this, "loadSound", &m_backend, &Backend::loadSound };
+	InterThreadCall2<Backend, uintptr_t, unsigned> m_loadSfxBatchCall {
+		this, "loadSounds", &m_backend, &Backend::loadSounds };
 
 	BatchedInterThreadCall3<Backend, int, Vec3, Vec3, 8> m_setEntitySpatialParamsCall {
 		this, "setEntitySpatialParams", &m_backend, &Backend::setEntitySpatialParams };
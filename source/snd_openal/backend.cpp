@@ -250,6 +250,14 @@ void Backend::loadSound( const int &id ) {
 	S_LoadBuffer( S_GetBufferById( id ) );
 }
 
+void Backend::loadSounds( const uintptr_t &idsAddress, const unsigned &numIds ) {
+	auto *ids = (int *)idsAddress;
+
+	S_LoadBuffers( ids, numIds );
+
+	Q_free( ids );
+}
+
 void Backend::setEntitySpatialParams( const int &entNum, const Vec3 &origin, const Vec3 &velocity ) {
 	S_SetEntitySpatialization( entNum, origin.Data(), velocity.Data() );
 }
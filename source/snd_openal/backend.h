@@ -22,6 +22,8 @@ public:
 
 	void freeSound( const int &id );
 	void loadSound( const int &id );
+	// TODO: Discover how to send pointers, see also the general note
+	void loadSounds( const uintptr_t &idsAddress, const unsigned &numIds );
 
 	void setEntitySpatialParams( const int &entNum, const Vec3 &origin, const Vec3 &velocity );
 	void setListener( const Vec3 &origin, const Vec3 &velocity, const std::array<Vec3, 3> &axis );
@@ -25,7 +25,11 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 // Hack... set quality hint based on sound fx name
 #include "../gameshared/gs_qrespath.h"
+#include "../qcommon/jobsystem.h"
+#include "../qcommon/wswfs.h"
+#include "snd_pcmcache.h"
 
+#include <atomic>
 #include <memory>
 
 #define MAX_SFX 4096
@@ -217,68 +221,160 @@ namespace std {
 	}
 }
 
-bool S_LoadBuffer( sfx_t *sfx ) {
-	if( !sfx ) {
-		return false;
+struct CallSFree {
+	void operator()( void *p ) {
+		if( p ) {
+			Q_free( p );
+		}
 	}
-	if( sfx->filename[0] == '\0' || sfx->inMemory ) {
-		return false;
+};
+
+using DataHolder = std::unique_ptr<void, CallSFree>;
+
+// PCM data of a sound that is ready to be uploaded to buffers
+struct DecodedSound {
+	snd_info_t monoInfo;
+	snd_info_t stereoInfo;
+	DataHolder monoData;
+	// Present only for stereo files
+	DataHolder stereoData;
+	unsigned durationMillis { 0 };
+	bool isFromCache { false };
+};
+
+static void *S_ReadPcmCacheFile( const char *filename, uint32_t pakChecksum, snd_info_t *info ) {
+	const wsw::String path( wsw::snd::PcmCacheFile::makePath( wsw::StringView( filename ) ) );
+	auto maybeHandle = wsw::fs::openAsReadHandle( wsw::StringView( path.data(), path.size(), wsw::StringView::ZeroTerminated ), wsw::fs::UseCacheFS );
+	if( !maybeHandle ) {
+		return nullptr;
 	}
 
-	struct CallSFree {
-		void operator()( void *p ) {
-			if( p ) {
-				Q_free( p );
-			}
+	uint8_t header[wsw::snd::PcmCacheFile::kHeaderSize];
+	const size_t fileSize = maybeHandle->getInitialFileSize();
+	if( fileSize < sizeof( header ) || !maybeHandle->readExact( header, sizeof( header ) ) ) {
+		return nullptr;
+	}
+	const auto maybeProps = wsw::snd::PcmCacheFile::parseHeader( header, fileSize, pakChecksum );
+	if( !maybeProps ) {
+		// The pak has been changed (or the file is corrupt). It's going to be rewritten.
+		return nullptr;
+	}
+
+	DataHolder data( Q_malloc( maybeProps->dataSize ) );
+	if( !maybeHandle->readExact( (uint8_t *)data.get(), maybeProps->dataSize ) ) {
+		return nullptr;
+	}
+
+	info->rate     = (int)maybeProps->rate;
+	info->width    = (int)maybeProps->width;
+	info->channels = (int)maybeProps->channels;
+	info->samples  = (int)maybeProps->samples;
+	info->size     = (int)maybeProps->dataSize;
+	return data.release();
+}
+
+static void S_WritePcmCacheFile( const char *filename, uint32_t pakChecksum, const snd_info_t &info, const void *data ) {
+	// Don't cache formats that are rejected on reading
+	if( ( info.width != 1 && info.width != 2 ) || ( info.channels != 1 && info.channels != 2 ) ) {
+		return;
+	}
+	if( info.rate <= 0 || info.samples < 0 || info.size <= 0 ) {
+		return;
+	}
+
+	wsw::snd::PcmProps props;
+	props.rate     = (uint32_t)info.rate;
+	props.width    = (uint32_t)info.width;
+	props.channels = (uint32_t)info.channels;
+	props.samples  = (uint32_t)info.samples;
+	props.dataSize = (uint32_t)info.size;
+
+	uint8_t header[wsw::snd::PcmCacheFile::kHeaderSize];
+	wsw::snd::PcmCacheFile::writeHeader( props, pakChecksum, header );
+
+	const wsw::String path( wsw::snd::PcmCacheFile::makePath( wsw::StringView( filename ) ) );
+	auto maybeHandle = wsw::fs::openAsWriteHandle( wsw::StringView( path.data(), path.size(), wsw::StringView::ZeroTerminated ), wsw::fs::UseCacheFS );
+	// Note: a partially written file fails the size check on reading
+	if( !maybeHandle || !maybeHandle->write( header, sizeof( header ) ) ||
+		!maybeHandle->write( (const uint8_t *)data, (size_t)info.size ) ) {
+		Com_Printf( S_COLOR_YELLOW "Failed to write the PCM cache file for %s\n", filename );
+	}
+}
+
+static void *S_LoadSoundUsingCache( const char *filename, snd_info_t *info, bool useCache, bool *isFromCache ) {
+	uint32_t pakChecksum = 0;
+	// Only sounds that come from paks are cached as pak checksums are cheap to get
+	if( useCache && s_pcmcache->integer ) {
+		if( const char *pakName = FS_PakNameForFile( filename ) ) {
+			pakChecksum = FS_ChecksumBaseFile( pakName, false );
 		}
-	};
+	}
 
-	using DataHolder = std::unique_ptr<void, CallSFree>;
+	if( pakChecksum ) {
+		if( void *data = S_ReadPcmCacheFile( filename, pakChecksum, info ) ) {
+			*isFromCache = true;
+			return data;
+		}
+	}
+
+	void *data = S_LoadSound( filename, info );
+	if( data && pakChecksum ) {
+		S_WritePcmCacheFile( filename, pakChecksum, *info, data );
+	}
+	return data;
+}
 
+/**
+ * Loads the sound file and converts the data to formats of sound buffers.
+ * This does not touch OpenAL so it's safe to call from any thread.
+ */
+static bool S_DecodeSound( const char *filename, bool useCache, DecodedSound *decoded ) {
 	snd_info_t fileInfo;
-	DataHolder fileData( S_LoadSound( sfx->filename, &fileInfo ) );
+	DataHolder fileData( S_LoadSoundUsingCache( filename, &fileInfo, useCache, &decoded->isFromCache ) );
 	if( !fileData ) {
-		//Com_DPrintf( "Couldn't load %s\n", sfx->filename );
+		//Com_DPrintf( "Couldn't load %s\n", filename );
 		return false;
 	}
 
-	snd_info_t monoInfo, stereoInfo;
-	DataHolder monoData, stereoData;
-	BufferHolder stereoBuffer;
+	decoded->durationMillis = (unsigned)( ( 1000 * (int64_t)fileInfo.samples ) / fileInfo.rate );
 	if( fileInfo.channels < 2 ) {
-		std::swap( fileData, monoData );
-		monoInfo = fileInfo;
-		assert( monoData.get() && !fileData.get() );
-	} else {
-		monoInfo = stereoInfo = fileInfo;
-		// Puf file data to stereo data
-		std::swap( fileData, stereoData );
-		BufferHolder tmpBuffer( S_BindBufferData( sfx->filename, stereoInfo, stereoData.get() ) );
+		decoded->monoInfo = fileInfo;
+		decoded->monoData = std::move( fileData );
+		return true;
+	}
+
+	decoded->monoInfo = decoded->stereoInfo = fileInfo;
+	DataHolder resampledData( stereo_mono( fileData.get(), &decoded->monoInfo ) );
+	if( !resampledData ) {
+		Com_Printf( "Can't resample stereo to mono for %s\n", filename );
+		return false;
+	}
+
+	decoded->stereoData = std::move( fileData );
+	decoded->monoData = std::move( resampledData );
+	return true;
+}
+
+static bool S_UploadDecodedSound( sfx_t *sfx, const DecodedSound &decoded ) {
+	BufferHolder stereoBuffer;
+	if( decoded.stereoData ) {
+		BufferHolder tmpBuffer( S_BindBufferData( sfx->filename, decoded.stereoInfo, decoded.stereoData.get() ) );
 		if( !tmpBuffer ) {
 			return false;
 		}
 		std::swap( stereoBuffer, tmpBuffer );
-		DataHolder resampledData( stereo_mono( stereoData.get(), &monoInfo ) );
-		if( !resampledData.get() ) {
-			Com_Printf( "Can't resample stereo to mono for %s\n", sfx->filename );
-			return false;
-		}
-
-		// Put resampled data to mono data
-		std::swap( monoData, resampledData );
-		assert( stereoData.get() && !fileData.get() );
-		assert( monoData.get() && !resampledData.get() );
 	}
 
-	BufferHolder monoBuffer( S_BindBufferData( sfx->filename, monoInfo, monoData.get() ) );
+	BufferHolder monoBuffer( S_BindBufferData( sfx->filename, decoded.monoInfo, decoded.monoData.get() ) );
 	if( !monoBuffer ) {
 		return false;
 	}
 
 	sfx->buffer         = monoBuffer.ReleaseOwnership();
 	sfx->stereoBuffer   = stereoBuffer.ReleaseOwnership();
-	sfx->durationMillis = (unsigned)( ( 1000 * (int64_t)fileInfo.samples )  / fileInfo.rate );
+	sfx->durationMillis = decoded.durationMillis;
 	sfx->inMemory       = true;
+	sfx->hasLoadFailed  = false;
 
 	if( s_environment_effects->integer ) {
 		S_SetQualityHint( sfx );
@@ -287,6 +383,75 @@ bool S_LoadBuffer( sfx_t *sfx ) {
 	return true;
 }
 
+bool S_LoadBuffer( sfx_t *sfx ) {
+	if( !sfx ) {
+		return false;
+	}
+	if( sfx->filename[0] == '\0' || sfx->inMemory ) {
+		return false;
+	}
+
+	DecodedSound decoded;
+	if( !S_DecodeSound( sfx->filename, true, &decoded ) ) {
+		sfx->hasLoadFailed = true;
+		return false;
+	}
+
+	return S_UploadDecodedSound( sfx, decoded );
+}
+
+void S_LoadBuffers( const int *ids, unsigned numIds ) {
+	// Limits the amount of decoded data that is kept in memory at once
+	constexpr unsigned kBatchSize = 32;
+
+	sfx_t *batchSfx[kBatchSize];
+	DecodedSound batchSounds[kBatchSize];
+	bool batchResults[kBatchSize];
+
+	const int64_t startTimestamp = Sys_Milliseconds();
+	unsigned numRequested = 0, numLoaded = 0, numFromCache = 0;
+
+	auto *const jobSystem = wsw::JobSystem::instance();
+	for( unsigned idIndex = 0; idIndex < numIds; ) {
+		unsigned batchSize = 0;
+		for(; idIndex < numIds && batchSize < kBatchSize; ++idIndex ) {
+			sfx_t *sfx = S_GetBufferById( ids[idIndex] );
+			if( sfx && sfx->filename[0] != '\0' && !sfx->inMemory ) {
+				batchSfx[batchSize++] = sfx;
+			}
+		}
+
+		// Decoding does not touch OpenAL, so it's performed by workers (the calling thread participates as well)
+		jobSystem->parallelFor( batchSize, 1, [&]( unsigned beginIndex, unsigned endIndex ) {
+			for( unsigned i = beginIndex; i < endIndex; ++i ) {
+				batchResults[i] = S_DecodeSound( batchSfx[i]->filename, true, &batchSounds[i] );
+			}
+		});
+
+		// Uploading must be performed by this thread as it owns the context
+		for( unsigned i = 0; i < batchSize; ++i ) {
+			sfx_t *const sfx = batchSfx[i];
+			// Check whether the same sound has been already uploaded by this batch
+			if( !sfx->inMemory ) {
+				if( batchResults[i] && S_UploadDecodedSound( sfx, batchSounds[i] ) ) {
+					numLoaded++;
+					numFromCache += batchSounds[i].isFromCache ? 1 : 0;
+				} else {
+					sfx->hasLoadFailed = true;
+				}
+			}
+			batchSounds[i] = DecodedSound();
+		}
+
+		numRequested += batchSize;
+	}
+
+	if( numRequested ) {
+		Com_DPrintf( "Loaded %u of %u sounds (%u from the PCM cache) in %d millis\n", numLoaded, numRequested,
+					 numFromCache, (int)( Sys_Milliseconds() - startTimestamp ) );
+	}
+}
+
 static ALuint S_BindBufferData( const char *tag, const snd_info_t &info, const void *data ) {
 	ALenum error;
 	ALuint buffer;
@@ -409,12 +574,52 @@ void S_SoundList_f( void ) {
 	}
 }
 
+// This is a console command rather than a benchmark of the client test executable,
+// as it's meaningful only for the actual set of registered sounds, which are read from paks of the game
+// by the engine filesystem and decoded by the vorbis runtime that are not available to tests.
+// Names of sounds are modified only by the main thread which also executes commands, and decoding
+// does not touch state of buffers, so this is safe to run while the backend is active.
+void S_DecodeBenchmark_f( void ) {
+	wsw::Vector<wsw::String> fileNames;
+	for( int i = 0; i < MAX_SFX; i++ ) {
+		if( knownSfx[i].filename[0] != '\0' ) {
+			fileNames.emplace_back( wsw::String( knownSfx[i].filename ) );
+		}
+	}
+
+	std::atomic<unsigned> numDecoded { 0 };
+	// The PCM cache is bypassed, so this measures decoding of files
+	const auto decodeRange = [&]( unsigned beginIndex, unsigned endIndex ) {
+		for( unsigned i = beginIndex; i < endIndex; ++i ) {
+			DecodedSound decoded;
+			if( S_DecodeSound( fileNames[i].data(), false, &decoded ) ) {
+				numDecoded.fetch_add( 1, std::memory_order_relaxed );
+			}
+		}
+	};
+
+	const auto numFiles = (unsigned)fileNames.size();
+	const int64_t serialStartTimestamp = Sys_Milliseconds();
+	decodeRange( 0, numFiles );
+	const int64_t serialMillis = Sys_Milliseconds() - serialStartTimestamp;
+	const unsigned numDecodedSerially = numDecoded.load( std::memory_order_relaxed );
+
+	auto *const jobSystem = wsw::JobSystem::instance();
+	const int64_t parallelStartTimestamp = Sys_Milliseconds();
+	jobSystem->parallelFor( numFiles, 1, decodeRange );
+	const int64_t parallelMillis = Sys_Milliseconds() - parallelStartTimestamp;
+
+	Com_Printf( "Decoded %u of %u sounds: %d millis serially, %d millis using %u threads\n", numDecodedSerially,
+				numFiles, (int)serialMillis, (int)parallelMillis, jobSystem->numWorkers() + 1 );
+}
+
 void S_UseBuffer( sfx_t *sfx ) {
 	if( sfx->filename[0] == '\0' ) {
 		return;
 	}
 
-	if( !sfx->inMemory ) {
+	// Don't retry loading files that are known to be missing or corrupt on every use
+	if( !sfx->inMemory && !sfx->hasLoadFailed ) {
 		S_LoadBuffer( sfx );
 	}
 
@@ -1,11 +1,10 @@
 #include "snd_computation_host.h"
 #include "snd_local.h"
 
+#include "../qcommon/jobsystem.h"
 #include "../qcommon/links.h"
 #include "../qcommon/singletonholder.h"
 
-#include <thread>
-
 static SingletonHolder<ParallelComputationHost> instanceHolder;
 
 ParallelComputationHost *ParallelComputationHost::Instance() {
@@ -21,56 +20,17 @@ void ParallelComputationHost::Shutdown() {
 }
 
 int ParallelComputationHost::SuggestNumberOfTasks() {
-	unsigned numPhysicalProcessors, numLogicalProcessors;
-	if( !Sys_GetNumberOfProcessors( &numPhysicalProcessors, &numLogicalProcessors ) ) {
-		return 2;
-	}
-	if( numLogicalProcessors > numPhysicalProcessors * 2 ) {
-		// We're running it at some weird machine, let's try
-		return numLogicalProcessors;
-	}
-	if( numLogicalProcessors == numPhysicalProcessors * 2 ) {
-		// A widely available implementation of HT.
-		// Let's use all logical cores except a single one.
-		// There's going to be lots of cache misses so utilizing HT can be beneficial.
-		return wsw::max( 2u, numLogicalProcessors - 1 );
-	}
-	return numPhysicalProcessors;
+	// Workers and the caller thread
+	return (int)wsw::JobSystem::instance()->numWorkers() + 1;
 }
 
-void *TaskThreadFunc( void *param ) {
-	auto *const task = (ParallelComputationHost::PartialTask *)param;
-	// TODO: This is not that bad as it gets started almost immediately but still...
-	while( !task->hasStarted.load( std::memory_order_relaxed ) ) {
-		QThread_Yield();
-	}
-
-	task->Exec();
-
-	task->isCompleted.store( true, std::memory_order_relaxed );
-	return nullptr;
+void ParallelComputationHost::ExecTask( void *task ) {
+	( (PartialTask *)task )->Exec();
 }
 
 bool ParallelComputationHost::TryAddTask( PartialTask *task ) {
 	assert( !isRunning );
 
-	// If there is no tasks, just link the task.
-	// It will be executed in a caller thread even if other tasks are added.
-	if( !tasksHead ) {
-		wsw::link( task, &tasksHead, 0 );
-		return true;
-	}
-
-	assert( !task->hasStarted && !task->isCompleted );
-
-	auto *threadHandle = QThread_Create( &TaskThreadFunc, task );
-	if( !threadHandle ) {
-		// Destroy the task immediately as we always acquire an ownership over the task lifetime.
-		DestroyTask( task );
-		return false;
-	}
-
-	task->threadHandle = threadHandle;
 	wsw::link( task, &tasksHead, 0 );
 	return true;
 }
@@ -84,49 +44,19 @@ void ParallelComputationHost::Exec() {
 
 	isRunning = true;
 
-	PartialTask *thisThreadTask = nullptr;
-	// Launch all tasks if their own
+	wsw::JobSystem *const jobSystem = wsw::JobSystem::instance();
+	wsw::JobSystem::Counter counter;
 	for( auto *task = tasksHead; task; task = task->Next() ) {
-		if( task->threadHandle ) {
-			task->hasStarted.store( true, std::memory_order_relaxed );
-			continue;
-		}
-		assert( !thisThreadTask );
-		thisThreadTask = task;
+		jobSystem->submit( &ParallelComputationHost::ExecTask, task, &counter );
 	}
 
-	assert( thisThreadTask );
-	// Execute the single task without its thread in the caller thread
-	thisThreadTask->Exec();
-
-	// Wait for completion of other tasks.
-	// As a CPU workload of tasks is assumed to be +/- equal, this should not take long.
-	WaitForTasksCompletion( thisThreadTask );
+	// Execute tasks in the caller thread as well while waiting
+	jobSystem->waitFor( &counter );
 	DestroyHeldTasks();
 	// We're ready for another batch of tasks
 	isRunning = false;
 }
 
-void ParallelComputationHost::WaitForTasksCompletion( const PartialTask *thisThreadTask ) {
-	for(;; ) {
-		if( AreAllTasksCompleted( thisThreadTask ) ) {
-			return;
-		}
-		// Should not really be bad as all tasks are going to be complete on the first iteration
-		QThread_Yield();
-	}
-}
-
-bool ParallelComputationHost::AreAllTasksCompleted( const PartialTask *thisThreadTask ) {
-	for( auto *task = tasksHead; task; task = task->Next() ) {
-		if( task != thisThreadTask && !task->isCompleted.load( std::memory_order_relaxed ) ) {
-			return false;
-		}
-	}
-
-	return true;
-}
-
 inline void ParallelComputationHost::DestroyTask( PartialTask *task ) {
 	assert( task );
 	task->~PartialTask();
@@ -140,4 +70,4 @@ void ParallelComputationHost::DestroyHeldTasks() {
 		DestroyTask( task );
 	}
 	tasksHead = nullptr;
-}
\ No newline at end of file
+}
@@ -1,7 +1,6 @@
 #ifndef QFUSION_SND_PARALLEL_COMPUTATION_H
 #define QFUSION_SND_PARALLEL_COMPUTATION_H
 
-#include <atomic>
 #include <assert.h>
 
 namespace wsw {
@@ -14,12 +13,7 @@ template <typename T> auto unlink( T *, T **, int ) -> T *;
  * A user splits the necessary workload between instances of {@code PartialTask} manually.
  * An even distribution of workload is not necessary but is expected for a proper computational power utilization.
  * Tasks are submitted and then a batch parallel computation is executed.
- * One task is executed in the caller thread, the rest in separate ones.
- * @note Lifting this host to the application scope as a single global host
- * for parallel CPU-expensive computations is proposed.
- * The current implementation is very basic and is just to get
- * working results ASAP but suits the current single use case:
- * doing computations at level loading preferrably in developer mode.
+ * Tasks are executed as jobs of the engine-wide {@code wsw::JobSystem}, the caller thread executes tasks as well.
  */
 class ParallelComputationHost {
 public:
@@ -29,45 +23,26 @@ public:
 	 */
 	class PartialTask {
 		friend class ParallelComputationHost;
-		friend void *TaskThreadFunc( void * );
 
 		template <typename T> friend auto wsw::link( T *, T **, int ) -> T *;
 		template <typename T> friend auto wsw::unlink( T *, T **, int ) -> T *;
 
-		// Note: we are aware of false sharing.
-		// These vars are accessed at the same time very rarely (even if a concurrent access happens).
-		std::atomic_bool hasStarted { false };
-		std::atomic_bool isCompleted { false };
-
-		struct qthread_s *threadHandle { nullptr };
-
 		PartialTask *Next() { return next[0]; }
 
 		PartialTask *prev[1] = { nullptr };
 		PartialTask *next[1] = { nullptr };
 	protected:
-		PartialTask() {
-			assert( hasStarted.is_lock_free() );
-			assert( isCompleted.is_lock_free() );
-		}
+		PartialTask() = default;
 
 		virtual ~PartialTask() = default;
 		virtual void Exec() = 0;
 	};
 
-	/**
-	 * Must be called after {@code thisThreadTask} has finished its execution.
-	 */
-	void WaitForTasksCompletion( const PartialTask *thisThreadTask );
-	/**
-	 * Must be called after {@code thisThreadTask} has finished its execution.
-	 * It is intended to be called by {@code WaitForTasksCompletion(const PartialTask *)}
-	 */
-	bool AreAllTasksCompleted( const PartialTask *thisThreadTask );
-
 	void DestroyHeldTasks();
 	inline void DestroyTask( PartialTask *task );
 protected:
+	static void ExecTask( void *task );
+
 	PartialTask *tasksHead { nullptr };
 	bool isRunning { false };
 public:
@@ -100,14 +75,10 @@ public:
 
 	/**
 	 * Must be called manually and right now only if the host instance is needed for computations at level change.
-	 * The host lifecycle is proposed to be lifted to the application scope
-	 * and all modules should share the single global application host.
 	 */
 	static void Init();
 	/**
 	 * Must be called manually and right now only if the host instance is needed for computations at level change.
-	 * The host lifecycle is proposed to be lifted to the application scope
-	 * and all modules should share the single global application host.
 	 */
 	static void Shutdown();
 };
@@ -90,6 +90,21 @@ void *S_LoadSound( const char *filename, snd_info_t *info ) {
 	return decoder->load( fn, info );
 }
 
+bool S_HasSoundFile( const char *filename ) {
+	snd_decoder_t *decoder;
+	char fn[MAX_QPATH];
+
+	decoder = findCodec( filename );
+	if( !decoder ) {
+		return false;
+	}
+
+	Q_strncpyz( fn, filename, sizeof( fn ) );
+	COM_DefaultExtension( fn, decoder->ext, sizeof( fn ) );
+
+	return FS_FOpenFile( fn, NULL, FS_READ ) >= 0;
+}
+
 snd_stream_t *S_OpenStream( const char *filename, bool *delay ) {
 	snd_decoder_t *decoder;
 	char fn[MAX_QPATH];
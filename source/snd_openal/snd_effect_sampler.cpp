@@ -4,28 +4,13 @@
 #include "snd_propagation.h"
 #include "efxpresetsregistry.h"
 
+#include "../qcommon/jobsystem.h"
 #include "../qcommon/wswstaticvector.h"
 #include "../qcommon/wswstringsplitter.h"
 
 #include <limits>
 #include <random>
 
-static UnderwaterFlangerEffectSampler underwaterFlangerEffectSampler;
-
-static ReverbEffectSampler reverbEffectSampler;
-
-Effect *EffectSamplers::TryApply( const ListenerProps &listenerProps, src_t *src, const src_t *tryReusePropsSrc ) {
-	Effect *effect;
-	if( ( effect = ::underwaterFlangerEffectSampler.TryApply( listenerProps, src, tryReusePropsSrc ) ) ) {
-		return effect;
-	}
-	if( ( effect = ::reverbEffectSampler.TryApply( listenerProps, src, tryReusePropsSrc ) ) ) {
-		return effect;
-	}
-
-	Com_Error( ERR_FATAL, "EffectSamplers::TryApply(): Can't find an applicable effect sampler\n" );
-}
-
 // We want sampling results to be reproducible especially for leaf sampling and thus use this local implementation
 static std::minstd_rand0 samplingRandom;
 
@@ -34,66 +19,18 @@ float EffectSamplers::SamplingRandom() {
 	return ( samplingRandom() - R::min() ) / (float)( R::max() - R::min() );
 }
 
-Effect *UnderwaterFlangerEffectSampler::TryApply( const ListenerProps &listenerProps, src_t *src, const src_t * ) {
-	if( !listenerProps.isInLiquid && !src->envUpdateState.isInLiquid ) {
-		return nullptr;
-	}
-
-	float directObstruction = 0.9f;
-	if( src->envUpdateState.isInLiquid && listenerProps.isInLiquid ) {
-		directObstruction = ComputeDirectObstruction( listenerProps, src );
-	}
-
-	auto *effect = EffectsAllocator::Instance()->NewFlangerEffect( src );
-	effect->directObstruction = directObstruction;
-	effect->hasMediumTransition = src->envUpdateState.isInLiquid ^ listenerProps.isInLiquid;
-	return effect;
-}
-
-static bool ENV_TryReuseSourceReverbProps( src_t *src, const src_t *tryReusePropsSrc, EaxReverbEffect *newEffect ) {
-	if( !tryReusePropsSrc ) {
-		return false;
-	}
-
-	auto *reuseEffect = Effect::Cast<const EaxReverbEffect *>( tryReusePropsSrc->envUpdateState.effect );
-	if( !reuseEffect ) {
-		return false;
-	}
-
-	// We are already sure that both sources are in the same contents kind (non-liquid).
-	// Check distance between sources.
-	const float squareDistance = DistanceSquared( tryReusePropsSrc->origin, src->origin );
-	// If they are way too far for reusing
-	if( squareDistance > 96 * 96 ) {
-		return false;
-	}
+static unsigned GetNumSamplesForCurrentQuality( unsigned minSamples, unsigned maxSamples ) {
+	float quality = s_environment_sampling_quality->value;
 
-	// If they are very close, feel free to just copy props
-	if( squareDistance > 4.0f * 4.0f ) {
-		// Do a coarse raycast test between these two sources
-		vec3_t start, end, dir;
-		VectorSubtract( tryReusePropsSrc->origin, src->origin, dir );
-		const float invDistance = 1.0f / sqrtf( squareDistance );
-		VectorScale( dir, invDistance, dir );
-		// Offset start and end by a dir unit.
-		// Ensure start and end are in "air" and not on a brush plane
-		VectorAdd( src->origin, dir, start );
-		VectorSubtract( tryReusePropsSrc->origin, dir, end );
-
-		trace_t trace;
-		S_Trace( &trace, start, end, vec3_origin, vec3_origin, MASK_SOLID );
-		if( trace.fraction != 1.0f ) {
-			return false;
-		}
-	}
+	assert( quality >= 0.0f && quality <= 1.0f );
+	assert( minSamples < maxSamples );
 
-	newEffect->directObstruction        = reuseEffect->directObstruction;
-	newEffect->secondaryRaysObstruction = reuseEffect->secondaryRaysObstruction;
-	newEffect->reverbProps              = reuseEffect->reverbProps;
-	return true;
+	auto numSamples = (unsigned)( minSamples + ( maxSamples - minSamples ) * quality );
+	assert( numSamples && numSamples <= maxSamples );
+	return numSamples;
 }
 
-void ObstructedEffectSampler::SetupDirectObstructionSamplingProps( src_t *src, unsigned minSamples, unsigned maxSamples ) {
+static void SetupDirectObstructionSamplingProps( src_t *src, unsigned minSamples, unsigned maxSamples ) {
 	float quality = s_environment_sampling_quality->value;
 	samplingProps_t *props = &src->envUpdateState.directObstructionSamplingProps;
 
@@ -125,88 +62,301 @@ struct DirectObstructionOffsetsHolder {
 
 static DirectObstructionOffsetsHolder directObstructionOffsetsHolder;
 
-float ObstructedEffectSampler::ComputeDirectObstruction( const ListenerProps &listenerProps, src_t *src ) {
-	trace_t trace;
-	envUpdateState_t *updateState;
-	float *originOffset;
-	vec3_t testedListenerOrigin;
-	vec3_t testedSourceOrigin;
-	float squareDistance;
-	unsigned numTestedRays, numPassedRays;
-	unsigned valueIndex;
+void EnvSamplingRays::clear() {
+	m_packets.clear();
+	m_starts.clear();
+	m_ends.clear();
+	m_traces.clear();
+	m_numTracedPackets = 0;
+}
+
+void EnvSamplingRays::beginPacket( int contentsMask, int topNodeHint ) {
+	const auto firstRayNum = (unsigned)( m_starts.size() / 3 );
+	m_packets.emplace_back( Packet { firstRayNum, 0, contentsMask, topNodeHint } );
+}
+
+auto EnvSamplingRays::addRay( const float *start, const float *end ) -> unsigned {
+	assert( m_packets.size() > m_numTracedPackets );
+	const auto rayNum = (unsigned)( m_starts.size() / 3 );
+	m_starts.insert( m_starts.end(), start, start + 3 );
+	m_ends.insert( m_ends.end(), end, end + 3 );
+	m_packets.back().numRays++;
+	return rayNum;
+}
+
+void EnvSamplingRays::trace() {
+	m_traces.resize( m_starts.size() / 3 );
 
-	updateState = &src->envUpdateState;
+	const unsigned firstPacketNum = m_numTracedPackets;
+	const auto numPackets = (unsigned)m_packets.size() - firstPacketNum;
+	wsw::JobSystem::instance()->parallelFor( numPackets, 4, [&]( unsigned beginIndex, unsigned endIndex ) {
+		for( unsigned i = beginIndex; i < endIndex; ++i ) {
+			tracePacket( m_packets[firstPacketNum + i] );
+		}
+	});
+
+	m_numTracedPackets = (unsigned)m_packets.size();
+}
+
+void EnvSamplingRays::tracePacket( const Packet &packet ) {
+	const auto *const starts = ( (const vec3_t *)m_starts.data() ) + packet.firstRayNum;
+	const auto *const ends = ( (const vec3_t *)m_ends.data() ) + packet.firstRayNum;
+	trace_t *const traces = m_traces.data() + packet.firstRayNum;
+	S_TracePoints( traces, starts, ends, packet.numRays, packet.contentsMask, packet.topNodeHint );
+}
 
-	VectorCopy( listenerProps.origin, testedListenerOrigin );
+void EnvSamplingBatch::clear( const ListenerProps &listenerProps ) {
+	m_numRequests = 0;
+
+	VectorCopy( listenerProps.origin, m_testedListenerOrigin );
 	// TODO: We assume standard view height
-	testedListenerOrigin[2] += 18.0f;
+	m_testedListenerOrigin[2] += 18.0f;
+	m_listenerLeafNum = listenerProps.GetLeafNum();
+
+	m_numPrimaryRays = GetNumSamplesForCurrentQuality( 16, MAX_REVERB_PRIMARY_RAY_SAMPLES );
+	GenericRaycastSampler::SetupSamplingRayDirs( m_primaryRayDirs, m_numPrimaryRays );
+}
 
-	squareDistance = DistanceSquared( testedListenerOrigin, src->origin );
-	// Shortcut for sounds relative to the player
-	if( squareDistance < 32.0f * 32.0f ) {
-		return 0.0f;
+void EnvSamplingBatch::sample() {
+	m_rays.clear();
+
+	// Rays of every stage depend on results of the previous one
+	for( unsigned i = 0; i < m_numRequests; ++i ) {
+		addInitialRays( i );
 	}
+	m_rays.trace();
 
-	if( !S_LeafsInPVS( listenerProps.GetLeafNum(), S_PointLeafNum( src->origin ) ) ) {
-		return 1.0f;
+	for( unsigned i = 0; i < m_numRequests; ++i ) {
+		addObstructionAndPrimaryRays( i );
 	}
+	m_rays.trace();
 
-	vec3_t hintBounds[2];
-	ClearBounds( hintBounds[0], hintBounds[1] );
-	AddPointToBounds( testedListenerOrigin, hintBounds[0], hintBounds[1] );
-	AddPointToBounds( src->origin, hintBounds[0], hintBounds[1] );
-	// Account for obstruction sampling offsets
-	// as we are going to compute the top node hint once
-	for( int i = 0; i < 3; ++i ) {
-		hintBounds[0][i] -= DirectObstructionOffsetsHolder::MAX_OFFSET;
-		hintBounds[1][i] += DirectObstructionOffsetsHolder::MAX_OFFSET;
+	for( unsigned i = 0; i < m_numRequests; ++i ) {
+		addSecondaryRays( i );
 	}
+	m_rays.trace();
 
-	const int topNodeHint = S_FindTopNodeForBox( hintBounds[0], hintBounds[1] );
-	S_Trace( &trace, testedListenerOrigin, src->origin, vec3_origin, vec3_origin, MASK_SOLID, topNodeHint );
-	if( trace.fraction == 1.0f && !trace.startsolid ) {
-		// Consider zero obstruction in this case
-		return 0.0f;
+	for( unsigned i = 0; i < m_numRequests; ++i ) {
+		computeResults( i );
 	}
+}
 
-	SetupDirectObstructionSamplingProps( src, 3, MAX_DIRECT_OBSTRUCTION_SAMPLES );
+void EnvSamplingBatch::addInitialRays( unsigned requestNum ) {
+	const EnvSamplingRequest &request = m_requests[requestNum];
+	EnvSamplingResult *const result = &m_results[requestNum];
+
+	result->leafNum = S_PointLeafNum( request.origin );
+	result->numPrimaryRays = 0;
+	result->numPrimaryHits = 0;
+	result->numPassedSecondaryRays = 0;
+	result->secondaryRaysObstruction = 0.0f;
+	result->hasReusedProps = false;
+
+	m_obstructionTestRayNums[requestNum] = kNoRays;
+	m_obstructionRayNums[requestNum] = kNoRays;
+	m_reuseTestRayNums[requestNum] = kNoRays;
+	m_primaryRayNums[requestNum] = kNoRays;
+	m_secondaryRayNums[requestNum] = kNoRays;
+	m_numSecondaryRays[requestNum] = 0;
+
+	if( !request.needsDirectObstruction ) {
+		result->directObstruction = 0.9f;
+	} else if( DistanceSquared( m_testedListenerOrigin, request.origin ) < 32.0f * 32.0f ) {
+		// Shortcut for sounds relative to the player
+		result->directObstruction = 0.0f;
+	} else if( !S_LeafsInPVS( m_listenerLeafNum, result->leafNum ) ) {
+		result->directObstruction = 1.0f;
+	} else {
+		vec3_t hintBounds[2];
+		ClearBounds( hintBounds[0], hintBounds[1] );
+		AddPointToBounds( m_testedListenerOrigin, hintBounds[0], hintBounds[1] );
+		AddPointToBounds( request.origin, hintBounds[0], hintBounds[1] );
+		// Account for obstruction sampling offsets
+		// as we are going to compute the top node hint once
+		for( int i = 0; i < 3; ++i ) {
+			hintBounds[0][i] -= DirectObstructionOffsetsHolder::MAX_OFFSET;
+			hintBounds[1][i] += DirectObstructionOffsetsHolder::MAX_OFFSET;
+		}
+
+		m_obstructionTopNodeHints[requestNum] = S_FindTopNodeForBox( hintBounds[0], hintBounds[1] );
+		m_rays.beginPacket( MASK_SOLID, m_obstructionTopNodeHints[requestNum] );
+		m_obstructionTestRayNums[requestNum] = m_rays.addRay( m_testedListenerOrigin, request.origin );
+	}
+
+	if( request.reusePropsRequestNum < 0 ) {
+		return;
+	}
+
+	// We are already sure that both sources are in the same contents kind (non-liquid).
+	// Check distance between sources.
+	const float *const reuseOrigin = m_requests[request.reusePropsRequestNum].origin;
+	const float squareDistance = DistanceSquared( reuseOrigin, request.origin );
+	// If they are way too far for reusing
+	if( squareDistance > 96 * 96 ) {
+		return;
+	}
 
-	numPassedRays = 0;
-	numTestedRays = updateState->directObstructionSamplingProps.numSamples;
-	valueIndex = updateState->directObstructionSamplingProps.valueIndex;
-	for( unsigned i = 0; i < numTestedRays; i++ ) {
-		valueIndex = ( valueIndex + 1 ) % DirectObstructionOffsetsHolder::NUM_VALUES;
-		originOffset = directObstructionOffsetsHolder.offsets[ valueIndex ];
-
-		VectorAdd( src->origin, originOffset, testedSourceOrigin );
-		S_Trace( &trace, testedListenerOrigin, testedSourceOrigin, vec3_origin, vec3_origin, MASK_SOLID, topNodeHint );
-		if( trace.fraction == 1.0f && !trace.startsolid ) {
-			numPassedRays++;
+	// If they are very close, feel free to just copy props
+	if( squareDistance <= 4.0f * 4.0f ) {
+		result->hasReusedProps = true;
+		return;
+	}
+
+	// Do a coarse raycast test between these two sources
+	vec3_t start, end, dir;
+	VectorSubtract( reuseOrigin, request.origin, dir );
+	const float invDistance = 1.0f / sqrtf( squareDistance );
+	VectorScale( dir, invDistance, dir );
+	// Offset start and end by a dir unit.
+	// Ensure start and end are in "air" and not on a brush plane
+	VectorAdd( request.origin, dir, start );
+	VectorSubtract( reuseOrigin, dir, end );
+
+	m_rays.beginPacket( MASK_SOLID );
+	m_reuseTestRayNums[requestNum] = m_rays.addRay( start, end );
+}
+
+void EnvSamplingBatch::addObstructionAndPrimaryRays( unsigned requestNum ) {
+	const EnvSamplingRequest &request = m_requests[requestNum];
+	EnvSamplingResult *const result = &m_results[requestNum];
+
+	if( const unsigned testRayNum = m_obstructionTestRayNums[requestNum]; testRayNum != kNoRays ) {
+		if( m_rays.hasPassed( testRayNum ) ) {
+			// Consider zero obstruction in this case
+			result->directObstruction = 0.0f;
+		} else {
+			m_rays.beginPacket( MASK_SOLID, m_obstructionTopNodeHints[requestNum] );
+			unsigned valueIndex = request.obstructionValueIndex;
+			for( unsigned i = 0; i < request.numObstructionRays; ++i ) {
+				valueIndex = ( valueIndex + 1 ) % DirectObstructionOffsetsHolder::NUM_VALUES;
+				const float *originOffset = directObstructionOffsetsHolder.offsets[valueIndex];
+
+				vec3_t testedSourceOrigin;
+				VectorAdd( request.origin, originOffset, testedSourceOrigin );
+				const unsigned rayNum = m_rays.addRay( m_testedListenerOrigin, testedSourceOrigin );
+				if( !i ) {
+					m_obstructionRayNums[requestNum] = rayNum;
+				}
+			}
 		}
 	}
 
-	return 1.0f - 0.9f * ( numPassedRays / (float)numTestedRays );
+	if( const unsigned testRayNum = m_reuseTestRayNums[requestNum]; testRayNum != kNoRays ) {
+		result->hasReusedProps = m_rays.getTrace( testRayNum ).fraction == 1.0f;
+	}
+
+	// Reverberation sampling is extremely expensive, so it's skipped if props could be reused
+	if( request.isUnderwater || result->hasReusedProps ) {
+		return;
+	}
+
+	const float emissionRadius = getEmissionRadius( request );
+	// Using top node hints is quite beneficial for small emission radii.
+	m_rays.beginPacket( MASK_SOLID | MASK_WATER, S_FindTopNodeForSphere( request.origin, emissionRadius ) );
+	for( unsigned i = 0; i < m_numPrimaryRays; ++i ) {
+		vec3_t testedRayPoint;
+		VectorMA( request.origin, emissionRadius, m_primaryRayDirs[i], testedRayPoint );
+		const unsigned rayNum = m_rays.addRay( request.origin, testedRayPoint );
+		if( !i ) {
+			m_primaryRayNums[requestNum] = rayNum;
+		}
+	}
+	result->numPrimaryRays = m_numPrimaryRays;
 }
 
-Effect *ReverbEffectSampler::TryApply( const ListenerProps &listenerProps, src_t *src, const src_t *tryReusePropsSrc ) {
-	EaxReverbEffect *effect = EffectsAllocator::Instance()->NewReverbEffect( src );
-	effect->directObstruction = ComputeDirectObstruction( listenerProps, src );
-	// We try reuse props only for reverberation effects
-	// since reverberation effects sampling is extremely expensive.
-	// Moreover, direct obstruction reuse is just not valid,
-	// since even a small origin difference completely changes it.
-	if( ENV_TryReuseSourceReverbProps( src, tryReusePropsSrc, effect ) ) {
-		src->envUpdateState.needsInterpolation = false;
-	} else {
-		ComputeReverberation( listenerProps, src, effect );
+void EnvSamplingBatch::addSecondaryRays( unsigned requestNum ) {
+	if( m_primaryRayNums[requestNum] == kNoRays ) {
+		return;
 	}
-	return effect;
+
+	const EnvSamplingRequest &request = m_requests[requestNum];
+	EnvSamplingResult *const result = &m_results[requestNum];
+
+	unsigned numPrimaryHits = 0;
+	for( unsigned i = 0; i < m_numPrimaryRays; ++i ) {
+		const trace_t &trace = m_rays.getTrace( m_primaryRayNums[requestNum] + i );
+		if( trace.startsolid || trace.allsolid ) {
+			continue;
+		}
+		if( trace.fraction == 1.0f ) {
+			continue;
+		}
+		if( trace.surfFlags & ( SURF_SKY | SURF_NOIMPACT | SURF_NOMARKS | SURF_FLESH | SURF_NOSTEPS ) ) {
+			continue;
+		}
+		if( DistanceSquared( request.origin, trace.endpos ) < 2 * 2 ) {
+			continue;
+		}
+
+		// Do not use the trace.endpos exactly as a source of a reflected wave.
+		// (a following trace call would probably fail for this start origin).
+		// Add -sampleDir offset to the trace.endpos
+		VectorSubtract( trace.endpos, m_primaryRayDirs[i], result->reflectionPoints[numPrimaryHits] );
+		numPrimaryHits++;
+	}
+
+	result->numPrimaryHits = numPrimaryHits;
+
+	unsigned numSecondaryRays = 0;
+	for( unsigned i = 0; i < numPrimaryHits; ++i ) {
+		float *const point = result->reflectionPoints[i];
+		// Cut off by PVS system early, we are not interested in actual ray hit points contrary to the primary emission.
+		if( !S_LeafsInPVS( m_listenerLeafNum, S_PointLeafNum( point ) ) ) {
+			continue;
+		}
+		// Keep points of tested rays first
+		if( numSecondaryRays != i ) {
+			VectorCopy( point, result->reflectionPoints[numSecondaryRays] );
+		}
+		// Secondary rays share the end point, so they form a coherent packet
+		if( !numSecondaryRays ) {
+			m_rays.beginPacket( MASK_SOLID );
+		}
+		const unsigned rayNum = m_rays.addRay( result->reflectionPoints[numSecondaryRays], m_testedListenerOrigin );
+		if( !numSecondaryRays ) {
+			m_secondaryRayNums[requestNum] = rayNum;
+		}
+		numSecondaryRays++;
+	}
+
+	m_numSecondaryRays[requestNum] = numSecondaryRays;
 }
 
-float ReverbEffectSampler::GetEmissionRadius() const {
+void EnvSamplingBatch::computeResults( unsigned requestNum ) {
+	const EnvSamplingRequest &request = m_requests[requestNum];
+	EnvSamplingResult *const result = &m_results[requestNum];
+
+	if( const unsigned firstRayNum = m_obstructionRayNums[requestNum]; firstRayNum != kNoRays ) {
+		unsigned numPassedRays = 0;
+		for( unsigned i = 0; i < request.numObstructionRays; ++i ) {
+			if( m_rays.hasPassed( firstRayNum + i ) ) {
+				numPassedRays++;
+			}
+		}
+		result->directObstruction = 1.0f - 0.9f * ( numPassedRays / (float)request.numObstructionRays );
+	}
+
+	if( !result->numPrimaryHits ) {
+		return;
+	}
+
+	unsigned numPassedSecondaryRays = 0;
+	for( unsigned i = 0; i < m_numSecondaryRays[requestNum]; ++i ) {
+		if( m_rays.hasPassed( m_secondaryRayNums[requestNum] + i ) ) {
+			VectorCopy( result->reflectionPoints[i], result->reflectionPoints[numPassedSecondaryRays] );
+			numPassedSecondaryRays++;
+		}
+	}
+
+	result->numPassedSecondaryRays = numPassedSecondaryRays;
+	// The secondary rays obstruction is complement to the fraction of passed rays
+	result->secondaryRaysObstruction = 1.0f - numPassedSecondaryRays / (float)result->numPrimaryHits;
+}
+
+auto EnvSamplingBatch::getEmissionRadius( const EnvSamplingRequest &request ) const -> float {
 	// Do not even bother casting rays 999999 units ahead for very attenuated sources.
 	// However, clamp/normalize the hit distance using the same defined threshold
-	float attenuation = src->attenuation;
+	float attenuation = request.attenuation;
 
 	if( attenuation <= 1.0f ) {
 		return 999999.9f;
@@ -218,15 +368,20 @@ float ReverbEffectSampler::GetEmissionRadius() const {
 	return distance;
 }
 
-void ReverbEffectSampler::ResetMutableState( const ListenerProps &listenerProps_, src_t *src_, EaxReverbEffect *effect_ ) {
-	this->listenerProps = &listenerProps_;
-	this->src = src_;
-	this->effect = effect_;
+void EffectSamplers::SetupRequest( const ListenerProps &listenerProps, src_t *src, EnvSamplingRequest *request ) {
+	VectorCopy( src->origin, request->origin );
+	request->attenuation = src->attenuation;
+	request->reusePropsRequestNum = -1;
 
-	GenericRaycastSampler::ResetMutableState( primaryRayDirs, reflectionPoints, primaryHitDistances, src->origin );
+	const bool isSrcInLiquid = src->envUpdateState.isInLiquid;
+	request->isUnderwater = listenerProps.isInLiquid || isSrcInLiquid;
+	request->hasMediumTransition = listenerProps.isInLiquid ^ isSrcInLiquid;
+	// The obstruction of underwater sounds is sampled only if both the listener and the source are in liquid
+	request->needsDirectObstruction = !request->isUnderwater || ( listenerProps.isInLiquid && isSrcInLiquid );
 
-	VectorCopy( listenerProps_.origin, testedListenerOrigin );
-	testedListenerOrigin[2] += 18.0f;
+	SetupDirectObstructionSamplingProps( src, 3, MAX_DIRECT_OBSTRUCTION_SAMPLES );
+	request->numObstructionRays = src->envUpdateState.directObstructionSamplingProps.numSamples;
+	request->obstructionValueIndex = src->envUpdateState.directObstructionSamplingProps.valueIndex;
 }
 
 class CachedPresetTracker {
@@ -312,29 +467,7 @@ static CachedPresetTracker g_tinyMetallicRoomPreset { "s_tinyMetallicRoomPreset"
 static CachedPresetTracker g_largeMetallicRoomPreset { "s_largeMetallicRoomPreset", "factory_largeroom factory_mediumroom" };
 static CachedPresetTracker g_hugeMetallicRoomPreset { "s_hugeMetallicRoomPreset", "factory_hall factory_hall hangar" };
 
-void ReverbEffectSampler::ComputeReverberation( const ListenerProps &listenerProps_,
-												src_t *src_,
-												EaxReverbEffect *effect_ ) {
-	ResetMutableState( listenerProps_, src_, effect_ );
-
-	numPrimaryRays = GetNumSamplesForCurrentQuality( 16, MAX_REVERB_PRIMARY_RAY_SAMPLES );
-
-	SetupPrimaryRayDirs();
-
-	EmitPrimaryRays();
-
-	if( !numPrimaryHits ) {
-		// Keep existing values (they are valid by default now)
-		return;
-	}
-
-	// Instead of trying to compute these factors every sampling call,
-	// reuse pre-computed properties of CM map leafs that briefly resemble rooms/convex volumes.
-	assert( src->envUpdateState.leafNum >= 0 );
-
-	const auto *const leafPropsCache = LeafPropsCache::Instance();
-	const LeafProps &leafProps = leafPropsCache->GetPropsForLeaf( src->envUpdateState.leafNum );
-
+static void ComputeReverbProps( const LeafProps &leafProps, EfxReverbProps *reverbProps ) {
 	EfxReverbProps openProps { EfxReverbProps::NoInit };
 	EfxReverbProps closedMetallicProps { EfxReverbProps::NoInit };
 	EfxReverbProps closedNonMetallicProps { EfxReverbProps::NoInit };
@@ -402,11 +535,11 @@ void ReverbEffectSampler::ComputeReverberation( const ListenerProps &listenerPro
 	EfxReverbProps closedProps { EfxReverbProps::NoInit };
 	lerpReverbProps( &closedNonMetallicProps, leafProps.getMetallnessFactor(), &closedMetallicProps, &closedProps );
 
-	lerpReverbProps( &closedProps, leafProps.getSkyFactor(), &openProps, &effect->reverbProps );
+	lerpReverbProps( &closedProps, leafProps.getSkyFactor(), &openProps, reverbProps );
 
 	// Tone it down, in general and especially for open and/or reflective environment and/or long decay time
 
-	const float decayTime                 = effect->reverbProps.decayTime;
+	const float decayTime                 = reverbProps->decayTime;
 	const float decayTimeForMinGain       = 5.0f;
 	const float decayAttenuationFrac      = wsw::min( 1.0f, decayTime * ( 1.0f / decayTimeForMinGain ) );
 	const float skyAttenuationFrac        = leafProps.getSkyFactor();
@@ -418,49 +551,57 @@ void ReverbEffectSampler::ComputeReverberation( const ListenerProps &listenerPro
 	constexpr float minAttenuation = 1.0f;
 	constexpr float maxAttenuation = 0.5f;
 	static_assert( AL_EAXREVERB_MIN_GAIN == 0.0f );
-	effect->reverbProps.gain *= minAttenuation - ( minAttenuation - maxAttenuation ) * attenuationFrac;
+	reverbProps->gain *= minAttenuation - ( minAttenuation - maxAttenuation ) * attenuationFrac;
 	static_assert( AL_EAXREVERB_MIN_DECAY_HFRATIO > 0.0f );
-	effect->reverbProps.decayHfRatio = wsw::max( AL_EAXREVERB_MIN_DECAY_HFRATIO, 0.6f * effect->reverbProps.decayHfRatio );
+	reverbProps->decayHfRatio = wsw::max( AL_EAXREVERB_MIN_DECAY_HFRATIO, 0.6f * reverbProps->decayHfRatio );
 
-	EmitSecondaryRays();
 }
 
-void ReverbEffectSampler::SetupPrimaryRayDirs() {
-	assert( numPrimaryRays );
+Effect *EffectSamplers::MakeEffect( src_t *src, const EnvSamplingRequest &request,
+									const EnvSamplingResult &result, const src_t *reusePropsSrc ) {
+	auto *const effectsAllocator = EffectsAllocator::Instance();
+	if( request.isUnderwater ) {
+		auto *effect = effectsAllocator->NewFlangerEffect( src );
+		effect->directObstruction = result.directObstruction;
+		effect->hasMediumTransition = request.hasMediumTransition;
+		return effect;
+	}
 
-	SetupSamplingRayDirs( primaryRayDirs, numPrimaryRays );
-}
+	EaxReverbEffect *effect = effectsAllocator->NewReverbEffect( src );
+	effect->directObstruction = result.directObstruction;
+
+	if( result.hasReusedProps ) {
+		// Reusing props is allowed only if the other source has been updated by this batch as well
+		if( reusePropsSrc ) {
+			if( const auto *reuseEffect = Effect::Cast<const EaxReverbEffect *>( reusePropsSrc->envUpdateState.effect ) ) {
+				effect->directObstruction        = reuseEffect->directObstruction;
+				effect->secondaryRaysObstruction = reuseEffect->secondaryRaysObstruction;
+				effect->reverbProps              = reuseEffect->reverbProps;
+				src->envUpdateState.needsInterpolation = false;
+			}
+		}
+		return effect;
+	}
 
-void ReverbEffectSampler::EmitSecondaryRays() {
-	int listenerLeafNum = listenerProps->GetLeafNum();
+	if( !result.numPrimaryHits ) {
+		// Keep existing values (they are valid by default now)
+		return effect;
+	}
 
-	auto *const panningUpdateState = &src->panningUpdateState;
-	panningUpdateState->numPrimaryRays = numPrimaryRays;
+	// Instead of trying to compute these factors every sampling call,
+	// reuse pre-computed properties of CM map leafs that briefly resemble rooms/convex volumes.
+	assert( result.leafNum >= 0 );
 
-	trace_t trace;
+	const auto *const leafPropsCache = LeafPropsCache::Instance();
+	ComputeReverbProps( leafPropsCache->GetPropsForLeaf( result.leafNum ), &effect->reverbProps );
 
-	unsigned numPassedSecondaryRays = 0;
-	panningUpdateState->numPassedSecondaryRays = 0;
-	for( unsigned i = 0; i < numPrimaryHits; i++ ) {
-		// Cut off by PVS system early, we are not interested in actual ray hit points contrary to the primary emission.
-		if( !S_LeafsInPVS( listenerLeafNum, S_PointLeafNum( reflectionPoints[i] ) ) ) {
-			continue;
-		}
+	effect->secondaryRaysObstruction = result.secondaryRaysObstruction;
 
-		S_Trace( &trace, reflectionPoints[i], testedListenerOrigin, vec3_origin, vec3_origin, MASK_SOLID );
-		if( trace.fraction == 1.0f && !trace.startsolid ) {
-			numPassedSecondaryRays++;
-			float *savedPoint = panningUpdateState->reflectionPoints[panningUpdateState->numPassedSecondaryRays++];
-			VectorCopy( reflectionPoints[i], savedPoint );
-		}
-	}
+	auto *const panningUpdateState = &src->panningUpdateState;
+	panningUpdateState->numPrimaryRays = result.numPrimaryRays;
+	panningUpdateState->numPassedSecondaryRays = result.numPassedSecondaryRays;
+	std::memcpy( panningUpdateState->reflectionPoints, result.reflectionPoints,
+				 result.numPassedSecondaryRays * sizeof( vec3_t ) );
 
-	if( numPrimaryHits ) {
-		float frac = numPassedSecondaryRays / (float)numPrimaryHits;
-		// The secondary rays obstruction is complement to the `frac`
-		effect->secondaryRaysObstruction = 1.0f - frac;
-	} else {
-		// Set minimal feasible values
-		effect->secondaryRaysObstruction = 1.0f;
-	}
-}
\ No newline at end of file
+	return effect;
+}
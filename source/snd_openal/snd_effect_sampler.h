@@ -4,6 +4,8 @@
 #include "snd_raycast_sampler.h"
 #include "snd_env_effects.h"
 
+#include "../qcommon/wswvector.h"
+
 struct ListenerProps {
 	vec3_t origin;
 	vec3_t velocity;
@@ -22,67 +24,159 @@ struct ListenerProps {
 	}
 };
 
-class EffectSampler {
-protected:
-	static unsigned GetNumSamplesForCurrentQuality( unsigned minSamples, unsigned maxSamples ) {
-		float quality = s_environment_sampling_quality->value;
+constexpr const auto MAX_DIRECT_OBSTRUCTION_SAMPLES = 8;
+// Almost doubled for "realistic obstruction" (we need more secondary rays)
+constexpr const auto MAX_REVERB_PRIMARY_RAY_SAMPLES = 80;
 
-		assert( quality >= 0.0f && quality <= 1.0f );
-		assert( minSamples < maxSamples );
+/**
+ * Rays that are traced together.
+ * Rays are grouped in packets that share the contents mask and the top node hint.
+ * Rays of a packet should be close to each other (e.g. share the start point) as they share BSP traversal.
+ */
+class EnvSamplingRays {
+public:
+	void clear();
 
-		auto numSamples = (unsigned)( minSamples + ( maxSamples - minSamples ) * quality );
-		assert( numSamples && numSamples <= maxSamples );
-		return numSamples;
-	}
+	void beginPacket( int contentsMask, int topNodeHint = 0 );
 
-	virtual Effect *TryApply( const ListenerProps &listenerProps, src_t *src, const src_t *tryReusePropsSrc ) = 0;
-};
+	[[nodiscard]]
+	auto addRay( const float *start, const float *end ) -> unsigned;
 
-class EffectSamplers {
-public:
-	// Would be nice just have a method of the same signature in Effect scope but static.
-	// Unfortunately there is no companion objects like in Scala/Kotlin.
-	static Effect *TryApply( const ListenerProps &listenerProps, src_t *src, const src_t *tryReusePropsSrc );
-	static float SamplingRandom();
+	/**
+	 * Traces packets that have been added since the last call. Packets are distributed over workers.
+	 */
+	void trace();
+
+	[[nodiscard]]
+	auto getTrace( unsigned rayNum ) const -> const trace_t & { return m_traces[rayNum]; }
+	[[nodiscard]]
+	bool hasPassed( unsigned rayNum ) const {
+		return m_traces[rayNum].fraction == 1.0f && !m_traces[rayNum].startsolid;
+	}
+private:
+	struct Packet {
+		unsigned firstRayNum;
+		unsigned numRays;
+		int contentsMask;
+		int topNodeHint;
+	};
+
+	void tracePacket( const Packet &packet );
+
+	wsw::Vector<Packet> m_packets;
+	// Components of points are stored contiguously
+	wsw::Vector<float> m_starts;
+	wsw::Vector<float> m_ends;
+	wsw::Vector<trace_t> m_traces;
+	unsigned m_numTracedPackets { 0 };
 };
 
-class ObstructedEffectSampler: public virtual EffectSampler {
-protected:
-	void SetupDirectObstructionSamplingProps( src_t *src, unsigned minSamples, unsigned maxSamples );
+/**
+ * Parameters of environment sampling of a source that are captured by the backend thread.
+ */
+struct EnvSamplingRequest {
+	vec3_t origin;
+	float attenuation;
+	unsigned numObstructionRays;
+	unsigned obstructionValueIndex;
+	// A number of a previous request of the same sound which reverb props could be reused, -1 if there's no such request
+	int reusePropsRequestNum;
+	bool isUnderwater;
+	bool hasMediumTransition;
+	bool needsDirectObstruction;
+};
 
-	float ComputeDirectObstruction( const ListenerProps &listenerProps, src_t *src );
+struct EnvSamplingResult {
+	// Points of reflection of primary rays that are visible from the listener
+	vec3_t reflectionPoints[MAX_REVERB_PRIMARY_RAY_SAMPLES];
+	unsigned numPassedSecondaryRays;
+	unsigned numPrimaryRays;
+	unsigned numPrimaryHits;
+	int leafNum;
+	float directObstruction;
+	float secondaryRaysObstruction;
+	bool hasReusedProps;
 };
 
-class UnderwaterFlangerEffectSampler final: public ObstructedEffectSampler {
+/**
+ * Environment sampling of a batch of sources.
+ * Rays of all sources of the batch are built up front and are traced together in a few stages.
+ * Requests are filled and results are consumed by the backend thread.
+ * The sampling itself does not access sources, so it could be performed by a worker thread.
+ */
+class EnvSamplingBatch {
 public:
-	Effect *TryApply( const ListenerProps &listenerProps, src_t *src, const src_t *tryReusePropsSrc ) override;
-};
+	static constexpr unsigned kMaxRequests = 32;
 
-constexpr const auto MAX_DIRECT_OBSTRUCTION_SAMPLES = 8;
-// Almost doubled for "realistic obstruction" (we need more secondary rays)
-constexpr const auto MAX_REVERB_PRIMARY_RAY_SAMPLES = 80;
+	void clear( const ListenerProps &listenerProps );
+
+	[[nodiscard]]
+	bool empty() const { return !m_numRequests; }
+	[[nodiscard]]
+	bool full() const { return m_numRequests == kMaxRequests; }
+	[[nodiscard]]
+	auto size() const -> unsigned { return m_numRequests; }
+
+	[[nodiscard]]
+	auto addRequest() -> EnvSamplingRequest * {
+		assert( !full() );
+		return &m_requests[m_numRequests++];
+	}
+
+	[[nodiscard]]
+	auto getRequest( unsigned requestNum ) const -> const EnvSamplingRequest & { return m_requests[requestNum]; }
+	[[nodiscard]]
+	auto getResult( unsigned requestNum ) const -> const EnvSamplingResult & { return m_results[requestNum]; }
 
-class ReverbEffectSampler final: public ObstructedEffectSampler, private GenericRaycastSampler {
+	void sample();
 private:
-	vec3_t primaryRayDirs[MAX_REVERB_PRIMARY_RAY_SAMPLES];
-	vec3_t reflectionPoints[MAX_REVERB_PRIMARY_RAY_SAMPLES];
-	float primaryHitDistances[MAX_REVERB_PRIMARY_RAY_SAMPLES];
-	vec3_t testedListenerOrigin;
+	static constexpr unsigned kNoRays = ~0u;
+
+	void addInitialRays( unsigned requestNum );
+	void addObstructionAndPrimaryRays( unsigned requestNum );
+	void addSecondaryRays( unsigned requestNum );
+	void computeResults( unsigned requestNum );
+
+	[[nodiscard]]
+	auto getEmissionRadius( const EnvSamplingRequest &request ) const -> float;
+
+	vec3_t m_testedListenerOrigin;
+	int m_listenerLeafNum { 0 };
 
-	const ListenerProps *listenerProps;
-	src_t * src;
-	EaxReverbEffect * effect;
+	vec3_t m_primaryRayDirs[MAX_REVERB_PRIMARY_RAY_SAMPLES];
+	unsigned m_numPrimaryRays { 0 };
 
-	void ComputeReverberation( const ListenerProps &listenerProps_, src_t *src_, EaxReverbEffect *effect_ );
+	EnvSamplingRequest m_requests[kMaxRequests];
+	EnvSamplingResult m_results[kMaxRequests];
+	unsigned m_numRequests { 0 };
 
-	void ResetMutableState( const ListenerProps &listenerProps_, src_t *src_, EaxReverbEffect *effect_ );
+	// Numbers of first rays of respective kinds for every request
+	unsigned m_obstructionTestRayNums[kMaxRequests];
+	unsigned m_obstructionRayNums[kMaxRequests];
+	unsigned m_reuseTestRayNums[kMaxRequests];
+	unsigned m_primaryRayNums[kMaxRequests];
+	unsigned m_secondaryRayNums[kMaxRequests];
+	unsigned m_numSecondaryRays[kMaxRequests];
+	int m_obstructionTopNodeHints[kMaxRequests];
 
-	float GetEmissionRadius() const override;
-	void SetupPrimaryRayDirs();
-	void EmitSecondaryRays();
+	EnvSamplingRays m_rays;
+};
 
+class EffectSamplers {
 public:
-	Effect *TryApply( const ListenerProps &listenerProps, src_t *src, const src_t *tryReusePropsSrc ) override;
+	/**
+	 * Captures parameters of a source that are required for environment sampling.
+	 */
+	static void SetupRequest( const ListenerProps &listenerProps, src_t *src, EnvSamplingRequest *request );
+
+	/**
+	 * Creates an effect of the source using results of the sampling.
+	 * @param reusePropsSrc a source that has been updated by the request that is referred as reusable by this request
+	 */
+	static Effect *MakeEffect( src_t *src, const EnvSamplingRequest &request,
+							   const EnvSamplingResult &result, const src_t *reusePropsSrc );
+
+	static float SamplingRandom();
 };
 
-#endif
+#endif
\ No newline at end of file
@@ -74,8 +74,6 @@ public:
 struct EfxPresetEntry;
 
 class EaxReverbEffect final: public Effect {
-	friend class ReverbEffectSampler;
-
 	void UpdateDelegatedSpatialization( struct src_s *src, const vec3_t listenerOrigin );
 
 	vec3_t tmpSourceOrigin { 0, 0, 0 };
@@ -7,6 +7,7 @@
 #include "snd_propagation.h"
 
 #include "../gameshared/q_comref.h"
+#include "../qcommon/jobsystem.h"
 
 #include <algorithm>
 #include <limits>
@@ -15,6 +16,29 @@ ListenerProps listenerProps;
 
 static_assert( PanningUpdateState::MAX_POINTS == MAX_REVERB_PRIMARY_RAY_SAMPLES, "" );
 
+// While a batch is being sampled by a worker, results of the previous one are applied by the backend
+static EnvSamplingBatch g_samplingBatches[2];
+
+// Sources of requests of respective batches and their registration serials at the moment of capture
+struct CapturedSource {
+	src_t *src;
+	unsigned registrationSerial;
+};
+
+static CapturedSource g_capturedSources[2][EnvSamplingBatch::kMaxRequests];
+
+static int g_pendingBatchNum = -1;
+static wsw::JobSystem::Counter g_pendingBatchCounter;
+
+static int ENV_WaitForPendingBatch() {
+	const int batchNum = g_pendingBatchNum;
+	if( batchNum >= 0 ) {
+		wsw::JobSystem::instance()->waitFor( &g_pendingBatchCounter );
+		g_pendingBatchNum = -1;
+	}
+	return batchNum;
+}
+
 static void ENV_ShutdownGlobalInstances() {
 	LeafPropsCache::Shutdown();
 	CachedLeafsGraph::Shutdown();
@@ -54,6 +78,8 @@ void ENV_Shutdown() {
 		return;
 	}
 
+	ENV_CancelPendingUpdates();
+
 	ENV_ShutdownGlobalInstances();
 
 	listenerProps.InvalidateCachedUpdateState();
@@ -67,7 +93,13 @@ void ENV_EndRegistration() {
 	ENV_DispatchEnsureValidCall();
 }
 
+void ENV_CancelPendingUpdates() {
+	// Results of the pending batch are just discarded
+	(void)ENV_WaitForPendingBatch();
+}
+
 void ENV_RegisterSource( src_t *src ) {
+	src->envUpdateState.registrationSerial++;
 	// Invalidate last update when reusing the source
 	// (otherwise it might be misused for props interpolation)
 	src->envUpdateState.lastEnvUpdateAt = 0;
@@ -84,6 +116,8 @@ void ENV_UnregisterSource( src_t *src ) {
 
 	// Prevent later occasional updates
 	src->envUpdateState.nextEnvUpdateAt = std::numeric_limits<int64_t>::max();
+	// Discard results of sampling that is in progress
+	src->envUpdateState.registrationSerial++;
 
 	if( src->envUpdateState.effect || src->envUpdateState.oldEffect ) {
 		auto *const effectsAllocator = EffectsAllocator::Instance();
@@ -136,7 +170,9 @@ static SourcesUpdatePriorityQueue sourcesUpdatePriorityQueue;
 
 static void ENV_ProcessUpdatesPriorityQueue();
 
-static void ENV_UpdateSourceEnvironment( src_t *src, int64_t millisNow, const src_t *tryReusePropsSrc );
+static void ENV_ScheduleNextUpdate( src_t *src, int64_t millisNow );
+
+static void ENV_ApplySamplingResults( int batchNum, int64_t millisNow );
 
 static inline void ENV_CollectForcedEnvironmentUpdates() {
 	src_t *src, *end;
@@ -270,38 +306,61 @@ src_t *SourcesUpdatePriorityQueue::PopSource() {
 }
 
 static void ENV_ProcessUpdatesPriorityQueue() {
-	const uint64_t micros = Sys_Microseconds();
-	const int64_t millis = (int64_t)( micros / 1000 );
+	const int64_t millis = Sys_Milliseconds();
 	src_t *src;
 
 	listenerProps.InvalidateCachedUpdateState();
 
+	// Sampling of the batch that has been submitted the last frame is likely to be completed at this moment
+	const int finishedBatchNum = ENV_WaitForPendingBatch();
+
+	const int batchNum = finishedBatchNum >= 0 ? ( finishedBatchNum ^ 1 ) : 0;
+	EnvSamplingBatch *const batch = &g_samplingBatches[batchNum];
+	CapturedSource *const capturedSources = g_capturedSources[batchNum];
+	batch->clear( listenerProps );
+
+	const EnvSamplingRequest *lastRequest = nullptr;
 	const sfx_t *lastProcessedSfx = nullptr;
-	const src_t *lastProcessedSrc = nullptr;
 	float lastProcessedPriority = std::numeric_limits<float>::max();
-	// Always do at least a single update
-	for( ;; ) {
+	// Sources that do not fit the batch are going to be collected again the next frame
+	while( !batch->full() ) {
 		if( !( src = sourcesUpdatePriorityQueue.PopSource() ) ) {
 			break;
 		}
 
-		const src_t *tryReusePropsSrc = nullptr;
-		if( src->sfx == lastProcessedSfx ) {
-			tryReusePropsSrc = lastProcessedSrc;
-		}
-
 		assert( lastProcessedPriority >= src->envUpdateState.priorityInQueue );
 		lastProcessedPriority = src->envUpdateState.priorityInQueue;
-		lastProcessedSfx = src->sfx;
-		lastProcessedSrc = src;
 
-		ENV_UpdateSourceEnvironment( src, millis, tryReusePropsSrc );
-		// Stop updates if the time quota has been exceeded immediately.
-		// Do not block the commands queue processing.
-		// The priority queue will be rebuilt next ENV_UpdateListenerCall().
-		if( Sys_Microseconds() - micros > 2000 && lastProcessedPriority < 1.0f ) {
-			break;
+		if( src->priority == SRCPRI_LOCAL ) {
+			// Check whether the source has never been updated for this local sound.
+			assert( !src->envUpdateState.nextEnvUpdateAt );
+			ENV_UnregisterSource( src );
+			continue;
 		}
+
+		ENV_ScheduleNextUpdate( src, millis );
+
+		capturedSources[batch->size()] = { src, src->envUpdateState.registrationSerial };
+		EnvSamplingRequest *const request = batch->addRequest();
+		EffectSamplers::SetupRequest( listenerProps, src, request );
+		// Try reusing reverb props of the previous source of the same sound
+		if( src->sfx == lastProcessedSfx && !request->isUnderwater && !lastRequest->isUnderwater ) {
+			request->reusePropsRequestNum = (int)batch->size() - 2;
+		}
+
+		lastProcessedSfx = src->sfx;
+		lastRequest = request;
+	}
+
+	if( !batch->empty() ) {
+		wsw::JobSystem::instance()->submit( []( void *data ) {
+			( (EnvSamplingBatch *)data )->sample();
+		}, batch, &g_pendingBatchCounter );
+		g_pendingBatchNum = batchNum;
+	}
+
+	if( finishedBatchNum >= 0 ) {
+		ENV_ApplySamplingResults( finishedBatchNum, millis );
 	}
 }
 
@@ -394,16 +453,9 @@ static void ENV_InterpolateEnvironmentProps( src_t *src, int64_t millisNow ) {
 	updateState->lastEnvUpdateAt = millisNow;
 }
 
-static void ENV_UpdateSourceEnvironment( src_t *src, int64_t millisNow, const src_t *tryReusePropsSrc ) {
+static void ENV_ScheduleNextUpdate( src_t *src, int64_t millisNow ) {
 	envUpdateState_t *updateState = &src->envUpdateState;
 
-	if( src->priority == SRCPRI_LOCAL ) {
-		// Check whether the source has never been updated for this local sound.
-		assert( !updateState->nextEnvUpdateAt );
-		ENV_UnregisterSource( src );
-		return;
-	}
-
 	if( src->isLooping ) {
 		updateState->nextEnvUpdateAt = (int64_t)( (double)millisNow + 250 + 50 * random() );
 	} else {
@@ -418,29 +470,45 @@ static void ENV_UpdateSourceEnvironment( src_t *src, int64_t millisNow, const sr
 
 	VectorCopy( src->origin, updateState->lastUpdateOrigin );
 	VectorCopy( src->velocity, updateState->lastUpdateVelocity );
+}
 
-	updateState->oldEffect = updateState->effect;
-	updateState->needsInterpolation = true;
+static void ENV_ApplySamplingResults( int batchNum, int64_t millisNow ) {
+	const EnvSamplingBatch &batch = g_samplingBatches[batchNum];
+	const CapturedSource *const capturedSources = g_capturedSources[batchNum];
 
-	// Get the leaf num before the update as it is important for all present tests
-	updateState->leafNum = S_PointLeafNum( src->origin );
+	bool isApplied[EnvSamplingBatch::kMaxRequests];
+	for( unsigned i = 0; i < batch.size(); ++i ) {
+		src_t *const src = capturedSources[i].src;
+		envUpdateState_t *const updateState = &src->envUpdateState;
 
-	updateState->effect = EffectSamplers::TryApply( listenerProps, src, tryReusePropsSrc );
+		// Skip sources that have been stopped or reused for another sound meanwhile
+		isApplied[i] = src->isActive && updateState->registrationSerial == capturedSources[i].registrationSerial;
+		if( !isApplied[i] ) {
+			continue;
+		}
 
-	updateState->effect->distanceAtLastUpdate = sqrtf( DistanceSquared( src->origin, listenerProps.origin ) );
-	updateState->effect->lastUpdateAt = millisNow;
+		const EnvSamplingRequest &request = batch.getRequest( i );
+		const src_t *reusePropsSrc = nullptr;
+		if( request.reusePropsRequestNum >= 0 && isApplied[request.reusePropsRequestNum] ) {
+			reusePropsSrc = capturedSources[request.reusePropsRequestNum].src;
+		}
 
-	if( updateState->needsInterpolation ) {
-		ENV_InterpolateEnvironmentProps( src, millisNow );
-	}
+		updateState->oldEffect = updateState->effect;
+		updateState->needsInterpolation = true;
 
-	// Recycle the old effect
-	EffectsAllocator::Instance()->DeleteEffect( updateState->oldEffect );
-	updateState->oldEffect = nullptr;
+		updateState->effect = EffectSamplers::MakeEffect( src, request, batch.getResult( i ), reusePropsSrc );
 
-	updateState->effect->BindOrUpdate( src );
+		updateState->effect->distanceAtLastUpdate = sqrtf( DistanceSquared( src->origin, listenerProps.origin ) );
+		updateState->effect->lastUpdateAt = millisNow;
 
-	// Prevent reusing an outdated leaf num
-	updateState->leafNum = -1;
-}
+		if( updateState->needsInterpolation ) {
+			ENV_InterpolateEnvironmentProps( src, millisNow );
+		}
+
+		// Recycle the old effect
+		EffectsAllocator::Instance()->DeleteEffect( updateState->oldEffect );
+		updateState->oldEffect = nullptr;
 
+		updateState->effect->BindOrUpdate( src );
+	}
+}
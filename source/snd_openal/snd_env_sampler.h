@@ -11,6 +11,9 @@ void ENV_EndRegistration();
 
 void ENV_UpdateListener( const vec3_t origin, const vec3_t velocity, const mat3_t axes );
 
+// Waits for completion of environment sampling that is in progress and discards its results
+void ENV_CancelPendingUpdates();
+
 void ENV_RegisterSource( struct src_s *src );
 
 void ENV_UnregisterSource( struct src_s *src );
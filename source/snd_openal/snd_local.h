@@ -59,12 +59,14 @@ typedef struct sfx_s {
 						// (the sound will remain playing but in low quality, without effects, etc).
 	bool inMemory;
 	bool isLocked;
+	bool hasLoadFailed; // The file is missing or corrupt, so it should not be reloaded on every use
 } sfx_t;
 
 extern cvar_t *s_volume;
 extern cvar_t *s_musicvolume;
 extern cvar_t *s_sources;
 extern cvar_t *s_stereo2mono;
+extern cvar_t *s_pcmcache;
 
 extern cvar_t *s_doppler;
 extern cvar_t *s_sound_velocity;
@@ -121,6 +123,7 @@ void *S_BackgroundUpdateProc( void *param );
 void S_InitBuffers( void );
 void S_ShutdownBuffers( void );
 void S_SoundList_f( void );
+void S_DecodeBenchmark_f( void );
 void S_UseBuffer( sfx_t *sfx );
 sfx_t *S_FindBuffer( const char *filename );
 void S_MarkBufferFree( sfx_t *sfx );
@@ -130,6 +133,8 @@ void S_ForEachBuffer( const std::function<void( sfx_t *)> &callback );
 
 sfx_t *S_GetBufferById( int id );
 bool S_LoadBuffer( sfx_t *sfx );
+// Decodes sounds in parallel and uploads them in batches. Ids of sounds that are already loaded are skipped.
+void S_LoadBuffers( const int *ids, unsigned numIds );
 bool S_UnloadBuffer( sfx_t *sfx );
 
 typedef struct {
@@ -161,7 +166,8 @@ typedef struct envUpdateState_s {
 	vec3_t lastUpdateOrigin;
 	vec3_t lastUpdateVelocity;
 
-	int leafNum;
+	// Gets incremented on every (un)registration, so results of sampling that is in progress could be discarded
+	unsigned registrationSerial;
 
 	int entNum;
 	float attenuation;
@@ -275,6 +281,7 @@ typedef struct bgTrack_s {
 bool S_InitDecoders( bool verbose );
 void S_ShutdownDecoders( bool verbose );
 void *S_LoadSound( const char *filename, snd_info_t *info );
+bool S_HasSoundFile( const char *filename );
 snd_stream_t *S_OpenStream( const char *filename, bool *delay );
 bool S_ContOpenStream( snd_stream_t *stream );
 int S_ReadStream( snd_stream_t *stream, int bytes, void *buffer );
@@ -290,6 +297,10 @@ unsigned S_GetRawSamplesLength( void );
 void S_Trace( trace_s *tr, const float *start, const float *end, const float *mins,
 			  const float *maxs, int mask, int topNodeHint = 0 );
 
+// Traces rays of points in the world. Successive rays should be close to each other as they share BSP traversal.
+void S_TracePoints( trace_s *traces, const vec3_t *starts, const vec3_t *ends,
+					unsigned numTraces, int mask, int topNodeHint = 0 );
+
 wsw::StringView S_ShaderrefName( int shaderNum );
 
 int S_PointContents( const float *p, int topNodeHint = 0 );
@@ -78,6 +78,7 @@ cvar_t *s_environment_sampling_quality;
 cvar_t *s_effects_number_threshold;
 cvar_t *s_hrtf;
 cvar_t *s_stereo2mono;
+cvar_t *s_pcmcache;
 cvar_t *s_globalfocus;
 
 static void SF_Music_f() {
@@ -113,6 +114,7 @@ bool SoundSystem::init( client_state_t *client, const InitOptions &options ) {
 	s_doppler        = Cvar_Get( "s_doppler", "1.0", CVAR_ARCHIVE );
 	s_sound_velocity = Cvar_Get( "s_sound_velocity", "8500", CVAR_DEVELOPER );
 	s_stereo2mono    = Cvar_Get( "s_stereo2mono", "0", CVAR_ARCHIVE );
+	s_pcmcache       = Cvar_Get( "s_pcmcache", "0", CVAR_ARCHIVE );
 	s_globalfocus    = Cvar_Get( "s_globalfocus", "0", CVAR_ARCHIVE );
 
 	s_environment_effects          = Cvar_Get( "s_environment_effects", "1", CVAR_ARCHIVE | CVAR_LATCH_SOUND );
@@ -222,6 +224,19 @@ void S_Trace( trace_t *tr, const vec3_t start,
 	tr->fraction = 1.0f;
 }
 
+void S_TracePoints( trace_t *traces, const vec3_t *starts, const vec3_t *ends,
+					unsigned numTraces, int mask, int topNodeHint ) {
+	if( const auto *cms = SoundSystem::instance()->getClient()->cms ) {
+		CM_TracePointsInWorld( cms, traces, starts, ends, (int)numTraces, mask, topNodeHint );
+		return;
+	}
+
+	for( unsigned i = 0; i < numTraces; ++i ) {
+		::memset( &traces[i], 0, sizeof( trace_t ) );
+		traces[i].fraction = 1.0f;
+	}
+}
+
 wsw::StringView S_ShaderrefName( int shaderNum ) {
 	const char *s = nullptr;
 	if( const auto *cms = SoundSystem::instance()->getClient()->cms ) {
@@ -0,0 +1,77 @@
+#include "snd_pcmcache.h"
+
+#include <cstring>
+
+namespace wsw::snd {
+
+struct PcmCacheFileHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t pakChecksum;
+	uint32_t rate;
+	uint32_t width;
+	uint32_t channels;
+	uint32_t samples;
+	uint32_t dataSize;
+};
+
+static_assert( sizeof( PcmCacheFileHeader ) == PcmCacheFile::kHeaderSize );
+
+static const char kPcmCacheMagic[4] { 'S', 'P', 'C', 'M' };
+
+auto PcmCacheFile::makePath( const wsw::StringView &soundFileName ) -> wsw::String {
+	wsw::String result( "pcmcache/" );
+	result.append( soundFileName.data(), soundFileName.size() );
+	result.append( ".pcm" );
+	return result;
+}
+
+void PcmCacheFile::writeHeader( const PcmProps &props, uint32_t pakChecksum, uint8_t *header ) {
+	PcmCacheFileHeader fileHeader;
+	std::memcpy( fileHeader.magic, kPcmCacheMagic, 4 );
+	fileHeader.version     = kVersion;
+	fileHeader.pakChecksum = pakChecksum;
+	fileHeader.rate        = props.rate;
+	fileHeader.width       = props.width;
+	fileHeader.channels    = props.channels;
+	fileHeader.samples     = props.samples;
+	fileHeader.dataSize    = props.dataSize;
+	std::memcpy( header, &fileHeader, sizeof( fileHeader ) );
+}
+
+auto PcmCacheFile::parseHeader( const uint8_t *header, size_t fileSize, uint32_t pakChecksum ) -> std::optional<PcmProps> {
+	PcmCacheFileHeader fileHeader;
+	if( fileSize < sizeof( fileHeader ) ) {
+		return std::nullopt;
+	}
+	std::memcpy( &fileHeader, header, sizeof( fileHeader ) );
+	if( std::memcmp( fileHeader.magic, kPcmCacheMagic, 4 ) != 0 ) {
+		return std::nullopt;
+	}
+	if( fileHeader.version != kVersion || fileHeader.pakChecksum != pakChecksum ) {
+		return std::nullopt;
+	}
+	if( fileSize - sizeof( fileHeader ) != fileHeader.dataSize ) {
+		return std::nullopt;
+	}
+	// Only formats that are accepted by OpenAL could be cached
+	if( ( fileHeader.width != 1 && fileHeader.width != 2 ) || ( fileHeader.channels != 1 && fileHeader.channels != 2 ) ) {
+		return std::nullopt;
+	}
+	if( !fileHeader.rate || !fileHeader.dataSize ) {
+		return std::nullopt;
+	}
+	if( (uint64_t)fileHeader.samples * fileHeader.width * fileHeader.channels > fileHeader.dataSize ) {
+		return std::nullopt;
+	}
+
+	PcmProps props;
+	props.rate     = fileHeader.rate;
+	props.width    = fileHeader.width;
+	props.channels = fileHeader.channels;
+	props.samples  = fileHeader.samples;
+	props.dataSize = fileHeader.dataSize;
+	return props;
+}
+
+}
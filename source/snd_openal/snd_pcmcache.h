@@ -0,0 +1,47 @@
+#ifndef WSW_ac460fb8_6d0e_4747_9d9c_3c9ca08c97d3_H
+#define WSW_ac460fb8_6d0e_4747_9d9c_3c9ca08c97d3_H
+
+#include "../qcommon/wswstring.h"
+#include "../qcommon/wswstringview.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace wsw::snd {
+
+struct PcmProps {
+	uint32_t rate { 0 };
+	uint32_t width { 0 };
+	uint32_t channels { 0 };
+	uint32_t samples { 0 };
+	uint32_t dataSize { 0 };
+};
+
+/**
+ * A file of decoded PCM data of a sound, so repeated loads of the sound could skip decoding.
+ * The file is found by the path of the sound file and is validated by the checksum of the pak the sound comes from.
+ * The header is followed by PCM data as it's fed to OpenAL.
+ * @note The data is stored in the native byte order as it's not supposed to be shared between machines.
+ */
+class PcmCacheFile {
+public:
+	static constexpr uint32_t kVersion = 1;
+	static constexpr size_t kHeaderSize = 32;
+
+	[[nodiscard]]
+	static auto makePath( const wsw::StringView &soundFileName ) -> wsw::String;
+
+	static void writeHeader( const PcmProps &props, uint32_t pakChecksum, uint8_t *header );
+
+	/**
+	 * Parses the header of a file of the given size.
+	 * @return nullopt if the header is malformed, outdated, or does not match the checksum or the file size.
+	 */
+	[[nodiscard]]
+	static auto parseHeader( const uint8_t *header, size_t fileSize, uint32_t pakChecksum ) -> std::optional<PcmProps>;
+};
+
+}
+
+#endif
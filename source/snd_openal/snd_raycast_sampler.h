@@ -47,7 +47,7 @@ protected:
 
 		VectorCopy( emissionOrigin_, this->emissionOrigin );
 	}
-
+public:
 	static void SetupSamplingRayDirs( vec3_t *rayDirs, unsigned numRays );
 };
 
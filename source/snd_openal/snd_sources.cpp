@@ -813,6 +813,9 @@ src_t *S_AllocRawSource( int entNum, float fvol, float attenuation, cvar_t *volu
 void S_StopAllSources( void ) {
 	int i;
 
+	// Sounds are stopped prior to releasing the map, make sure it's not accessed by environment sampling
+	ENV_CancelPendingUpdates();
+
 	for( i = 0; i < src_count; i++ )
 		source_kill( &srclist[i] );
 }
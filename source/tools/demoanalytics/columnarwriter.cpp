@@ -0,0 +1,52 @@
+#include "columnarwriter.h"
+
+static bool WriteString( FILE *fp, const std::string &s ) {
+	const auto len = (uint32_t)s.size();
+	return std::fwrite( &len, sizeof( len ), 1, fp ) == 1 && std::fwrite( s.data(), 1, len, fp ) == len;
+}
+
+bool ColumnarTable::writeTo( FILE *fp ) const {
+	const auto numColumns = (uint32_t)m_columns.size();
+	if( !WriteString( fp, m_name ) ) {
+		return false;
+	}
+	if( std::fwrite( &m_numRows, sizeof( m_numRows ), 1, fp ) != 1 ) {
+		return false;
+	}
+	if( std::fwrite( &numColumns, sizeof( numColumns ), 1, fp ) != 1 ) {
+		return false;
+	}
+
+	for( const Column &column: m_columns ) {
+		const auto type = (uint8_t)column.type;
+		if( !WriteString( fp, column.name ) ) {
+			return false;
+		}
+		if( std::fwrite( &type, sizeof( type ), 1, fp ) != 1 ) {
+			return false;
+		}
+		if( std::fwrite( column.data.data(), 1, column.data.size(), fp ) != column.data.size() ) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool WriteColumnarFile( const char *filePath, const ColumnarTable *const *tables, unsigned numTables ) {
+	FILE *fp = std::fopen( filePath, "wb" );
+	if( !fp ) {
+		return false;
+	}
+
+	const uint32_t version = 1;
+	bool result = std::fwrite( "WDAC", 1, 4, fp ) == 4;
+	result = result && std::fwrite( &version, sizeof( version ), 1, fp ) == 1;
+	result = result && std::fwrite( &numTables, sizeof( numTables ), 1, fp ) == 1;
+	for( unsigned i = 0; i < numTables && result; ++i ) {
+		result = tables[i]->writeTo( fp );
+	}
+
+	result = ( std::fclose( fp ) == 0 ) && result;
+	return result;
+}
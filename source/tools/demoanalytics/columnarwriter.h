@@ -0,0 +1,67 @@
+#ifndef WSW_0a45dc93_18ff_49f1_bc3f_6d48018e7a0a_H
+#define WSW_0a45dc93_18ff_49f1_bc3f_6d48018e7a0a_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/**
+ * Accumulates rows of a table column-by-column and dumps them as contiguous arrays.
+ * The file layout is (all integers are little-endian):
+ * <pre>
+ * "WDAC" u32 version u32 numTables
+ * for each table: str name, u64 numRows, u32 numColumns
+ *   for each column: str name, u8 type, then numRows values of the type
+ * </pre>
+ * Strings are prefixed by u32 length. Types are 0 for i32, 1 for f32 and 2 for i64.
+ */
+class ColumnarTable {
+public:
+	enum class Type : uint8_t { I32, F32, I64 };
+private:
+	struct Column {
+		std::string name;
+		Type type;
+		std::vector<uint8_t> data;
+	};
+
+	std::string m_name;
+	std::vector<Column> m_columns;
+	uint64_t m_numRows { 0 };
+
+	template <typename T>
+	void append( unsigned column, T value ) {
+		auto &data = m_columns[column].data;
+		const size_t oldSize = data.size();
+		data.resize( oldSize + sizeof( T ) );
+		std::memcpy( data.data() + oldSize, &value, sizeof( T ) );
+	}
+public:
+	explicit ColumnarTable( std::string name ) : m_name( std::move( name ) ) {}
+
+	[[nodiscard]]
+	auto addColumn( std::string name, Type type ) -> unsigned {
+		m_columns.emplace_back( Column { std::move( name ), type, {} } );
+		return (unsigned)( m_columns.size() - 1 );
+	}
+
+	void setI32( unsigned column, int32_t value ) { append( column, value ); }
+	void setF32( unsigned column, float value ) { append( column, value ); }
+	void setI64( unsigned column, int64_t value ) { append( column, value ); }
+
+	//! Must be called once all columns of a row are set.
+	void endRow() { m_numRows++; }
+
+	[[nodiscard]]
+	auto numRows() const -> uint64_t { return m_numRows; }
+
+	[[nodiscard]]
+	bool writeTo( FILE *fp ) const;
+};
+
+[[nodiscard]]
+bool WriteColumnarFile( const char *filePath, const ColumnarTable *const *tables, unsigned numTables );
+
+#endif
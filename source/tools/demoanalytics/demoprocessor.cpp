@@ -0,0 +1,291 @@
+#include "demoprocessor.h"
+#include "../../gameshared/gs_public.h"
+
+#include <stdexcept>
+#include <zlib.h>
+
+DemoProcessor::DemoProcessor() {
+	using Type = ColumnarTable::Type;
+
+	auto &ec = m_entityColumns;
+	ec.frame      = m_entities.addColumn( "frame", Type::I64 );
+	ec.serverTime = m_entities.addColumn( "serverTime", Type::I64 );
+	ec.number     = m_entities.addColumn( "number", Type::I32 );
+	ec.type       = m_entities.addColumn( "type", Type::I32 );
+	ec.modelindex = m_entities.addColumn( "modelindex", Type::I32 );
+	ec.team       = m_entities.addColumn( "team", Type::I32 );
+	ec.solid      = m_entities.addColumn( "solid", Type::I32 );
+	ec.effects    = m_entities.addColumn( "effects", Type::I32 );
+	for( int i = 0; i < 3; ++i ) {
+		ec.origin[i] = m_entities.addColumn( std::string( "origin" ) + "xyz"[i], Type::F32 );
+	}
+	for( int i = 0; i < 3; ++i ) {
+		ec.angles[i] = m_entities.addColumn( std::string( "angles" ) + "xyz"[i], Type::F32 );
+	}
+
+	auto &pc = m_playerColumns;
+	pc.frame      = m_players.addColumn( "frame", Type::I64 );
+	pc.serverTime = m_players.addColumn( "serverTime", Type::I64 );
+	pc.playerNum  = m_players.addColumn( "playerNum", Type::I32 );
+	pc.povNum     = m_players.addColumn( "povNum", Type::I32 );
+	pc.pmType     = m_players.addColumn( "pmType", Type::I32 );
+	pc.pmFlags    = m_players.addColumn( "pmFlags", Type::I32 );
+	pc.health     = m_players.addColumn( "health", Type::I32 );
+	pc.weapon     = m_players.addColumn( "weapon", Type::I32 );
+	for( int i = 0; i < 3; ++i ) {
+		pc.origin[i] = m_players.addColumn( std::string( "origin" ) + "xyz"[i], Type::F32 );
+	}
+	for( int i = 0; i < 3; ++i ) {
+		pc.velocity[i] = m_players.addColumn( std::string( "velocity" ) + "xyz"[i], Type::F32 );
+	}
+	for( int i = 0; i < 3; ++i ) {
+		pc.viewangles[i] = m_players.addColumn( std::string( "viewangles" ) + "xyz"[i], Type::F32 );
+	}
+
+	// Map bounds are not available, use conservative ones (this costs a few bits of absolute positions)
+	constexpr float kWorldExtent = 65536.0f;
+	const vec3_t worldMins { -kWorldExtent, -kWorldExtent, -kWorldExtent };
+	const vec3_t worldMaxs { +kWorldExtent, +kWorldExtent, +kWorldExtent };
+	MSG_SetupQuantization( &m_quantization, worldMins, worldMaxs );
+
+	memset( m_baselines, 0, sizeof( m_baselines ) );
+	for( int i = 0; i < UPDATE_BACKUP; ++i ) {
+		m_snapshots[i].valid = false;
+		m_snapshots[i].serverFrame = 0;
+		m_snapshots[i].areabytes = sizeof( m_areabits[i] );
+		m_snapshots[i].areabits = m_areabits[i];
+	}
+}
+
+bool DemoProcessor::process( const char *demoPath ) {
+	gzFile gzf = gzopen( demoPath, "rb" );
+	if( !gzf ) {
+		m_error = "Failed to open the file";
+		return false;
+	}
+
+	msg_t msg;
+	MSG_Init( &msg, m_msgBuffer, sizeof( m_msgBuffer ) );
+
+	bool result = true;
+	try {
+		for(;; ) {
+			int32_t msgLen;
+			if( gzread( gzf, &msgLen, sizeof( msgLen ) ) != (int)sizeof( msgLen ) ) {
+				throw std::runtime_error( "Unexpected end of file" );
+			}
+			msgLen = LittleLong( msgLen );
+			if( msgLen == -1 ) {
+				break;
+			}
+			if( msgLen < 0 || msgLen > MAX_MSGLEN ) {
+				throw std::runtime_error( "Illegal message length" );
+			}
+			if( gzread( gzf, m_msgBuffer, (unsigned)msgLen ) != msgLen ) {
+				throw std::runtime_error( "Unexpected end of file" );
+			}
+			msg.cursize = (size_t)msgLen;
+			msg.readcount = 0;
+			parseMessage( &msg );
+		}
+	} catch( std::exception &ex ) {
+		m_error = ex.what();
+		result = false;
+	}
+
+	gzclose( gzf );
+	return result;
+}
+
+void DemoProcessor::parseMessage( msg_t *msg ) {
+	// This mirrors CL_ParseServerMessage() for the subset of commands that could be found in demos
+	while( msg->readcount < msg->cursize ) {
+		const int cmd = MSG_ReadUint8( msg );
+		switch( cmd ) {
+			case svc_nop:
+				break;
+			case svc_servercmd:
+				if( !m_reliable ) {
+					(void)MSG_ReadInt32( msg );
+				}
+				[[fallthrough]];
+			case svc_servercs:
+				(void)MSG_ReadString( msg );
+				break;
+			case svc_serverdata:
+				parseServerData( msg );
+				break;
+			case svc_clcack:
+				// Client demos contain acknowledges of client commands
+				if( m_reliable ) {
+					Com_Error( ERR_DROP, "clack message for reliable client" );
+				}
+				(void)MSG_ReadUintBase128( msg ); // reliable commands acknowledge
+				(void)MSG_ReadUintBase128( msg ); // ucmd acknowledge
+				break;
+			case svc_spawnbaseline:
+				SNAP_ParseBaseline( msg, m_baselines );
+				break;
+			case svc_frame:
+				parseFrame( msg );
+				break;
+			case svc_demoinfo: {
+				(void)MSG_ReadInt32( msg ); // demoinfo length
+				(void)MSG_ReadInt32( msg ); // metadata offset
+				(void)MSG_ReadInt32( msg ); // metadata real size
+				// The metadata is padded to the max size
+				MSG_SkipData( msg, (size_t)MSG_ReadInt32( msg ) );
+				break;
+			}
+			case svc_extension: {
+				(void)MSG_ReadUint8( msg );
+				(void)MSG_ReadUint8( msg );
+				const int len = MSG_ReadInt16( msg );
+				MSG_SkipData( msg, (size_t)len );
+				break;
+			}
+			default:
+				Com_Error( ERR_DROP, "Illegible server message %d", cmd );
+		}
+	}
+
+	if( msg->readcount > msg->cursize ) {
+		Com_Error( ERR_DROP, "Bad server message" );
+	}
+}
+
+void DemoProcessor::parseServerData( msg_t *msg ) {
+	(void)MSG_ReadInt32( msg );  // protocol
+	(void)MSG_ReadInt32( msg );  // servercount
+	(void)MSG_ReadInt16( msg );  // snapFrameTime
+	(void)MSG_ReadInt16( msg );  // playernum
+	(void)MSG_ReadString( msg ); // level name
+
+	const int bitflags = MSG_ReadUint8( msg );
+	m_reliable = ( bitflags & SV_BITFLAGS_RELIABLE ) != 0;
+	if( bitflags & SV_BITFLAGS_HTTP ) {
+		if( bitflags & SV_BITFLAGS_HTTP_BASEURL ) {
+			(void)MSG_ReadString( msg );
+		} else {
+			(void)MSG_ReadInt16( msg );
+		}
+	}
+
+	for( int numPure = MSG_ReadInt16( msg ); numPure > 0; --numPure ) {
+		(void)MSG_ReadString( msg );
+		(void)MSG_ReadInt32( msg );
+	}
+}
+
+void DemoProcessor::parseFrame( msg_t *msg ) {
+	snapshot_t *const oldSnap = m_receivedSnapNum > 0 ? &m_snapshots[m_receivedSnapNum & UPDATE_MASK] : nullptr;
+	const snapshot_t *snap = SNAP_ParseFrame( msg, oldSnap, nullptr, m_snapshots, m_baselines, 0 );
+	if( snap->valid ) {
+		m_receivedSnapNum = snap->serverFrame;
+		if( m_firstServerTime < 0 ) {
+			m_firstServerTime = snap->serverTime;
+		}
+		m_lastServerTime = snap->serverTime;
+		m_numFrames++;
+		addFrameRows( snap );
+		if( m_measureEntityEncoding ) {
+			const snapshot_t *lastEncodedSnap = nullptr;
+			if( m_lastEncodedSnapNum > 0 && snap->serverFrame - m_lastEncodedSnapNum < UPDATE_MASK ) {
+				lastEncodedSnap = &m_snapshots[m_lastEncodedSnapNum & UPDATE_MASK];
+			}
+			measureEntityEncoding( lastEncodedSnap, snap );
+			m_lastEncodedSnapNum = snap->serverFrame;
+		}
+	}
+}
+
+void DemoProcessor::measureEntityEncoding( const snapshot_t *oldSnap, const snapshot_t *snap ) {
+	m_plainEntityBytes += writePacketEntities( oldSnap, snap, nullptr );
+	m_quantizedEntityBytes += writePacketEntities( oldSnap, snap, &m_quantization );
+	m_numEncodedFrames++;
+}
+
+auto DemoProcessor::writePacketEntities( const snapshot_t *oldSnap, const snapshot_t *snap,
+										 const msg_quantization_t *quantization ) -> size_t {
+	msg_t msg;
+	MSG_Init( &msg, m_encodingBuffer, sizeof( m_encodingBuffer ) );
+
+	// This mirrors SNAP_EmitPacketEntities()
+	const int oldNumEntities = oldSnap ? oldSnap->numEntities : 0;
+	int newIndex = 0, oldIndex = 0;
+	while( newIndex < snap->numEntities || oldIndex < oldNumEntities ) {
+		const entity_state_t *newState = nullptr, *oldState = nullptr;
+		int newNum = 9999, oldNum = 9999;
+		if( newIndex < snap->numEntities ) {
+			newState = &snap->parsedEntities[newIndex & ( MAX_PARSE_ENTITIES - 1 )];
+			newNum = newState->number;
+		}
+		if( oldIndex < oldNumEntities ) {
+			oldState = &oldSnap->parsedEntities[oldIndex & ( MAX_PARSE_ENTITIES - 1 )];
+			oldNum = oldState->number;
+		}
+		if( newNum == oldNum ) {
+			MSG_WriteDeltaEntity( &msg, oldState, newState, false, quantization );
+			oldIndex++, newIndex++;
+		} else if( newNum < oldNum ) {
+			MSG_WriteDeltaEntity( &msg, &m_baselines[newNum], newState, true, quantization );
+			newIndex++;
+		} else {
+			MSG_WriteDeltaEntity( &msg, oldState, nullptr, false, quantization );
+			oldIndex++;
+		}
+	}
+	MSG_WriteInt16( &msg, 0 );
+
+	return msg.cursize;
+}
+
+void DemoProcessor::addFrameRows( const snapshot_t *snap ) {
+	const auto &ec = m_entityColumns;
+	for( int i = 0; i < snap->numEntities; ++i ) {
+		const entity_state_t &es = snap->parsedEntities[i & ( MAX_PARSE_ENTITIES - 1 )];
+		m_entities.setI64( ec.frame, snap->serverFrame );
+		m_entities.setI64( ec.serverTime, snap->serverTime );
+		m_entities.setI32( ec.number, es.number );
+		m_entities.setI32( ec.type, es.type );
+		m_entities.setI32( ec.modelindex, (int32_t)es.modelindex );
+		m_entities.setI32( ec.team, es.team );
+		m_entities.setI32( ec.solid, es.solid );
+		m_entities.setI32( ec.effects, (int32_t)es.effects );
+		for( int j = 0; j < 3; ++j ) {
+			m_entities.setF32( ec.origin[j], es.origin[j] );
+		}
+		for( int j = 0; j < 3; ++j ) {
+			m_entities.setF32( ec.angles[j], es.angles[j] );
+		}
+		m_entities.endRow();
+	}
+
+	const auto &pc = m_playerColumns;
+	for( int i = 0; i < snap->numplayers; ++i ) {
+		const player_state_t &ps = snap->playerStates[i];
+		m_players.setI64( pc.frame, snap->serverFrame );
+		m_players.setI64( pc.serverTime, snap->serverTime );
+		m_players.setI32( pc.playerNum, (int32_t)ps.playerNum );
+		m_players.setI32( pc.povNum, (int32_t)ps.POVnum );
+		m_players.setI32( pc.pmType, ps.pmove.pm_type );
+		m_players.setI32( pc.pmFlags, ps.pmove.pm_flags );
+		m_players.setI32( pc.health, ps.stats[STAT_HEALTH] );
+		m_players.setI32( pc.weapon, ps.stats[STAT_WEAPON] );
+		for( int j = 0; j < 3; ++j ) {
+			m_players.setF32( pc.origin[j], ps.pmove.origin[j] );
+		}
+		for( int j = 0; j < 3; ++j ) {
+			m_players.setF32( pc.velocity[j], ps.pmove.velocity[j] );
+		}
+		for( int j = 0; j < 3; ++j ) {
+			m_players.setF32( pc.viewangles[j], ps.viewangles[j] );
+		}
+		m_players.endRow();
+	}
+}
+
+bool DemoProcessor::writeResults( const char *outputPath ) const {
+	const ColumnarTable *tables[] = { &m_entities, &m_players };
+	return WriteColumnarFile( outputPath, tables, 2 );
+}
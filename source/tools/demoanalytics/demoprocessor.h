@@ -0,0 +1,94 @@
+#ifndef WSW_3fff97a5_610c_471c_b560_a415fb9564ff_H
+#define WSW_3fff97a5_610c_471c_b560_a415fb9564ff_H
+
+#include "../../qcommon/qcommon.h"
+#include "../../cgame/cg_public.h"
+#include "columnarwriter.h"
+
+#include <string>
+
+/**
+ * Streams a single demo through the snapshot parsing code without any client or renderer,
+ * collecting per-frame entity and player state data as columnar tables.
+ * Instances are independent and can be used by different threads concurrently.
+ */
+class DemoProcessor {
+	friend class DemoProcessorTest;
+
+	entity_state_t m_baselines[MAX_EDICTS];
+	snapshot_t m_snapshots[UPDATE_BACKUP];
+	uint8_t m_areabits[UPDATE_BACKUP][256];
+	uint8_t m_msgBuffer[MAX_MSGLEN];
+	uint8_t m_encodingBuffer[MAX_MSGLEN];
+
+	ColumnarTable m_entities { "entities" };
+	ColumnarTable m_players { "players" };
+
+	struct {
+		unsigned frame, serverTime, number, type, modelindex, team, solid, effects;
+		unsigned origin[3], angles[3];
+	} m_entityColumns;
+
+	struct {
+		unsigned frame, serverTime, playerNum, povNum, pmType, pmFlags, health, weapon;
+		unsigned origin[3], velocity[3], viewangles[3];
+	} m_playerColumns;
+
+	int64_t m_receivedSnapNum { 0 };
+	int64_t m_firstServerTime { -1 };
+	int64_t m_lastServerTime { -1 };
+	uint64_t m_numFrames { 0 };
+	bool m_reliable { true };
+
+	bool m_measureEntityEncoding { false };
+	msg_quantization_t m_quantization;
+	int64_t m_lastEncodedSnapNum { 0 };
+	uint64_t m_numEncodedFrames { 0 };
+	uint64_t m_plainEntityBytes { 0 };
+	uint64_t m_quantizedEntityBytes { 0 };
+
+	std::string m_error;
+
+	void parseMessage( msg_t *msg );
+	void parseServerData( msg_t *msg );
+	void parseFrame( msg_t *msg );
+	void addFrameRows( const snapshot_t *snap );
+	void measureEntityEncoding( const snapshot_t *oldSnap, const snapshot_t *snap );
+	[[nodiscard]]
+	auto writePacketEntities( const snapshot_t *oldSnap, const snapshot_t *snap, const msg_quantization_t *quantization ) -> size_t;
+public:
+	DemoProcessor();
+
+	/**
+	 * Enables re-encoding of entity updates between consecutive frames
+	 * using the plain and the quantized encoding for comparison of their sizes.
+	 */
+	void setMeasureEntityEncoding( bool measure ) { m_measureEntityEncoding = measure; }
+
+	/**
+	 * Reads and parses the entire demo.
+	 * @return false on failure, the error is available via {@code error()} in this case.
+	 */
+	[[nodiscard]]
+	bool process( const char *demoPath );
+
+	[[nodiscard]]
+	bool writeResults( const char *outputPath ) const;
+
+	[[nodiscard]]
+	auto error() const -> const std::string & { return m_error; }
+	[[nodiscard]]
+	auto numFrames() const -> uint64_t { return m_numFrames; }
+	[[nodiscard]]
+	auto durationMillis() const -> int64_t {
+		return m_firstServerTime >= 0 ? m_lastServerTime - m_firstServerTime : 0;
+	}
+	[[nodiscard]]
+	auto numEncodedFrames() const -> uint64_t { return m_numEncodedFrames; }
+	[[nodiscard]]
+	auto plainEntityBytes() const -> uint64_t { return m_plainEntityBytes; }
+	[[nodiscard]]
+	auto quantizedEntityBytes() const -> uint64_t { return m_quantizedEntityBytes; }
+};
+
+#endif
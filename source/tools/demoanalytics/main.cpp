@@ -0,0 +1,165 @@
+#include "demoprocessor.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Parsing code reports errors via these functions.
+// Errors are fatal for the demo being parsed but not for other ones.
+
+void Com_Error( com_error_code_t, const char *format, ... ) {
+	char buffer[1024];
+	va_list va;
+	va_start( va, format );
+	(void)vsnprintf( buffer, sizeof( buffer ), format, va );
+	va_end( va );
+	throw std::runtime_error( buffer );
+}
+
+void Sys_Error( const char *format, ... ) {
+	char buffer[1024];
+	va_list va;
+	va_start( va, format );
+	(void)vsnprintf( buffer, sizeof( buffer ), format, va );
+	va_end( va );
+	throw std::runtime_error( buffer );
+}
+
+static std::mutex printMutex;
+static bool verbose;
+
+void Com_Printf( const char *format, ... ) {
+	if( verbose ) {
+		std::lock_guard<std::mutex> lock( printMutex );
+		va_list va;
+		va_start( va, format );
+		(void)vfprintf( stderr, format, va );
+		va_end( va );
+	}
+}
+
+static void PrintUsage( const char *programName ) {
+	fprintf( stderr, "Usage: %s [-j <numThreads>] [-o <outputDir>] [-e] [-v] <demo>...\n", programName );
+	fprintf( stderr, "Writes <outputDir>/<demo name>.wdac columnar files with per-frame entity and player data\n" );
+	fprintf( stderr, "-e: Compare sizes of plain and quantized entity updates\n" );
+}
+
+static auto MakeOutputPath( const std::string &outputDir, const std::string &demoPath ) -> std::string {
+	std::string name( demoPath );
+	if( const auto slashPos = name.find_last_of( "/\\" ); slashPos != std::string::npos ) {
+		name = name.substr( slashPos + 1 );
+	}
+	if( const auto dotPos = name.find_last_of( '.' ); dotPos != std::string::npos ) {
+		name = name.substr( 0, dotPos );
+	}
+	return outputDir + "/" + name + ".wdac";
+}
+
+int main( int argc, char **argv ) {
+	std::string outputDir( "." );
+	unsigned numThreads = std::thread::hardware_concurrency();
+	bool measureEntityEncoding = false;
+	std::vector<std::string> demoPaths;
+
+	for( int i = 1; i < argc; ++i ) {
+		const std::string arg( argv[i] );
+		if( arg == "-j" && i + 1 < argc ) {
+			numThreads = (unsigned)std::max( 1, atoi( argv[++i] ) );
+		} else if( arg == "-o" && i + 1 < argc ) {
+			outputDir = argv[++i];
+		} else if( arg == "-v" ) {
+			verbose = true;
+		} else if( arg == "-e" ) {
+			measureEntityEncoding = true;
+		} else if( !arg.empty() && arg[0] == '-' ) {
+			PrintUsage( argv[0] );
+			return 1;
+		} else {
+			demoPaths.push_back( arg );
+		}
+	}
+
+	if( demoPaths.empty() ) {
+		PrintUsage( argv[0] );
+		return 1;
+	}
+
+	numThreads = std::max( 1u, std::min( numThreads, (unsigned)demoPaths.size() ) );
+
+	std::atomic<unsigned> nextDemoIndex { 0 };
+	std::atomic<unsigned> numFailures { 0 };
+	std::atomic<uint64_t> totalFrames { 0 };
+	std::atomic<int64_t> totalDurationMillis { 0 };
+	std::atomic<uint64_t> totalEncodedFrames { 0 };
+	std::atomic<uint64_t> totalPlainEntityBytes { 0 };
+	std::atomic<uint64_t> totalQuantizedEntityBytes { 0 };
+
+	auto workerFn = [&]() {
+		for(;; ) {
+			const unsigned index = nextDemoIndex.fetch_add( 1, std::memory_order_relaxed );
+			if( index >= demoPaths.size() ) {
+				return;
+			}
+
+			const std::string &demoPath = demoPaths[index];
+			// The processor is heavy-weight (it holds the entire snapshots backup)
+			auto processor = std::make_unique<DemoProcessor>();
+			processor->setMeasureEntityEncoding( measureEntityEncoding );
+			bool succeeded = processor->process( demoPath.c_str() );
+			if( succeeded ) {
+				const std::string outputPath( MakeOutputPath( outputDir, demoPath ) );
+				if( !processor->writeResults( outputPath.c_str() ) ) {
+					std::lock_guard<std::mutex> lock( printMutex );
+					fprintf( stderr, "%s: Failed to write %s\n", demoPath.c_str(), outputPath.c_str() );
+					succeeded = false;
+				}
+			} else {
+				std::lock_guard<std::mutex> lock( printMutex );
+				fprintf( stderr, "%s: %s\n", demoPath.c_str(), processor->error().c_str() );
+			}
+
+			if( succeeded ) {
+				totalFrames.fetch_add( processor->numFrames(), std::memory_order_relaxed );
+				totalDurationMillis.fetch_add( processor->durationMillis(), std::memory_order_relaxed );
+				totalEncodedFrames.fetch_add( processor->numEncodedFrames(), std::memory_order_relaxed );
+				totalPlainEntityBytes.fetch_add( processor->plainEntityBytes(), std::memory_order_relaxed );
+				totalQuantizedEntityBytes.fetch_add( processor->quantizedEntityBytes(), std::memory_order_relaxed );
+			} else {
+				numFailures.fetch_add( 1, std::memory_order_relaxed );
+			}
+		}
+	};
+
+	const auto startTime = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> threads;
+	for( unsigned i = 1; i < numThreads; ++i ) {
+		threads.emplace_back( workerFn );
+	}
+	workerFn();
+	for( std::thread &thread: threads ) {
+		thread.join();
+	}
+
+	const auto endTime = std::chrono::steady_clock::now();
+	const double seconds = std::chrono::duration<double>( endTime - startTime ).count();
+	const double demoMinutes = (double)totalDurationMillis.load() / ( 60.0 * 1000.0 );
+
+	printf( "Processed %u demos (%u failed) using %u threads\n", (unsigned)demoPaths.size(), numFailures.load(), numThreads );
+	printf( "%llu frames, %.2f demo-minutes in %.3f seconds\n", (unsigned long long)totalFrames.load(), demoMinutes, seconds );
+	printf( "Throughput: %.2f demo-minutes/s\n", seconds > 0.0 ? demoMinutes / seconds : 0.0 );
+
+	if( const uint64_t numEncodedFrames = totalEncodedFrames.load() ) {
+		const double plainBytes = (double)totalPlainEntityBytes.load() / (double)numEncodedFrames;
+		const double quantizedBytes = (double)totalQuantizedEntityBytes.load() / (double)numEncodedFrames;
+		printf( "Entity updates: %.1f bytes/frame plain, %.1f bytes/frame quantized (%.1f%%)\n",
+				plainBytes, quantizedBytes, plainBytes > 0.0 ? 100.0 * quantizedBytes / plainBytes : 0.0 );
+	}
+
+	return numFailures.load() ? 1 : 0;
+}
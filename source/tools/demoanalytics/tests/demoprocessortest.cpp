@@ -0,0 +1,214 @@
+#include "demoprocessortest.h"
+#include "../demoprocessor.h"
+#include "../../../gameshared/gs_public.h"
+
+#include <cmath>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+struct DemoProcessorTest::FrameParams {
+	int numPlayers { 1 };
+	int numStaticEntities { 0 };
+	bool multipov { false };
+	// Client demos of unreliable connections contain svc_clcack commands
+	bool withAcks { false };
+};
+
+void DemoProcessorTest::parseServerData( DemoProcessor *processor, bool reliable ) {
+	std::vector<uint8_t> buffer( MAX_MSGLEN );
+	msg_t msg;
+	MSG_Init( &msg, buffer.data(), buffer.size() );
+
+	MSG_WriteUint8( &msg, svc_serverdata );
+	MSG_WriteInt32( &msg, APP_PROTOCOL_VERSION );
+	MSG_WriteInt32( &msg, 1 );  // servercount
+	MSG_WriteInt16( &msg, 50 ); // snapFrameTime
+	MSG_WriteInt16( &msg, 0 );  // playernum
+	MSG_WriteString( &msg, "wdm1" );
+	MSG_WriteUint8( &msg, reliable ? SV_BITFLAGS_RELIABLE : 0 );
+	MSG_WriteInt16( &msg, 0 );  // pure files
+
+	MSG_BeginReading( &msg );
+	processor->parseMessage( &msg );
+}
+
+// Writes frames the way SNAP_WriteFrameSnapToClient() does (without deltas) and parses them.
+// Players keep running around with occasional turns, static entities never change.
+void DemoProcessorTest::parseFrames( DemoProcessor *processor, const FrameParams &params, int numFrames ) {
+	std::mt19937 rng( 17 );
+	std::uniform_real_distribution<float> turns( -30.0f, +30.0f );
+	std::uniform_real_distribution<float> positions( -1024.0f, +1024.0f );
+
+	struct Player { vec3_t origin, velocity; float yaw, pitch; };
+	std::vector<Player> players( params.numPlayers );
+	for( Player &player: players ) {
+		player.origin[0] = positions( rng ), player.origin[1] = positions( rng ), player.origin[2] = 0.0f;
+		player.yaw = turns( rng ) * 6.0f, player.pitch = turns( rng ) / 3.0f;
+	}
+
+	std::vector<entity_state_t> staticEntities( params.numStaticEntities );
+	for( size_t i = 0; i < staticEntities.size(); ++i ) {
+		entity_state_t &es = staticEntities[i];
+		memset( &es, 0, sizeof( es ) );
+		es.number = (int)( MAX_CLIENTS + 1 + i );
+		es.type = ET_ITEM;
+		es.modelindex = 1 + i % 8;
+		es.itemNum = 1 + i % 8;
+		es.origin[0] = positions( rng ), es.origin[1] = positions( rng ), es.origin[2] = 24.0f;
+	}
+
+	const game_state_t gameState {};
+	const ReplicatedScoreboardData scoreboardData {};
+	const entity_state_t nullState {};
+
+	std::vector<uint8_t> buffer( MAX_MSGLEN );
+	for( int frameNum = 1; frameNum <= numFrames; ++frameNum ) {
+		// 50 ms per frame at 320 units per second
+		for( Player &player: players ) {
+			if( !( rng() % 4 ) ) {
+				player.yaw = anglemod( player.yaw + turns( rng ) );
+				player.pitch = std::clamp( player.pitch + turns( rng ) / 3.0f, -60.0f, +60.0f );
+			}
+			player.velocity[0] = 320.0f * std::cos( DEG2RAD( player.yaw ) );
+			player.velocity[1] = 320.0f * std::sin( DEG2RAD( player.yaw ) );
+			player.velocity[2] = 0.0f;
+			for( int i = 0; i < 2; ++i ) {
+				player.origin[i] = std::clamp( player.origin[i] + 0.05f * player.velocity[i], -2048.0f, +2048.0f );
+			}
+		}
+
+		msg_t msg;
+		MSG_Init( &msg, buffer.data(), buffer.size() );
+
+		if( params.withAcks ) {
+			MSG_WriteUint8( &msg, svc_clcack );
+			MSG_WriteUintBase128( &msg, frameNum );     // reliable commands acknowledge
+			MSG_WriteUintBase128( &msg, 3 * frameNum ); // ucmd acknowledge
+		}
+
+		MSG_WriteUint8( &msg, svc_frame );
+		const size_t lengthPos = msg.cursize;
+		MSG_WriteInt16( &msg, 0 );
+		MSG_WriteIntBase128( &msg, 50 * frameNum );
+		MSG_WriteUintBase128( &msg, frameNum );
+		MSG_WriteUintBase128( &msg, 0 ); // delta frame
+		MSG_WriteUintBase128( &msg, frameNum ); // ucmd executed
+		MSG_WriteUint8( &msg, params.multipov ? ( FRAMESNAP_FLAG_MULTIPOV | FRAMESNAP_FLAG_ALLENTITIES ) : 0 );
+		MSG_WriteUint8( &msg, 0 ); // suppress count
+
+		MSG_WriteUint8( &msg, svc_gamecommands );
+		MSG_WriteInt16( &msg, -1 );
+		MSG_WriteUint8( &msg, 0 ); // areabits
+
+		MSG_WriteUint8( &msg, svc_match );
+		MSG_WriteDeltaGameState( &msg, nullptr, &gameState );
+		MSG_WriteUint8( &msg, svc_scoreboard );
+		MSG_WriteDeltaScoreboardData( &msg, nullptr, &scoreboardData );
+
+		// Multi-POV frames hold states of all players, otherwise there's a single state of the demo owner
+		const int numPlayerStates = params.multipov ? params.numPlayers : 1;
+		for( int i = 0; i < numPlayerStates; ++i ) {
+			player_state_t ps {};
+			ps.playerNum = i;
+			ps.POVnum = i + 1;
+			ps.stats[STAT_HEALTH] = 100;
+			VectorCopy( players[i].origin, ps.pmove.origin );
+			VectorCopy( players[i].velocity, ps.pmove.velocity );
+			ps.viewangles[PITCH] = players[i].pitch;
+			ps.viewangles[YAW] = players[i].yaw;
+			MSG_WriteUint8( &msg, svc_playerinfo );
+			MSG_WriteDeltaPlayerState( &msg, nullptr, &ps );
+		}
+		MSG_WriteUint8( &msg, 0 );
+
+		MSG_WriteUint8( &msg, svc_packetentities );
+		for( int i = 0; i < params.numPlayers; ++i ) {
+			entity_state_t es {};
+			es.number = i + 1;
+			es.type = ET_PLAYER;
+			es.modelindex = 255;
+			VectorCopy( players[i].origin, es.origin );
+			es.angles[YAW] = players[i].yaw;
+			MSG_WriteDeltaEntity( &msg, &nullState, &es, true );
+		}
+		for( const entity_state_t &es: staticEntities ) {
+			MSG_WriteDeltaEntity( &msg, &nullState, &es, true );
+		}
+		MSG_WriteInt16( &msg, 0 );
+
+		const size_t frameEnd = msg.cursize;
+		msg.cursize = lengthPos;
+		MSG_WriteInt16( &msg, (int)( frameEnd - lengthPos - 2 ) );
+		msg.cursize = frameEnd;
+
+		MSG_BeginReading( &msg );
+		processor->parseMessage( &msg );
+	}
+}
+
+void DemoProcessorTest::test_clientDemoAcks() {
+	auto processor = std::make_unique<DemoProcessor>();
+	parseServerData( processor.get(), false );
+
+	FrameParams params;
+	params.numPlayers = 8;
+	params.numStaticEntities = 16;
+	params.withAcks = true;
+	parseFrames( processor.get(), params, 20 );
+
+	QCOMPARE( processor->numFrames(), (uint64_t)20 );
+	QCOMPARE( processor->durationMillis(), (int64_t)( 50 * 19 ) );
+}
+
+void DemoProcessorTest::test_acksInReliableDemo() {
+	auto processor = std::make_unique<DemoProcessor>();
+	parseServerData( processor.get(), true );
+
+	uint8_t buffer[16];
+	msg_t msg;
+	MSG_Init( &msg, buffer, sizeof( buffer ) );
+	MSG_WriteUint8( &msg, svc_clcack );
+	MSG_WriteUintBase128( &msg, 1 );
+	MSG_WriteUintBase128( &msg, 1 );
+
+	MSG_BeginReading( &msg );
+	QVERIFY_EXCEPTION_THROWN( processor->parseMessage( &msg ), std::runtime_error );
+}
+
+void DemoProcessorTest::test_measureMultiPovFrames() {
+	auto processor = std::make_unique<DemoProcessor>();
+	processor->setMeasureEntityEncoding( true );
+	parseServerData( processor.get(), true );
+
+	FrameParams params;
+	params.numPlayers = 4;
+	params.multipov = true;
+	parseFrames( processor.get(), params, 10 );
+
+	// Server demos are multi-POV, these frames must be measured as well
+	QCOMPARE( processor->numFrames(), (uint64_t)10 );
+	QCOMPARE( processor->numEncodedFrames(), (uint64_t)10 );
+	QVERIFY( processor->plainEntityBytes() > 0 );
+}
+
+void DemoProcessorTest::test_measureFullServerEncoding() {
+	auto processor = std::make_unique<DemoProcessor>();
+	processor->setMeasureEntityEncoding( true );
+	parseServerData( processor.get(), true );
+
+	// A minute of a server demo of a full server
+	FrameParams params;
+	params.numPlayers = MAX_CLIENTS;
+	params.numStaticEntities = 64;
+	params.multipov = true;
+	parseFrames( processor.get(), params, 1200 );
+
+	QCOMPARE( processor->numEncodedFrames(), (uint64_t)1200 );
+	const double plainBytes = (double)processor->plainEntityBytes() / 1200.0;
+	const double quantizedBytes = (double)processor->quantizedEntityBytes() / 1200.0;
+	qInfo( "Entity updates: %.1f bytes/frame plain, %.1f bytes/frame quantized (%.1f%%)",
+		   plainBytes, quantizedBytes, 100.0 * quantizedBytes / plainBytes );
+	QVERIFY( quantizedBytes < plainBytes );
+}
@@ -0,0 +1,23 @@
+#ifndef WSW_6d0b8e3f_2c47_4a19_b5e8_93f1a07c4d26_H
+#define WSW_6d0b8e3f_2c47_4a19_b5e8_93f1a07c4d26_H
+
+#include <QtTest/QtTest>
+
+class DemoProcessor;
+
+class DemoProcessorTest : public QObject {
+	Q_OBJECT
+
+	struct FrameParams;
+
+	void parseServerData( DemoProcessor *processor, bool reliable );
+	void parseFrames( DemoProcessor *processor, const FrameParams &params, int numFrames );
+
+private slots:
+	void test_clientDemoAcks();
+	void test_acksInReliableDemo();
+	void test_measureMultiPovFrames();
+	void test_measureFullServerEncoding();
+};
+
+#endif
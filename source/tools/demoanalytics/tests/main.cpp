@@ -0,0 +1,42 @@
+#include <QCoreApplication>
+#include "demoprocessortest.h"
+#include "../demoprocessor.h"
+
+#include <cstdarg>
+#include <stdexcept>
+
+// Parsing code reports errors via these functions (this matches the tool)
+
+void Com_Error( com_error_code_t, const char *format, ... ) {
+	char buffer[1024];
+	va_list va;
+	va_start( va, format );
+	(void)vsnprintf( buffer, sizeof( buffer ), format, va );
+	va_end( va );
+	throw std::runtime_error( buffer );
+}
+
+void Sys_Error( const char *format, ... ) {
+	char buffer[1024];
+	va_list va;
+	va_start( va, format );
+	(void)vsnprintf( buffer, sizeof( buffer ), format, va );
+	va_end( va );
+	throw std::runtime_error( buffer );
+}
+
+void Com_Printf( const char *, ... ) {}
+
+int main( int argc, char **argv ) {
+	QCoreApplication app( argc, argv );
+	(void)std::setlocale( LC_ALL, "C" );
+
+	int result = 0;
+
+	{
+		DemoProcessorTest demoProcessorTest;
+		result |= QTest::qExec( &demoProcessorTest, argc, argv );
+	}
+
+	return result;
+}
@@ -3,6 +3,8 @@
 #include <QJsonObject>
 #include <QJsonArray>
 
+#include <algorithm>
+
 namespace wsw::ui {
 
 auto ServerListModel::roleNames() const -> QHash<int, QByteArray> {
@@ -42,24 +44,37 @@ auto ServerListModel::columnCount( const QModelIndex & ) const -> int {
 void ServerListModel::clear() {
 	beginResetModel();
 	m_servers.clear();
+	m_numClientsOfServers.clear();
 	endResetModel();
 	Q_EMIT wasReset();
 }
 
 auto ServerListModel::getServerAtIndex( int index ) const -> const PolledGameServer * {
 	if( (unsigned)index < m_servers.size() ) {
-		return m_servers[index];
+		return m_servers[index].server;
 	}
 	return nullptr;
 }
 
-auto ServerListModel::findIndexOfServer( const PolledGameServer *server ) const -> std::optional<unsigned> {
-	for( unsigned i = 0; i < m_servers.size(); ++i ) {
-		if( m_servers[i] == server ) {
-			return i;
-		}
+auto ServerListModel::findIndexOfServer( const wsw::Vector<Entry> &entries,
+										 const PolledGameServer *server ) const -> unsigned {
+	const auto it = m_numClientsOfServers.constFind( server );
+	if( it == m_numClientsOfServers.cend() ) {
+		wsw::failWithLogicError( "Failed to find the server" );
+	}
+
+	const Entry key { server, it.value() };
+	const auto entryIt = std::lower_bound( entries.begin(), entries.end(), key );
+	if( entryIt == entries.end() || entryIt->server != server ) {
+		wsw::failWithLogicError( "The order of servers is broken" );
 	}
-	return std::nullopt;
+
+	return (unsigned)( entryIt - entries.begin() );
+}
+
+void ServerListModel::insertEntry( wsw::Vector<Entry> &entries, const Entry &entry ) {
+	entries.insert( std::upper_bound( entries.begin(), entries.end(), entry ), entry );
+	m_numClientsOfServers[entry.server] = entry.numClients;
 }
 
 auto ServerListModel::data( const QModelIndex &modelIndex, int role ) const -> QVariant {
@@ -96,70 +111,122 @@ auto ServerListModel::data( const QModelIndex &modelIndex, int role ) const -> Q
 	}
 }
 
-void ServerListModel::onServerAdded( const PolledGameServer *server ) {
-	if( findIndexOfServer( server ) ) {
-		wsw::failWithLogicError( "The server is already present" );
-	}
+void ServerListModel::onServerListChanged( const ServerListChangeSet &changeSet ) {
+	const int oldNumServers = (int)m_servers.size();
+	const int oldRowCount = rowCount( QModelIndex() );
 
-	const auto serversCount = (int)m_servers.size();
-	if( serversCount % 2 ) {
-		m_servers.push_back( server );
-		const QModelIndex modelIndex( index( rowCount( QModelIndex() ), 1 ) );
-		Q_EMIT dataChanged( modelIndex, modelIndex );
-		return;
+	// Build the new order incrementally, only changed entries get repositioned
+	m_nextServers.assign( m_servers.begin(), m_servers.end() );
+
+	for( const PolledGameServer *server: changeSet.removed ) {
+		m_nextServers.erase( m_nextServers.begin() + findIndexOfServer( m_nextServers, server ) );
+		m_numClientsOfServers.remove( server );
 	}
 
-	const auto newRowCount = ( serversCount + 1 ) / 2;
-	beginInsertRows( QModelIndex(), newRowCount, newRowCount );
-	m_servers.push_back( server );
-	endInsertRows();
-}
+	for( const ServerListChangeSet::Update &update: changeSet.updated ) {
+		if( update.changedFields & ServerInfo::NumClientsField ) {
+			const unsigned index = findIndexOfServer( m_nextServers, update.server );
+			if( m_nextServers[index].numClients != update.server->getNumClients() ) {
+				m_nextServers.erase( m_nextServers.begin() + index );
+				insertEntry( m_nextServers, { update.server, update.server->getNumClients() } );
+			}
+		}
+	}
 
-void ServerListModel::onServerRemoved( const PolledGameServer *server ) {
-	const auto maybeServerIndex = findIndexOfServer( server );
-	if( !maybeServerIndex ) {
-		wsw::failWithLogicError( "Failed to find the server for removal" );
+	for( const PolledGameServer *server: changeSet.added ) {
+		if( m_numClientsOfServers.contains( server ) ) {
+			wsw::failWithLogicError( "The server is already present" );
+		}
+		insertEntry( m_nextServers, { server, server->getNumClients() } );
 	}
 
-	// Swap with the last row.
-	// The QSortFilterProxy model that we're going to use
-	// should help to preserve the desired order regardless of that.
-	std::swap( m_servers[*maybeServerIndex], m_servers.back() );
+	const int newNumServers = (int)m_nextServers.size();
+	const int newRowCount = ( newNumServers + 1 ) / 2;
+	const int numCommonRows = wsw::min( oldRowCount, newRowCount );
 
-	// TODO: Optimize dispatching updates (specify the rectangle in a QModelIndex() constructor)
-	assert( !m_servers.empty() );
-	for( unsigned i = *maybeServerIndex; i < m_servers.size() - 1u; ++i ) {
-		const auto row = (int)i / 2;
-		const auto column = (int)i % 2;
-		const QModelIndex modelIndex( index( row, column ) );
-		Q_EMIT dataChanged( modelIndex, modelIndex );
+	// Cells of common rows which have got another server (or became empty) are fully changed
+	m_cellRolesMasks.assign( 2 * numCommonRows, 0 );
+	for( int i = 0; i < 2 * numCommonRows; ++i ) {
+		const PolledGameServer *oldServer = i < oldNumServers ? m_servers[i].server : nullptr;
+		const PolledGameServer *newServer = i < newNumServers ? m_nextServers[i].server : nullptr;
+		if( oldServer != newServer ) {
+			m_cellRolesMasks[i] = kAllRolesMask;
+		}
 	}
 
-	const auto oldLastRow = (int)m_servers.size() / 2;
-	// If there's going to be a row removal
-	if( m_servers.size() % 2 ) {
-		beginRemoveRows( QModelIndex(), oldLastRow, oldLastRow );
-		m_servers.pop_back();
+	// Cells that still hold the same server get only roles of changed fields updated
+	for( const ServerListChangeSet::Update &update: changeSet.updated ) {
+		const unsigned index = findIndexOfServer( m_nextServers, update.server );
+		if( index < m_cellRolesMasks.size() ) {
+			m_cellRolesMasks[index] |= toRolesMask( update.changedFields );
+		}
+	}
+
+	if( newRowCount < oldRowCount ) {
+		beginRemoveRows( QModelIndex(), newRowCount, oldRowCount - 1 );
+		m_servers.swap( m_nextServers );
 		endRemoveRows();
+	} else if( newRowCount > oldRowCount ) {
+		beginInsertRows( QModelIndex(), oldRowCount, newRowCount - 1 );
+		m_servers.swap( m_nextServers );
+		endInsertRows();
 	} else {
-		m_servers.pop_back();
-		// Make the bottom-right cell reflect it's now-empty status
-		const QModelIndex modelIndex( index( oldLastRow, 1 ) );
-		Q_EMIT dataChanged( modelIndex, modelIndex );
+		m_servers.swap( m_nextServers );
 	}
+
+	dispatchDataChanges( numCommonRows );
 }
 
-void ServerListModel::onServerUpdated( const PolledGameServer *server ) {
-	const auto maybeServerIndex = findIndexOfServer( server );
-	if( !maybeServerIndex ) {
-		wsw::failWithLogicError( "Failed to find the server for update" );
+void ServerListModel::dispatchDataChanges( int numRows ) {
+	// Emit a signal per a contiguous range of rows that share the same set of changed roles
+	for( int startRow = 0; startRow < numRows; ) {
+		const unsigned rolesMask = m_cellRolesMasks[2 * startRow] | m_cellRolesMasks[2 * startRow + 1];
+		int endRow = startRow + 1;
+		for(; endRow < numRows; ++endRow ) {
+			if( ( m_cellRolesMasks[2 * endRow] | m_cellRolesMasks[2 * endRow + 1] ) != rolesMask ) {
+				break;
+			}
+		}
+		if( rolesMask ) {
+			// An empty vector of roles stands for all roles
+			const QVector<int> roles( rolesMask == kAllRolesMask ? QVector<int>() : toRolesVector( rolesMask ) );
+			Q_EMIT dataChanged( index( startRow, 0 ), index( endRow - 1, 1 ), roles );
+		}
+		startRow = endRow;
 	}
+}
+
+auto ServerListModel::toRolesMask( unsigned changedFields ) -> unsigned {
+	const auto bit = []( Role role ) -> unsigned { return 1u << ( role - ServerName ); };
 
-	const auto row = (int)*maybeServerIndex / 2;
-	const auto column = (int)*maybeServerIndex % 2;
+	unsigned result = 0;
+	result |= ( changedFields & ServerInfo::ServerNameField ) ? bit( ServerName ) : 0;
+	result |= ( changedFields & ServerInfo::GametypeField ) ? bit( Gametype ) : 0;
+	result |= ( changedFields & ServerInfo::MapNameField ) ? bit( MapName ) : 0;
+	if( changedFields & ServerInfo::TimeField ) {
+		result |= bit( TimeMinutes ) | bit( TimeSeconds ) | bit( TimeFlags );
+	}
+	if( changedFields & ServerInfo::ScoreField ) {
+		result |= bit( AlphaTeamName ) | bit( BetaTeamName ) | bit( AlphaTeamScore ) | bit( BetaTeamScore );
+	}
+	result |= ( changedFields & ServerInfo::NumClientsField ) ? bit( NumPlayers ) : 0;
+	result |= ( changedFields & ServerInfo::MaxClientsField ) ? bit( MaxPlayers ) : 0;
+	result |= ( changedFields & ServerInfo::SpectatorsField ) ? bit( SpectatorsList ) : 0;
+	result |= ( changedFields & ServerInfo::PlayersTeamField ) ? bit( PlayersTeamList ) : 0;
+	result |= ( changedFields & ServerInfo::AlphaTeamField ) ? bit( AlphaTeamList ) : 0;
+	result |= ( changedFields & ServerInfo::BetaTeamField ) ? bit( BetaTeamList ) : 0;
+	// Bots count and password flags are not displayed yet
+	return result;
+}
 
-	const QModelIndex modelIndex( index( row, column ) );
-	Q_EMIT dataChanged( modelIndex, modelIndex );
+auto ServerListModel::toRolesVector( unsigned rolesMask ) -> QVector<int> {
+	QVector<int> result;
+	for( unsigned i = 0; rolesMask >> i; ++i ) {
+		if( rolesMask & ( 1u << i ) ) {
+			result.append( ServerName + (int)i );
+		}
+	}
+	return result;
 }
 
 auto ServerListModel::toQmlTeamList( const PlayerInfo *playerInfoHead ) -> QVariant {
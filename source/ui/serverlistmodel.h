@@ -4,12 +4,17 @@
 #include "../client/serverlist.h"
 #include "../qcommon/wswvector.h"
 #include <QAbstractTableModel>
+#include <QHash>
+
+class ServerListModelTest;
 
 namespace wsw::ui {
 
 class ServerListModel : public QAbstractTableModel, public ServerListListener {
 	Q_OBJECT
 
+	friend class ::ServerListModelTest;
+
 	enum Role {
 		ServerName = Qt::UserRole + 1,
 		MapName,
@@ -31,13 +36,45 @@ class ServerListModel : public QAbstractTableModel, public ServerListListener {
 		SpectatorsList
 	};
 
-	wsw::Vector<const PolledGameServer *> m_servers;
+	static constexpr unsigned kAllRolesMask = ( 1u << ( SpectatorsList - ServerName + 1 ) ) - 1;
+
+	// Servers are kept ordered by the number of clients (descending), then by arrival order.
+	// The number of clients is cached as it's the sort key that was used for the entry placement.
+	struct Entry {
+		const PolledGameServer *server;
+		int numClients;
+
+		[[nodiscard]]
+		bool operator<( const Entry &that ) const {
+			if( numClients != that.numClients ) {
+				return numClients > that.numClients;
+			}
+			return server->getInstanceId() < that.server->getInstanceId();
+		}
+	};
+
+	wsw::Vector<Entry> m_servers;
+	// Caches sort keys of entries so their positions could be found by a binary search
+	QHash<const PolledGameServer *, int> m_numClientsOfServers;
+
+	// Reused buffers for building a new order
+	wsw::Vector<Entry> m_nextServers;
+	wsw::Vector<unsigned> m_cellRolesMasks;
 
 	[[nodiscard]]
 	auto getServerAtIndex( int index ) const -> const PolledGameServer *;
 
 	[[nodiscard]]
-	auto findIndexOfServer( const PolledGameServer *server ) const -> std::optional<unsigned>;
+	auto findIndexOfServer( const wsw::Vector<Entry> &entries, const PolledGameServer *server ) const -> unsigned;
+
+	void insertEntry( wsw::Vector<Entry> &entries, const Entry &entry );
+
+	void dispatchDataChanges( int numRows );
+
+	[[nodiscard]]
+	static auto toRolesMask( unsigned changedFields ) -> unsigned;
+	[[nodiscard]]
+	static auto toRolesVector( unsigned rolesMask ) -> QVector<int>;
 
 	[[nodiscard]]
 	static auto toQmlTeamList( const PlayerInfo *playerInfoHead ) -> QVariant;
@@ -67,9 +104,7 @@ public:
 
 	void clear();
 
-	void onServerAdded( const PolledGameServer *server ) override;
-	void onServerUpdated( const PolledGameServer *server ) override;
-	void onServerRemoved( const PolledGameServer *server ) override;
+	void onServerListChanged( const ServerListChangeSet &changeSet ) override;
 };
 
 }